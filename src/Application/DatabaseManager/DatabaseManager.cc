@@ -42,12 +42,261 @@
 namespace Seg3D
 {
 
+// Number of compiled statements that are kept per database
+const static size_t STATEMENT_CACHE_SIZE_C = 128;
+
 class DatabaseManagerPrivate : public Core::RecursiveLockable {
 public:
+  // GET_STATEMENT:
+  // Get the compiled statement for the SQL text, compiling it if it is not in the cache.
+  sqlite3_stmt* get_statement( const std::string& sql_str, std::string& error );
+
+  // CLEAR_STATEMENTS:
+  // Finalize all the cached statements.
+  void clear_statements();
+
+  // SET_CONNECTION:
+  // Replace the database connection, the old one is closed.
+  void set_connection( sqlite3* database, const boost::filesystem::path& database_file );
+
   // The actual database
   sqlite3* database_;
+
+  // Compiled statements by their SQL text
+  std::map< std::string, sqlite3_stmt* > statements_;
+
+  // File the database is kept in, empty if it is kept in memory
+  boost::filesystem::path database_file_;
 };
 
+sqlite3_stmt* DatabaseManagerPrivate::get_statement( const std::string& sql_str, 
+  std::string& error )
+{
+  std::map< std::string, sqlite3_stmt* >::iterator it = this->statements_.find( sql_str );
+  if ( it != this->statements_.end() ) return it->second;
+
+  sqlite3_stmt* statement = NULL;
+  if ( sqlite3_prepare_v2( this->database_, sql_str.c_str(), 
+    static_cast< int >( sql_str.size() ), &statement, NULL ) != SQLITE_OK || 
+    statement == NULL )
+  {
+    error =  "The SQL statement '" + sql_str + "' failed to compile with error: "
+      + sqlite3_errmsg( this->database_ );
+    return NULL;
+  }
+
+  // NOTE: Statements are meant to be written with placeholders, so the cache only overflows
+  // if statements with embedded values are run. In that case start over.
+  if ( this->statements_.size() >= STATEMENT_CACHE_SIZE_C ) this->clear_statements();
+  this->statements_[ sql_str ] = statement;
+  return statement;
+}
+
+void DatabaseManagerPrivate::clear_statements()
+{
+  std::map< std::string, sqlite3_stmt* >::iterator it = this->statements_.begin();
+  for ( ; it != this->statements_.end(); ++it )
+  {
+    sqlite3_finalize( it->second );
+  }
+  this->statements_.clear();
+}
+
+void DatabaseManagerPrivate::set_connection( sqlite3* database, 
+  const boost::filesystem::path& database_file )
+{
+  if ( this->database_ )
+  {
+    this->clear_statements();
+    sqlite3_close( this->database_ );
+  }
+  this->database_ = database;
+  this->database_file_ = database_file;
+}
+
+SqlValueList::value_type SqlValueList::get_type( size_t index ) const
+{
+  return this->values_[ index ].type_;
+}
+
+bool SqlValueList::is_null( size_t index ) const
+{
+  return this->values_[ index ].type_ == NULL_E;
+}
+
+long long SqlValueList::get_int64( size_t index ) const
+{
+  const Value& value = this->values_[ index ];
+  if ( value.type_ == INTEGER_E ) return value.int_;
+  if ( value.type_ == FLOAT_E ) return static_cast< long long >( value.double_ );
+  return 0;
+}
+
+double SqlValueList::get_double( size_t index ) const
+{
+  const Value& value = this->values_[ index ];
+  if ( value.type_ == FLOAT_E ) return value.double_;
+  if ( value.type_ == INTEGER_E ) return static_cast< double >( value.int_ );
+  return 0.0;
+}
+
+std::string SqlValueList::get_text( size_t index ) const
+{
+  size_t length;
+  const char* data = this->get_text_data( index, length );
+  return std::string( data, length );
+}
+
+const char* SqlValueList::get_text_data( size_t index, size_t& length ) const
+{
+  const Value& value = this->values_[ index ];
+  if ( value.type_ != TEXT_E || value.text_length_ == 0 )
+  {
+    length = 0;
+    return "";
+  }
+  length = value.text_length_;
+  return &this->text_[ value.text_offset_ ];
+}
+
+void SqlValueList::clear()
+{
+  this->values_.clear();
+  this->text_.clear();
+}
+
+void SqlValueList::push_back_null()
+{
+  Value value;
+  value.type_ = NULL_E;
+  value.int_ = 0;
+  value.text_length_ = 0;
+  this->values_.push_back( value );
+}
+
+void SqlValueList::push_back_int64( long long int_value )
+{
+  Value value;
+  value.type_ = INTEGER_E;
+  value.int_ = int_value;
+  value.text_length_ = 0;
+  this->values_.push_back( value );
+}
+
+void SqlValueList::push_back_double( double double_value )
+{
+  Value value;
+  value.type_ = FLOAT_E;
+  value.double_ = double_value;
+  value.text_length_ = 0;
+  this->values_.push_back( value );
+}
+
+void SqlValueList::push_back_text( const char* text_value, size_t length )
+{
+  Value value;
+  value.type_ = TEXT_E;
+  value.text_offset_ = this->text_.size();
+  value.text_length_ = length;
+  this->text_.insert( this->text_.end(), text_value, text_value + length );
+  this->values_.push_back( value );
+}
+
+size_t SqlValueList::get_size() const
+{
+  return this->values_.size();
+}
+
+SqlParameters& SqlParameters::add_null()
+{
+  this->push_back_null();
+  return *this;
+}
+
+SqlParameters& SqlParameters::add_int64( long long value )
+{
+  this->push_back_int64( value );
+  return *this;
+}
+
+SqlParameters& SqlParameters::add_double( double value )
+{
+  this->push_back_double( value );
+  return *this;
+}
+
+SqlParameters& SqlParameters::add_text( const std::string& value )
+{
+  this->push_back_text( value.c_str(), value.size() );
+  return *this;
+}
+
+size_t SqlParameters::size() const
+{
+  return this->get_size();
+}
+
+SqlResult::SqlResult() :
+  num_rows_( 0 )
+{
+}
+
+size_t SqlResult::get_num_rows() const
+{
+  return this->num_rows_;
+}
+
+size_t SqlResult::get_num_columns() const
+{
+  return this->column_names_.size();
+}
+
+const std::string& SqlResult::get_column_name( size_t column ) const
+{
+  return this->column_names_[ column ];
+}
+
+int SqlResult::get_column_index( const std::string& name ) const
+{
+  for ( size_t j = 0; j < this->column_names_.size(); ++j )
+  {
+    if ( this->column_names_[ j ] == name ) return static_cast< int >( j );
+  }
+  return -1;
+}
+
+SqlValueList::value_type SqlResult::get_type( size_t row, size_t column ) const
+{
+  return SqlValueList::get_type( row * this->column_names_.size() + column );
+}
+
+bool SqlResult::is_null( size_t row, size_t column ) const
+{
+  return SqlValueList::is_null( row * this->column_names_.size() + column );
+}
+
+long long SqlResult::get_int64( size_t row, size_t column ) const
+{
+  return SqlValueList::get_int64( row * this->column_names_.size() + column );
+}
+
+double SqlResult::get_double( size_t row, size_t column ) const
+{
+  return SqlValueList::get_double( row * this->column_names_.size() + column );
+}
+
+std::string SqlResult::get_text( size_t row, size_t column ) const
+{
+  return SqlValueList::get_text( row * this->column_names_.size() + column );
+}
+
+void SqlResult::clear()
+{
+  SqlValueList::clear();
+  this->column_names_.clear();
+  this->num_rows_ = 0;
+}
+
 
 DatabaseManager::DatabaseManager() :
   private_( new DatabaseManagerPrivate )
@@ -98,6 +347,8 @@ DatabaseManager::~DatabaseManager()
   // We need to close the database to avoid memory leak.
   if ( this->private_->database_ )
   {
+    // NOTE: The database cannot be closed while there are compiled statements
+    this->private_->clear_statements();
     sqlite3_close( this->private_->database_ );
   }
 }
@@ -188,6 +439,118 @@ bool DatabaseManager::run_sql_statement( const std::string& sql_str, ResultSet&
   return true;
 }
 
+bool DatabaseManager::run_prepared_statement( const std::string& sql_str, 
+  const SqlParameters& parameters, std::string& error )
+{
+  SqlResult dummy_result;
+  return this->run_prepared_statement( sql_str, parameters, dummy_result, error );
+}
+
+bool DatabaseManager::run_prepared_statement( const std::string& sql_str, 
+  const SqlParameters& parameters, SqlResult& result, std::string& error )
+{
+  result.clear();
+
+  DatabaseManagerPrivate::lock_type lock( this->private_->get_mutex() );
+
+  if ( this->private_->database_ == NULL )
+  {
+    error = "Invalid database connection.";
+    return false;
+  }
+
+  sqlite3_stmt* statement = this->private_->get_statement( sql_str, error );
+  if ( statement == NULL ) return false;
+
+  if ( static_cast< int >( parameters.size() ) != sqlite3_bind_parameter_count( statement ) )
+  {
+    error = "The SQL statement '" + sql_str + "' was given the wrong number of parameters.";
+    return false;
+  }
+
+  int bind_result = SQLITE_OK;
+  for ( size_t j = 0; j < parameters.size() && bind_result == SQLITE_OK; ++j )
+  {
+    int index = static_cast< int >( j + 1 );
+    switch ( parameters.get_type( j ) )
+    {
+    case SqlValueList::INTEGER_E:
+      bind_result = sqlite3_bind_int64( statement, index, parameters.get_int64( j ) );
+      break;
+    case SqlValueList::FLOAT_E:
+      bind_result = sqlite3_bind_double( statement, index, parameters.get_double( j ) );
+      break;
+    case SqlValueList::TEXT_E:
+      {
+        size_t length;
+        const char* text = parameters.get_text_data( j, length );
+        // NOTE: The parameters outlive the execution of the statement, hence the text does
+        // not need to be copied.
+        bind_result = sqlite3_bind_text( statement, index, text, static_cast< int >( length ),
+          SQLITE_STATIC );
+        break;
+      }
+    case SqlValueList::NULL_E:
+    default:
+      bind_result = sqlite3_bind_null( statement, index );
+      break;
+    }
+  }
+
+  int step_result = bind_result;
+  if ( bind_result == SQLITE_OK )
+  {
+    int num_columns = sqlite3_column_count( statement );
+    for ( int j = 0; j < num_columns; ++j )
+    {
+      result.column_names_.push_back( sqlite3_column_name( statement, j ) );
+    }
+
+    while ( ( step_result = sqlite3_step( statement ) ) == SQLITE_ROW )
+    {
+      for ( int j = 0; j < num_columns; ++j )
+      {
+        switch( sqlite3_column_type( statement, j ) )
+        {
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+          {
+            const char* text = reinterpret_cast< const char* >( 
+              sqlite3_column_text( statement, j ) );
+            result.push_back_text( text, static_cast< size_t >( 
+              sqlite3_column_bytes( statement, j ) ) );
+            break;
+          }
+        case SQLITE_INTEGER:
+          result.push_back_int64( sqlite3_column_int64( statement, j ) );
+          break;
+        case SQLITE_FLOAT:
+          result.push_back_double( sqlite3_column_double( statement, j ) );
+          break;
+        case SQLITE_NULL:
+        default:
+          result.push_back_null();
+          break;
+        }
+      }
+      result.num_rows_++;
+    }
+  }
+
+  // Make the statement ready for the next call
+  std::string error_message = sqlite3_errmsg( this->private_->database_ );
+  sqlite3_reset( statement );
+  sqlite3_clear_bindings( statement );
+
+  if ( step_result != SQLITE_DONE )
+  {
+    error =  "The SQL statement '" + sql_str + "' returned error: " + error_message;
+    return false;
+  } 
+
+  return true;
+}
+
 bool DatabaseManager::run_sql_script( const std::string& sql_str, std::string& error )
 {
   DatabaseManagerPrivate::lock_type lock( this->private_->get_mutex() );
@@ -248,6 +611,24 @@ bool DatabaseManager::load_database( const boost::filesystem::path& database_fil
     return false;
   }
   
+  // The schema is replaced, hence recompile the statements when they are used next
+  this->private_->clear_statements();
+
+  // Loading always restores into memory, make sure the file of an on-disk database
+  // is not overwritten
+  if ( !this->private_->database_file_.empty() )
+  {
+    sqlite3* memory_database;
+    if ( sqlite3_open( ":memory:", &memory_database ) != SQLITE_OK )
+    {
+      sqlite3_close( temp_open_database );
+      sqlite3_close( memory_database );
+      error = "Could not create in-memory database.";
+      return false;
+    }
+    this->private_->set_connection( memory_database, boost::filesystem::path() );
+  }
+
   backup_database_object = 
     sqlite3_backup_init( this->private_->database_, "main", temp_open_database, "main" );
   
@@ -278,6 +659,14 @@ bool DatabaseManager::save_database( const boost::filesystem::path& database_fil
   std::string& error )
 {
   DatabaseManagerPrivate::lock_type lock( this->private_->get_mutex() );
+
+  // An on-disk database only needs to move its log into the database file
+  if ( !this->private_->database_file_.empty() && 
+    database_file == this->private_->database_file_ )
+  {
+    return this->checkpoint_database( error );
+  }
+
   int result;
   sqlite3* temp_open_database;
   sqlite3_backup* backup_database_object;
@@ -313,6 +702,77 @@ bool DatabaseManager::save_database( const boost::filesystem::path& database_fil
   return true;  
 }
 
+bool DatabaseManager::open_database( const boost::filesystem::path& database_file, 
+  std::string& error )
+{
+  DatabaseManagerPrivate::lock_type lock( this->private_->get_mutex() );
+
+  if ( !this->private_->database_file_.empty() && 
+    database_file == this->private_->database_file_ )
+  {
+    return true;
+  }
+
+  // Write the current content to the file if there is no database yet
+  if ( !boost::filesystem::exists( database_file ) && 
+    !this->save_database( database_file, error ) )
+  {
+    return false;
+  }
+
+  sqlite3* file_database;
+  if ( sqlite3_open( database_file.string().c_str(), &file_database ) != SQLITE_OK )
+  {
+    sqlite3_close( file_database );
+    error = std::string( "Could not open database file '" ) + database_file.string() + "'.";
+    return false;
+  }
+
+  // NOTE: WAL mode is persistent, it is stored in the database file. Synchronous NORMAL
+  // only syncs on checkpoints, which in WAL mode keeps the database consistent after
+  // a crash, though the last transactions may be lost after a power failure.
+  // NOTE: This also fails if the file is not a database, in which case the current
+  // connection is kept.
+  if ( sqlite3_exec( file_database, "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;"
+    "PRAGMA foreign_keys = ON;", NULL, NULL, NULL ) != SQLITE_OK )
+  {
+    error = std::string( "Could not open database file '" ) + database_file.string() + 
+      "': " + sqlite3_errmsg( file_database );
+    sqlite3_close( file_database );
+    return false;
+  }
+
+  this->private_->set_connection( file_database, database_file );
+
+  error = "";
+  return true;
+}
+
+bool DatabaseManager::checkpoint_database( std::string& error )
+{
+  DatabaseManagerPrivate::lock_type lock( this->private_->get_mutex() );
+
+  if ( this->private_->database_file_.empty() ) return true;
+
+  if ( sqlite3_wal_checkpoint_v2( this->private_->database_, NULL, SQLITE_CHECKPOINT_FULL,
+    NULL, NULL ) != SQLITE_OK )
+  {
+    error = std::string( "Could not checkpoint database file '" ) + 
+      this->private_->database_file_.string() + "': " + 
+      sqlite3_errmsg( this->private_->database_ );
+    return false;
+  }
+
+  error = "";
+  return true;
+}
+
+boost::filesystem::path DatabaseManager::get_database_file()
+{
+  DatabaseManagerPrivate::lock_type lock( this->private_->get_mutex() );
+  return this->private_->database_file_;
+}
+
 long long DatabaseManager::get_last_insert_rowid()
 {
   if ( this->private_->database_ != 0 )
@@ -35,6 +35,8 @@
 
 // STL includes
 #include <map>
+#include <string>
+#include <vector>
 
 // Boost includes
 #include <boost/filesystem.hpp>
@@ -47,6 +49,132 @@ namespace Seg3D
 
 typedef std::vector< std::map< std::string, boost::any > > ResultSet;
 
+// CLASS SqlValueList:
+/// List of typed values, which stores text of all values in one buffer so no memory is 
+/// allocated per value. It is the base of the parameters and the results of prepared statements.
+class SqlValueList
+{
+public:
+  enum value_type
+  {
+    NULL_E = 0,
+    INTEGER_E,
+    FLOAT_E,
+    TEXT_E
+  };
+
+  /// GET_TYPE:
+  /// Get the type of a value.
+  value_type get_type( size_t index ) const;
+
+  /// IS_NULL:
+  /// Check whether a value is NULL.
+  bool is_null( size_t index ) const;
+
+  /// GET_INT64:
+  /// Get a value as an integer. Float values are truncated, other values are zero.
+  long long get_int64( size_t index ) const;
+
+  /// GET_DOUBLE:
+  /// Get a value as a floating point number. Other values than numbers are zero.
+  double get_double( size_t index ) const;
+
+  /// GET_TEXT:
+  /// Get a text value. Other values than text are empty strings.
+  std::string get_text( size_t index ) const;
+
+  /// GET_TEXT_DATA:
+  /// Get a text value without copying it. The pointer is valid until the list is changed.
+  const char* get_text_data( size_t index, size_t& length ) const;
+
+  /// CLEAR:
+  /// Remove all values.
+  void clear();
+
+protected:
+  void push_back_null();
+  void push_back_int64( long long value );
+  void push_back_double( double value );
+  void push_back_text( const char* value, size_t length );
+
+  size_t get_size() const;
+
+private:
+  class Value
+  {
+  public:
+    value_type type_;
+    union
+    {
+      long long int_;
+      double double_;
+      size_t text_offset_;
+    };
+    size_t text_length_;
+  };
+
+  std::vector< Value > values_;
+  std::vector< char > text_;
+};
+
+// CLASS SqlParameters:
+/// Parameters that are bound to the ?-placeholders of a prepared statement, in order.
+class SqlParameters : public SqlValueList
+{
+public:
+  SqlParameters& add_null();
+  SqlParameters& add_int64( long long value );
+  SqlParameters& add_double( double value );
+  SqlParameters& add_text( const std::string& value );
+
+  /// SIZE:
+  /// Number of parameters.
+  size_t size() const;
+};
+
+// CLASS SqlResult:
+/// Rows returned by a prepared statement. The cells are stored row by row in one list, and
+/// columns are addressed by index, which can be looked up from the name once per query.
+class SqlResult : public SqlValueList
+{
+public:
+  SqlResult();
+
+  /// GET_NUM_ROWS:
+  /// Number of rows in the result.
+  size_t get_num_rows() const;
+
+  /// GET_NUM_COLUMNS:
+  /// Number of columns in the result.
+  size_t get_num_columns() const;
+
+  /// GET_COLUMN_NAME:
+  /// Name of a column.
+  const std::string& get_column_name( size_t column ) const;
+
+  /// GET_COLUMN_INDEX:
+  /// Index of the column with the given name, or -1 if there is no such column.
+  int get_column_index( const std::string& name ) const;
+
+  /// GET_TYPE, IS_NULL, GET_INT64, GET_DOUBLE, GET_TEXT:
+  /// Access a cell of the result.
+  value_type get_type( size_t row, size_t column ) const;
+  bool is_null( size_t row, size_t column ) const;
+  long long get_int64( size_t row, size_t column ) const;
+  double get_double( size_t row, size_t column ) const;
+  std::string get_text( size_t row, size_t column ) const;
+
+  /// CLEAR:
+  /// Remove all rows and columns.
+  void clear();
+
+private:
+  friend class DatabaseManager;
+
+  std::vector< std::string > column_names_;
+  size_t num_rows_;
+};
+
 // Forward declaration
 class DatabaseManager;
 typedef boost::shared_ptr< DatabaseManager > DatabaseManagerHandle;
@@ -77,18 +205,48 @@ public:
   /// Returns true on success, otherwise false.
   bool run_sql_statement( const std::string& sql_str, std::string& error );
   
+  /// RUN_PREPARED_STATEMENT:
+  /// Execute a SQL statement with ?-placeholders, which are bound to the parameters. The
+  /// compiled statement is cached by its text, hence the text should not contain values
+  /// that change between calls. Any results are put in the result.
+  /// Returns true on success, otherwise false.
+  bool run_prepared_statement( const std::string& sql_str, const SqlParameters& parameters, 
+    SqlResult& result, std::string& error );
+
+  /// RUN_PREPARED_STATEMENT:
+  /// Execute a SQL statement with ?-placeholders, which are bound to the parameters.
+  /// Returns true on success, otherwise false.
+  bool run_prepared_statement( const std::string& sql_str, const SqlParameters& parameters,
+    std::string& error );
+
   /// RUN_SQL_SCRIPT:
   /// Execute multiple SQL statements sequentially.
   bool run_sql_script( const std::string& sql_str, std::string& error );
 
   /// SAVE_DATABASE:
-  /// Save the database to disk
+  /// Save the database to disk. If the database is kept in that file already, it is only
+  /// checkpointed.
   bool save_database( const boost::filesystem::path& database_file, std::string& error );
   
   /// LOAD_DATABASE:
-  /// Load the database from disk
+  /// Load the database from disk into memory
   bool load_database( const boost::filesystem::path& database_file, std::string& error );
 
+  /// OPEN_DATABASE:
+  /// Keep the database in the given file instead of in memory. If the file does not exist yet,
+  /// it is created from the current content. The file is put in WAL mode, so every statement
+  /// only appends its changes to the log file, and committed changes survive a crash.
+  bool open_database( const boost::filesystem::path& database_file, std::string& error );
+
+  /// CHECKPOINT_DATABASE:
+  /// Write the changes in the log file of an on-disk database back into the database file.
+  /// Does nothing for an in-memory database.
+  bool checkpoint_database( std::string& error );
+
+  /// GET_DATABASE_FILE:
+  /// The file an on-disk database is kept in, or an empty path if it is kept in memory.
+  boost::filesystem::path get_database_file();
+
   /// GET_LAST_INSERT_ROWID:
   /// Return the row ID of last successful insert statement.
   long long get_last_insert_rowid();
@@ -0,0 +1,291 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+ 
+ The MIT License
+ 
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+ 
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include <boost/any.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+#include <Core/Utils/StringUtil.h>
+
+#include <Application/DatabaseManager/DatabaseManager.h>
+#include <Testing/Utils/FilesystemPaths.h>
+
+using namespace Seg3D;
+using namespace Testing::Utils;
+
+// Tables of the provenance database that are used by the provenance queries
+static void createProvenanceTables( DatabaseManager& database )
+{
+  std::string error;
+  ASSERT_TRUE( database.run_sql_script( 
+    "CREATE TABLE user (user_id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+    "user_name TEXT NOT NULL UNIQUE);"
+    "CREATE TABLE action (action_id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+    "action_name TEXT NOT NULL UNIQUE);"
+    "CREATE TABLE provenance_step (prov_step_id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+    "action_id INTEGER NOT NULL REFERENCES action(action_id) ON DELETE CASCADE, "
+    "action_params TEXT NOT NULL, timestamp TEXT NOT NULL DEFAULT CURRENT_TIMESTAMP, "
+    "user_id INTEGER NOT NULL REFERENCES user(user_id) ON DELETE CASCADE);"
+    "CREATE TABLE provenance_input (input_id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+    "prov_step_id INTEGER NOT NULL REFERENCES provenance_step(prov_step_id) ON DELETE CASCADE, "
+    "prov_id INTEGER NOT NULL);"
+    "CREATE INDEX prov_input_index ON provenance_input(prov_step_id);"
+    "CREATE TABLE provenance_output (output_id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+    "prov_step_id INTEGER NOT NULL REFERENCES provenance_step(prov_step_id) ON DELETE CASCADE, "
+    "prov_id INTEGER NOT NULL UNIQUE);"
+    "CREATE INDEX prov_output_index ON provenance_output(prov_step_id);", error ) ) << error;
+}
+
+// Chain of steps where step j turns provenance ID j into provenance ID j + 1
+static void fillProvenanceTables( DatabaseManager& database, int num_steps )
+{
+  std::string error;
+  ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO user (user_name) VALUES(?);",
+    SqlParameters().add_text( "user" ), error ) ) << error;
+  ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO action (action_name) VALUES(?);",
+    SqlParameters().add_text( "Threshold" ), error ) ) << error;
+  ASSERT_TRUE( database.run_sql_statement( "BEGIN TRANSACTION;", error ) ) << error;
+  for ( int j = 0; j < num_steps; ++j )
+  {
+    ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO provenance_step "
+      "(action_id, action_params, user_id) VALUES(?, ?, ?);", SqlParameters().add_int64( 1 ).
+      add_text( "Threshold layerid='layer_1' lower_threshold=10" ).add_int64( 1 ), error ) ) 
+      << error;
+    long long step_id = database.get_last_insert_rowid();
+    ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO provenance_input "
+      "(prov_step_id, prov_id) VALUES(?, ?);", SqlParameters().add_int64( step_id ).
+      add_int64( j ), error ) ) << error;
+    ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO provenance_output "
+      "(prov_step_id, prov_id) VALUES(?, ?);", SqlParameters().add_int64( step_id ).
+      add_int64( j + 1 ), error ) ) << error;
+  }
+  ASSERT_TRUE( database.run_sql_statement( "COMMIT;", error ) ) << error;
+}
+
+TEST(DatabaseManagerTests, PreparedStatementTypes)
+{
+  DatabaseManager database;
+  std::string error;
+  ASSERT_TRUE( database.run_sql_statement( 
+    "CREATE TABLE test (i INTEGER, d REAL, t TEXT, n TEXT);", error ) ) << error;
+
+  // NOTE: Quotes do not need escaping when bound as parameters
+  ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO test VALUES(?, ?, ?, ?);", 
+    SqlParameters().add_int64( 1LL << 40 ).add_double( 2.5 ).add_text( "it's" ).add_null(), 
+    error ) ) << error;
+  ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO test VALUES(?, ?, ?, ?);", 
+    SqlParameters().add_int64( -3 ).add_double( -0.25 ).add_text( "" ).add_text( "x" ), 
+    error ) ) << error;
+
+  SqlResult result;
+  ASSERT_TRUE( database.run_prepared_statement( "SELECT * FROM test WHERE i > ? ORDER BY i;",
+    SqlParameters().add_int64( -10 ), result, error ) ) << error;
+  ASSERT_EQ( 2u, result.get_num_rows() );
+  ASSERT_EQ( 4u, result.get_num_columns() );
+  EXPECT_EQ( 2, result.get_column_index( "t" ) );
+  EXPECT_EQ( -1, result.get_column_index( "missing" ) );
+  EXPECT_EQ( "d", result.get_column_name( 1 ) );
+
+  EXPECT_EQ( -3, result.get_int64( 0, 0 ) );
+  EXPECT_EQ( -0.25, result.get_double( 0, 1 ) );
+  EXPECT_EQ( SqlResult::TEXT_E, result.get_type( 0, 2 ) );
+  EXPECT_EQ( "", result.get_text( 0, 2 ) );
+  EXPECT_EQ( "x", result.get_text( 0, 3 ) );
+
+  EXPECT_EQ( 1LL << 40, result.get_int64( 1, 0 ) );
+  EXPECT_EQ( 2.5, result.get_double( 1, 1 ) );
+  EXPECT_EQ( "it's", result.get_text( 1, 2 ) );
+  EXPECT_TRUE( result.is_null( 1, 3 ) );
+}
+
+TEST(DatabaseManagerTests, PreparedStatementReuse)
+{
+  DatabaseManager database;
+  std::string error;
+  ASSERT_TRUE( database.run_sql_statement( "CREATE TABLE test (i INTEGER);", error ) ) << error;
+  for ( int j = 0; j < 100; ++j )
+  {
+    ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO test VALUES(?);", 
+      SqlParameters().add_int64( j ), error ) ) << error;
+  }
+
+  SqlResult result;
+  for ( int j = 0; j < 100; j += 10 )
+  {
+    ASSERT_TRUE( database.run_prepared_statement( "SELECT i FROM test WHERE i >= ?;",
+      SqlParameters().add_int64( j ), result, error ) ) << error;
+    EXPECT_EQ( static_cast< size_t >( 100 - j ), result.get_num_rows() );
+    EXPECT_EQ( j, result.get_int64( 0, 0 ) );
+  }
+}
+
+TEST(DatabaseManagerTests, PreparedStatementErrors)
+{
+  DatabaseManager database;
+  std::string error;
+  ASSERT_TRUE( database.run_sql_statement( 
+    "CREATE TABLE test (i INTEGER UNIQUE);", error ) ) << error;
+
+  EXPECT_FALSE( database.run_prepared_statement( "SELECT * FROM missing WHERE i = ?;",
+    SqlParameters().add_int64( 1 ), error ) );
+  EXPECT_FALSE( database.run_prepared_statement( "INSERT INTO test VALUES(?);",
+    SqlParameters(), error ) );
+
+  // A failing statement can be run again
+  ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO test VALUES(?);",
+    SqlParameters().add_int64( 1 ), error ) ) << error;
+  EXPECT_FALSE( database.run_prepared_statement( "INSERT INTO test VALUES(?);",
+    SqlParameters().add_int64( 1 ), error ) );
+  EXPECT_TRUE( database.run_prepared_statement( "INSERT INTO test VALUES(?);",
+    SqlParameters().add_int64( 2 ), error ) ) << error;
+}
+
+TEST(DatabaseManagerTests, OnDiskDatabase)
+{
+  boost::filesystem::path database_file = testOutputDir() / "OnDiskDatabase.sqlite";
+  boost::filesystem::remove( database_file );
+  std::string error;
+  {
+    DatabaseManager database;
+    createProvenanceTables( database );
+    fillProvenanceTables( database, 10 );
+
+    // The file is created from the in-memory content
+    ASSERT_TRUE( database.open_database( database_file, error ) ) << error;
+    ASSERT_TRUE( boost::filesystem::exists( database_file ) );
+    SqlResult result;
+    ASSERT_TRUE( database.run_prepared_statement( "PRAGMA journal_mode;", SqlParameters(),
+      result, error ) ) << error;
+    EXPECT_EQ( "wal", result.get_text( 0, 0 ) );
+
+    // New rows are visible to other connections before the database is saved
+    ASSERT_TRUE( database.run_prepared_statement( "INSERT INTO provenance_step "
+      "(action_id, action_params, user_id) VALUES(?, ?, ?);", 
+      SqlParameters().add_int64( 1 ).add_text( "Paint" ).add_int64( 1 ), error ) ) << error;
+    DatabaseManager reader;
+    ASSERT_TRUE( reader.load_database( database_file, error ) ) << error;
+    ASSERT_TRUE( reader.run_prepared_statement( "SELECT COUNT(*) FROM provenance_step;",
+      SqlParameters(), result, error ) ) << error;
+    EXPECT_EQ( 11, result.get_int64( 0, 0 ) );
+
+    // Saving to the same file only checkpoints
+    EXPECT_TRUE( database.save_database( database_file, error ) ) << error;
+    EXPECT_TRUE( database.open_database( database_file, error ) ) << error;
+  }
+
+  // Loading restores into memory and leaves the file alone
+  DatabaseManager database;
+  ASSERT_TRUE( database.open_database( database_file, error ) ) << error;
+  ASSERT_TRUE( database.load_database( database_file, error ) ) << error;
+  ASSERT_TRUE( database.run_sql_statement( "DELETE FROM provenance_step;", error ) ) << error;
+  DatabaseManager reader;
+  ASSERT_TRUE( reader.load_database( database_file, error ) ) << error;
+  SqlResult result;
+  ASSERT_TRUE( reader.run_prepared_statement( "SELECT COUNT(*) FROM provenance_step;",
+    SqlParameters(), result, error ) ) << error;
+  EXPECT_EQ( 11, result.get_int64( 0, 0 ) );
+}
+
+TEST(DatabaseManagerTests, OnDiskWorkingCopy)
+{
+  boost::filesystem::path saved_file = testOutputDir() / "OnDiskWorkingCopy.sqlite";
+  boost::filesystem::path working_file = testOutputDir() / "OnDiskWorkingCopy.sqlite.working";
+  boost::filesystem::remove( saved_file );
+  boost::filesystem::remove( working_file );
+  std::string error;
+
+  DatabaseManager database;
+  createProvenanceTables( database );
+  fillProvenanceTables( database, 10 );
+  EXPECT_TRUE( database.get_database_file().empty() );
+  ASSERT_TRUE( database.open_database( working_file, error ) ) << error;
+  EXPECT_EQ( working_file, database.get_database_file() );
+
+  // Saving into another file copies the database and keeps working in the working copy
+  ASSERT_TRUE( database.save_database( saved_file, error ) ) << error;
+  EXPECT_EQ( working_file, database.get_database_file() );
+  ASSERT_TRUE( database.run_sql_statement( "DELETE FROM provenance_step;", error ) ) << error;
+
+  DatabaseManager reader;
+  ASSERT_TRUE( reader.load_database( saved_file, error ) ) << error;
+  SqlResult result;
+  ASSERT_TRUE( reader.run_prepared_statement( "SELECT COUNT(*) FROM provenance_step;",
+    SqlParameters(), result, error ) ) << error;
+  EXPECT_EQ( 10, result.get_int64( 0, 0 ) );
+}
+
+// Timing of the queries that walk the provenance trail, with statements built from strings
+// and with prepared statements. The times are recorded as test properties. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=*Benchmark* --gtest_output=xml
+TEST(DatabaseManagerTests, DISABLED_ProvenanceQueryBenchmark)
+{
+  const int num_steps = 5000;
+  DatabaseManager database;
+  createProvenanceTables( database );
+  fillProvenanceTables( database, num_steps );
+  std::string error;
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for ( int j = num_steps; j > 0; --j )
+  {
+    ResultSet result_set;
+    ASSERT_TRUE( database.run_sql_statement( "SELECT prov_step_id FROM provenance_output "
+      "WHERE prov_id = " + Core::ExportToString( j ) + ";", result_set, error ) ) << error;
+    long long step_id = boost::any_cast< long long >( result_set[ 0 ][ "prov_step_id" ] );
+    ASSERT_TRUE( database.run_sql_statement( "SELECT * FROM provenance_step "
+      "WHERE prov_step_id = " + Core::ExportToString( step_id ) + ";", result_set, error ) );
+    ASSERT_TRUE( database.run_sql_statement( "SELECT prov_id FROM provenance_input "
+      "WHERE prov_step_id = " + Core::ExportToString( step_id ) + ";", result_set, error ) );
+  }
+  boost::posix_time::ptime middle = boost::posix_time::microsec_clock::universal_time();
+
+  SqlParameters parameters;
+  SqlResult result;
+  for ( int j = num_steps; j > 0; --j )
+  {
+    parameters.clear();
+    parameters.add_int64( j );
+    ASSERT_TRUE( database.run_prepared_statement( "SELECT prov_step_id FROM provenance_output "
+      "WHERE prov_id = ?;", parameters, result, error ) ) << error;
+    parameters.clear();
+    parameters.add_int64( result.get_int64( 0, 0 ) );
+    ASSERT_TRUE( database.run_prepared_statement( "SELECT action_id, action_params, user_id, "
+      "timestamp FROM provenance_step WHERE prov_step_id = ?;", parameters, result, error ) );
+    ASSERT_TRUE( database.run_prepared_statement( "SELECT prov_id FROM provenance_input "
+      "WHERE prov_step_id = ?;", parameters, result, error ) );
+  }
+  boost::posix_time::ptime end = boost::posix_time::microsec_clock::universal_time();
+
+  RecordProperty( "string_statements_ms", static_cast< int >( 
+    ( middle - start ).total_milliseconds() ) );
+  RecordProperty( "prepared_statements_ms", static_cast< int >( 
+    ( end - middle ).total_milliseconds() ) );
+}
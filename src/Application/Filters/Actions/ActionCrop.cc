@@ -26,6 +26,7 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+#include <Core/DataBlock/DataBlockView.h>
 #include <Core/DataBlock/StdDataBlock.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
 
@@ -89,10 +90,6 @@ public:
 
 public:
 
-  template< class T >
-  void crop_typed_data( Core::DataBlockHandle src, Core::DataBlockHandle dst, 
-    LayerHandle dst_layer );
-
   void crop_data_layer( DataLayerHandle input, DataLayerHandle output );
   void crop_mask_layer( MaskLayerHandle input, MaskLayerHandle output );
 
@@ -117,35 +114,6 @@ public:
   }
 };
 
-template< class T >
-void CropAlgo::crop_typed_data( Core::DataBlockHandle src, Core::DataBlockHandle dst,
-                 LayerHandle dst_layer )
-{
-  T* src_data = reinterpret_cast< T* >( src->get_data() );
-  T* dst_data = reinterpret_cast< T* >( dst->get_data() );
-  size_t current_index = src->to_index( 0, 0, 0 );
-  size_t stride_x = src->to_index( 1, 0, 0 ) - current_index;
-  size_t stride_y = src->to_index( 0, 1, 0 ) - current_index;
-  size_t stride_z = src->to_index( 0, 0, 1 ) - current_index;
-  size_t current_z = src->to_index( this->start_x_, this->start_y_, this->start_z_ );
-  size_t current_y;
-  size_t dst_index = 0;
-  size_t total_z_slice = this->end_z_ - this->start_z_ + 1;
-  for ( size_t z = this->start_z_; z <= this->end_z_; ++z, current_z += stride_z )
-  {
-    current_y = current_z;
-    for ( size_t y = this->start_y_; y <= this->end_y_; ++y, current_y += stride_y )
-    {
-      current_index = current_y;
-      for ( size_t x = this->start_x_; x <= this->end_x_; ++x, current_index += stride_x )
-      {
-        dst_data[ dst_index++ ] = src_data[ current_index ];
-      }
-    }
-    dst_layer->update_progress_signal_( ( z - this->start_z_ + 1.0 ) / total_z_slice * 0.8 );
-  }
-}
-
 void CropAlgo::run_filter()
 {
   for ( size_t i = 0; i < this->src_layers_.size(); ++i )
@@ -184,56 +152,36 @@ void CropAlgo::run_filter()
 void CropAlgo::crop_data_layer( DataLayerHandle input, DataLayerHandle output )
 {
   Core::DataBlockHandle input_datablock = input->get_data_volume()->get_data_block();
-  Core::DataBlockHandle output_datablock = Core::StdDataBlock::New( 
-    output->get_grid_transform(), input_datablock->get_data_type() );
-  if ( !output_datablock ) 
+
+  // NOTE: The cropped data is described as a view of the input data, which copies straight
+  // from the original data when the input is itself a view that has not been copied yet.
+  // Results that are shown need their voxels for the slices right away and are copied here,
+  // so the copy does not happen on the rendering thread. Results that go into a sandbox are
+  // copied when their histogram is computed, as the layer needs the value range of the 
+  // cropped region.
+  std::vector< size_t > offset( 3 );
+  offset[ 0 ] = this->start_x_;
+  offset[ 1 ] = this->start_y_;
+  offset[ 2 ] = this->start_z_;
+  std::vector< size_t > size( 3 );
+  size[ 0 ] = output->get_grid_transform().get_nx();
+  size[ 1 ] = output->get_grid_transform().get_ny();
+  size[ 2 ] = output->get_grid_transform().get_nz();
+
+  Core::DataBlockViewHandle output_datablock = Core::DataBlockView::NewCrop( 
+    input_datablock, input->get_grid_transform(), offset, size );
+  if ( !output_datablock || 
+    ( this->get_sandbox() == -1 && !output_datablock->materialize() ) ) 
   {
     this->report_error( "Could not allocate enough memory" );
     return;
   }
-  
-  Core::DataBlock::shared_lock_type data_lock( input_datablock->get_mutex() );
-  switch ( input_datablock->get_data_type() )
-  {
-  case Core::DataType::CHAR_E:
-    this->crop_typed_data< signed char >( input_datablock, output_datablock, output );
-    break;
-  case Core::DataType::UCHAR_E:
-    this->crop_typed_data< unsigned char >( input_datablock, output_datablock, output );
-    break;
-  case Core::DataType::SHORT_E:
-    this->crop_typed_data< short >( input_datablock, output_datablock, output );
-    break;
-  case Core::DataType::USHORT_E:
-    this->crop_typed_data< unsigned short >( input_datablock, output_datablock, output );
-    break;
-  case Core::DataType::INT_E:
-    this->crop_typed_data< int >( input_datablock, output_datablock, output );
-    break;
-  case Core::DataType::UINT_E:
-    this->crop_typed_data< unsigned int >( input_datablock, output_datablock, output );
-    break;
-  case Core::DataType::FLOAT_E:
-    this->crop_typed_data< float >( input_datablock, output_datablock, output );
-    break;
-  case Core::DataType::DOUBLE_E:
-    this->crop_typed_data< double >( input_datablock, output_datablock, output );
-    break;
-  default:
-    assert( false );
-  }
-
-  data_lock.unlock();
+  output->update_progress_signal_( 0.8 );
 
   if ( !this->check_abort() )
   {
-    // Centering should be preserved for each layer
-    Core::GridTransform output_grid_transform = output->get_grid_transform();
-    output_grid_transform.set_originally_node_centered( 
-      input->get_grid_transform().get_originally_node_centered() );
-
     this->dispatch_insert_data_volume_into_layer( output, Core::DataVolumeHandle(
-      new Core::DataVolume( output_grid_transform, output_datablock ) ), 
+      new Core::DataVolume( output_datablock->get_grid_transform(), output_datablock ) ), 
       true );
     output->update_progress_signal_( 1.0 );
     this->dispatch_unlock_layer( output );
@@ -405,21 +353,20 @@ bool ActionCrop::validate( Core::ActionContextHandle& context )
   }
 
   // Compute the cropped grid transform 
-  Core::Point clamped_origin( this->private_->start_x_, 
-    this->private_->start_y_, this->private_->start_z_ );
-  clamped_origin = trans * clamped_origin;
-  trans( 0, 3 ) = clamped_origin[ 0 ];
-  trans( 1, 3 ) = clamped_origin[ 1 ];
-  trans( 2, 3 ) = clamped_origin[ 2 ];
-  this->private_->output_grid_trans_.load_matrix( trans );
-  this->private_->output_grid_trans_.set_nx( static_cast< size_t >( 
-    this->private_->end_x_ - this->private_->start_x_ + 1 ) );
-  this->private_->output_grid_trans_.set_ny( static_cast< size_t >( 
-    this->private_->end_y_ - this->private_->start_y_ + 1 ) );
-  this->private_->output_grid_trans_.set_nz( static_cast< size_t >( 
-    this->private_->end_z_ - this->private_->start_z_ + 1 ) );
-  this->private_->output_grid_trans_.set_originally_node_centered(
-    grid_trans.get_originally_node_centered() );
+  std::vector< size_t > crop_offset( 3 );
+  crop_offset[ 0 ] = static_cast< size_t >( this->private_->start_x_ );
+  crop_offset[ 1 ] = static_cast< size_t >( this->private_->start_y_ );
+  crop_offset[ 2 ] = static_cast< size_t >( this->private_->start_z_ );
+  std::vector< size_t > crop_size( 3 );
+  crop_size[ 0 ] = static_cast< size_t >( this->private_->end_x_ - this->private_->start_x_ + 1 );
+  crop_size[ 1 ] = static_cast< size_t >( this->private_->end_y_ - this->private_->start_y_ + 1 );
+  crop_size[ 2 ] = static_cast< size_t >( this->private_->end_z_ - this->private_->start_z_ + 1 );
+  std::vector< int > crop_permutation( 3 );
+  crop_permutation[ 0 ] = 1;
+  crop_permutation[ 1 ] = 2;
+  crop_permutation[ 2 ] = 3;
+  this->private_->output_grid_trans_ = Core::DataBlockView::ComputeGridTransform( 
+    grid_trans, crop_permutation, crop_offset, crop_size );
 
   // Validation successful
   return true;
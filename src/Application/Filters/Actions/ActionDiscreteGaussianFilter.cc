@@ -26,13 +26,20 @@
  DEALINGS IN THE SOFTWARE.
  */
 
-// ITK includes
-#include <itkDiscreteGaussianImageFilter.h>
+// STL includes
+#include <cmath>
+
+// Boost includes
+#include <boost/bind.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlockFilter.h>
 
 // Application includes
+#include <Application/Layer/DataLayer.h>
 #include <Application/Layer/LayerManager.h>
 #include <Application/StatusBar/StatusBar.h>
-#include <Application/Filters/ITKFilter.h>
+#include <Application/Filters/LayerFilter.h>
 #include <Application/Filters/Actions/ActionDiscreteGaussianFilter.h>
 
 // REGISTER ACTION:
@@ -73,7 +80,7 @@ bool ActionDiscreteGaussianFilter::validate( Core::ActionContextHandle& context
 // NOTE: The separation of the algorithm into a private class is for the purpose of running the
 // filter on a separate thread.
 
-class DiscreteGaussianFilterAlgo : public ITKFilter
+class DiscreteGaussianFilterAlgo : public LayerFilter
 {
 
 public:
@@ -84,74 +91,57 @@ public:
   double blurring_distance_;
 
 public:
-  // RUN:
-  // Implemtation of run of the Runnable base class, this function is called when the thread
-  // is launched.
+  // REPORT_PROGRESS:
+  // Forward the progress of the filter to the layer that shows it.
+  void report_progress( double progress )
+  {
+    this->dst_layer_->update_progress_signal_( progress );
+  }
 
-  // NOTE: The macro needs a data type to select which version to run. This needs to be
-  // a member variable of the algorithm class.
-  SCI_BEGIN_TYPED_ITK_RUN( this->src_layer_->get_data_type() )
+  // RUN_FILTER:
+  // Implementation of run of the Runnable base class, this function is called when the thread
+  // is launched.
+  // NOTE: The blurring distance is the variance of the Gaussian in voxels, as it was for the
+  // ITK filter that this filter replaces.
+  virtual void run_filter()
   {
-    // Define the type of filter that we use.
-    typedef itk::DiscreteGaussianImageFilter< 
-      TYPED_IMAGE_TYPE, FLOAT_IMAGE_TYPE > filter_type;
-
-    // Retrieve the image as an itk image from the underlying data structure
-    // NOTE: This only does wrapping and does not regenerate the data.
-    typename Core::ITKImageDataT<VALUE_TYPE>::Handle input_image; 
-    this->get_itk_image_from_layer<VALUE_TYPE>( this->src_layer_, input_image );
-        
-    // Create a new ITK filter instantiation. 
-    typename filter_type::Pointer filter = filter_type::New();
-
-    // Relay abort and progress information to the layer that is executing the filter.
-    this->forward_abort_to_filter( filter, this->dst_layer_ );
-    this->observe_itk_progress( filter, this->dst_layer_, 0.0, 0.75 );
-      
-    // Setup the filter parameters that we do not want to change.
-    filter->SetInput( input_image->get_image() );
-    filter->SetUseImageSpacingOff();
-    filter->SetVariance( this->blurring_distance_ );
-
-    // Ensure we will have some threads left for doing something else
-    this->limit_number_of_itk_threads( filter );
-    
-    // Run the actual ITK filter.
-    // This needs to be in a try/catch statement as certain filters throw exceptions when they
-    // are aborted. In that case we will relay a message to the status bar for information.
-    try 
-    { 
-      filter->Update(); 
-    } 
-    catch ( ... ) 
+    DataLayerHandle src_layer = boost::dynamic_pointer_cast< DataLayer >( this->src_layer_ );
+    Core::DataBlockHandle src_data_block = src_layer->get_data_volume()->get_data_block();
+
+    Core::DataBlockHandle dst_data_block;
+    if ( !Core::DataBlockFilter::GaussianFilter( src_data_block, dst_data_block, 
+      std::sqrt( this->blurring_distance_ ), boost::bind( &LayerFilter::check_abort, this ), 
+      boost::bind( &DiscreteGaussianFilterAlgo::report_progress, this, _1 ) ) )
     {
       if ( this->check_abort() )
       {
         this->report_error( "Filter was aborted." );
         return;
       }
-      this->report_error( "ITK filter failed to complete." );
-      return;   
+
+      this->report_error( "Could not allocate enough memory." );
+      return;
     }
 
-    // As ITK filters generate an inconsistent abort behavior, we record our own abort flag
-    // This one is set when the abort button is pressed and an abort is sent to ITK.
-    if ( this->check_abort() ) return;
-    
     // If we want to preserve the data type we convert the data before inserting it back.
-    // NOTE: Conversion is done on the filter thread and insertion is done on the application
-    // thread.
-    if ( this->preserve_data_format_ )
-    {
-      this->convert_and_insert_itk_image_into_layer( this->dst_layer_, 
-        filter->GetOutput(), this->src_layer_->get_data_type() );       
-    }
-    else
+    if ( this->preserve_data_format_ && 
+      src_data_block->get_data_type() != dst_data_block->get_data_type() )
     {
-      this->insert_itk_image_into_layer( this->dst_layer_, filter->GetOutput() ); 
+      Core::DataBlockHandle converted_data_block;
+      if ( !Core::DataBlock::ConvertDataType( dst_data_block, converted_data_block, 
+        src_data_block->get_data_type() ) )
+      {
+        this->report_error( "Could not allocate enough memory." );
+        return;
+      }
+      dst_data_block = converted_data_block;
     }
+
+    if ( this->check_abort() ) return;
+
+    this->dispatch_insert_data_volume_into_layer( this->dst_layer_, Core::DataVolumeHandle( 
+      new Core::DataVolume( this->dst_layer_->get_grid_transform(), dst_data_block ) ), true );
   }
-  SCI_END_TYPED_ITK_RUN()
   
   // GET_FITLER_NAME:
   // The name of the filter, this information is used for generating new layer labels.
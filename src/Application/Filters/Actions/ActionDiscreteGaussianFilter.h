@@ -42,10 +42,10 @@ class ActionDiscreteGaussianFilter : public LayerAction
 {
 
 CORE_ACTION( 
-  CORE_ACTION_TYPE( "DiscreteGaussianFilter", "ITK filter that blurs the data." )
+  CORE_ACTION_TYPE( "DiscreteGaussianFilter", "Filter that blurs the data." )
   CORE_ACTION_ARGUMENT( "layerid", "The layerid on which this filter needs to be run." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "replace", "true", "Replace the old layer (true), or add an new layer (false)" )
-  CORE_ACTION_OPTIONAL_ARGUMENT( "preserve_data_format", "true", "ITK filters run in floating point percision,"
+  CORE_ACTION_OPTIONAL_ARGUMENT( "preserve_data_format", "true", "The filter runs in floating point percision,"
     " this option will convert the result back into the original format." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "blurring_distance", "2.0", "The amount of blurring." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "sandbox", "-1", "The sandbox in which to run the action." )
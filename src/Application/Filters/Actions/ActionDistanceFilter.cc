@@ -26,13 +26,17 @@
  DEALINGS IN THE SOFTWARE.
  */
 
-// ITK includes
-#include <itkSignedMaurerDistanceMapImageFilter.h>
+// Boost includes
+#include <boost/bind.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlockFilter.h>
 
 // Application includes
+#include <Application/Layer/MaskLayer.h>
 #include <Application/Layer/LayerManager.h>
 #include <Application/StatusBar/StatusBar.h>
-#include <Application/Filters/ITKFilter.h>
+#include <Application/Filters/LayerFilter.h>
 #include <Application/Filters/Actions/ActionDistanceFilter.h>
 
 // REGISTER ACTION:
@@ -66,7 +70,7 @@ bool ActionDistanceFilter::validate( Core::ActionContextHandle& context )
 // NOTE: The separation of the algorithm into a private class is for the purpose of running the
 // filter on a separate thread.
 
-class DistanceFilterAlgo : public ITKFilter
+class DistanceFilterAlgo : public LayerFilter
 {
 
 public:
@@ -78,65 +82,52 @@ public:
   bool inside_positive_;
   
 public:
-  // RUN:
+  // REPORT_PROGRESS:
+  // Forward the progress of the filter to the layer that shows it.
+  void report_progress( double progress )
+  {
+    this->dst_layer_->update_progress_signal_( progress );
+  }
+
+  // RUN_FILTER:
   // Implementation of run of the Runnable base class, this function is called when the thread
   // is launched.
-  
-  // NOTE: The macro needs a data type to select which version to run. This needs to be
-  // a member variable of the algorithm class.
-  SCI_BEGIN_ITK_RUN( )
+  // NOTE: The distance is computed with an exact separable Euclidean distance transform that
+  // reads the bit plane of the mask directly, hence no intermediate image is generated.
+  virtual void run_filter()
   {
-    // Define the type of filter that we use.
-    typedef itk::SignedMaurerDistanceMapImageFilter< 
-      UCHAR_IMAGE_TYPE, FLOAT_IMAGE_TYPE > filter_type;
-
-    // Retrieve the image as an itk image from the underlying data structure
-    // NOTE: This only does wrapping and does not regenerate the data.
-    Core::ITKImageDataT<unsigned char>::Handle input_image; 
-    this->get_itk_image_from_layer<unsigned char>( this->src_layer_, input_image );
-        
-    // Create a new ITK filter instantiation.   
-    filter_type::Pointer filter = filter_type::New();
-
-    // Relay abort and progress information to the layer that is executing the filter.
-    this->forward_abort_to_filter( filter, this->dst_layer_ );    
-    this->observe_itk_progress( filter, this->dst_layer_ );
-
-    // Setup the filter parameters that we do not want to change.
-    filter->SetInput( input_image->get_image() );
-
-    filter->SetSquaredDistance( false );
-    filter->SetInsideIsPositive( this->inside_positive_ );
-    filter->SetUseImageSpacing( ! this->use_index_space_ );
-
-    // Ensure we will have some threads left for doing something else
-    this->limit_number_of_itk_threads( filter );
-        
-    // Run the actual ITK filter.
-    // This needs to be in a try/catch statement as certain filters throw exceptions when they
-    // are aborted. In that case we will relay a message to the status bar for information.
-    try 
-    { 
-      filter->Update(); 
-    } 
-    catch ( ... ) 
+    MaskLayerHandle src_layer = boost::dynamic_pointer_cast< MaskLayer >( this->src_layer_ );
+    Core::MaskDataBlockHandle mask_data_block = 
+      src_layer->get_mask_volume()->get_mask_data_block();
+
+    Core::Vector spacing( 1.0, 1.0, 1.0 );
+    if ( !this->use_index_space_ )
+    {
+      Core::GridTransform grid_transform = src_layer->get_grid_transform();
+      spacing = Core::Vector( grid_transform.spacing_x(), grid_transform.spacing_y(), 
+        grid_transform.spacing_z() );
+    }
+
+    Core::DataBlockHandle dst_data_block;
+    if ( !Core::DataBlockFilter::DistanceFilter( mask_data_block, dst_data_block, spacing, 
+      true, this->inside_positive_, boost::bind( &LayerFilter::check_abort, this ), 
+      boost::bind( &DistanceFilterAlgo::report_progress, this, _1 ) ) )
     {
       if ( this->check_abort() )
       {
         this->report_error( "Filter was aborted." );
         return;
       }
-      this->report_error( "ITK filter failed to complete." );
+
+      this->report_error( "Could not allocate enough memory." );
       return;
     }
 
-    // As ITK filters generate an inconsistent abort behavior, we record our own abort flag
-    // This one is set when the abort button is pressed and an abort is sent to ITK.
     if ( this->check_abort() ) return;
-    
-    this->insert_itk_image_into_layer( this->dst_layer_, filter->GetOutput() ); 
+
+    this->dispatch_insert_data_volume_into_layer( this->dst_layer_, Core::DataVolumeHandle( 
+      new Core::DataVolume( this->dst_layer_->get_grid_transform(), dst_data_block ) ), true );
   }
-  SCI_END_ITK_RUN()
   
   // GET_FITLER_NAME:
   // The name of the filter, this information is used for generating new layer labels.
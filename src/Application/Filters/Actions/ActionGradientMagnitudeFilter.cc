@@ -97,9 +97,8 @@ public:
     // Create a new ITK filter instantiation.   
     typename filter_type::Pointer filter = filter_type::New();
 
-    // Relay abort and progress information to the layer that is executing the filter.
+    // Relay abort information to the layer that is executing the filter.
     this->forward_abort_to_filter( filter, this->dst_layer_ );
-    this->observe_itk_progress( filter, this->dst_layer_ );
     
     // Setup the filter parameters that we do not want to change.
     filter->SetInput( input_image->get_image() );
@@ -108,6 +107,19 @@ public:
     // Ensure we will have some threads left for doing something else
     this->limit_number_of_itk_threads( filter );
 
+    // Volumes that are too large to be filtered as a whole are computed in slabs, which are
+    // written directly into the destination layer.
+    if ( this->use_itk_streaming( this->src_layer_, sizeof( float ) ) )
+    {
+      this->stream_itk_filter_into_layer( filter, this->dst_layer_, 
+        this->preserve_data_format_ ? this->src_layer_->get_data_type() : 
+        Core::DataType::FLOAT_E );
+      return;
+    }
+
+    // Relay progress information to the layer that is executing the filter.
+    this->observe_itk_progress( filter, this->dst_layer_ );
+
     // Run the actual ITK filter.
     // This needs to be in a try/catch statement as certain filters throw exceptions when they
     // are aborted. In that case we will relay a message to the status bar for information.
@@ -0,0 +1,419 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+ 
+ The MIT License
+ 
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+ 
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// ITK includes
+#include <itkGradientMagnitudeImageFilter.h>
+#include <itkMedianImageFilter.h>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlockFilter.h>
+#include <Core/DataBlock/ITKStreaming.h>
+#include <Core/LargeVolume/LargeVolumeFilter.h>
+#include <Core/Utils/StringUtil.h>
+
+// Application includes
+#include <Application/Layer/LargeVolumeLayer.h>
+#include <Application/Layer/LayerManager.h>
+#include <Application/Filters/LayerFilter.h>
+#include <Application/Filters/Actions/ActionLargeVolumeFilter.h>
+
+// REGISTER ACTION:
+// Define a function that registers the action. The action also needs to be
+// registered in the CMake file.
+// NOTE: Registration needs to be done outside of any namespace
+CORE_REGISTER_ACTION( Seg3D, LargeVolumeFilter )
+
+namespace Seg3D
+{
+
+static bool IsLargeVolumeBooleanFilter( const std::string& filter )
+{
+  return filter == "and" || filter == "or" || filter == "xor" || filter == "remove";
+}
+
+// NOTE: The bricks are already filtered in parallel, hence the itk filters below use a single 
+// thread each.
+
+// GRADIENTMAGNITUDEREGIONFILTER:
+// Gradient magnitude of a brick, computed with itk as it is for data layers.
+static bool GradientMagnitudeRegionFilter( const std::vector< Core::DataBlockHandle >& inputs, 
+  Core::DataBlockHandle& output )
+{
+  typedef itk::Image< float, 3 > image_type;
+  typedef itk::GradientMagnitudeImageFilter< image_type, image_type > filter_type;
+
+  filter_type::Pointer filter = filter_type::New();
+  filter->SetUseImageSpacingOff();
+  filter->SetNumberOfThreads( 1 );
+  return Core::ITKStreaming::RunFilter( filter.GetPointer(), inputs[ 0 ], 
+    Core::DataType::FLOAT_E, output );
+}
+
+// ITKMEDIANREGIONFILTER:
+// Median of a brick computed with itk, for the data types the native median filter does not
+// support. As the median is one of the values in the box, computing it in double precision 
+// and converting it back is exact.
+static bool ITKMedianRegionFilter( const std::vector< Core::DataBlockHandle >& inputs, 
+  Core::DataBlockHandle& output, int radius )
+{
+  typedef itk::Image< double, 3 > image_type;
+  typedef itk::MedianImageFilter< image_type, image_type > filter_type;
+
+  filter_type::Pointer filter = filter_type::New();
+  filter_type::InputSizeType size;
+  size.Fill( radius );
+  filter->SetRadius( size );
+  filter->SetNumberOfThreads( 1 );
+  return Core::ITKStreaming::RunFilter( filter.GetPointer(), inputs[ 0 ], 
+    inputs[ 0 ]->get_data_type(), output );
+}
+
+bool ActionLargeVolumeFilter::validate( Core::ActionContextHandle& context )
+{
+  // Make sure that the sandbox exists
+  if ( !LayerManager::CheckSandboxExistence( this->sandbox_, context ) ) return false;
+
+  // Check for layer existence and type information
+  if ( ! LayerManager::CheckLayerExistenceAndType( this->target_layer_, 
+    Core::VolumeType::LARGE_DATA_E, context, this->sandbox_ ) ) return false;
+  
+  // Check for layer availability 
+  if ( ! LayerManager::CheckLayerAvailabilityForUse( this->target_layer_, 
+    context, this->sandbox_ ) ) return false;
+
+  if ( this->filter_ != "threshold" && this->filter_ != "mean" && 
+    this->filter_ != "median" && this->filter_ != "gaussian" && 
+    this->filter_ != "gradient_magnitude" && !IsLargeVolumeBooleanFilter( this->filter_ ) )
+  {
+    context->report_error( "Unknown filter '" + this->filter_ + "'." );
+    return false;
+  }
+
+  if ( IsLargeVolumeBooleanFilter( this->filter_ ) )
+  {
+    if ( ! LayerManager::CheckLayerExistenceAndType( this->mask_layer_, 
+      Core::VolumeType::LARGE_DATA_E, context, this->sandbox_ ) ) return false;
+
+    if ( ! LayerManager::CheckLayerAvailabilityForUse( this->mask_layer_, 
+      context, this->sandbox_ ) ) return false;
+
+    if ( ! LayerManager::CheckLayerSize( this->target_layer_, this->mask_layer_,
+      context, this->sandbox_ ) ) return false;
+  }
+
+  if ( ( this->filter_ == "mean" || this->filter_ == "median" ) && this->radius_ < 1 )
+  {
+    context->report_error( "The radius needs to be larger than or equal to one." );
+    return false;
+  }
+
+  if ( this->filter_ == "gaussian" && this->sigma_ <= 0.0 )
+  {
+    context->report_error( "The standard deviation needs to be larger than zero." );
+    return false;
+  }
+
+  // Validation successful
+  return true;
+}
+
+// ALGORITHM CLASS
+// This class does the actual work and is run on a separate thread.
+// NOTE: The separation of the algorithm into a private class is for the purpose of running the
+// filter on a separate thread.
+
+class LargeVolumeFilterAlgo : public LayerFilter
+{
+
+public:
+  LayerHandle src_layer_;
+  LayerHandle mask_layer_;
+  LayerHandle dst_layer_;
+  Core::LargeVolumeSchemaHandle dst_schema_;
+
+  std::string filter_;
+  double lower_threshold_;
+  double upper_threshold_;
+  int radius_;
+  double sigma_;
+  std::string dir_;
+
+  // Whether the directory of the destination volume was created by this filter and still 
+  // needs to be removed, as the volume has not been inserted into its layer
+  bool remove_dir_;
+
+public:
+  LargeVolumeFilterAlgo() :
+    remove_dir_( false )
+  {
+  }
+
+  virtual ~LargeVolumeFilterAlgo()
+  {
+    // NOTE: The filter is only released once it stopped running, so the directory of a
+    // volume that was aborted or failed is no longer written to
+    if ( this->remove_dir_ )
+    {
+      boost::system::error_code ec;
+      boost::filesystem::remove_all( this->dst_schema_->get_dir(), ec );
+    }
+  }
+
+  // REPORT_PROGRESS:
+  // Forward the progress of the filter to the layer that shows it.
+  void report_progress( double progress )
+  {
+    this->dst_layer_->update_progress_signal_( progress );
+  }
+
+  // GET_OUTPUT_DIR:
+  // Find a directory next to the one of the source volume that is not in use yet.
+  boost::filesystem::path get_output_dir( const Core::LargeVolumeSchemaHandle& schema )
+  {
+    if ( !this->dir_.empty() ) return boost::filesystem::path( this->dir_ );
+    
+    boost::filesystem::path src_dir = schema->get_dir();
+    std::string base_name = src_dir.filename().string() + "_" + this->get_layer_prefix();
+    boost::filesystem::path dir = src_dir.parent_path() / base_name;
+    for ( int j = 1; boost::filesystem::exists( dir ); j++ )
+    {
+      dir = src_dir.parent_path() / ( base_name + "_" + Core::ExportToString( j ) );
+    }
+    return dir;
+  }
+
+  // GET_OUTPUT_DATA_TYPE:
+  // The data type of the volume the filter writes.
+  Core::DataType get_output_data_type( Core::DataType src_data_type ) const
+  {
+    if ( this->filter_ == "mean" || this->filter_ == "gaussian" || 
+      this->filter_ == "gradient_magnitude" )
+    {
+      return Core::DataType::FLOAT_E;
+    }
+    if ( this->filter_ == "median" ) return src_data_type;
+    return Core::DataType::UCHAR_E;
+  }
+
+  // RUN_FILTER:
+  // Implementation of run of the Runnable base class, this function is called when the thread
+  // is launched.
+  // NOTE: Only one brick of the volume and the halo around it are in memory at a time for 
+  // each thread, the result is written straight into the bricks of the new volume.
+  virtual void run_filter()
+  {
+    std::vector< Core::LargeVolumeSchemaHandle > src_schemas;
+    src_schemas.push_back( boost::dynamic_pointer_cast< LargeVolumeLayer >( 
+      this->src_layer_ )->get_schema() );
+    if ( this->mask_layer_ )
+    {
+      src_schemas.push_back( boost::dynamic_pointer_cast< LargeVolumeLayer >( 
+        this->mask_layer_ )->get_schema() );
+    }
+
+    Core::LargeVolumeFilter::region_filter_type filter;
+    size_t halo = 0;
+    size_t filter_memory = 0;
+
+    if ( this->filter_ == "threshold" )
+    {
+      filter = Core::LargeVolumeFilter::ThresholdFilter( this->lower_threshold_, 
+        this->upper_threshold_ );
+    }
+    else if ( this->filter_ == "mean" )
+    {
+      filter = Core::LargeVolumeFilter::MeanFilter( this->radius_ );
+      halo = static_cast< size_t >( this->radius_ );
+    }
+    else if ( this->filter_ == "median" )
+    {
+      // 8 and 16 bit data is filtered natively, other data with itk
+      if ( Core::DataBlockFilter::IsMedianFilterSupported( src_schemas[ 0 ]->get_data_type() ) )
+      {
+        filter = Core::LargeVolumeFilter::MedianFilter( this->radius_ );
+        filter_memory = Core::LargeVolumeFilter::GetMedianFilterMemory( 
+          src_schemas[ 0 ]->get_brick_size(), this->radius_ );
+      }
+      else
+      {
+        filter = boost::bind( &ITKMedianRegionFilter, _1, _2, this->radius_ );
+      }
+      halo = static_cast< size_t >( this->radius_ );
+    }
+    else if ( this->filter_ == "gaussian" )
+    {
+      filter = Core::LargeVolumeFilter::GaussianFilter( this->sigma_ );
+      halo = Core::LargeVolumeFilter::GetGaussianHalo( this->sigma_ );
+    }
+    else if ( this->filter_ == "gradient_magnitude" )
+    {
+      filter = boost::bind( &GradientMagnitudeRegionFilter, _1, _2 );
+      halo = 1;
+    }
+    else
+    {
+      Core::LargeVolumeFilter::boolean_type boolean = Core::LargeVolumeFilter::AND_E;
+      if ( this->filter_ == "or" ) boolean = Core::LargeVolumeFilter::OR_E;
+      else if ( this->filter_ == "xor" ) boolean = Core::LargeVolumeFilter::XOR_E;
+      else if ( this->filter_ == "remove" ) boolean = Core::LargeVolumeFilter::REMOVE_E;
+      filter = Core::LargeVolumeFilter::BooleanFilter( boolean );
+    }
+
+    std::string error;
+    if ( !Core::LargeVolumeFilter::Run( src_schemas, this->dst_schema_, halo, filter_memory,
+      filter, error, boost::bind( &LayerFilter::check_abort, this ), 
+      boost::bind( &LargeVolumeFilterAlgo::report_progress, this, _1 ) ) )
+    {
+      this->report_error( error );
+      return;
+    }
+
+    if ( this->check_abort() ) return;
+
+    this->remove_dir_ = false;
+    this->dispatch_insert_large_volume_into_layer( this->dst_layer_ );
+  }
+  
+  // GET_FITLER_NAME:
+  // The name of the filter, this information is used for generating new layer labels.
+  virtual std::string get_filter_name() const
+  {
+    return "Large Volume Filter";
+  }
+
+  // GET_LAYER_PREFIX:
+  // This function returns the name of the filter. The latter is prepended to the new layer name, 
+  // when a new layer is generated. 
+  virtual std::string get_layer_prefix() const
+  {
+    if ( this->filter_ == "threshold" ) return "Threshold";
+    if ( this->filter_ == "mean" ) return "Mean";
+    if ( this->filter_ == "median" ) return "Median";
+    if ( this->filter_ == "gaussian" ) return "Gaussian";
+    if ( this->filter_ == "gradient_magnitude" ) return "GradientMagnitude";
+    if ( this->filter_ == "and" ) return "AND";
+    if ( this->filter_ == "or" ) return "OR";
+    if ( this->filter_ == "xor" ) return "XOR";
+    return "REMOVE";
+  }
+};
+
+
+bool ActionLargeVolumeFilter::run( Core::ActionContextHandle& context, 
+  Core::ActionResultHandle& result )
+{
+  // Create algorithm
+  boost::shared_ptr<LargeVolumeFilterAlgo> algo( new LargeVolumeFilterAlgo );
+
+  // Copy the parameters over to the algorithm that runs the filter
+  algo->set_sandbox( this->sandbox_ );
+  algo->filter_ = this->filter_;
+  algo->lower_threshold_ = this->lower_threshold_;
+  algo->upper_threshold_ = this->upper_threshold_;
+  algo->radius_ = this->radius_;
+  algo->sigma_ = this->sigma_;
+  algo->dir_ = this->dir_;
+
+  // Find the handle to the layers
+  algo->find_layer( this->target_layer_, algo->src_layer_ );
+  if ( IsLargeVolumeBooleanFilter( this->filter_ ) )
+  {
+    algo->find_layer( this->mask_layer_, algo->mask_layer_ );
+  }
+
+  // Lock the layers, so they cannot be used else where
+  algo->lock_for_use( algo->src_layer_ );
+  if ( algo->mask_layer_ ) algo->lock_for_use( algo->mask_layer_ );
+
+  // Describe the volume the filter writes into, its bricks are written by the filter
+  Core::LargeVolumeSchemaHandle src_schema = boost::dynamic_pointer_cast< LargeVolumeLayer >( 
+    algo->src_layer_ )->get_schema();
+  algo->dst_schema_ = Core::LargeVolumeFilter::CreateSchema( src_schema, 
+    algo->get_output_dir( src_schema ), 
+    algo->get_output_data_type( src_schema->get_data_type() ) );
+
+  // Create the destination layer, which will show a progress bar
+  if ( !algo->create_and_lock_large_volume_layer( algo->dst_schema_, algo->src_layer_, 
+    algo->dst_layer_ ) ) return false;
+
+  // Only write the schema once the layers are locked, which claims its directory. If the 
+  // filter fails or is aborted the directory is removed again.
+  std::string error;
+  algo->remove_dir_ = !boost::filesystem::exists( algo->dst_schema_->get_dir() );
+  if ( !algo->dst_schema_->save( error ) )
+  {
+    context->report_error( error );
+    return false;
+  }
+
+  // Return the id of the destination layer.
+  result = Core::ActionResultHandle( new Core::ActionResult( 
+    algo->dst_layer_->get_layer_id() ) );
+
+  // If the action is run from a script (provenance is a special case of script),
+  // return a notifier that the script engine can wait on.
+  if ( context->source() == Core::ActionSource::SCRIPT_E ||
+    context->source() == Core::ActionSource::PROVENANCE_E )
+  {
+    context->report_need_resource( algo->get_notifier() );
+  }
+
+  // Build the undo-redo record
+  algo->create_undo_redo_and_provenance_record( context, this->shared_from_this() );
+
+  // Start the filter.
+  Core::Runnable::Start( algo );
+
+  return true;
+}
+
+void ActionLargeVolumeFilter::Dispatch( Core::ActionContextHandle context, 
+  std::string target_layer, std::string filter, std::string mask_layer, 
+  double lower_threshold, double upper_threshold, int radius, double sigma )
+{ 
+  // Create a new action
+  ActionLargeVolumeFilter* action = new ActionLargeVolumeFilter;
+
+  // Setup the parameters
+  action->target_layer_ = target_layer;
+  action->filter_ = filter;
+  action->mask_layer_ = mask_layer;
+  action->lower_threshold_ = lower_threshold;
+  action->upper_threshold_ = upper_threshold;
+  action->radius_ = radius;
+  action->sigma_ = sigma;
+
+  // Dispatch action to underlying engine
+  Core::ActionDispatcher::PostAction( Core::ActionHandle( action ), context );
+}
+  
+} // end namespace Seg3D
@@ -0,0 +1,112 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+ 
+ The MIT License
+ 
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+ 
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef APPLICATION_FILTERS_ACTIONS_ACTIONLARGEVOLUMEFILTER_H
+#define APPLICATION_FILTERS_ACTIONS_ACTIONLARGEVOLUMEFILTER_H
+
+// Core includes
+#include <Core/Action/Actions.h>
+#include <Core/Interface/Interface.h>
+
+// Application includes
+#include <Application/Layer/Layer.h>
+#include <Application/Layer/LayerAction.h>
+#include <Application/Layer/LayerManager.h>
+
+namespace Seg3D
+{
+
+class ActionLargeVolumeFilter : public LayerAction
+{
+
+CORE_ACTION( 
+  CORE_ACTION_TYPE( "LargeVolumeFilter", "Filter a large volume brick by brick into a new"
+    " large volume." )
+  CORE_ACTION_ARGUMENT( "layerid", "The layerid on which this filter needs to be run." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "filter", "threshold", "The filter to run: threshold, mean,"
+    " median, gaussian, gradient_magnitude, and, or, xor or remove." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "mask_layerid", "<none>", "The second large volume for the"
+    " boolean filters." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "lower_threshold", "0.0", "Lower value of the threshold." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "upper_threshold", "0.0", "Upper value of the threshold." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "radius", "1", "The radius of the mean and median filter." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "sigma", "1.0", "The standard deviation of the gaussian"
+    " filter in voxels." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "dir", "", "The directory to write the new large volume to."
+    " By default a directory next to the one of the source volume is used." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "sandbox", "-1", "The sandbox in which to run the action." )
+  CORE_ACTION_ARGUMENT_IS_NONPERSISTENT( "sandbox" )  
+  CORE_ACTION_CHANGES_PROJECT_DATA()
+)
+  
+  // -- Constructor/Destructor --
+public:
+  ActionLargeVolumeFilter()
+  {
+    // Action arguments
+    this->add_layer_id( this->target_layer_ );
+    this->add_parameter( this->filter_ );
+    this->add_layer_id( this->mask_layer_ );
+    this->add_parameter( this->lower_threshold_ );
+    this->add_parameter( this->upper_threshold_ );
+    this->add_parameter( this->radius_ );
+    this->add_parameter( this->sigma_ );
+    this->add_parameter( this->dir_ );
+    this->add_parameter( this->sandbox_ );
+  }
+
+  // -- Functions that describe action --
+public:
+  virtual bool validate( Core::ActionContextHandle& context );
+  virtual bool run( Core::ActionContextHandle& context, Core::ActionResultHandle& result );
+  
+  // -- Action parameters --
+private:
+
+  std::string target_layer_;
+  std::string filter_;
+  std::string mask_layer_;
+  double lower_threshold_;
+  double upper_threshold_;
+  int radius_;
+  double sigma_;
+  std::string dir_;
+  SandboxID sandbox_;
+  
+  // -- Dispatch this action from the interface --
+public:
+  // DISPATCH:
+  // Create and dispatch action that filters the large volume 
+  static void Dispatch( Core::ActionContextHandle context, std::string target_layer, 
+    std::string filter, std::string mask_layer, double lower_threshold, 
+    double upper_threshold, int radius, double sigma );        
+};
+  
+} // end namespace Seg3D
+
+#endif
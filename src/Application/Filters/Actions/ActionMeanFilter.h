@@ -45,11 +45,11 @@ class ActionMeanFilter : public LayerAction
 {
 
 CORE_ACTION( 
-  CORE_ACTION_TYPE( "MeanFilter", "ITK filter that calculates the mean from a volume with"
+  CORE_ACTION_TYPE( "MeanFilter", "Filter that calculates the mean from a volume with"
     " a certain radius." )
   CORE_ACTION_ARGUMENT( "layerid", "The layerid on which this filter needs to be run." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "replace", "true", "Replace the old layer (true), or add an new layer (false)" )
-  CORE_ACTION_OPTIONAL_ARGUMENT( "preserve_data_format", "true", "ITK filters run in floating point percision,"
+  CORE_ACTION_OPTIONAL_ARGUMENT( "preserve_data_format", "true", "The filter runs in floating point percision,"
     " this option will convert the result back into the original format." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "radius", "2", "The distance over which the filter computes the median." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "sandbox", "-1", "The sandbox in which to run the action." )
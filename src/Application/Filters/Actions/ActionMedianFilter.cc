@@ -26,10 +26,17 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+// Boost includes
+#include <boost/bind.hpp>
+
 // ITK includes
 #include <itkMedianImageFilter.h>
 
+// Core includes
+#include <Core/DataBlock/DataBlockFilter.h>
+
 // Application includes
+#include <Application/Layer/DataLayer.h>
 #include <Application/Layer/LayerManager.h>
 #include <Application/StatusBar/StatusBar.h>
 #include <Application/Filters/ITKFilter.h>
@@ -84,6 +91,55 @@ public:
   int radius_;
 
 public:
+  // REPORT_PROGRESS:
+  // Forward the progress of the native filter to the layer that shows it.
+  void report_progress( double progress )
+  {
+    this->dst_layer_->update_progress_signal_( progress );
+  }
+
+  // RUN_NATIVE_FILTER:
+  // Compute the median directly on the data block of the layer with a sliding histogram.
+  // This avoids the conversion into an ITK image and hardly slows down for larger radii.
+  void run_native_filter()
+  {
+    DataLayerHandle src_layer = boost::dynamic_pointer_cast< DataLayer >( this->src_layer_ );
+    Core::DataBlockHandle src_data_block = src_layer->get_data_volume()->get_data_block();
+
+    Core::DataBlockHandle dst_data_block;
+    if ( !Core::DataBlockFilter::MedianFilter( src_data_block, dst_data_block, this->radius_,
+      boost::bind( &LayerFilter::check_abort, this ), 
+      boost::bind( &MedianFilterAlgo::report_progress, this, _1 ) ) )
+    {
+      if ( this->check_abort() )
+      {
+        this->report_error( "Filter was aborted." );
+        return;
+      }
+
+      this->report_error( "Could not allocate enough memory." );
+      return;
+    }
+
+    // The ITK filter generates floating point data, which is kept for consistency.
+    if ( !this->preserve_data_format_ )
+    {
+      Core::DataBlockHandle converted_data_block;
+      if ( !Core::DataBlock::ConvertDataType( dst_data_block, converted_data_block, 
+        Core::DataType::FLOAT_E ) )
+      {
+        this->report_error( "Could not allocate enough memory." );
+        return;
+      }
+      dst_data_block = converted_data_block;
+    }
+
+    if ( this->check_abort() ) return;
+
+    this->dispatch_insert_data_volume_into_layer( this->dst_layer_, Core::DataVolumeHandle( 
+      new Core::DataVolume( this->dst_layer_->get_grid_transform(), dst_data_block ) ), true );
+  }
+
   // RUN:
   // Implemtation of run of the Runnable base class, this function is called when the thread
   // is launched.
@@ -92,6 +148,13 @@ public:
   // a member variable of the algorithm class.
   SCI_BEGIN_TYPED_ITK_RUN( this->src_layer_->get_data_type() )
   {
+    // 8 and 16 bit data is filtered natively
+    if ( Core::DataBlockFilter::IsMedianFilterSupported( this->src_layer_->get_data_type() ) )
+    {
+      this->run_native_filter();
+      return;
+    }
+
     // Define the type of filter that we use.
     typedef itk::MedianImageFilter< 
       TYPED_IMAGE_TYPE, FLOAT_IMAGE_TYPE > filter_type;
@@ -104,9 +167,8 @@ public:
     // Create a new ITK filter instantiation. 
     typename filter_type::Pointer filter = filter_type::New();
 
-    // Relay abort and progress information to the layer that is executing the filter.
+    // Relay abort information to the layer that is executing the filter.
     this->forward_abort_to_filter( filter, this->dst_layer_ );
-    this->observe_itk_progress( filter, this->dst_layer_ );
 
     // Setup the filter parameters that we do not want to change.
     filter->SetInput( input_image->get_image() );
@@ -118,6 +180,19 @@ public:
     // Ensure we will have some threads left for doing something else
     this->limit_number_of_itk_threads( filter );
 
+    // Volumes that are too large to be filtered as a whole are computed in slabs, which are
+    // written directly into the destination layer.
+    if ( this->use_itk_streaming( this->src_layer_, sizeof( float ) ) )
+    {
+      this->stream_itk_filter_into_layer( filter, this->dst_layer_, 
+        this->preserve_data_format_ ? this->src_layer_->get_data_type() : 
+        Core::DataType::FLOAT_E );
+      return;
+    }
+
+    // Relay progress information to the layer that is executing the filter.
+    this->observe_itk_progress( filter, this->dst_layer_ );
+
     // Run the actual ITK filter.
     // This needs to be in a try/catch statement as certain filters throw exceptions when they
     // are aborted. In that case we will relay a message to the status bar for information.
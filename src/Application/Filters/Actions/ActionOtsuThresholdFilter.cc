@@ -26,13 +26,23 @@
  DEALINGS IN THE SOFTWARE.
  */
 
-// ITK includes
-#include <itkOtsuMultipleThresholdsImageFilter.h>
+// STL includes
+#include <limits>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/math/special_functions/next.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlockFilter.h>
+#include <Core/DataBlock/MaskDataBlockManager.h>
 
 // Application includes
+#include <Application/Layer/DataLayer.h>
+#include <Application/Layer/MaskLayer.h>
 #include <Application/Layer/LayerManager.h>
 #include <Application/StatusBar/StatusBar.h>
-#include <Application/Filters/ITKFilter.h>
+#include <Application/Filters/LayerFilter.h>
 #include <Application/Filters/Actions/ActionOtsuThresholdFilter.h>
 
 // REGISTER ACTION:
@@ -74,7 +84,7 @@ bool ActionOtsuThresholdFilter::validate( Core::ActionContextHandle& context )
 // NOTE: The separation of the algorithm into a private class is for the purpose of running the
 // filter on a separate thread.
 
-class OtsuThresholdFilterAlgo : public ITKFilter
+class OtsuThresholdFilterAlgo : public LayerFilter
 {
 
 public:
@@ -84,50 +94,65 @@ public:
   double amount_;
   
 public:
-  // RUN:
+  // REPORT_PROGRESS:
+  // Forward the progress of the filter to the layers that show it.
+  void report_progress( double progress )
+  {
+    for ( size_t j = 0; j < this->dst_layer_.size(); j++ )
+    {
+      this->dst_layer_[ j ]->update_progress_signal_( progress );
+    }
+  }
+
+  // RUN_FILTER:
   // Implementation of run of the Runnable base class, this function is called when the thread
   // is launched.
-  
-  // NOTE: The macro needs a data type to select which version to run. This needs to be
-  // a member variable of the algorithm class.
-  SCI_BEGIN_TYPED_ITK_RUN( this->src_layer_->get_data_type() )
+  // NOTE: The thresholds are computed from the histogram of the data block, and all the masks
+  // are written in a single pass over the data.
+  virtual void run_filter()
   {
-    // Define the type of filter that we use.
-    typedef itk::OtsuMultipleThresholdsImageFilter< 
-      TYPED_IMAGE_TYPE, UCHAR_IMAGE_TYPE > filter_type;
+    DataLayerHandle src_layer = boost::dynamic_pointer_cast< DataLayer >( this->src_layer_ );
+    Core::DataBlockHandle src_data_block = src_layer->get_data_volume()->get_data_block();
 
-    // Retrieve the image as an itk image from the underlying data structure
-    // NOTE: This only does wrapping and does not regenerate the data.
-    typename Core::ITKImageDataT<VALUE_TYPE>::Handle input_image; 
-    this->get_itk_image_from_layer<VALUE_TYPE>( this->src_layer_, input_image );
-        
-    // Create a new ITK filter instantiation.   
-    typename filter_type::Pointer filter = filter_type::New();
+    Core::Histogram histogram = src_data_block->get_histogram();
+    if ( !histogram.is_valid() )
+    {
+      src_data_block->update_histogram();
+      histogram = src_data_block->get_histogram();
+    }
 
-    // Relay abort and progress information to the layer that is executing the filter.
+    std::vector< double > thresholds;
+    if ( !Core::DataBlockFilter::OtsuThresholds( histogram, 
+      static_cast< int >( this->amount_ ), thresholds ) )
+    {
+      this->report_error( "Could not compute the thresholds from the histogram." );
+      return;
+    }
 
-    for ( size_t j = 0; j < static_cast<size_t>( this->amount_ + 1 );  j++ )
+    // Each mask contains the values from its lower threshold up to, but not including, the
+    // next threshold.
+    std::vector< double > lower;
+    std::vector< double > upper;
+    std::vector< Core::MaskDataBlockHandle > masks;
+    for ( size_t j = 0; j < this->dst_layer_.size(); j++ )
     {
-      this->forward_abort_to_filter( filter, this->dst_layer_[ j ] );
-      this->observe_itk_progress( filter, this->dst_layer_[ j ] );
+      lower.push_back( j == 0 ? -std::numeric_limits< double >::max() : thresholds[ j - 1 ] );
+      upper.push_back( j == thresholds.size() ? std::numeric_limits< double >::max() : 
+        boost::math::float_prior( thresholds[ j ] ) );
+
+      Core::MaskDataBlockHandle mask;
+      if ( !Core::MaskDataBlockManager::Create( this->dst_layer_[ j ]->get_grid_transform(), 
+        mask ) )
+      {
+        this->report_error( "Could not allocate enough memory." );
+        return;
+      }
+      masks.push_back( mask );
     }
-    
-    // Setup the filter parameters that we do not want to change.
-    filter->SetInput( input_image->get_image() );
-      filter->SetLabelOffset( 0 );
-    filter->SetNumberOfThresholds( this->amount_ );
 
-    // Ensure we will have some threads left for doing something else
-    this->limit_number_of_itk_threads( filter );
-    
-    // Run the actual ITK filter.
-    // This needs to be in a try/catch statement as certain filters throw exceptions when they
-    // are aborted. In that case we will relay a message to the status bar for information.
-    try 
-    { 
-      filter->Update(); 
-    } 
-    catch ( ... ) 
+    if ( !Core::DataBlockFilter::ThresholdFilter( src_data_block, lower, upper, masks,
+      boost::bind( &LayerFilter::check_abort, this ), 
+      boost::bind( &OtsuThresholdFilterAlgo::report_progress, this, _1 ) ) )
     {
       if ( this->check_abort() )
       {
@@ -135,21 +160,19 @@ public:
         return;
       }
 
-      this->report_error( "ITK filter failed to complete." );
+      this->report_error( "Could not threshold the data." );
       return;
     }
 
-    // As ITK filters generate an inconsistent abort behavior, we record our own abort flag
-    // This one is set when the abort button is pressed and an abort is sent to ITK.
     if ( this->check_abort() ) return;
     
-    for ( size_t j = 0; j < static_cast<size_t>( this->amount_ + 1 );  j++ )
+    for ( size_t j = 0; j < this->dst_layer_.size(); j++ )
     {   
-      this->insert_itk_label_into_mask_layer( this->dst_layer_[ j ], filter->GetOutput(), 
-        static_cast<unsigned char>( j ) );  
+      this->dispatch_insert_mask_volume_into_layer( this->dst_layer_[ j ], 
+        Core::MaskVolumeHandle( new Core::MaskVolume( 
+        this->dst_layer_[ j ]->get_grid_transform(), masks[ j ] ) ) );
     }
   }
-  SCI_END_TYPED_ITK_RUN()
   
   // GET_FITLER_NAME:
   // The name of the filter, this information is used for generating new layer labels.
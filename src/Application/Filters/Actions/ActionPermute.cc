@@ -26,6 +26,7 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+#include <Core/DataBlock/DataBlockView.h>
 #include <Core/DataBlock/StdDataBlock.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
 
@@ -136,20 +137,26 @@ void PermuteAlgo::permute_data_layer( DataLayerHandle input, DataLayerHandle out
 {
   Core::DataBlockHandle input_datablock = input->get_data_volume()->get_data_block();
 
-  Core::DataBlockHandle output_datablock;
-  bool succeeded = Core::DataBlock::PermuteData( input_datablock, 
-    output_datablock, this->permutation_ );
-
-  if ( succeeded && !this->check_abort() )
+  // NOTE: The permuted data is described as a view of the input data. Results that go into
+  // a sandbox are only copied when their voxels are used, so a chain of crops and 
+  // permutations in a sandbox results in a single copy. Results that are shown need their
+  // voxels for the slices right away and are copied here, so the copy does not happen on 
+  // the rendering thread.
+  Core::DataBlockViewHandle output_datablock = Core::DataBlockView::NewPermutation( 
+    input_datablock, input->get_grid_transform(), this->permutation_ );
+  bool succeeded = output_datablock && 
+    ( this->get_sandbox() != -1 || output_datablock->materialize() );
+  if ( !succeeded )
   {
-    // Centering should be preserved for each layer
-    Core::GridTransform output_grid_transform = output->get_grid_transform();
-    output_grid_transform.set_originally_node_centered( 
-      input->get_grid_transform().get_originally_node_centered() );
+    this->report_error( "Could not allocate enough memory." );
+    return;
+  }
 
+  if ( !this->check_abort() )
+  {
     this->dispatch_insert_data_volume_into_layer( output, Core::DataVolumeHandle(
-      new Core::DataVolume( output_grid_transform, output_datablock ) ), 
-      true );
+      new Core::DataVolume( output_datablock->get_grid_transform(), output_datablock ) ), 
+      !output_datablock->get_histogram().is_valid() );
     output->update_progress_signal_( 1.0 );
     this->dispatch_unlock_layer( output );
     if ( this->replace_ )
@@ -276,32 +283,18 @@ bool ActionPermute::validate( Core::ActionContextHandle& context )
   }
 
   // Compute the output grid transform
-  std::vector< size_t > src_size( 3 );
-  src_size[ 0 ] = src_grid_trans.get_nx();
-  src_size[ 1 ] = src_grid_trans.get_ny();
-  src_size[ 2 ] = src_grid_trans.get_nz();
-  Core::Point src_origin = src_grid_trans * Core::Point( 0, 0, 0 );
-  Core::Point src_max = src_grid_trans * Core::Point( static_cast< double >( src_size[ 0 ] - 1 ), 
-    static_cast< double >( src_size[ 1 ] - 1 ), static_cast< double >( src_size[ 2 ] - 1 ) );
-  Core::Point src_center( ( src_origin + src_max ) * 0.5 );
-  Core::Vector src_extend = src_max - src_origin;
-  Core::Vector src_spacing = src_grid_trans * Core::Vector( 1, 1, 1 );
-  Core::Point dst_orgin;
-  Core::Vector dst_spacing;
   std::vector< size_t > dst_size( 3 );
   for ( int i = 0; i < 3; ++i )
   {
-    int original_index = Core::Abs( permutation[ i ] ) - 1;
-    dst_orgin[ i ] = src_center[ i ] - src_extend[ original_index ] * 0.5;
-    dst_spacing[ i ] = src_spacing[ original_index ];
-    dst_size[ i ] = src_size[ original_index ];
+    switch ( Core::Abs( permutation[ i ] ) )
+    {
+    case 1: dst_size[ i ] = src_grid_trans.get_nx(); break;
+    case 2: dst_size[ i ] = src_grid_trans.get_ny(); break;
+    case 3: dst_size[ i ] = src_grid_trans.get_nz(); break;
+    }
   }
-
-  this->private_->output_grid_trans_.set_nx( dst_size[ 0 ] );
-  this->private_->output_grid_trans_.set_ny( dst_size[ 1 ] );
-  this->private_->output_grid_trans_.set_nz( dst_size[ 2 ] );
-  this->private_->output_grid_trans_.load_basis( dst_orgin, Core::Vector( dst_spacing[ 0 ], 0, 0 ),
-    Core::Vector( 0, dst_spacing[ 1 ], 0 ), Core::Vector( 0, 0, dst_spacing[ 2 ] ) );
+  this->private_->output_grid_trans_ = Core::DataBlockView::ComputeGridTransform( 
+    src_grid_trans, permutation, std::vector< size_t >( 3, 0 ), dst_size );
 
   // Validation successful
   return true;
@@ -35,16 +35,20 @@
 #include <Core/Utils/ConnectionHandler.h>
 #include <Core/Utils/Log.h>
 #include <Core/Utils/Notifier.h>
+#include <Core/Utils/Parallel.h>
 #include <Core/Utils/Runnable.h>
 
 #include <Core/DataBlock/StdDataBlock.h>
 #include <Core/Volume/DataVolume.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 // Boost includes
+#include <boost/bind.hpp>
 #include <boost/signals2/signal.hpp>
+#include <boost/thread/barrier.hpp>
 #include <boost/thread/thread.hpp>
 
 // RBF library includes
@@ -112,6 +116,36 @@ public:
   double thresholdValue_;
 };
 
+// Number of x values that are copied together, so both the reads along z from the RBF
+// value grid and the writes along x into the data block stay within a few cache lines
+const static size_t RBF_COPY_TILE_C = 32;
+
+// COPYRBFVALUES:
+// Copy the z-slab of the RBF values that belongs to this thread into the float buffer.
+static void CopyRBFValues( const RBFInterface* rbf_algo, float* data, size_t nx, size_t ny, 
+  size_t nz, int thread, int num_threads, boost::barrier& barrier )
+{
+  size_t z_start = nz * thread / num_threads;
+  size_t z_end = nz * ( thread + 1 ) / num_threads;
+  size_t nxy = nx * ny;
+
+  for ( size_t j = 0; j < ny; ++j )
+  {
+    for ( size_t i_start = 0; i_start < nx; i_start += RBF_COPY_TILE_C )
+    {
+      size_t i_end = std::min( nx, i_start + RBF_COPY_TILE_C );
+      for ( size_t k = z_start; k < z_end; ++k )
+      {
+        float* row = data + k * nxy + j * nx;
+        for ( size_t i = i_start; i < i_end; ++i )
+        {
+          row[ i ] = static_cast< float >( rbf_algo->value[ i ][ j ][ k ] );
+        }
+      }
+    }
+  }
+}
+
 class RadialBasisFunctionAlgo : public LayerFilter
 {
 public:
@@ -167,16 +201,14 @@ public:
       return;
     }
 
-    for (size_t i = 0; i < dstDataBlock->get_nx(); ++i)
-    {
-      for (size_t j = 0; j < dstDataBlock->get_ny(); ++j)
-      {
-        for (size_t k = 0; k < dstDataBlock->get_nz(); ++k)
-        {
-          dstDataBlock->set_data_at( i, j, k, rbfAlgo.value[i][j][k] );
-        }
-      }
-    }
+    if ( this->check_abort() ) return;
+
+    // Write the values straight into the float buffer, one z-slab per thread
+    Core::Parallel parallel_copy( boost::bind( &CopyRBFValues, &rbfAlgo, 
+      reinterpret_cast< float* >( dstDataBlock->get_data() ), dstDataBlock->get_nx(), 
+      dstDataBlock->get_ny(), dstDataBlock->get_nz(), _1, _2, _3 ) );
+    parallel_copy.run();
+
     dstDataBlock->update_histogram();
     std::cerr << "Min: " << dstDataBlock->get_min() << ", max: " << dstDataBlock->get_max() << std::endl;
 
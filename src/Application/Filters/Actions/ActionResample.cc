@@ -26,15 +26,26 @@
  DEALINGS IN THE SOFTWARE.
 */
 
+// STL includes
+#include <cmath>
+#include <vector>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
 // teem includes
 #include <teem/nrrd.h>
 #include <privateNrrd.h>
 
 // Core includes
+#include <Core/DataBlock/DataBlockFilter.h>
 #include <Core/DataBlock/NrrdDataBlock.h>
 #include <Core/DataBlock/StdDataBlock.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/Math/MathFunctions.h>
 #include <Core/Utils/Log.h>
+#include <Core/Utils/Parallel.h>
 
 // Application includes
 #include <Application/Layer/LayerManager.h>
@@ -91,6 +102,112 @@ public:
   Core::GridTransform grid_transform_;
 };
 
+//////////////////////////////////////////////////////////////////////////
+// Native mask resampler
+// Data layers are resampled by Core::DataBlockFilter::ResampleFilter. Masks are resampled with
+// nearest neighbor sampling directly on their bit planes.
+//////////////////////////////////////////////////////////////////////////
+
+// Number of output samples below which the mask resampler runs on a single thread
+const static size_t RESAMPLE_PARALLEL_SIZE_C = 1 << 16;
+
+// CLASS ResampleNearestTable:
+// The nearest input sample of each output sample along one axis. Samples that fall outside of
+// the input and need to be padded have index -1.
+class ResampleNearestTable
+{
+public:
+  size_t size_in_;
+  size_t size_out_;
+  std::vector< int > index_;
+};
+
+// COMPUTENEARESTTABLE:
+// Table that picks the nearest input sample for each output sample along an axis.
+static void ComputeNearestTable( const NrrdResampleAxis& axis, bool pad, 
+  ResampleNearestTable& table )
+{
+  const int size_in = static_cast< int >( axis.sizeIn );
+  const size_t size_out = axis.samples;
+
+  table.size_in_ = axis.sizeIn;
+  table.size_out_ = size_out;
+  table.index_.resize( size_out );
+
+  for ( size_t i = 0; i < size_out; ++i )
+  {
+    double pos = NRRD_POS( axis.center, axis.min, axis.max, size_out, i );
+    int index = static_cast< int >( std::floor( pos + 0.5 ) );
+    if ( index < 0 || index >= size_in )
+    {
+      index = pad ? -1 : Core::Clamp( index, 0, size_in - 1 );
+    }
+    table.index_[ i ] = index;
+  }
+}
+
+// CLASS ResampleMaskInfo:
+// The nearest neighbor tables and the bit planes of a mask that is resampled.
+class ResampleMaskInfo
+{
+public:
+  const ResampleNearestTable* tables_[ 3 ];
+  const unsigned char* src_;
+  unsigned char src_value_;
+  unsigned char* dst_;
+  unsigned char dst_value_;
+  boost::function< bool () > abort_function_;
+};
+
+// RESAMPLEMASKPARALLEL:
+// Copy the bit of the nearest input voxel into the bit plane of the output mask, without 
+// converting the masks to and from byte volumes. Each thread takes a range of slices.
+static void ResampleMaskParallel( const ResampleMaskInfo& info, 
+  int thread, int num_threads, boost::barrier& barrier )
+{
+  const ResampleNearestTable& table_x = *info.tables_[ 0 ];
+  const ResampleNearestTable& table_y = *info.tables_[ 1 ];
+  const ResampleNearestTable& table_z = *info.tables_[ 2 ];
+  const size_t src_nx = table_x.size_in_;
+  const size_t src_nxy = src_nx * table_y.size_in_;
+  const size_t nx = table_x.size_out_;
+  const size_t ny = table_y.size_out_;
+  const size_t nz = table_z.size_out_;
+  const unsigned char src_value = info.src_value_;
+  const unsigned char dst_value = info.dst_value_;
+  const unsigned char not_dst_value = static_cast< unsigned char >( ~dst_value );
+
+  const size_t z_start = ( nz * thread ) / num_threads;
+  const size_t z_end = ( nz * ( thread + 1 ) ) / num_threads;
+
+  for ( size_t z = z_start; z < z_end; ++z )
+  {
+    if ( info.abort_function_() ) return;
+
+    for ( size_t y = 0; y < ny; ++y )
+    {
+      unsigned char* dst = info.dst_ + ( z * ny + y ) * nx;
+      const int src_z = table_z.index_[ z ];
+      const int src_y = table_y.index_[ y ];
+      if ( src_z < 0 || src_y < 0 )
+      {
+        for ( size_t x = 0; x < nx; ++x ) dst[ x ] &= not_dst_value;
+        continue;
+      }
+
+      const unsigned char* src = info.src_ + src_z * src_nxy + src_y * src_nx;
+      for ( size_t x = 0; x < nx; ++x )
+      {
+        const int src_x = table_x.index_[ x ];
+        const unsigned char inside = static_cast< unsigned char >( 
+          src_x >= 0 && ( src[ src_x ] & src_value ) );
+        dst[ x ] = static_cast< unsigned char >( ( dst[ x ] & not_dst_value ) | 
+          ( -inside & dst_value ) );
+      }
+    }
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////
 // ALGORITHM CLASS
 // This class does the actual work and is run on a separate thread.
@@ -143,9 +260,12 @@ public:
   // Detect cases where sample positions are not changed so we only need to do padding/cropping.
   void detect_padding_only();
 
-  // NRRD_RESAMPLE:
-  // Resample the nrrd data.
-  bool nrrd_resample( Nrrd* nin, Nrrd* nout, NrrdKernelSpec* unuk );
+  // REPORT_PROGRESS:
+  // Report the progress of resampling a data layer, which starts after 10%.
+  void report_progress( DataLayerHandle output, double progress )
+  {
+    output->update_progress_signal_( 0.1 + 0.9 * progress );
+  }
 
   // RESAMPLE_DATA_LAYER:
   // Resample a  data layer.
@@ -396,36 +516,6 @@ bool ResampleAlgo::compute_output_grid_transform( LayerHandle layer,
   return true;
 }
 
-bool ResampleAlgo::nrrd_resample( Nrrd* nin, Nrrd* nout, NrrdKernelSpec* unuk )
-{
-  int error = AIR_FALSE;
-  error |= nrrdResampleNrrdSet( this->current_resample_context_, nin );
-  for ( unsigned int axis = 0; axis < nin->dim && !error; ++axis )
-  {
-    error |= nrrdResampleKernelSet( this->current_resample_context_, axis, unuk->kernel, 
-      unuk->parm );
-    error |= nrrdResampleSamplesSet( this->current_resample_context_, axis, 
-      this->dimesions_[ axis ] );
-    if ( this->crop_ )
-    {
-      error |= nrrdResampleRangeSet( this->current_resample_context_, axis, 
-        this->range_min_[ axis ], this->range_max_[ axis ] );
-    }
-    else
-    {
-      error |= nrrdResampleRangeFullSet( this->current_resample_context_, axis );
-    }
-  }
-  if ( ! error )
-  {
-    // For some reason the grid transform of nout isn't set (no min, max, or origin info)
-    // unu resample works, so maybe we're doing something wrong?  Working around this for now.
-    error |= nrrdResampleExecute( this->current_resample_context_, nout );
-  }
-
-  return !error;
-}
-
 void ResampleAlgo::resample_data_layer( DataLayerHandle input, DataLayerHandle output )
 {
   if ( this->padding_only_ )
@@ -433,52 +523,35 @@ void ResampleAlgo::resample_data_layer( DataLayerHandle input, DataLayerHandle o
     this->pad_and_crop_data_layer( input, output );
     return;
   }
-  
-  Core::DataBlock::shared_lock_type data_lock( input->get_data_volume()->
-    get_data_block()->get_mutex() );
-
-  Core::NrrdDataHandle nrrd_in( new Core::NrrdData( 
-    input->get_data_volume()->get_data_block(),
-    input->get_grid_transform() ) );
 
-  Nrrd* nrrd_out = nrrdNew();
-  int error = AIR_FALSE;
+  Core::DataBlockHandle input_datablock = input->get_data_volume()->get_data_block();
 
-  if ( this->crop_ )
+  double pad_value = 0.0;
+  if ( this->crop_ && this->padding_ == ActionResample::MIN_C )
   {
-    if ( this->padding_ == ActionResample::ZERO_C )
-    {
-      error |= nrrdResamplePadValueSet( this->current_resample_context_, 0.0 );
-    }
-    else if ( this->padding_ == ActionResample::MIN_C )
-    {
-      error |= nrrdResamplePadValueSet( this->current_resample_context_, input->get_data_volume()->
-        get_data_block()->get_min() );
-    }
-    else
-    {
-      error |= nrrdResamplePadValueSet( this->current_resample_context_, input->get_data_volume()->
-        get_data_block()->get_max() );
-    }
-    if (error)
-    {
-      nrrdNuke( nrrd_out );
-      CORE_LOG_ERROR( "Failed to set up padding." );
-      return;
-    }
+    pad_value = input_datablock->get_min();
   }
+  else if ( this->crop_ && this->padding_ != ActionResample::ZERO_C )
+  {
+    pad_value = input_datablock->get_max();
+  }
+
   output->update_progress_signal_( 0.1 );
-  if ( ! nrrd_resample( nrrd_in->nrrd(), nrrd_out, this->data_kernel_ ) )
+  Core::DataBlockHandle output_datablock;
+  bool success = Core::DataBlockFilter::ResampleFilter( input_datablock, output_datablock,
+    this->current_resample_context_, this->data_kernel_, this->crop_, pad_value,
+    boost::bind( &LayerFilter::check_abort, this ), 
+    boost::bind( &ResampleAlgo::report_progress, this, output, _1 ) );
+  if ( !success && !this->check_abort() )
   {
-    nrrdNuke( nrrd_out );
-    CORE_LOG_ERROR( "Failed to resample layer '" + input->get_layer_id() +"'" );
+    this->report_error( "Could not allocate enough memory." );
+    return;
   }
-  else if ( !this->check_abort() )
+
+  if ( success && !this->check_abort() )
   {
-    Core::NrrdDataHandle nrrd_data( new Core::NrrdData( nrrd_out ) );
-    Core::DataBlockHandle data_block = Core::NrrdDataBlock::New( nrrd_data );
     Core::DataVolumeHandle data_volume( new Core::DataVolume( 
-      this->current_output_transform_, data_block ) );
+      this->current_output_transform_, output_datablock ) );
     this->dispatch_insert_data_volume_into_layer( output, data_volume, true );
     output->update_progress_signal_( 1.0 );
     this->dispatch_unlock_layer( output );
@@ -493,6 +566,8 @@ void ResampleAlgo::resample_data_layer( DataLayerHandle input, DataLayerHandle o
   }
 }
 
+// NOTE: Masks are resampled with nearest neighbor sampling straight from the bit plane of the
+// input into the bit plane of a new mask, hence no byte volumes need to be allocated.
 void ResampleAlgo::resample_mask_layer( MaskLayerHandle input, MaskLayerHandle output )
 {
   if ( this->padding_only_ )
@@ -500,44 +575,53 @@ void ResampleAlgo::resample_mask_layer( MaskLayerHandle input, MaskLayerHandle o
     this->pad_and_crop_mask_layer( input, output );
     return;
   }
-  
-  Core::DataBlockHandle input_data_block;
-  Core::MaskDataBlockManager::Convert( input->get_mask_volume()->get_mask_data_block(),
-    input_data_block, Core::DataType::UCHAR_E );
-  Core::NrrdDataHandle nrrd_in( new Core::NrrdData( input_data_block, input->get_grid_transform() ) );
 
-  Nrrd* nrrd_out = nrrdNew();
-
-  if ( this->crop_ )
+  ResampleNearestTable tables[ 3 ];
+  for ( int axis = 0; axis < 3; ++axis )
   {
-    int error = AIR_FALSE;
-
-    // Pad the mask layer with 0
-    error |= nrrdResamplePadValueSet( this->current_resample_context_, 0.0 );
-    if (error)
-    {
-      nrrdNuke( nrrd_out );
-      CORE_LOG_ERROR( "Failed to set up padding." );
-      return;
-    }
+    ComputeNearestTable( this->current_resample_context_->axis[ axis ], this->crop_,
+      tables[ axis ] );
   }
-  output->update_progress_signal_( 0.1 );
-  if ( ! nrrd_resample( nrrd_in->nrrd(), nrrd_out, this->mask_kernel_ ) )
+
+  Core::MaskDataBlockHandle mask_data_block;
+  if ( !Core::MaskDataBlockManager::Create( this->current_output_transform_, mask_data_block ) )
   {
-    nrrdNuke( nrrd_out );
-    CORE_LOG_ERROR( "Failed to resample layer '" + input->get_layer_id() +"'" );
+    this->report_error( "Could not allocate enough memory." );
+    return;
   }
-  else if ( !this->check_abort() )
+  output->update_progress_signal_( 0.1 );
+
   {
-    Core::NrrdDataHandle nrrd_data( new Core::NrrdData( nrrd_out ) );
-    Core::DataBlockHandle data_block = Core::NrrdDataBlock::New( nrrd_data );
-    Core::MaskDataBlockHandle mask_data_block;
-    if ( ! Core::MaskDataBlockManager::Convert( data_block,
-      this->current_output_transform_, mask_data_block ) )
+    Core::MaskDataBlockHandle input_mask = input->get_mask_volume()->get_mask_data_block();
+
+    // NOTE: The new mask may share its data block with the input, in which case the write
+    // lock covers the reading as well.
+    Core::MaskDataBlock::shared_lock_type data_lock( input_mask->get_mutex(), boost::defer_lock );
+    if ( input_mask->get_data_block() != mask_data_block->get_data_block() )
     {
-      return;
+      data_lock.lock();
     }
+    Core::MaskDataBlock::lock_type mask_lock( mask_data_block->get_mutex() );
 
+    ResampleMaskInfo info;
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+      info.tables_[ axis ] = &tables[ axis ];
+    }
+    info.src_ = input_mask->get_mask_data();
+    info.src_value_ = input_mask->get_mask_value();
+    info.dst_ = mask_data_block->get_mask_data();
+    info.dst_value_ = mask_data_block->get_mask_value();
+    info.abort_function_ = boost::bind( &LayerFilter::check_abort, this );
+
+    int num_threads = mask_data_block->get_size() < RESAMPLE_PARALLEL_SIZE_C ? 1 : -1;
+    Core::Parallel parallel( boost::bind( &ResampleMaskParallel, boost::cref( info ), 
+      _1, _2, _3 ), num_threads );
+    parallel.run();
+  }
+
+  if ( !this->check_abort() )
+  {
     Core::MaskVolumeHandle mask_volume( new Core::MaskVolume( 
       this->current_output_transform_, mask_data_block ) );
     this->dispatch_insert_mask_volume_into_layer( output, mask_volume );
@@ -561,20 +645,10 @@ void ResampleAlgo::run_filter()
     this->current_output_transform_ = this->output_transforms_[ i ];
     this->current_resample_context_ = this->resample_contexts_[ i ];
 
-    int error = AIR_FALSE;
+    // NOTE: When cropping the boundary is padded, otherwise the edge of the data is repeated.
     if ( this->crop_ )
     {
       this->detect_padding_only();
-      error |= nrrdResampleBoundarySet( this->current_resample_context_, nrrdBoundaryPad );
-    }
-    else
-    {
-      error |= nrrdResampleBoundarySet( this->current_resample_context_, nrrdBoundaryBleed );
-    }
-    if (error)
-    {
-      this->report_error( "Resample boundary failed." );
-      return;
     }
 
     switch ( this->src_layers_[ i ]->get_type() )
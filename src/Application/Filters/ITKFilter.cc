@@ -30,7 +30,9 @@
 #include <itkCommand.h>
  
 // Core includes
+#include <Core/Application/Application.h>
 #include <Core/Utils/Exception.h>
+#include <Core/Utils/Tracer.h>
 #include <Core/DataBlock/StdDataBlock.h>
 #include <Core/DataBlock/ITKDataBlock.h>
 #include <Core/DataBlock/ITKImageData.h>
@@ -45,6 +47,14 @@
 namespace Seg3D
 {
 
+// ITK_STREAMING_MEMORY_FRACTION_C:
+// Fraction of the physical memory a full volume filter may use before it is run in slabs.
+const static double ITK_STREAMING_MEMORY_FRACTION_C = 0.25;
+
+// ITK_STREAMING_SLAB_VOXELS_C:
+// Approximate number of voxels that are computed per slab when streaming a filter.
+const static size_t ITK_STREAMING_SLAB_VOXELS_C = 1 << 24;
+
 // CLASS ITKPROGRESSREPORTER:
 //
 // This class keeps track of the progress made in a filter
@@ -91,6 +101,42 @@ void ITKProgressReporter::Report( ITKProgressReporterHandle reporter, const itk:
   }
 }
 
+// CLASS ITKTRACEREPORTER:
+//
+// This class records the time spent inside an itk filter's update in the trace
+
+class ITKTraceReporter;
+typedef boost::shared_ptr<ITKTraceReporter> ITKTraceReporterHandle;
+
+class ITKTraceReporter
+{
+public:
+  ITKTraceReporter() :
+    start_( 0 )
+  {}
+
+  // Time at which the filter started
+  long long start_;
+
+public:
+  static void Start( ITKTraceReporterHandle reporter, const itk::Object* itk_object );
+  static void End( ITKTraceReporterHandle reporter, const itk::Object* itk_object );
+};
+
+void ITKTraceReporter::Start( ITKTraceReporterHandle reporter, const itk::Object* itk_object )
+{
+  reporter->start_ = Core::Tracer::Instance()->get_timestamp();
+}
+
+void ITKTraceReporter::End( ITKTraceReporterHandle reporter, const itk::Object* itk_object )
+{
+  if ( !Core::Tracer::IsTracing() ) return;
+  
+  Core::Tracer* tracer = Core::Tracer::Instance();
+  tracer->add_span( "itk", std::string( itk_object->GetNameOfClass() ) + " update", 
+    reporter->start_, tracer->get_timestamp() - reporter->start_ );
+}
+
 // CLASS ITKOBSERVER:
 //
 // This object is installed in an itk filter so it can call functor objects when events
@@ -210,6 +256,16 @@ void ITKFilter::forward_abort_to_filter_internal( itk::ProcessObject::Pointer fi
   ITKFilterPrivate::lock_type lock( this->private_->get_mutex() );
   this->private_->disconnect_all();
   this->private_->filter_ = filter;
+
+  // Record the time spent in the update of the filter
+  if ( Core::Tracer::IsTracing() )
+  {
+    ITKTraceReporterHandle reporter( new ITKTraceReporter );
+    filter->AddObserver( itk::StartEvent(), new ITKConstObserver( boost::bind( 
+      &ITKTraceReporter::Start, reporter, _1 ) ) );
+    filter->AddObserver( itk::EndEvent(), new ITKConstObserver( boost::bind( 
+      &ITKTraceReporter::End, reporter, _1 ) ) );
+  }
   
   // NOTE: The following logic is already done by LayerFilter.
   //this->private_->add_connection( layer->abort_signal_.connect( boost::bind(
@@ -246,4 +302,31 @@ void ITKFilter::limit_number_of_itk_threads_internal( itk::ProcessObject::Pointe
   filter->GetMultiThreader()->SetNumberOfThreads( max_threads - 1 );
 }
 
+bool ITKFilter::use_itk_streaming( const LayerHandle& layer, size_t bytes_per_voxel ) const
+{
+  Core::GridTransform grid_transform = layer->get_grid_transform();
+  double volume_size = static_cast<double>( grid_transform.get_nx() ) * 
+    static_cast<double>( grid_transform.get_ny() ) * 
+    static_cast<double>( grid_transform.get_nz() ) * static_cast<double>( bytes_per_voxel );
+
+  // NOTE: Most itk filters need at least one internal buffer of the size of the output, hence
+  // a full volume run needs twice the size of the output on top of the input.
+  double memory = static_cast<double>( 
+    Core::Application::Instance()->get_total_addressable_physical_memory() );
+  return ( memory > 0.0 && 2.0 * volume_size > ITK_STREAMING_MEMORY_FRACTION_C * memory );
+}
+
+size_t ITKFilter::get_itk_streaming_slab_size( size_t nx, size_t ny, size_t nz ) const
+{
+  size_t slice_size = std::max( nx * ny, static_cast<size_t>( 1 ) );
+  size_t slab_size = std::max( ITK_STREAMING_SLAB_VOXELS_C / slice_size, 
+    static_cast<size_t>( 1 ) );
+  return std::min( slab_size, std::max( nz, static_cast<size_t>( 1 ) ) );
+}
+
+void ITKFilter::update_layer_progress( LayerHandle layer, double progress )
+{
+  layer->update_progress_signal_( progress );
+}
+
 } // end namespace Core
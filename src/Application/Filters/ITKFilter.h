@@ -30,6 +30,7 @@
 #define APPLICATION_FILTERS_ITKFILTER_H
  
 // Boost includes
+#include <boost/bind.hpp>
 #include <boost/function.hpp>
 #include <boost/smart_ptr.hpp> 
 #include <boost/noncopyable.hpp> 
@@ -37,7 +38,9 @@
 // Core includes
 #include <Core/DataBlock/ITKImageData.h>
 #include <Core/DataBlock/ITKDataBlock.h>
+#include <Core/DataBlock/ITKStreaming.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/DataBlock/StdDataBlock.h>
 #include <Core/Utils/Runnable.h>
 #include <Core/Volume/DataVolume.h>
 #include <Core/Volume/MaskVolume.h>
@@ -381,6 +384,29 @@ protected:
     {
       DataLayerHandle data_layer = boost::dynamic_pointer_cast<DataLayer>( layer );
 
+      Core::DataBlockHandle data_block_dst;
+
+      // If the itk image owns its buffer and the requested type has the size of the pixel
+      // type, the pixels are converted in place so no second volume needs to be allocated.
+      // NOTE: Narrower types are copied, as the layer would otherwise keep the larger itk
+      // buffer alive while reporting the size of the narrower type.
+      // NOTE: Buffers that are not managed by itk may be shared with the input layer.
+      if ( Core::GetSizeDataType( data_type ) == sizeof( T ) &&
+        itk_image->GetPixelContainer()->GetContainerManageMemory() )
+      {
+        data_block_dst = Core::ITKDataBlock::New<T>( itk_image, data_type );
+        if ( ! data_block_dst )
+        {
+          this->report_error( "Could not allocate enough memory." );
+          return false;     
+        }
+
+        Core::DataVolumeHandle data_volume( new Core::DataVolume( 
+          data_layer->get_grid_transform(), data_block_dst ) );
+        this->dispatch_insert_data_volume_into_layer( data_layer, data_volume, true );
+        return true;
+      }
+
       // Wrap an ITKImageData object around the itk object
       Core::DataBlockHandle data_block_src = Core::ITKDataBlock::New<T>( itk_image ) ;
       if ( ! data_block_src )
@@ -389,7 +415,7 @@ protected:
         return false;     
       }
       
-      Core::DataBlockHandle data_block_dst = data_block_src;
+      data_block_dst = data_block_src;
       if ( data_block_src->get_data_type() != data_type )
       {
         if ( !( Core::DataBlock::ConvertDataType( data_block_src, 
@@ -495,6 +521,70 @@ protected:
     this->limit_number_of_itk_threads_internal( itk::ProcessObject::Pointer( filter_pointer ) );
   }
   
+  /// USE_ITK_STREAMING:
+  /// Whether an itk filter that generates a volume of the size of the layer with the given
+  /// number of bytes per voxel should be run in slabs, as the full volume and the internal
+  /// buffers of the filter would take up too large a fraction of the physical memory.
+  bool use_itk_streaming( const LayerHandle& layer, size_t bytes_per_voxel ) const;
+
+  /// STREAM_ITK_FILTER_INTO_LAYER:
+  /// Run an itk filter in slabs along the z axis and write each slab of its output directly
+  /// into the data block that becomes the data of the layer, which is allocated in the 
+  /// requested type. The input of the filter should wrap the data of the source layer, of 
+  /// which each slab only reads the region it needs. Hence, besides the source and 
+  /// destination data, only the output and internal buffers of a single slab are held by 
+  /// itk. Both volumes still need to be in memory; volumes that do not fit are handled as 
+  /// large volumes, whose bricks are read from and written to disk one at a time.
+  /// Progress is reported per slab, hence the filter should not be observed with 
+  /// observe_itk_progress.
+  template< class FILTER >
+  bool stream_itk_filter_into_layer( FILTER filter_pointer, const LayerHandle& layer, 
+    Core::DataType data_type )
+  {
+    if ( layer->get_type() != Core::VolumeType::DATA_E )
+    {
+      this->report_error( "Encountered unknown data type." );
+      return false;
+    }
+    DataLayerHandle data_layer = boost::dynamic_pointer_cast<DataLayer>( layer );
+
+    Core::GridTransform grid_transform = data_layer->get_grid_transform();
+    Core::DataBlockHandle data_block = Core::StdDataBlock::New( grid_transform, data_type );
+    if ( !data_block )
+    {
+      this->report_error( "Could not allocate enough memory." );
+      return false;
+    }
+
+    size_t slab_size = this->get_itk_streaming_slab_size( grid_transform.get_nx(), 
+      grid_transform.get_ny(), grid_transform.get_nz() );
+    if ( !Core::ITKStreaming::StreamFilter( filter_pointer.GetPointer(), data_block, 
+      slab_size, boost::bind( &LayerFilter::check_abort, this ),
+      boost::bind( &ITKFilter::update_layer_progress, this, layer, _1 ) ) )
+    {
+      if ( this->check_abort() )
+      {
+        this->report_error( "Filter was aborted." );
+        return false;
+      }
+      this->report_error( "ITK filter failed to complete." );
+      return false;
+    }
+
+    Core::DataVolumeHandle data_volume( new Core::DataVolume( grid_transform, data_block ) );
+    this->dispatch_insert_data_volume_into_layer( data_layer, data_volume, true );
+    return true;
+  }
+
+private:
+  /// GET_ITK_STREAMING_SLAB_SIZE:
+  /// The number of slices that are computed at once when streaming a filter
+  size_t get_itk_streaming_slab_size( size_t nx, size_t ny, size_t nz ) const;
+
+  /// UPDATE_LAYER_PROGRESS:
+  /// Forward the progress of a streamed filter to a layer
+  void update_layer_progress( LayerHandle layer, double progress );
+
 protected:      
   /// HANDLE_ABORT:
   /// A virtual function that can be overloaded
@@ -0,0 +1,278 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef _MSC_VER
+#pragma warning( disable: 4244 4267 )
+#endif
+
+// STL includes
+#include <string>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/python.hpp>
+
+// Core includes
+#include <Core/Application/Application.h>
+#include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/Python/DataBlockBuffer.h>
+#include <Core/Python/PythonActionContext.h>
+#include <Core/Python/PythonDataBlock.h>
+
+// Application includes
+#include <Application/Filters/LayerFilterLock.h>
+#include <Application/Layer/DataLayer.h>
+#include <Application/Layer/LayerCheckPoint.h>
+#include <Application/Layer/LayerManager.h>
+#include <Application/Layer/LayerUndoBufferItem.h>
+#include <Application/Layer/MaskLayer.h>
+#include <Application/PreferencesManager/PreferencesManager.h>
+#include <Application/Project/Project.h>
+#include <Application/ProjectManager/ProjectManager.h>
+#include <Application/Provenance/Provenance.h>
+#include <Application/Provenance/ProvenanceStep.h>
+#include <Application/UndoBuffer/UndoBuffer.h>
+
+// Functions that give python direct access to the data of layers, so that scripts can use the
+// data with numpy instead of exporting and importing files.
+
+namespace Seg3D
+{
+
+// RAISEERROR:
+// Raise a python exception with the error message.
+static void RaiseError( const std::string& error )
+{
+  PyErr_SetString( PyExc_Exception, error.c_str() );
+  boost::python::throw_error_already_set();
+}
+
+// FINDANDLOCKLAYER:
+// Find a layer of the given type and lock it, for processing if the data is changed and for 
+// use otherwise. This needs to run on the application thread.
+static void FindAndLockLayer( const std::string& layer_id, Core::VolumeType type, 
+  bool processing, LayerHandle& layer )
+{
+  layer = LayerManager::FindLayer( layer_id );
+  if ( !layer || layer->get_type() != type ) 
+  {
+    layer.reset();
+    return;
+  }
+
+  bool locked = processing ? LayerManager::LockForProcessing( layer ) : 
+    LayerManager::LockForUse( layer );
+  if ( !locked ) layer.reset();
+}
+
+// UNLOCKLAYER:
+// Unlock the layer once python is done with its data.
+static void UnlockLayer( LayerHandle layer, bool filter_slot )
+{
+  LayerManager::DispatchUnlockLayer( layer );
+  if ( filter_slot ) LayerFilterLock::Instance()->unlock();
+}
+
+// INSERTLAYERDATA:
+// Replace the data of a data layer with the copy python changed and unlock the layer. The old
+// data volume stays intact for the check point and for the layers that share its data block.
+// This needs to run on the application thread.
+static void InsertLayerData( LayerHandle layer, Core::DataBlockHandle data_block )
+{
+  DataLayerHandle data_layer = boost::static_pointer_cast< DataLayer >( layer );
+
+  ProvenanceID prov_id = GenerateProvenanceID();
+  ProvenanceIDList old_prov_ids( 1, layer->provenance_id_state_->get() );
+  ProvenanceStepHandle provenance_step( new ProvenanceStep );
+  provenance_step->set_input_provenance_ids( old_prov_ids );
+  provenance_step->set_output_provenance_ids( ProvenanceIDList( 1, prov_id ) );
+  provenance_step->set_replaced_provenance_ids( old_prov_ids );
+  provenance_step->set_action_name( "getlayerdata" );
+  provenance_step->set_action_params( "layerid=" + layer->get_layer_id() + " writable=true" );
+  ProvenanceStepID prov_step_id = ProjectManager::Instance()->get_current_project()->
+    add_provenance_record( provenance_step );
+
+  if ( PreferencesManager::Instance()->enable_undo_state_->get() )
+  {
+    // NOTE: The change was not made by an action, hence it can be undone but not redone.
+    LayerUndoBufferItemHandle item( new LayerUndoBufferItem( "Python Layer Data" ) );
+    item->add_layer_to_restore( layer, LayerCheckPointHandle( new LayerCheckPoint( layer ) ) );
+    item->set_provenance_step_id( prov_step_id );
+    UndoBuffer::Instance()->insert_undo_item( Core::ActionContextHandle( 
+      new Core::PythonActionContext ), item );
+  }
+
+  LayerManager::DispatchInsertDataVolumeIntoLayer( data_layer, Core::DataVolumeHandle( 
+    new Core::DataVolume( data_layer->get_grid_transform(), data_block ) ), prov_id );
+  LayerManager::DispatchUnlockLayer( layer );
+}
+
+// FINISHLAYERDATA:
+// Hand the data python changed to the layer once the python object is closed.
+static void FinishLayerData( LayerHandle layer, Core::DataBlockHandle data_block )
+{
+  Core::Application::PostEvent( boost::bind( &InsertLayerData, layer, data_block ) );
+  LayerFilterLock::Instance()->unlock();
+}
+
+// CREATELAYER:
+// Create a new data layer. This needs to run on the application thread.
+static void CreateLayer( const Core::GridTransform& grid_transform, const std::string& name,
+  LayerHandle& layer )
+{
+  if ( !LayerManager::CreateAndLockDataLayer( grid_transform, name, layer, LayerMetaData() ) )
+  {
+    layer.reset();
+  }
+}
+
+// GETLAYERDATA:
+// Get the data of a data layer as an object that numpy.asarray() can use. The layer is locked
+// until the object is closed. A read-only object uses the data of the layer without copying it.
+// A writable object is a copy of the data, which replaces the data of the layer as a new data
+// volume once the object is closed. The data of a layer is shared with its undo check points 
+// and with the views of other layers, hence it is never changed in place. A writable object 
+// is treated as a filter and needs a filter slot.
+static boost::python::object GetLayerData( const std::string& layer_id, bool writable )
+{
+  if ( writable ) LayerFilterLock::Instance()->lock();
+
+  LayerHandle layer;
+  Core::Application::PostAndWaitEvent( boost::bind( &FindAndLockLayer, layer_id, 
+    Core::VolumeType::DATA_E, writable, boost::ref( layer ) ) );
+  if ( !layer )
+  {
+    if ( writable ) LayerFilterLock::Instance()->unlock();
+    RaiseError( "Layer '" + layer_id + "' is not a data layer or is not available." );
+  }
+
+  Core::DataBlockHandle data_block = static_cast< DataLayer* >( layer.get() )->
+    get_data_volume()->get_data_block();
+  if ( !writable )
+  {
+    return Core::NewDataBlockBuffer( data_block, false, 
+      boost::bind( &UnlockLayer, layer, false ) );
+  }
+
+  Core::DataBlockHandle data_copy;
+  if ( !Core::DataBlock::Duplicate( data_block, data_copy ) || !data_copy )
+  {
+    UnlockLayer( layer, true );
+    RaiseError( "Could not allocate enough memory." );
+  }
+  return Core::NewDataBlockBuffer( data_copy, true, 
+    boost::bind( &FinishLayerData, layer, data_copy ) );
+}
+
+// GETMASKDATA:
+// Get the data of a mask layer as bytes that are 1 inside the mask and 0 outside of it. The
+// bits of masks are packed together, hence this is a copy of the mask.
+static boost::python::object GetMaskData( const std::string& layer_id )
+{
+  LayerHandle layer;
+  Core::Application::PostAndWaitEvent( boost::bind( &FindAndLockLayer, layer_id, 
+    Core::VolumeType::MASK_E, false, boost::ref( layer ) ) );
+  if ( !layer )
+  {
+    RaiseError( "Layer '" + layer_id + "' is not a mask layer or is not available." );
+  }
+
+  Core::DataBlockHandle data_block;
+  bool converted = Core::MaskDataBlockManager::Convert( static_cast< MaskLayer* >( 
+    layer.get() )->get_mask_volume()->get_mask_data_block(), data_block, 
+    Core::DataType::UCHAR_E );
+  LayerManager::DispatchUnlockLayer( layer );
+  if ( !converted || !data_block )
+  {
+    RaiseError( "Could not allocate enough memory." );
+  }
+
+  return Core::NewDataBlockBuffer( data_block, false );
+}
+
+// NEWLAYERFROMDATA:
+// Create a new data layer from a numpy array of shape ( nz, ny, nx ). The memory of an array
+// of a bytes object is used without copying it, other arrays are copied since python could 
+// change them while the layer is in use. Use getlayerdata( layerid, writable=True ) to change
+// the data of the layer afterwards. Returns the id of the new layer.
+static std::string NewLayerFromData( boost::python::object data, const std::string& name,
+  boost::python::object origin, boost::python::object spacing )
+{
+  Core::DataBlockHandle data_block;
+  std::string error;
+  if ( !Core::PythonDataBlock::New( data.ptr(), data_block, error ) )
+  {
+    RaiseError( error );
+  }
+  data_block->update_histogram();
+
+  double position[ 3 ], step[ 3 ];
+  for ( int i = 0; i < 3; ++i )
+  {
+    position[ i ] = boost::python::extract< double >( origin[ i ] );
+    step[ i ] = boost::python::extract< double >( spacing[ i ] );
+  }
+  Core::GridTransform grid_transform( data_block->get_nx(), data_block->get_ny(), 
+    data_block->get_nz(), Core::Point( position[ 0 ], position[ 1 ], position[ 2 ] ),
+    Core::Vector( step[ 0 ], 0.0, 0.0 ), Core::Vector( 0.0, step[ 1 ], 0.0 ), 
+    Core::Vector( 0.0, 0.0, step[ 2 ] ) );
+
+  LayerHandle layer;
+  Core::Application::PostAndWaitEvent( boost::bind( &CreateLayer, grid_transform, name,
+    boost::ref( layer ) ) );
+  if ( !layer )
+  {
+    RaiseError( "Could not create a new layer." );
+  }
+
+  LayerManager::DispatchInsertDataVolumeIntoLayer( boost::static_pointer_cast< DataLayer >( 
+    layer ), Core::DataVolumeHandle( new Core::DataVolume( grid_transform, data_block ) ),
+    GenerateProvenanceID() );
+  LayerManager::DispatchUnlockLayer( layer );
+
+  return layer->get_layer_id();
+}
+
+} // end namespace Seg3D
+
+namespace Core
+{
+
+void register_layer_data_python_wrapper()
+{
+  boost::python::def( "getlayerdata", &Seg3D::GetLayerData, 
+    ( boost::python::arg( "layerid" ), boost::python::arg( "writable" ) = false ) );
+  boost::python::def( "getmaskdata", &Seg3D::GetMaskData, 
+    ( boost::python::arg( "layerid" ) ) );
+  boost::python::def( "newlayerfromdata", &Seg3D::NewLayerFromData, 
+    ( boost::python::arg( "data" ), boost::python::arg( "name" ) = "Python", 
+    boost::python::arg( "origin" ) = boost::python::make_tuple( 0.0, 0.0, 0.0 ),
+    boost::python::arg( "spacing" ) = boost::python::make_tuple( 1.0, 1.0, 1.0 ) ) );
+}
+
+} // end namespace Core
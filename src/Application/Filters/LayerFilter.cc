@@ -35,10 +35,12 @@
 #include <boost/lambda/lambda.hpp>
 #include <boost/thread/mutex.hpp> 
 #include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
  
 // Core includes
 #include <Core/Utils/Log.h>
 #include <Core/Utils/Exception.h>
+#include <Core/Utils/Tracer.h>
 
 // Application includes
 #include <Application/StatusBar/StatusBar.h>
@@ -216,6 +218,8 @@ bool LayerFilterPrivate::delete_layer( LayerHandle layer )
 
 void LayerFilterPrivate::finalize()
 {
+  CORE_TRACE_SCOPE( "filter", "finalize" );
+
   bool abort = false;
   {
     boost::mutex::scoped_lock lock( this->mutex_ );
@@ -757,6 +761,34 @@ bool LayerFilter::create_cropped_large_volume_layer( const Core::GridTransform&
   return true;
 }
 
+bool LayerFilter::create_and_lock_large_volume_layer( Core::LargeVolumeSchemaHandle schema,
+  LayerHandle src_layer, LayerHandle& dst_layer )
+{
+  // Generate a new name for the filter
+  std::string name = this->get_layer_prefix() + "_" + src_layer->get_layer_name();
+
+  // Create the layer in creating mode
+  if ( !( LayerManager::CreateAndLockLargeVolumeLayer( schema, name, dst_layer, 
+    src_layer->get_meta_data(), this->private_->key_, this->private_->sandbox_ ) ) )
+  {
+    dst_layer.reset();
+    this->report_error( "Could not create large volume layer." );
+    return false;
+  }
+
+  // Record that the layer is locked
+  this->private_->created_layers_.push_back( dst_layer );
+
+  dst_layer->set_filter_handle( this->shared_from_this() );
+
+  // Hook up the abort signal from the layer
+  this->connect_abort( dst_layer );
+  this->connect_stop( dst_layer );
+
+  // Success
+  return true;
+}
+
 bool LayerFilter::create_and_lock_mask_layer_from_layer( LayerHandle src_layer, LayerHandle& dst_layer )
 {
   // Generate a new name for the filter
@@ -899,6 +931,29 @@ bool LayerFilter::dispatch_insert_data_volume_into_layer( LayerHandle layer,
   return true;
 }
 
+bool LayerFilter::dispatch_insert_large_volume_into_layer( LayerHandle layer )
+{
+  // Check whether the layer is of the right type
+  LargeVolumeLayerHandle lv_layer = boost::dynamic_pointer_cast<LargeVolumeLayer>( layer );
+  if ( ! lv_layer ) return false;
+
+  // Find the provenance id that this layer will use
+  ProvenanceID prov_id = -1;
+  
+  LayerFilterPrivate::provenance_map_type::iterator it = 
+    this->private_->provenance_ids_.find( layer.get() );
+    
+  if ( it != this->private_->provenance_ids_.end() )
+  {
+    prov_id = ( *it ).second;
+  }
+
+  // Ensure that the application thread will process this update.
+  LayerManager::DispatchInsertLargeVolumeIntoLayer( lv_layer, prov_id, 
+    this->private_->key_, this->private_->sandbox_ );
+  return true;
+}
+
 bool LayerFilter::dispatch_insert_mask_volume_into_layer( LayerHandle layer, 
   Core::MaskVolumeHandle mask )
 { 
@@ -930,16 +985,39 @@ void LayerFilter::run()
   // hence we restrict the maximum number of filters can run simultaneously.
 
   // If more filters are running wait until one of them finished computing
+  Core::TraceScope lock_trace( "filter", Core::Tracer::IsTracing() ? 
+    this->get_filter_name() + " lock wait" : std::string() );
   LayerFilterLock::Instance()->lock();
+  lock_trace.end();
   
+  boost::posix_time::ptime start_time = boost::posix_time::microsec_clock::universal_time();
   try
   {
+    CORE_TRACE_SCOPE( "filter", this->get_filter_name() + " run" );
     this->run_filter();
   }
   catch( ... )
   {
   }
   
+  // Record how long the filter ran and how many voxels it wrote, so its throughput
+  // can be monitored
+  if ( !this->check_abort() )
+  {
+    double seconds = static_cast< double >( ( boost::posix_time::microsec_clock::universal_time() 
+      - start_time ).total_microseconds() ) * 1.0e-6;
+    double voxels = 0.0;
+    for ( size_t j = 0; j < this->private_->locked_for_processing_layers_.size(); j++ )
+    {
+      Core::GridTransform grid_transform = 
+        this->private_->locked_for_processing_layers_[ j ]->get_grid_transform();
+      voxels += static_cast< double >( grid_transform.get_nx() ) * 
+        static_cast< double >( grid_transform.get_ny() ) * 
+        static_cast< double >( grid_transform.get_nz() );
+    }
+    LayerFilterLock::Instance()->record_filter_run( this->get_filter_name(), seconds, voxels );
+  }
+
   // Release the lock so another filter can start
   LayerFilterLock::Instance()->unlock();
 
@@ -160,6 +160,13 @@ public:
   bool create_cropped_large_volume_layer( const Core::GridTransform& crop_trans,
     LayerHandle src_layer, LayerHandle& dst_layer );
 
+  /// CREATE_AND_LOCK_LARGE_VOLUME_LAYER:
+  /// Create a new layer for a large volume that is computed from the source layer into the
+  /// given schema. The layer is locked in the creating state until its bricks are written.
+  /// NOTE: This function can only be run from the application thread
+  bool create_and_lock_large_volume_layer( Core::LargeVolumeSchemaHandle schema,
+    LayerHandle src_layer, LayerHandle& dst_layer );
+
   /// CREATE_AND_LOCK_MASK_LAYER_FROM_LAYER:
   /// Create a new mask layer with the same dimensions as another layer, the layer is immediately
   /// locked as it does not contain any data and will be in the creating state.
@@ -199,6 +206,11 @@ public:
   bool dispatch_insert_mask_volume_into_layer( LayerHandle layer, 
     Core::MaskVolumeHandle mask );
 
+  /// DISPATCH_INSERT_LARGE_VOLUME_INTO_LAYER:
+  /// Mark the volume of a layer created with create_and_lock_large_volume_layer as written,
+  /// once the filter has written all of its bricks.
+  bool dispatch_insert_large_volume_into_layer( LayerHandle layer );
+
   /// CREATE_UNDO_REDO_AND_RPOVENANCE_RECORD:
   /// Create a provenance record and add it to the provenance database, 
   /// and an undo record and add it to the undo stack.
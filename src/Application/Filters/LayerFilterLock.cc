@@ -27,6 +27,9 @@
  */
  
 
+// STL includes
+#include <map>
+
 // Application includes
 #include <Application/Filters/LayerFilterLock.h>
 
@@ -40,6 +43,10 @@ class LayerFilterLockPrivate
 public:
   int max_filter_count_;
   int current_filter_count_;
+  int waiting_filter_count_;
+
+  // Run statistics for each type of filter
+  std::map< std::string, LayerFilterStatistics > statistics_;
 
   boost::mutex mutex_;
   boost::condition_variable condition_variable_;
@@ -50,6 +57,7 @@ LayerFilterLock::LayerFilterLock() :
 {
   this->private_->max_filter_count_ = 4;
   this->private_->current_filter_count_ = 0;
+  this->private_->waiting_filter_count_ = 0;
 }
 
 LayerFilterLock::~LayerFilterLock()
@@ -59,11 +67,13 @@ LayerFilterLock::~LayerFilterLock()
 void LayerFilterLock::lock()
 {
   boost::unique_lock<boost::mutex> lock( this->private_->mutex_ );
+  this->private_->waiting_filter_count_++;
   while ( this->private_->current_filter_count_ >=  this->private_->max_filter_count_ )
   {
     this->private_->condition_variable_.wait( lock );
   }
   
+  this->private_->waiting_filter_count_--;
   this->private_->current_filter_count_++;
 }
 
@@ -74,4 +84,40 @@ void LayerFilterLock::unlock()
   this->private_->condition_variable_.notify_all();
 }
 
+int LayerFilterLock::get_running_filter_count()
+{
+  boost::unique_lock<boost::mutex> lock( this->private_->mutex_ );
+  return this->private_->current_filter_count_;
+}
+
+int LayerFilterLock::get_waiting_filter_count()
+{
+  boost::unique_lock<boost::mutex> lock( this->private_->mutex_ );
+  return this->private_->waiting_filter_count_;
+}
+
+void LayerFilterLock::record_filter_run( const std::string& filter_name, double seconds, 
+  double voxels )
+{
+  boost::unique_lock<boost::mutex> lock( this->private_->mutex_ );
+  LayerFilterStatistics& statistics = this->private_->statistics_[ filter_name ];
+  statistics.name_ = filter_name;
+  statistics.runs_++;
+  statistics.seconds_ += seconds;
+  statistics.voxels_ += voxels;
+}
+
+std::vector< LayerFilterStatistics > LayerFilterLock::get_filter_statistics()
+{
+  boost::unique_lock<boost::mutex> lock( this->private_->mutex_ );
+  std::vector< LayerFilterStatistics > statistics;
+  std::map< std::string, LayerFilterStatistics >::const_iterator it = 
+    this->private_->statistics_.begin();
+  for ( ; it != this->private_->statistics_.end(); ++it )
+  {
+    statistics.push_back( it->second );
+  }
+  return statistics;
+}
+
 } // end namespace Core
@@ -29,6 +29,10 @@
 #ifndef APPLICATION_FILTERS_BASEFILTERLOCK_H 
 #define APPLICATION_FILTERS_BASEFILTERLOCK_H
  
+// STL includes
+#include <string>
+#include <vector>
+
 // Boost includes
 #include <boost/smart_ptr.hpp> 
 #include <boost/utility.hpp> 
@@ -43,7 +47,33 @@ namespace Seg3D
 
 /// This class prevents too many filters running simultaneously by allowing only
 /// a certain amount of the filters to run in parallel. If too many threads are started
-/// some will have to wait until others are done.
+/// some will have to wait until others are done. It also keeps statistics on how many
+/// filters are running and how fast each type of filter processes its data.
+
+// CLASS LayerFilterStatistics
+/// Accumulated run statistics of one type of filter.
+class LayerFilterStatistics
+{
+public:
+  LayerFilterStatistics() :
+    runs_( 0 ),
+    seconds_( 0.0 ),
+    voxels_( 0.0 )
+  {
+  }
+
+  // Name of the filter
+  std::string name_;
+  
+  // Number of times the filter finished running
+  size_t runs_;
+
+  // Total time spent running the filter
+  double seconds_;
+
+  // Total number of voxels that were written by the filter
+  double voxels_;
+};
 
 class LayerFilterLockPrivate;
 typedef boost::shared_ptr<LayerFilterLockPrivate> LayerFilterLockPrivateHandle;
@@ -65,6 +95,19 @@ public:
   
   /// Unlock the resource.
   void unlock();
+
+  /// Get the number of filters that are running.
+  int get_running_filter_count();
+
+  /// Get the number of filters that are waiting for a slot.
+  int get_waiting_filter_count();
+
+  /// Add the time it took to run a filter and the number of voxels it produced to the
+  /// statistics of its filter type.
+  void record_filter_run( const std::string& filter_name, double seconds, double voxels );
+
+  /// Get the statistics of all the filters that have run.
+  std::vector< LayerFilterStatistics > get_filter_statistics();
   
   // -- internals --
 private:
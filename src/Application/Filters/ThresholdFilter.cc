@@ -26,11 +26,18 @@
  DEALINGS IN THE SOFTWARE.
 */
 
-#include <Application/Filters/ThresholdFilter.h>
+// STL includes
+#include <sstream>
+
+// Boost includes
+#include <boost/bind.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlockFilter.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
-#include <Core/DataBlock/StdDataBlock.h>
 
-#include <sstream>
+// Application includes
+#include <Application/Filters/ThresholdFilter.h>
 
 using namespace Filter;
 using namespace Seg3D;
@@ -52,57 +59,36 @@ std::string ThresholdFilter::get_layer_prefix() const
   return oss.str();
 }
 
-void ThresholdFilter::run_filter()
+void ThresholdFilter::report_progress( double progress )
 {
-  DataBlockHandle threshold_result =
-    StdDataBlock::New(this->src_layer_->get_grid_transform(), DataType::UCHAR_E );
+  this->dst_layer_->update_progress_signal_( progress );
+}
 
-  switch ( this->src_layer_->get_data_type() )
+// NOTE: The threshold is written directly into the bit plane of a new mask, hence no 
+// intermediate byte volume needs to be allocated and converted.
+void ThresholdFilter::run_filter()
+{
+  MaskDataBlockHandle threshold_mask;
+  if ( !MaskDataBlockManager::Create( this->dst_layer_->get_grid_transform(), threshold_mask ) )
   {
-    case DataType::CHAR_E:
-      this->threshold_data< signed char >( threshold_result,
-                                           this->lower_threshold_, this->upper_threshold_ );
-      break;
-    case DataType::UCHAR_E:
-      this->threshold_data< unsigned char >( threshold_result,
-                                             this->lower_threshold_, this->upper_threshold_ );
-      break;
-    case DataType::SHORT_E:
-      this->threshold_data< short >( threshold_result,
-                                     this->lower_threshold_, this->upper_threshold_ );
-      break;
-    case DataType::USHORT_E:
-      this->threshold_data< unsigned short >( threshold_result,
-                                              this->lower_threshold_, this->upper_threshold_ );
-      break;
-    case DataType::INT_E:
-      this->threshold_data< int >( threshold_result,
-                                   this->lower_threshold_, this->upper_threshold_ );
-      break;
-    case DataType::UINT_E:
-      this->threshold_data< unsigned int >( threshold_result,
-                                            this->lower_threshold_, this->upper_threshold_ );
-      break;
-    case DataType::FLOAT_E:
-      this->threshold_data< float >( threshold_result,
-                                     this->lower_threshold_, this->upper_threshold_ );
-      break;
-    case DataType::DOUBLE_E:
-      this->threshold_data< double >( threshold_result,
-                                      this->lower_threshold_, this->upper_threshold_ );
-      break;
+    this->report_error( "Could not allocate enough memory." );
+    return;
   }
 
-  if ( this->check_abort() )
+  std::vector< double > lower( 1, this->lower_threshold_ );
+  std::vector< double > upper( 1, this->upper_threshold_ );
+  std::vector< MaskDataBlockHandle > masks( 1, threshold_mask );
+
+  if ( !DataBlockFilter::ThresholdFilter( this->src_layer_->get_data_volume()->get_data_block(),
+    lower, upper, masks, boost::bind( &LayerFilter::check_abort, this ), 
+    boost::bind( &ThresholdFilter::report_progress, this, _1 ) ) )
   {
+    if ( this->check_abort() ) return;
+
+    this->report_error( "Could not threshold the data." );
     return;
   }
 
-  MaskDataBlockHandle threshold_mask;
-  MaskDataBlockManager::Convert( threshold_result,
-                                 this->dst_layer_->get_grid_transform(),
-                                 threshold_mask );
-
   if ( this->check_abort() )
   {
     return;
@@ -46,6 +46,7 @@ class ActionDeleteLayers : public LayerAction
 CORE_ACTION( 
   CORE_ACTION_TYPE( "DeleteLayers", "Delete selected layers from a group and the group if it will become empty.")
   CORE_ACTION_ARGUMENT( "layers", "A Pipe delimited list of layers to delete." )
+  CORE_ACTION_ARGUMENT_IS_INPLACE( "layers" )
   CORE_ACTION_CHANGES_PROJECT_DATA()
 )
   
@@ -30,6 +30,7 @@
 #include <limits>
 
 // Boost includes 
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 
 // Core includes
@@ -41,6 +42,8 @@
 // Application includes
 #include <Application/ProjectManager/ProjectManager.h>
 #include <Application/Layer/DataLayer.h>
+#include <Application/Layer/LayerDataLoader.h>
+#include <Application/Layer/LayerManager.h>
 #include <Application/PreferencesManager/PreferencesManager.h>
 
 namespace Seg3D
@@ -55,8 +58,27 @@ public:
   void handle_contrast_brightness_changed();
   void handle_display_value_range_changed();
 
+  // LOAD_DATA_IN_BACKGROUND:
+  // If the data of the layer is being loaded in the background, restore the layer without its
+  // data and keep it locked until the data arrives.
+  bool load_data_in_background( const boost::filesystem::path& data_path, 
+    Core::DataBlock::generation_type generation );
+
+  // FINISH_LOADING_DATA:
+  // Insert the data that was loaded in the background and unlock the layer.
+  void finish_loading_data( bool success, Core::DataVolumeHandle volume, 
+    const std::string& error );
+
+  // HANDLEDATALOADED:
+  // Called on the application thread when the data of a layer has been loaded.
+  static void HandleDataLoaded( const std::string& layer_id, Layer::filter_key_type key,
+    bool success, Core::DataVolumeHandle volume, std::string error );
+
   DataLayer* layer_;
   size_t signal_block_count_;
+
+  // Key that locks the layer while its data is being loaded, zero otherwise
+  Layer::filter_key_type load_key_;
 };
 
 void DataLayerPrivate::update_data_info()
@@ -166,6 +188,88 @@ void DataLayerPrivate::handle_display_value_range_changed()
 }
 
 
+bool DataLayerPrivate::load_data_in_background( const boost::filesystem::path& data_path, 
+  Core::DataBlock::generation_type generation )
+{
+  // The size and transform of the layer are needed right away
+  Core::GridTransform grid_transform;
+  std::string error;
+  if ( !Core::DataVolume::LoadGridTransform( data_path / 
+    ( Core::ExportToString( generation ) + ".nrrd" ), grid_transform, error ) )
+  {
+    return false;
+  }
+
+  Layer::filter_key_type key = Layer::GenerateFilterKey();
+  if ( !LayerDataLoader::Instance()->load_data_volume_in_background( data_path, generation, 
+    this->layer_->get_layer_id(), boost::bind( &DataLayerPrivate::HandleDataLoaded, 
+    this->layer_->get_layer_id(), key, _1, _2, _3 ) ) )
+  {
+    return false;
+  }
+
+  Core::DataVolume::CreateInvalidData( grid_transform, this->layer_->data_volume_ );
+  this->load_key_ = key;
+  this->layer_->add_filter_key( key );
+  this->layer_->data_state_->set( Layer::CREATING_C );
+  return true;
+}
+
+void DataLayerPrivate::finish_loading_data( bool success, Core::DataVolumeHandle volume, 
+  const std::string& error )
+{
+  Layer::filter_key_type key = this->load_key_;
+  this->load_key_ = 0;
+  LayerHandle layer = LayerManager::FindLayer( this->layer_->get_layer_id() );
+
+  if ( !success )
+  {
+    CORE_LOG_ERROR( error );
+    // NOTE: The layer is deleted, as it would not have been restored if its data had been 
+    // loaded up front. This is posted as the layer may be saved right now.
+    if ( layer )
+    {
+      Core::Application::PostEvent( boost::bind( &LayerManager::DispatchUnlockOrDeleteLayer,
+        layer, key, -1 ) );
+    }
+    return;
+  }
+
+  // Keep the transform of the placeholder, as the layer group may have adjusted it
+  Core::GridTransform grid_transform = this->layer_->get_grid_transform();
+  {
+    Layer::lock_type lock( Layer::GetMutex() );
+    volume->register_data( this->layer_->generation_state_->get() );
+    this->layer_->data_volume_ = volume;
+  }
+  this->layer_->set_grid_transform( grid_transform, true );
+  this->update_data_info();
+  this->update_display_value_range();
+
+  if ( layer )
+  {
+    LayerManager::Instance()->layer_volume_changed_signal_( layer );
+    LayerManager::Instance()->layers_changed_signal_();
+    LayerManager::DispatchUnlockLayer( layer, key, -1 );
+  }
+  else
+  {
+    this->layer_->remove_filter_key( key );
+    this->layer_->data_state_->set( Layer::AVAILABLE_C );
+  }
+}
+
+void DataLayerPrivate::HandleDataLoaded( const std::string& layer_id, Layer::filter_key_type key,
+  bool success, Core::DataVolumeHandle volume, std::string error )
+{
+  DataLayerHandle layer = boost::dynamic_pointer_cast< DataLayer >( 
+    LayerManager::FindLayer( layer_id ) );
+
+  // NOTE: The data may have been inserted already when the layer was saved
+  if ( !layer || layer->private_->load_key_ != key ) return;
+  layer->private_->finish_loading_data( success, volume, error );
+}
+
 DataLayer::DataLayer( const std::string& name, const Core::DataVolumeHandle& volume ) :
   Layer( name, !( volume->is_valid() ) ),
   data_volume_( volume ),
@@ -174,6 +278,7 @@ DataLayer::DataLayer( const std::string& name, const Core::DataVolumeHandle& vol
   this->data_volume_->register_data();
   this->private_->layer_ = this;
   this->private_->signal_block_count_ = 0;
+  this->private_->load_key_ = 0;
   this->initialize_states();
   this->private_->update_display_value_range();
 }
@@ -184,6 +289,7 @@ DataLayer::DataLayer( const std::string& state_id ) :
 {
   this->private_->layer_ = this;
   this->private_->signal_block_count_ = 0;
+  this->private_->load_key_ = 0;
   this->initialize_states();
 }
 
@@ -348,6 +454,18 @@ bool DataLayer::set_data_volume( Core::DataVolumeHandle data_volume )
 
 bool DataLayer::pre_save_states( Core::StateIO& state_io )
 {
+  // Data that is still being loaded in the background is needed now
+  if ( this->private_->load_key_ != 0 )
+  {
+    Core::DataVolumeHandle volume;
+    std::string error;
+    bool success = LayerDataLoader::Instance()->load_data_volume( ProjectManager::Instance()->
+      get_current_project()->get_project_data_path(), this->generation_state_->get(), 
+      volume, error );
+    this->private_->finish_loading_data( success, volume, error );
+    if ( !success ) return false;
+  }
+
   if ( this->data_volume_ )
   {
     long long generation_number = this->data_volume_->get_generation();
@@ -387,16 +505,22 @@ bool DataLayer::post_load_states( const Core::StateIO& state_io )
 {
   if ( this->generation_state_->get() >= 0 )
   {
-    std::string generation = this->generation_state_->export_to_string() + ".nrrd";
-    boost::filesystem::path volume_path = ProjectManager::Instance()->get_current_project()->
-      get_project_data_path() / generation;
+    boost::filesystem::path data_path = ProjectManager::Instance()->get_current_project()->
+      get_project_data_path();
     std::string error;
     
-    if( Core::DataVolume::LoadDataVolume( volume_path, this->data_volume_, error ) )
+    // NOTE: If the data is being loaded in the background, the layer is restored right away 
+    // and receives its data later
+    if ( this->private_->load_data_in_background( data_path, this->generation_state_->get() ) ||
+      LayerDataLoader::Instance()->load_data_volume( data_path, 
+      this->generation_state_->get(), this->data_volume_, error ) )
     {
-      this->data_volume_->register_data( this->generation_state_->get() );
-      this->private_->update_data_info();
-      this->private_->update_display_value_range();
+      if ( this->private_->load_key_ == 0 )
+      {
+        this->data_volume_->register_data( this->generation_state_->get() );
+        this->private_->update_data_info();
+        this->private_->update_display_value_range();
+      }
 
       // If the layer didn't have a valid provenance ID, generate one
       if ( this->provenance_id_state_->get() < 0 )
@@ -59,6 +59,9 @@ public:
   LargeVolumeLayer* layer_;
   Core::LargeVolumeHandle volume_;
   size_t signal_block_count_;
+
+  // Whether the bricks of the volume are still being written
+  bool creating_;
 };
 
 void LargeVolumeLayerPrivate::update_data_info()
@@ -168,13 +171,15 @@ void LargeVolumeLayerPrivate::handle_display_value_range_changed()
 }
 
 
-LargeVolumeLayer::LargeVolumeLayer( const std::string& name, Core::LargeVolumeSchemaHandle schema ) :
-  Layer( name ),
+LargeVolumeLayer::LargeVolumeLayer( const std::string& name, Core::LargeVolumeSchemaHandle schema,
+  bool creating ) :
+  Layer( name, creating ),
   private_( new LargeVolumeLayerPrivate )
 {
   this->private_->volume_ = Core::LargeVolumeHandle( new Core::LargeVolume( schema ) );
   this->private_->layer_ = this;
   this->private_->signal_block_count_ = 0;
+  this->private_->creating_ = creating;
   this->initialize_states();
   this->dir_name_state_->set( schema->get_dir().string() );
   this->private_->update_display_value_range();
@@ -188,6 +193,7 @@ LargeVolumeLayer::LargeVolumeLayer( const std::string& name, Core::LargeVolumeSc
   this->private_->volume_ = Core::LargeVolumeHandle( new Core::LargeVolume( schema, crop_trans ) );
   this->private_->layer_ = this;
   this->private_->signal_block_count_ = 0;
+  this->private_->creating_ = false;
   this->initialize_states();
   this->dir_name_state_->set( schema->get_dir().string() );
   this->crop_volume_state_->set( true );
@@ -201,6 +207,7 @@ LargeVolumeLayer::LargeVolumeLayer( const std::string& state_id ) :
 {
   this->private_->layer_ = this;
   this->private_->signal_block_count_ = 0;
+  this->private_->creating_ = false;
   this->initialize_states();
 }
 
@@ -300,7 +307,9 @@ size_t LargeVolumeLayer::get_byte_size() const
 
 bool LargeVolumeLayer::has_valid_data() const
 {
-  return true;
+  Layer::lock_type lock( Layer::GetMutex() );
+
+  return !this->private_->creating_;
 }
 
 Core::VolumeHandle LargeVolumeLayer::get_volume() const
@@ -359,5 +368,16 @@ Core::LargeVolumeSchemaHandle LargeVolumeLayer::get_schema() const
   return this->private_->volume_->get_schema();
 }
 
+void LargeVolumeLayer::finish_creating()
+{
+  {
+    Layer::lock_type lock( Layer::GetMutex() );
+    this->private_->creating_ = false;
+  }
+
+  this->private_->update_data_info();
+  this->private_->update_display_value_range();
+}
+
 } // end namespace Seg3D
 
@@ -56,7 +56,8 @@ class LargeVolumeLayer : public Layer
   // -- constructor/destructor --
 public:
 
-  LargeVolumeLayer( const std::string& name, Core::LargeVolumeSchemaHandle schema );
+  LargeVolumeLayer( const std::string& name, Core::LargeVolumeSchemaHandle schema, 
+    bool creating = false );
   LargeVolumeLayer( const std::string& name, Core::LargeVolumeSchemaHandle schema, const Core::GridTransform& crop_trans );
   LargeVolumeLayer( const std::string& state_id );
   virtual ~LargeVolumeLayer();
@@ -98,6 +99,12 @@ public:
   // Returns the underlying schema.
   Core::LargeVolumeSchemaHandle get_schema() const;
 
+  /// FINISH_CREATING:
+  /// Mark a layer that was created while the bricks of its volume were still being written
+  /// as complete, and update its value range from the schema.
+  /// NOTE: This function can only be called from the Application thread.
+  void finish_creating();
+
   // -- state variables --
 public:
 
@@ -26,8 +26,12 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+// STL includes
+#include <algorithm>
+
 // Core includes
 #include <Core/Utils/Exception.h>
+#include <Core/Utils/StringUtil.h>
 
 // Application includes
 #include <Application/Layer/Layer.h>
@@ -197,4 +201,105 @@ std::string LayerAction::export_params_to_provenance_string( bool single_input )
   return action_params;
 }
 
+std::vector< std::string > LayerAction::get_input_layer_ids() const
+{
+  std::vector< std::string > layer_ids;
+
+  size_t num_params = this->num_params();
+  for ( size_t j = 0; j < num_params; j++ )
+  {
+    Core::ActionParameterBase* param = this->get_param( j );
+    if ( dynamic_cast< LayerActionLayerIDList* >( param ) )
+    {
+      std::vector< std::string > layer_id_list;
+      Core::ImportFromString( param->export_to_string(), layer_id_list );
+      layer_ids.insert( layer_ids.end(), layer_id_list.begin(), layer_id_list.end() );
+    }
+    else if ( dynamic_cast< LayerActionLayerID* >( param ) )
+    {
+      layer_ids.push_back( param->export_to_string() );
+    }
+  }
+
+  return layer_ids;
+}
+
+std::vector< std::string > LayerAction::get_modified_layer_ids() const
+{
+  // A filter that replaces its input needs write access to all of its input layers
+  int replace_index = this->get_key_index( "replace" );
+  if ( replace_index >= 0 && static_cast< size_t >( replace_index ) < this->num_params() )
+  {
+    bool replace = false;
+    if ( Core::ImportFromString( this->get_param( replace_index )->export_to_string(), 
+      replace ) && replace )
+    {
+      return this->get_input_layer_ids();
+    }
+  }
+
+  std::vector< std::string > layer_ids;
+
+  Core::ActionInfoHandle action_info = this->get_action_info();
+  size_t num_params = this->num_params();
+  for ( size_t j = 0; j < num_params; j++ )
+  {
+    std::vector< std::string > properties = action_info->get_key_properties( j );
+    if ( std::find( properties.begin(), properties.end(), "inplace" ) == properties.end() )
+    {
+      continue;
+    }
+
+    Core::ActionParameterBase* param = this->get_param( j );
+    if ( dynamic_cast< LayerActionLayerIDList* >( param ) )
+    {
+      std::vector< std::string > layer_id_list;
+      Core::ImportFromString( param->export_to_string(), layer_id_list );
+      layer_ids.insert( layer_ids.end(), layer_id_list.begin(), layer_id_list.end() );
+    }
+    else if ( dynamic_cast< LayerActionLayerID* >( param ) )
+    {
+      layer_ids.push_back( param->export_to_string() );
+    }
+  }
+
+  return layer_ids;
+}
+
+bool LayerAction::replace_layer_ids( const layer_id_map_type& layer_id_map, 
+  std::string& error )
+{
+  size_t num_params = this->num_params();
+  for ( size_t j = 0; j < num_params; j++ )
+  {
+    Core::ActionParameterBase* param = this->get_param( j );
+    if ( dynamic_cast< LayerActionLayerIDList* >( param ) )
+    {
+      std::vector< std::string > layer_id_list;
+      Core::ImportFromString( param->export_to_string(), layer_id_list );
+      std::vector< std::string > new_layer_id_list;
+      for ( size_t k = 0; k < layer_id_list.size(); k++ )
+      {
+        std::vector< std::string > layer_ids = layer_id_map( layer_id_list[ k ] );
+        new_layer_id_list.insert( new_layer_id_list.end(), layer_ids.begin(), layer_ids.end() );
+      }
+      param->import_from_string( Core::ExportToString( new_layer_id_list ) );
+    }
+    else if ( dynamic_cast< LayerActionLayerID* >( param ) )
+    {
+      std::string layer_id = param->export_to_string();
+      std::vector< std::string > layer_ids = layer_id_map( layer_id );
+      if ( layer_ids.size() != 1 )
+      {
+        error = "Parameter '" + this->get_key( j ) + "' takes a single layer, but '" + 
+          layer_id + "' refers to " + Core::ExportToString( layer_ids.size() ) + " layers.";
+        return false;
+      }
+      param->import_from_string( layer_ids[ 0 ] );
+    }
+  }
+
+  return true;
+}
+
 } // end namespace Seg3D
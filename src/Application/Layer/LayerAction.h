@@ -29,6 +29,9 @@
 #ifndef APPLICATION_LAYER_LAYERACTION_H
 #define APPLICATION_LAYER_LAYERACTION_H 
  
+// Boost includes
+#include <boost/function.hpp>
+
 // Core includes 
 #include <Core/Action/Action.h> 
 
@@ -114,6 +117,25 @@ public:
   /// Export the action parameters to a string and mark the provenance inputs
   /// with special placeholders.
   std::string export_params_to_provenance_string( bool single_input = false ) const;
+
+  // -- Layer inputs --
+public:
+  /// GET_INPUT_LAYER_IDS:
+  /// Get the layer ids that were assigned to the layer and layer list parameters of the action.
+  std::vector< std::string > get_input_layer_ids() const;
+
+  /// GET_MODIFIED_LAYER_IDS:
+  /// Get the layer ids whose data the action changes in place. These are all the input layers
+  /// of a filter that replaces its input, and the layer parameters that are marked as in place.
+  std::vector< std::string > get_modified_layer_ids() const;
+
+  /// REPLACE_LAYER_IDS:
+  /// Replace each layer id of the layer and layer list parameters with the layer ids the 
+  /// function maps it to. Other parameters are left alone. Returns false if a layer parameter
+  /// would not get exactly one layer.
+  typedef boost::function< std::vector< std::string > ( const std::string& ) > 
+    layer_id_map_type;
+  bool replace_layer_ids( const layer_id_map_type& layer_id_map, std::string& error );
   
   // -- internals --
 private:  
@@ -0,0 +1,557 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// Core includes
+#include <Core/Action/ActionContext.h>
+#include <Core/Action/ActionDispatcher.h>
+#include <Core/Action/ActionFactory.h>
+#include <Core/Application/Application.h>
+#include <Core/Utils/Log.h>
+#include <Core/Utils/StringUtil.h>
+
+// Application includes
+#include <Application/Layer/Layer.h>
+#include <Application/Layer/LayerActionBatch.h>
+#include <Application/Layer/LayerActionBatchGraph.h>
+#include <Application/Layer/LayerAction.h>
+#include <Application/Layer/LayerManager.h>
+#include <Application/Layer/LayerUndoBufferItem.h>
+#include <Application/UndoBuffer/UndoBuffer.h>
+
+namespace Seg3D
+{
+
+// CLASS LayerActionBatchContext:
+// Context for the actions of a batch. The actions are run as if they came from a script, so
+// that filters report the notifier that is triggered once they are done.
+
+class LayerActionBatchContext : public Core::ActionContext
+{
+public:
+  LayerActionBatchContext() {}
+  virtual ~LayerActionBatchContext() {}
+
+  virtual void report_error( const std::string& error )
+  {
+    this->error_msg_ = error;
+  }
+
+  virtual Core::ActionSource source() const
+  {
+    return Core::ActionSource::SCRIPT_E;
+  }
+};
+
+// CLASS LayerActionBatchStep:
+// The action of one step of the batch. The order of the steps and their output layers are
+// tracked by the LayerActionBatchGraph.
+
+class LayerActionBatchStep
+{
+public:
+  LayerActionBatchStep() :
+    memory_( 0 )
+  {
+  }
+
+  std::string action_string_;
+
+  // The action, created when the step is ready to run
+  Core::ActionHandle action_;
+  // Estimate of the memory the step needs
+  long long memory_;
+};
+
+// PARSELAYERIDS:
+// Split the result of an action, which is a layer id or a list of layer ids, into layer ids.
+static void ParseLayerIDs( const std::string& str, bool is_list, std::vector< std::string >& ids )
+{
+  ids.clear();
+  if ( is_list )
+  {
+    Core::ImportFromString( str, ids );
+  }
+  else if ( !str.empty() )
+  {
+    ids.push_back( str );
+  }
+}
+
+// GETINPUTLAYERIDS:
+// Get the layer ids the action takes as input. Actions that are not layer actions have none.
+static std::vector< std::string > GetInputLayerIDs( Core::ActionHandle action )
+{
+  LayerAction* layer_action = dynamic_cast< LayerAction* >( action.get() );
+  if ( !layer_action ) return std::vector< std::string >();
+  return layer_action->get_input_layer_ids();
+}
+
+// GETMODIFIEDLAYERIDS:
+// Get the layer ids the action changes in place. Actions that are not layer actions have none.
+static std::vector< std::string > GetModifiedLayerIDs( Core::ActionHandle action )
+{
+  LayerAction* layer_action = dynamic_cast< LayerAction* >( action.get() );
+  if ( !layer_action ) return std::vector< std::string >();
+  return layer_action->get_modified_layer_ids();
+}
+
+// ESTIMATEMEMORY:
+// Estimate the memory a step needs from the size of its input layers. This needs to run on the
+// application thread.
+static void EstimateMemory( Core::ActionHandle action, long long& memory )
+{
+  memory = 0;
+  std::vector< std::string > layer_ids = GetInputLayerIDs( action );
+  for ( size_t j = 0; j < layer_ids.size(); j++ )
+  {
+    LayerHandle layer = LayerManager::FindLayer( layer_ids[ j ] );
+    if ( layer ) memory += static_cast< long long >( layer->get_byte_size() );
+  }
+}
+
+// FINDMISSINGLAYERS:
+// Find the layers that no longer exist or have no valid data. This needs to run on the 
+// application thread, so that the layer deletions a failed filter posts have been processed.
+static void FindMissingLayers( const std::vector< std::string >& layer_ids, 
+  std::vector< std::string >& missing_layer_ids )
+{
+  missing_layer_ids.clear();
+  for ( size_t j = 0; j < layer_ids.size(); j++ )
+  {
+    LayerHandle layer = LayerManager::FindLayer( layer_ids[ j ] );
+    if ( !layer || !layer->has_valid_data() ) missing_layer_ids.push_back( layer_ids[ j ] );
+  }
+}
+
+// USESLAYERS:
+// Whether an undo item holds on to any of the layers.
+static bool UsesLayers( UndoBufferItemHandle item, const std::vector< LayerHandle >& layers )
+{
+  LayerUndoBufferItemHandle layer_item = boost::dynamic_pointer_cast< LayerUndoBufferItem >( 
+    item );
+  if ( !layer_item ) return false;
+  for ( size_t j = 0; j < layers.size(); j++ )
+  {
+    if ( layer_item->uses_layer( layers[ j ] ) ) return true;
+  }
+  return false;
+}
+
+class LayerActionBatchPrivate
+{
+public:
+  LayerActionBatchPrivate() :
+    max_running_steps_( 0 ),
+    memory_limit_( 0 ),
+    num_running_( 0 ),
+    memory_in_use_( 0 )
+  {
+  }
+
+  // PREPARE_STEP:
+  // Create the action of a step that has all its inputs and estimate its memory.
+  bool prepare_step( size_t index, std::string& error );
+
+  // START_STEP:
+  // Post the action of a step and have a thread wait for it to finish. 
+  bool start_step( size_t index, std::string& error );
+
+  // WAIT_FOR_STEP:
+  // Wait for the notifier of a step and hand the step back to the run loop.
+  void wait_for_step( size_t index, Core::NotifierHandle notifier, bool retry );
+
+  // FINISH_STEP:
+  // Record that a step is done, make the steps waiting for it ready and delete the 
+  // intermediate layers that are no longer needed.
+  bool finish_step( size_t index, std::string& error );
+
+  // DELETE_LAYERS:
+  // Delete the layers the batch no longer needs. This needs to run on the application thread.
+  // NOTE: Deleting them with ActionDeleteLayers would keep them in its undo item, and the undo
+  // items of the steps that created or changed them keep them as well. Those items are 
+  // dropped, so the memory of the layers is released, and those steps can no longer be undone.
+  static void DeleteLayers( const std::vector< std::string >& layer_ids );
+
+public:
+  LayerActionBatchGraph graph_;
+  std::vector< LayerActionBatchStep > steps_;
+
+  int max_running_steps_;
+  long long memory_limit_;
+
+  // -- run state --
+  // Steps that have all their inputs, in the order they were added
+  std::vector< size_t > ready_;
+  int num_running_;
+  long long memory_in_use_;
+  boost::thread_group wait_threads_;
+
+  // Steps handed back by the wait threads, protected by the mutex
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+  std::vector< size_t > finished_;
+  std::vector< size_t > retry_;
+};
+
+bool LayerActionBatchPrivate::prepare_step( size_t index, std::string& error )
+{
+  LayerActionBatchStep& step = this->steps_[ index ];
+  if ( step.action_ ) return true;
+
+  std::string action_error;
+  std::string usage;
+  if ( !Core::ActionFactory::CreateAction( step.action_string_, step.action_, action_error, 
+    usage ) )
+  {
+    error = "Step '" + this->graph_.get_step_name( index ) + "': " + action_error;
+    return false;
+  }
+
+  // Only the layer parameters can refer to the output layers of other steps
+  LayerAction* layer_action = dynamic_cast< LayerAction* >( step.action_.get() );
+  if ( layer_action && !layer_action->replace_layer_ids( boost::bind( 
+    &LayerActionBatchGraph::substitute_outputs, &this->graph_, _1 ), action_error ) )
+  {
+    step.action_.reset();
+    error = "Step '" + this->graph_.get_step_name( index ) + "': " + action_error;
+    return false;
+  }
+
+  Core::Application::PostAndWaitEvent( boost::bind( &EstimateMemory, step.action_, 
+    boost::ref( step.memory_ ) ) );
+  return true;
+}
+
+bool LayerActionBatchPrivate::start_step( size_t index, std::string& error )
+{
+  LayerActionBatchStep& step = this->steps_[ index ];
+
+  Core::ActionContextHandle context( new LayerActionBatchContext );
+  Core::ActionDispatcher::PostAndWaitAction( step.action_, context );
+  Core::NotifierHandle notifier = context->get_resource_notifier();
+
+  if ( context->is_success() )
+  {
+    // Only the results of layer actions are layer ids
+    Core::ActionResultHandle result = context->get_result();
+    if ( result && dynamic_cast< LayerAction* >( step.action_.get() ) )
+    {
+      std::string result_string = result->export_to_string();
+      std::vector< std::string > output_layer_ids;
+      ParseLayerIDs( result_string, !result_string.empty() && result_string[ 0 ] == '[', 
+        output_layer_ids );
+      this->graph_.set_output_layer_ids( index, output_layer_ids );
+    }
+  }
+  else if ( !context->is_unavailable() || !notifier )
+  {
+    error = "Step '" + this->graph_.get_step_name( index ) + "' failed: " + 
+      context->get_error_message();
+    return false;
+  }
+
+  this->num_running_++;
+  this->memory_in_use_ += step.memory_;
+
+  if ( notifier )
+  {
+    this->wait_threads_.create_thread( boost::bind( &LayerActionBatchPrivate::wait_for_step, 
+      this, index, notifier, !context->is_success() ) );
+  }
+  else
+  {
+    // The action finished while it was being posted
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    this->finished_.push_back( index );
+  }
+  return true;
+}
+
+void LayerActionBatchPrivate::wait_for_step( size_t index, Core::NotifierHandle notifier,
+  bool retry )
+{
+  notifier->wait();
+
+  boost::mutex::scoped_lock lock( this->mutex_ );
+  if ( retry ) this->retry_.push_back( index );
+  else this->finished_.push_back( index );
+  this->condition_.notify_all();
+}
+
+bool LayerActionBatchPrivate::finish_step( size_t index, std::string& error )
+{
+  this->steps_[ index ].action_.reset();
+
+  // A filter that failed or was aborted removes its output layers
+  std::vector< std::string > output_layer_ids = this->graph_.get_output_layer_ids( index );
+  std::vector< std::string > missing_layer_ids;
+  Core::Application::PostAndWaitEvent( boost::bind( &FindMissingLayers, 
+    boost::cref( output_layer_ids ), boost::ref( missing_layer_ids ) ) );
+  if ( !missing_layer_ids.empty() )
+  {
+    error = "Step '" + this->graph_.get_step_name( index ) + "' did not generate layer '" + 
+      missing_layer_ids[ 0 ] + "'.";
+    return false;
+  }
+
+  std::vector< size_t > ready;
+  std::vector< std::string > unused_layer_ids;
+  this->graph_.finish_step( index, ready, unused_layer_ids );
+
+  for ( size_t j = 0; j < ready.size(); j++ )
+  {
+    this->ready_.insert( std::lower_bound( this->ready_.begin(), this->ready_.end(), 
+      ready[ j ] ), ready[ j ] );
+  }
+
+  if ( !unused_layer_ids.empty() )
+  {
+    Core::Application::PostAndWaitEvent( boost::bind( &FindMissingLayers, 
+      boost::cref( unused_layer_ids ), boost::ref( missing_layer_ids ) ) );
+
+    std::vector< std::string > layer_ids;
+    for ( size_t j = 0; j < unused_layer_ids.size(); j++ )
+    {
+      if ( std::find( missing_layer_ids.begin(), missing_layer_ids.end(), 
+        unused_layer_ids[ j ] ) == missing_layer_ids.end() )
+      {
+        layer_ids.push_back( unused_layer_ids[ j ] );
+      }
+    }
+    
+    if ( !layer_ids.empty() )
+    {
+      Core::Application::PostAndWaitEvent( boost::bind( 
+        &LayerActionBatchPrivate::DeleteLayers, boost::cref( layer_ids ) ) );
+    }
+  }
+
+  return true;
+}
+
+void LayerActionBatchPrivate::DeleteLayers( const std::vector< std::string >& layer_ids )
+{
+  std::vector< LayerHandle > layers;
+  for ( size_t j = 0; j < layer_ids.size(); j++ )
+  {
+    LayerHandle layer = LayerManager::FindLayer( layer_ids[ j ] );
+    if ( layer ) layers.push_back( layer );
+  }
+  if ( layers.empty() ) return;
+
+  LayerManager::Instance()->delete_layers( layers );
+  UndoBuffer::Instance()->remove_items( boost::bind( &UsesLayers, _1, 
+    boost::cref( layers ) ) );
+}
+
+LayerActionBatch::LayerActionBatch() :
+  private_( new LayerActionBatchPrivate )
+{
+}
+
+LayerActionBatch::~LayerActionBatch()
+{
+}
+
+bool LayerActionBatch::add_step( const std::string& name, const std::string& action_string,
+  bool keep, std::string& error )
+{
+  Core::ActionHandle action;
+  std::string action_error;
+  std::string usage;
+  if ( !Core::ActionFactory::CreateAction( action_string, action, action_error, usage ) )
+  {
+    error = "Step '" + name + "': " + action_error + "\nUsage: " + usage;
+    return false;
+  }
+
+  // Filters that replace their input and tools that edit a layer in place change the layers
+  // they use, which orders them with respect to the other steps that use the same layers.
+  if ( !this->private_->graph_.add_step( name, GetInputLayerIDs( action ), 
+    GetModifiedLayerIDs( action ), keep, error ) )
+  {
+    return false;
+  }
+
+  LayerActionBatchStep step;
+  step.action_string_ = action_string;
+  this->private_->steps_.push_back( step );
+  return true;
+}
+
+void LayerActionBatch::set_max_running_steps( int max_running_steps )
+{
+  this->private_->max_running_steps_ = max_running_steps;
+}
+
+void LayerActionBatch::set_memory_limit( long long memory_limit )
+{
+  this->private_->memory_limit_ = memory_limit;
+}
+
+bool LayerActionBatch::run( std::string& error )
+{
+  if ( Core::Application::IsApplicationThread() )
+  {
+    error = "A batch cannot be run on the application thread.";
+    return false;
+  }
+
+  LayerActionBatchPrivateHandle batch = this->private_;
+
+  int max_running_steps = batch->max_running_steps_;
+  if ( max_running_steps <= 0 ) 
+  {
+    max_running_steps = std::max( 1, static_cast< int >( boost::thread::hardware_concurrency() ) );
+  }
+
+  long long memory_limit = batch->memory_limit_;
+  if ( memory_limit <= 0 )
+  {
+    Core::Application* application = Core::Application::Instance();
+    memory_limit = application->get_total_addressable_physical_memory() - 
+      application->get_my_physical_memory_used();
+  }
+
+  batch->finished_.clear();
+  batch->retry_.clear();
+  batch->num_running_ = 0;
+  batch->memory_in_use_ = 0;
+
+  batch->graph_.reset( batch->ready_ );
+  for ( size_t j = 0; j < batch->steps_.size(); j++ )
+  {
+    batch->steps_[ j ].action_.reset();
+  }
+
+  error.clear();
+  size_t num_done = 0;
+  while ( num_done < batch->steps_.size() )
+  {
+    // Start the ready steps in order for as far as the limits allow. A step that does not fit
+    // in memory does not hold back smaller steps behind it.
+    std::vector< size_t >::iterator it = batch->ready_.begin();
+    while ( error.empty() && it != batch->ready_.end() && 
+      batch->num_running_ < max_running_steps )
+    {
+      if ( !batch->prepare_step( *it, error ) ) break;
+
+      if ( batch->num_running_ > 0 && 
+        batch->memory_in_use_ + batch->steps_[ *it ].memory_ > memory_limit )
+      {
+        ++it;
+        continue;
+      }
+
+      if ( !batch->start_step( *it, error ) ) break;
+      it = batch->ready_.erase( it );
+    }
+
+    if ( batch->num_running_ == 0 ) 
+    {
+      if ( error.empty() ) 
+      {
+        error = "The batch has steps that can never run.";
+      }
+      break;
+    }
+
+    std::vector< size_t > finished;
+    std::vector< size_t > retry;
+    {
+      boost::mutex::scoped_lock lock( batch->mutex_ );
+      while ( batch->finished_.empty() && batch->retry_.empty() )
+      {
+        batch->condition_.wait( lock );
+      }
+      finished.swap( batch->finished_ );
+      retry.swap( batch->retry_ );
+    }
+
+    for ( size_t j = 0; j < retry.size(); j++ )
+    {
+      batch->num_running_--;
+      batch->memory_in_use_ -= batch->steps_[ retry[ j ] ].memory_;
+      batch->ready_.insert( std::lower_bound( batch->ready_.begin(), batch->ready_.end(), 
+        retry[ j ] ), retry[ j ] );
+    }
+
+    for ( size_t j = 0; j < finished.size(); j++ )
+    {
+      batch->num_running_--;
+      batch->memory_in_use_ -= batch->steps_[ finished[ j ] ].memory_;
+      num_done++;
+
+      std::string step_error;
+      if ( !batch->finish_step( finished[ j ], step_error ) && error.empty() ) 
+      {
+        error = step_error;
+      }
+    }
+  }
+
+  // Wait for the steps that are still running after an error
+  while ( batch->num_running_ > 0 )
+  {
+    boost::mutex::scoped_lock lock( batch->mutex_ );
+    while ( batch->finished_.empty() && batch->retry_.empty() )
+    {
+      batch->condition_.wait( lock );
+    }
+    batch->num_running_ -= static_cast< int >( batch->finished_.size() + batch->retry_.size() );
+    batch->finished_.clear();
+    batch->retry_.clear();
+  }
+
+  batch->wait_threads_.join_all();
+
+  if ( !error.empty() )
+  {
+    CORE_LOG_ERROR( error );
+    return false;
+  }
+  return true;
+}
+
+std::vector< std::string > LayerActionBatch::get_output_layer_ids( const std::string& name ) const
+{
+  int index = this->private_->graph_.find_step( name );
+  if ( index < 0 ) return std::vector< std::string >();
+  return this->private_->graph_.get_output_layer_ids( static_cast< size_t >( index ) );
+}
+
+} // end namespace Seg3D
@@ -0,0 +1,111 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef APPLICATION_LAYER_LAYERACTIONBATCH_H
+#define APPLICATION_LAYER_LAYERACTIONBATCH_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Boost includes
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+namespace Seg3D
+{
+
+class LayerActionBatch;
+typedef boost::shared_ptr< LayerActionBatch > LayerActionBatchHandle;
+
+class LayerActionBatchPrivate;
+typedef boost::shared_ptr< LayerActionBatchPrivate > LayerActionBatchPrivateHandle;
+
+// CLASS LayerActionBatch:
+/// A pipeline of layer actions that is run as a dependency graph instead of one action after
+/// the other. Each step is an action string as used by scripts, in which the layer parameters 
+/// can refer to the output layers of earlier steps as $name. A step runs after the earlier 
+/// steps that generated or changed its layers, and a step that changes a layer in place runs 
+/// after the earlier steps that use that layer. Steps whose inputs are ready run concurrently, 
+/// as long as the number of running steps and the size of their input layers stay within the 
+/// limits of the batch.
+
+class LayerActionBatch : public boost::noncopyable
+{
+  // -- constructor/destructor --
+public:
+  LayerActionBatch();
+  virtual ~LayerActionBatch();
+
+  // -- building the batch --
+public:
+  /// ADD_STEP:
+  /// Add an action to the batch. Later steps can use the output layers of this step as $name
+  /// in their layer list parameters, or in a layer parameter if the step has a single output.
+  /// Unless keep is set, the output layers are deleted as soon as the last step that uses them
+  /// has finished, together with the undo items that refer to them. Outputs that are not used
+  /// by any step are always kept. Returns false if the action cannot be created or refers to
+  /// an unknown step.
+  bool add_step( const std::string& name, const std::string& action_string, bool keep, 
+    std::string& error );
+
+  /// SET_MAX_RUNNING_STEPS:
+  /// Set the number of steps that can run at the same time. Zero, the default, uses the number
+  /// of cores.
+  void set_max_running_steps( int max_running_steps );
+
+  /// SET_MEMORY_LIMIT:
+  /// Set the number of bytes the input layers of the running steps can take up together. Zero, 
+  /// the default, uses the physical memory that is free when the batch starts. A single step
+  /// is always allowed to run.
+  void set_memory_limit( long long memory_limit );
+
+  // -- running the batch --
+public:
+  /// RUN:
+  /// Run all the steps of the batch. If a step fails, no new steps are started and the error
+  /// is returned once the running steps have finished.
+  /// NOTE: This function blocks until the batch is done and should not be called on the 
+  /// application thread.
+  bool run( std::string& error );
+
+  /// GET_OUTPUT_LAYER_IDS:
+  /// Get the ids of the layers a step generated.
+  std::vector< std::string > get_output_layer_ids( const std::string& name ) const;
+
+private:
+  LayerActionBatchPrivateHandle private_;
+};
+
+} // end namespace Seg3D
+
+#endif
@@ -0,0 +1,336 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <map>
+
+// Application includes
+#include <Application/Layer/LayerActionBatchGraph.h>
+
+namespace Seg3D
+{
+
+// CLASS LayerActionBatchGraphStep:
+// The bookkeeping for one step of the graph.
+
+class LayerActionBatchGraphStep
+{
+public:
+  LayerActionBatchGraphStep() :
+    keep_( false ),
+    num_consumers_( 0 ),
+    num_pending_dependencies_( 0 ),
+    done_( false )
+  {
+  }
+
+  std::string name_;
+  bool keep_;
+
+  // The steps whose output layers this step uses
+  std::vector< size_t > inputs_;
+  // The steps that use the output layers of this step
+  std::vector< size_t > consumers_;
+  // Number of consumers that have not finished yet
+  size_t num_consumers_;
+
+  // The steps that need to finish before this step can run
+  std::vector< size_t > dependencies_;
+  // The steps that wait for this step
+  std::vector< size_t > dependents_;
+  // Number of dependencies that have not finished yet
+  size_t num_pending_dependencies_;
+
+  std::vector< std::string > output_layer_ids_;
+  bool done_;
+};
+
+// CLASS LayerActionBatchGraphLayer:
+// The steps that accessed a layer so far.
+
+class LayerActionBatchGraphLayer
+{
+public:
+  LayerActionBatchGraphLayer() :
+    has_writer_( false ),
+    writer_( 0 )
+  {
+  }
+
+  // The last step that changed the layer
+  bool has_writer_;
+  size_t writer_;
+  // The steps that used the layer since it was last changed
+  std::vector< size_t > readers_;
+};
+
+// ADDUNIQUE:
+// Add a step to a list of steps, unless it is in there already.
+static void AddUnique( std::vector< size_t >& steps, size_t step )
+{
+  if ( std::find( steps.begin(), steps.end(), step ) == steps.end() )
+  {
+    steps.push_back( step );
+  }
+}
+
+class LayerActionBatchGraphPrivate
+{
+public:
+  // ADD_DEPENDENCY:
+  // Make step run after dependency.
+  void add_dependency( LayerActionBatchGraphStep& step, size_t index, size_t dependency );
+
+  // IS_LAYER_NEEDED:
+  // Check whether a layer is the output of a step that is done and that is kept, not used by 
+  // any step or still used by a step that has to finish. A step that replaces its input 
+  // layer outputs the same layer as the step that generated it.
+  bool is_layer_needed( const std::string& layer_id ) const;
+
+public:
+  std::vector< LayerActionBatchGraphStep > steps_;
+  std::map< std::string, size_t > step_index_;
+
+  // The layers the steps access, by the id that is used in the steps
+  std::map< std::string, LayerActionBatchGraphLayer > layers_;
+};
+
+void LayerActionBatchGraphPrivate::add_dependency( LayerActionBatchGraphStep& step, 
+  size_t index, size_t dependency )
+{
+  if ( dependency == index ) return;
+  AddUnique( step.dependencies_, dependency );
+}
+
+bool LayerActionBatchGraphPrivate::is_layer_needed( const std::string& layer_id ) const
+{
+  for ( size_t j = 0; j < this->steps_.size(); j++ )
+  {
+    const LayerActionBatchGraphStep& step = this->steps_[ j ];
+    if ( !step.done_ || ( !step.keep_ && !step.consumers_.empty() && 
+      step.num_consumers_ == 0 ) ) continue;
+
+    if ( std::find( step.output_layer_ids_.begin(), step.output_layer_ids_.end(), 
+      layer_id ) != step.output_layer_ids_.end() ) return true;
+  }
+  return false;
+}
+
+LayerActionBatchGraph::LayerActionBatchGraph() :
+  private_( new LayerActionBatchGraphPrivate )
+{
+}
+
+LayerActionBatchGraph::~LayerActionBatchGraph()
+{
+}
+
+bool LayerActionBatchGraph::add_step( const std::string& name, 
+  const std::vector< std::string >& layer_ids, 
+  const std::vector< std::string >& modified_layer_ids, bool keep, std::string& error )
+{
+  if ( name.empty() || this->private_->step_index_.count( name ) )
+  {
+    error = "Step name '" + name + "' is empty or already in use.";
+    return false;
+  }
+
+  size_t index = this->private_->steps_.size();
+  LayerActionBatchGraphStep step;
+  step.name_ = name;
+  step.keep_ = keep;
+
+  std::vector< std::string > step_layer_ids;
+  for ( size_t j = 0; j < layer_ids.size(); j++ )
+  {
+    if ( layer_ids[ j ].empty() || layer_ids[ j ] == "<none>" ) continue;
+    step_layer_ids.push_back( layer_ids[ j ] );
+  }
+  for ( size_t j = 0; j < modified_layer_ids.size(); j++ )
+  {
+    if ( modified_layer_ids[ j ].empty() || modified_layer_ids[ j ] == "<none>" ) continue;
+    step_layer_ids.push_back( modified_layer_ids[ j ] );
+  }
+
+  // Layers that refer to earlier steps make this step a consumer of their output layers
+  for ( size_t j = 0; j < step_layer_ids.size(); j++ )
+  {
+    if ( step_layer_ids[ j ][ 0 ] != '$' ) continue;
+
+    std::map< std::string, size_t >::const_iterator it = 
+      this->private_->step_index_.find( step_layer_ids[ j ].substr( 1 ) );
+    if ( it == this->private_->step_index_.end() )
+    {
+      error = "Step '" + name + "' refers to unknown step '" + step_layer_ids[ j ] + "'.";
+      return false;
+    }
+    AddUnique( step.inputs_, it->second );
+  }
+
+  // A step needs to wait for the last step that changed one of its layers, and a step that 
+  // changes a layer needs to wait for the steps that used it before. The output layers of a 
+  // step are changed by that step. Layers that are neither generated nor changed by the 
+  // batch do not impose any order.
+  for ( size_t j = 0; j < step_layer_ids.size(); j++ )
+  {
+    LayerActionBatchGraphLayer& layer = this->private_->layers_[ step_layer_ids[ j ] ];
+    if ( layer.has_writer_ ) 
+    {
+      this->private_->add_dependency( step, index, layer.writer_ );
+    }
+
+    if ( std::find( modified_layer_ids.begin(), modified_layer_ids.end(), 
+      step_layer_ids[ j ] ) != modified_layer_ids.end() )
+    {
+      for ( size_t k = 0; k < layer.readers_.size(); k++ )
+      {
+        this->private_->add_dependency( step, index, layer.readers_[ k ] );
+      }
+      layer.has_writer_ = true;
+      layer.writer_ = index;
+      layer.readers_.clear();
+    }
+    else if ( !layer.has_writer_ || layer.writer_ != index )
+    {
+      AddUnique( layer.readers_, index );
+    }
+  }
+
+  LayerActionBatchGraphLayer& output = this->private_->layers_[ "$" + name ];
+  output.has_writer_ = true;
+  output.writer_ = index;
+
+  for ( size_t j = 0; j < step.inputs_.size(); j++ )
+  {
+    this->private_->steps_[ step.inputs_[ j ] ].consumers_.push_back( index );
+  }
+  for ( size_t j = 0; j < step.dependencies_.size(); j++ )
+  {
+    this->private_->steps_[ step.dependencies_[ j ] ].dependents_.push_back( index );
+  }
+  step.num_pending_dependencies_ = step.dependencies_.size();
+
+  this->private_->steps_.push_back( step );
+  this->private_->step_index_[ name ] = index;
+  return true;
+}
+
+size_t LayerActionBatchGraph::get_num_steps() const
+{
+  return this->private_->steps_.size();
+}
+
+int LayerActionBatchGraph::find_step( const std::string& name ) const
+{
+  std::map< std::string, size_t >::const_iterator it = this->private_->step_index_.find( name );
+  if ( it == this->private_->step_index_.end() ) return -1;
+  return static_cast< int >( it->second );
+}
+
+std::string LayerActionBatchGraph::get_step_name( size_t index ) const
+{
+  return this->private_->steps_[ index ].name_;
+}
+
+std::vector< size_t > LayerActionBatchGraph::get_dependencies( size_t index ) const
+{
+  return this->private_->steps_[ index ].dependencies_;
+}
+
+void LayerActionBatchGraph::reset( std::vector< size_t >& ready )
+{
+  ready.clear();
+  for ( size_t j = 0; j < this->private_->steps_.size(); j++ )
+  {
+    LayerActionBatchGraphStep& step = this->private_->steps_[ j ];
+    step.done_ = false;
+    step.output_layer_ids_.clear();
+    step.num_consumers_ = step.consumers_.size();
+    step.num_pending_dependencies_ = step.dependencies_.size();
+    if ( step.num_pending_dependencies_ == 0 ) ready.push_back( j );
+  }
+}
+
+std::vector< std::string > LayerActionBatchGraph::substitute_outputs( 
+  const std::string& layer_id ) const
+{
+  if ( !layer_id.empty() && layer_id[ 0 ] == '$' )
+  {
+    std::map< std::string, size_t >::const_iterator it = 
+      this->private_->step_index_.find( layer_id.substr( 1 ) );
+    if ( it != this->private_->step_index_.end() && this->private_->steps_[ it->second ].done_ )
+    {
+      return this->private_->steps_[ it->second ].output_layer_ids_;
+    }
+  }
+  return std::vector< std::string >( 1, layer_id );
+}
+
+void LayerActionBatchGraph::set_output_layer_ids( size_t index, 
+  const std::vector< std::string >& layer_ids )
+{
+  this->private_->steps_[ index ].output_layer_ids_ = layer_ids;
+}
+
+std::vector< std::string > LayerActionBatchGraph::get_output_layer_ids( size_t index ) const
+{
+  return this->private_->steps_[ index ].output_layer_ids_;
+}
+
+void LayerActionBatchGraph::finish_step( size_t index, std::vector< size_t >& ready,
+  std::vector< std::string >& unused_layer_ids )
+{
+  ready.clear();
+  unused_layer_ids.clear();
+
+  LayerActionBatchGraphStep& step = this->private_->steps_[ index ];
+  step.done_ = true;
+
+  for ( size_t j = 0; j < step.dependents_.size(); j++ )
+  {
+    LayerActionBatchGraphStep& dependent = this->private_->steps_[ step.dependents_[ j ] ];
+    if ( --dependent.num_pending_dependencies_ == 0 ) ready.push_back( step.dependents_[ j ] );
+  }
+
+  for ( size_t j = 0; j < step.inputs_.size(); j++ )
+  {
+    LayerActionBatchGraphStep& input = this->private_->steps_[ step.inputs_[ j ] ];
+    if ( --input.num_consumers_ > 0 || input.keep_ ) continue;
+
+    for ( size_t k = 0; k < input.output_layer_ids_.size(); k++ )
+    {
+      if ( !this->private_->is_layer_needed( input.output_layer_ids_[ k ] ) )
+      {
+        unused_layer_ids.push_back( input.output_layer_ids_[ k ] );
+      }
+    }
+  }
+}
+
+} // end namespace Seg3D
@@ -0,0 +1,120 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef APPLICATION_LAYER_LAYERACTIONBATCHGRAPH_H
+#define APPLICATION_LAYER_LAYERACTIONBATCHGRAPH_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Boost includes
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+namespace Seg3D
+{
+
+class LayerActionBatchGraphPrivate;
+typedef boost::shared_ptr< LayerActionBatchGraphPrivate > LayerActionBatchGraphPrivateHandle;
+
+// CLASS LayerActionBatchGraph:
+/// The dependency graph of a LayerActionBatch. It only knows which layers each step uses and
+/// changes, and keeps track of which steps can run and which intermediate layers can be
+/// deleted while the batch runs. Layer ids of the form $name refer to the output layers of the
+/// step called name.
+
+class LayerActionBatchGraph : public boost::noncopyable
+{
+  // -- constructor/destructor --
+public:
+  LayerActionBatchGraph();
+  virtual ~LayerActionBatchGraph();
+
+  // -- building the graph --
+public:
+  /// ADD_STEP:
+  /// Add a step that uses the given layers and changes the given subset of them in place. A
+  /// step runs after the last earlier step that changed one of its layers, and a step that
+  /// changes a layer also runs after the earlier steps that used it. Returns false if the name
+  /// is empty or already in use, or if a layer refers to an unknown step.
+  bool add_step( const std::string& name, const std::vector< std::string >& layer_ids,
+    const std::vector< std::string >& modified_layer_ids, bool keep, std::string& error );
+
+  /// GET_NUM_STEPS:
+  /// Get the number of steps in the graph.
+  size_t get_num_steps() const;
+
+  /// FIND_STEP:
+  /// Get the index of a step, or -1 if there is no step with that name.
+  int find_step( const std::string& name ) const;
+
+  /// GET_STEP_NAME:
+  /// Get the name of a step.
+  std::string get_step_name( size_t index ) const;
+
+  /// GET_DEPENDENCIES:
+  /// Get the steps that need to finish before a step can run.
+  std::vector< size_t > get_dependencies( size_t index ) const;
+
+  // -- running the graph --
+public:
+  /// RESET:
+  /// Forget the results of an earlier run and get the steps that can run right away.
+  void reset( std::vector< size_t >& ready );
+
+  /// SUBSTITUTE_OUTPUTS:
+  /// Get the layers a layer id stands for: the output layers of the step if it is a $name 
+  /// reference to a step that is done, otherwise the layer id itself.
+  std::vector< std::string > substitute_outputs( const std::string& layer_id ) const;
+
+  /// SET_OUTPUT_LAYER_IDS:
+  /// Set the ids of the layers a step generated.
+  void set_output_layer_ids( size_t index, const std::vector< std::string >& layer_ids );
+
+  /// GET_OUTPUT_LAYER_IDS:
+  /// Get the ids of the layers a step generated.
+  std::vector< std::string > get_output_layer_ids( size_t index ) const;
+
+  /// FINISH_STEP:
+  /// Mark a step as done. Returns the steps that can run now, and the output layers of earlier
+  /// steps that are not kept and that no step that still has to finish uses.
+  void finish_step( size_t index, std::vector< size_t >& ready, 
+    std::vector< std::string >& unused_layer_ids );
+
+private:
+  LayerActionBatchGraphPrivateHandle private_;
+};
+
+} // end namespace Seg3D
+
+#endif
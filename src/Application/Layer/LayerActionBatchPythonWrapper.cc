@@ -0,0 +1,116 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef _MSC_VER
+#pragma warning( disable: 4244 4267 )
+#endif
+
+// STL includes
+#include <string>
+
+// Boost includes
+#include <boost/python.hpp>
+
+// Application includes
+#include <Application/Layer/LayerActionBatch.h>
+
+// Function that runs a pipeline of actions from python as a batch, so that the independent
+// steps of the pipeline run concurrently instead of one after the other.
+
+namespace Seg3D
+{
+
+// RUNBATCH:
+// Run a list of (name, action) or (name, action, keep) steps and return a dictionary with the
+// output layer ids of each step.
+static boost::python::dict RunBatch( boost::python::list steps, int max_running, 
+  long long memory_limit )
+{
+  LayerActionBatch batch;
+  batch.set_max_running_steps( max_running );
+  batch.set_memory_limit( memory_limit );
+
+  std::vector< std::string > names;
+  std::string error;
+  boost::python::ssize_t num_steps = boost::python::len( steps );
+  for ( boost::python::ssize_t j = 0; j < num_steps; j++ )
+  {
+    boost::python::object step = steps[ j ];
+    boost::python::ssize_t step_size = boost::python::len( step );
+    if ( step_size < 2 || step_size > 3 )
+    {
+      PyErr_SetString( PyExc_ValueError, "A step needs to be (name, action) or "
+        "(name, action, keep)." );
+      boost::python::throw_error_already_set();
+    }
+
+    std::string name = boost::python::extract< std::string >( step[ 0 ] );
+    std::string action = boost::python::extract< std::string >( step[ 1 ] );
+    bool keep = step_size > 2 && boost::python::extract< bool >( step[ 2 ] );
+
+    if ( !batch.add_step( name, action, keep, error ) )
+    {
+      PyErr_SetString( PyExc_Exception, error.c_str() );
+      boost::python::throw_error_already_set();
+    }
+    names.push_back( name );
+  }
+
+  if ( !batch.run( error ) )
+  {
+    PyErr_SetString( PyExc_Exception, error.c_str() );
+    boost::python::throw_error_already_set();
+  }
+
+  boost::python::dict outputs;
+  for ( size_t j = 0; j < names.size(); j++ )
+  {
+    std::vector< std::string > layer_ids = batch.get_output_layer_ids( names[ j ] );
+    boost::python::list layer_id_list;
+    for ( size_t k = 0; k < layer_ids.size(); k++ )
+    {
+      layer_id_list.append( layer_ids[ k ] );
+    }
+    outputs[ names[ j ] ] = layer_id_list;
+  }
+  return outputs;
+}
+
+} // end namespace Seg3D
+
+namespace Core
+{
+
+void register_layer_action_batch_python_wrapper()
+{
+  boost::python::def( "runbatch", &Seg3D::RunBatch, 
+    ( boost::python::arg( "steps" ), boost::python::arg( "maxrunning" ) = 0,
+    boost::python::arg( "memorylimit" ) = 0 ) );
+}
+
+} // end namespace Core
@@ -0,0 +1,478 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <list>
+#include <map>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+// Core includes
+#include <Core/Application/Application.h>
+#include <Core/DataBlock/NrrdData.h>
+#include <Core/Math/MathFunctions.h>
+#include <Core/Utils/Log.h>
+#include <Core/Utils/StringUtil.h>
+
+// Application includes
+#include <Application/Layer/LayerDataLoader.h>
+#include <Application/Layer/LayerManager.h>
+
+namespace Seg3D
+{
+
+CORE_SINGLETON_IMPLEMENTATION( LayerDataLoader );
+
+// Maximum number of files that are read at the same time. Each file is decompressed with 
+// multiple threads already, hence this mainly overlaps file access and decoding.
+static const unsigned int MAX_LOADER_THREADS_C = 4;
+
+// Smallest change in progress that is reported to the layers
+static const double PROGRESS_STEP_C = 0.01;
+
+// CLASS LAYERDATALOADQUEUE:
+/// The files that were queued by one call to prefetch.
+class LayerDataLoadQueue
+{
+public:
+  LayerDataLoadQueue() :
+    pending_bytes_( 0 ),
+    memory_budget_( 0 ),
+    num_files_( 0 ),
+    num_loaded_files_( 0 ),
+    abort_( false )
+  {
+  }
+
+  // Load status of one generation file
+  class Entry
+  {
+  public:
+    Entry() : 
+      started_( false ), 
+      finished_( false ), 
+      success_( false ), 
+      size_( 0 ), 
+      reported_progress_( 0.0 ) 
+    {
+    }
+
+    bool started_;
+    bool finished_;
+    bool success_;
+
+    // Memory reserved for this file until a layer picks it up
+    size_t size_;
+    Core::DataVolumeHandle volume_;
+    std::string error_;
+
+    // The layers that wait for this file
+    double reported_progress_;
+    std::vector< std::string > layer_ids_;
+    std::vector< LayerDataLoader::done_function_type > done_functions_;
+  };
+  typedef boost::shared_ptr< Entry > EntryHandle;
+  typedef std::map< Core::DataBlock::generation_type, EntryHandle > entry_map_type;
+
+  // RUN_LOADER:
+  /// Main function of the loader threads
+  void run_loader();
+
+  // REPORT_PROGRESS:
+  /// Forward the progress of a file to the layers that wait for it
+  void report_progress( EntryHandle entry, double progress );
+
+  // NOTIFY_DONE:
+  /// Post the result of a file to the layers that wait for it
+  /// NOTE: The mutex needs to be locked.
+  void notify_done( EntryHandle entry );
+
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+
+  // The threads that load the files
+  boost::thread_group threads_;
+
+  // Directory that contains the generation files
+  boost::filesystem::path data_path_;
+
+  // Generations that still need to be loaded, in the order in which they will be picked up
+  std::list< Core::DataBlock::generation_type > queue_;
+
+  // Status of all the files that have not been picked up yet
+  entry_map_type entries_;
+
+  // Amount of memory reserved for volumes that are being loaded or not yet picked up
+  size_t pending_bytes_;
+  size_t memory_budget_;
+
+  // Progress reporting
+  size_t num_files_;
+  size_t num_loaded_files_;
+
+  // Whether the queue has been abandoned
+  bool abort_;
+};
+
+typedef boost::shared_ptr< LayerDataLoadQueue > LayerDataLoadQueueHandle;
+
+// UPDATELAYERPROGRESS:
+// Show the load progress on a layer. This runs on the application thread, where the layer can
+// be looked up safely.
+static void UpdateLayerProgress( const std::string& layer_id, double progress )
+{
+  LayerHandle layer = LayerManager::FindLayer( layer_id );
+  if ( layer ) layer->update_progress( progress );
+}
+
+// GETVOLUMEBYTESIZE:
+// Get the size of the data stored in a generation file from its header.
+static size_t GetVolumeByteSize( const boost::filesystem::path& volume_path )
+{
+  Core::NrrdDataHandle header;
+  std::string error;
+  if ( !Core::NrrdData::LoadNrrdHeader( volume_path.string(), header, error ) ) return 0;
+
+  Core::GridTransform grid_transform = header->get_grid_transform();
+  return grid_transform.get_nx() * grid_transform.get_ny() * grid_transform.get_nz() *
+    Core::GetSizeDataType( header->get_data_type() );
+}
+
+void LayerDataLoadQueue::run_loader()
+{
+  boost::mutex::scoped_lock lock( this->mutex_ );
+
+  while ( true )
+  {
+    // Do not run too far ahead of the layers that pick up the data
+    while ( !this->abort_ && !this->queue_.empty() && 
+      this->pending_bytes_ >= this->memory_budget_ )
+    {
+      this->condition_.wait( lock );
+    }
+
+    if ( this->abort_ || this->queue_.empty() ) return;
+
+    Core::DataBlock::generation_type generation = this->queue_.front();
+    this->queue_.pop_front();
+    EntryHandle entry = this->entries_[ generation ];
+    entry->started_ = true;
+
+    boost::filesystem::path volume_path = this->data_path_ / 
+      ( Core::ExportToString( generation ) + ".nrrd" );
+    
+    lock.unlock();
+    size_t size = GetVolumeByteSize( volume_path );
+    lock.lock();
+
+    // Reserve the memory of the file until a layer picks up the data, so that the threads
+    // that start next account for the files that are still being read.
+    entry_map_type::iterator it = this->entries_.find( generation );
+    if ( !this->abort_ && it != this->entries_.end() && it->second == entry )
+    {
+      entry->size_ = size;
+      this->pending_bytes_ += size;
+    }
+
+    lock.unlock();
+    Core::DataVolumeHandle volume;
+    std::string error;
+    bool success = Core::DataVolume::LoadDataVolume( volume_path, volume, error,
+      boost::bind( &LayerDataLoadQueue::report_progress, this, entry, _1 ) );
+    lock.lock();
+
+    entry->finished_ = true;
+    entry->success_ = success;
+    entry->error_ = error;
+    this->num_loaded_files_++;
+
+    // The entry is gone if the file was released or abandoned meanwhile, in which case its
+    // reservation was returned as well
+    it = this->entries_.find( generation );
+    if ( !this->abort_ && it != this->entries_.end() && it->second == entry )
+    {
+      // Only the loaded data remains reserved
+      size_t loaded_size = success ? volume->get_data_block()->get_byte_size() : 0;
+      this->pending_bytes_ = this->pending_bytes_ - entry->size_ + loaded_size;
+      entry->size_ = loaded_size;
+      if ( success ) entry->volume_ = volume;
+
+      if ( !entry->done_functions_.empty() )
+      {
+        // Hand the data to the layers that are waiting for it
+        this->pending_bytes_ -= entry->size_;
+        this->notify_done( entry );
+        this->entries_.erase( it );
+      }
+
+      CORE_LOG_MESSAGE( "Loaded layer data " + Core::ExportToString( this->num_loaded_files_ ) +
+        " of " + Core::ExportToString( this->num_files_ ) + "." );
+    }
+    this->condition_.notify_all();
+  }
+}
+
+void LayerDataLoadQueue::report_progress( EntryHandle entry, double progress )
+{
+  boost::mutex::scoped_lock lock( this->mutex_ );
+  if ( this->abort_ || progress < entry->reported_progress_ + PROGRESS_STEP_C ) return;
+  entry->reported_progress_ = progress;
+
+  for ( size_t j = 0; j < entry->layer_ids_.size(); j++ )
+  {
+    Core::Application::PostEvent( boost::bind( &UpdateLayerProgress, entry->layer_ids_[ j ], 
+      progress ) );
+  }
+}
+
+void LayerDataLoadQueue::notify_done( EntryHandle entry )
+{
+  for ( size_t j = 0; j < entry->done_functions_.size(); j++ )
+  {
+    Core::Application::PostEvent( boost::bind( entry->done_functions_[ j ], entry->success_, 
+      entry->volume_, entry->error_ ) );
+  }
+  entry->layer_ids_.clear();
+  entry->done_functions_.clear();
+}
+
+class LayerDataLoaderPrivate
+{
+public:
+  // ABORT_QUEUE:
+  /// Abandon the current queue and wait for its threads to exit
+  void abort_queue();
+
+  // FIND_QUEUE:
+  /// Get the current queue if it loads the files in the data directory
+  LayerDataLoadQueueHandle find_queue( const boost::filesystem::path& data_path );
+
+  // The files that are currently being loaded
+  boost::mutex mutex_;
+  LayerDataLoadQueueHandle queue_;
+};
+
+void LayerDataLoaderPrivate::abort_queue()
+{
+  LayerDataLoadQueueHandle queue;
+  {
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    queue.swap( this->queue_ );
+  }
+  if ( !queue ) return;
+
+  {
+    boost::mutex::scoped_lock lock( queue->mutex_ );
+    queue->abort_ = true;
+    queue->queue_.clear();
+    queue->entries_.clear();
+    queue->pending_bytes_ = 0;
+    queue->condition_.notify_all();
+  }
+
+  // NOTE: Files that are being read are finished by their threads and then discarded. The
+  // loader threads only post events to the application thread, hence this can be called on
+  // the application thread.
+  queue->threads_.join_all();
+}
+
+LayerDataLoadQueueHandle LayerDataLoaderPrivate::find_queue( 
+  const boost::filesystem::path& data_path )
+{
+  boost::mutex::scoped_lock lock( this->mutex_ );
+  if ( this->queue_ && this->queue_->data_path_ == data_path ) return this->queue_;
+  return LayerDataLoadQueueHandle();
+}
+
+LayerDataLoader::LayerDataLoader() :
+  private_( new LayerDataLoaderPrivate )
+{
+  this->add_connection( Core::Application::Instance()->reset_signal_.connect( boost::bind(
+    &LayerDataLoader::finish, this ) ) );
+}
+
+LayerDataLoader::~LayerDataLoader()
+{
+  this->disconnect_all();
+  this->private_->abort_queue();
+}
+
+void LayerDataLoader::prefetch( const boost::filesystem::path& data_path,
+  const std::vector< Core::DataBlock::generation_type >& generations )
+{
+  this->private_->abort_queue();
+  if ( generations.empty() ) return;
+
+  LayerDataLoadQueueHandle queue( new LayerDataLoadQueue );
+  queue->data_path_ = data_path;
+  queue->memory_budget_ = static_cast< size_t >( 
+    Core::Application::Instance()->get_total_addressable_physical_memory() / 4 );
+
+  for ( size_t j = 0; j < generations.size(); j++ )
+  {
+    if ( generations[ j ] < 0 || queue->entries_.count( generations[ j ] ) ) continue;
+    queue->entries_[ generations[ j ] ] = LayerDataLoadQueue::EntryHandle( 
+      new LayerDataLoadQueue::Entry );
+    queue->queue_.push_back( generations[ j ] );
+  }
+  queue->num_files_ = queue->queue_.size();
+
+  unsigned int num_threads = Core::Min( Core::Max( boost::thread::hardware_concurrency(), 1u ),
+    MAX_LOADER_THREADS_C );
+  num_threads = Core::Min( num_threads, static_cast< unsigned int >( queue->num_files_ ) );
+
+  {
+    boost::mutex::scoped_lock lock( this->private_->mutex_ );
+    this->private_->queue_ = queue;
+  }
+
+  for ( unsigned int j = 0; j < num_threads; j++ )
+  {
+    queue->threads_.create_thread( boost::bind( &LayerDataLoadQueue::run_loader, queue ) );
+  }
+}
+
+bool LayerDataLoader::load_data_volume_in_background( const boost::filesystem::path& data_path,
+  Core::DataBlock::generation_type generation, const std::string& layer_id,
+  done_function_type done_function )
+{
+  LayerDataLoadQueueHandle queue = this->private_->find_queue( data_path );
+  if ( !queue ) return false;
+
+  boost::mutex::scoped_lock lock( queue->mutex_ );
+  LayerDataLoadQueue::entry_map_type::iterator it = queue->entries_.find( generation );
+  if ( it == queue->entries_.end() ) return false;
+
+  LayerDataLoadQueue::EntryHandle entry = it->second;
+  entry->layer_ids_.push_back( layer_id );
+  entry->done_functions_.push_back( done_function );
+
+  if ( entry->finished_ )
+  {
+    // The data was loaded ahead of the layer
+    queue->pending_bytes_ -= entry->size_;
+    queue->notify_done( entry );
+    queue->entries_.erase( it );
+    queue->condition_.notify_all();
+  }
+
+  return true;
+}
+
+bool LayerDataLoader::load_data_volume( const boost::filesystem::path& data_path, 
+  Core::DataBlock::generation_type generation, Core::DataVolumeHandle& volume, 
+  std::string& error )
+{
+  boost::filesystem::path volume_path = data_path / 
+    ( Core::ExportToString( generation ) + ".nrrd" );
+
+  LayerDataLoadQueueHandle queue = this->private_->find_queue( data_path );
+  if ( !queue ) return Core::DataVolume::LoadDataVolume( volume_path, volume, error );
+
+  boost::mutex::scoped_lock lock( queue->mutex_ );
+  LayerDataLoadQueue::entry_map_type::iterator it = queue->entries_.find( generation );
+  if ( it == queue->entries_.end() )
+  {
+    lock.unlock();
+    return Core::DataVolume::LoadDataVolume( volume_path, volume, error );
+  }
+
+  LayerDataLoadQueue::EntryHandle entry = it->second;
+  if ( !entry->started_ )
+  {
+    // The loader threads did not get to this file yet, load it here instead
+    queue->queue_.remove( generation );
+    entry->started_ = true;
+
+    lock.unlock();
+    entry->success_ = Core::DataVolume::LoadDataVolume( volume_path, entry->volume_, 
+      entry->error_ );
+    lock.lock();
+    entry->finished_ = true;
+  }
+  else
+  {
+    // Wait for this particular file only
+    while ( !entry->finished_ && !queue->abort_ ) queue->condition_.wait( lock );
+    if ( !entry->finished_ )
+    {
+      lock.unlock();
+      return Core::DataVolume::LoadDataVolume( volume_path, volume, error );
+    }
+  }
+
+  // NOTE: The entry may have been picked up while the lock was released
+  it = queue->entries_.find( generation );
+  if ( it != queue->entries_.end() && it->second == entry )
+  {
+    queue->pending_bytes_ -= entry->size_;
+    queue->notify_done( entry );
+    queue->entries_.erase( it );
+  }
+  queue->condition_.notify_all();
+
+  volume = entry->volume_;
+  error = entry->error_;
+  return entry->success_;
+}
+
+void LayerDataLoader::release_unclaimed()
+{
+  LayerDataLoadQueueHandle queue;
+  {
+    boost::mutex::scoped_lock lock( this->private_->mutex_ );
+    queue = this->private_->queue_;
+  }
+  if ( !queue ) return;
+
+  boost::mutex::scoped_lock lock( queue->mutex_ );
+  LayerDataLoadQueue::entry_map_type::iterator it = queue->entries_.begin();
+  while ( it != queue->entries_.end() )
+  {
+    if ( it->second->done_functions_.empty() )
+    {
+      queue->queue_.remove( it->first );
+      queue->pending_bytes_ -= it->second->size_;
+      queue->entries_.erase( it++ );
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  queue->condition_.notify_all();
+}
+
+void LayerDataLoader::finish()
+{
+  this->private_->abort_queue();
+}
+
+} // end namespace Seg3D
@@ -0,0 +1,118 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef APPLICATION_LAYER_LAYERDATALOADER_H
+#define APPLICATION_LAYER_LAYERDATALOADER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Boost includes
+#include <boost/filesystem/path.hpp>
+#include <boost/function.hpp>
+#include <boost/smart_ptr.hpp>
+
+// Core includes
+#include <Core/Utils/Singleton.h>
+#include <Core/Utils/ConnectionHandler.h>
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/Volume/DataVolume.h>
+
+namespace Seg3D
+{
+
+/// LayerDataLoader
+/// This singleton class loads the data files of the layers of a session concurrently. When a
+/// session is loaded, the generation files of all the data and mask layers are queued and loaded
+/// by a bounded pool of threads. The layers are restored right away and wait for their data in 
+/// the background, while the loader reports the progress of each file. The amount of memory 
+/// that is loaded ahead of the layers is limited by a budget.
+
+/// Internals for the LayerDataLoader singleton
+class LayerDataLoaderPrivate;
+typedef boost::shared_ptr< LayerDataLoaderPrivate > LayerDataLoaderPrivateHandle;
+
+class LayerDataLoader : private Core::ConnectionHandler
+{
+  CORE_SINGLETON( LayerDataLoader );
+
+  // -- Constructor/Destructor --
+private:
+  LayerDataLoader();
+  virtual ~LayerDataLoader();
+
+  // -- loader interface --
+public:
+  typedef boost::function< void ( bool, Core::DataVolumeHandle, std::string ) > 
+    done_function_type;
+
+  /// PREFETCH:
+  /// Start loading the generation files in the data directory in the background.
+  /// NOTE: Loading of the files of a previous call is stopped.
+  void prefetch( const boost::filesystem::path& data_path,
+    const std::vector< Core::DataBlock::generation_type >& generations );
+
+  /// LOAD_DATA_VOLUME_IN_BACKGROUND:
+  /// Wait in the background for a prefetched file. While the file is read, its progress is
+  /// shown on the layer. Once it is done, the done function is called with the result on the 
+  /// application thread. Several layers can wait for the same file. Returns false if the file
+  /// was not prefetched.
+  bool load_data_volume_in_background( const boost::filesystem::path& data_path,
+    Core::DataBlock::generation_type generation, const std::string& layer_id,
+    done_function_type done_function );
+
+  /// LOAD_DATA_VOLUME:
+  /// Get the volume stored in the file of a generation. If the file was prefetched, this only
+  /// waits for that particular file, otherwise the file is loaded on the calling thread.
+  /// Layers that wait for the file in the background are notified as well.
+  bool load_data_volume( const boost::filesystem::path& data_path, 
+    Core::DataBlock::generation_type generation, Core::DataVolumeHandle& volume, 
+    std::string& error );
+
+  /// RELEASE_UNCLAIMED:
+  /// Stop loading the prefetched files that no layer waits for and discard their volumes.
+  void release_unclaimed();
+
+  /// FINISH:
+  /// Stop loading, discard all the volumes and wait for the loader threads to exit. Layers
+  /// that still wait for their data are not notified.
+  void finish();
+
+  // -- internals --
+private:
+  LayerDataLoaderPrivateHandle private_;
+};
+
+} // end namespace Seg3D
+
+#endif
@@ -63,6 +63,9 @@ typedef boost::shared_ptr< LayerSceneItem > LayerSceneItemHandle;
 typedef std::vector< LayerSceneItemHandle > LayerScene;
 typedef boost::shared_ptr< LayerScene > LayerSceneHandle;
 
+class ViewerSceneInfo;
+typedef boost::shared_ptr< const ViewerSceneInfo > ViewerSceneInfoHandle;
+
 } // end namespace Seg3D
 
 #endif
@@ -695,10 +695,12 @@ bool LayerGroup::post_load_states( const Core::StateIO& state_io )
       // Here we do any post loading processing that requires both the group and layer info
       
       // Now, if the mask had its isosurface generated we dispatch an action to do it again
+      // NOTE: Masks whose data is still being loaded do this once their data arrives.
       if( layer_type == "mask" ) 
       {
         MaskLayerHandle temp_mask_handle = boost::dynamic_pointer_cast< MaskLayer >( layer );
-        if( temp_mask_handle->iso_generated_state_->get() ) 
+        if( temp_mask_handle->iso_generated_state_->get() && 
+          temp_mask_handle->has_valid_data() ) 
         {
           double quality = 1.0;
           Core::ImportFromString( this->isosurface_quality_state_->get(), quality );
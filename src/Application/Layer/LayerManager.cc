@@ -36,6 +36,7 @@
 #include <Core/State/StateIO.h>
 #include <Core/Utils/ScopedCounter.h>
 #include <Core/Utils/Exception.h>
+#include <Core/Utils/AtomicCounter.h>
 
 // Application includes
 #include <Application/Layer/LayerGroup.h>
@@ -44,13 +45,17 @@
 #include <Application/Layer/DataLayer.h>
 #include <Application/Layer/LayerScene.h>
 #include <Application/Layer/LayerAvailabilityNotifier.h>
+#include <Application/Layer/LayerDataLoader.h>
 #include <Application/Layer/LayerManager.h>
 #include <Application/ProjectManager/ProjectManager.h>
 #include <Application/PreferencesManager/PreferencesManager.h>
+#include <Application/Viewer/Viewer.h>
+#include <Application/ViewerManager/ViewerManager.h>
 
 // Boost includes
 #include <boost/foreach.hpp>
 #include <boost/smart_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace Seg3D
 {
@@ -65,6 +70,28 @@ typedef std::map< std::string, LayerHandle > LayerSandbox;
 typedef boost::shared_ptr< LayerSandbox > LayerSandboxHandle;
 typedef std::map< SandboxID, LayerSandboxHandle > LayerSandboxMap;
 
+// CLASS LayerSceneSnapshot:
+// Immutable copy of the layer and viewer properties that the renderers need, for all viewers
+// at once. It is built on the application thread while holding the state lock and published 
+// through an atomic shared pointer, so renderers never take the state lock to read it.
+class LayerSceneSnapshot
+{
+public:
+  // Items of all the layers with valid data, from bottom to top
+  std::vector< LayerSceneItemHandle > items_;
+
+  // Properties of each of the viewers
+  std::vector< ViewerSceneInfoHandle > viewers_;
+
+  // Bounding box of all the layer groups
+  Core::BBox bbox_;
+
+  // Value of the layer scene version when the snapshot was built
+  long version_;
+};
+
+typedef boost::shared_ptr< const LayerSceneSnapshot > LayerSceneSnapshotHandle;
+
 class LayerManagerPrivate
 {
 public:
@@ -101,6 +128,35 @@ public:
   // Find the specified sandbox.
   LayerSandboxHandle find_sandbox( SandboxID sandbox );
 
+  // CONNECT_LAYER_SCENE_STATES:
+  // Invalidate the layer scene snapshot whenever a state of the layer that is part of
+  // the layer scene changes.
+  void connect_layer_scene_states( LayerHandle layer );
+
+  // INVALIDATE_LAYER_SCENE:
+  // Mark the layer scene snapshot as out of date and schedule a new one to be built on the
+  // application thread.
+  void invalidate_layer_scene();
+
+  // UPDATE_LAYER_SCENE:
+  // Build and publish a new layer scene snapshot. Runs on the application thread.
+  void update_layer_scene();
+
+  // BUILD_LAYER_SCENE_SNAPSHOT:
+  // Copy the layer properties into a new snapshot.
+  // NOTE: The state engine needs to be locked when calling this function.
+  LayerSceneSnapshotHandle build_layer_scene_snapshot();
+
+  // GET_LAYER_SCENE_SNAPSHOT:
+  // Get the last published layer scene snapshot. If it is out of date, the renderers are 
+  // asked to redraw once the application thread has published the next one.
+  LayerSceneSnapshotHandle get_layer_scene_snapshot();
+
+  // GET_SESSION_GENERATIONS:
+  // Get the generation numbers of the data files used by the data and mask layers in a session.
+  void get_session_generations( const TiXmlElement* groups_element, 
+    std::vector< Core::DataBlock::generation_type >& generations );
+
   // An internal counter for temporarily blocking certain signals from being processed.
   size_t signal_block_count_;
   // A list of layer groups
@@ -113,6 +169,15 @@ public:
   LayerSandboxMap sandboxes_;
   // Sandbox counter
   SandboxID sandbox_count_;
+
+  // The last published layer scene snapshot
+  // NOTE: Only access it through boost::atomic_load and boost::atomic_store
+  LayerSceneSnapshotHandle layer_scene_snapshot_;
+  // Incremented whenever anything in the layer scene changes
+  Core::AtomicCounter layer_scene_version_;
+  // Whether an update of the snapshot has been posted to the application thread
+  bool layer_scene_update_pending_;
+  boost::mutex layer_scene_update_mutex_;
 };
 
 void LayerManagerPrivate::update_layer_list()
@@ -179,6 +244,223 @@ void LayerManagerPrivate::reset()
   }
   this->active_layer_.reset();
   this->group_list_.clear();
+  this->invalidate_layer_scene();
+}
+
+void LayerManagerPrivate::connect_layer_scene_states( LayerHandle layer )
+{
+  std::vector< Core::StateBaseHandle > states;
+  states.push_back( layer->master_visible_state_ );
+  states.insert( states.end(), layer->visible_state_.begin(), layer->visible_state_.end() );
+  states.push_back( layer->opacity_state_ );
+  states.push_back( layer->data_state_ );
+
+  switch( layer->get_type() )
+  {
+  case Core::VolumeType::DATA_E:
+    {
+      DataLayer* data_layer = dynamic_cast< DataLayer* >( layer.get() );
+      states.push_back( data_layer->min_value_state_ );
+      states.push_back( data_layer->max_value_state_ );
+      states.push_back( data_layer->display_min_value_state_ );
+      states.push_back( data_layer->display_max_value_state_ );
+      states.push_back( data_layer->volume_rendered_state_ );
+    }
+    break;
+  case Core::VolumeType::MASK_E:
+    {
+      MaskLayer* mask_layer = dynamic_cast< MaskLayer* >( layer.get() );
+      states.push_back( mask_layer->color_state_ );
+      states.push_back( mask_layer->border_state_ );
+      states.push_back( mask_layer->fill_state_ );
+      states.push_back( mask_layer->show_isosurface_state_ );
+    }
+    break;
+  case Core::VolumeType::LARGE_DATA_E:
+    {
+      LargeVolumeLayer* lv_layer = dynamic_cast< LargeVolumeLayer* >( layer.get() );
+      states.push_back( lv_layer->min_value_state_ );
+      states.push_back( lv_layer->max_value_state_ );
+      states.push_back( lv_layer->display_min_value_state_ );
+      states.push_back( lv_layer->display_max_value_state_ );
+    }
+    break;
+  default:
+    break;
+  }
+
+  // NOTE: LayerManager will always out-live layers, so it's safe to not disconnect.
+  for ( size_t i = 0; i < states.size(); ++i )
+  {
+    states[ i ]->state_changed_signal_.connect( boost::bind( 
+      &LayerManagerPrivate::invalidate_layer_scene, this ) );
+  }
+}
+
+void LayerManagerPrivate::invalidate_layer_scene()
+{
+  ++this->layer_scene_version_;
+
+  // Coalesce all the changes until the application thread gets to the update
+  {
+    boost::mutex::scoped_lock lock( this->layer_scene_update_mutex_ );
+    if ( this->layer_scene_update_pending_ ) return;
+    this->layer_scene_update_pending_ = true;
+  }
+
+  Core::Application::PostEvent( boost::bind( &LayerManagerPrivate::update_layer_scene, this ) );
+}
+
+void LayerManagerPrivate::update_layer_scene()
+{
+  {
+    boost::mutex::scoped_lock lock( this->layer_scene_update_mutex_ );
+    this->layer_scene_update_pending_ = false;
+  }
+
+  {
+    Core::StateEngine::lock_type lock( Core::StateEngine::GetMutex() );
+    boost::atomic_store( &this->layer_scene_snapshot_, this->build_layer_scene_snapshot() );
+  }
+
+  this->layer_manager_->layer_scene_updated_signal_();
+}
+
+LayerSceneSnapshotHandle LayerManagerPrivate::build_layer_scene_snapshot()
+{
+  boost::shared_ptr< LayerSceneSnapshot > snapshot( new LayerSceneSnapshot );
+  snapshot->version_ = this->layer_scene_version_;
+
+  // For each layer group
+  GroupList::reverse_iterator group_iterator = this->group_list_.rbegin();
+  for ( ; group_iterator != this->group_list_.rend(); group_iterator++)
+  {
+    const Core::GridTransform& grid_trans = ( *group_iterator )->get_grid_transform();
+    Core::Point pt( -0.5, -0.5, -0.5 );
+    snapshot->bbox_.extend( grid_trans * pt );
+    pt = Core::Point( static_cast< double >( grid_trans.get_nx() - 0.5 ), 
+      static_cast< double >( grid_trans.get_ny() - 0.5 ), 
+      static_cast< double >( grid_trans.get_nz() - 0.5 ) );
+    snapshot->bbox_.extend( grid_trans * pt );
+
+    const LayerList& layer_list = ( *group_iterator )->get_layer_list();
+
+    LayerList::const_reverse_iterator layer_iterator = layer_list.rbegin();
+    // For each layer in the group
+    for ( ; layer_iterator != layer_list.rend(); layer_iterator++ )
+    {
+      LayerHandle layer = *layer_iterator;
+      
+      // Skip processing this layer if it's not valid.
+      // NOTE: Layers that are not valid include the layers that are currently
+      // under construction.
+      if ( !layer->has_valid_data() )
+      {
+        continue;
+      }
+
+      LayerSceneItemHandle layer_scene_item;
+
+      switch( layer->get_type() )
+      {
+      case Core::VolumeType::DATA_E:
+        {
+          DataLayer* data_layer = dynamic_cast< DataLayer* >( layer.get() );
+          DataLayerSceneItem* data_layer_scene_item = new DataLayerSceneItem;
+          layer_scene_item = LayerSceneItemHandle( data_layer_scene_item );
+          data_layer_scene_item->data_min_ = data_layer->min_value_state_->get();
+          data_layer_scene_item->data_max_ = data_layer->max_value_state_->get();
+          data_layer_scene_item->display_min_ = data_layer->display_min_value_state_->get();
+          data_layer_scene_item->display_max_ = data_layer->display_max_value_state_->get();
+          if ( data_layer_scene_item->display_min_ > data_layer_scene_item->display_max_ )
+          {
+            std::swap( data_layer_scene_item->display_min_, data_layer_scene_item->display_max_ );
+          }
+          data_layer_scene_item->volume_rendered_ = data_layer->
+            volume_rendered_state_->get();
+        }
+        break;
+      case Core::VolumeType::MASK_E:
+        {
+          MaskLayer* mask_layer = dynamic_cast< MaskLayer* >( layer.get() );
+          MaskLayerSceneItem* mask_layer_scene_item = new MaskLayerSceneItem;
+          layer_scene_item = LayerSceneItemHandle( mask_layer_scene_item );
+          mask_layer_scene_item->color_ = mask_layer->color_state_->get();
+          mask_layer_scene_item->border_ = mask_layer->border_state_->index();
+          mask_layer_scene_item->fill_ = mask_layer->fill_state_->index();
+          mask_layer_scene_item->show_isosurface_ = mask_layer->
+            show_isosurface_state_->get();
+        }
+        break;
+      case Core::VolumeType::LARGE_DATA_E:
+        {
+          LargeVolumeLayer* lv_layer = dynamic_cast<LargeVolumeLayer*>(layer.get());
+          LargeVolumeLayerSceneItem* lv_layer_scene_item = new LargeVolumeLayerSceneItem;
+          layer_scene_item = LayerSceneItemHandle(lv_layer_scene_item);
+          lv_layer_scene_item->data_min_ = lv_layer->min_value_state_->get();
+          lv_layer_scene_item->data_max_ = lv_layer->max_value_state_->get();
+          lv_layer_scene_item->display_min_ = lv_layer->display_min_value_state_->get();
+          lv_layer_scene_item->display_max_ = lv_layer->display_max_value_state_->get();
+          if (lv_layer_scene_item->display_min_ > lv_layer_scene_item->display_max_)
+          {
+            std::swap(lv_layer_scene_item->display_min_, lv_layer_scene_item->display_max_);
+          }
+        }
+        break;
+      default:
+        CORE_THROW_LOGICERROR("Unknow layer type");
+        break;
+      } // end switch
+
+      layer_scene_item->layer_id_ = layer->get_layer_id();
+      layer_scene_item->layer_ = layer;
+      layer_scene_item->opacity_ = layer->opacity_state_->get();
+      layer_scene_item->grid_transform_ = layer->get_grid_transform();
+
+      layer_scene_item->visible_.resize( layer->visible_state_.size() );
+      for ( size_t i = 0; i < layer_scene_item->visible_.size(); ++i )
+      {
+        layer_scene_item->visible_[ i ] = layer->is_visible( i );
+      }
+
+      snapshot->items_.push_back( layer_scene_item );
+    } // end for each layer
+
+  } // end for each group
+
+  // For each viewer
+  size_t num_of_viewers = ViewerManager::Instance()->number_of_viewers();
+  for ( size_t i = 0; i < num_of_viewers; ++i )
+  {
+    ViewerHandle viewer = ViewerManager::Instance()->get_viewer( i );
+    ViewerSceneInfo* viewer_info = new ViewerSceneInfo;
+    snapshot->viewers_.push_back( ViewerSceneInfoHandle( viewer_info ) );
+
+    viewer_info->view_mode_ = viewer->view_mode_state_->get();
+    viewer_info->volume_view_ = viewer->is_volume_view();
+    viewer_info->viewer_visible_ = viewer->viewer_visible_state_->get();
+    viewer_info->slice_visible_ = viewer->slice_visible_state_->get();
+    viewer_info->background_color_ = PreferencesManager::Instance()->get_background_color();
+    if ( !viewer_info->volume_view_ )
+    {
+      viewer_info->view2d_ = static_cast< Core::StateView2D* >( 
+        viewer->get_active_view_state().get() )->get();
+    }
+
+    for ( size_t j = 0; j < snapshot->items_.size(); ++j )
+    {
+      const std::string& layer_id = snapshot->items_[ j ]->layer_id_;
+      Core::VolumeSliceHandle volume_slice = viewer->get_volume_slice( layer_id );
+      if ( volume_slice ) viewer_info->volume_slices_[ layer_id ] = volume_slice;
+    }
+  }
+
+  return snapshot;
+}
+
+LayerSceneSnapshotHandle LayerManagerPrivate::get_layer_scene_snapshot()
+{
+  return boost::atomic_load( &this->layer_scene_snapshot_ );
 }
 
 void LayerManagerPrivate::handle_layer_name_changed( std::string layer_id, std::string name )
@@ -231,6 +513,39 @@ LayerSandboxHandle LayerManagerPrivate::find_sandbox( SandboxID sandbox )
   return LayerSandboxHandle();
 }
 
+void LayerManagerPrivate::get_session_generations( const TiXmlElement* groups_element,
+  std::vector< Core::DataBlock::generation_type >& generations )
+{
+  const TiXmlElement* group_element = groups_element->FirstChildElement();
+  while ( group_element != 0 )
+  {
+    const TiXmlElement* layers_element = group_element->FirstChildElement( "layers" );
+    const TiXmlElement* layer_element = layers_element ? layers_element->FirstChildElement() : 0;
+    while ( layer_element != 0 )
+    {
+      const char* layer_type = layer_element->Attribute( "type" );
+      if ( layer_type && ( std::string( layer_type ) == "data" || 
+        std::string( layer_type ) == "mask" ) )
+      {
+        const TiXmlElement* state_element = layer_element->FirstChildElement( "State" );
+        while ( state_element != 0 )
+        {
+          const char* state_id = state_element->Attribute( "id" );
+          Core::DataBlock::generation_type generation;
+          if ( state_id && std::string( state_id ) == "generation" && state_element->GetText() &&
+            Core::ImportFromString( state_element->GetText(), generation ) && generation >= 0 )
+          {
+            generations.push_back( generation );
+          }
+          state_element = state_element->NextSiblingElement( "State" );
+        }
+      }
+      layer_element = layer_element->NextSiblingElement();
+    }
+    group_element = group_element->NextSiblingElement();
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Class LayerManager
 //////////////////////////////////////////////////////////////////////////
@@ -247,6 +562,14 @@ LayerManager::LayerManager() :
   this->private_->signal_block_count_ = 0;
   this->private_->layer_manager_ = this;
   this->private_->sandbox_count_ = 1;
+  this->private_->layer_scene_update_pending_ = false;
+
+  // Start out with an empty snapshot, the first one with the viewers is built once the 
+  // application thread runs
+  boost::shared_ptr< LayerSceneSnapshot > snapshot( new LayerSceneSnapshot );
+  snapshot->version_ = -1;
+  this->private_->layer_scene_snapshot_ = snapshot;
+  this->private_->invalidate_layer_scene();
 
   this->add_connection( this->layers_changed_signal_.connect( boost::bind( 
     &LayerManagerPrivate::update_layer_list, this->private_ ) ) );
@@ -256,6 +579,16 @@ LayerManager::LayerManager() :
     &LayerManagerPrivate::handle_active_layer_state_changed, this->private_, _2 ) ) );
   this->add_connection( Core::Application::Instance()->reset_signal_.connect( boost::bind(
     &LayerManagerPrivate::reset, this->private_ ) ) );
+
+  // Changes to the layers and groups that require a new layer scene snapshot
+  this->add_connection( this->layers_changed_signal_.connect( boost::bind( 
+    &LayerManagerPrivate::invalidate_layer_scene, this->private_ ) ) );
+  this->add_connection( this->groups_reordered_signal_.connect( boost::bind( 
+    &LayerManagerPrivate::invalidate_layer_scene, this->private_ ) ) );
+  this->add_connection( this->layer_volume_changed_signal_.connect( boost::bind( 
+    &LayerManagerPrivate::invalidate_layer_scene, this->private_ ) ) );
+  this->add_connection( this->layer_data_changed_signal_.connect( boost::bind( 
+    &LayerManagerPrivate::invalidate_layer_scene, this->private_ ) ) );
 }
 
 LayerManager::~LayerManager()
@@ -338,6 +671,8 @@ bool LayerManager::insert_layer( LayerHandle layer, SandboxID sandbox )
     // This is need to switch on/off menu options in the interface
     layer->data_state_->state_changed_signal_.connect( boost::bind(
       &LayerManagerPrivate::handle_layer_data_changed, this->private_, LayerWeakHandle( layer ) ) );
+
+    this->private_->connect_layer_scene_states( layer );
         
   } // unlocked from here
 
@@ -753,95 +1088,18 @@ LayerManager::mutex_type& LayerManager::get_mutex()
 LayerSceneHandle LayerManager::compose_layer_scene( size_t viewer_id )
 {
   // NOTE: This functions is called from the Rendering Thread
-  // Lock the LayerManager
-  lock_type lock( this->get_mutex() );
+  LayerSceneSnapshotHandle snapshot = this->private_->get_layer_scene_snapshot();
 
   LayerSceneHandle layer_scene( new LayerScene );
-
-  // For each layer group
-  GroupList::reverse_iterator group_iterator = 
-    this->private_->group_list_.rbegin();
-  for ( ; group_iterator != this->private_->group_list_.rend(); group_iterator++)
+  for ( size_t i = 0; i < snapshot->items_.size(); ++i )
   {
-    
-    const LayerList& layer_list = ( *group_iterator )->get_layer_list();
-
-    LayerList::const_reverse_iterator layer_iterator = layer_list.rbegin();
-    // For each layer in the group
-    for ( ; layer_iterator != layer_list.rend(); layer_iterator++ )
+    const std::vector< bool >& visible = snapshot->items_[ i ]->visible_;
+    if ( viewer_id < visible.size() && visible[ viewer_id ] )
     {
-      LayerHandle layer = *layer_iterator;
-      
-      // Skip processing this layer if it's not visible or that is not valid.
-      // NOTE: Layers that are not valid include the layers that are currently
-      // under construction.
-      if ( !layer->is_visible( viewer_id ) || !layer->has_valid_data() )
-      {
-        continue;
-      }
-
-      LayerSceneItemHandle layer_scene_item;
-
-      switch( layer->get_type() )
-      {
-      case Core::VolumeType::DATA_E:
-        {
-          DataLayer* data_layer = dynamic_cast< DataLayer* >( layer.get() );
-          DataLayerSceneItem* data_layer_scene_item = new DataLayerSceneItem;
-          layer_scene_item = LayerSceneItemHandle( data_layer_scene_item );
-          data_layer_scene_item->data_min_ = data_layer->min_value_state_->get();
-          data_layer_scene_item->data_max_ = data_layer->max_value_state_->get();
-          data_layer_scene_item->display_min_ = data_layer->display_min_value_state_->get();
-          data_layer_scene_item->display_max_ = data_layer->display_max_value_state_->get();
-          if ( data_layer_scene_item->display_min_ > data_layer_scene_item->display_max_ )
-          {
-            std::swap( data_layer_scene_item->display_min_, data_layer_scene_item->display_max_ );
-          }
-          data_layer_scene_item->volume_rendered_ = data_layer->
-            volume_rendered_state_->get();
-        }
-        break;
-      case Core::VolumeType::MASK_E:
-        {
-          MaskLayer* mask_layer = dynamic_cast< MaskLayer* >( layer.get() );
-          MaskLayerSceneItem* mask_layer_scene_item = new MaskLayerSceneItem;
-          layer_scene_item = LayerSceneItemHandle( mask_layer_scene_item );
-          mask_layer_scene_item->color_ = mask_layer->color_state_->get();
-          mask_layer_scene_item->border_ = mask_layer->border_state_->index();
-          mask_layer_scene_item->fill_ = mask_layer->fill_state_->index();
-          mask_layer_scene_item->show_isosurface_ = mask_layer->
-            show_isosurface_state_->get();
-        }
-        break;
-      case Core::VolumeType::LARGE_DATA_E:
-        {
-          LargeVolumeLayer* lv_layer = dynamic_cast<LargeVolumeLayer*>(layer.get());
-          LargeVolumeLayerSceneItem* lv_layer_scene_item = new LargeVolumeLayerSceneItem;
-          layer_scene_item = LayerSceneItemHandle(lv_layer_scene_item);
-          lv_layer_scene_item->data_min_ = lv_layer->min_value_state_->get();
-          lv_layer_scene_item->data_max_ = lv_layer->max_value_state_->get();
-          lv_layer_scene_item->display_min_ = lv_layer->display_min_value_state_->get();
-          lv_layer_scene_item->display_max_ = lv_layer->display_max_value_state_->get();
-          if (lv_layer_scene_item->display_min_ > lv_layer_scene_item->display_max_)
-          {
-            std::swap(lv_layer_scene_item->display_min_, lv_layer_scene_item->display_max_);
-          }
-        }
-        break;
-      default:
-        CORE_THROW_LOGICERROR("Unknow layer type");
-        break;
-      } // end switch
-
-      layer_scene_item->layer_id_ = layer->get_layer_id();
-      layer_scene_item->layer_ = layer;
-      layer_scene_item->opacity_ = layer->opacity_state_->get();
-      layer_scene_item->grid_transform_ = layer->get_grid_transform();
-
-      layer_scene->push_back( layer_scene_item );
-    } // end for each layer
-
-  } // end for each group
+      // NOTE: The renderer modifies the items, hence each scene gets its own copy
+      layer_scene->push_back( LayerSceneItemHandle( snapshot->items_[ i ]->clone() ) );
+    }
+  }
 
   return layer_scene;
 }
@@ -849,24 +1107,26 @@ LayerSceneHandle LayerManager::compose_layer_scene( size_t viewer_id )
 Core::BBox LayerManager::get_layers_bbox()
 {
   // NOTE: This functions is called from the Rendering Thread
-  // Lock the LayerManager
-  lock_type lock( this->get_mutex() );
+  return this->private_->get_layer_scene_snapshot()->bbox_;
+}
 
-  Core::BBox bbox;
-  GroupList::iterator group_iterator = this->private_->group_list_.begin();
-  for ( ; group_iterator != this->private_->group_list_.end(); group_iterator++)
-  {
-    LayerGroupHandle group = *group_iterator;
-    const Core::GridTransform& grid_trans = group->get_grid_transform();
-    Core::Point pt( -0.5, -0.5, -0.5 );
-    bbox.extend( grid_trans * pt );
-    pt = Core::Point( static_cast< double >( grid_trans.get_nx() - 0.5 ), 
-      static_cast< double >( grid_trans.get_ny() - 0.5 ), 
-      static_cast< double >( grid_trans.get_nz() - 0.5 ) );
-    bbox.extend( grid_trans * pt );
-  }
+ViewerSceneInfoHandle LayerManager::get_viewer_scene_info( size_t viewer_id )
+{
+  // NOTE: This functions is called from the Rendering Thread
+  LayerSceneSnapshotHandle snapshot = this->private_->get_layer_scene_snapshot();
+  if ( viewer_id < snapshot->viewers_.size() ) return snapshot->viewers_[ viewer_id ];
+  return ViewerSceneInfoHandle();
+}
 
-  return bbox;
+bool LayerManager::is_layer_scene_current()
+{
+  return this->private_->get_layer_scene_snapshot()->version_ == 
+    this->private_->layer_scene_version_;
+}
+
+void LayerManager::invalidate_layer_scene()
+{
+  this->private_->invalidate_layer_scene();
 }
 
 void LayerManager::get_layer_names( std::vector< LayerIDNamePair >& layer_names, int type )
@@ -1123,6 +1383,13 @@ bool LayerManager::pre_load_states( const Core::StateIO& state_io )
     return false;
   }
 
+  // Start loading the data of all the layers in the background, so that the files are
+  // decompressed concurrently while the layers are being restored one by one.
+  std::vector< Core::DataBlock::generation_type > generations;
+  this->private_->get_session_generations( groups_element, generations );
+  LayerDataLoader::Instance()->prefetch( ProjectManager::Instance()->get_current_project()->
+    get_project_data_path(), generations );
+
   state_io.push_current_element();
   state_io.set_current_element( groups_element );
 
@@ -1152,6 +1419,8 @@ bool LayerManager::pre_load_states( const Core::StateIO& state_io )
         ( *it )->data_state_->state_changed_signal_.connect( boost::bind(
           &LayerManagerPrivate::handle_layer_data_changed, this->private_, LayerWeakHandle( *it ) ) );
 
+        this->private_->connect_layer_scene_states( *it );
+
         this->layer_inserted_signal_( ( *it ), first );
         first = false;
       }
@@ -1173,6 +1442,9 @@ bool LayerManager::pre_load_states( const Core::StateIO& state_io )
 
 bool LayerManager::post_load_states( const Core::StateIO& state_io )
 { 
+  // All layers are waiting for their data by now, files that no layer uses are not needed
+  LayerDataLoader::Instance()->release_unclaimed();
+
   // If there are layers loaded, restore the active layer state
   if ( this->private_->group_list_.size() > 0 )
   {
@@ -1628,6 +1900,31 @@ bool LayerManager::CreateCroppedLargeVolumeLayer( Core::LargeVolumeSchemaHandle
   return true;
 }
 
+bool LayerManager::CreateAndLockLargeVolumeLayer( Core::LargeVolumeSchemaHandle schema,
+  const std::string& name, LayerHandle& layer, const LayerMetaData& meta_data, 
+  filter_key_type key, SandboxID sandbox )
+{
+  // NOTE: Security check to keep the program logic sane
+  // Only the Application Thread guarantees that nothing is changed in the program
+  if ( !Core::Application::IsApplicationThread() )
+  {
+    CORE_THROW_LOGICERROR( "CreateAndLockLargeVolumeLayer can only be called from the"
+      " application thread." );
+  }
+
+  // NOTE: The layer is not valid until the filter has written all the bricks of the schema
+  layer.reset( new LargeVolumeLayer( name, schema, true ) );
+
+  // Insert the key used to keep track of which process is using this layer
+  layer->add_filter_key( key );
+
+  layer->set_meta_data( meta_data );
+
+  LayerManager::Instance()->insert_layer( layer, sandbox );
+
+  return true;
+}
+
 void LayerManager::DispatchDeleteLayer( LayerHandle layer, filter_key_type key, SandboxID sandbox )
 {
   // Move this request to the Application thread
@@ -1758,6 +2055,31 @@ void LayerManager::DispatchInsertDataVolumeIntoLayer( DataLayerHandle layer,
   }
 }
 
+void LayerManager::DispatchInsertLargeVolumeIntoLayer( LargeVolumeLayerHandle layer, 
+  ProvenanceID prov_id, filter_key_type key, SandboxID sandbox )
+{
+  // Move this request to the Application thread
+  if ( !( Core::Application::IsApplicationThread() ) )
+  {
+    Core::Application::PostEvent( boost::bind( 
+      &LayerManager::DispatchInsertLargeVolumeIntoLayer, layer, prov_id, key, sandbox ) );
+    return;
+  }
+  
+  // Only do work if the unique key is a match
+  if ( layer->check_filter_key( key ) )
+  {
+    layer->finish_creating();
+    layer->provenance_id_state_->set( prov_id );
+    // Only trigger signals if not in a sandbox
+    if ( sandbox == -1 )
+    {
+      LayerManager::Instance()->layer_volume_changed_signal_( layer );
+      LayerManager::Instance()->layers_changed_signal_();
+    }
+  }
+}
+
 void LayerManager::DispatchInsertMaskVolumeIntoLayer( MaskLayerHandle layer, 
   Core::MaskVolumeHandle mask, ProvenanceID prov_id, filter_key_type key, SandboxID sandbox )
 {
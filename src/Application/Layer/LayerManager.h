@@ -158,6 +158,7 @@ private:
   friend class ActionRecreateLayer;
   friend class LayerUndoBufferItem;
   friend class LayerRecreationUndoBufferItem;
+  friend class LayerActionBatchPrivate;
 
   /// INSERT_LAYER:
   /// This function returns true when it successfully inserts a layer
@@ -218,12 +219,26 @@ private:
   bool delete_sandbox( SandboxID sandbox );
 
 public:
-  /// Take an atomic snapshot of visual properties of layers for rendering in the specified viewer
+  /// Take an atomic snapshot of visual properties of layers for rendering in the specified viewer.
+  /// It is copied from the last snapshot that the application thread published, hence it does
+  /// not need the state lock.
   LayerSceneHandle compose_layer_scene( size_t viewer_id );
 
+  /// Get the properties of a viewer from the last published snapshot. Returns an empty handle
+  /// if no snapshot with the viewer has been published yet.
+  ViewerSceneInfoHandle get_viewer_scene_info( size_t viewer_id );
+
   /// Get the bounding box of all layers
   Core::BBox get_layers_bbox();
 
+  /// IS_LAYER_SCENE_CURRENT:
+  /// Whether the last published snapshot includes all the changes made so far.
+  bool is_layer_scene_current();
+
+  /// INVALIDATE_LAYER_SCENE:
+  /// Schedule a new snapshot after a change to a property it copies, e.g. a viewer state.
+  void invalidate_layer_scene();
+
   // -- locking --
 public: 
   typedef Core::StateEngine::mutex_type mutex_type;
@@ -298,6 +313,10 @@ public:
   /// are being locked for processing and when new data will be available
   boost::signals2::signal< void ( LayerHandle ) > layer_data_changed_signal_;
 
+  /// LAYER_SCENE_UPDATED_SIGNAL:
+  /// Triggered on the application thread after a new layer scene snapshot is published.
+  boost::signals2::signal< void () > layer_scene_updated_signal_;
+
   /// SANDBOX_CREATED_SIGNAL_:
   /// Triggered when a sandbox has been created.
   boost::signals2::signal< void ( SandboxID ) > sandbox_created_signal_;
@@ -497,6 +516,14 @@ public:
   static bool CreateCroppedLargeVolumeLayer( Core::LargeVolumeSchemaHandle schema,
     const Core::GridTransform& crop_trans, const std::string& name,
     LayerHandle& layer, const LayerMetaData& meta_data, SandboxID sandbox = -1 );
+
+  /// CREATEANDLOCKLARGEVOLUMELAYER:
+  /// Create a layer for a large volume whose bricks still need to be written and lock it 
+  /// into the CREATING_C mode.
+  /// NOTE: This function can *only* be called from the Application thread.
+  static bool CreateAndLockLargeVolumeLayer( Core::LargeVolumeSchemaHandle schema,
+    const std::string& name, LayerHandle& layer, const LayerMetaData& meta_data, 
+    filter_key_type key = filter_key_type( 0 ), SandboxID sandbox = -1 );
   
   // == functions for setting data and unlocking layers ==
 
@@ -527,6 +554,12 @@ public:
     Core::DataVolumeHandle data, ProvenanceID provid, 
     filter_key_type key = filter_key_type( 0 ), SandboxID sandbox = -1 );
 
+  /// DISPATCHINSERTLARGEVOLUMEINTOLAYER:
+  /// Mark the volume of a large volume layer as written, once all of its bricks are. This
+  /// function will relay a call to the Application thread if needed.
+  static void DispatchInsertLargeVolumeIntoLayer( LargeVolumeLayerHandle layer, 
+    ProvenanceID provid, filter_key_type key = filter_key_type( 0 ), SandboxID sandbox = -1 );
+
   /// DISPATCHINSERTMASKVOLUMEINTOLAYER:
   /// Insert a mask volume into a mask layer. This function will relay a call to the 
   /// Application thread if needed.
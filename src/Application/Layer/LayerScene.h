@@ -29,11 +29,15 @@
 #ifndef APPLICATION_LAYER_LAYERSCENE_H
 #define APPLICATION_LAYER_LAYERSCENE_H
 
+#include <map>
+#include <string>
 #include <vector>
 #include <boost/shared_ptr.hpp>
 
 #include <Application/Layer/Layer.h>
 
+#include <Core/Geometry/Color.h>
+#include <Core/Geometry/View2D.h>
 #include <Core/Volume/DataVolume.h>
 #include <Core/Volume/DataVolumeSlice.h>
 #include <Core/Volume/LargeVolumeBrickSlice.h>
@@ -51,11 +55,16 @@ public:
 
   virtual Core::VolumeType type() = 0;
 
+  // CLONE:
+  // Copy the item, so a shared copy can be handed to a renderer that modifies it.
+  virtual LayerSceneItem* clone() const = 0;
+
 public:
   std::string layer_id_;
   double opacity_;
   LayerHandle layer_;
   Core::GridTransform grid_transform_;
+  std::vector< bool > visible_; // Whether the layer is visible in each of the viewers
   Core::VolumeSliceHandle volume_slice_; // This value is set and used by Renderer
 };
 
@@ -70,6 +79,11 @@ public:
     return Core::VolumeType::DATA_E;
   }
 
+  virtual LayerSceneItem* clone() const
+  {
+    return new DataLayerSceneItem( *this );
+  }
+
 public:
   double data_min_;
   double data_max_;
@@ -89,6 +103,11 @@ public:
     return Core::VolumeType::LARGE_DATA_E;
   }
 
+  virtual LayerSceneItem* clone() const
+  {
+    return new LargeVolumeLayerSceneItem( *this );
+  }
+
 public:
   double data_min_;
   double data_max_;
@@ -108,6 +127,11 @@ public:
     return Core::VolumeType::MASK_E;
   }
 
+  virtual LayerSceneItem* clone() const
+  {
+    return new MaskLayerSceneItem( *this );
+  }
+
 public:
   int color_;
   int border_;
@@ -115,6 +139,31 @@ public:
   bool show_isosurface_;
 };
 
+// CLASS ViewerSceneInfo:
+// The properties of a viewer that the renderers need. They are copied together with the layer
+// scene, so a renderer can read them without taking the state lock.
+class ViewerSceneInfo
+{
+public:
+  typedef std::map< std::string, Core::VolumeSliceHandle > volume_slice_map_type;
+
+  std::string view_mode_;
+  bool volume_view_;
+  bool viewer_visible_;
+  bool slice_visible_;
+
+  // Color the viewer is cleared with, copied from the preferences
+  Core::Color background_color_;
+
+  // The active 2D view, it is not set for a volume view
+  Core::View2D view2d_;
+
+  // The slices of the viewer by layer ID
+  // NOTE: These are the slices of the viewer itself, which lock themselves when they are
+  // changed, so a renderer can upload and clone them.
+  volume_slice_map_type volume_slices_;
+};
+
 } // end namespace Seg3D
 
 #endif
\ No newline at end of file
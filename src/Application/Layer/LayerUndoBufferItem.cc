@@ -26,6 +26,9 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+// STL includes
+#include <algorithm>
+
 // Application includes
 #include <Application/Layer/LayerGroup.h>
 #include <Application/Layer/LayerUndoBufferItem.h>
@@ -167,6 +170,36 @@ void LayerUndoBufferItem::add_layer_to_restore( LayerHandle layer,
   this->private_->layers_to_restore_.push_back( std::make_pair( layer, checkpoint ) );
 }
 
+bool LayerUndoBufferItem::uses_layer( LayerHandle layer ) const
+{
+  if ( std::find( this->private_->layers_to_delete_.begin(), 
+    this->private_->layers_to_delete_.end(), layer ) != this->private_->layers_to_delete_.end() )
+  {
+    return true;
+  }
+
+  for ( size_t j = 0; j < this->private_->layers_to_restore_.size(); j++ )
+  {
+    if ( this->private_->layers_to_restore_[ j ].first == layer ) return true;
+  }
+
+  std::map< size_t, LayerDeletionUndoRecordHandle >::const_iterator group_it = 
+    this->private_->layers_to_add_.begin();
+  while ( group_it != this->private_->layers_to_add_.end() )
+  {
+    const std::map< size_t, LayerHandle >& layer_pos_map = ( *group_it ).second->layer_pos_map_;
+    std::map< size_t, LayerHandle >::const_iterator layer_it = layer_pos_map.begin();
+    while ( layer_it != layer_pos_map.end() )
+    {
+      if ( ( *layer_it ).second == layer ) return true;
+      ++layer_it;
+    }
+    ++group_it;
+  }
+
+  return false;
+}
+
 void LayerUndoBufferItem::rollback_layer_changes()
 {
   // Step 1: 
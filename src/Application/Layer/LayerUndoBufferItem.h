@@ -94,6 +94,10 @@ public:
   /// Set the provenance record ID associated with the action.
   void set_provenance_step_ids( const std::vector< ProvenanceStepID >& step_ids );
 
+  /// USES_LAYER:
+  /// Whether the item deletes, adds back or restores the layer when it is undone.
+  bool uses_layer( LayerHandle layer ) const;
+
   /// ROLLBACK_LAYER_CHANGES:
   /// Abort corresponding filters (if any) and rollback all the layer changes.
   /// NOTE: This function should only be called by LayerFilter when aborted by the user.
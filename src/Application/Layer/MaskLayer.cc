@@ -29,10 +29,12 @@
 // STL includes
 
 // Boost includes 
+#include <boost/bind.hpp>
 
 // Core includes
 #include <Core/Application/Application.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/Interface/Interface.h>
 #include <Core/Utils/AtomicCounter.h>
 #include <Core/Utils/StringUtil.h>
 #include <Core/Utils/Log.h>
@@ -40,7 +42,10 @@
 
 // Application includes
 #include <Application/Layer/MaskLayer.h>
+#include <Application/Layer/LayerDataLoader.h>
+#include <Application/Layer/LayerGroup.h>
 #include <Application/Layer/LayerManager.h>
+#include <Application/Layer/Actions/ActionComputeIsosurface.h>
 #include <Application/PreferencesManager/PreferencesManager.h>
 #include <Application/ProjectManager/ProjectManager.h>
 
@@ -57,6 +62,27 @@ public:
   void handle_isosurface_update_progress( double progress );
   void update_mask_info();
 
+  // CREATE_MASK_VOLUME:
+  // Create the mask volume from the data block of the generation and bit of the layer. If the
+  // data block is not known yet, it is registered from the loaded volume.
+  bool create_mask_volume( Core::DataVolumeHandle data_volume );
+
+  // LOAD_DATA_IN_BACKGROUND:
+  // If the data of the layer is being loaded in the background, restore the layer without its
+  // data and keep it locked until the data arrives.
+  bool load_data_in_background( const boost::filesystem::path& data_path, 
+    Core::DataBlock::generation_type generation );
+
+  // FINISH_LOADING_DATA:
+  // Insert the data that was loaded in the background and unlock the layer.
+  void finish_loading_data( bool success, Core::DataVolumeHandle volume, 
+    const std::string& error );
+
+  // HANDLEDATALOADED:
+  // Called on the application thread when the data of a layer has been loaded.
+  static void HandleDataLoaded( const std::string& layer_id, Layer::filter_key_type key,
+    bool success, Core::DataVolumeHandle volume, std::string error );
+
   // Extra private state information
   // NOTE: This used for saving the bit that is used in a mask to a session file. As the state
   // variables are read first, this will allow for reconstructing which data block and which bit
@@ -68,6 +94,9 @@ public:
   Core::IsosurfaceHandle isosurface_;
 
   MaskLayer * layer_;
+
+  // Key that locks the layer while its data is being loaded, zero otherwise
+  Layer::filter_key_type load_key_;
 };
 
 // counter for generating new colors for each new mask
@@ -149,6 +178,119 @@ void MaskLayerPrivate::update_mask_info()
   this->layer_->max_value_state_->set( this->mask_volume_->get_max() );
 }
 
+bool MaskLayerPrivate::create_mask_volume( Core::DataVolumeHandle data_volume )
+{
+  Core::DataBlock::generation_type generation = this->layer_->generation_state_->get();
+  unsigned int bit = static_cast< unsigned int >( this->bit_state_->get() );
+  Core::MaskDataBlockHandle mask_data_block;
+  Core::GridTransform grid_transform;
+  bool success = Core::MaskDataBlockManager::Instance()->
+    create( generation, bit, grid_transform, mask_data_block );
+  if ( !success && data_volume )
+  {
+    data_volume->register_data( generation );
+    Core::MaskDataBlockManager::Instance()->register_data_block( 
+      data_volume->get_data_block(), data_volume->get_grid_transform() );
+    success = Core::MaskDataBlockManager::Instance()->
+      create( generation, bit, grid_transform, mask_data_block );
+  }
+  if ( !success ) return false;
+
+  {
+    Layer::lock_type lock( Layer::GetMutex() );
+    this->mask_volume_ = Core::MaskVolumeHandle( new Core::MaskVolume( 
+      grid_transform, mask_data_block ) );
+  }
+  this->layer_->add_connection( this->mask_volume_->get_mask_data_block()->mask_updated_signal_.
+    connect( boost::bind( &MaskLayerPrivate::handle_mask_data_changed, this ) ) );
+  this->update_mask_info();
+  return true;
+}
+
+bool MaskLayerPrivate::load_data_in_background( const boost::filesystem::path& data_path, 
+  Core::DataBlock::generation_type generation )
+{
+  // The size and transform of the layer are needed right away
+  Core::GridTransform grid_transform;
+  std::string error;
+  if ( !Core::DataVolume::LoadGridTransform( data_path / 
+    ( Core::ExportToString( generation ) + ".nrrd" ), grid_transform, error ) )
+  {
+    return false;
+  }
+
+  Layer::filter_key_type key = Layer::GenerateFilterKey();
+  if ( !LayerDataLoader::Instance()->load_data_volume_in_background( data_path, generation, 
+    this->layer_->get_layer_id(), boost::bind( &MaskLayerPrivate::HandleDataLoaded, 
+    this->layer_->get_layer_id(), key, _1, _2, _3 ) ) )
+  {
+    return false;
+  }
+
+  Core::MaskVolume::CreateInvalidMask( grid_transform, this->mask_volume_ );
+  this->load_key_ = key;
+  this->layer_->add_filter_key( key );
+  this->layer_->data_state_->set( Layer::CREATING_C );
+  return true;
+}
+
+void MaskLayerPrivate::finish_loading_data( bool success, Core::DataVolumeHandle volume, 
+  const std::string& error )
+{
+  Layer::filter_key_type key = this->load_key_;
+  this->load_key_ = 0;
+  LayerHandle layer = LayerManager::FindLayer( this->layer_->get_layer_id() );
+
+  // Keep the transform of the placeholder, as the layer group may have adjusted it
+  Core::GridTransform grid_transform = this->layer_->get_grid_transform();
+  if ( !success || !this->create_mask_volume( volume ) )
+  {
+    CORE_LOG_ERROR( success ? "Could not create mask '" + this->layer_->get_layer_name() + 
+      "'." : error );
+    // NOTE: The layer is deleted, as it would not have been restored if its data had been 
+    // loaded up front. This is posted as the layer may be saved right now.
+    if ( layer )
+    {
+      Core::Application::PostEvent( boost::bind( &LayerManager::DispatchUnlockOrDeleteLayer,
+        layer, key, -1 ) );
+    }
+    return;
+  }
+  this->layer_->set_grid_transform( grid_transform, true );
+
+  if ( !layer )
+  {
+    this->layer_->remove_filter_key( key );
+    this->layer_->data_state_->set( Layer::AVAILABLE_C );
+    return;
+  }
+
+  LayerManager::Instance()->layer_volume_changed_signal_( layer );
+  LayerManager::Instance()->layers_changed_signal_();
+  LayerManager::DispatchUnlockLayer( layer, key, -1 );
+
+  // The isosurface could not be restored without the data
+  LayerGroupHandle group = layer->get_layer_group();
+  if ( this->layer_->iso_generated_state_->get() && group )
+  {
+    double quality = 1.0;
+    Core::ImportFromString( group->isosurface_quality_state_->get(), quality );
+    ActionComputeIsosurface::Dispatch( Core::Interface::GetWidgetActionContext(), 
+      boost::dynamic_pointer_cast< MaskLayer >( layer ), quality, 
+      group->isosurface_capping_enabled_state_->get() );
+  }
+}
+
+void MaskLayerPrivate::HandleDataLoaded( const std::string& layer_id, Layer::filter_key_type key,
+  bool success, Core::DataVolumeHandle volume, std::string error )
+{
+  MaskLayerHandle layer = LayerManager::FindMaskLayer( layer_id );
+
+  // NOTE: The data may have been inserted already when the layer was saved
+  if ( !layer || layer->private_->load_key_ != key ) return;
+  layer->private_->finish_loading_data( success, volume, error );
+}
+
 MaskLayer::MaskLayer( const std::string& name, const Core::MaskVolumeHandle& volume ) :
   Layer( name, !( volume->is_valid() ) ), 
   private_( new MaskLayerPrivate )
@@ -156,6 +298,7 @@ MaskLayer::MaskLayer( const std::string& name, const Core::MaskVolumeHandle& vol
   this->private_->mask_volume_ = volume;
   this->private_->mask_volume_->register_data();
   this->private_->layer_ = this;
+  this->private_->load_key_ = 0;
   
   this->private_->initialize_states();
   
@@ -172,6 +315,7 @@ MaskLayer::MaskLayer( const std::string& state_id ) :
   private_( new MaskLayerPrivate )
 {
   this->private_->layer_ = this;
+  this->private_->load_key_ = 0;
   this->private_->initialize_states();
 }
 
@@ -284,6 +428,18 @@ bool MaskLayer::set_mask_volume( Core::MaskVolumeHandle volume )
 
 bool MaskLayer::pre_save_states( Core::StateIO& state_io )
 {
+  // Data that is still being loaded in the background is needed now
+  if ( this->private_->load_key_ != 0 )
+  {
+    Core::DataVolumeHandle volume;
+    std::string error;
+    bool success = LayerDataLoader::Instance()->load_data_volume( ProjectManager::Instance()->
+      get_current_project()->get_project_data_path(), this->generation_state_->get(), 
+      volume, error );
+    this->private_->finish_loading_data( success, volume, error );
+    if ( !this->has_valid_data() ) return false;
+  }
+
   long long generation_number = this->get_mask_volume()->get_generation();
   this->generation_state_->set( generation_number );
 
@@ -318,38 +474,26 @@ bool MaskLayer::pre_save_states( Core::StateIO& state_io )
 
 bool MaskLayer::post_load_states( const Core::StateIO& state_io )
 {
-  Core::DataBlock::generation_type generation = this->generation_state_->get();
-  unsigned int bit = static_cast< unsigned int >( this->private_->bit_state_->get() );
-  Core::MaskDataBlockHandle mask_data_block;
-  Core::GridTransform grid_transform;
-  bool success = Core::MaskDataBlockManager::Instance()->
-    create( generation, bit, grid_transform, mask_data_block );
+  // Masks of the same generation share one data block, which may already be loaded
+  bool success = this->private_->create_mask_volume( Core::DataVolumeHandle() );
   if ( !success )
   {
+    Core::DataBlock::generation_type generation = this->generation_state_->get();
     Core::DataVolumeHandle data_volume;
-    boost::filesystem::path volume_path = ProjectManager::Instance()->get_current_project()->
-      get_project_data_path() / ( this->generation_state_->export_to_string() + ".nrrd" );
+    boost::filesystem::path data_path = ProjectManager::Instance()->get_current_project()->
+      get_project_data_path();
     std::string error;
 
-    if( Core::DataVolume::LoadDataVolume( volume_path, data_volume, error ) )
+    // NOTE: If the data is being loaded in the background, the layer is restored right away 
+    // and receives its data later
+    success = this->private_->load_data_in_background( data_path, generation );
+    if ( !success && LayerDataLoader::Instance()->load_data_volume( data_path, generation, 
+      data_volume, error ) )
     {
-      data_volume->register_data( generation );
-      Core::MaskDataBlockManager::Instance()->register_data_block( 
-        data_volume->get_data_block(), data_volume->get_grid_transform() );
-      success = Core::MaskDataBlockManager::Instance()->
-        create( generation, bit, grid_transform, mask_data_block );
+      success = this->private_->create_mask_volume( data_volume );
     }
   }
 
-  if ( success )
-  {
-    this->private_->mask_volume_ = Core::MaskVolumeHandle( new Core::MaskVolume( 
-      grid_transform, mask_data_block ) );
-    this->add_connection( this->private_->mask_volume_->get_mask_data_block()->mask_updated_signal_.
-      connect( boost::bind( &MaskLayerPrivate::handle_mask_data_changed, this->private_ ) ) );
-    this->private_->update_mask_info();
-  }
-
   // If the layer didn't have a valid provenance ID, generate one
   if ( this->provenance_id_state_->get() < 0 )
   {
@@ -52,6 +52,7 @@ typedef boost::shared_ptr< MaskLayerPrivate > MaskLayerPrivateHandle;
 // Class definition
 class MaskLayer : public Layer
 {
+  friend class MaskLayerPrivate;
 
   // -- constructor/destructor --
 public:
@@ -0,0 +1,319 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <Core/Utils/StringUtil.h>
+
+#include <Application/Layer/LayerActionBatchGraph.h>
+
+using namespace Seg3D;
+
+// Split a comma separated list of layer ids
+static std::vector< std::string > layerIDs( const std::string& str )
+{
+  return Core::SplitString( str, "," );
+}
+
+// Get the names of the steps a step depends on
+static std::string dependencies( const LayerActionBatchGraph& graph, const std::string& name )
+{
+  std::vector< size_t > steps = graph.get_dependencies( graph.find_step( name ) );
+  std::string result;
+  for ( size_t j = 0; j < steps.size(); j++ )
+  {
+    if ( j > 0 ) result += ",";
+    result += graph.get_step_name( steps[ j ] );
+  }
+  return result;
+}
+
+// Add a step that only uses its layers
+static void addReader( LayerActionBatchGraph& graph, const std::string& name, 
+  const std::string& layer_ids, bool keep = false )
+{
+  std::string error;
+  ASSERT_TRUE( graph.add_step( name, layerIDs( layer_ids ), std::vector< std::string >(), 
+    keep, error ) ) << error;
+}
+
+// Add a step that changes all its layers in place
+static void addWriter( LayerActionBatchGraph& graph, const std::string& name,
+  const std::string& layer_ids )
+{
+  std::string error;
+  ASSERT_TRUE( graph.add_step( name, layerIDs( layer_ids ), layerIDs( layer_ids ), 
+    false, error ) ) << error;
+}
+
+TEST(LayerActionBatchGraphTest, StepReferences)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1" );
+  addReader( graph, "b", "$a" );
+  addReader( graph, "c", "$b,$a" );
+
+  EXPECT_EQ( "", dependencies( graph, "a" ) );
+  EXPECT_EQ( "a", dependencies( graph, "b" ) );
+  EXPECT_EQ( "b,a", dependencies( graph, "c" ) );
+}
+
+TEST(LayerActionBatchGraphTest, InvalidSteps)
+{
+  LayerActionBatchGraph graph;
+  std::string error;
+  addReader( graph, "a", "layer_1" );
+
+  EXPECT_FALSE( graph.add_step( "", layerIDs( "layer_1" ), std::vector< std::string >(), 
+    false, error ) );
+  EXPECT_FALSE( graph.add_step( "a", layerIDs( "layer_1" ), std::vector< std::string >(), 
+    false, error ) );
+  EXPECT_FALSE( graph.add_step( "b", layerIDs( "$c" ), std::vector< std::string >(), 
+    false, error ) );
+  EXPECT_EQ( 1u, graph.get_num_steps() );
+  EXPECT_EQ( -1, graph.find_step( "b" ) );
+}
+
+TEST(LayerActionBatchGraphTest, ExistingLayersAreShared)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1" );
+  addReader( graph, "b", "layer_1,layer_2" );
+  addReader( graph, "c", "<none>,layer_2" );
+
+  std::vector< size_t > ready;
+  graph.reset( ready );
+  EXPECT_EQ( 3u, ready.size() );
+}
+
+TEST(LayerActionBatchGraphTest, ReadAfterWrite)
+{
+  LayerActionBatchGraph graph;
+  addWriter( graph, "replace", "layer_1" );
+  addReader( graph, "read", "layer_1" );
+  addReader( graph, "other", "layer_2" );
+
+  EXPECT_EQ( "replace", dependencies( graph, "read" ) );
+  EXPECT_EQ( "", dependencies( graph, "other" ) );
+}
+
+TEST(LayerActionBatchGraphTest, WriteAfterRead)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "read1", "layer_1" );
+  addReader( graph, "read2", "layer_2,layer_1" );
+  addWriter( graph, "paint", "layer_1" );
+  addReader( graph, "read3", "layer_1" );
+
+  EXPECT_EQ( "read1,read2", dependencies( graph, "paint" ) );
+  EXPECT_EQ( "paint", dependencies( graph, "read3" ) );
+}
+
+TEST(LayerActionBatchGraphTest, WriteAfterWrite)
+{
+  LayerActionBatchGraph graph;
+  addWriter( graph, "paint1", "layer_1" );
+  addWriter( graph, "paint2", "layer_1" );
+
+  EXPECT_EQ( "paint1", dependencies( graph, "paint2" ) );
+}
+
+TEST(LayerActionBatchGraphTest, PartialWrite)
+{
+  // A filter that changes its target in place, but only reads its mask
+  LayerActionBatchGraph graph;
+  std::string error;
+  addReader( graph, "read", "layer_1,layer_2" );
+  ASSERT_TRUE( graph.add_step( "mask", layerIDs( "layer_1,layer_2" ), layerIDs( "layer_1" ), 
+    false, error ) ) << error;
+  addReader( graph, "read_mask", "layer_2" );
+  addReader( graph, "read_target", "layer_1" );
+
+  EXPECT_EQ( "read", dependencies( graph, "mask" ) );
+  EXPECT_EQ( "", dependencies( graph, "read_mask" ) );
+  EXPECT_EQ( "mask", dependencies( graph, "read_target" ) );
+}
+
+TEST(LayerActionBatchGraphTest, ReplaceStepOutput)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1" );
+  addReader( graph, "b", "$a" );
+  addWriter( graph, "c", "$a" );
+  addReader( graph, "d", "$a" );
+
+  EXPECT_EQ( "a,b", dependencies( graph, "c" ) );
+  EXPECT_EQ( "c", dependencies( graph, "d" ) );
+}
+
+TEST(LayerActionBatchGraphTest, RunOrder)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1" );
+  addWriter( graph, "b", "layer_1" );
+  addReader( graph, "c", "layer_2" );
+  addReader( graph, "d", "layer_1,layer_2" );
+
+  std::vector< size_t > ready;
+  std::vector< std::string > unused;
+  graph.reset( ready );
+  ASSERT_EQ( 2u, ready.size() );
+  EXPECT_EQ( 0u, ready[ 0 ] );
+  EXPECT_EQ( 2u, ready[ 1 ] );
+
+  graph.finish_step( 2, ready, unused );
+  EXPECT_TRUE( ready.empty() );
+  graph.finish_step( 0, ready, unused );
+  ASSERT_EQ( 1u, ready.size() );
+  EXPECT_EQ( 1u, ready[ 0 ] );
+  graph.finish_step( 1, ready, unused );
+  ASSERT_EQ( 1u, ready.size() );
+  EXPECT_EQ( 3u, ready[ 0 ] );
+}
+
+TEST(LayerActionBatchGraphTest, Substitution)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1" );
+  addReader( graph, "b_2", "layer_1" );
+
+  std::vector< size_t > ready;
+  std::vector< std::string > unused;
+  graph.reset( ready );
+
+  // References to steps that are not done and other layer ids are left alone
+  EXPECT_EQ( layerIDs( "$a" ), graph.substitute_outputs( "$a" ) );
+  EXPECT_EQ( layerIDs( "layer_1" ), graph.substitute_outputs( "layer_1" ) );
+  EXPECT_EQ( layerIDs( "$x" ), graph.substitute_outputs( "$x" ) );
+
+  graph.set_output_layer_ids( 0, layerIDs( "layer_2" ) );
+  graph.finish_step( 0, ready, unused );
+  EXPECT_EQ( layerIDs( "layer_2" ), graph.substitute_outputs( "$a" ) );
+
+  graph.set_output_layer_ids( 1, layerIDs( "layer_3,layer_4" ) );
+  graph.finish_step( 1, ready, unused );
+  EXPECT_EQ( layerIDs( "layer_3,layer_4" ), graph.substitute_outputs( "$b_2" ) );
+
+  // Only whole layer ids are references
+  EXPECT_EQ( layerIDs( "$a_2" ), graph.substitute_outputs( "$a_2" ) );
+
+  // A new run forgets the outputs of the previous one
+  graph.reset( ready );
+  EXPECT_EQ( layerIDs( "$a" ), graph.substitute_outputs( "$a" ) );
+}
+
+TEST(LayerActionBatchGraphTest, IntermediateDeletion)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1" );
+  addReader( graph, "b", "$a" );
+  addReader( graph, "c", "$a" );
+  addReader( graph, "d", "$b" );
+
+  std::vector< size_t > ready;
+  std::vector< std::string > unused;
+  graph.reset( ready );
+
+  graph.set_output_layer_ids( 0, layerIDs( "layer_2,layer_3" ) );
+  graph.finish_step( 0, ready, unused );
+  EXPECT_TRUE( unused.empty() );
+
+  graph.set_output_layer_ids( 1, layerIDs( "layer_4" ) );
+  graph.finish_step( 1, ready, unused );
+  EXPECT_TRUE( unused.empty() );
+
+  graph.set_output_layer_ids( 2, layerIDs( "layer_5" ) );
+  graph.finish_step( 2, ready, unused );
+  EXPECT_EQ( layerIDs( "layer_2,layer_3" ), unused );
+
+  // The output of the last step is not used by any step and is kept
+  graph.set_output_layer_ids( 3, layerIDs( "layer_6" ) );
+  graph.finish_step( 3, ready, unused );
+  EXPECT_EQ( layerIDs( "layer_4" ), unused );
+}
+
+TEST(LayerActionBatchGraphTest, KeepIntermediate)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1", true );
+  addReader( graph, "b", "$a" );
+
+  std::vector< size_t > ready;
+  std::vector< std::string > unused;
+  graph.reset( ready );
+
+  graph.set_output_layer_ids( 0, layerIDs( "layer_2" ) );
+  graph.finish_step( 0, ready, unused );
+  graph.set_output_layer_ids( 1, layerIDs( "layer_3" ) );
+  graph.finish_step( 1, ready, unused );
+  EXPECT_TRUE( unused.empty() );
+}
+
+TEST(LayerActionBatchGraphTest, ReplacedIntermediate)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1" );
+  addWriter( graph, "b", "$a" );
+  addReader( graph, "c", "$b" );
+
+  std::vector< size_t > ready;
+  std::vector< std::string > unused;
+  graph.reset( ready );
+
+  // A filter that replaces its input outputs the same layer, which is still needed by c
+  graph.set_output_layer_ids( 0, layerIDs( "layer_2" ) );
+  graph.finish_step( 0, ready, unused );
+  graph.set_output_layer_ids( 1, layerIDs( "layer_2" ) );
+  graph.finish_step( 1, ready, unused );
+  EXPECT_TRUE( unused.empty() );
+
+  graph.set_output_layer_ids( 2, layerIDs( "layer_3" ) );
+  graph.finish_step( 2, ready, unused );
+  EXPECT_EQ( layerIDs( "layer_2" ), unused );
+}
+
+TEST(LayerActionBatchGraphTest, ReplacedOutput)
+{
+  LayerActionBatchGraph graph;
+  addReader( graph, "a", "layer_1" );
+  addWriter( graph, "b", "$a" );
+
+  std::vector< size_t > ready;
+  std::vector< std::string > unused;
+  graph.reset( ready );
+
+  // The layer is the output of b, which is not used by any step and hence kept
+  graph.set_output_layer_ids( 0, layerIDs( "layer_2" ) );
+  graph.finish_step( 0, ready, unused );
+  graph.set_output_layer_ids( 1, layerIDs( "layer_2" ) );
+  graph.finish_step( 1, ready, unused );
+  EXPECT_TRUE( unused.empty() );
+}
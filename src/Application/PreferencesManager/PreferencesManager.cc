@@ -190,6 +190,10 @@ void PreferencesManager::initialize_states()
   this->add_state( "embed_input_files_state", this->embed_input_files_state_, true );
   this->add_state( "generate_osx_project_bundle_state", this->generate_osx_project_bundle_state_, true );
 
+  // Keep the project databases in WAL mode working copies inside the project directory once a
+  // project is saved, instead of in memory. Saving copies them into the project files.
+  this->add_state( "on_disk_databases", this->on_disk_databases_state_, false );
+
   this->add_state( "reverse_slice_navigation", this->reverse_slice_navigation_state_, false );
   this->add_state( "zero_based_slice_numbers", this->zero_based_slice_numbers_state_, false );
   this->add_state( "active_layer_navigation", this->active_layer_navigation_state_, true );
@@ -85,6 +85,7 @@ public:
   Core::StateRangedDoubleHandle percent_of_memory_state_;
   Core::StateBoolHandle embed_input_files_state_;
   Core::StateBoolHandle generate_osx_project_bundle_state_;
+  Core::StateBoolHandle on_disk_databases_state_;
 
   Core::StateBoolHandle export_dicom_headers_state_;
   
@@ -27,7 +27,7 @@
  */
 
 // STL includes
-#include <queue>
+#include <map>
 #include <set>
 #include <vector>
 
@@ -37,6 +37,7 @@
 #include <boost/date_time/c_local_time_adjustor.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
 
 // Core includes
 #include <Core/Application/Application.h>
@@ -45,6 +46,7 @@
 #include <Core/Utils/FilesystemUtil.h>
 #include <Core/Utils/StringUtil.h>
 #include <Core/Utils/Log.h>
+#include <Core/Utils/Tracer.h>
 #include <Core/DataBlock/DataBlockManager.h>
 
 // Application includes
@@ -73,6 +75,7 @@ static const boost::filesystem::path DATA_DIR_C( "data" );
 static const boost::filesystem::path INPUTFILES_DIR_C( "inputfiles" );
 static const boost::filesystem::path DATABASE_DIR_C( "database" );
 static const boost::filesystem::path NOTE_DATABASE_C( "notes.sqlite" );
+static const std::string WORKING_DATABASE_EXTENSION_C( ".working" );
 
 static const std::string AUTO_SESSION_NAME_C( "Auto Save" );
 
@@ -84,7 +87,8 @@ public:
     project_( 0 ),
     changed_( false ),
     last_saved_session_time_stamp_( boost::posix_time::second_clock::local_time() ),
-    need_anonymize_( false ) 
+    need_anonymize_( false ),
+    lineage_valid_( false )
   { 
   }
 
@@ -110,6 +114,18 @@ public:
   // in the database file
   bool save_state( const boost::filesystem::path& project_directory );  
       
+  // LOAD_DATABASE:
+  // Load a project database from its file into memory. Even with the on-disk databases 
+  // preference set, the database is only moved into its file when the project is saved, so
+  // opening a project does not change its files.
+  bool load_database( DatabaseManager& database, const boost::filesystem::path& database_file );
+
+  // SAVE_DATABASE:
+  // Save a project database to its file. If the on-disk databases preference is set, the
+  // database is kept in a working copy next to that file from here on, so changes that are
+  // not saved never reach the file of the project.
+  bool save_database( DatabaseManager& database, const boost::filesystem::path& database_file );
+
   // SET_LAST_SAVED_SESSION_TIME_STAMP
   // this function updates the time of when the last session was saved
   void set_last_saved_session_time_stamp();
@@ -156,6 +172,32 @@ public:
   // Get all the provenance steps that lead to the given provenance ID.
   void get_provenance_steps( const std::vector< ProvenanceID >& prov_ids, 
     std::set< ProvenanceStepID >& prov_steps );
+
+  // BUILD_LINEAGE_INDEX:
+  // Load the lineage index from the provenance database if it is not valid.
+  // NOTE: The lineage_mutex_ needs to be locked when calling this function.
+  bool build_lineage_index();
+
+  // COLLECT_LINEAGE_STEPS:
+  // Walk the lineage index from the given provenance IDs back to the steps that generated
+  // them. Steps shared by several ancestors are only visited once.
+  // NOTE: The lineage_mutex_ needs to be locked when calling this function.
+  void collect_lineage_steps( const std::vector< ProvenanceID >& prov_ids, 
+    std::set< ProvenanceStepID >& prov_steps );
+
+  // INVALIDATE_LINEAGE_INDEX:
+  // Drop the lineage index and the cached user and action names, so they will be reloaded 
+  // from the provenance database the next time they are needed.
+  void invalidate_lineage_index();
+
+  // ADD_LINEAGE_STEP:
+  // Add a newly recorded provenance step to the lineage index.
+  void add_lineage_step( ProvenanceStepID step_id, const ProvenanceIDList& inputs,
+    const ProvenanceIDList& outputs, const ProvenanceIDList& replaced );
+
+  // REMOVE_LINEAGE_STEP:
+  // Remove a deleted provenance step from the lineage index.
+  void remove_lineage_step( ProvenanceStepID step_id );
   
   // EXTRACT_SESSION_INFO:
   // Extract session information from the database query result.
@@ -270,6 +312,35 @@ public:
   // Whether data needs to be anonymized on the next save
   bool need_anonymize_;
 
+  // CLASS LineageStep:
+  // The inputs, outputs and replaced provenance IDs of one provenance step
+  class LineageStep
+  {
+  public:
+    ProvenanceIDList inputs_;
+    ProvenanceIDList outputs_;
+    ProvenanceIDList replaced_;
+  };
+
+  typedef std::map< ProvenanceID, ProvenanceStepID > lineage_output_map_type;
+  typedef std::map< ProvenanceStepID, LineageStep > lineage_step_map_type;
+  typedef boost::mutex lineage_mutex_type;
+  typedef lineage_mutex_type::scoped_lock lineage_lock_type;
+
+  // In memory copy of the provenance DAG. It is loaded from the database the first time
+  // a trail is requested and kept up to date as provenance records are added or deleted,
+  // so walking a trail does not need any database queries.
+  bool lineage_valid_;
+
+  // Provenance ID to the step that generated it
+  lineage_output_map_type lineage_outputs_;
+
+  // Provenance step ID to its inputs, outputs and replaced IDs
+  lineage_step_map_type lineage_steps_;
+
+  // Provenance records can be added from filter threads
+  lineage_mutex_type lineage_mutex_;
+
   // -- static helper functions --
 public:
   // UPDATE_PROJECT_DIRECTORY:
@@ -494,35 +565,66 @@ bool ProjectPrivate::save_state( const boost::filesystem::path& project_director
   this->project_->project_files_generated_state_->set( true );
   this->project_->project_files_accessible_state_->set( true );
 
-  std::string error;
-
   // Save the session database to disk
   boost::filesystem::path session_database = project_directory / 
     DATABASE_DIR_C / SESSION_DATABASE_C;
-  if ( !this->session_database_.save_database( session_database, error ) )
+  if ( !this->save_database( this->session_database_, session_database ) ) return false;
+
+  // Save the provenance database to disk
+  boost::filesystem::path provenance_database = project_directory /
+    DATABASE_DIR_C / PROVENANCE_DATABASE_C;
+  if ( !this->save_database( this->provenance_database_, provenance_database ) ) return false;
+
+  // Save the note database to disk
+  boost::filesystem::path note_database = project_directory /
+    DATABASE_DIR_C / NOTE_DATABASE_C;
+  if ( !this->save_database( this->note_database_, note_database ) ) return false;
+  
+  return true;
+}
+
+bool ProjectPrivate::load_database( DatabaseManager& database, 
+  const boost::filesystem::path& database_file )
+{
+  std::string error;
+  if ( !database.load_database( database_file, error ) )
   {
     CORE_LOG_ERROR( error );
     return false;
   }
 
-  // Save the provenance database to disk
-  boost::filesystem::path provenance_database = project_directory /
-    DATABASE_DIR_C / PROVENANCE_DATABASE_C;
-  if ( !this->provenance_database_.save_database( provenance_database, error ) )
+  return true;
+}
+
+bool ProjectPrivate::save_database( DatabaseManager& database, 
+  const boost::filesystem::path& database_file )
+{
+  std::string error;
+  if ( !database.save_database( database_file, error ) )
   {
     CORE_LOG_ERROR( error );
     return false;
   }
 
-  // Save the note database to disk
-  boost::filesystem::path note_database = project_directory /
-    DATABASE_DIR_C / NOTE_DATABASE_C;
-  if ( !this->note_database_.save_database( note_database, error ) )
+  if ( !PreferencesManager::Instance()->on_disk_databases_state_->get() ) return true;
+
+  // NOTE: A working copy left behind by an earlier session is out of date, as the database was
+  // loaded from the project file. It is replaced with the content that was just saved.
+  boost::filesystem::path working_file( database_file.string() + WORKING_DATABASE_EXTENSION_C );
+  if ( database.get_database_file() != working_file )
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove( working_file, ec );
+    boost::filesystem::remove( working_file.string() + "-wal", ec );
+    boost::filesystem::remove( working_file.string() + "-shm", ec );
+  }
+
+  if ( !database.open_database( working_file, error ) )
   {
     CORE_LOG_ERROR( error );
     return false;
   }
-  
+
   return true;
 }
 
@@ -695,6 +797,8 @@ bool ProjectPrivate::initialize_provenance_database()
   // Set the database version to 1
   sql_statements += "INSERT INTO database_version VALUES (1);";
 
+  this->invalidate_lineage_index();
+
   std::string error;
   if ( !this->provenance_database_.run_sql_script( sql_statements, error ) )
   {
@@ -733,6 +837,8 @@ bool ProjectPrivate::clear_provenance_database()
   // Delete records from table for storing outputs of each provenance step
   sql_statements += "DELETE FROM provenance_inputfiles_cache;";
   
+  this->invalidate_lineage_index();
+
   std::string error;
   if ( !this->provenance_database_.run_sql_script( sql_statements, error ) )
   {
@@ -821,9 +927,19 @@ bool ProjectPrivate::query_provenance_trail( const std::vector< ProvenanceID >&
 {
   if ( prov_ids.size() == 0 ) return false;
 
-  // Get all the provenance steps that lead to the provenance ID
+  // Get all the provenance steps that lead to the provenance ID, together with their
+  // lineage, from the in memory index
   std::set< ProvenanceStepID > prov_steps;
-  this->get_provenance_steps( prov_ids, prov_steps );
+  lineage_step_map_type trail_steps;
+  {
+    lineage_lock_type lock( this->lineage_mutex_ );
+    if ( !this->build_lineage_index() ) return false;
+    this->collect_lineage_steps( prov_ids, prov_steps );
+    BOOST_FOREACH( ProvenanceStepID step_id, prov_steps )
+    {
+      trail_steps[ step_id ] = this->lineage_steps_[ step_id ];
+    }
+  }
 
   // The length of provenance trail is the same as the number of steps
   provenance_trail.resize( prov_steps.size() );
@@ -850,36 +966,37 @@ bool ProjectPrivate::query_provenance_trail( const std::vector< ProvenanceID >&
     ProvenanceStepID prov_step_id = *it++;
 
     // Query the action string of the provenance step
-    std::string sql_str = "SELECT * FROM provenance_step WHERE "
-      "prov_step_id = " + Core::ExportToString( prov_step_id ) + ";";
-    ResultSet result_set;
+    SqlParameters parameters;
+    parameters.add_int64( prov_step_id );
+    SqlResult result;
     std::string error;
-    if ( !this->provenance_database_.run_sql_statement( sql_str, result_set, error ) )
+    if ( !this->provenance_database_.run_prepared_statement( "SELECT action_id, action_params, "
+      "user_id, timestamp FROM provenance_step WHERE prov_step_id = ?;", parameters, 
+      result, error ) )
     {
       CORE_LOG_ERROR( error );
       return false;
     }
-    if ( result_set.size() != 1 )
+    if ( result.get_num_rows() != 1 )
     {
       CORE_LOG_ERROR( "Provenance database is broken." );
       return false;
     }
-
-    long long action_id, user_id;
-    std::string action_name, action_params, user_name, timestamp_str;
-    try
-    {
-      action_id = boost::any_cast< long long >( result_set[ 0 ][ "action_id" ] );
-      action_params = boost::any_cast< std::string >( result_set[ 0 ][ "action_params" ] );
-      user_id = boost::any_cast< long long >( ( result_set[ 0 ] )[ "user_id" ] );
-      timestamp_str = boost::any_cast< std::string >( ( result_set[ 0 ] )[ "timestamp" ] );
-    }
-    catch ( ... )
+    if ( result.get_type( 0, 0 ) != SqlResult::INTEGER_E || 
+      result.get_type( 0, 1 ) != SqlResult::TEXT_E ||
+      result.get_type( 0, 2 ) != SqlResult::INTEGER_E || 
+      result.get_type( 0, 3 ) != SqlResult::TEXT_E )
     {
       CORE_LOG_ERROR( "Invalid provenance database." );
       return false;
     }
 
+    long long action_id = result.get_int64( 0, 0 );
+    std::string action_params = result.get_text( 0, 1 );
+    long long user_id = result.get_int64( 0, 2 );
+    std::string timestamp_str = result.get_text( 0, 3 );
+    std::string action_name, user_name;
+
     if ( !this->get_action_name( action_id, action_name ) ||
       !this->get_user_name( user_id, user_name ) )
     {
@@ -902,20 +1019,13 @@ bool ProjectPrivate::query_provenance_trail( const std::vector< ProvenanceID >&
     prov_step->set_username( user_name );
     prov_step->set_timestamp( timestamp );
 
-    // Query outputs for the provenance step
+    // Outputs, inputs and replaced IDs come from the lineage index.
     // We also figure out what output IDs we are interested in for this step
-    sql_str = "SELECT prov_id FROM provenance_output WHERE prov_step_id = " +
-      Core::ExportToString( prov_step_id ) + " ORDER BY output_id ASC;";
-    if ( !this->provenance_database_.run_sql_statement( sql_str, result_set, error ) )
-    {
-      CORE_LOG_ERROR( error );
-      return false;
-    }
-    ProvenanceIDList output_prov_ids;
+    const LineageStep& lineage_step = trail_steps[ prov_step_id ];
+    const ProvenanceIDList& output_prov_ids = lineage_step.outputs_;
     ProvenanceIDList prov_ids_of_interest;
-    for ( size_t i = 0; i < result_set.size(); ++i )
+    for ( size_t i = 0; i < output_prov_ids.size(); ++i )
     {
-      output_prov_ids.push_back( boost::any_cast< ProvenanceID >( result_set[ i ][ "prov_id" ] ) );
       if ( poi_set.find( output_prov_ids[ i ] ) != poi_set.end() )
       {
         prov_ids_of_interest.push_back( output_prov_ids[ i ] );
@@ -925,39 +1035,10 @@ bool ProjectPrivate::query_provenance_trail( const std::vector< ProvenanceID >&
     prov_step->set_output_provenance_ids( output_prov_ids );
     prov_step->set_provenance_ids_of_interest( prov_ids_of_interest );
 
-
-    // Query inputs for the provenance step.
-    // Update the poi_set in the mean time.
-    sql_str = "SELECT prov_id FROM provenance_input WHERE prov_step_id = " +
-      Core::ExportToString( prov_step_id ) + " ORDER BY input_id ASC;";
-    if ( !this->provenance_database_.run_sql_statement( sql_str, result_set, error ) )
-    {
-      CORE_LOG_ERROR( error );
-      return false;
-    }
-    ProvenanceIDList input_prov_ids;
-    for ( size_t i = 0; i < result_set.size(); ++i )
-    {
-      input_prov_ids.push_back( boost::any_cast< ProvenanceID >( result_set[ i ][ "prov_id" ] ) );
-      poi_set.insert( input_prov_ids[ i ] );
-    }
-    prov_step->set_input_provenance_ids( input_prov_ids );
-
-
-    // Query replaced provenance IDs for the provenance step
-    sql_str = "SELECT prov_id FROM provenance_replaced WHERE prov_step_id = " +
-      Core::ExportToString( prov_step_id ) + " ORDER BY rowid ASC;";
-    if ( !this->provenance_database_.run_sql_statement( sql_str, result_set, error ) )
-    {
-      CORE_LOG_ERROR( error );
-      return false;
-    }
-    ProvenanceIDList replaced_prov_ids;
-    for ( size_t i = 0; i < result_set.size(); ++i )
-    {
-      replaced_prov_ids.push_back( boost::any_cast< ProvenanceID >( result_set[ i ][ "prov_id" ] ) );
-    }
-    prov_step->set_replaced_provenance_ids( replaced_prov_ids );
+    // Update the poi_set with the inputs of this step
+    poi_set.insert( lineage_step.inputs_.begin(), lineage_step.inputs_.end() );
+    prov_step->set_input_provenance_ids( lineage_step.inputs_ );
+    prov_step->set_replaced_provenance_ids( lineage_step.replaced_ );
 
     provenance_trail[ --index ] = prov_step;
   }
@@ -1527,50 +1608,137 @@ bool ProjectPrivate::get_session_file( SessionID session_id, boost::filesystem::
 void ProjectPrivate::get_provenance_steps( const std::vector< ProvenanceID >& prov_ids, 
                       std::set< ProvenanceStepID >& prov_steps )
 {
-  typedef std::queue< ProvenanceID > prov_id_queue_type;
-  void ( prov_id_queue_type::*push_queue_func )( const ProvenanceID& ) = &prov_id_queue_type::push;
-  prov_id_queue_type provenance_queue;
-  std::for_each( prov_ids.begin(), prov_ids.end(), boost::bind( 
-    push_queue_func, &provenance_queue, _1 ) );
+  lineage_lock_type lock( this->lineage_mutex_ );
+  if ( !this->build_lineage_index() ) return;
+  this->collect_lineage_steps( prov_ids, prov_steps );
+}
+
+bool ProjectPrivate::build_lineage_index()
+{
+  if ( this->lineage_valid_ ) return true;
+
+  this->lineage_outputs_.clear();
+  this->lineage_steps_.clear();
+
+  // Load the whole DAG with one query per table. The ID columns are increasing with insertion,
+  // so the lists end up in the same order as when the step was recorded.
+  SqlParameters parameters;
+  SqlResult result;
+  std::string error;
+  if ( !this->provenance_database_.run_prepared_statement( "SELECT prov_step_id, prov_id "
+    "FROM provenance_output ORDER BY output_id ASC;", parameters, result, error ) )
+  {
+    CORE_LOG_ERROR( error );
+    return false;
+  }
+  for ( size_t i = 0; i < result.get_num_rows(); ++i )
+  {
+    ProvenanceStepID step_id = result.get_int64( i, 0 );
+    ProvenanceID prov_id = result.get_int64( i, 1 );
+    this->lineage_outputs_[ prov_id ] = step_id;
+    this->lineage_steps_[ step_id ].outputs_.push_back( prov_id );
+  }
+
+  if ( !this->provenance_database_.run_prepared_statement( "SELECT prov_step_id, prov_id "
+    "FROM provenance_input ORDER BY input_id ASC;", parameters, result, error ) )
+  {
+    CORE_LOG_ERROR( error );
+    this->lineage_outputs_.clear();
+    this->lineage_steps_.clear();
+    return false;
+  }
+  for ( size_t i = 0; i < result.get_num_rows(); ++i )
+  {
+    this->lineage_steps_[ result.get_int64( i, 0 ) ].inputs_.push_back( 
+      result.get_int64( i, 1 ) );
+  }
 
-  while ( !provenance_queue.empty() )
+  if ( !this->provenance_database_.run_prepared_statement( "SELECT prov_step_id, prov_id "
+    "FROM provenance_replaced ORDER BY rowid ASC;", parameters, result, error ) )
   {
-    ProvenanceID output_id = provenance_queue.front();
-    provenance_queue.pop();
+    CORE_LOG_ERROR( error );
+    this->lineage_outputs_.clear();
+    this->lineage_steps_.clear();
+    return false;
+  }
+  for ( size_t i = 0; i < result.get_num_rows(); ++i )
+  {
+    this->lineage_steps_[ result.get_int64( i, 0 ) ].replaced_.push_back( 
+      result.get_int64( i, 1 ) );
+  }
+
+  this->lineage_valid_ = true;
+  return true;
+}
+
+void ProjectPrivate::collect_lineage_steps( const std::vector< ProvenanceID >& prov_ids, 
+  std::set< ProvenanceStepID >& prov_steps )
+{
+  std::vector< ProvenanceID > pending_ids( prov_ids );
+  while ( !pending_ids.empty() )
+  {
+    ProvenanceID output_id = pending_ids.back();
+    pending_ids.pop_back();
     if ( output_id == -1 ) continue;
 
-    std::string error;
-    std::string sql_str;
-    ResultSet result_set;
+    lineage_output_map_type::const_iterator output_it = this->lineage_outputs_.find( output_id );
+    if ( output_it == this->lineage_outputs_.end() ) continue;
 
-    // Query the provenance step that generated the output_id
-    sql_str = "SELECT prov_step_id FROM provenance_output WHERE prov_id = " +
-      Core::ExportToString( output_id ) + ";";
-    if ( !this->provenance_database_.run_sql_statement( sql_str, result_set, error ) )
-    {
-      CORE_LOG_ERROR( error );
-      return;
-    }
-    if ( result_set.size() == 0 ) continue;
+    // Only expand a step the first time it is reached
+    if ( !prov_steps.insert( output_it->second ).second ) continue;
 
-    ProvenanceStepID prov_step_id = boost::any_cast< long long >( result_set[ 0 ][ "prov_step_id" ] );
-    prov_steps.insert( prov_step_id );
+    lineage_step_map_type::const_iterator step_it = this->lineage_steps_.find( output_it->second );
+    if ( step_it == this->lineage_steps_.end() ) continue;
+    pending_ids.insert( pending_ids.end(), step_it->second.inputs_.begin(), 
+      step_it->second.inputs_.end() );
+  }
+}
 
-    // Query the inputs of the provenance step
-    sql_str = "SELECT prov_id FROM provenance_input WHERE prov_step_id = " +
-      Core::ExportToString( prov_step_id ) + ";";
-    result_set.clear();
-    if ( !this->provenance_database_.run_sql_statement( sql_str, result_set, error ) )
-    {
-      CORE_LOG_ERROR( error );
-      return;
-    }
-    for ( size_t i = 0; i < result_set.size(); ++i )
+void ProjectPrivate::invalidate_lineage_index()
+{
+  lineage_lock_type lock( this->lineage_mutex_ );
+  this->lineage_valid_ = false;
+  this->lineage_outputs_.clear();
+  this->lineage_steps_.clear();
+
+  // User and action IDs are only unique within one database
+  this->user_name_map_.clear();
+  this->action_name_map_.clear();
+}
+
+void ProjectPrivate::add_lineage_step( ProvenanceStepID step_id, const ProvenanceIDList& inputs,
+  const ProvenanceIDList& outputs, const ProvenanceIDList& replaced )
+{
+  lineage_lock_type lock( this->lineage_mutex_ );
+  // If the index has not been loaded yet, the step will be picked up when it is
+  if ( !this->lineage_valid_ ) return;
+
+  LineageStep& step = this->lineage_steps_[ step_id ];
+  step.inputs_ = inputs;
+  step.outputs_ = outputs;
+  step.replaced_ = replaced;
+  for ( size_t i = 0; i < outputs.size(); ++i )
+  {
+    this->lineage_outputs_[ outputs[ i ] ] = step_id;
+  }
+}
+
+void ProjectPrivate::remove_lineage_step( ProvenanceStepID step_id )
+{
+  lineage_lock_type lock( this->lineage_mutex_ );
+  lineage_step_map_type::iterator step_it = this->lineage_steps_.find( step_id );
+  if ( step_it == this->lineage_steps_.end() ) return;
+
+  const ProvenanceIDList& outputs = step_it->second.outputs_;
+  for ( size_t i = 0; i < outputs.size(); ++i )
+  {
+    lineage_output_map_type::iterator output_it = this->lineage_outputs_.find( outputs[ i ] );
+    if ( output_it != this->lineage_outputs_.end() && output_it->second == step_id )
     {
-      ProvenanceID input_id = boost::any_cast< long long >( result_set[ i ][ "prov_id" ] );
-      provenance_queue.push( input_id );
+      this->lineage_outputs_.erase( output_it );
     }
   }
+  this->lineage_steps_.erase( step_it );
 }
 
 void ProjectPrivate::set_project_changed( Core::ActionHandle action, Core::ActionResultHandle result )
@@ -1595,24 +1763,24 @@ void ProjectPrivate::set_project_changed( Core::ActionHandle action, Core::Actio
 
 long long ProjectPrivate::get_user_id( const std::string& user_name )
 {
-  std::string sql_str = "SELECT user_id FROM user WHERE user_name = '" + 
-    DatabaseManager::EscapeQuotes( user_name ) + "';";
+  SqlParameters parameters;
+  parameters.add_text( user_name );
   std::string error;
-  ResultSet results;
-  if ( !this->provenance_database_.run_sql_statement( sql_str, results, error ) )
+  SqlResult result;
+  if ( !this->provenance_database_.run_prepared_statement( 
+    "SELECT user_id FROM user WHERE user_name = ?;", parameters, result, error ) )
   {
     CORE_LOG_ERROR( error );
     return -1;
   }
 
-  if ( results.size() > 0 )
+  if ( result.get_num_rows() > 0 )
   {
-    return boost::any_cast< long long >( results[ 0 ][ "user_id" ] );
+    return result.get_int64( 0, 0 );
   }
   
-  sql_str = "INSERT INTO user (user_name) VALUES('" + 
-    DatabaseManager::EscapeQuotes( user_name ) + "');";
-  if ( !this->provenance_database_.run_sql_statement( sql_str, error ) )
+  if ( !this->provenance_database_.run_prepared_statement( 
+    "INSERT INTO user (user_name) VALUES(?);", parameters, error ) )
   {
     CORE_LOG_ERROR( error );
     return -1;
@@ -1623,22 +1791,24 @@ long long ProjectPrivate::get_user_id( const std::string& user_name )
 
 long long ProjectPrivate::get_action_id( const std::string& action_name )
 {
-  std::string sql_str = "SELECT action_id FROM action WHERE action_name = '" + action_name + "';";
+  SqlParameters parameters;
+  parameters.add_text( action_name );
   std::string error;
-  ResultSet results;
-  if ( !this->provenance_database_.run_sql_statement( sql_str, results, error ) )
+  SqlResult result;
+  if ( !this->provenance_database_.run_prepared_statement( 
+    "SELECT action_id FROM action WHERE action_name = ?;", parameters, result, error ) )
   {
     CORE_LOG_ERROR( error );
     return -1;
   }
 
-  if ( results.size() > 0 )
+  if ( result.get_num_rows() > 0 )
   {
-    return boost::any_cast< long long >( results[ 0 ][ "action_id" ] );
+    return result.get_int64( 0, 0 );
   }
 
-  sql_str = "INSERT INTO action (action_name) VALUES('" + action_name + "');";
-  if ( !this->provenance_database_.run_sql_statement( sql_str, error ) )
+  if ( !this->provenance_database_.run_prepared_statement( 
+    "INSERT INTO action (action_name) VALUES(?);", parameters, error ) )
   {
     CORE_LOG_ERROR( error );
     return -1;
@@ -1656,31 +1826,25 @@ bool ProjectPrivate::get_user_name( long long user_id, std::string& user_name )
     return true;
   }
   
-  std::string sql_str = "SELECT user_name FROM user WHERE user_id = " +
-    Core::ExportToString( user_id ) + ";";
-  ResultSet results;
+  SqlParameters parameters;
+  parameters.add_int64( user_id );
+  SqlResult result;
   std::string error;
-  if ( !this->provenance_database_.run_sql_statement( sql_str, results, error ) )
+  if ( !this->provenance_database_.run_prepared_statement( 
+    "SELECT user_name FROM user WHERE user_id = ?;", parameters, result, error ) )
   {
     CORE_LOG_ERROR( error );
     return false;
   }
   
-  if ( results.size() == 0 )
+  if ( result.get_num_rows() == 0 || result.get_type( 0, 0 ) != SqlResult::TEXT_E )
   {
     CORE_LOG_ERROR( "Invalid provenance database." );
     return false;
   }
   
-  try
-  {
-    user_name = boost::any_cast< std::string >( results[ 0 ][ "user_name" ] );
-  }
-  catch ( ... )
-  {
-    CORE_LOG_ERROR( "Invalid provenance database." );
-    return false;
-  }
+  user_name = result.get_text( 0, 0 );
+  this->user_name_map_[ user_id ] = user_name;
 
   return true;
 }
@@ -1694,31 +1858,25 @@ bool ProjectPrivate::get_action_name( long long action_id, std::string& action_n
     return true;
   }
 
-  std::string sql_str = "SELECT action_name FROM action WHERE action_id = " +
-    Core::ExportToString( action_id ) + ";";
-  ResultSet results;
+  SqlParameters parameters;
+  parameters.add_int64( action_id );
+  SqlResult result;
   std::string error;
-  if ( !this->provenance_database_.run_sql_statement( sql_str, results, error ) )
+  if ( !this->provenance_database_.run_prepared_statement( 
+    "SELECT action_name FROM action WHERE action_id = ?;", parameters, result, error ) )
   {
     CORE_LOG_ERROR( error );
     return false;
   }
 
-  if ( results.size() == 0 )
+  if ( result.get_num_rows() == 0 || result.get_type( 0, 0 ) != SqlResult::TEXT_E )
   {
     CORE_LOG_ERROR( "Invalid provenance database." );
     return false;
   }
 
-  try
-  {
-    action_name = boost::any_cast< std::string >( results[ 0 ][ "action_name" ] );
-  }
-  catch ( ... )
-  {
-    CORE_LOG_ERROR( "Invalid provenance database." );
-    return false;
-  }
+  action_name = result.get_text( 0, 0 );
+  this->action_name_map_[ action_id ] = action_name;
 
   return true;
 }
@@ -1969,18 +2127,19 @@ bool Project::load_project( const boost::filesystem::path& project_file )
   {
     boost::filesystem::path session_db_file = full_filename.parent_path() /
       DATABASE_DIR_C / SESSION_DATABASE_C;
-    std::string error;
     // If the session database doesn't exist or it's invalid, create an empty one
     if ( !boost::filesystem::exists( session_db_file ) ||
-      !this->private_->session_database_.load_database( session_db_file, error ) )
+      !this->private_->load_database( this->private_->session_database_, session_db_file ) )
     {
       this->private_->initialize_session_database();
     }
 
     boost::filesystem::path provenance_db_file = full_filename.parent_path() /
       DATABASE_DIR_C / PROVENANCE_DATABASE_C;
+    this->private_->invalidate_lineage_index();
     if ( !boost::filesystem::exists( provenance_db_file ) ||
-      !this->private_->provenance_database_.load_database( provenance_db_file, error ) )
+      !this->private_->load_database( this->private_->provenance_database_, 
+      provenance_db_file ) )
     {
       this->private_->initialize_provenance_database();
     }
@@ -1988,7 +2147,7 @@ bool Project::load_project( const boost::filesystem::path& project_file )
     boost::filesystem::path note_db_file = full_filename.parent_path() / 
       DATABASE_DIR_C / NOTE_DATABASE_C;
     if ( !boost::filesystem::exists( note_db_file ) || 
-      !this->private_->note_database_.load_database( note_db_file, error ) )
+      !this->private_->load_database( this->private_->note_database_, note_db_file ) )
     {
       this->private_->initialize_note_database();
     }
@@ -2615,6 +2774,8 @@ bool Project::load_session( SessionID session_id )
   // This function sets state variables directly, hence we need to be on the application thread
   ASSERT_IS_APPLICATION_THREAD();
 
+  CORE_TRACE_SCOPE( "session", "load session" );
+
   // Get the session XML file
   std::string error;
   boost::filesystem::path session_file;
@@ -2683,6 +2844,8 @@ bool Project::save_session( const std::string& name )
   // This function sets state variables directly, hence we need to be on the application thread
   ASSERT_IS_APPLICATION_THREAD();
 
+  CORE_TRACE_SCOPE( "session", "save session" );
+
   std::string session_name = name;
   // Update the session name if needed
   if ( session_name.empty() ) 
@@ -2954,12 +3117,11 @@ ProvenanceStepID Project::add_provenance_record( const ProvenanceStepHandle& ste
   ProvenanceIDList deleted_list = step->get_replaced_provenance_ids();
   InputFilesID inputfiles_id = step->get_inputfiles_id();
 
-  std::string sql_str = "INSERT INTO provenance_step (action_id, action_params, user_id)"
-    " VALUES(" + Core::ExportToString( action_id ) + ", '" + 
-    DatabaseManager::EscapeQuotes( action_params ) + 
-    "', " + Core::ExportToString( user_id ) + ");";
+  SqlParameters parameters;
+  parameters.add_int64( action_id ).add_text( action_params ).add_int64( user_id );
   std::string error;
-  if ( !this->private_->provenance_database_.run_sql_statement( sql_str, error ) )
+  if ( !this->private_->provenance_database_.run_prepared_statement( "INSERT INTO "
+    "provenance_step (action_id, action_params, user_id) VALUES(?, ?, ?);", parameters, error ) )
   {
     CORE_LOG_ERROR( error );
     return -1;
@@ -2968,9 +3130,10 @@ ProvenanceStepID Project::add_provenance_record( const ProvenanceStepHandle& ste
 
   for ( size_t i = 0; i < input_list.size(); ++i )
   {
-    sql_str = "INSERT INTO provenance_input (prov_step_id,prov_id) VALUES(" + Core::ExportToString( step_id ) + ", " +
-      Core::ExportToString( input_list[ i ] ) + ");";
-    if ( !this->private_->provenance_database_.run_sql_statement( sql_str, error ) )
+    parameters.clear();
+    parameters.add_int64( step_id ).add_int64( input_list[ i ] );
+    if ( !this->private_->provenance_database_.run_prepared_statement( "INSERT INTO "
+      "provenance_input (prov_step_id,prov_id) VALUES(?, ?);", parameters, error ) )
     {
       CORE_LOG_ERROR( error );
       this->delete_provenance_record( step_id );
@@ -2980,9 +3143,10 @@ ProvenanceStepID Project::add_provenance_record( const ProvenanceStepHandle& ste
 
   for ( size_t i = 0; i < output_list.size(); ++i )
   {
-    sql_str = "INSERT INTO provenance_output (prov_step_id,prov_id) VALUES(" + Core::ExportToString( step_id ) + ", " +
-      Core::ExportToString( output_list[ i ] ) + ");";
-    if ( !this->private_->provenance_database_.run_sql_statement( sql_str, error ) )
+    parameters.clear();
+    parameters.add_int64( step_id ).add_int64( output_list[ i ] );
+    if ( !this->private_->provenance_database_.run_prepared_statement( "INSERT INTO "
+      "provenance_output (prov_step_id,prov_id) VALUES(?, ?);", parameters, error ) )
     {
       CORE_LOG_ERROR( error );
       this->delete_provenance_record( step_id );
@@ -2992,9 +3156,10 @@ ProvenanceStepID Project::add_provenance_record( const ProvenanceStepHandle& ste
   
   for ( size_t i = 0; i < deleted_list.size(); ++i )
   {
-    sql_str = "INSERT INTO provenance_replaced (prov_step_id,prov_id) VALUES(" + Core::ExportToString( step_id ) + ", " +
-      Core::ExportToString( deleted_list[ i ] ) + ");";
-    if ( !this->private_->provenance_database_.run_sql_statement( sql_str, error ) )
+    parameters.clear();
+    parameters.add_int64( step_id ).add_int64( deleted_list[ i ] );
+    if ( !this->private_->provenance_database_.run_prepared_statement( "INSERT INTO "
+      "provenance_replaced (prov_step_id,prov_id) VALUES(?, ?);", parameters, error ) )
     {
       CORE_LOG_ERROR( error );
       this->delete_provenance_record( step_id );
@@ -3004,10 +3169,10 @@ ProvenanceStepID Project::add_provenance_record( const ProvenanceStepHandle& ste
   
   if ( inputfiles_id > -1 )
   { // If it is a valid ID add it to the table
-    sql_str = "INSERT INTO provenance_inputfiles_cache VALUES (" + 
-      Core::ExportToString( step_id ) + ", " + Core::ExportToString( inputfiles_id ) + ");";
-      
-    if ( !this->private_->provenance_database_.run_sql_statement( sql_str, error ) )
+    parameters.clear();
+    parameters.add_int64( step_id ).add_int64( inputfiles_id );
+    if ( !this->private_->provenance_database_.run_prepared_statement( 
+      "INSERT INTO provenance_inputfiles_cache VALUES (?, ?);", parameters, error ) )
     {
       CORE_LOG_ERROR( error );
       this->delete_provenance_record( step_id );
@@ -3015,19 +3180,23 @@ ProvenanceStepID Project::add_provenance_record( const ProvenanceStepHandle& ste
     }
   }
   
+  this->private_->add_lineage_step( step_id, input_list, output_list, deleted_list );
+
   return step_id;
 }
 
 bool Project::delete_provenance_record( ProvenanceStepID record_id )
 {
-  std::string sql_str = "DELETE FROM provenance_step WHERE prov_step_id = " +
-    Core::ExportToString( record_id ) + ";";
+  SqlParameters parameters;
+  parameters.add_int64( record_id );
   std::string error;
-  if ( !this->private_->provenance_database_.run_sql_statement( sql_str, error ) )
+  if ( !this->private_->provenance_database_.run_prepared_statement( 
+    "DELETE FROM provenance_step WHERE prov_step_id = ?;", parameters, error ) )
   {
     CORE_LOG_ERROR( error );
     return false;
   }
+  this->private_->remove_lineage_step( record_id );
   return true;
 }
 
@@ -3042,11 +3211,11 @@ void Project::update_provenance_record( ProvenanceStepID record_id, const Proven
     action_params = " ";
   }
 
-  std::string sql_str = "UPDATE provenance_step SET action_params = '" + 
-    DatabaseManager::EscapeQuotes( action_params ) +
-    "' WHERE prov_step_id = " + Core::ExportToString( record_id ) + ";";
+  SqlParameters parameters;
+  parameters.add_text( action_params ).add_int64( record_id );
   std::string error;
-  if ( !this->private_->provenance_database_.run_sql_statement( sql_str, error ) )
+  if ( !this->private_->provenance_database_.run_prepared_statement( 
+    "UPDATE provenance_step SET action_params = ? WHERE prov_step_id = ?;", parameters, error ) )
   {
     CORE_LOG_ERROR( error );
   }
@@ -0,0 +1,86 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// Core includes
+#include <Core/Action/ActionFactory.h>
+#include <Core/Action/ActionDispatcher.h>
+#include <Core/Utils/Tracer.h>
+
+// Application includes
+#include <Application/ProjectManager/Actions/ActionExportTrace.h>
+
+CORE_REGISTER_ACTION( Seg3D, ExportTrace )
+
+namespace Seg3D
+{
+
+bool ActionExportTrace::validate( Core::ActionContextHandle& context )
+{
+  if ( this->file_.empty() )
+  {
+    context->report_error( "No file name was given for the trace." );
+    return false;
+  }
+
+  // NOTE: Events are kept after tracing stops, so a stopped trace can be exported again.
+  if ( !Core::Tracer::Instance()->is_tracing() && !Core::Tracer::Instance()->has_events() )
+  {
+    context->report_error( "No trace has been recorded." );
+    return false;
+  }
+
+  return true; // validated
+}
+
+bool ActionExportTrace::run( Core::ActionContextHandle& context, 
+  Core::ActionResultHandle& result )
+{
+  // NOTE: Stop first, so this action does not end up in its own trace half finished.
+  if ( this->stop_ ) Core::Tracer::Instance()->stop();
+
+  std::string error;
+  if ( !Core::Tracer::Instance()->export_to_file( this->file_, error ) )
+  {
+    context->report_error( error );
+    return false;
+  }
+
+  CORE_LOG_SUCCESS( "Wrote trace to '" + this->file_ + "'." );
+  return true;
+}
+
+void ActionExportTrace::Dispatch( Core::ActionContextHandle context, const std::string& file )
+{
+  ActionExportTrace* action = new ActionExportTrace;
+  action->file_ = file;
+  action->stop_ = true;
+
+  Core::ActionDispatcher::PostAction( Core::ActionHandle( action ), context );
+}
+
+} // end namespace Seg3D
@@ -0,0 +1,77 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef APPLICATION_PROJECTMANAGER_ACTIONS_ACTIONEXPORTTRACE_H
+#define APPLICATION_PROJECTMANAGER_ACTIONS_ACTIONEXPORTTRACE_H
+
+// Core includes
+#include <Core/Action/Action.h> 
+#include <Core/Interface/Interface.h>
+
+namespace Seg3D
+{
+
+class ActionExportTrace : public Core::Action
+{
+  
+CORE_ACTION(
+  CORE_ACTION_TYPE( "ExportTrace", "Write the recorded trace to a Chrome/Perfetto JSON file." )
+  CORE_ACTION_ARGUMENT( "file", "Name of the JSON file the trace is written to." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "stop", "true", "Whether to stop recording after exporting." )
+)
+
+  // -- Constructor/Destructor --
+public:
+  ActionExportTrace()
+  {
+    this->add_parameter( this->file_ );
+    this->add_parameter( this->stop_ );
+  }
+
+  // -- Functions that describe action --
+public:
+  virtual bool validate( Core::ActionContextHandle& context );
+  virtual bool run( Core::ActionContextHandle& context, Core::ActionResultHandle& result );
+  
+private:
+  // The file the trace is written to
+  std::string file_;
+
+  // Whether recording stops after the export
+  bool stop_;
+  
+  // -- Dispatch this action from the interface --
+public:
+  /// DISPATCH:
+  /// Dispatch an action that writes the recorded trace to file
+  static void Dispatch( Core::ActionContextHandle context, const std::string& file );
+};
+
+} // end namespace Seg3D
+
+#endif
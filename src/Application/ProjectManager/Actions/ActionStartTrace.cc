@@ -0,0 +1,69 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// Core includes
+#include <Core/Action/ActionFactory.h>
+#include <Core/Action/ActionDispatcher.h>
+#include <Core/Utils/Tracer.h>
+
+// Application includes
+#include <Application/ProjectManager/Actions/ActionStartTrace.h>
+
+CORE_REGISTER_ACTION( Seg3D, StartTrace )
+
+namespace Seg3D
+{
+
+bool ActionStartTrace::validate( Core::ActionContextHandle& context )
+{
+  if ( this->capacity_ <= 0 )
+  {
+    context->report_error( "The capacity of the trace needs to be larger than zero." );
+    return false;
+  }
+
+  return true; // validated
+}
+
+bool ActionStartTrace::run( Core::ActionContextHandle& context, 
+  Core::ActionResultHandle& result )
+{
+  Core::Tracer::Instance()->start( static_cast< size_t >( this->capacity_ ) );
+  CORE_LOG_MESSAGE( "Started recording a trace." );
+  return true;
+}
+
+void ActionStartTrace::Dispatch( Core::ActionContextHandle context )
+{
+  ActionStartTrace* action = new ActionStartTrace;
+  action->capacity_ = static_cast< int >( Core::Tracer::DEFAULT_CAPACITY_C );
+
+  Core::ActionDispatcher::PostAction( Core::ActionHandle( action ), context );
+}
+
+} // end namespace Seg3D
@@ -28,6 +28,7 @@
 
 // Boost includes
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
 
 // Core includes
 #include <Core/Application/Application.h>
@@ -43,6 +44,7 @@
 #include <Core/Graphics/ColorMap.h>
 #include <Core/Volume/LargeVolumeSlice.h>
 #include <Core/Volume/LargeVolumeBrickSlice.h>
+#include <Core/Volume/MaskVolumeSlice.h>
 #include <Core/VolumeRenderer/VolumeRendererSimple.h>
 #include <Core/VolumeRenderer/VolumeRendererOcclusion.h>
 
@@ -112,7 +114,8 @@ class RendererPrivate
 {
   // -- Helper functions --
 public:
-  void process_slices( LayerSceneHandle& layer_scene, ViewerHandle& viewer );
+  void process_slices( LayerSceneHandle& layer_scene, const ViewerSceneInfo& viewer_info,
+    size_t viewer_id );
   void draw_slices_3d( const Core::BBox& bbox, const Core::Transform& mvp_trans,
     const std::vector< LayerSceneHandle >& layer_scenes, 
     const std::vector< double >& depths,
@@ -120,7 +123,7 @@ public:
   void draw_slice( LayerSceneItemHandle layer_item, const Core::Matrix& proj_mat,
     ProxyRectangleHandle rect = ProxyRectangleHandle() );
   void set_scale_bias(double data_min, double data_max, double display_min, double display_max);
-  bool render_volume_view( ViewerHandle viewer, const Core::Color bkg_color, Core::StateEngine::lock_type& state_lock );
+  bool render_volume_view( ViewerHandle viewer, const Core::Color bkg_color );
   
   void map_slice_texture(Core::Texture2DHandle slice_tex, int width, int height,
     double left, double right, double bottom, double top,
@@ -142,6 +145,7 @@ public:
   void viewer_mode_changed( size_t viewer_id );
   void picking_target_changed( size_t viewer_id );
   void enable_rendering( bool enable );
+  void layer_scene_updated();
 
   Renderer* renderer_;
 
@@ -155,18 +159,25 @@ public:
 
   size_t viewer_id_;
   bool rendering_enabled_;
+
+  // Whether the last redraw used a layer scene snapshot that was out of date
+  bool rendered_stale_;
+  boost::mutex rendered_stale_mutex_;
 };
 
-void RendererPrivate::process_slices( LayerSceneHandle& layer_scene, ViewerHandle& viewer )
+void RendererPrivate::process_slices( LayerSceneHandle& layer_scene, 
+  const ViewerSceneInfo& viewer_info, size_t viewer_id )
 {
   for ( size_t layer_num = 0; layer_num < layer_scene->size(); layer_num++ )
   {
     LayerSceneItemHandle layer_item = ( *layer_scene )[ layer_num ];
     bool layer_visible = false;
-    if ( layer_item->layer_->is_visible( this->viewer_id_ ) )
+    if ( viewer_id < layer_item->visible_.size() && layer_item->visible_[ viewer_id ] )
     {
-      Core::VolumeSliceHandle volume_slice = 
-        viewer->get_volume_slice( layer_item->layer_id_ );
+      ViewerSceneInfo::volume_slice_map_type::const_iterator it = 
+        viewer_info.volume_slices_.find( layer_item->layer_id_ );
+      Core::VolumeSliceHandle volume_slice;
+      if ( it != viewer_info.volume_slices_.end() ) volume_slice = it->second;
 
       if ( volume_slice && volume_slice->is_valid() )
       {
@@ -199,6 +210,17 @@ void RendererPrivate::process_slices( LayerSceneHandle& layer_scene, ViewerHandl
   }
 }
 
+void RendererPrivate::layer_scene_updated()
+{
+  // Redraw if the last redraw had to use an older snapshot
+  {
+    boost::mutex::scoped_lock lock( this->rendered_stale_mutex_ );
+    if ( !this->rendered_stale_ ) return;
+    this->rendered_stale_ = false;
+  }
+  this->renderer_->redraw_scene();
+}
+
 void RendererPrivate::viewer_slice_changed( size_t viewer_id )
 {
   ViewerHandle self_viewer = ViewerManager::Instance()->get_viewer( this->viewer_id_ );
@@ -559,6 +581,8 @@ void RendererPrivate::draw_slice( LayerSceneItemHandle layer_item,
       Core::Color color = PreferencesManager::Instance()->get_color( mask_layer_item->color_ );
       this->slice_shader_->set_mask_color( static_cast< float >( color.r() / 255 ), 
         static_cast< float >( color.g() / 255 ), static_cast< float >( color.b() / 255 ) );
+      this->slice_shader_->set_mask_bit( static_cast< int >( static_cast< Core::MaskVolumeSlice* >(
+        volume_slice )->get_mask_data_block()->get_mask_bit() ) );
       this->slice_shader_->set_texture_clamp( 0.0f, 1.0f, 0.0f, 1.0f );
       this->map_slice_texture( volume_slice->get_texture(),
         static_cast<int>( volume_slice->nx() ), static_cast<int>( volume_slice->ny() ),
@@ -610,8 +634,12 @@ void RendererPrivate::draw_slice( LayerSceneItemHandle layer_item,
   } // end switch
 }
 
-bool RendererPrivate::render_volume_view( ViewerHandle viewer, const Core::Color bkg_color, Core::StateEngine::lock_type& state_lock )
+bool RendererPrivate::render_volume_view( ViewerHandle viewer, const Core::Color bkg_color )
 {
+  // NOTE: The volume rendering properties of this viewer are not part of the layer scene
+  // snapshot, so they are read while briefly holding the state lock.
+  Core::StateEngine::lock_type state_lock( Core::StateEngine::GetMutex() );
+
   Core::View3D view3d( viewer->volume_view_state_->get() );
   std::vector< LayerSceneHandle > layer_scenes;
   std::vector< double > depths;
@@ -634,32 +662,6 @@ bool RendererPrivate::render_volume_view( ViewerHandle viewer, const Core::Color
   // Clipping does not seem to work properly on OSX 10.5
   if (Core::Application::Instance()->is_osx_10_5_or_less()) enable_clipping = false;
 
-  for (size_t i = 0; i < num_of_viewers && draw_slices; i++)
-  {
-    ViewerHandle other_viewer = ViewerManager::Instance()->get_viewer( i );
-    if (!other_viewer->slice_visible_state_->get() ||
-      other_viewer->is_volume_view() ||
-      ( !show_invisible_slices && !other_viewer->viewer_visible_state_->get() ))
-    {
-      continue;
-    }
-    // Get a snapshot of current layers
-    LayerSceneHandle layer_scene = LayerManager::Instance()->compose_layer_scene( i );
-
-    // Copy slices from viewer
-    this->process_slices( layer_scene, other_viewer );
-
-    if (layer_scene->size() > 0)
-    {
-      layer_scenes.push_back( layer_scene );
-      Core::StateView2D* view2d_state = static_cast< Core::StateView2D* >(
-        other_viewer->get_active_view_state().get() );
-      depths.push_back( view2d_state->get().center().z() );
-      view_modes.push_back( other_viewer->view_mode_state_->get() );
-    }
-  }
-
-  Core::BBox bbox = LayerManager::Instance()->get_layers_bbox();
   IsosurfaceArray isosurfaces;
   if (draw_isosurfaces)
   {
@@ -688,6 +690,31 @@ bool RendererPrivate::render_volume_view( ViewerHandle viewer, const Core::Color
   // We have got everything we want from the state engine, unlock before we do any rendering
   state_lock.unlock();
 
+  // The slices of the other viewers come from the layer scene snapshot
+  for (size_t i = 0; i < num_of_viewers && draw_slices; i++)
+  {
+    ViewerSceneInfoHandle other_info = LayerManager::Instance()->get_viewer_scene_info( i );
+    if ( !other_info || !other_info->slice_visible_ || other_info->volume_view_ ||
+      ( !show_invisible_slices && !other_info->viewer_visible_ ) )
+    {
+      continue;
+    }
+    // Get a snapshot of current layers
+    LayerSceneHandle layer_scene = LayerManager::Instance()->compose_layer_scene( i );
+
+    // Copy slices from viewer
+    this->process_slices( layer_scene, *other_info, i );
+
+    if (layer_scene->size() > 0)
+    {
+      layer_scenes.push_back( layer_scene );
+      depths.push_back( other_info->view2d_.center().z() );
+      view_modes.push_back( other_info->view_mode_ );
+    }
+  }
+
+  Core::BBox bbox = LayerManager::Instance()->get_layers_bbox();
+
   double znear, zfar;
   view3d.compute_clipping_planes( bbox, znear, zfar );
   // If the scene is completely behind the camera, no need to render
@@ -974,6 +1001,7 @@ Renderer::Renderer( size_t viewer_id ) :
   private_( new RendererPrivate )
 {
   this->private_->rendering_enabled_ = true;
+  this->private_->rendered_stale_ = false;
   this->private_->renderer_ = this;
   this->private_->slice_shader_.reset( new SliceShader );
   this->private_->isosurface_shader_.reset( new IsosurfaceShader );
@@ -1070,6 +1098,9 @@ void Renderer::post_initialize()
   this->add_connection( ViewerManager::Instance()->picking_target_changed_signal_.connect(
     boost::bind( &RendererPrivate::picking_target_changed, this->private_, _1 ) ) );
 
+  this->add_connection( LayerManager::Instance()->layer_scene_updated_signal_.connect(
+    boost::bind( &RendererPrivate::layer_scene_updated, this->private_ ) ) );
+
   this->add_connection( Core::StateEngine::Instance()->pre_load_states_signal_.connect(
     boost::bind( &RendererPrivate::enable_rendering, this->private_, false ) ) );
   this->add_connection( Core::StateEngine::Instance()->post_load_states_signal_.connect(
@@ -1083,25 +1114,35 @@ bool Renderer::render_scene()
     return false;
   }
 
-  // Lock the state engine
-  Core::StateEngine::lock_type state_lock( Core::StateEngine::GetMutex() );
+  // NOTE: The state engine is not locked here, the viewer and layer properties come from the
+  // last layer scene snapshot published by the application thread. If it is out of date,
+  // the scene is redrawn once the next one is published.
+  {
+    boost::mutex::scoped_lock lock( this->private_->rendered_stale_mutex_ );
+    this->private_->rendered_stale_ = !LayerManager::Instance()->is_layer_scene_current();
+  }
 
-  Core::Color bkg_color = PreferencesManager::Instance()->get_background_color();
+  ViewerSceneInfoHandle viewer_info = LayerManager::Instance()->
+    get_viewer_scene_info( this->private_->viewer_id_ );
+  Core::Color bkg_color;
+  if ( viewer_info ) bkg_color = viewer_info->background_color_;
 
   glClearColor( bkg_color.r(), bkg_color.g(), bkg_color.b(), 0.0f );
   glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
+  // Nothing has been published for this viewer yet, it is redrawn once it is
+  if ( !viewer_info ) return true;
+
   CORE_LOG_DEBUG( std::string("Renderer ") + Core::ExportToString( 
     this->private_->viewer_id_ ) + ": starting redraw" );
 
   glMatrixMode( GL_PROJECTION );
   glLoadIdentity();
 
-  ViewerHandle viewer = ViewerManager::Instance()->get_viewer( this->private_->viewer_id_ );
-
-  if ( viewer->is_volume_view() )
+  if ( viewer_info->volume_view_ )
   {
-    this->private_->render_volume_view( viewer, bkg_color, state_lock );
+    ViewerHandle viewer = ViewerManager::Instance()->get_viewer( this->private_->viewer_id_ );
+    this->private_->render_volume_view( viewer, bkg_color );
   }
   else
   {
@@ -1110,13 +1151,9 @@ bool Renderer::render_scene()
       compose_layer_scene( this->private_->viewer_id_ );
     
     // Copy slices from viewer
-    this->private_->process_slices( layer_scene, viewer );
+    this->private_->process_slices( layer_scene, *viewer_info, this->private_->viewer_id_ );
 
-    Core::View2D view2d( static_cast< Core::StateView2D* >( 
-      viewer->get_active_view_state().get() )->get() );
-
-    // We have got everything we want from the state engine, unlock before we do any rendering
-    state_lock.unlock();
+    Core::View2D view2d( viewer_info->view2d_ );
 
     glDisable( GL_DEPTH_TEST );
     glEnable( GL_BLEND );
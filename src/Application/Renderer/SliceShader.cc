@@ -81,6 +81,7 @@ bool SliceShader::post_initialize()
   this->border_width_loc_ = this->get_uniform_location( "border_width" );
   this->volume_type_loc_ = this->get_uniform_location( "volume_type" );
   this->mask_color_loc_ = this->get_uniform_location( "mask_color" );
+  this->mask_bit_loc_ = this->get_uniform_location( "mask_bit" );
   this->enable_lighting_loc_ = this->get_uniform_location( "enable_lighting" );
   this->enable_fog_loc_ = this->get_uniform_location( "enable_fog" );
   this->fog_range_loc_ = this->get_uniform_location( "fog_range" );
@@ -135,6 +136,11 @@ void SliceShader::set_mask_color( float r, float g, float b )
   glUniform3f( this->mask_color_loc_, r, g, b );
 }
 
+void SliceShader::set_mask_bit( int mask_bit )
+{
+  glUniform1i( this->mask_bit_loc_, mask_bit );
+}
+
 void SliceShader::set_lighting( bool enabled )
 {
   glUniform1i( this->enable_lighting_loc_, enabled );
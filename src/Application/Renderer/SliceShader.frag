@@ -20,6 +20,17 @@ uniform vec2 scale_bias;
 uniform int border_width; // width of the mask border
 uniform vec2 pixel_size; // pixel size in texture space
 uniform vec4 texture_clamp; // texture coordinate ranges (s_min, s_max, t_min, t_max)
+uniform int mask_bit; // bit of the mask in a packed mask texture, or -1 for a single mask
+
+// Get whether the mask is set in a texel. Packed mask textures hold all the bit planes of the
+// mask data block, and the bit of the mask is extracted arithmetically as GLSL 1.10 does not 
+// have bit operations.
+float unpack_mask( float value )
+{
+  if ( mask_bit < 0 ) return value;
+  float bits = floor( value * 255.0 + 0.5 );
+  return mod( floor( bits / exp2( float( mask_bit ) ) ), 2.0 );
+}
 
 uniform bool enable_lighting;
 uniform bool enable_fog;
@@ -46,35 +57,35 @@ bool edge_test()
     return true;
   
   // test the pixel to the left
-  if ( texture2D( slice_tex, vec2( left,  gl_TexCoord[0].t ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( slice_tex, vec2( left,  gl_TexCoord[0].t ) ).a ) == 0.0 )
     return true;
 
   // test the pixel to the right
-  if ( texture2D( slice_tex, vec2( right,  gl_TexCoord[0].t ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( slice_tex, vec2( right,  gl_TexCoord[0].t ) ).a ) == 0.0 )
     return true;
 
   // test the pixel below
-  if ( texture2D( slice_tex, vec2( gl_TexCoord[0].s, bottom ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( slice_tex, vec2( gl_TexCoord[0].s, bottom ) ).a ) == 0.0 )
     return true;
 
   // test the pixel above
-  if ( texture2D( slice_tex, vec2( gl_TexCoord[0].s, top ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( slice_tex, vec2( gl_TexCoord[0].s, top ) ).a ) == 0.0 )
     return true;
 
   // test the pixel on the bottom left corner
-  if ( texture2D( slice_tex, vec2( left, bottom ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( slice_tex, vec2( left, bottom ) ).a ) == 0.0 )
     return true;
 
   // test the pixel on the bottom right corner
-  if ( texture2D( slice_tex, vec2( right, bottom ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( slice_tex, vec2( right, bottom ) ).a ) == 0.0 )
     return true;
 
   // test the pixel on the top right corner
-  if ( texture2D( slice_tex, vec2( right, top ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( slice_tex, vec2( right, top ) ).a ) == 0.0 )
     return true;
 
   // test the pixel on the top left corner
-  if ( texture2D( slice_tex, vec2( left, top ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( slice_tex, vec2( left, top ) ).a ) == 0.0 )
     return true;
 
   return false;
@@ -82,7 +93,7 @@ bool edge_test()
 
 vec4 shade_mask_slice()
 {
-  float mask = texture2D( slice_tex, gl_TexCoord[0].st ).a;
+  float mask = unpack_mask( texture2D( slice_tex, gl_TexCoord[0].st ).a );
   vec4 color;
   
   if ( mask == 0.0 ) discard;
@@ -31,20 +31,31 @@
 #endif
 
 // STL includes
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <sstream>
+#include <vector>
 
 // Boost includes
 #include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/ref.hpp>
+#include <boost/weak_ptr.hpp>
 
 // Core includes
-#include <Core/Utils/ConnectionHandler.h>
 #include <Core/Utils/Log.h>
+#include <Core/Application/Application.h>
+#include <Core/Action/ActionDispatcher.h>
+#include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/LargeVolume/LargeVolumeCache.h>
 #include <Core/Python/PythonInterpreter.h>
 
 // Application includes
+#include <Application/Filters/LayerFilterLock.h>
 #include <Application/Socket/ActionSocket.h>
+#include <Application/UndoBuffer/UndoBuffer.h>
 
 namespace Seg3D
 {
@@ -67,26 +78,479 @@ ActionSocket::~ActionSocket()
 {
 }
 
-static void WriteOutputToSocket( boost::asio::ip::tcp::socket& socket, std::string output )
+static std::string EscapeJSONString( const std::string& str )
 {
-  try
+  std::string escaped;
+  for ( size_t j = 0; j < str.size(); j++ )
+  {
+    if ( str[ j ] == '"' || str[ j ] == '\\' ) escaped += '\\';
+    if ( static_cast< unsigned char >( str[ j ] ) >= 0x20 ) escaped += str[ j ];
+  }
+  return escaped;
+}
+
+std::string ActionSocket::GetMetrics()
+{
+  // NOTE: None of these counters require the application thread, so metrics can still be
+  // queried when the application thread is stuck.
+  std::ostringstream metrics;
+  metrics << "{";
+  metrics << "\"event_queue_depth\":" << 
+    Core::Application::Instance()->get_event_queue_size();
+  metrics << ",\"actions_in_flight\":" << 
+    Core::ActionDispatcher::Instance()->get_action_count();
+
+  boost::posix_time::ptime last_action = 
+    Core::ActionDispatcher::Instance()->last_action_completed();
+  long seconds_since_last_action = -1;
+  if ( !last_action.is_not_a_date_time() )
+  {
+    seconds_since_last_action = static_cast< long >( ( 
+      boost::posix_time::second_clock::local_time() - last_action ).total_seconds() );
+  }
+  metrics << ",\"seconds_since_last_action\":" << seconds_since_last_action;
+
+  metrics << ",\"undo_buffer_bytes\":" << UndoBuffer::Instance()->get_total_byte_size();
+  metrics << ",\"large_volume_cache_bytes\":" << 
+    Core::LargeVolumeCache::Instance()->get_cache_size();
+  metrics << ",\"large_volume_cache_capacity\":" << 
+    Core::LargeVolumeCache::Instance()->get_cache_capacity();
+
+  size_t used_bitplanes = 0;
+  size_t total_bitplanes = 0;
+  Core::MaskDataBlockManager::Instance()->get_bitplane_usage( used_bitplanes, total_bitplanes );
+  metrics << ",\"mask_bitplanes_used\":" << used_bitplanes;
+  metrics << ",\"mask_bitplanes_total\":" << total_bitplanes;
+
+  metrics << ",\"filters_running\":" << LayerFilterLock::Instance()->get_running_filter_count();
+  metrics << ",\"filters_waiting\":" << LayerFilterLock::Instance()->get_waiting_filter_count();
+  
+  std::vector< LayerFilterStatistics > statistics = 
+    LayerFilterLock::Instance()->get_filter_statistics();
+  metrics << ",\"filters\":[";
+  for ( size_t j = 0; j < statistics.size(); j++ )
+  {
+    if ( j > 0 ) metrics << ",";
+    double voxels_per_second = statistics[ j ].seconds_ > 0.0 ? 
+      statistics[ j ].voxels_ / statistics[ j ].seconds_ : 0.0;
+    metrics << "{\"name\":\"" << EscapeJSONString( statistics[ j ].name_ ) << "\"" <<
+      ",\"runs\":" << statistics[ j ].runs_ <<
+      ",\"seconds\":" << statistics[ j ].seconds_ <<
+      ",\"voxels_per_second\":" << voxels_per_second << "}";
+  }
+  metrics << "]}";
+
+  return metrics.str();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Class ActionSocketSession
+//////////////////////////////////////////////////////////////////////////
+
+// CLASS ACTIONSOCKETSESSION
+// One client connection of the action socket. Commands are read asynchronously, so a client
+// can send the next commands before the previous ones have finished. The output of the
+// commands of a client is only sent back to that client.
+
+class ActionSocketSession;
+typedef boost::shared_ptr< ActionSocketSession > ActionSocketSessionHandle;
+typedef boost::weak_ptr< ActionSocketSession > ActionSocketSessionWeakHandle;
+
+class ActionSocketSession : public boost::enable_shared_from_this< ActionSocketSession >
+{
+public:
+  ActionSocketSession( boost::asio::io_service& io_service ) :
+    socket_( io_service ),
+    io_service_( io_service ),
+    python_session_( new Core::PythonSession ),
+    binary_mode_( false ),
+    pending_line_commands_( 0 ),
+    pending_frames_( 0 ),
+    close_after_write_( false )
+  {
+  }
+
+  // START:
+  // Connect to the python session and start reading commands.
+  void start();
+
+  // The socket of this connection
+  boost::asio::ip::tcp::socket socket_;
+
+  // Largest request that is accepted in binary mode
+  const static size_t MAX_FRAME_SIZE_C;
+
+private:
+  // READ_LINE:
+  // Read the next command in line mode.
+  void read_line();
+  void handle_read_line( const boost::system::error_code& error );
+
+  // READ_FRAME:
+  // Read the next request in binary mode.
+  void read_frame();
+  void handle_read_frame_header( const boost::system::error_code& error );
+  void handle_read_frame_payload( const boost::system::error_code& error );
+
+  // WRITE:
+  // Queue data to be written to the socket.
+  void write( const std::string& data );
+  void handle_write( const boost::system::error_code& error );
+
+  // WRITE_FRAME:
+  // Write a length prefixed frame to the socket.
+  void write_frame( const std::string& data );
+
+  // HANDLE_OUTPUT, HANDLE_PROMPT:
+  // Forward the output of the python session. For binary requests the output is collected
+  // until the prompt indicates that the request has finished.
+  void handle_output( std::string output );
+  void handle_prompt( std::string prompt );
+
+  // CLOSE:
+  // Shut down the connection.
+  void close();
+
+  // POSTOUTPUT, POSTPROMPT:
+  // The python session signals are triggered on the python thread, these functions
+  // relay them to the socket thread.
+  static void PostOutput( ActionSocketSessionWeakHandle session, std::string output );
+  static void PostPrompt( ActionSocketSessionWeakHandle session, std::string prompt );
+
+private:
+  boost::asio::io_service& io_service_;
+
+  // Python session that runs the commands of this connection
+  Core::PythonSessionHandle python_session_;
+
+  // Buffers for incoming data
+  boost::asio::streambuf line_buffer_;
+  unsigned char frame_header_[ 4 ];
+  std::vector< char > frame_payload_;
+
+  // Data waiting to be written to the socket
+  std::deque< std::string > write_queue_;
+
+  // Whether the client switched to length prefixed binary frames
+  bool binary_mode_;
+
+  // Number of line commands that have not returned a prompt yet
+  size_t pending_line_commands_;
+
+  // Number of binary requests that have not finished yet and their collected output
+  size_t pending_frames_;
+  std::string frame_output_;
+
+  // Whether the connection is closed once all the data has been written
+  bool close_after_write_;
+};
+
+const size_t ActionSocketSession::MAX_FRAME_SIZE_C = 256 << 20;
+
+void ActionSocketSession::start()
+{
+  ActionSocketSessionWeakHandle weak_session( this->shared_from_this() );
+  this->python_session_->prompt_signal_.connect( boost::bind( 
+    &ActionSocketSession::PostPrompt, weak_session, _1 ) );
+  this->python_session_->error_signal_.connect( boost::bind( 
+    &ActionSocketSession::PostOutput, weak_session, _1 ) );
+  this->python_session_->output_signal_.connect( boost::bind( 
+    &ActionSocketSession::PostOutput, weak_session, _1 ) );
+
+  CORE_LOG_MESSAGE( "Socket connected." );
+  this->write( "Welcome to Seg3D\r\n" );
+  this->read_line();
+}
+
+void ActionSocketSession::read_line()
+{
+  boost::asio::async_read_until( this->socket_, this->line_buffer_, std::string( "\r\n" ),
+    boost::bind( &ActionSocketSession::handle_read_line, this->shared_from_this(),
+    boost::asio::placeholders::error ) );
+}
+
+void ActionSocketSession::handle_read_line( const boost::system::error_code& error )
+{
+  if ( error )
+  {
+    this->close();
+    return;
+  }
+
+  std::istream is( &this->line_buffer_ );
+  std::string action_string;
+  std::getline( is, action_string );
+  if ( !action_string.empty() && *action_string.rbegin() == '\r' )
+  {
+    action_string.resize( action_string.size() - 1 );
+  }
+
+  if ( action_string == "exit" )
+  {
+    this->close_after_write_ = true;
+    this->write( "Goodbye!\r\n" );
+    return;
+  }
+  
+  if ( action_string == "metrics" )
+  {
+    this->write( ActionSocket::GetMetrics() + "\r\n" );
+    this->read_line();
+    return;
+  }
+
+  if ( action_string == "binary" )
+  {
+    this->binary_mode_ = true;
+    this->write( "Binary mode\r\n" );
+    
+    // NOTE: The client may have sent the first frames already
+    this->read_frame();
+    return;
+  }
+
+  this->pending_line_commands_++;
+  Core::PythonInterpreter::Instance()->run_string( action_string, this->python_session_ );
+  this->read_line();
+}
+
+void ActionSocketSession::read_frame()
+{
+  // Use the data that was read beyond the last line first
+  size_t buffered = this->line_buffer_.size();
+  if ( buffered > 0 )
+  {
+    buffered = buffered < 4 ? buffered : 4;
+    this->line_buffer_.sgetn( reinterpret_cast< char* >( this->frame_header_ ), buffered );
+  }
+
+  boost::asio::async_read( this->socket_, 
+    boost::asio::buffer( this->frame_header_ + buffered, 4 - buffered ),
+    boost::bind( &ActionSocketSession::handle_read_frame_header, this->shared_from_this(),
+    boost::asio::placeholders::error ) );
+}
+
+void ActionSocketSession::handle_read_frame_header( const boost::system::error_code& error )
+{
+  if ( error )
+  {
+    this->close();
+    return;
+  }
+
+  size_t frame_size = ( static_cast< size_t >( this->frame_header_[ 0 ] ) << 24 ) |
+    ( static_cast< size_t >( this->frame_header_[ 1 ] ) << 16 ) |
+    ( static_cast< size_t >( this->frame_header_[ 2 ] ) << 8 ) |
+    static_cast< size_t >( this->frame_header_[ 3 ] );
+
+  if ( frame_size > MAX_FRAME_SIZE_C )
+  {
+    CORE_LOG_ERROR( "Socket request of " + Core::ExportToString( frame_size ) + 
+      " bytes is too large." );
+    this->close();
+    return;
+  }
+  
+  this->frame_payload_.resize( frame_size );
+  size_t buffered = this->line_buffer_.size();
+  buffered = buffered < frame_size ? buffered : frame_size;
+  if ( buffered > 0 )
+  {
+    this->line_buffer_.sgetn( &this->frame_payload_[ 0 ], buffered );
+  }
+
+  if ( buffered == frame_size )
+  {
+    this->handle_read_frame_payload( boost::system::error_code() );
+    return;
+  }
+
+  boost::asio::async_read( this->socket_, 
+    boost::asio::buffer( &this->frame_payload_[ buffered ], frame_size - buffered ),
+    boost::bind( &ActionSocketSession::handle_read_frame_payload, this->shared_from_this(),
+    boost::asio::placeholders::error ) );
+}
+
+void ActionSocketSession::handle_read_frame_payload( const boost::system::error_code& error )
+{
+  if ( error )
+  {
+    this->close();
+    return;
+  }
+
+  std::string script;
+  if ( !this->frame_payload_.empty() )
+  {
+    script.assign( &this->frame_payload_[ 0 ], this->frame_payload_.size() );
+  }
+
+  this->pending_frames_++;
+  Core::PythonInterpreter::Instance()->run_script( script, this->python_session_ );
+  this->read_frame();
+}
+
+void ActionSocketSession::write( const std::string& data )
+{
+  if ( !this->socket_.is_open() ) return;
+
+  bool write_in_progress = !this->write_queue_.empty();
+  this->write_queue_.push_back( data );
+  if ( !write_in_progress )
+  {
+    boost::asio::async_write( this->socket_, boost::asio::buffer( this->write_queue_.front() ),
+      boost::bind( &ActionSocketSession::handle_write, this->shared_from_this(),
+      boost::asio::placeholders::error ) );
+  }
+}
+
+void ActionSocketSession::handle_write( const boost::system::error_code& error )
+{
+  if ( error )
+  {
+    this->write_queue_.clear();
+    this->close();
+    return;
+  }
+
+  this->write_queue_.pop_front();
+  if ( !this->write_queue_.empty() )
+  {
+    boost::asio::async_write( this->socket_, boost::asio::buffer( this->write_queue_.front() ),
+      boost::bind( &ActionSocketSession::handle_write, this->shared_from_this(),
+      boost::asio::placeholders::error ) );
+  }
+  else if ( this->close_after_write_ )
+  {
+    this->close();
+  }
+}
+
+void ActionSocketSession::write_frame( const std::string& data )
+{
+  std::string frame( 4, '\0' );
+  frame[ 0 ] = static_cast< char >( ( data.size() >> 24 ) & 0xff );
+  frame[ 1 ] = static_cast< char >( ( data.size() >> 16 ) & 0xff );
+  frame[ 2 ] = static_cast< char >( ( data.size() >> 8 ) & 0xff );
+  frame[ 3 ] = static_cast< char >( data.size() & 0xff );
+  this->write( frame + data );
+}
+
+void ActionSocketSession::handle_output( std::string output )
+{
+  if ( this->pending_line_commands_ == 0 && this->pending_frames_ > 0 )
+  {
+    this->frame_output_ += output;
+  }
+  else
+  {
+    this->write( output );
+  }
+}
+
+void ActionSocketSession::handle_prompt( std::string prompt )
+{
+  // Prompts are returned in the order in which the commands were sent, so the ones for
+  // line commands that were sent before switching to binary mode come first.
+  if ( this->pending_line_commands_ > 0 )
+  {
+    this->pending_line_commands_--;
+    this->write( "\r\n" + prompt );
+  }
+  else if ( this->pending_frames_ > 0 )
+  {
+    this->pending_frames_--;
+    this->write_frame( this->frame_output_ );
+    this->frame_output_.clear();
+  }
+}
+
+void ActionSocketSession::close()
+{
+  if ( !this->socket_.is_open() ) return;
+
+  boost::system::error_code ec;
+  this->socket_.shutdown( boost::asio::ip::tcp::socket::shutdown_both, ec );
+  this->socket_.close( ec );
+  CORE_LOG_MESSAGE( "Socket disconnected." );
+}
+
+void ActionSocketSession::PostOutput( ActionSocketSessionWeakHandle session, 
+  std::string output )
+{
+  ActionSocketSessionHandle handle = session.lock();
+  if ( handle )
+  {
+    handle->io_service_.post( boost::bind( &ActionSocketSession::handle_output, 
+      handle, output ) );
+  }
+}
+
+void ActionSocketSession::PostPrompt( ActionSocketSessionWeakHandle session, 
+  std::string prompt )
+{
+  ActionSocketSessionHandle handle = session.lock();
+  if ( handle )
   {
-    boost::asio::write( socket, boost::asio::buffer( output ) );
+    handle->io_service_.post( boost::bind( &ActionSocketSession::handle_prompt, 
+      handle, prompt ) );
   }
-  catch ( ... ) {}
 }
 
-static void WritePromptToSocket( boost::asio::ip::tcp::socket& socket, std::string output )
+//////////////////////////////////////////////////////////////////////////
+// Class ActionSocketPrivate
+//////////////////////////////////////////////////////////////////////////
+
+class ActionSocketPrivate
+{
+public:
+  ActionSocketPrivate() :
+    acceptor_( io_service_ )
+  {
+  }
+
+  // START_ACCEPT:
+  // Wait asynchronously for the next client.
+  void start_accept();
+  void handle_accept( ActionSocketSessionHandle session, const boost::system::error_code& error );
+
+  boost::asio::io_service io_service_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+};
+
+void ActionSocketPrivate::start_accept()
 {
-  output = "\r\n" + output;
-  WriteOutputToSocket( socket, output );
+  ActionSocketSessionHandle session( new ActionSocketSession( this->io_service_ ) );
+  this->acceptor_.async_accept( session->socket_, boost::bind( 
+    &ActionSocketPrivate::handle_accept, this, session, boost::asio::placeholders::error ) );
 }
 
+void ActionSocketPrivate::handle_accept( ActionSocketSessionHandle session, 
+  const boost::system::error_code& error )
+{
+  if ( error ) 
+  {
+    if ( error != boost::asio::error::operation_aborted )
+    {
+      CORE_LOG_ERROR( "Socket failed to accept a connection: " + error.message() );
+    }
+    return;
+  }
+
+  // Wait for the next client first, so a client that fails to start does not stop the server
+  this->start_accept();
+  session->start();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Class ActionSocket
+//////////////////////////////////////////////////////////////////////////
+
 void ActionSocket::run_action_socket( int portnum )
 {
-  boost::asio::io_service io_service;
+  ActionSocketPrivate server;
 
-  boost::asio::ip::tcp::acceptor acceptor( io_service );
+  boost::asio::ip::tcp::acceptor& acceptor = server.acceptor_;
   try
   {
     boost::asio::ip::tcp::endpoint endpoint( boost::asio::ip::tcp::v4(), portnum );
@@ -124,70 +588,32 @@ void ActionSocket::run_action_socket( int portnum )
     rename( "port_tmp", "port" );
   }
 
-  Core::ConnectionHandler connection_handler;
   CORE_LOG_MESSAGE( "Started listening on port " + Core::ExportToString( portnum ) );
 
-  while ( 1 )
+  // NOTE: All the clients are served from this thread. Reading and writing is asynchronous,
+  // hence a slow client does not hold up any of the others.
+  server.start_accept();
+
+  // NOTE: An exception thrown by a handler leaves run(), but the other handlers are still 
+  // queued. The error is logged and the server continues serving the other clients.
+  for ( ;; )
   {
-    boost::asio::ip::tcp::socket socket( io_service );
     try
     {
-      acceptor.accept( socket );
-    }
-    catch ( ... )
-    {
+      server.io_service_.run();
       break;
     }
-
-    // Connect to PythonInterpreter signals
-    connection_handler.add_connection( Core::PythonInterpreter::Instance()->prompt_signal_.connect( 
-      boost::bind( &WritePromptToSocket, boost::ref( socket ), _1 ) ) );
-    connection_handler.add_connection( Core::PythonInterpreter::Instance()->error_signal_.connect( 
-      boost::bind( &WriteOutputToSocket, boost::ref( socket ), _1 ) ) );
-    connection_handler.add_connection( Core::PythonInterpreter::Instance()->output_signal_.connect( 
-      boost::bind( &WriteOutputToSocket, boost::ref( socket ), _1 ) ) );
-
-    CORE_LOG_MESSAGE( "Socket connected." );
-    try
+    catch ( const std::exception& e )
     {
-      boost::asio::write( socket, boost::asio::buffer( std::string( "Welcome to Seg3D\r\n" ) ) );
+      CORE_LOG_ERROR( std::string( "Socket error: " ) + e.what() );
     }
-    catch ( ... ) {}
-
-    boost::system::error_code read_ec;
-    while ( !read_ec )
+    catch ( ... )
     {
-      boost::asio::streambuf buffer;
-
-      boost::asio::read_until( socket, buffer, std::string( "\r\n" ), read_ec );
-      std::istream is( &buffer );
-
-      std::string action_string;
-      std::getline( is, action_string );
-
-      if ( !read_ec )
-      {
-        if ( action_string == "exit\r" )
-        {
-          try
-          {
-            boost::asio::write( socket, boost::asio::buffer( "Goodbye!\r\n" ) );
-            socket.close();
-          }
-          catch ( ... ) {}
-          break;
-        }
-
-        Core::PythonInterpreter::Instance()->run_string( action_string );
-      }
+      CORE_LOG_ERROR( "Socket error: unknown exception." );
     }
-
-    CORE_LOG_MESSAGE( "Socket disconnected." );
-    connection_handler.disconnect_all();
   }
 
   CORE_LOG_MESSAGE( "Stopped listening on port " + Core::ExportToString( portnum ) );
 }
 
 } // end namespace Core
-
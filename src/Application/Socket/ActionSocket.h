@@ -29,6 +29,9 @@
 #ifndef APPLICATION_SOCKET_ACTIONSOCKET_H
 #define APPLICATION_SOCKET_ACTIONSOCKET_H
 
+// STL includes
+#include <string>
+
 // Boost includes
 #include <boost/utility.hpp>
 #include <boost/thread.hpp>
@@ -40,7 +43,16 @@ namespace Seg3D
 {
 
 /// CLASS ACTIONSOCKET
-/// Class that defines a socket for issuing commands
+/// Class that defines a socket for issuing commands. Any number of clients can be connected
+/// at the same time, each client runs its commands in its own python session and only
+/// receives the output of its own commands. Commands are separated by "\r\n" and can be
+/// sent without waiting for the previous ones to finish. The following lines are handled
+/// by the socket itself instead of python:
+///   exit    - close the connection
+///   metrics - return a JSON object with the performance counters
+///   binary  - switch the connection to binary mode. In binary mode every request and every
+///             reply is a 4 byte big endian length followed by that many bytes. A request is
+///             run as a python script and its reply contains all the output of the script.
 
 // Forward declaration
 class AtionSocket;
@@ -60,6 +72,11 @@ private:
 public:
   void start( int portnum );
 
+  /// GETMETRICS:
+  /// Get a JSON object with the performance counters of the application. A client
+  /// requests this object by sending "metrics" over the socket.
+  static std::string GetMetrics();
+
 private:
   static void run_action_socket( int portnum );
 
@@ -68,6 +68,7 @@ CORE_ACTION
   CORE_ACTION_TYPE( "FloodFill", "Flood fill the content of a mask slice "
     "starting from seed points." )
   CORE_ACTION_ARGUMENT( "target", "The ID of the target mask layer." )
+  CORE_ACTION_ARGUMENT_IS_INPLACE( "target" )
   CORE_ACTION_ARGUMENT( "slice_type", "The slicing direction." )
   CORE_ACTION_ARGUMENT( "slice_number", "The slice number to be filled." )
   CORE_ACTION_ARGUMENT( "seed_points", "The world coordinates of seed points." )
@@ -46,6 +46,7 @@ class ActionPaint : public LayerAction
   ( 
     CORE_ACTION_TYPE( "Paint", "Paint with the specified paint tool.")
     CORE_ACTION_ARGUMENT( "target", "The ID of the target mask layer." )
+    CORE_ACTION_ARGUMENT_IS_INPLACE( "target" )
     CORE_ACTION_ARGUMENT( "slice_type", "The slicing direction to be painted on." )
     CORE_ACTION_ARGUMENT( "slice_number", "The slice number to be painted on." )
     CORE_ACTION_ARGUMENT( "x", "X coordinates of the brush stroke(in index space)." )
@@ -44,6 +44,7 @@ CORE_ACTION
 ( 
   CORE_ACTION_TYPE( "Paste", "Paste the content of the clipboard onto a mask slice.")
   CORE_ACTION_ARGUMENT( "target", "The ID of the target mask layer." )
+  CORE_ACTION_ARGUMENT_IS_INPLACE( "target" )
   CORE_ACTION_ARGUMENT( "slice_type", "The slicing direction." )
   CORE_ACTION_ARGUMENT( "min_slice", "The minimum slice number to paste onto." )
   CORE_ACTION_ARGUMENT( "max_slice", "The maximum slice number to paste onto." )
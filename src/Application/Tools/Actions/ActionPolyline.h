@@ -50,6 +50,7 @@ CORE_ACTION
   CORE_ACTION_TYPE( "Polyline", "Fill or erase a slice of a mask layer within "
                     "the region enclosed by the polyline.")
   CORE_ACTION_ARGUMENT( "target", "The ID of the target mask layer." )
+  CORE_ACTION_ARGUMENT_IS_INPLACE( "target" )
   CORE_ACTION_ARGUMENT( "slice_type", "The slicing direction to be painted on." )
   CORE_ACTION_ARGUMENT( "slice_number", "The slice number to be painted on." )
   CORE_ACTION_ARGUMENT( "erase", "Whether to erase." )
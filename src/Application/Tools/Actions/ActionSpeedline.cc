@@ -26,12 +26,19 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <list>
+
 #include <boost/math/special_functions/round.hpp>
+#include <boost/thread.hpp>
 
 #include <Core/Action/ActionFactory.h>
+#include <Core/Application/Application.h>
 #include <Core/Volume/MaskVolumeSlice.h>
 #include <Core/Volume/DataVolumeSlice.h>
 #include <Core/Geometry/Path.h>
+#include <Core/Utils/Lockable.h>
+#include <Core/Utils/Parallel.h>
 
 #include <Core/ITKSpeedLine/itkSpeedFunctionToPathFilter.h>
 #include <Core/ITKSpeedLine/itkArrivalFunctionToPathFilter.h>
@@ -48,6 +55,7 @@
 #include <itkRescaleIntensityImageFilter.h>
 #include <itkDiscreteGaussianImageFilter.h>
 #include <itkExtractImageFilter.h>
+#include <itkFastMarchingUpwindGradientImageFilter.h>
 #include <itkLinearInterpolateImageFunction.h>
 #include <itkPathIterator.h>
 #include <itkIndex.h>
@@ -66,26 +74,193 @@ CORE_REGISTER_ACTION( Seg3D, Speedline )
 namespace Seg3D
 {
 
+// Types of the two dimensional images used for computing the paths
+typedef itk::Image< double, 2 > SpeedlineImageType;
+typedef SpeedlineImageType::RegionType SpeedlineRegionType;
+
+// Smallest margin in pixels of the band around a segment in which its path is computed
+const static double SPEEDLINE_MIN_MARGIN_C = 32.0;
+
+// Margin of the band around a segment as a fraction of the length of the segment
+const static double SPEEDLINE_MARGIN_FACTOR_C = 0.5;
+
+// Arrival maps are computed on a band this many times wider than needed, so the map of an
+// anchor can be reused while the other end of the segment is dragged around
+const static double SPEEDLINE_ARRIVAL_MARGIN_SCALE_C = 2.0;
+
+// Number of bytes of arrival maps that are kept. A map that is larger by itself is still kept
+// until the next one is computed.
+const static size_t SPEEDLINE_CACHE_BYTES_C = 256 * 1024 * 1024;
+
+// CLASS SpeedlineArrivalCache:
+// Arrival maps of the fast marching from the anchors of the speedline. The map only depends
+// on the speed image and the anchor it starts from, hence a segment whose start point did not
+// move reuses the map as long as it covers the band of the segment. The maps of a layer are
+// dropped when it is deleted, and all of them when the application is reset.
+
+class SpeedlineArrivalCache : public Core::Lockable
+{
+public:
+  SpeedlineArrivalCache() :
+    size_( 0 ),
+    connected_( false )
+  {
+  }
+
+  // FIND:
+  // Find a map of the anchor on the slice that covers the region.
+  SpeedlineImageType::Pointer find( const std::string& layer_id, 
+    Core::DataBlock::generation_type generation, int slice_type, size_t slice_number, 
+    const Core::Point& anchor, const SpeedlineRegionType& region )
+  {
+    lock_type lock( this->get_mutex() );
+    std::list< Entry >::iterator it = this->entries_.begin();
+    for ( ; it != this->entries_.end(); ++it )
+    {
+      if ( it->layer_id_ == layer_id && it->generation_ == generation && 
+        it->slice_type_ == slice_type && it->slice_number_ == slice_number &&
+        it->anchor_ == anchor && it->arrival_->GetLargestPossibleRegion().IsInside( region ) )
+      {
+        this->entries_.splice( this->entries_.begin(), this->entries_, it );
+        return it->arrival_;
+      }
+    }
+    return SpeedlineImageType::Pointer();
+  }
+
+  // INSERT:
+  // Add a map to the cache, dropping the least recently used ones.
+  void insert( const std::string& layer_id, Core::DataBlock::generation_type generation, 
+    int slice_type, size_t slice_number, const Core::Point& anchor, 
+    SpeedlineImageType::Pointer arrival )
+  {
+    Entry entry;
+    entry.layer_id_ = layer_id;
+    entry.generation_ = generation;
+    entry.slice_type_ = slice_type;
+    entry.slice_number_ = slice_number;
+    entry.anchor_ = anchor;
+    entry.arrival_ = arrival;
+
+    entry.size_ = arrival->GetLargestPossibleRegion().GetNumberOfPixels() * 
+      sizeof( SpeedlineImageType::PixelType );
+
+    lock_type lock( this->get_mutex() );
+    
+    // NOTE: The cache is created before the layer manager, hence it connects to its signals 
+    // once it holds maps.
+    if ( !this->connected_ )
+    {
+      LayerManager::Instance()->layers_deleted_signal_.connect( boost::bind( 
+        &SpeedlineArrivalCache::handle_layers_deleted, this, _1 ) );
+      Core::Application::Instance()->reset_signal_.connect( boost::bind( 
+        &SpeedlineArrivalCache::clear, this ) );
+      this->connected_ = true;
+    }
+
+    this->entries_.push_front( entry );
+    this->size_ += entry.size_;
+    while ( this->size_ > SPEEDLINE_CACHE_BYTES_C && this->entries_.size() > 1 ) 
+    {
+      this->size_ -= this->entries_.back().size_;
+      this->entries_.pop_back();
+    }
+  }
+
+  // CLEAR:
+  // Remove all the maps.
+  void clear()
+  {
+    lock_type lock( this->get_mutex() );
+    this->entries_.clear();
+    this->size_ = 0;
+  }
+
+private:
+  // HANDLE_LAYERS_DELETED:
+  // Remove the maps computed on the deleted layers.
+  void handle_layers_deleted( std::vector< std::string > layer_ids )
+  {
+    lock_type lock( this->get_mutex() );
+    std::list< Entry >::iterator it = this->entries_.begin();
+    while ( it != this->entries_.end() )
+    {
+      if ( std::find( layer_ids.begin(), layer_ids.end(), it->layer_id_ ) != layer_ids.end() )
+      {
+        this->size_ -= it->size_;
+        it = this->entries_.erase( it );
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  class Entry
+  {
+  public:
+    std::string layer_id_;
+    Core::DataBlock::generation_type generation_;
+    int slice_type_;
+    size_t slice_number_;
+    Core::Point anchor_;
+    SpeedlineImageType::Pointer arrival_;
+    size_t size_;
+  };
+
+  // Most recently used maps are at the front
+  std::list< Entry > entries_;
+
+  // Number of bytes held by the maps
+  size_t size_;
+
+  // Whether the cache is connected to the signals that invalidate it
+  bool connected_;
+};
+
+static SpeedlineArrivalCache SpeedlineArrivalCacheInstance;
+
+// CLASS SpeedlineSegment:
+// Segment between two vertices of the speedline, which is computed on its own thread.
+
+class SpeedlineSegment
+{
+public:
+  int start_index_;
+  int end_index_;
+
+  // Arrival map from the start point, or the speed image to compute it from when the map was 
+  // not in the cache
+  SpeedlineImageType::Pointer arrival_;
+  SpeedlineImageType::Pointer speed_;
+
+  Core::SinglePath path_;
+};
+
 class ActionSpeedlineAlgo : public  ITKFilter
 {
 public:
   static const unsigned int DIMENSION_C = 2;
   typedef double pixel_type;
-  typedef itk::Image< pixel_type, DIMENSION_C > image_type;
+  typedef SpeedlineImageType image_type;
   typedef itk::PolyLineParametricPath< DIMENSION_C > path_type;
-  typedef itk::SpeedFunctionToPathFilter< image_type, path_type > path_filter_type;
+  typedef itk::ArrivalFunctionToPathFilter< image_type, path_type > path_filter_type;
   typedef path_filter_type::CostFunctionType::CoordRepType coord_rep_type; // double
 
   typedef itk::ContinuousIndex< double, 3 >   continuous_index_type;
   typedef itk::Point< double, 3 > itk_point_type;
 
-  image_type::Pointer speed_image_2D_;
   Core::Path itk_paths_;
   Core::Path world_paths_;
 
   continuous_index_type start_point_cindex_; // Continuous index for start point
   std::vector< continuous_index_type > vertices_cindex_;
 
+  // Region of the whole slice and generation of the data it was taken from
+  SpeedlineRegionType slice_region_;
+  Core::DataBlock::generation_type generation_;
+
 public:
   std::string target_layer_id_;
   int slice_type_;
@@ -161,8 +336,152 @@ public:
     return is_successed;
   }
 
-  void compute_path ( int start_index, int end_index )
+  // GET_SLICE_AXES:
+  // Get the axes of the volume that span the slice.
+  void get_slice_axes( int& axis0, int& axis1 ) const
+  {
+    if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E )
+    {
+      axis0 = 1; axis1 = 2;
+    }
+    else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E )
+    {
+      axis0 = 0; axis1 = 2;
+    }
+    else
+    {
+      axis0 = 0; axis1 = 1;
+    }
+  }
+
+  // GET_SLICE_POINT:
+  // Get the position of a vertex in the physical space of the slice image.
+  path_filter_type::PointType get_slice_point( const Core::Point& vertex ) const
   {
+    int axis0, axis1;
+    this->get_slice_axes( axis0, axis1 );
+    path_filter_type::PointType pnt;
+    pnt[ 0 ] = vertex[ axis0 ];
+    pnt[ 1 ] = vertex[ axis1 ];
+    return pnt;
+  }
+
+  // GET_BAND_REGION:
+  // Get the band of the slice around the bounding box of a segment. The margin grows with the
+  // length of the segment, so the path has room to follow the features of the image.
+  SpeedlineRegionType get_band_region( int start_index, int end_index, double scale ) const
+  {
+    int axis0, axis1;
+    this->get_slice_axes( axis0, axis1 );
+    const continuous_index_type& c0 = this->vertices_cindex_[ start_index ];
+    const continuous_index_type& c1 = this->vertices_cindex_[ end_index ];
+
+    double dx = c1[ axis0 ] - c0[ axis0 ];
+    double dy = c1[ axis1 ] - c0[ axis1 ];
+    double margin = scale * std::max( SPEEDLINE_MIN_MARGIN_C, 
+      SPEEDLINE_MARGIN_FACTOR_C * std::sqrt( dx * dx + dy * dy ) );
+
+    SpeedlineRegionType::IndexType start;
+    SpeedlineRegionType::SizeType size;
+    int axes[ 2 ] = { axis0, axis1 };
+    for ( int d = 0; d < 2; d++ )
+    {
+      long slice_start = this->slice_region_.GetIndex()[ d ];
+      long slice_end = slice_start + static_cast< long >( this->slice_region_.GetSize()[ d ] );
+      long lower = static_cast< long >( std::floor( std::min( c0[ axes[ d ] ], 
+        c1[ axes[ d ] ] ) - margin ) );
+      long upper = static_cast< long >( std::ceil( std::max( c0[ axes[ d ] ], 
+        c1[ axes[ d ] ] ) + margin ) ) + 1;
+      lower = std::min( std::max( lower, slice_start ), slice_end - 1 );
+      upper = std::max( std::min( upper, slice_end ), lower + 1 );
+      start[ d ] = lower;
+      size[ d ] = static_cast< SpeedlineRegionType::SizeValueType >( upper - lower );
+    }
+
+    SpeedlineRegionType region;
+    region.SetIndex( start );
+    region.SetSize( size );
+    return region;
+  }
+
+  // EXTRACT_SPEED_IMAGE:
+  // Extract a band of the slice from the volume.
+  // NOTE: The extracted image keeps the index and origin of the slice, hence continuous
+  // indices of the path are indices into the whole slice.
+  template< class VALUE_TYPE >
+  image_type::Pointer extract_speed_image( typename itk::Image< VALUE_TYPE, 3 >::Pointer image, 
+    const SpeedlineRegionType& region )
+  {
+    typedef itk::Image< VALUE_TYPE, 3 > typed_image_type;
+    typedef itk::ExtractImageFilter< typed_image_type, image_type > extract_filter_type;
+    typename extract_filter_type::Pointer extract_filter = extract_filter_type::New();
+
+    int axis0, axis1;
+    this->get_slice_axes( axis0, axis1 );
+
+    typename typed_image_type::SizeType size;
+    typename typed_image_type::IndexType start;
+    size.Fill( 0 );
+    start.Fill( static_cast< long >( this->slice_number_ ) );
+    size[ axis0 ] = region.GetSize()[ 0 ];
+    size[ axis1 ] = region.GetSize()[ 1 ];
+    start[ axis0 ] = region.GetIndex()[ 0 ];
+    start[ axis1 ] = region.GetIndex()[ 1 ];
+
+    typename typed_image_type::RegionType desired_region;
+    desired_region.SetSize( size );
+    desired_region.SetIndex( start );
+
+    extract_filter->SetExtractionRegion( desired_region );
+    extract_filter->SetInput( image );
+    extract_filter->Update();
+
+    image_type::Pointer speed_image = extract_filter->GetOutput();
+    speed_image->DisconnectPipeline();
+    return speed_image;
+  }
+
+  // COMPUTE_ARRIVAL_MAP:
+  // Run the fast marching over the band from the start point of the segment.
+  image_type::Pointer compute_arrival_map( image_type::Pointer speed_image, 
+    const Core::Point& start_point )
+  {
+    typedef itk::FastMarchingUpwindGradientImageFilter< image_type, image_type > 
+      marching_type;
+    marching_type::Pointer marching = marching_type::New();
+    marching->SetInput( speed_image );
+    marching->SetGenerateGradientImage( false );
+
+    marching_type::IndexType index;
+    speed_image->TransformPhysicalPointToIndex( this->get_slice_point( start_point ), index );
+    marching_type::NodeType node;
+    node.SetValue( 0.0 );
+    node.SetIndex( index );
+    marching_type::NodeContainer::Pointer trial = marching_type::NodeContainer::New();
+    trial->Initialize();
+    trial->InsertElement( 0, node );
+    marching->SetTrialPoints( trial );
+
+    marching->UpdateLargestPossibleRegion();
+    image_type::Pointer arrival = marching->GetOutput();
+    arrival->DisconnectPipeline();
+    return arrival;
+  }
+
+  // COMPUTE_SEGMENT:
+  // Back propagate from the end point of the segment through the arrival map.
+  void compute_segment( SpeedlineSegment& segment )
+  {
+    const Core::Point& start_point = this->vertices_[ segment.start_index_ ];
+    const Core::Point& end_point = this->vertices_[ segment.end_index_ ];
+
+    if ( !segment.arrival_ )
+    {
+      segment.arrival_ = this->compute_arrival_map( segment.speed_, start_point );
+      SpeedlineArrivalCacheInstance.insert( this->target_layer_id_, this->generation_, 
+        this->slice_type_, this->slice_number_, start_point, segment.arrival_ );
+    }
+
     // Create interpolator
 
     typedef itk::LinearInterpolateImageFunction< image_type, coord_rep_type >
@@ -176,7 +495,7 @@ public:
 
     // Create optimizer
 
-    image_type::SpacingType spacing = this->speed_image_2D_->GetSpacing();
+    image_type::SpacingType spacing = segment.arrival_->GetSpacing();
     double min_spacing = ( spacing[ 0 ] < spacing[ 1 ] ) ? spacing[ 0 ] : spacing[ 1 ];
     double max_step = 0.5 * min_spacing;
     double min_step = 0.001 * min_spacing;
@@ -195,250 +514,131 @@ public:
     path_filter->SetCostFunction( cost );
     path_filter->SetOptimizer( optimizer );
     path_filter->SetTerminationValue( this->termination_ * min_spacing );
-    path_filter->SetInput( this->speed_image_2D_ );
-
-    if ( !this->update_all_paths_ )
-    {
-      // Add the seed points.
-      path_filter_type::PathInfo  info;
-      path_filter_type::PointType pnt;
-
-      if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E )
-      {
-        pnt[0] = this->vertices_[ start_index ].y();
-        pnt[1] = this->vertices_[ start_index ].z();
-
-      }
-      else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E )
-      {
-        pnt[0] = this->vertices_[ start_index ].x();
-        pnt[1] = this->vertices_[ start_index ].z();
-
-      }
-      else
-      {
-        pnt[0] = this->vertices_[ start_index ].x();
-        pnt[1] = this->vertices_[ start_index ].y();
-      }
-
-      info.SetStartPoint( pnt );
+    path_filter->SetInput( segment.arrival_ );
+    path_filter->SetPathEndPoint( this->get_slice_point( end_point ) );
+    path_filter->Update();
 
-      if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E )
-      {
-        pnt[0] = this->vertices_[ end_index ].y();
-        pnt[1] = this->vertices_[ end_index ].z();
+    segment.path_ = Core::SinglePath( start_point, end_point );
 
-      }
-      else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E )
-      {
-        pnt[0] = this->vertices_[ end_index ].x();
-        pnt[1] = this->vertices_[ end_index ].z();
+    path_type::Pointer itk_path = path_filter->GetOutput( 0 );
+    size_t vertex_list_size = itk_path->GetVertexList()->Size();
 
-      }
-      else
-      {
-        pnt[0] = this->vertices_[ end_index ].x();
-        pnt[1] = this->vertices_[ end_index ].y();
-      }
-
-      info.SetEndPoint( pnt );
-
-      path_filter->AddPathInfo( info );
-      path_filter->Update();
-
-      Core::SinglePath new_path( this->vertices_[ start_index ], this->vertices_[ end_index ] );
-
-      path_type::Pointer itk_path = path_filter->GetOutput( 0 );
-      size_t vertex_list_size = itk_path->GetVertexList()->Size();
-
-      // Need to check if this path has been successfully computed. 
-      // The criterion is the last point is in the same pixel as start point.
-      // IF not, we just put a straight line between start point and end point.
-
-      bool is_successed = false;
-
-      if ( vertex_list_size > 0 )
-      {
-      
-        const double x0 = itk_path->GetVertexList()->ElementAt( vertex_list_size - 1 )[0];
-        const double y0 = itk_path->GetVertexList()->ElementAt( vertex_list_size - 1 )[1];
-
-        is_successed = is_path_completed( x0, y0, start_index );
-
-      }
-
-      if ( is_successed )
-      {
-        for ( unsigned int k = 0; k < vertex_list_size; k++ )
-        {
-          const double x = itk_path->GetVertexList()->ElementAt( k )[0];
-          const double y = itk_path->GetVertexList()->ElementAt( k )[1];
-
-          Core::Point ipnt;
-
-          if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E ) // SAGITTAL_E = 2
-          {
-            ipnt[0] = this->slice_number_;
-            ipnt[1] = x;
-            ipnt[2] = y;
-          }
-          else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E ) // CORONAL_E = 1
-          {
-            ipnt[0] = x;
-            ipnt[1] = this->slice_number_;
-            ipnt[2] = y;
-          }
-          else
-          {
-            ipnt[0] = x;
-            ipnt[1] = y;
-            ipnt[2] = this->slice_number_;
-          }
-          new_path.add_a_point( ipnt );
-        }
-      }
+    // Need to check if this path has been successfully computed. 
+    // The criterion is the last point is in the same pixel as start point.
+    // IF not, we just put a straight line between start point and end point.
 
+    bool is_successed = false;
 
-      this->itk_paths_.add_one_path( new_path );
-    }
-    else
+    if ( vertex_list_size > 0 )
     {
-      // update each path in new slice
-      Core::Path updated_paths;
-
-      this->itk_paths_.delete_all_paths();
-      size_t vertices_num = this->vertices_.size();
+      const double x0 = itk_path->GetVertexList()->ElementAt( vertex_list_size - 1 )[0];
+      const double y0 = itk_path->GetVertexList()->ElementAt( vertex_list_size - 1 )[1];
 
+      is_successed = is_path_completed( x0, y0, segment.start_index_ );
+    }
 
-      for ( unsigned int i = 0; i < vertices_num; ++i )
+    if ( is_successed )
+    {
+      for ( unsigned int k = 0; k < vertex_list_size; k++ )
       {
-        if ( i == 1 && vertices_num == 2)
-        {
-          break; //just update one path, not a loop
-        }
+        const double x = itk_path->GetVertexList()->ElementAt( k )[0];
+        const double y = itk_path->GetVertexList()->ElementAt( k )[1];
 
-        Core::Point p0, p1;
-        p0 = this->vertices_[ i ];
-        p1 = this->vertices_[ ( i + 1 ) % vertices_num ];
+        Core::Point ipnt;
 
-        path_filter_type::PathInfo  info;
-        path_filter_type::PointType pnt;
-
-        if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E )
-        {
-          pnt[0] = p0.y();
-          pnt[1] = p0.z();
-
-        }
-        else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E )
-        {
-          pnt[0] = p0.x();
-          pnt[1] = p0.z();
-
-        }
-        else
+        if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E ) // SAGITTAL_E = 2
         {
-          pnt[0] = p0.x();
-          pnt[1] = p0.y();
+          ipnt[0] = this->slice_number_;
+          ipnt[1] = x;
+          ipnt[2] = y;
         }
-
-        info.SetStartPoint( pnt );
-
-        if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E )
+        else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E ) // CORONAL_E = 1
         {
-          pnt[0] = p1.y();
-          pnt[1] = p1.z();
-
-        }
-        else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E )
-        {
-          pnt[0] = p1.x();
-          pnt[1] = p1.z();
-
+          ipnt[0] = x;
+          ipnt[1] = this->slice_number_;
+          ipnt[2] = y;
         }
         else
         {
-          pnt[0] = p1.x();
-          pnt[1] = p1.y();
+          ipnt[0] = x;
+          ipnt[1] = y;
+          ipnt[2] = this->slice_number_;
         }
-
-        info.SetEndPoint( pnt );
-
-        path_filter->AddPathInfo( info );
+        segment.path_.add_a_point( ipnt );
       }
-      
-      path_filter->Update();
+    }
+  }
 
-      size_t num_of_outputs = path_filter->GetNumberOfOutputs(); 
-      for ( unsigned int j = 0; j < num_of_outputs; ++j )
+  void compute_segments_parallel( std::vector< SpeedlineSegment >& segments, int thread, 
+    int num_threads, boost::barrier& barrier )
+  {
+    for ( size_t j = thread; j < segments.size(); j += num_threads )
+    {
+      try
       {
-        Core::Point p0, p1;
-
-        p0 = this->vertices_[ j ];
-        p1 = this->vertices_[ ( j + 1 ) % vertices_num ];
-        Core::SinglePath new_path( p0, p1 );
-
-        path_type::Pointer itk_path = path_filter->GetOutput( j );
-        size_t vertex_list_size = itk_path->GetVertexList()->Size();
-
-        // Need to check if this path has been successfully computed. 
-        // The criterion is the last point is in the same pixel as start point.
-        // IF not, we just put a straight line between start point and end point.
-
-        bool is_succeed = false;
-
-        if ( vertex_list_size > 0 )
-        {
-
-          const double x0 = itk_path->GetVertexList()->ElementAt( vertex_list_size - 1 )[0];
-          const double y0 = itk_path->GetVertexList()->ElementAt( vertex_list_size - 1 )[1];
-
-          is_succeed = is_path_completed( x0, y0, j );
-        }
-
-        if ( is_succeed )
-        {
-          for ( unsigned int k = 0; k < vertex_list_size; ++k )
-          {
-            const double x = itk_path->GetVertexList()->ElementAt( k )[0];
-            const double y = itk_path->GetVertexList()->ElementAt( k )[1];
-
-            Core::Point ipnt;
-
-            if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E ) // SAGITTAL_E = 2
-            {
-              ipnt[0] = this->slice_number_;
-              ipnt[1] = x;
-              ipnt[2] = y;
-
-            }
-            else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E ) // CORONAL_E = 1
-            {
-              ipnt[0] = x;
-              ipnt[1] = this->slice_number_;
-              ipnt[2] = y;
-            }
-            else
-            {
-              ipnt[0] = x;
-              ipnt[1] = y;
-              ipnt[2] = this->slice_number_;
-            }
-            new_path.add_a_point( ipnt );
-          }
-        }
-
-        updated_paths.add_one_path( new_path );
+        this->compute_segment( segments[ j ] );
       }
+      catch ( ... )
+      {
+        // A failed segment is drawn as a straight line
+        segments[ j ].path_ = Core::SinglePath( this->vertices_[ segments[ j ].start_index_ ],
+          this->vertices_[ segments[ j ].end_index_ ] );
+      }
+    }
+  }
 
-      this->itk_paths_.delete_all_paths();
-
-      for ( unsigned int i = 0; i < updated_paths.get_path_num(); ++i )
+  // COMPUTE_PATHS:
+  // Compute the paths of the segments and add them to the paths of the speedline. Segments
+  // reuse the arrival maps of their start points where possible, the others are computed on
+  // their own band of the slice, and the segments are solved in parallel.
+  template< class VALUE_TYPE >
+  void compute_paths( typename itk::Image< VALUE_TYPE, 3 >::Pointer image,
+    std::vector< SpeedlineSegment >& segments )
+  {
+    for ( size_t j = 0; j < segments.size(); j++ )
+    {
+      SpeedlineSegment& segment = segments[ j ];
+      SpeedlineRegionType region = this->get_band_region( segment.start_index_, 
+        segment.end_index_, 1.0 );
+      segment.arrival_ = SpeedlineArrivalCacheInstance.find( this->target_layer_id_, 
+        this->generation_, this->slice_type_, this->slice_number_, 
+        this->vertices_[ segment.start_index_ ], region );
+      if ( !segment.arrival_ )
       {
-        this->itk_paths_.add_one_path( updated_paths.get_one_path( i ) );
+        segment.speed_ = this->extract_speed_image< VALUE_TYPE >( image, 
+          this->get_band_region( segment.start_index_, segment.end_index_, 
+          SPEEDLINE_ARRIVAL_MARGIN_SCALE_C ) );
       }
     }
-    
+
+    int num_threads = static_cast< int >( std::min( segments.size(), 
+      static_cast< size_t >( std::max( 1u, boost::thread::hardware_concurrency() ) ) ) );
+    if ( num_threads > 1 )
+    {
+      Core::Parallel parallel( boost::bind( &ActionSpeedlineAlgo::compute_segments_parallel, 
+        this, boost::ref( segments ), _1, _2, _3 ), num_threads );
+      parallel.run();
+    }
+    else if ( num_threads == 1 )
+    {
+      boost::barrier barrier( 1 );
+      this->compute_segments_parallel( segments, 0, 1, barrier );
+    }
+
+    for ( size_t j = 0; j < segments.size(); j++ )
+    {
+      this->itk_paths_.add_one_path( segments[ j ].path_ );
+    }
+  }
+
+  // ADD_SEGMENT:
+  // Add a segment between two vertices to the list of segments to compute.
+  void add_segment( std::vector< SpeedlineSegment >& segments, int start_index, int end_index )
+  {
+    SpeedlineSegment segment;
+    segment.start_index_ = start_index;
+    segment.end_index_ = end_index;
+    segments.push_back( segment );
   }
 
   // When mouse is moved, clean the temporary paths
@@ -589,45 +789,22 @@ public:
       this->vertices_cindex_.push_back( cindex );
     }
 
-    // Create 2D itk image
-    typedef itk::ExtractImageFilter< TYPED_IMAGE_TYPE, image_type >  extract_filter_type;
-    typename extract_filter_type::Pointer extract_filter = extract_filter_type::New();
-    
+    // Region of the slice, the paths are computed on bands of it
     typename TYPED_IMAGE_TYPE::RegionType input_region = 
       speed_image_3D->get_image()->GetLargestPossibleRegion();
-    typename TYPED_IMAGE_TYPE::SizeType size = input_region.GetSize();
-    typename TYPED_IMAGE_TYPE::IndexType start = input_region.GetIndex();
-
-    if ( this->slice_type_ == Core::VolumeSliceType::SAGITTAL_E )
-    {
-      // Collapse Dim X
-      size[ 0 ] = 0;
-      start[ 0 ] = this->slice_number_;
-    }
-    else if ( this->slice_type_ == Core::VolumeSliceType::CORONAL_E )
-    {
-      // Collapse Dim Y
-      size[ 1 ] = 0;
-      start[ 1 ] = this->slice_number_;
-
-    }
-    else
-    {
-      // Collapse Dim Z
-      size[ 2 ] = 0;
-      start[ 2 ] = this->slice_number_;
-    }
-
-    typename TYPED_IMAGE_TYPE::RegionType desired_region;
-    desired_region.SetSize( size );
-    desired_region.SetIndex( start );
-
-    extract_filter->SetExtractionRegion( desired_region );
-    extract_filter->SetInput( speed_image_3D->get_image() );
-    extract_filter->Update();
-
-    this->speed_image_2D_ = extract_filter->GetOutput();
-    this->speed_image_2D_->DisconnectPipeline();
+    int axis0, axis1;
+    this->get_slice_axes( axis0, axis1 );
+    SpeedlineRegionType::IndexType slice_start;
+    SpeedlineRegionType::SizeType slice_size;
+    slice_start[ 0 ] = input_region.GetIndex()[ axis0 ];
+    slice_start[ 1 ] = input_region.GetIndex()[ axis1 ];
+    slice_size[ 0 ] = input_region.GetSize()[ axis0 ];
+    slice_size[ 1 ] = input_region.GetSize()[ axis1 ];
+    this->slice_region_.SetIndex( slice_start );
+    this->slice_region_.SetSize( slice_size );
+    this->generation_ = this->target_layer_->get_data_volume()->get_generation();
+
+    std::vector< SpeedlineSegment > segments;
 
     this->itk_paths_.set_start_point( this->vertices_[0] );
     this->itk_paths_.set_end_point( this->vertices_[ this->vertices_.size() - 1 ] );
@@ -640,10 +817,17 @@ public:
 
     if ( this->update_all_paths_ )
     {
-      start_index = 0;
-      end_index = num_of_vertices - 1;
-
-      compute_path( start_index, end_index );
+      // update each path in new slice
+      this->itk_paths_.delete_all_paths();
+      for ( size_t i = 0; i < num_of_vertices; ++i )
+      {
+        if ( i == 1 && num_of_vertices == 2 )
+        {
+          break; //just update one path, not a loop
+        }
+        this->add_segment( segments, static_cast< int >( i ), 
+          static_cast< int >( ( i + 1 ) % num_of_vertices ) );
+      }
     }
     
     else
@@ -664,7 +848,7 @@ public:
 
         this->itk_paths_.delete_all_paths();  //2 points just redraw
 
-        compute_path( start_index, end_index );
+        this->add_segment( segments, start_index, end_index );
       }
       else
       { 
@@ -698,11 +882,15 @@ public:
         p1 = this->vertices_[ end_index ];
         this->itk_paths_.delete_one_path( p0, p1 );
 
-        compute_path( start_index, this->current_vertex_index_ );
-        compute_path( this->current_vertex_index_, end_index );
+        // NOTE: Only the two segments next to the moved vertex are recomputed. The first one
+        // starts at a vertex that did not move, so its arrival map usually comes from the cache.
+        this->add_segment( segments, start_index, this->current_vertex_index_ );
+        this->add_segment( segments, this->current_vertex_index_, end_index );
       }
     }
 
+    this->compute_paths< VALUE_TYPE >( speed_image_3D->get_image(), segments );
+
     this->world_paths_.set_start_point( this->itk_paths_.get_start_point() );
     this->world_paths_.set_end_point( this->itk_paths_.get_end_point() );
 
@@ -581,6 +581,8 @@ void TransformTool::redraw( size_t viewer_id, const Core::Matrix& proj_mat,
       this->private_->shader_->enable();
       this->private_->shader_->set_color( static_cast< float >( color.r() / 255 ), 
         static_cast< float >( color.g() / 255 ), static_cast< float >( color.b() / 255 ) );
+      this->private_->shader_->set_mask_bit( static_cast< int >( static_cast< 
+        Core::MaskVolumeSlice* >( vol_slice.get() )->get_mask_data_block()->get_mask_bit() ) );
     }
 
     slice_tex->enable();
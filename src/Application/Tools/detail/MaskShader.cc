@@ -62,6 +62,8 @@ bool MaskShader::post_initialize()
   this->pixel_size_loc_ = this->get_uniform_location( "pixel_size" );
   this->border_width_loc_ = this->get_uniform_location( "border_width" );
   this->color_loc_ = this->get_uniform_location( "color" );
+  this->mask_bit_loc_ = this->get_uniform_location( "mask_bit" );
+  this->set_mask_bit( -1 );
   this->disable();
   return true;
 }
@@ -86,6 +88,11 @@ void MaskShader::set_border_width( int width )
   glUniform1i( this->border_width_loc_, width );
 }
 
+void MaskShader::set_mask_bit( int mask_bit )
+{
+  glUniform1i( this->mask_bit_loc_, mask_bit );
+}
+
 void MaskShader::set_color( float r, float g, float b )
 {
   glUniform3f( this->color_loc_, r, g, b );
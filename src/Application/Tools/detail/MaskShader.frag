@@ -5,6 +5,15 @@ uniform vec3 color; // color of mask
 uniform float opacity;
 uniform int border_width; // width of the mask border
 uniform vec2 pixel_size; // pixel size in texture space
+uniform int mask_bit; // bit of the mask in a packed texture, or -1 if none
+
+// Get whether the mask is set in a texel, same as in the slice shader
+float unpack_mask( float value )
+{
+  if ( mask_bit < 0 ) return value;
+  float bits = floor( value * 255.0 + 0.5 );
+  return mod( floor( bits / exp2( float( mask_bit ) ) ), 2.0 );
+}
 
 // Test for mask edges
 bool edge_test()
@@ -20,35 +29,35 @@ bool edge_test()
     return true;
   
   // test the pixel to the left
-  if ( texture2D( tex, vec2( left,  gl_TexCoord[0].t ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( tex, vec2( left,  gl_TexCoord[0].t ) ).a ) == 0.0 )
     return true;
 
   // test the pixel to the right
-  if ( texture2D( tex, vec2( right,  gl_TexCoord[0].t ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( tex, vec2( right,  gl_TexCoord[0].t ) ).a ) == 0.0 )
     return true;
 
   // test the pixel below
-  if ( texture2D( tex, vec2( gl_TexCoord[0].s, bottom ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( tex, vec2( gl_TexCoord[0].s, bottom ) ).a ) == 0.0 )
     return true;
 
   // test the pixel above
-  if ( texture2D( tex, vec2( gl_TexCoord[0].s, top ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( tex, vec2( gl_TexCoord[0].s, top ) ).a ) == 0.0 )
     return true;
 
   // test the pixel on the bottom left corner
-  if ( texture2D( tex, vec2( left, bottom ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( tex, vec2( left, bottom ) ).a ) == 0.0 )
     return true;
 
   // test the pixel on the bottom right corner
-  if ( texture2D( tex, vec2( right, bottom ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( tex, vec2( right, bottom ) ).a ) == 0.0 )
     return true;
 
   // test the pixel on the top right corner
-  if ( texture2D( tex, vec2( right, top ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( tex, vec2( right, top ) ).a ) == 0.0 )
     return true;
 
   // test the pixel on the top left corner
-  if ( texture2D( tex, vec2( left, top ) ).a == 0.0 )
+  if ( unpack_mask( texture2D( tex, vec2( left, top ) ).a ) == 0.0 )
     return true;
 
   return false;
@@ -56,7 +65,7 @@ bool edge_test()
 
 vec4 shade_mask()
 {
-  float mask = texture2D( tex, gl_TexCoord[0].st ).a;
+  float mask = unpack_mask( texture2D( tex, gl_TexCoord[0].st ).a );
   if ( mask == 0.0 ) discard;
 
   if ( border_width > 0 )
@@ -53,6 +53,11 @@ public:
   void set_pixel_size( float width, float height );
   void set_border_width( int width );
 
+  // SET_MASK_BIT:
+  // Set the bit of the mask if the texture is a packed mask texture, or -1 if the texture
+  // holds a single mask, which is the default.
+  void set_mask_bit( int mask_bit );
+
 protected:
   virtual bool get_fragment_shader_source( std::string& source );
   virtual bool post_initialize();
@@ -63,6 +68,7 @@ private:
   int opacity_loc_;
   int border_width_loc_;
   int pixel_size_loc_;
+  int mask_bit_loc_;
 };
 
 } // end namespace Seg3D
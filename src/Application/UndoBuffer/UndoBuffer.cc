@@ -27,8 +27,12 @@
  */
 
 // STL includes
+#include <algorithm>
 #include <deque>
 
+// Boost includes
+#include <boost/thread/mutex.hpp>
+
 // Core includes
 #include <Core/Action/ActionContextContainer.h>
 
@@ -75,8 +79,17 @@ public:
   
   UndoBuffer* buffer_;
   long long max_mem_;
+
+  // Total size of the undo and redo stacks, protected by the mutex so it can be
+  // queried from other threads
+  size_t total_byte_size_;
+  mutable boost::mutex total_byte_size_mutex_;
   
   void handle_enable( bool enable );
+
+  // UPDATE_TOTAL_BYTE_SIZE:
+  // Recompute the total size of the undo and redo stacks.
+  void update_total_byte_size();
 };
 
 
@@ -88,10 +101,27 @@ void UndoBufferPrivate::handle_enable( bool enable )
   }
 }
 
+void UndoBufferPrivate::update_total_byte_size()
+{
+  size_t total_byte_size = 0;
+  for ( size_t j = 0; j < this->undo_list_.size(); j++ )
+  {
+    total_byte_size += this->undo_list_[ j ]->get_byte_size();
+  }
+  for ( size_t j = 0; j < this->redo_list_.size(); j++ )
+  {
+    total_byte_size += this->redo_list_[ j ]->get_byte_size();
+  }
+
+  boost::mutex::scoped_lock lock( this->total_byte_size_mutex_ );
+  this->total_byte_size_ = total_byte_size;
+}
+
 UndoBuffer::UndoBuffer() :
   private_( new UndoBufferPrivate )
 {
   this->private_->buffer_ = this;
+  this->private_->total_byte_size_ = 0;
   this->private_->max_mem_ = Core::Application::Instance()->
     get_total_addressable_physical_memory();
   
@@ -145,6 +175,7 @@ void UndoBuffer::insert_undo_item( Core::ActionContextHandle context,
   this->private_->undo_list_.push_front( undo_item );
   
   this->update_undo_tag_signal_( undo_item->get_tag() );
+  this->private_->update_total_byte_size();
   this->buffer_changed_signal_();
 }
 
@@ -176,6 +207,7 @@ bool UndoBuffer::undo( Core::ActionContextHandle context )
   // Update the entries in the menu
   this->update_undo_tag_signal_( this->get_undo_tag() );
   this->update_redo_tag_signal_( this->get_redo_tag() );
+  this->private_->update_total_byte_size();
   this->buffer_changed_signal_();
 
   return true;
@@ -200,6 +232,7 @@ bool UndoBuffer::redo( Core::ActionContextHandle context )
 
   // Update the entries in the menu
   this->update_redo_tag_signal_( this->get_redo_tag() );
+  this->private_->update_total_byte_size();
   this->buffer_changed_signal_();
   
   // Applying the redo action should put a new undo check point onto the undo stack.
@@ -213,6 +246,20 @@ void UndoBuffer::reset_undo_buffer()
 
   this->update_redo_tag_signal_( this->get_redo_tag() );
   this->update_undo_tag_signal_( this->get_undo_tag() );
+  this->private_->update_total_byte_size();
+  this->buffer_changed_signal_();
+}
+
+void UndoBuffer::remove_items( const item_function_type& remove )
+{
+  this->private_->undo_list_.erase( std::remove_if( this->private_->undo_list_.begin(),
+    this->private_->undo_list_.end(), remove ), this->private_->undo_list_.end() );
+  this->private_->redo_list_.erase( std::remove_if( this->private_->redo_list_.begin(),
+    this->private_->redo_list_.end(), remove ), this->private_->redo_list_.end() );
+
+  this->update_redo_tag_signal_( this->get_redo_tag() );
+  this->update_undo_tag_signal_( this->get_undo_tag() );
+  this->private_->update_total_byte_size();
   this->buffer_changed_signal_();
 }
 
@@ -292,5 +339,11 @@ size_t UndoBuffer::num_redo_items()
   return this->private_->redo_list_.size();
 }
 
+size_t UndoBuffer::get_total_byte_size() const
+{
+  boost::mutex::scoped_lock lock( this->private_->total_byte_size_mutex_ );
+  return this->private_->total_byte_size_;
+}
+
 } // end namespace Seg3D
 
@@ -30,6 +30,7 @@
 #define APPLICATION_UNDOBUFFER_UNDOBUFFER_H
 
 // boost includes
+#include <boost/function.hpp>
 #include <boost/signals2/signal.hpp>
 
 // Core includes
@@ -79,6 +80,12 @@ public:
   /// RESET_UNDO_BUFFER:
   /// Reset the buffer to its initial setting
   void reset_undo_buffer();
+
+  /// REMOVE_ITEMS:
+  /// Remove the items from the undo and redo stacks for which the function returns true, so 
+  /// that the data they hold can be released. The other items stay in order.
+  typedef boost::function< bool ( UndoBufferItemHandle ) > item_function_type;
+  void remove_items( const item_function_type& remove );
   
   /// GET_UNDO_TAG:
   /// Get the tag from the action stored on top of the undo stack.
@@ -116,6 +123,11 @@ public:
   /// Get the number of redo items on the stack
   size_t num_redo_items();
 
+  /// GET_TOTAL_BYTE_SIZE:
+  /// Get the number of bytes held by all the items on the undo and redo stacks.
+  /// NOTE: This function is thread-safe, the size is updated whenever the buffer changes.
+  size_t get_total_byte_size() const;
+
 
   // -- signals --
 public:
@@ -58,6 +58,12 @@ void UndoBufferItem::set_redo_action( Core::ActionHandle action )
 
 bool UndoBufferItem::apply_redo( Core::ActionContextHandle& context )
 {
+  // Changes that were not made by an action cannot be redone
+  if ( !this->private_->redo_action_ )
+  {
+    context->report_error( "'" + this->private_->tag_ + "' cannot be redone." );
+    return false;
+  }
 
   // Validate the action. It should validate, but if it doesn't it should fail
   // gracefully. Hence we check anyway.
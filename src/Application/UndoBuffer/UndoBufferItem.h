@@ -55,7 +55,8 @@ public:
 public:
   /// SET_REDO_ACTION:
   /// Set a redo action for undoing the undo
-  /// NOTE: This is generally the action that inserts the undo step onto the queue
+  /// NOTE: This is generally the action that inserts the undo step onto the queue. Items without
+  /// a redo action cannot be redone.
   void set_redo_action( Core::ActionHandle action );
 
   // -- apply undo/redo action --
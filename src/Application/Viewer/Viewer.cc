@@ -1123,6 +1123,17 @@ Viewer::Viewer( size_t viewer_id, bool visible, const std::string& mode ) :
   this->add_connection( this->lock_state_->value_changed_signal_.connect(
     boost::bind( &ViewerPrivate::viewer_lock_state_changed, this->private_, _1 ) ) );
 
+  // Connect state variables that are copied into the layer scene snapshot, which the
+  // renderers read instead of the states.
+  Core::StateBaseHandle scene_states[] = { this->view_mode_state_, this->viewer_visible_state_,
+    this->slice_visible_state_, this->axial_view_state_, this->coronal_view_state_,
+    this->sagittal_view_state_, PreferencesManager::Instance()->background_color_state_ };
+  for ( size_t i = 0; i < sizeof( scene_states ) / sizeof( Core::StateBaseHandle ); ++i )
+  {
+    this->add_connection( scene_states[ i ]->state_changed_signal_.connect( boost::bind(
+      &LayerManager::invalidate_layer_scene, LayerManager::Instance() ) ) );
+  }
+
   // Connect state variables that should trigger redraw_all.
   this->add_connection( this->view_mode_state_->state_changed_signal_.connect(
     boost::bind( &Viewer::redraw_all, this ) ) );
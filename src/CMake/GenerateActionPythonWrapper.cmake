@@ -29,6 +29,7 @@
 
 SET(ACTION_PYTHON_WRAPPER_REGISTRATION_LIST "" CACHE INTERNAL "list of actions that have python wrappers" FORCE)
 SET(ACTION_PYTHON_WRAPPER_TEMPLATE "" CACHE INTERNAL "String template for generating action wrapper functions" FORCE)
+SET(PYTHON_WRAPPER_FUNCTION_REGISTRATION_LIST "" CACHE INTERNAL "list of functions that register hand written python wrappers" FORCE)
 
 FILE(STRINGS ${CMAKE_SOURCE_DIR}/Configuration/ActionPythonWrapperFunctionSource.in ACTION_PYTHON_TEMPLATE_STRINGS)
 FOREACH(LINE ${ACTION_PYTHON_TEMPLATE_STRINGS})
@@ -67,6 +68,12 @@ MACRO(GENERATE_ACTION_PYTHON_WRAPPER wrapper_file proj)
                  @ONLY)
 ENDMACRO(GENERATE_ACTION_PYTHON_WRAPPER)
 
+# Register a function in the Core namespace that defines python functions that are not 
+# generated from actions. The function is called when the python module is initialized.
+MACRO(REGISTER_PYTHON_WRAPPER_FUNCTION function)
+  SET(PYTHON_WRAPPER_FUNCTION_REGISTRATION_LIST ${PYTHON_WRAPPER_FUNCTION_REGISTRATION_LIST} ${function} CACHE INTERNAL "")
+ENDMACRO(REGISTER_PYTHON_WRAPPER_FUNCTION)
+
 MACRO(GENERATE_ACTION_PYTHON_WRAPPER_REGISTRATION_FILE)
   SET(DECLARATIONS "")
   SET(IMPLEMENTATIONS "")
@@ -78,6 +85,14 @@ MACRO(GENERATE_ACTION_PYTHON_WRAPPER_REGISTRATION_FILE)
   STRING(CONFIGURE "\tregister_action_@ACTION@_python_wrapper();\n" IMPLEMENTATION)
   SET(IMPLEMENTATIONS "${IMPLEMENTATIONS}${IMPLEMENTATION}")
   ENDFOREACH(ACTION ${ACTION_PYTHON_WRAPPER_REGISTRATION_LIST})
+
+  FOREACH(FUNCTION ${PYTHON_WRAPPER_FUNCTION_REGISTRATION_LIST})
+    STRING(CONFIGURE "extern void @FUNCTION@();\n" DECLARATION)
+    SET(DECLARATIONS "${DECLARATIONS}${DECLARATION}")
+
+    STRING(CONFIGURE "\t@FUNCTION@();\n" IMPLEMENTATION)
+    SET(IMPLEMENTATIONS "${IMPLEMENTATIONS}${IMPLEMENTATION}")
+  ENDFOREACH(FUNCTION ${PYTHON_WRAPPER_FUNCTION_REGISTRATION_LIST})
   
   CONFIGURE_FILE(${CMAKE_SOURCE_DIR}/Configuration/ActionPythonWrapperRegistration.h.in
                  ${CMAKE_CURRENT_BINARY_DIR}/ActionPythonWrapperRegistration.h
@@ -297,6 +297,9 @@ CORE_ACTION_INTERNAL(definition_string, Core::ActionInfo )
 #define CORE_ACTION_ARGUMENT_IS_NONPERSISTENT( name ) \
 CORE_ACTION_ARGUMENT_PROPERTY( name, "nonpersistent" )
 
+#define CORE_ACTION_ARGUMENT_IS_INPLACE( name ) \
+CORE_ACTION_ARGUMENT_PROPERTY( name, "inplace" )
+
 #define CORE_ACTION_CHANGES_PROJECT_DATA() \
 CORE_ACTION_PROPERTY( "changes_project_data" )
 
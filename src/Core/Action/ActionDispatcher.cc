@@ -30,6 +30,7 @@
 #include <Core/Utils/AtomicCounter.h>
 #include <Core/Utils/Exception.h>
 #include <Core/Utils/Log.h>
+#include <Core/Utils/Tracer.h>
 #include <Core/Application/Application.h>
 #include <Core/Action/ActionDispatcher.h>
 #include <Core/Action/ActionHistory.h>
@@ -174,12 +175,25 @@ bool ActionDispatcher::is_busy()
   return this->private_->action_count_ > 0;
 }
 
+size_t ActionDispatcher::get_action_count() const
+{
+  long count = this->private_->action_count_;
+  return count > 0 ? static_cast< size_t >( count ) : 0;
+}
+
 void ActionDispatcher::run_action( ActionHandle action, ActionContextHandle action_context )
 {
+  CORE_TRACE_SCOPE( "action", action->get_type() );
+
   // Step (1): Some actions require a translation before they can be validated
   // The first step is calling the translation function.
   // NOTE: if translation fails the action is not executed.
-  if ( !( action->translate( action_context ) ) )
+  TraceScope translate_trace( "action", Tracer::IsTracing() ? 
+    action->get_type() + " translate" : std::string() );
+  bool translated = action->translate( action_context );
+  translate_trace.end();
+
+  if ( !translated )
   {
     // The action context should return unavailable or invalid
     if ( action_context->status() != ActionStatus::UNAVAILABLE_E )
@@ -197,7 +211,12 @@ void ActionDispatcher::run_action( ActionHandle action, ActionContextHandle acti
   // The validation is a separate step as invalid actions should not be
   // posted to the observers that record what the program does.
 
-  if ( !( action->validate( action_context ) ) )
+  TraceScope validate_trace( "action", Tracer::IsTracing() ? 
+    action->get_type() + " validate" : std::string() );
+  bool validated = action->validate( action_context );
+  validate_trace.end();
+
+  if ( !validated )
   {
     // The action context should return unavailable or invalid
     if ( action_context->status() != ActionStatus::UNAVAILABLE_E )
@@ -222,7 +241,12 @@ void ActionDispatcher::run_action( ActionHandle action, ActionContextHandle acti
   // program whether the action succeeded.
 
   ActionResultHandle result;
-  if ( !( action->run( action_context, result ) ) )
+  TraceScope run_trace( "action", Tracer::IsTracing() ? 
+    action->get_type() + " run" : std::string() );
+  bool success = action->run( action_context, result );
+  run_trace.end();
+
+  if ( !success )
   {
     action_context->report_status( ActionStatus::ERROR_E );
     action_context->report_done();
@@ -100,6 +100,10 @@ public:
   /// Returns true if there are actions being processed, otherwise false.
   bool is_busy();
 
+  // GET_ACTION_COUNT:
+  /// Returns the number of actions that have been posted and have not finished yet.
+  size_t get_action_count() const;
+
   // LAST_ACTION_COMPLETED:
   /// Returns the timestamp of the last action that was completed
   boost::posix_time::ptime last_action_completed() const;
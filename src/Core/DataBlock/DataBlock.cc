@@ -26,6 +26,18 @@
  DEALINGS IN THE SOFTWARE.
 */
 
+// STL includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+
+// Core includes
+#include <Core/Utils/Parallel.h>
 #include <Core/DataBlock/DataBlock.h>
 #include <Core/DataBlock/DataBlockManager.h>
 #include <Core/DataBlock/StdDataBlock.h>
@@ -33,12 +45,16 @@
 namespace Core
 {
 
+// Number of voxels above which a permutation is split over multiple threads
+const static size_t PERMUTE_PARALLEL_SIZE_C = 1 << 20;
+
 DataBlock::DataBlock() :
   nx_( 0 ), 
   ny_( 0 ), 
   nz_( 0 ), 
   data_type_( DataType::UNKNOWN_E ), 
   data_( 0 ),
+  deferred_data_( false ),
   generation_( -1 )
 {
 }
@@ -52,6 +68,16 @@ DataBlock::~DataBlock()
   }
 }
 
+void DataBlock::set_deferred_data()
+{
+  this->deferred_data_ = true;
+}
+
+void* DataBlock::get_deferred_data()
+{
+  return this->data_;
+}
+
 double DataBlock::get_data_at( index_type index ) const
 {
   // range check
@@ -62,46 +88,49 @@ double DataBlock::get_data_at( index_type index ) const
     return 0.0;
   }
 
+  // NOTE: Data blocks that defer creating their data create it here
+  void* data_ptr = const_cast< DataBlock* >( this )->get_data();
+
   switch( this->data_type_ )
   {
   case DataType::CHAR_E:
     {
-      signed char* data = reinterpret_cast<signed char*>( this->data_ );
+      signed char* data = reinterpret_cast<signed char*>( data_ptr );
       return static_cast<double>( data[ index ] );
     }     
   case DataType::UCHAR_E:
     {
-      unsigned char* data = reinterpret_cast<unsigned char*>( this->data_ );
+      unsigned char* data = reinterpret_cast<unsigned char*>( data_ptr );
       return static_cast<double>( data[ index ] );
     }     
   case DataType::SHORT_E:
     {
-      short* data = reinterpret_cast<short*>( this->data_ );
+      short* data = reinterpret_cast<short*>( data_ptr );
       return static_cast<double>( data[ index ] );
     }     
   case DataType::USHORT_E:
     {
-      unsigned short* data = reinterpret_cast<unsigned short*>( this->data_ );
+      unsigned short* data = reinterpret_cast<unsigned short*>( data_ptr );
       return static_cast<double>( data[ index ] );
     }
   case DataType::INT_E:
     {
-      int* data = reinterpret_cast<int*>( this->data_ );
+      int* data = reinterpret_cast<int*>( data_ptr );
       return static_cast<double>( data[ index ] );
     }     
   case DataType::UINT_E:
     {
-      unsigned int* data = reinterpret_cast<unsigned int*>( this->data_ );
+      unsigned int* data = reinterpret_cast<unsigned int*>( data_ptr );
       return static_cast<double>( data[ index ] );
     }       
   case DataType::FLOAT_E:
     {
-      float* data = reinterpret_cast<float*>( this->data_ );
+      float* data = reinterpret_cast<float*>( data_ptr );
       return static_cast<double>( data[ index ] );
     }     
   case DataType::DOUBLE_E:
     {
-      double* data = reinterpret_cast<double*>( this->data_ );
+      double* data = reinterpret_cast<double*>( data_ptr );
       return data[ index ];
     }     
   }
@@ -112,53 +141,54 @@ double DataBlock::get_data_at( index_type index ) const
 void DataBlock::set_data_at( index_type index, double value )
 {
   // range check?
+  void* data_ptr = this->get_data();
   switch( this->data_type_ )
   {
     case DataType::CHAR_E:
     {
-      signed char* data = reinterpret_cast<signed char*>( this->data_ );
+      signed char* data = reinterpret_cast<signed char*>( data_ptr );
       data[ index ] = static_cast<signed char>( value );
       return;
     }     
     case DataType::UCHAR_E:
     {
-      unsigned char* data = reinterpret_cast<unsigned char*>( this->data_ );
+      unsigned char* data = reinterpret_cast<unsigned char*>( data_ptr );
       data[ index ] = static_cast<unsigned char>( value );
       return;
     }     
     case DataType::SHORT_E:
     {
-      short* data = reinterpret_cast<short*>( this->data_ );
+      short* data = reinterpret_cast<short*>( data_ptr );
       data[ index ] = static_cast<short>( value );
       return;
     }     
     case DataType::USHORT_E:
     {
-      unsigned short* data = reinterpret_cast<unsigned short*>( this->data_ );
+      unsigned short* data = reinterpret_cast<unsigned short*>( data_ptr );
       data[ index ] = static_cast<unsigned short>( value );
       return;
     } 
     case DataType::INT_E:
     {
-      int* data = reinterpret_cast<int*>( this->data_ );
+      int* data = reinterpret_cast<int*>( data_ptr );
       data[ index ] = static_cast<int>( value );
       return;
     }     
     case DataType::UINT_E:
     {
-      unsigned int* data = reinterpret_cast<unsigned int*>( this->data_ );
+      unsigned int* data = reinterpret_cast<unsigned int*>( data_ptr );
       data[ index ] = static_cast<unsigned int>( value );
       return;
     } 
     case DataType::FLOAT_E:
     {
-      float* data = reinterpret_cast<float*>( this->data_ );
+      float* data = reinterpret_cast<float*>( data_ptr );
       data[ index ] = static_cast<float>( value );
       return;
     }     
     case DataType::DOUBLE_E:
     {
-      double* data = reinterpret_cast<double*>( this->data_ );
+      double* data = reinterpret_cast<double*>( data_ptr );
       data[ index ] = value;
       return;
     }
@@ -224,7 +254,7 @@ const Histogram& DataBlock::get_histogram() const
 void DataBlock::clear()
 {
   lock_type lock( this->get_mutex() );
-  memset( this->data_, 0, Core::GetSizeDataType( this->data_type_ ) * this->get_size() );
+  memset( this->get_data(), 0, Core::GetSizeDataType( this->data_type_ ) * this->get_size() );
   this->generation_ = DataBlockManager::Instance()->increase_generation( this->generation_ );
 }
 
@@ -712,86 +742,329 @@ bool DataBlock::ConvertDataType( const DataBlockHandle& src_data_block,
   }
 }
 
-template<class DATA>
-static bool PermuteDataInternal( const DataBlockHandle& src_data_block, 
-  DataBlockHandle& dst_data_block, std::vector<int>& permutation )
+// CONVERT_IN_PLACE_CHUNK_SIZE_C:
+// Number of elements that are converted at once by convert_data_type_in_place.
+const static size_t CONVERT_IN_PLACE_CHUNK_SIZE_C = 1 << 16;
+
+template< class SRC, class DST >
+static void ConvertDataTypeInPlaceInternal( void* data, size_t size )
 {
-  DATA* src = reinterpret_cast<DATA*>( src_data_block->get_data() );
-  DATA* dst = reinterpret_cast<DATA*>( dst_data_block->get_data() );
+  // NOTE: As the destination type is never wider than the source type, the destination of a
+  // chunk only overlaps source elements of the same or of earlier chunks. Those have already
+  // been read into the chunk buffer, hence the data can be streamed front to back.
+  const SRC* src = reinterpret_cast<const SRC*>( data );
+  unsigned char* dst = reinterpret_cast<unsigned char*>( data );
+
+  std::vector<DST> buffer( std::min( size, CONVERT_IN_PLACE_CHUNK_SIZE_C ) );
+  for ( size_t start = 0; start < size; start += CONVERT_IN_PLACE_CHUNK_SIZE_C )
+  {
+    size_t end = std::min( start + CONVERT_IN_PLACE_CHUNK_SIZE_C, size );
+    for ( size_t j = start; j < end; j++ )
+    {
+      buffer[ j - start ] = static_cast<DST>( src[ j ] );
+    }
+    std::memcpy( dst + start * sizeof( DST ), &buffer[ 0 ], ( end - start ) * sizeof( DST ) );
+  }
+}
+
+template< class SRC >
+static bool ConvertDataTypeInPlace( void* data, size_t size, DataType new_data_type )
+{
+  switch ( new_data_type )
+  {
+    case DataType::CHAR_E:
+      ConvertDataTypeInPlaceInternal<SRC, signed char>( data, size );
+      return true;
+    case DataType::UCHAR_E:
+      ConvertDataTypeInPlaceInternal<SRC, unsigned char>( data, size );
+      return true;
+    case DataType::SHORT_E:
+      ConvertDataTypeInPlaceInternal<SRC, short>( data, size );
+      return true;
+    case DataType::USHORT_E:
+      ConvertDataTypeInPlaceInternal<SRC, unsigned short>( data, size );
+      return true;
+    case DataType::INT_E:
+      ConvertDataTypeInPlaceInternal<SRC, int>( data, size );
+      return true;
+    case DataType::UINT_E:
+      ConvertDataTypeInPlaceInternal<SRC, unsigned int>( data, size );
+      return true;
+    case DataType::FLOAT_E:
+      ConvertDataTypeInPlaceInternal<SRC, float>( data, size );
+      return true;
+    case DataType::DOUBLE_E:
+      ConvertDataTypeInPlaceInternal<SRC, double>( data, size );
+      return true;
+    default:
+      return false;
+  }
+}
 
+bool DataBlock::convert_data_type_in_place( DataType new_data_type )
+{
+  if ( new_data_type == this->get_data_type() ) return true;
+  if ( GetSizeDataType( new_data_type ) > GetSizeDataType( this->get_data_type() ) ) return false;
+
+  lock_type lock( this->get_mutex() );
+
+  void* data = this->get_data();
+  size_t size = this->get_size();
+  bool success = false;
+
+  switch( this->get_data_type() )
+  {
+    case DataType::CHAR_E:
+      success = ConvertDataTypeInPlace<signed char>( data, size, new_data_type );
+      break;
+    case DataType::UCHAR_E:
+      success = ConvertDataTypeInPlace<unsigned char>( data, size, new_data_type );
+      break;
+    case DataType::SHORT_E:
+      success = ConvertDataTypeInPlace<short>( data, size, new_data_type );
+      break;
+    case DataType::USHORT_E:
+      success = ConvertDataTypeInPlace<unsigned short>( data, size, new_data_type );
+      break;
+    case DataType::INT_E:
+      success = ConvertDataTypeInPlace<int>( data, size, new_data_type );
+      break;
+    case DataType::UINT_E:
+      success = ConvertDataTypeInPlace<unsigned int>( data, size, new_data_type );
+      break;
+    case DataType::FLOAT_E:
+      success = ConvertDataTypeInPlace<float>( data, size, new_data_type );
+      break;
+    case DataType::DOUBLE_E:
+      success = ConvertDataTypeInPlace<double>( data, size, new_data_type );
+      break;
+    default:
+      break;
+  }
+
+  if ( success ) this->set_type( new_data_type );
+  return success;
+}
+
+// CLASS PermuteDataInfo:
+// Mapping from the destination axes to the source data that is shared by all the threads
+// that permute a data block.
+
+class PermuteDataInfo
+{
+public:
   typedef DataBlock::index_type index_type;
 
-  std::vector<index_type> start(3);
-  std::vector<index_type> stride(3);
-  
-  index_type nx = static_cast<index_type>( src_data_block->get_nx() );
-  index_type ny = static_cast<index_type>( src_data_block->get_ny() );
-  index_type nz = static_cast<index_type>( src_data_block->get_nz() );
-  index_type nxy = nx*ny;
-  index_type nxyz = nx*ny*nz;
+  // Size of the destination along each axis
+  index_type dn_[ 3 ];
+
+  // Offset in the source of the first destination voxel
+  index_type start_;
+
+  // Step in the source when stepping along each destination axis
+  index_type stride_[ 3 ];
+
+  // Destination axis that runs along the contiguous source axis, and the remaining axis
+  int contiguous_axis_;
+  int outer_axis_;
+
+  // Number of destination voxels along each side of a tile
+  index_type tile_size_;
+};
+
+template<class DATA>
+static void PermuteRowsParallel( const DATA* src, DATA* dst, const PermuteDataInfo& info, 
+  int thread, int num_threads, boost::barrier& barrier )
+{
+  // NOTE: The destination x axis runs along the source x axis, hence every destination row
+  // is a forward or backward copy of a source row.
+  typedef PermuteDataInfo::index_type index_type;
   
-  for ( index_type j = 0; j < 3; j++)
+  index_type dnx = info.dn_[ 0 ];
+  index_type num_rows = info.dn_[ 1 ] * info.dn_[ 2 ];
+  index_type row_start = ( num_rows * thread ) / num_threads;
+  index_type row_end = ( num_rows * ( thread + 1 ) ) / num_threads;
+
+  for ( index_type row = row_start; row < row_end; row++ )
   {
-    if ( permutation[ j ] == 1 )
-    {
-      start[ j ] = 0;
-      stride[ j ] = 1; 
-    }
-    else if ( permutation[ j ] == -1 )
+    index_type dy = row % info.dn_[ 1 ];
+    index_type dz = row / info.dn_[ 1 ];
+    const DATA* src_row = src + info.start_ + dy * info.stride_[ 1 ] + dz * info.stride_[ 2 ];
+    DATA* dst_row = dst + row * dnx;
+
+    if ( info.stride_[ 0 ] == 1 )
     {
-      start[ j ] = nx - 1;
-      stride[ j ] = -1;   
+      std::memcpy( dst_row, src_row, dnx * sizeof( DATA ) );
     }
-    else if ( permutation[ j ] == 2 )
+    else
     {
-      start[ j ] = 0;
-      stride[ j ] = nx; 
+      for ( index_type dx = 0; dx < dnx; dx++ )
+      {
+        dst_row[ dx ] = src_row[ -dx ];
+      }
     }
-    else if ( permutation[ j ] == -2 )
+  }
+}
+
+template<class DATA>
+static void PermuteTilesParallel( const DATA* src, DATA* dst, const PermuteDataInfo& info, 
+  int thread, int num_threads, boost::barrier& barrier )
+{
+  // NOTE: The destination x axis runs across source rows. The data is copied in square tiles
+  // that span the destination x axis and the destination axis that runs along the source
+  // rows, so the source rows and destination rows of a tile both stay in cache.
+  typedef PermuteDataInfo::index_type index_type;
+
+  const int k = info.contiguous_axis_;
+  const int m = info.outer_axis_;
+  const index_type tile_size = info.tile_size_;
+  
+  index_type dst_stride[ 3 ];
+  dst_stride[ 0 ] = 1;
+  dst_stride[ 1 ] = info.dn_[ 0 ];
+  dst_stride[ 2 ] = info.dn_[ 0 ] * info.dn_[ 1 ];
+  
+  index_type num_k_tiles = ( info.dn_[ k ] + tile_size - 1 ) / tile_size;
+  index_type num_items = info.dn_[ m ] * num_k_tiles;
+  index_type item_start = ( num_items * thread ) / num_threads;
+  index_type item_end = ( num_items * ( thread + 1 ) ) / num_threads;
+
+  for ( index_type item = item_start; item < item_end; item++ )
+  {
+    index_type dm = item / num_k_tiles;
+    index_type k_begin = ( item % num_k_tiles ) * tile_size;
+    index_type k_end = std::min( k_begin + tile_size, info.dn_[ k ] );
+
+    const DATA* src_m = src + info.start_ + dm * info.stride_[ m ];
+    DATA* dst_m = dst + dm * dst_stride[ m ];
+
+    for ( index_type x_begin = 0; x_begin < info.dn_[ 0 ]; x_begin += tile_size )
     {
-      start[ j ] = nxy - nx;
-      stride[ j ] = -nx;  
+      index_type x_end = std::min( x_begin + tile_size, info.dn_[ 0 ] );
+      for ( index_type dk = k_begin; dk < k_end; dk++ )
+      {
+        const DATA* src_k = src_m + dk * info.stride_[ k ];
+        DATA* dst_k = dst_m + dk * dst_stride[ k ];
+        for ( index_type dx = x_begin; dx < x_end; dx++ )
+        {
+          dst_k[ dx ] = src_k[ dx * info.stride_[ 0 ] ];
+        }
+      }
     }
-    else if ( permutation[ j ] == 3 )
+  }
+}
+
+template<class DATA>
+static bool PermuteDataInternal( const DataBlockHandle& src_data_block, 
+  const DataBlockHandle& dst_data_block, const std::vector<int>& permutation,
+  const std::vector<size_t>& offset )
+{
+  const DATA* src = reinterpret_cast<DATA*>( src_data_block->get_data() );
+  DATA* dst = reinterpret_cast<DATA*>( dst_data_block->get_data() );
+  if ( src == 0 || dst == 0 ) return false;
+
+  typedef DataBlock::index_type index_type;
+
+  index_type sn[ 3 ];
+  sn[ 0 ] = static_cast<index_type>( src_data_block->get_nx() );
+  sn[ 1 ] = static_cast<index_type>( src_data_block->get_ny() );
+  sn[ 2 ] = static_cast<index_type>( src_data_block->get_nz() );
+
+  index_type sstride[ 3 ];
+  sstride[ 0 ] = 1;
+  sstride[ 1 ] = sn[ 0 ];
+  sstride[ 2 ] = sn[ 0 ] * sn[ 1 ];
+  
+  PermuteDataInfo info;
+  info.dn_[ 0 ] = static_cast<index_type>( dst_data_block->get_nx() );
+  info.dn_[ 1 ] = static_cast<index_type>( dst_data_block->get_ny() );
+  info.dn_[ 2 ] = static_cast<index_type>( dst_data_block->get_nz() );
+  info.start_ = 0;
+  info.contiguous_axis_ = 0;
+
+  bool used_axis[ 3 ] = { false, false, false };
+  for ( int j = 0; j < 3; j++)
+  {
+    int axis = std::abs( permutation[ j ] ) - 1;
+    if ( axis < 0 || axis > 2 || used_axis[ axis ] ) return false;
+    used_axis[ axis ] = true;
+
+    // The region needs to be inside the source
+    index_type first = static_cast<index_type>( offset[ axis ] );
+    if ( first + info.dn_[ j ] > sn[ axis ] ) return false;
+
+    if ( permutation[ j ] > 0 )
     {
-      start[ j ] = 0;
-      stride[ j ] = nxy; 
+      info.start_ += first * sstride[ axis ];
+      info.stride_[ j ] = sstride[ axis ];
     }
-    else if ( permutation[ j ] == -3 )
+    else
     {
-      start[ j ] = nxyz - nxy;
-      stride[ j ] = -nxy;   
+      info.start_ += ( first + info.dn_[ j ] - 1 ) * sstride[ axis ];
+      info.stride_[ j ] = -sstride[ axis ];
     }
+    
+    if ( axis == 0 ) info.contiguous_axis_ = j;
   }
-  
-  index_type dnx = static_cast<index_type>( dst_data_block->get_nx() );
-  index_type dny = static_cast<index_type>( dst_data_block->get_ny() );
-  index_type dnz = static_cast<index_type>( dst_data_block->get_nz() );
-  index_type dnxy = dnx * dny;
-  index_type dnxyz = dnx * dny * dnz;
-  index_type sz = start[ 2 ];
-  index_type sz_stride = stride[ 2 ];
-  for ( index_type dz = 0; dz < dnxyz; dz += dnxy )
+
+  info.outer_axis_ = ( info.contiguous_axis_ == 1 ) ? 2 : 1;
+  // Keep the source and destination rows of a tile within the L1 cache
+  info.tile_size_ = sizeof( DATA ) <= 2 ? 64 : 32;
+
+  // Small volumes are not worth starting threads for
+  int num_threads = dst_data_block->get_size() < PERMUTE_PARALLEL_SIZE_C ? 1 : -1;
+
+  if ( info.contiguous_axis_ == 0 )
   {
-    index_type sy = start[ 1 ];
-    index_type sy_stride = stride[ 1 ];
-    for ( index_type dy = 0; dy < dnxy; dy += dnx )
-    {
-      index_type sx = start[ 0 ];
-      index_type sx_stride = stride[ 0 ];
-      for ( index_type dx = 0; dx < dnx; dx++ )
-      {
-        dst[ dx + dy + dz ] = src[ sx + sy + sz ];
-        sx += sx_stride;
-      }
-      sy += sy_stride;
-    }
-    sz += sz_stride;
+    Parallel parallel( boost::bind( &PermuteRowsParallel<DATA>, src, dst, 
+      boost::cref( info ), _1, _2, _3 ), num_threads );
+    parallel.run();
+  }
+  else
+  {
+    Parallel parallel( boost::bind( &PermuteTilesParallel<DATA>, src, dst, 
+      boost::cref( info ), _1, _2, _3 ), num_threads );
+    parallel.run();
   }
   
   return true;
 }
 
+static bool PermuteRegionInternal( const DataBlockHandle& src_data_block, 
+  const DataBlockHandle& dst_data_block, const std::vector<int>& permutation,
+  const std::vector<size_t>& offset )
+{
+  switch( src_data_block->get_data_type() )
+  {
+    case DataType::CHAR_E:
+      return PermuteDataInternal<signed char>( src_data_block, dst_data_block, 
+        permutation, offset );
+    case DataType::UCHAR_E:
+      return PermuteDataInternal<unsigned char>( src_data_block, dst_data_block, 
+        permutation, offset );
+    case DataType::SHORT_E:
+      return PermuteDataInternal<short>( src_data_block, dst_data_block, 
+        permutation, offset );
+    case DataType::USHORT_E:
+      return PermuteDataInternal<unsigned short>( src_data_block, dst_data_block, 
+        permutation, offset );
+    case DataType::INT_E:
+      return PermuteDataInternal<int>( src_data_block, dst_data_block, 
+        permutation, offset );
+    case DataType::UINT_E:
+      return PermuteDataInternal<unsigned int>( src_data_block, dst_data_block, 
+        permutation, offset );
+    case DataType::FLOAT_E:
+      return PermuteDataInternal<float>( src_data_block, dst_data_block, 
+        permutation, offset );
+    case DataType::DOUBLE_E:
+      return PermuteDataInternal<double>( src_data_block, dst_data_block, 
+        permutation, offset );
+    default:
+      return false;
+  }
+}
+
 bool DataBlock::PermuteData( const DataBlockHandle& src_data_block, 
   DataBlockHandle& dst_data_block, std::vector<int> permutation )
 {
@@ -822,38 +1095,30 @@ bool DataBlock::PermuteData( const DataBlockHandle& src_data_block,
   
   dst_data_block = StdDataBlock::New( dn[ 0 ], dn[ 1 ], dn[ 2 ], 
     src_data_block->get_data_type() );  
+  if ( !dst_data_block ) return false;
 
-  switch( src_data_block->get_data_type() )
+  if ( !PermuteRegionInternal( src_data_block, dst_data_block, permutation, 
+    std::vector<size_t>( 3, 0 ) ) )
   {
-    case DataType::CHAR_E:
-      return PermuteDataInternal<signed char>( src_data_block, dst_data_block, 
-        permutation );
-    case DataType::UCHAR_E:
-      return PermuteDataInternal<unsigned char>( src_data_block, dst_data_block, 
-        permutation );
-    case DataType::SHORT_E:
-      return PermuteDataInternal<short>( src_data_block, dst_data_block, 
-        permutation );
-    case DataType::USHORT_E:
-      return PermuteDataInternal<unsigned short>( src_data_block, dst_data_block, 
-        permutation );
-    case DataType::INT_E:
-      return PermuteDataInternal<int>( src_data_block, dst_data_block, 
-        permutation );
-    case DataType::UINT_E:
-      return PermuteDataInternal<unsigned int>( src_data_block, dst_data_block, 
-        permutation );
-    case DataType::FLOAT_E:
-      return PermuteDataInternal<float>( src_data_block, dst_data_block, 
-        permutation );
-    case DataType::DOUBLE_E:
-      return PermuteDataInternal<double>( src_data_block, dst_data_block, 
-        permutation );
-    default:
-      return false;
+    dst_data_block.reset();
+    return false;
   }
+  
+  return true;
 }
 
+bool DataBlock::PermuteRegion( const DataBlockHandle& src_data_block, 
+  const DataBlockHandle& dst_data_block, const std::vector<int>& permutation,
+  const std::vector<size_t>& offset )
+{
+  if ( !src_data_block || !dst_data_block ) return false;
+  if ( permutation.size() != 3 || offset.size() != 3 ) return false;
+  if ( src_data_block->get_data_type() != dst_data_block->get_data_type() ) return false;
+  if ( dst_data_block->get_size() == 0 ) return false;
+
+  shared_lock_type lock( src_data_block->get_mutex( ) );
+  return PermuteRegionInternal( src_data_block, dst_data_block, permutation, offset );
+}
 
 template<class DATA>
 static bool QuantizeDataInternal( double min, double max, DATA* src, DataBlockHandle& dst_data_block )
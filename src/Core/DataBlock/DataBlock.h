@@ -149,6 +149,8 @@ public:
   /// Pointer to the block of data
   void* get_data()
   {
+    // NOTE: The flag is only set on construction, hence it can be read without locking.
+    if ( this->deferred_data_ ) return this->get_deferred_data();
     return this->data_;
   }
 
@@ -230,6 +232,18 @@ private:
   
 protected:
 
+  // SET_DEFERRED_DATA:
+  /// Mark the data block as creating its data on first access. This needs to be called from
+  /// the constructor of the derived class, after which get_data always calls 
+  /// get_deferred_data.
+  void set_deferred_data();
+
+  // GET_DEFERRED_DATA:
+  /// Called by get_data for data blocks that defer creating their data. The overload is
+  /// responsible for its own locking and returns the data pointer, or 0 if the data could not
+  /// be created.
+  virtual void* get_deferred_data();
+
   // SET_NX, SET_NY, SET_NZ
   /// Set the dimensions of the datablock
   void set_nx( size_t nx );
@@ -240,6 +254,14 @@ protected:
   /// Set the type of the data
   void set_type( DataType type );
 
+  // CONVERT_DATA_TYPE_IN_PLACE:
+  /// Convert the data to a type that does not use more bytes per element than the current
+  /// type, reusing the current buffer. Returns false if the new type is wider.
+  /// NOTE: The buffer keeps its original allocation, hence this is only meant for data blocks
+  /// that do not release the data based on their data type. For a narrower type 
+  /// get_byte_size reports less than the allocation.
+  bool convert_data_type_in_place( DataType new_data_type );
+
 public:
   // SET_DATA
   /// Set the data pointer of the data
@@ -277,6 +299,9 @@ private:
   /// Pointer to the data
   void* data_;
 
+  /// Whether the data is created on first access by get_deferred_data
+  bool deferred_data_;
+
   /// Histogram information for this data block
   Histogram histogram_;
   
@@ -296,6 +321,14 @@ public:
   /// indicates an inverted axis.
   static bool PermuteData( const DataBlockHandle& src_data_block, 
     DataBlockHandle& dst_data_block, std::vector<int> permutation );
+
+  // PERMUTEREGION:
+  /// Copy a region of the source into an allocated destination of the same data type while
+  /// reordering the axis as in PermuteData. The offset is the first voxel of the region in
+  /// source coordinates, the size of the region follows from the destination dimensions.
+  static bool PermuteRegion( const DataBlockHandle& src_data_block, 
+    const DataBlockHandle& dst_data_block, const std::vector<int>& permutation,
+    const std::vector<size_t>& offset );
     
   // QUANTIZEDATA:
   /// Quantize the data based on its min and max value
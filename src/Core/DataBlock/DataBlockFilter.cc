@@ -0,0 +1,1899 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/math/special_functions/next.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlockFilter.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Math/MathFunctions.h>
+#include <Core/Utils/Parallel.h>
+
+namespace Core
+{
+
+/// Volumes smaller than this number of voxels are filtered on the calling thread
+const static size_t NEIGHBORHOOD_PARALLEL_SIZE_C = 1 << 18;
+
+/// Largest number of bits of the data for which the median filter uses column histograms
+const static int MEDIAN_COLUMN_MAX_BITS_C = 12;
+
+/// Memory that the column histograms of the median filter may use for all threads together
+const static size_t MEDIAN_COLUMN_MAX_MEMORY_C = 256 << 20;
+
+/// Smallest sigma for which the Gaussian filter uses the recursive filter
+const static double GAUSSIAN_RECURSIVE_SIGMA_C = 2.0;
+
+/// Size of the explicit Gaussian kernel on each side of the center in sigmas
+const static double GAUSSIAN_KERNEL_WIDTH_C = 3.0;
+
+typedef DataBlock::index_type index_type;
+
+// CLASS NeighborhoodFilterInfo:
+// Parameters that are shared by all the threads that run a neighborhood filter.
+
+class NeighborhoodFilterInfo
+{
+public:
+  // Dimensions of the volume
+  index_type n_[ 3 ];
+
+  // Number of voxels on each side of the center of the box
+  index_type radius_;
+
+  // Mapping of the values onto histogram bins, the histograms of the median filter have
+  // 2^bin_bits_ bins and bin zero corresponds to the value -bin_offset_
+  int bin_offset_;
+  int bin_bits_;
+
+  // Callbacks of the caller
+  DataBlockFilter::abort_function_type abort_function_;
+  DataBlockFilter::progress_function_type progress_function_;
+
+  bool check_abort() const
+  {
+    return !this->abort_function_.empty() && this->abort_function_();
+  }
+
+  void report_progress( double fraction ) const
+  {
+    if ( !this->progress_function_.empty() ) this->progress_function_( fraction );
+  }
+};
+
+static inline index_type Clamp( index_type value, index_type size )
+{
+  return value < 0 ? 0 : ( value >= size ? size - 1 : value );
+}
+
+// Offset that maps the values of a type onto histogram bins starting at zero
+template< class DATA >
+static inline int HistogramOffset()
+{
+  return -static_cast< int >( std::numeric_limits< DATA >::min() );
+}
+
+template< class DATA >
+static void MedianFilterColumnsParallel( const DATA* src, DATA* dst, 
+  const NeighborhoodFilterInfo& info, int thread, int num_threads, boost::barrier& barrier )
+{
+  // NOTE: For every voxel in the current row the histogram of the column of voxels that
+  // spans the box in y and z is kept. Moving to the next row updates each column with 2r+1 
+  // voxels, moving to the next voxel in the row adds and removes a column histogram. As in
+  // the method of Perreault and Hebert the histograms have a coarse level that is always 
+  // updated and a fine level of which only the part that contains the median is brought up 
+  // to date.
+  const index_type nx = info.n_[ 0 ];
+  const index_type ny = info.n_[ 1 ];
+  const index_type nz = info.n_[ 2 ];
+  const index_type nxy = nx * ny;
+  const index_type r = info.radius_;
+  const int offset = info.bin_offset_;
+  const unsigned int half = static_cast< unsigned int >( ( 2 * r + 1 ) * ( 2 * r + 1 ) * 
+    ( 2 * r + 1 ) / 2 );
+
+  // Each coarse bin covers 2^shift fine bins
+  const int shift = info.bin_bits_ / 2;
+  const index_type nf = index_type( 1 ) << info.bin_bits_;
+  const index_type nc = nf >> shift;
+  const int group = 1 << shift;
+
+  std::vector< unsigned int > column_coarse( nx * nc );
+  std::vector< unsigned int > column_fine( nx * nf );
+  std::vector< unsigned int > coarse( nc );
+  std::vector< unsigned int > fine( nf );
+  // Voxel in the row for which each part of the fine level is up to date
+  std::vector< index_type > fine_position( nc );
+
+  index_type z_start = ( nz * thread ) / num_threads;
+  index_type z_end = ( nz * ( thread + 1 ) ) / num_threads;
+
+  for ( index_type z = z_start; z < z_end; z++ )
+  {
+    if ( info.check_abort() ) return;
+
+    // Columns of the first row
+    std::fill( column_coarse.begin(), column_coarse.end(), 0 );
+    std::fill( column_fine.begin(), column_fine.end(), 0 );
+    for ( index_type dz = -r; dz <= r; dz++ )
+    {
+      for ( index_type dy = -r; dy <= r; dy++ )
+      {
+        const DATA* row = src + Clamp( z + dz, nz ) * nxy + Clamp( dy, ny ) * nx;
+        for ( index_type x = 0; x < nx; x++ )
+        {
+          int bin = row[ x ] + offset;
+          column_coarse[ x * nc + ( bin >> shift ) ]++;
+          column_fine[ x * nf + bin ]++;
+        }
+      }
+    }
+
+    for ( index_type y = 0; y < ny; y++ )
+    {
+      if ( y > 0 )
+      {
+        index_type old_y = Clamp( y - 1 - r, ny );
+        index_type new_y = Clamp( y + r, ny );
+        for ( index_type dz = -r; dz <= r; dz++ )
+        {
+          const DATA* slice = src + Clamp( z + dz, nz ) * nxy;
+          const DATA* old_row = slice + old_y * nx;
+          const DATA* new_row = slice + new_y * nx;
+          for ( index_type x = 0; x < nx; x++ )
+          {
+            int old_bin = old_row[ x ] + offset;
+            int new_bin = new_row[ x ] + offset;
+            column_coarse[ x * nc + ( old_bin >> shift ) ]--;
+            column_fine[ x * nf + old_bin ]--;
+            column_coarse[ x * nc + ( new_bin >> shift ) ]++;
+            column_fine[ x * nf + new_bin ]++;
+          }
+        }
+      }
+
+      // Coarse level of the box of the first voxel in the row
+      std::fill( coarse.begin(), coarse.end(), 0 );
+      for ( index_type dx = -r; dx <= r; dx++ )
+      {
+        const unsigned int* column = &column_coarse[ Clamp( dx, nx ) * nc ];
+        for ( index_type bin = 0; bin < nc; bin++ ) coarse[ bin ] += column[ bin ];
+      }
+      std::fill( fine_position.begin(), fine_position.end(), -1 );
+
+      DATA* dst_row = dst + z * nxy + y * nx;
+      for ( index_type x = 0; x < nx; x++ )
+      {
+        if ( x > 0 )
+        {
+          const unsigned int* old_column = &column_coarse[ Clamp( x - 1 - r, nx ) * nc ];
+          const unsigned int* new_column = &column_coarse[ Clamp( x + r, nx ) * nc ];
+          for ( index_type bin = 0; bin < nc; bin++ )
+          {
+            coarse[ bin ] += new_column[ bin ] - old_column[ bin ];
+          }
+        }
+
+        unsigned int count = 0;
+        int coarse_bin = 0;
+        while ( count + coarse[ coarse_bin ] <= half ) count += coarse[ coarse_bin++ ];
+
+        // Bring the fine level of this coarse bin up to date
+        unsigned int* fine_bins = &fine[ coarse_bin * group ];
+        index_type& position = fine_position[ coarse_bin ];
+        if ( position >= 0 && x - position <= 2 * r + 1 )
+        {
+          for ( index_type p = position + 1; p <= x; p++ )
+          {
+            const unsigned int* old_column = &column_fine[ Clamp( p - 1 - r, nx ) * nf + 
+              coarse_bin * group ];
+            const unsigned int* new_column = &column_fine[ Clamp( p + r, nx ) * nf + 
+              coarse_bin * group ];
+            for ( int bin = 0; bin < group; bin++ )
+            {
+              fine_bins[ bin ] += new_column[ bin ] - old_column[ bin ];
+            }
+          }
+        }
+        else
+        {
+          std::fill( fine_bins, fine_bins + group, 0 );
+          for ( index_type dx = -r; dx <= r; dx++ )
+          {
+            const unsigned int* column = &column_fine[ Clamp( x + dx, nx ) * nf + 
+              coarse_bin * group ];
+            for ( int bin = 0; bin < group; bin++ ) fine_bins[ bin ] += column[ bin ];
+          }
+        }
+        position = x;
+
+        int bin = 0;
+        while ( ( count += fine_bins[ bin ] ) <= half ) bin++;
+        dst_row[ x ] = static_cast< DATA >( coarse_bin * group + bin - offset );
+      }
+    }
+
+    if ( thread == 0 )
+    {
+      info.report_progress( static_cast< double >( z - z_start + 1 ) / ( z_end - z_start ) );
+    }
+  }
+}
+
+// CLASS SlidingHistogram:
+// Histogram of the voxels in a box that moves through the volume one voxel at a time. 
+// The histogram is split in a coarse and a fine level, so the median is found by scanning
+// at most two times 256 bins.
+
+template< class DATA >
+class SlidingHistogram
+{
+public:
+  SlidingHistogram( const DATA* src, const NeighborhoodFilterInfo& info, index_type x, 
+    index_type y, index_type z ) :
+    src_( src ),
+    info_( info ),
+    offset_( HistogramOffset< DATA >() ),
+    fine_( 1 << 16, 0 ),
+    coarse_( 1 << 8, 0 )
+  {
+    index_type r = info.radius_;
+    this->center_[ 0 ] = x;
+    this->center_[ 1 ] = y;
+    this->center_[ 2 ] = z;
+    this->stride_[ 0 ] = 1;
+    this->stride_[ 1 ] = info.n_[ 0 ];
+    this->stride_[ 2 ] = info.n_[ 0 ] * info.n_[ 1 ];
+    this->half_ = static_cast< unsigned int >( ( 2 * r + 1 ) * ( 2 * r + 1 ) * 
+      ( 2 * r + 1 ) / 2 );
+
+    for ( index_type dz = -r; dz <= r; dz++ )
+    {
+      this->update_plane( 2, Clamp( z + dz, info.n_[ 2 ] ), 1 );
+    }
+  }
+
+  // Move the center of the box one voxel along an axis
+  void move( int axis, int direction )
+  {
+    index_type r = this->info_.radius_;
+    index_type c = this->center_[ axis ];
+    index_type n = this->info_.n_[ axis ];
+    if ( direction > 0 )
+    {
+      this->update_plane( axis, Clamp( c - r, n ), -1 );
+      this->update_plane( axis, Clamp( c + r + 1, n ), 1 );
+    }
+    else
+    {
+      this->update_plane( axis, Clamp( c + r, n ), -1 );
+      this->update_plane( axis, Clamp( c - r - 1, n ), 1 );
+    }
+    this->center_[ axis ] += direction;
+  }
+
+  DATA get_median() const
+  {
+    unsigned int count = 0;
+    int coarse_bin = 0;
+    while ( count + this->coarse_[ coarse_bin ] <= this->half_ )
+    {
+      count += this->coarse_[ coarse_bin++ ];
+    }
+
+    int bin = coarse_bin << 8;
+    while ( ( count += this->fine_[ bin ] ) <= this->half_ ) bin++;
+    return static_cast< DATA >( bin - this->offset_ );
+  }
+
+private:
+  // Add or remove the voxels in the plane of the box at a position along an axis
+  void update_plane( int axis, index_type position, int delta )
+  {
+    index_type r = this->info_.radius_;
+    int u = ( axis == 0 ) ? 1 : 0;
+    int v = ( axis == 2 ) ? 1 : 2;
+    const DATA* plane = this->src_ + position * this->stride_[ axis ];
+    for ( index_type dv = -r; dv <= r; dv++ )
+    {
+      const DATA* line = plane + Clamp( this->center_[ v ] + dv, this->info_.n_[ v ] ) * 
+        this->stride_[ v ];
+      for ( index_type du = -r; du <= r; du++ )
+      {
+        int bin = line[ Clamp( this->center_[ u ] + du, this->info_.n_[ u ] ) * 
+          this->stride_[ u ] ] + this->offset_;
+        this->fine_[ bin ] += delta;
+        this->coarse_[ bin >> 8 ] += delta;
+      }
+    }
+  }
+
+  const DATA* src_;
+  const NeighborhoodFilterInfo& info_;
+  int offset_;
+  index_type center_[ 3 ];
+  index_type stride_[ 3 ];
+  unsigned int half_;
+  std::vector< unsigned int > fine_;
+  std::vector< unsigned int > coarse_;
+};
+
+template< class DATA >
+static void MedianFilterSlidingParallel( const DATA* src, DATA* dst, 
+  const NeighborhoodFilterInfo& info, int thread, int num_threads, boost::barrier& barrier )
+{
+  // NOTE: The box moves through the slab in a zigzag, so every step only adds and removes 
+  // one plane of the box.
+  const index_type nx = info.n_[ 0 ];
+  const index_type ny = info.n_[ 1 ];
+  const index_type nz = info.n_[ 2 ];
+
+  index_type z_start = ( nz * thread ) / num_threads;
+  index_type z_end = ( nz * ( thread + 1 ) ) / num_threads;
+  if ( z_start == z_end ) return;
+
+  SlidingHistogram< DATA > histogram( src, info, 0, 0, z_start );
+  index_type x = 0;
+  index_type y = 0;
+  int x_direction = 1;
+  int y_direction = 1;
+
+  for ( index_type z = z_start; z < z_end; z++ )
+  {
+    if ( info.check_abort() ) return;
+    if ( z > z_start ) histogram.move( 2, 1 );
+
+    for ( index_type j = 0; j < ny; j++ )
+    {
+      if ( j > 0 )
+      {
+        histogram.move( 1, y_direction );
+        y += y_direction;
+      }
+
+      DATA* dst_row = dst + ( z * ny + y ) * nx;
+      for ( index_type i = 0; i < nx; i++ )
+      {
+        if ( i > 0 )
+        {
+          histogram.move( 0, x_direction );
+          x += x_direction;
+        }
+        dst_row[ x ] = histogram.get_median();
+      }
+      x_direction = -x_direction;
+    }
+    y_direction = -y_direction;
+
+    if ( thread == 0 )
+    {
+      info.report_progress( static_cast< double >( z - z_start + 1 ) / ( z_end - z_start ) );
+    }
+  }
+}
+
+template< class DATA >
+static void MeanFilterParallel( const DATA* src, float* dst, 
+  const NeighborhoodFilterInfo& info, int thread, int num_threads, boost::barrier& barrier )
+{
+  // NOTE: The mean over the box is the mean along x of the mean along y of the mean along z.
+  // Each pass keeps a running sum, so the cost does not depend on the radius. The passes 
+  // along y and z update whole rows at a time to keep the memory access contiguous.
+  const index_type nx = info.n_[ 0 ];
+  const index_type ny = info.n_[ 1 ];
+  const index_type nz = info.n_[ 2 ];
+  const index_type nxy = nx * ny;
+  const index_type r = info.radius_;
+  const double scale = 1.0 / static_cast< double >( 2 * r + 1 );
+
+  index_type z_start = ( nz * thread ) / num_threads;
+  index_type z_end = ( nz * ( thread + 1 ) ) / num_threads;
+  index_type y_start = ( ny * thread ) / num_threads;
+  index_type y_end = ( ny * ( thread + 1 ) ) / num_threads;
+
+  // Pass along x
+  for ( index_type z = z_start; z < z_end; z++ )
+  {
+    if ( info.check_abort() ) break;
+    for ( index_type y = 0; y < ny; y++ )
+    {
+      const DATA* src_row = src + z * nxy + y * nx;
+      float* dst_row = dst + z * nxy + y * nx;
+      double sum = 0.0;
+      for ( index_type dx = -r; dx <= r; dx++ ) sum += src_row[ Clamp( dx, nx ) ];
+      for ( index_type x = 0; x < nx; x++ )
+      {
+        dst_row[ x ] = static_cast< float >( sum * scale );
+        sum += static_cast< double >( src_row[ Clamp( x + r + 1, nx ) ] ) - 
+          static_cast< double >( src_row[ Clamp( x - r, nx ) ] );
+      }
+    }
+    if ( thread == 0 ) info.report_progress( ( z - z_start + 1.0 ) / ( z_end - z_start ) / 3.0 );
+  }
+  barrier.wait();
+
+  std::vector< float > buffer;
+  std::vector< double > sum( nx );
+
+  // Pass along y, slice by slice
+  buffer.resize( nxy );
+  for ( index_type z = z_start; z < z_end; z++ )
+  {
+    if ( info.check_abort() ) break;
+    float* slice = dst + z * nxy;
+    std::copy( slice, slice + nxy, buffer.begin() );
+    std::fill( sum.begin(), sum.end(), 0.0 );
+    for ( index_type dy = -r; dy <= r; dy++ )
+    {
+      const float* row = &buffer[ Clamp( dy, ny ) * nx ];
+      for ( index_type x = 0; x < nx; x++ ) sum[ x ] += row[ x ];
+    }
+    for ( index_type y = 0; y < ny; y++ )
+    {
+      float* dst_row = slice + y * nx;
+      const float* old_row = &buffer[ Clamp( y - r, ny ) * nx ];
+      const float* new_row = &buffer[ Clamp( y + r + 1, ny ) * nx ];
+      for ( index_type x = 0; x < nx; x++ )
+      {
+        dst_row[ x ] = static_cast< float >( sum[ x ] * scale );
+        sum[ x ] += static_cast< double >( new_row[ x ] ) - static_cast< double >( old_row[ x ] );
+      }
+    }
+    if ( thread == 0 ) info.report_progress( ( 1.0 + ( z - z_start + 1.0 ) / 
+      ( z_end - z_start ) ) / 3.0 );
+  }
+  barrier.wait();
+
+  // Pass along z, one xz plane at a time
+  buffer.resize( nx * nz );
+  for ( index_type y = y_start; y < y_end; y++ )
+  {
+    if ( info.check_abort() ) break;
+    for ( index_type z = 0; z < nz; z++ )
+    {
+      const float* row = dst + z * nxy + y * nx;
+      std::copy( row, row + nx, buffer.begin() + z * nx );
+    }
+    std::fill( sum.begin(), sum.end(), 0.0 );
+    for ( index_type dz = -r; dz <= r; dz++ )
+    {
+      const float* row = &buffer[ Clamp( dz, nz ) * nx ];
+      for ( index_type x = 0; x < nx; x++ ) sum[ x ] += row[ x ];
+    }
+    for ( index_type z = 0; z < nz; z++ )
+    {
+      float* dst_row = dst + z * nxy + y * nx;
+      const float* old_row = &buffer[ Clamp( z - r, nz ) * nx ];
+      const float* new_row = &buffer[ Clamp( z + r + 1, nz ) * nx ];
+      for ( index_type x = 0; x < nx; x++ )
+      {
+        dst_row[ x ] = static_cast< float >( sum[ x ] * scale );
+        sum[ x ] += static_cast< double >( new_row[ x ] ) - static_cast< double >( old_row[ x ] );
+      }
+    }
+    if ( thread == 0 ) info.report_progress( ( 2.0 + ( y - y_start + 1.0 ) / 
+      ( y_end - y_start ) ) / 3.0 );
+  }
+}
+
+// Smallest and largest value of each thread's part of the volume
+template< class DATA >
+static void ValueRangeParallel( const DATA* src, size_t size, std::vector< DATA >& min_values,
+  std::vector< DATA >& max_values, int thread, int num_threads, boost::barrier& barrier )
+{
+  size_t start = size * thread / num_threads;
+  size_t end = size * ( thread + 1 ) / num_threads;
+  if ( start == end ) return;
+
+  DATA min_value = src[ start ];
+  DATA max_value = src[ start ];
+  for ( size_t j = start + 1; j < end; j++ )
+  {
+    if ( src[ j ] < min_value ) min_value = src[ j ];
+    if ( src[ j ] > max_value ) max_value = src[ j ];
+  }
+  min_values[ thread ] = min_value;
+  max_values[ thread ] = max_value;
+}
+
+template< class DATA >
+static void RunMedianFilter( const DataBlockHandle& src_data_block, 
+  const DataBlockHandle& dst_data_block, NeighborhoodFilterInfo& info, int num_threads )
+{
+  const DATA* src = reinterpret_cast< const DATA* >( src_data_block->get_data() );
+  DATA* dst = reinterpret_cast< DATA* >( dst_data_block->get_data() );
+
+  // NOTE: The column histograms need one histogram per voxel in a row, which is only
+  // affordable for a limited number of bins. 16 bit data that only uses a range of 
+  // MEDIAN_COLUMN_MAX_BITS_C bits, which is common for CT and EM data, is mapped onto 
+  // that range. Other data uses a single sliding histogram, which costs O(r^2) instead of 
+  // O(r) per voxel.
+  if ( num_threads < 0 ) num_threads = static_cast< int >( 
+    boost::thread::hardware_concurrency() );
+  if ( num_threads < 1 ) num_threads = 1;
+
+  info.bin_offset_ = HistogramOffset< DATA >();
+  info.bin_bits_ = 8 * static_cast< int >( sizeof( DATA ) );
+  if ( sizeof( DATA ) > 1 )
+  {
+    // NOTE: Threads that do not get any voxels keep the first voxel as their range.
+    std::vector< DATA > min_values( num_threads, src[ 0 ] );
+    std::vector< DATA > max_values( num_threads, src[ 0 ] );
+    Parallel range_parallel( boost::bind( &ValueRangeParallel< DATA >, src, 
+      src_data_block->get_size(), boost::ref( min_values ), boost::ref( max_values ), 
+      _1, _2, _3 ), num_threads );
+    range_parallel.run();
+
+    DATA min_value = *std::min_element( min_values.begin(), min_values.end() );
+    DATA max_value = *std::max_element( max_values.begin(), max_values.end() );
+    int num_values = static_cast< int >( max_value ) - static_cast< int >( min_value );
+    info.bin_offset_ = -static_cast< int >( min_value );
+    info.bin_bits_ = 8;
+    while ( info.bin_bits_ < 16 && ( 1 << info.bin_bits_ ) <= num_values ) info.bin_bits_++;
+  }
+
+  // The column histograms take nx * ( 2^bits + 2^( bits - bits / 2 ) ) counts per thread,
+  // which is 16kB per voxel in a row for 12 bits. Use fewer threads to stay within
+  // MEDIAN_COLUMN_MAX_MEMORY_C, or the sliding histogram if a single thread does not fit.
+  size_t column_bins = ( size_t( 1 ) << info.bin_bits_ ) + 
+    ( size_t( 1 ) << ( info.bin_bits_ - info.bin_bits_ / 2 ) );
+  size_t column_memory = static_cast< size_t >( info.n_[ 0 ] ) * column_bins * 
+    sizeof( unsigned int );
+  int max_column_threads = static_cast< int >( Min( MEDIAN_COLUMN_MAX_MEMORY_C / 
+    column_memory, size_t( 1024 ) ) );
+
+  if ( info.bin_bits_ <= MEDIAN_COLUMN_MAX_BITS_C && max_column_threads > 0 )
+  {
+    num_threads = Min( num_threads, max_column_threads );
+    Parallel parallel( boost::bind( &MedianFilterColumnsParallel< DATA >, src, dst,
+      boost::cref( info ), _1, _2, _3 ), num_threads );
+    parallel.run();
+  }
+  else
+  {
+    Parallel parallel( boost::bind( &MedianFilterSlidingParallel< DATA >, src, dst,
+      boost::cref( info ), _1, _2, _3 ), num_threads );
+    parallel.run();
+  }
+}
+
+template< class DATA >
+static void RunMeanFilter( const DataBlockHandle& src_data_block, 
+  const DataBlockHandle& dst_data_block, const NeighborhoodFilterInfo& info, int num_threads )
+{
+  const DATA* src = reinterpret_cast< const DATA* >( src_data_block->get_data() );
+  float* dst = reinterpret_cast< float* >( dst_data_block->get_data() );
+
+  Parallel parallel( boost::bind( &MeanFilterParallel< DATA >, src, dst,
+    boost::cref( info ), _1, _2, _3 ), num_threads );
+  parallel.run();
+}
+
+// CLASS GaussianFilterInfo:
+// Parameters of the Gaussian filter that are shared by all the threads.
+
+class GaussianFilterInfo : public NeighborhoodFilterInfo
+{
+public:
+  // Whether the recursive filter is used instead of the explicit convolution
+  bool recursive_;
+
+  // Weights of the explicit convolution from the center outwards
+  std::vector< float > kernel_;
+
+  // Coefficients of the recursive filter as w[n] = b_ * x[n] + sum a_[i] * w[n-i-1]
+  double b_;
+  double a_[ 3 ];
+
+  void setup( double sigma, bool allow_recursive )
+  {
+    this->recursive_ = allow_recursive && sigma >= GAUSSIAN_RECURSIVE_SIGMA_C;
+    if ( this->recursive_ )
+    {
+      // Young and van Vliet, "Recursive implementation of the Gaussian filter", 1995
+      double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 
+        3.97156 - 4.14554 * std::sqrt( 1.0 - 0.26891 * sigma );
+      double q2 = q * q;
+      double q3 = q2 * q;
+      double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+      this->a_[ 0 ] = ( 2.44413 * q + 2.85619 * q2 + 1.26661 * q3 ) / b0;
+      this->a_[ 1 ] = -( 1.4281 * q2 + 1.26661 * q3 ) / b0;
+      this->a_[ 2 ] = ( 0.422205 * q3 ) / b0;
+      this->b_ = 1.0 - ( this->a_[ 0 ] + this->a_[ 1 ] + this->a_[ 2 ] );
+    }
+    else
+    {
+      int radius = DataBlockFilter::GetGaussianKernelRadius( sigma );
+      this->kernel_.resize( radius + 1 );
+      double sum = 0.0;
+      for ( int k = 0; k <= radius; k++ )
+      {
+        this->kernel_[ k ] = static_cast< float >( std::exp( -0.5 * k * k / ( sigma * sigma ) ) );
+        sum += ( k == 0 ? 1.0 : 2.0 ) * this->kernel_[ k ];
+      }
+      for ( int k = 0; k <= radius; k++ )
+      {
+        this->kernel_[ k ] = static_cast< float >( this->kernel_[ k ] / sum );
+      }
+    }
+  }
+};
+
+// Smooth a contiguous line with the explicit kernel
+static void GaussianConvolveLine( float* line, index_type n, const std::vector< float >& kernel,
+  std::vector< float >& buffer )
+{
+  index_type radius = static_cast< index_type >( kernel.size() ) - 1;
+  buffer.resize( n + 2 * radius );
+  for ( index_type j = -radius; j < n + radius; j++ ) buffer[ j + radius ] = line[ Clamp( j, n ) ];
+
+  const float* center = &buffer[ radius ];
+  for ( index_type j = 0; j < n; j++ ) line[ j ] = kernel[ 0 ] * center[ j ];
+  for ( index_type k = 1; k <= radius; k++ )
+  {
+    const float weight = kernel[ k ];
+    const float* left = center - k;
+    const float* right = center + k;
+    for ( index_type j = 0; j < n; j++ ) line[ j ] += weight * ( left[ j ] + right[ j ] );
+  }
+}
+
+// Smooth a contiguous line with the recursive filter
+static void GaussianRecurseLine( float* line, index_type n, const GaussianFilterInfo& info )
+{
+  const double b = info.b_;
+  const double a0 = info.a_[ 0 ];
+  const double a1 = info.a_[ 1 ];
+  const double a2 = info.a_[ 2 ];
+
+  // NOTE: The state starts as if the line continues with the value on the boundary
+  double w1 = line[ 0 ], w2 = line[ 0 ], w3 = line[ 0 ];
+  for ( index_type j = 0; j < n; j++ )
+  {
+    double w = b * line[ j ] + a0 * w1 + a1 * w2 + a2 * w3;
+    line[ j ] = static_cast< float >( w );
+    w3 = w2; w2 = w1; w1 = w;
+  }
+
+  w1 = w2 = w3 = line[ n - 1 ];
+  for ( index_type j = n - 1; j >= 0; j-- )
+  {
+    double w = b * line[ j ] + a0 * w1 + a1 * w2 + a2 * w3;
+    line[ j ] = static_cast< float >( w );
+    w3 = w2; w2 = w1; w1 = w;
+  }
+}
+
+// Smooth count rows of nx voxels that are stride voxels apart, along the direction across
+// the rows, with the explicit kernel. All the voxels of a row are updated together, which
+// keeps the inner loops contiguous so they are vectorized.
+static void GaussianConvolveRows( float* rows, index_type stride, index_type count, 
+  index_type nx, const std::vector< float >& kernel, std::vector< float >& buffer )
+{
+  index_type radius = static_cast< index_type >( kernel.size() ) - 1;
+  buffer.resize( count * nx );
+  for ( index_type j = 0; j < count; j++ )
+  {
+    std::copy( rows + j * stride, rows + j * stride + nx, buffer.begin() + j * nx );
+  }
+
+  for ( index_type j = 0; j < count; j++ )
+  {
+    float* dst_row = rows + j * stride;
+    const float* center = &buffer[ j * nx ];
+    for ( index_type x = 0; x < nx; x++ ) dst_row[ x ] = kernel[ 0 ] * center[ x ];
+    for ( index_type k = 1; k <= radius; k++ )
+    {
+      const float weight = kernel[ k ];
+      const float* left = &buffer[ Clamp( j - k, count ) * nx ];
+      const float* right = &buffer[ Clamp( j + k, count ) * nx ];
+      for ( index_type x = 0; x < nx; x++ ) dst_row[ x ] += weight * ( left[ x ] + right[ x ] );
+    }
+  }
+}
+
+// Smooth count rows of nx voxels that are stride voxels apart, along the direction across
+// the rows, with the recursive filter.
+static void GaussianRecurseRows( float* rows, index_type stride, index_type count, 
+  index_type nx, const GaussianFilterInfo& info, std::vector< float >& buffer )
+{
+  const float b = static_cast< float >( info.b_ );
+  const float a0 = static_cast< float >( info.a_[ 0 ] );
+  const float a1 = static_cast< float >( info.a_[ 1 ] );
+  const float a2 = static_cast< float >( info.a_[ 2 ] );
+
+  // The first and last row before they are overwritten, these start the recursion
+  buffer.resize( 2 * nx );
+  float* first = &buffer[ 0 ];
+  float* last = &buffer[ nx ];
+  std::copy( rows, rows + nx, first );
+
+  const float* w1 = first;
+  const float* w2 = first;
+  const float* w3 = first;
+  for ( index_type j = 0; j < count; j++ )
+  {
+    float* row = rows + j * stride;
+    for ( index_type x = 0; x < nx; x++ )
+    {
+      row[ x ] = b * row[ x ] + a0 * w1[ x ] + a1 * w2[ x ] + a2 * w3[ x ];
+    }
+    w3 = w2; w2 = w1; w1 = row;
+  }
+
+  std::copy( rows + ( count - 1 ) * stride, rows + ( count - 1 ) * stride + nx, last );
+  w1 = w2 = w3 = last;
+  for ( index_type j = count - 1; j >= 0; j-- )
+  {
+    float* row = rows + j * stride;
+    for ( index_type x = 0; x < nx; x++ )
+    {
+      row[ x ] = b * row[ x ] + a0 * w1[ x ] + a1 * w2[ x ] + a2 * w3[ x ];
+    }
+    w3 = w2; w2 = w1; w1 = row;
+  }
+}
+
+template< class DATA >
+static void ConvertToFloatParallel( const DATA* src, float* dst, size_t size, 
+  int thread, int num_threads, boost::barrier& barrier )
+{
+  size_t start = ( size * thread ) / num_threads;
+  size_t end = ( size * ( thread + 1 ) ) / num_threads;
+  for ( size_t j = start; j < end; j++ ) dst[ j ] = static_cast< float >( src[ j ] );
+}
+
+static void GaussianFilterParallel( float* data, const GaussianFilterInfo& info, 
+  int thread, int num_threads, boost::barrier& barrier )
+{
+  const index_type nx = info.n_[ 0 ];
+  const index_type ny = info.n_[ 1 ];
+  const index_type nz = info.n_[ 2 ];
+  const index_type nxy = nx * ny;
+
+  index_type z_start = ( nz * thread ) / num_threads;
+  index_type z_end = ( nz * ( thread + 1 ) ) / num_threads;
+  index_type y_start = ( ny * thread ) / num_threads;
+  index_type y_end = ( ny * ( thread + 1 ) ) / num_threads;
+
+  std::vector< float > buffer;
+
+  // Pass along x, row by row
+  for ( index_type z = z_start; z < z_end && nx > 1; z++ )
+  {
+    if ( info.check_abort() ) break;
+    for ( index_type y = 0; y < ny; y++ )
+    {
+      float* row = data + z * nxy + y * nx;
+      if ( info.recursive_ ) GaussianRecurseLine( row, nx, info );
+      else GaussianConvolveLine( row, nx, info.kernel_, buffer );
+    }
+    if ( thread == 0 ) info.report_progress( ( z - z_start + 1.0 ) / ( z_end - z_start ) / 3.0 );
+  }
+  barrier.wait();
+
+  // Pass along y, slice by slice
+  for ( index_type z = z_start; z < z_end && ny > 1; z++ )
+  {
+    if ( info.check_abort() ) break;
+    float* slice = data + z * nxy;
+    if ( info.recursive_ ) GaussianRecurseRows( slice, nx, ny, nx, info, buffer );
+    else GaussianConvolveRows( slice, nx, ny, nx, info.kernel_, buffer );
+    if ( thread == 0 ) info.report_progress( ( 1.0 + ( z - z_start + 1.0 ) / 
+      ( z_end - z_start ) ) / 3.0 );
+  }
+  barrier.wait();
+
+  // Pass along z, one xz plane at a time
+  for ( index_type y = y_start; y < y_end && nz > 1; y++ )
+  {
+    if ( info.check_abort() ) break;
+    float* plane = data + y * nx;
+    if ( info.recursive_ ) GaussianRecurseRows( plane, nxy, nz, nx, info, buffer );
+    else GaussianConvolveRows( plane, nxy, nz, nx, info.kernel_, buffer );
+    if ( thread == 0 ) info.report_progress( ( 2.0 + ( y - y_start + 1.0 ) / 
+      ( y_end - y_start ) ) / 3.0 );
+  }
+}
+
+template< class DATA >
+static void RunConvertToFloat( const DataBlockHandle& src_data_block, 
+  const DataBlockHandle& dst_data_block, int num_threads )
+{
+  const DATA* src = reinterpret_cast< const DATA* >( src_data_block->get_data() );
+  float* dst = reinterpret_cast< float* >( dst_data_block->get_data() );
+
+  Parallel parallel( boost::bind( &ConvertToFloatParallel< DATA >, src, dst,
+    src_data_block->get_size(), _1, _2, _3 ), num_threads );
+  parallel.run();
+}
+
+// CLASS DistanceFilterInfo:
+// Parameters of the distance transform that are shared by all the threads.
+
+class DistanceFilterInfo : public NeighborhoodFilterInfo
+{
+public:
+  // Distance between voxels along each axis
+  double spacing_[ 3 ];
+
+  // Bit of the mask in the mask data
+  unsigned char mask_value_;
+
+  bool signed_distance_;
+  bool inside_positive_;
+};
+
+/// Squared distance of voxels that have no feature voxel on their lines yet
+const static float DISTANCE_INFINITY_C = std::numeric_limits< float >::max();
+
+// Buffers of the distance transform of a line
+
+class DistanceLineBuffers
+{
+public:
+  // Voxels whose parabolas form the lower envelope, with their squared distances
+  std::vector< index_type > vertices_;
+  std::vector< double > values_;
+
+  // Positions where the parabolas of the envelope start
+  std::vector< double > bounds_;
+};
+
+// Replace the squared distances along a line with the squared distances to the nearest 
+// feature voxel along the line, using the lower envelope of the parabolas rooted at each 
+// voxel (Felzenszwalb and Huttenlocher, "Distance transforms of sampled functions", 2012)
+static void DistanceTransformLine( float* line, index_type n, double spacing, 
+  DistanceLineBuffers& buffers )
+{
+  std::vector< index_type >& vertices = buffers.vertices_;
+  std::vector< double >& values = buffers.values_;
+  std::vector< double >& bounds = buffers.bounds_;
+  vertices.resize( n );
+  values.resize( n );
+  bounds.resize( n + 1 );
+
+  // Build the lower envelope from the voxels that have a distance
+  index_type k = -1;
+  for ( index_type q = 0; q < n; q++ )
+  {
+    if ( line[ q ] >= DISTANCE_INFINITY_C ) continue;
+    double position = q * spacing;
+    double height = line[ q ] + position * position;
+
+    double start = -std::numeric_limits< double >::max();
+    while ( k >= 0 )
+    {
+      double vertex_position = vertices[ k ] * spacing;
+      start = ( height - ( values[ k ] + vertex_position * vertex_position ) ) / 
+        ( 2.0 * ( position - vertex_position ) );
+      if ( start > bounds[ k ] ) break;
+      start = -std::numeric_limits< double >::max();
+      k--;
+    }
+
+    k++;
+    vertices[ k ] = q;
+    values[ k ] = line[ q ];
+    bounds[ k ] = start;
+    bounds[ k + 1 ] = std::numeric_limits< double >::max();
+  }
+
+  // Line without any feature voxel
+  if ( k < 0 ) return;
+
+  index_type j = 0;
+  for ( index_type q = 0; q < n; q++ )
+  {
+    double position = q * spacing;
+    while ( bounds[ j + 1 ] < position ) j++;
+    double distance = position - vertices[ j ] * spacing;
+    line[ q ] = static_cast< float >( distance * distance + values[ j ] );
+  }
+}
+
+static void DistanceFilterParallel( const unsigned char* mask, float* data, 
+  const DistanceFilterInfo& info, int thread, int num_threads, boost::barrier& barrier )
+{
+  const index_type nx = info.n_[ 0 ];
+  const index_type ny = info.n_[ 1 ];
+  const index_type nz = info.n_[ 2 ];
+  const index_type nxy = nx * ny;
+  const unsigned char mask_value = info.mask_value_;
+
+  index_type z_start = ( nz * thread ) / num_threads;
+  index_type z_end = ( nz * ( thread + 1 ) ) / num_threads;
+  index_type y_start = ( ny * thread ) / num_threads;
+  index_type y_end = ( ny * ( thread + 1 ) ) / num_threads;
+
+  DistanceLineBuffers line_buffers;
+  std::vector< float > buffer;
+
+  // Mark the feature voxels and run the pass along x
+  for ( index_type z = z_start; z < z_end; z++ )
+  {
+    if ( info.check_abort() ) break;
+    for ( index_type y = 0; y < ny; y++ )
+    {
+      index_type index = z * nxy + y * nx;
+      float* row = data + index;
+      for ( index_type x = 0; x < nx; x++, index++ )
+      {
+        bool inside = ( mask[ index ] & mask_value ) != 0;
+        bool feature = inside;
+        if ( inside && info.signed_distance_ )
+        {
+          // NOTE: The boundary consists of the voxels inside the mask that have a face 
+          // neighbor outside the mask, as in ITK's signed Maurer distance map
+          feature = ( x > 0 && !( mask[ index - 1 ] & mask_value ) ) ||
+            ( x + 1 < nx && !( mask[ index + 1 ] & mask_value ) ) ||
+            ( y > 0 && !( mask[ index - nx ] & mask_value ) ) ||
+            ( y + 1 < ny && !( mask[ index + nx ] & mask_value ) ) ||
+            ( z > 0 && !( mask[ index - nxy ] & mask_value ) ) ||
+            ( z + 1 < nz && !( mask[ index + nxy ] & mask_value ) );
+        }
+        row[ x ] = feature ? 0.0f : DISTANCE_INFINITY_C;
+      }
+      DistanceTransformLine( row, nx, info.spacing_[ 0 ], line_buffers );
+    }
+    if ( thread == 0 ) info.report_progress( ( z - z_start + 1.0 ) / ( z_end - z_start ) / 3.0 );
+  }
+  barrier.wait();
+
+  // Pass along y, column by column within each slice
+  buffer.resize( ny );
+  for ( index_type z = z_start; z < z_end; z++ )
+  {
+    if ( info.check_abort() ) break;
+    float* slice = data + z * nxy;
+    for ( index_type x = 0; x < nx; x++ )
+    {
+      for ( index_type y = 0; y < ny; y++ ) buffer[ y ] = slice[ y * nx + x ];
+      DistanceTransformLine( &buffer[ 0 ], ny, info.spacing_[ 1 ], line_buffers );
+      for ( index_type y = 0; y < ny; y++ ) slice[ y * nx + x ] = buffer[ y ];
+    }
+    if ( thread == 0 ) info.report_progress( ( 1.0 + ( z - z_start + 1.0 ) / 
+      ( z_end - z_start ) ) / 3.0 );
+  }
+  barrier.wait();
+
+  // Pass along z, which transposes each xz plane so the lines are contiguous
+  buffer.resize( nx * nz );
+  for ( index_type y = y_start; y < y_end; y++ )
+  {
+    if ( info.check_abort() ) break;
+    for ( index_type z = 0; z < nz; z++ )
+    {
+      const float* row = data + z * nxy + y * nx;
+      for ( index_type x = 0; x < nx; x++ ) buffer[ x * nz + z ] = row[ x ];
+    }
+    for ( index_type x = 0; x < nx; x++ )
+    {
+      DistanceTransformLine( &buffer[ x * nz ], nz, info.spacing_[ 2 ], line_buffers );
+    }
+    
+    // Take the square root and apply the sign
+    for ( index_type z = 0; z < nz; z++ )
+    {
+      index_type index = z * nxy + y * nx;
+      float* row = data + index;
+      for ( index_type x = 0; x < nx; x++ )
+      {
+        float squared_distance = buffer[ x * nz + z ];
+        float distance = squared_distance >= DISTANCE_INFINITY_C ? DISTANCE_INFINITY_C : 
+          std::sqrt( squared_distance );
+        bool inside = ( mask[ index + x ] & mask_value ) != 0;
+        row[ x ] = ( info.signed_distance_ && inside != info.inside_positive_ ) ? 
+          -distance : distance;
+      }
+    }
+    if ( thread == 0 ) info.report_progress( ( 2.0 + ( y - y_start + 1.0 ) / 
+      ( y_end - y_start ) ) / 3.0 );
+  }
+}
+
+// CLASS ThresholdFilterInfo:
+// Ranges and bit planes of the masks that are written by the threshold filter.
+
+template< class DATA >
+class ThresholdFilterInfo : public NeighborhoodFilterInfo
+{
+public:
+  // Ranges of the masks converted to the type of the data
+  std::vector< DATA > lower_;
+  std::vector< DATA > upper_;
+
+  // Bit planes of the masks
+  std::vector< unsigned char* > mask_data_;
+  std::vector< unsigned char > mask_value_;
+};
+
+// Smallest value of the type that is not below the value, and largest value that is not above
+// it. Integer types are clamped to their range.
+template< class DATA >
+static inline DATA ThresholdLowerBound( double value )
+{
+  if ( value <= static_cast< double >( std::numeric_limits< DATA >::min() ) ) 
+  {
+    return std::numeric_limits< DATA >::min();
+  }
+  return static_cast< DATA >( std::ceil( value ) );
+}
+
+template< class DATA >
+static inline DATA ThresholdUpperBound( double value )
+{
+  if ( value >= static_cast< double >( std::numeric_limits< DATA >::max() ) ) 
+  {
+    return std::numeric_limits< DATA >::max();
+  }
+  return static_cast< DATA >( std::floor( value ) );
+}
+
+template<>
+inline float ThresholdLowerBound< float >( double value )
+{
+  float bound = static_cast< float >( value );
+  if ( static_cast< double >( bound ) < value ) bound = boost::math::float_next( bound );
+  return bound;
+}
+
+template<>
+inline float ThresholdUpperBound< float >( double value )
+{
+  float bound = static_cast< float >( value );
+  if ( static_cast< double >( bound ) > value ) bound = boost::math::float_prior( bound );
+  return bound;
+}
+
+template<>
+inline double ThresholdLowerBound< double >( double value )
+{
+  return value;
+}
+
+template<>
+inline double ThresholdUpperBound< double >( double value )
+{
+  return value;
+}
+
+template< class DATA >
+static void ThresholdFilterParallel( const DATA* src, const ThresholdFilterInfo< DATA >& info,
+  int thread, int num_threads, boost::barrier& barrier )
+{
+  const index_type nxy = info.n_[ 0 ] * info.n_[ 1 ];
+  const index_type nz = info.n_[ 2 ];
+  const size_t num_masks = info.mask_data_.size();
+
+  index_type z_start = ( nz * thread ) / num_threads;
+  index_type z_end = ( nz * ( thread + 1 ) ) / num_threads;
+
+  for ( index_type z = z_start; z < z_end; z++ )
+  {
+    if ( info.check_abort() ) break;
+
+    // NOTE: The slice is read once for each mask, after the first time it is in the cache. 
+    // Each inner loop is a branch free compare and bit update that the compiler can vectorize.
+    const DATA* data = src + z * nxy;
+    for ( size_t k = 0; k < num_masks; k++ )
+    {
+      const DATA lower = info.lower_[ k ];
+      const DATA upper = info.upper_[ k ];
+      const unsigned char value = info.mask_value_[ k ];
+      const unsigned char not_value = static_cast< unsigned char >( ~value );
+      unsigned char* mask = info.mask_data_[ k ] + z * nxy;
+
+      for ( index_type j = 0; j < nxy; j++ )
+      {
+        const unsigned char inside = static_cast< unsigned char >( 
+          ( data[ j ] >= lower ) & ( data[ j ] <= upper ) );
+        mask[ j ] = static_cast< unsigned char >( ( mask[ j ] & not_value ) | 
+          ( -inside & value ) );
+      }
+    }
+
+    if ( thread == 0 ) info.report_progress( ( z - z_start + 1.0 ) / ( z_end - z_start ) );
+  }
+}
+
+template< class DATA >
+static void RunThresholdFilter( const DataBlockHandle& src_data_block, 
+  const std::vector< double >& lower, const std::vector< double >& upper,
+  const std::vector< MaskDataBlockHandle >& masks, NeighborhoodFilterInfo& base_info )
+{
+  ThresholdFilterInfo< DATA > info;
+  static_cast< NeighborhoodFilterInfo& >( info ) = base_info;
+  const DATA min_value = std::numeric_limits< DATA >::is_integer ? 
+    std::numeric_limits< DATA >::min() : -std::numeric_limits< DATA >::max();
+  const DATA max_value = std::numeric_limits< DATA >::max();
+  for ( size_t k = 0; k < masks.size(); k++ )
+  {
+    // Ranges outside of the type are empty, which is marked by a lower bound above the upper
+    if ( lower[ k ] > upper[ k ] || upper[ k ] < static_cast< double >( min_value ) ||
+      lower[ k ] > static_cast< double >( max_value ) )
+    {
+      info.lower_.push_back( max_value );
+      info.upper_.push_back( min_value );
+    }
+    else
+    {
+      info.lower_.push_back( ThresholdLowerBound< DATA >( lower[ k ] ) );
+      info.upper_.push_back( ThresholdUpperBound< DATA >( upper[ k ] ) );
+    }
+    info.mask_data_.push_back( masks[ k ]->get_mask_data() );
+    info.mask_value_.push_back( masks[ k ]->get_mask_value() );
+  }
+
+  int num_threads = src_data_block->get_size() < NEIGHBORHOOD_PARALLEL_SIZE_C ? 1 : -1;
+  Parallel parallel( boost::bind( &ThresholdFilterParallel< DATA >, 
+    reinterpret_cast< const DATA* >( src_data_block->get_data() ), boost::cref( info ), 
+    _1, _2, _3 ), num_threads );
+  parallel.run();
+}
+
+// CLASS ResampleAxisTable:
+// The input samples and weights that make up each output sample along one axis. Samples that
+// fall outside of the input and need to be padded have index -1.
+class ResampleAxisTable
+{
+public:
+  size_t size_in_;
+  size_t size_out_;
+  int taps_;
+  std::vector< int > index_;
+  std::vector< float > weight_;
+};
+
+// Compute the weights of the kernel for the output samples along an axis. The sample positions,
+// the stretching of the kernel when downsampling and the renormalization follow what 
+// nrrdResampleExecute does, so the results do not change.
+static void ComputeResampleAxisTable( const NrrdResampleAxis& axis, 
+  const NrrdKernelSpec* kernel_spec, bool pad, ResampleAxisTable& table )
+{
+  double parm[ NRRD_KERNEL_PARMS_NUM ];
+  for ( int i = 0; i < NRRD_KERNEL_PARMS_NUM; ++i )
+  {
+    parm[ i ] = kernel_spec->parm[ i ];
+  }
+  if ( axis.ratio < 1.0 )
+  {
+    parm[ 0 ] /= axis.ratio;
+  }
+
+  const NrrdKernel* kernel = kernel_spec->kernel;
+  const int size_in = static_cast< int >( axis.sizeIn );
+  const size_t size_out = axis.samples;
+  const int taps = Max( 1, 2 * static_cast< int >( std::ceil( kernel->support( parm ) ) ) );
+  const double integral = kernel->integral( parm );
+
+  table.size_in_ = axis.sizeIn;
+  table.size_out_ = size_out;
+  table.taps_ = taps;
+  table.index_.resize( size_out * taps );
+  table.weight_.resize( size_out * taps );
+
+  std::vector< double > weights( taps );
+  for ( size_t i = 0; i < size_out; ++i )
+  {
+    double pos = NRRD_POS( axis.center, axis.min, axis.max, size_out, i );
+    int base = static_cast< int >( std::floor( pos ) ) - taps / 2 + 1;
+    double sum = 0.0;
+    for ( int j = 0; j < taps; ++j )
+    {
+      int index = base + j;
+      weights[ j ] = kernel->eval1_d( pos - index, parm );
+      sum += weights[ j ];
+      if ( index < 0 || index >= size_in )
+      {
+        index = pad ? -1 : Core::Clamp( index, 0, size_in - 1 );
+      }
+      table.index_[ i * taps + j ] = index;
+    }
+
+    double scale = ( sum != 0.0 && integral != 0.0 ) ? integral / sum : 1.0;
+    for ( int j = 0; j < taps; ++j )
+    {
+      table.weight_[ i * taps + j ] = static_cast< float >( weights[ j ] * scale );
+    }
+  }
+}
+
+// Convert a resampled value back to the data type, rounding and clamping integer types.
+template< class DATA >
+static inline DATA ResampleCast( float value )
+{
+  if ( std::numeric_limits< DATA >::is_integer )
+  {
+    double rounded = std::floor( value + 0.5 );
+    if ( rounded <= static_cast< double >( std::numeric_limits< DATA >::min() ) ) 
+    {
+      return std::numeric_limits< DATA >::min();
+    }
+    if ( rounded >= static_cast< double >( std::numeric_limits< DATA >::max() ) ) 
+    {
+      return std::numeric_limits< DATA >::max();
+    }
+    return static_cast< DATA >( rounded );
+  }
+  return static_cast< DATA >( value );
+}
+
+// CLASS ResampleFilterInfo:
+// The tables of the three axes of the resample filter, which are shared by all the threads.
+class ResampleFilterInfo : public NeighborhoodFilterInfo
+{
+public:
+  ResampleAxisTable tables_[ 3 ];
+  float pad_value_;
+};
+
+// Resample count contiguous rows along the rows
+template< class SRC >
+static void ResampleRows( const SRC* src, float* dst, size_t count, 
+  const ResampleAxisTable& table, float pad_value )
+{
+  const size_t size_in = table.size_in_;
+  const size_t size_out = table.size_out_;
+  const int taps = table.taps_;
+
+  for ( size_t row = 0; row < count; ++row )
+  {
+    const SRC* src_row = src + row * size_in;
+    float* dst_row = dst + row * size_out;
+    const int* index = &table.index_[ 0 ];
+    const float* weight = &table.weight_[ 0 ];
+    for ( size_t i = 0; i < size_out; ++i, index += taps, weight += taps )
+    {
+      float sum = 0.0f;
+      for ( int j = 0; j < taps; ++j )
+      {
+        sum += weight[ j ] * ( index[ j ] < 0 ? pad_value : 
+          static_cast< float >( src_row[ index[ j ] ] ) );
+      }
+      dst_row[ i ] = sum;
+    }
+  }
+}
+
+// Compute output row i of rows of size values that are size values apart, along the direction
+// across the rows. All the values of a row are summed together, which keeps the inner loops
+// contiguous so they are vectorized.
+template< class DST >
+static void ResampleAcrossRows( const float* src, DST* dst, size_t size, size_t i, 
+  const ResampleAxisTable& table, float pad_value, float* sum )
+{
+  const int taps = table.taps_;
+  std::fill( sum, sum + size, 0.0f );
+  for ( int j = 0; j < taps; ++j )
+  {
+    const int index = table.index_[ i * taps + j ];
+    const float weight = table.weight_[ i * taps + j ];
+    if ( weight == 0.0f ) continue;
+
+    if ( index < 0 )
+    {
+      const float padding = weight * pad_value;
+      for ( size_t k = 0; k < size; ++k ) sum[ k ] += padding;
+      continue;
+    }
+
+    const float* src_row = src + index * size;
+    for ( size_t k = 0; k < size; ++k )
+    {
+      sum[ k ] += weight * src_row[ k ];
+    }
+  }
+
+  for ( size_t k = 0; k < size; ++k )
+  {
+    dst[ k ] = ResampleCast< DST >( sum[ k ] );
+  }
+}
+
+// Resample the x and y axes of a range of input slices. Each thread resamples its slices along
+// x into a scratch slice and from there along y into the float volume.
+template< class DATA >
+static void ResampleSlicesParallel( const DATA* src, float* dst, const ResampleFilterInfo& info,
+  int thread, int num_threads, boost::barrier& barrier )
+{
+  const ResampleAxisTable& table_x = info.tables_[ 0 ];
+  const ResampleAxisTable& table_y = info.tables_[ 1 ];
+  const size_t nz = static_cast< size_t >( info.n_[ 2 ] );
+  const size_t src_nxy = table_x.size_in_ * table_y.size_in_;
+  const size_t nx = table_x.size_out_;
+  const size_t ny = table_y.size_out_;
+  const size_t z_start = ( nz * thread ) / num_threads;
+  const size_t z_end = ( nz * ( thread + 1 ) ) / num_threads;
+
+  std::vector< float > rows( nx * table_y.size_in_ );
+  std::vector< float > sum( nx );
+  for ( size_t z = z_start; z < z_end; ++z )
+  {
+    if ( info.check_abort() ) return;
+
+    ResampleRows( src + z * src_nxy, &rows[ 0 ], table_y.size_in_, table_x, info.pad_value_ );
+    for ( size_t y = 0; y < ny; ++y )
+    {
+      ResampleAcrossRows( &rows[ 0 ], dst + ( z * ny + y ) * nx, nx, y, table_y, 
+        info.pad_value_, &sum[ 0 ] );
+    }
+
+    if ( thread == 0 ) info.report_progress( 0.7 * ( z - z_start + 1.0 ) / ( z_end - z_start ) );
+  }
+}
+
+// Resample the z axis from the float volume into the destination. Each thread takes a range 
+// of output slices.
+template< class DATA >
+static void ResampleDepthParallel( const float* src, DATA* dst, const ResampleFilterInfo& info,
+  int thread, int num_threads, boost::barrier& barrier )
+{
+  const ResampleAxisTable& table_z = info.tables_[ 2 ];
+  const size_t nxy = info.tables_[ 0 ].size_out_ * info.tables_[ 1 ].size_out_;
+  const size_t nz = table_z.size_out_;
+  const size_t z_start = ( nz * thread ) / num_threads;
+  const size_t z_end = ( nz * ( thread + 1 ) ) / num_threads;
+
+  std::vector< float > sum( nxy );
+  for ( size_t z = z_start; z < z_end; ++z )
+  {
+    if ( info.check_abort() ) return;
+
+    ResampleAcrossRows( src, dst + z * nxy, nxy, z, table_z, info.pad_value_, &sum[ 0 ] );
+
+    if ( thread == 0 ) 
+    {
+      info.report_progress( 0.7 + 0.3 * ( z - z_start + 1.0 ) / ( z_end - z_start ) );
+    }
+  }
+}
+
+template< class DATA >
+static bool RunResampleFilter( const DataBlockHandle& src_data_block, 
+  DataBlockHandle& dst_data_block, const ResampleFilterInfo& info )
+{
+  const size_t nx = info.tables_[ 0 ].size_out_;
+  const size_t ny = info.tables_[ 1 ].size_out_;
+  const size_t nz = info.tables_[ 2 ].size_out_;
+  int num_threads = nx * ny * nz < NEIGHBORHOOD_PARALLEL_SIZE_C ? 1 : -1;
+
+  DataBlockHandle slices = StdDataBlock::New( nx, ny, src_data_block->get_nz(), 
+    DataType::FLOAT_E );
+  if ( !slices ) return false;
+
+  Parallel slices_parallel( boost::bind( &ResampleSlicesParallel< DATA >, 
+    reinterpret_cast< const DATA* >( src_data_block->get_data() ), 
+    reinterpret_cast< float* >( slices->get_data() ), boost::cref( info ), _1, _2, _3 ), 
+    num_threads );
+  slices_parallel.run();
+  if ( info.check_abort() ) return true;
+
+  dst_data_block = StdDataBlock::New( nx, ny, nz, src_data_block->get_data_type() );
+  if ( !dst_data_block ) return false;
+
+  Parallel depth_parallel( boost::bind( &ResampleDepthParallel< DATA >, 
+    reinterpret_cast< const float* >( slices->get_data() ), 
+    reinterpret_cast< DATA* >( dst_data_block->get_data() ), boost::cref( info ), 
+    _1, _2, _3 ), num_threads );
+  depth_parallel.run();
+  return true;
+}
+
+static void SetupNeighborhoodFilterInfo( const DataBlockHandle& data_block, int radius,
+  const DataBlockFilter::abort_function_type& abort_function,
+  const DataBlockFilter::progress_function_type& progress_function,
+  NeighborhoodFilterInfo& info )
+{
+  info.n_[ 0 ] = static_cast< index_type >( data_block->get_nx() );
+  info.n_[ 1 ] = static_cast< index_type >( data_block->get_ny() );
+  info.n_[ 2 ] = static_cast< index_type >( data_block->get_nz() );
+  info.radius_ = radius;
+  info.abort_function_ = abort_function;
+  info.progress_function_ = progress_function;
+}
+
+bool DataBlockFilter::IsMedianFilterSupported( DataType data_type )
+{
+  return data_type == DataType::CHAR_E || data_type == DataType::UCHAR_E ||
+    data_type == DataType::SHORT_E || data_type == DataType::USHORT_E;
+}
+
+bool DataBlockFilter::MedianFilter( const DataBlockHandle& src_data_block, 
+  DataBlockHandle& dst_data_block, int radius, const abort_function_type& abort_function,
+  const progress_function_type& progress_function, int num_threads )
+{
+  dst_data_block.reset();
+  if ( !src_data_block || radius < 0 ) return false;
+  if ( !IsMedianFilterSupported( src_data_block->get_data_type() ) ) return false;
+  if ( src_data_block->get_size() == 0 ) return false;
+
+  DataBlock::shared_lock_type lock( src_data_block->get_mutex() );
+
+  dst_data_block = StdDataBlock::New( src_data_block->get_nx(), src_data_block->get_ny(),
+    src_data_block->get_nz(), src_data_block->get_data_type() );
+  if ( !dst_data_block ) return false;
+
+  NeighborhoodFilterInfo info;
+  SetupNeighborhoodFilterInfo( src_data_block, radius, abort_function, progress_function, 
+    info );
+  if ( num_threads < 0 && src_data_block->get_size() < NEIGHBORHOOD_PARALLEL_SIZE_C ) 
+  {
+    num_threads = 1;
+  }
+
+  switch ( src_data_block->get_data_type() )
+  {
+    case DataType::CHAR_E:
+      RunMedianFilter< signed char >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::UCHAR_E:
+      RunMedianFilter< unsigned char >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::SHORT_E:
+      RunMedianFilter< short >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::USHORT_E:
+      RunMedianFilter< unsigned short >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    default:
+      break;
+  }
+
+  if ( info.check_abort() )
+  {
+    dst_data_block.reset();
+    return false;
+  }
+  return true;
+}
+
+size_t DataBlockFilter::GetMedianFilterMemory( size_t nx )
+{
+  // The column histograms of the largest number of bits that uses them, or the sliding
+  // histogram of 16 bit data, whichever is larger
+  size_t column_bins = ( size_t( 1 ) << MEDIAN_COLUMN_MAX_BITS_C ) + 
+    ( size_t( 1 ) << ( MEDIAN_COLUMN_MAX_BITS_C - MEDIAN_COLUMN_MAX_BITS_C / 2 ) );
+  size_t column_memory = ( nx + 1 ) * column_bins * sizeof( unsigned int ) +
+    ( size_t( 1 ) << ( MEDIAN_COLUMN_MAX_BITS_C - MEDIAN_COLUMN_MAX_BITS_C / 2 ) ) * 
+    sizeof( index_type );
+  size_t sliding_memory = ( ( size_t( 1 ) << 16 ) + ( size_t( 1 ) << 8 ) ) * 
+    sizeof( unsigned int );
+  return Max( column_memory, sliding_memory );
+}
+
+bool DataBlockFilter::MeanFilter( const DataBlockHandle& src_data_block, 
+  DataBlockHandle& dst_data_block, int radius, const abort_function_type& abort_function,
+  const progress_function_type& progress_function, int num_threads )
+{
+  dst_data_block.reset();
+  if ( !src_data_block || radius < 0 ) return false;
+  if ( src_data_block->get_size() == 0 ) return false;
+
+  DataBlock::shared_lock_type lock( src_data_block->get_mutex() );
+
+  dst_data_block = StdDataBlock::New( src_data_block->get_nx(), src_data_block->get_ny(),
+    src_data_block->get_nz(), DataType::FLOAT_E );
+  if ( !dst_data_block ) return false;
+
+  NeighborhoodFilterInfo info;
+  SetupNeighborhoodFilterInfo( src_data_block, radius, abort_function, progress_function, 
+    info );
+  if ( num_threads < 0 && src_data_block->get_size() < NEIGHBORHOOD_PARALLEL_SIZE_C ) 
+  {
+    num_threads = 1;
+  }
+
+  switch ( src_data_block->get_data_type() )
+  {
+    case DataType::CHAR_E:
+      RunMeanFilter< signed char >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::UCHAR_E:
+      RunMeanFilter< unsigned char >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::SHORT_E:
+      RunMeanFilter< short >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::USHORT_E:
+      RunMeanFilter< unsigned short >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::INT_E:
+      RunMeanFilter< int >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::UINT_E:
+      RunMeanFilter< unsigned int >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::FLOAT_E:
+      RunMeanFilter< float >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    case DataType::DOUBLE_E:
+      RunMeanFilter< double >( src_data_block, dst_data_block, info, num_threads );
+      break;
+    default:
+      dst_data_block.reset();
+      return false;
+  }
+
+  if ( info.check_abort() )
+  {
+    dst_data_block.reset();
+    return false;
+  }
+  return true;
+}
+
+static bool RunGaussianFilter( const DataBlockHandle& src_data_block, 
+  DataBlockHandle& dst_data_block, double sigma, bool allow_recursive, 
+  const DataBlockFilter::abort_function_type& abort_function,
+  const DataBlockFilter::progress_function_type& progress_function, int num_threads )
+{
+  dst_data_block.reset();
+  if ( !src_data_block || sigma < 0.0 ) return false;
+  if ( src_data_block->get_size() == 0 ) return false;
+
+  DataBlock::shared_lock_type lock( src_data_block->get_mutex() );
+
+  dst_data_block = StdDataBlock::New( src_data_block->get_nx(), src_data_block->get_ny(),
+    src_data_block->get_nz(), DataType::FLOAT_E );
+  if ( !dst_data_block ) return false;
+
+  if ( num_threads < 0 && src_data_block->get_size() < NEIGHBORHOOD_PARALLEL_SIZE_C ) 
+  {
+    num_threads = 1;
+  }
+
+  switch ( src_data_block->get_data_type() )
+  {
+    case DataType::CHAR_E:
+      RunConvertToFloat< signed char >( src_data_block, dst_data_block, num_threads );
+      break;
+    case DataType::UCHAR_E:
+      RunConvertToFloat< unsigned char >( src_data_block, dst_data_block, num_threads );
+      break;
+    case DataType::SHORT_E:
+      RunConvertToFloat< short >( src_data_block, dst_data_block, num_threads );
+      break;
+    case DataType::USHORT_E:
+      RunConvertToFloat< unsigned short >( src_data_block, dst_data_block, num_threads );
+      break;
+    case DataType::INT_E:
+      RunConvertToFloat< int >( src_data_block, dst_data_block, num_threads );
+      break;
+    case DataType::UINT_E:
+      RunConvertToFloat< unsigned int >( src_data_block, dst_data_block, num_threads );
+      break;
+    case DataType::FLOAT_E:
+      RunConvertToFloat< float >( src_data_block, dst_data_block, num_threads );
+      break;
+    case DataType::DOUBLE_E:
+      RunConvertToFloat< double >( src_data_block, dst_data_block, num_threads );
+      break;
+    default:
+      dst_data_block.reset();
+      return false;
+  }
+  lock.unlock();
+
+  if ( sigma == 0.0 ) return true;
+
+  GaussianFilterInfo info;
+  SetupNeighborhoodFilterInfo( dst_data_block, 0, abort_function, progress_function, info );
+  info.setup( sigma, allow_recursive );
+
+  Parallel parallel( boost::bind( &GaussianFilterParallel, 
+    reinterpret_cast< float* >( dst_data_block->get_data() ), boost::cref( info ), 
+    _1, _2, _3 ), num_threads );
+  parallel.run();
+
+  if ( info.check_abort() )
+  {
+    dst_data_block.reset();
+    return false;
+  }
+  return true;
+}
+
+bool DataBlockFilter::GaussianFilter( const DataBlockHandle& src_data_block, 
+  DataBlockHandle& dst_data_block, double sigma, const abort_function_type& abort_function,
+  const progress_function_type& progress_function, int num_threads )
+{
+  return RunGaussianFilter( src_data_block, dst_data_block, sigma, true, abort_function,
+    progress_function, num_threads );
+}
+
+bool DataBlockFilter::GaussianKernelFilter( const DataBlockHandle& src_data_block, 
+  DataBlockHandle& dst_data_block, double sigma, const abort_function_type& abort_function,
+  const progress_function_type& progress_function, int num_threads )
+{
+  return RunGaussianFilter( src_data_block, dst_data_block, sigma, false, abort_function,
+    progress_function, num_threads );
+}
+
+int DataBlockFilter::GetGaussianKernelRadius( double sigma )
+{
+  return static_cast< int >( std::ceil( GAUSSIAN_KERNEL_WIDTH_C * sigma ) );
+}
+
+bool DataBlockFilter::DistanceFilter( const MaskDataBlockHandle& mask_data_block, 
+  DataBlockHandle& dst_data_block, const Vector& spacing, bool signed_distance, 
+  bool inside_positive, const abort_function_type& abort_function,
+  const progress_function_type& progress_function )
+{
+  dst_data_block.reset();
+  if ( !mask_data_block || mask_data_block->get_size() == 0 ) return false;
+  if ( spacing.x() <= 0.0 || spacing.y() <= 0.0 || spacing.z() <= 0.0 ) return false;
+
+  MaskDataBlock::shared_lock_type lock( mask_data_block->get_mutex() );
+
+  dst_data_block = StdDataBlock::New( mask_data_block->get_nx(), mask_data_block->get_ny(),
+    mask_data_block->get_nz(), DataType::FLOAT_E );
+  if ( !dst_data_block ) return false;
+
+  DistanceFilterInfo info;
+  SetupNeighborhoodFilterInfo( dst_data_block, 0, abort_function, progress_function, info );
+  info.spacing_[ 0 ] = spacing.x();
+  info.spacing_[ 1 ] = spacing.y();
+  info.spacing_[ 2 ] = spacing.z();
+  info.mask_value_ = mask_data_block->get_mask_value();
+  info.signed_distance_ = signed_distance;
+  info.inside_positive_ = inside_positive;
+
+  int num_threads = mask_data_block->get_size() < NEIGHBORHOOD_PARALLEL_SIZE_C ? 1 : -1;
+  Parallel parallel( boost::bind( &DistanceFilterParallel, 
+    mask_data_block->get_mask_data(), reinterpret_cast< float* >( dst_data_block->get_data() ), 
+    boost::cref( info ), _1, _2, _3 ), num_threads );
+  parallel.run();
+
+  if ( info.check_abort() )
+  {
+    dst_data_block.reset();
+    return false;
+  }
+  return true;
+}
+
+bool DataBlockFilter::ThresholdFilter( const DataBlockHandle& src_data_block, 
+  const std::vector< double >& lower, const std::vector< double >& upper,
+  const std::vector< MaskDataBlockHandle >& masks, const abort_function_type& abort_function,
+  const progress_function_type& progress_function )
+{
+  if ( !src_data_block || src_data_block->get_size() == 0 ) return false;
+  if ( masks.empty() || lower.size() != masks.size() || upper.size() != masks.size() ) 
+  {
+    return false;
+  }
+
+  // Masks that share a data block share its mutex, so each data block is locked once. They
+  // are locked in order of their address so two filters cannot lock them in reverse order.
+  std::vector< DataBlock* > mask_data_blocks;
+  for ( size_t k = 0; k < masks.size(); k++ )
+  {
+    if ( !masks[ k ] || masks[ k ]->get_nx() != src_data_block->get_nx() ||
+      masks[ k ]->get_ny() != src_data_block->get_ny() || 
+      masks[ k ]->get_nz() != src_data_block->get_nz() )
+    {
+      return false;
+    }
+    mask_data_blocks.push_back( masks[ k ]->get_data_block().get() );
+  }
+  std::sort( mask_data_blocks.begin(), mask_data_blocks.end() );
+  mask_data_blocks.erase( std::unique( mask_data_blocks.begin(), mask_data_blocks.end() ), 
+    mask_data_blocks.end() );
+
+  DataBlock::shared_lock_type lock( src_data_block->get_mutex() );
+  std::vector< boost::shared_ptr< DataBlock::lock_type > > mask_locks;
+  for ( size_t k = 0; k < mask_data_blocks.size(); k++ )
+  {
+    mask_locks.push_back( boost::shared_ptr< DataBlock::lock_type >( 
+      new DataBlock::lock_type( mask_data_blocks[ k ]->get_mutex() ) ) );
+  }
+
+  NeighborhoodFilterInfo info;
+  SetupNeighborhoodFilterInfo( src_data_block, 0, abort_function, progress_function, info );
+
+  switch ( src_data_block->get_data_type() )
+  {
+    case DataType::CHAR_E:
+      RunThresholdFilter< signed char >( src_data_block, lower, upper, masks, info );
+      break;
+    case DataType::UCHAR_E:
+      RunThresholdFilter< unsigned char >( src_data_block, lower, upper, masks, info );
+      break;
+    case DataType::SHORT_E:
+      RunThresholdFilter< short >( src_data_block, lower, upper, masks, info );
+      break;
+    case DataType::USHORT_E:
+      RunThresholdFilter< unsigned short >( src_data_block, lower, upper, masks, info );
+      break;
+    case DataType::INT_E:
+      RunThresholdFilter< int >( src_data_block, lower, upper, masks, info );
+      break;
+    case DataType::UINT_E:
+      RunThresholdFilter< unsigned int >( src_data_block, lower, upper, masks, info );
+      break;
+    case DataType::FLOAT_E:
+      RunThresholdFilter< float >( src_data_block, lower, upper, masks, info );
+      break;
+    case DataType::DOUBLE_E:
+      RunThresholdFilter< double >( src_data_block, lower, upper, masks, info );
+      break;
+    default:
+      return false;
+  }
+
+  return !info.check_abort();
+}
+
+bool DataBlockFilter::OtsuThresholds( const Histogram& histogram, int num_thresholds,
+  std::vector< double >& thresholds )
+{
+  thresholds.clear();
+  if ( !histogram.is_valid() || num_thresholds < 1 ) return false;
+
+  const std::vector< size_t >& bins = histogram.get_bins();
+  const size_t num_bins = bins.size();
+  const size_t num_classes = static_cast< size_t >( num_thresholds ) + 1;
+  if ( num_bins < num_classes ) return false;
+
+  // Cumulative weight and first moment of the bins, so the contribution of any range of bins
+  // can be computed in constant time
+  std::vector< double > weight( num_bins + 1, 0.0 );
+  std::vector< double > moment( num_bins + 1, 0.0 );
+  for ( size_t j = 0; j < num_bins; j++ )
+  {
+    double value = histogram.get_bin_start( j ) + 0.5 * histogram.get_bin_size();
+    weight[ j + 1 ] = weight[ j ] + static_cast< double >( bins[ j ] );
+    moment[ j + 1 ] = moment[ j ] + static_cast< double >( bins[ j ] ) * value;
+  }
+
+  // NOTE: The variance between the classes equals the sum of moment^2 / weight over the 
+  // classes minus a constant, which is a sum over contiguous ranges of bins. Hence the best
+  // split into k classes of the first j bins extends the best split into k - 1 classes of 
+  // fewer bins.
+  std::vector< double > best( ( num_bins + 1 ) * num_classes, 
+    -std::numeric_limits< double >::max() );
+  std::vector< size_t > split( ( num_bins + 1 ) * num_classes, 0 );
+
+  for ( size_t j = 1; j <= num_bins; j++ )
+  {
+    best[ j ] = weight[ j ] > 0.0 ? moment[ j ] * moment[ j ] / weight[ j ] : 0.0;
+  }
+
+  for ( size_t k = 1; k < num_classes; k++ )
+  {
+    for ( size_t j = k + 1; j <= num_bins; j++ )
+    {
+      for ( size_t i = k; i < j; i++ )
+      {
+        double w = weight[ j ] - weight[ i ];
+        double m = moment[ j ] - moment[ i ];
+        double variance = best[ ( k - 1 ) * ( num_bins + 1 ) + i ] + 
+          ( w > 0.0 ? m * m / w : 0.0 );
+        if ( variance > best[ k * ( num_bins + 1 ) + j ] )
+        {
+          best[ k * ( num_bins + 1 ) + j ] = variance;
+          split[ k * ( num_bins + 1 ) + j ] = i;
+        }
+      }
+    }
+  }
+
+  thresholds.resize( num_thresholds );
+  size_t j = num_bins;
+  for ( size_t k = num_classes - 1; k > 0; k-- )
+  {
+    j = split[ k * ( num_bins + 1 ) + j ];
+    thresholds[ k - 1 ] = histogram.get_bin_start( j );
+  }
+
+  return true;
+}
+
+bool DataBlockFilter::ResampleFilter( const DataBlockHandle& src_data_block, 
+  DataBlockHandle& dst_data_block, const NrrdResampleContext* resample_context,
+  const NrrdKernelSpec* kernel_spec, bool pad, double pad_value, 
+  const abort_function_type& abort_function, const progress_function_type& progress_function )
+{
+  dst_data_block.reset();
+  if ( !src_data_block || !resample_context || !kernel_spec ) return false;
+  if ( src_data_block->get_size() == 0 ) return false;
+
+  ResampleFilterInfo info;
+  SetupNeighborhoodFilterInfo( src_data_block, 0, abort_function, progress_function, info );
+  info.pad_value_ = static_cast< float >( pad_value );
+  for ( int axis = 0; axis < 3; ++axis )
+  {
+    if ( resample_context->axis[ axis ].sizeIn != static_cast< size_t >( info.n_[ axis ] ) ||
+      resample_context->axis[ axis ].samples == 0 )
+    {
+      return false;
+    }
+    ComputeResampleAxisTable( resample_context->axis[ axis ], kernel_spec, pad, 
+      info.tables_[ axis ] );
+  }
+
+  DataBlock::shared_lock_type lock( src_data_block->get_mutex() );
+
+  bool success = false;
+  switch ( src_data_block->get_data_type() )
+  {
+    case DataType::CHAR_E:
+      success = RunResampleFilter< signed char >( src_data_block, dst_data_block, info );
+      break;
+    case DataType::UCHAR_E:
+      success = RunResampleFilter< unsigned char >( src_data_block, dst_data_block, info );
+      break;
+    case DataType::SHORT_E:
+      success = RunResampleFilter< short >( src_data_block, dst_data_block, info );
+      break;
+    case DataType::USHORT_E:
+      success = RunResampleFilter< unsigned short >( src_data_block, dst_data_block, info );
+      break;
+    case DataType::INT_E:
+      success = RunResampleFilter< int >( src_data_block, dst_data_block, info );
+      break;
+    case DataType::UINT_E:
+      success = RunResampleFilter< unsigned int >( src_data_block, dst_data_block, info );
+      break;
+    case DataType::LONGLONG_E:
+      success = RunResampleFilter< long long >( src_data_block, dst_data_block, info );
+      break;
+    case DataType::ULONGLONG_E:
+      success = RunResampleFilter< unsigned long long >( src_data_block, dst_data_block, 
+        info );
+      break;
+    case DataType::FLOAT_E:
+      success = RunResampleFilter< float >( src_data_block, dst_data_block, info );
+      break;
+    case DataType::DOUBLE_E:
+      success = RunResampleFilter< double >( src_data_block, dst_data_block, info );
+      break;
+    default:
+      break;
+  }
+
+  if ( !success || info.check_abort() )
+  {
+    dst_data_block.reset();
+    return false;
+  }
+  return true;
+}
+
+} // end namespace Core
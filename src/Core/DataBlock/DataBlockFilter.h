@@ -0,0 +1,176 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_DATABLOCKFILTER_H
+#define CORE_DATABLOCK_DATABLOCKFILTER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <vector>
+
+// Teem includes
+#include <teem/nrrd.h>
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+// Core includes
+#include <Core/Geometry/Vector.h>
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/Histogram.h>
+#include <Core/DataBlock/MaskDataBlock.h>
+
+namespace Core
+{
+
+// CLASS DataBlockFilter:
+/// Native implementations of neighborhood filters that work directly on data blocks. The
+/// filters split the volume into slabs that are processed in parallel. The boundary is
+/// handled by repeating the voxels on the edge of the volume, as ITK does by default.
+class DataBlockFilter : public boost::noncopyable
+{
+public:
+  /// Function that is polled to check whether the filter needs to be aborted
+  typedef boost::function< bool () > abort_function_type;
+
+  /// Function that is called with the fraction of the volume that has been processed
+  typedef boost::function< void ( double ) > progress_function_type;
+
+  // ISMEDIANFILTERSUPPORTED:
+  /// Whether MedianFilter supports the data type, which is the case for 8 and 16 bit data.
+  static bool IsMedianFilterSupported( DataType data_type );
+
+  // MEDIANFILTER:
+  /// Median over a box of ( 2 * radius + 1 )^3 voxels. The destination has the data type of
+  /// the source. Data whose values span at most 12 bits, which includes all 8 bit data, uses
+  /// a histogram per column of the box, which costs O(radius) per voxel and nx * 16kB per 
+  /// thread for 12 bits; the number of threads is reduced to keep this within 256MB. Other
+  /// 16 bit data uses a single sliding histogram, which costs O(radius^2) per voxel.
+  /// The neighborhood filters use num_threads threads, or pick a number themselves if it is
+  /// negative; callers that already filter several volumes at once should pass one.
+  static bool MedianFilter( const DataBlockHandle& src_data_block, 
+    DataBlockHandle& dst_data_block, int radius, 
+    const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type(),
+    int num_threads = -1 );
+
+  // GETMEDIANFILTERMEMORY:
+  /// The largest amount of memory that each thread of MedianFilter uses for its histograms,
+  /// in addition to the source and destination, for a volume that is nx voxels wide.
+  static size_t GetMedianFilterMemory( size_t nx );
+
+  // MEANFILTER:
+  /// Mean over a box of ( 2 * radius + 1 )^3 voxels. The destination is of type float. The
+  /// mean is computed as three passes of running sums, one along each axis, so the cost does
+  /// not depend on the radius.
+  static bool MeanFilter( const DataBlockHandle& src_data_block, 
+    DataBlockHandle& dst_data_block, int radius, 
+    const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type(),
+    int num_threads = -1 );
+
+  // GAUSSIANFILTER:
+  /// Gaussian smoothing with a standard deviation of sigma voxels. The destination is of type
+  /// float and is smoothed in place, one axis at a time. Small sigmas use an explicit
+  /// convolution, larger sigmas the recursive filter of Young and van Vliet whose cost does
+  /// not depend on sigma.
+  static bool GaussianFilter( const DataBlockHandle& src_data_block, 
+    DataBlockHandle& dst_data_block, double sigma, 
+    const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type(),
+    int num_threads = -1 );
+
+  // GAUSSIANKERNELFILTER:
+  /// Gaussian smoothing that always uses the explicit convolution, so each voxel of the 
+  /// result only depends on the voxels within GetGaussianKernelRadius( sigma ) of it. This
+  /// allows a volume to be smoothed in parts that give the same result as smoothing it at
+  /// once, at a cost that grows linearly with sigma.
+  static bool GaussianKernelFilter( const DataBlockHandle& src_data_block, 
+    DataBlockHandle& dst_data_block, double sigma, 
+    const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type(),
+    int num_threads = -1 );
+
+  // GETGAUSSIANKERNELRADIUS:
+  /// The size of the explicit Gaussian kernel on each side of its center.
+  static int GetGaussianKernelRadius( double sigma );
+
+  // DISTANCEFILTER:
+  /// Exact Euclidean distance transform of a mask, with the given spacing between voxels. 
+  /// The destination is of type float. The unsigned distance is the distance to the nearest 
+  /// voxel inside the mask. The signed distance is the distance to the nearest voxel on the
+  /// boundary of the mask, which is negative inside the mask unless inside_positive is set.
+  /// The transform is computed with the separable linear time algorithm of Felzenszwalb and
+  /// Huttenlocher, directly on the bit plane of the mask.
+  static bool DistanceFilter( const MaskDataBlockHandle& mask_data_block, 
+    DataBlockHandle& dst_data_block, const Vector& spacing, bool signed_distance, 
+    bool inside_positive, 
+    const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type() );
+
+  // THRESHOLDFILTER:
+  /// Set the bit of each mask for the voxels within its range [lower, upper] and clear it 
+  /// everywhere else. The masks need to have the size of the source. All the masks are 
+  /// written in a single pass over the data, directly into their bit planes. The ranges are
+  /// converted to the data type first, so the comparisons are done in that type.
+  static bool ThresholdFilter( const DataBlockHandle& src_data_block, 
+    const std::vector< double >& lower, const std::vector< double >& upper,
+    const std::vector< MaskDataBlockHandle >& masks,
+    const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type() );
+
+  // RESAMPLEFILTER:
+  /// Resample the data onto the output grid of a teem resample context, which needs to have
+  /// been set up for a volume of the size of the source, with the given kernel. The result
+  /// matches nrrdResampleExecute with the default rounding, clamping and renormalization, and
+  /// has the data type of the source. Samples outside of the source take pad_value if pad
+  /// is set, otherwise the nearest sample on the boundary. The volume is resampled separably:
+  /// the x and y axes slice by slice into a float volume of nx_out * ny_out * nz_in voxels,
+  /// and the z axis from there into the destination. This float volume is the only full 
+  /// scratch volume; in addition each thread uses a slice of nx_out * ny_in floats.
+  static bool ResampleFilter( const DataBlockHandle& src_data_block, 
+    DataBlockHandle& dst_data_block, const NrrdResampleContext* resample_context,
+    const NrrdKernelSpec* kernel_spec, bool pad, double pad_value,
+    const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type() );
+
+  // OTSUTHRESHOLDS:
+  /// Thresholds that split the histogram into num_thresholds + 1 classes with the largest
+  /// variance between the classes. The thresholds are on the boundaries of the bins and are
+  /// found with dynamic programming over the bins, rather than with another pass over the data.
+  static bool OtsuThresholds( const Histogram& histogram, int num_thresholds,
+    std::vector< double >& thresholds );
+};
+
+} // end namespace Core
+
+#endif
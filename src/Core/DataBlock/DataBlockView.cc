@@ -0,0 +1,311 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <cstdlib>
+
+// Boost includes
+#include <boost/thread/mutex.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlockView.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Utils/Log.h>
+
+namespace Core
+{
+
+class DataBlockViewPrivate : public boost::noncopyable
+{
+public:
+  // Data block the view refers to, this is reset once the view is materialized
+  DataBlockHandle parent_;
+
+  // Axes and region of the parent described by the view
+  std::vector<int> permutation_;
+  std::vector<size_t> offset_;
+
+  // Data block that owns the data once the view is materialized
+  DataBlockHandle data_block_;
+
+  // Grid transform of the view
+  GridTransform grid_transform_;
+
+  // Mutex protecting the materialization
+  boost::mutex mutex_;
+
+  // MATERIALIZE:
+  // Copy the data out of the parent. The mutex needs to be locked.
+  bool materialize( DataBlockView* view );
+};
+
+bool DataBlockViewPrivate::materialize( DataBlockView* view )
+{
+  if ( this->data_block_ ) return true;
+
+  DataBlockHandle data_block = StdDataBlock::New( view->get_nx(), view->get_ny(), 
+    view->get_nz(), view->get_data_type() );
+  if ( !data_block || !data_block->get_data() ) return false;
+
+  if ( !DataBlock::PermuteRegion( this->parent_, data_block, this->permutation_, 
+    this->offset_ ) )
+  {
+    return false;
+  }
+
+  this->data_block_ = data_block;
+
+  // The view no longer needs the parent
+  this->parent_.reset();
+  return true;
+}
+
+DataBlockView::DataBlockView( const DataBlockHandle& parent, 
+  const std::vector<int>& permutation, const std::vector<size_t>& offset, 
+  const std::vector<size_t>& size, const GridTransform& grid_transform ) :
+  private_( new DataBlockViewPrivate )
+{
+  this->private_->parent_ = parent;
+  this->private_->permutation_ = permutation;
+  this->private_->offset_ = offset;
+  this->private_->grid_transform_ = grid_transform;
+
+  // NOTE: The data pointer of the base class is never set, all access goes through
+  // get_deferred_data, which locks the view while the data is copied.
+  set_deferred_data();
+
+  set_nx( size[ 0 ] );
+  set_ny( size[ 1 ] );
+  set_nz( size[ 2 ] );
+  set_type( parent->get_data_type() );
+}
+
+DataBlockView::~DataBlockView()
+{
+}
+
+bool DataBlockView::is_materialized() const
+{
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  return this->private_->data_block_.get() != 0;
+}
+
+bool DataBlockView::materialize()
+{
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  return this->private_->materialize( this );
+}
+
+const GridTransform& DataBlockView::get_grid_transform() const
+{
+  return this->private_->grid_transform_;
+}
+
+void* DataBlockView::get_deferred_data()
+{
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  if ( !this->private_->materialize( this ) )
+  {
+    CORE_LOG_ERROR( "Could not allocate enough memory for the data of a data block view." );
+    return 0;
+  }
+  return this->private_->data_block_->get_data();
+}
+
+DataBlockViewHandle DataBlockView::New( const DataBlockHandle& parent, 
+  const GridTransform& parent_transform, const std::vector<int>& permutation, 
+  const std::vector<size_t>& offset, const std::vector<size_t>& size )
+{
+  if ( !parent || permutation.size() != 3 || offset.size() != 3 || size.size() != 3 )
+  {
+    return DataBlockViewHandle();
+  }
+
+  size_t parent_size[ 3 ];
+  parent_size[ 0 ] = parent->get_nx();
+  parent_size[ 1 ] = parent->get_ny();
+  parent_size[ 2 ] = parent->get_nz();
+
+  // Validate the permutation and the region in the coordinates of the parent
+  bool used_axis[ 3 ] = { false, false, false };
+  bool full_size = true;
+  for ( size_t j = 0; j < 3; j++ )
+  {
+    int axis = std::abs( permutation[ j ] ) - 1;
+    if ( axis < 0 || axis > 2 || used_axis[ axis ] ) return DataBlockViewHandle();
+    used_axis[ axis ] = true;
+    
+    if ( size[ j ] == 0 || offset[ axis ] + size[ j ] > parent_size[ axis ] )
+    {
+      return DataBlockViewHandle();
+    }
+    if ( size[ j ] != parent_size[ axis ] ) full_size = false;
+  }
+
+  DataBlockHandle root = parent;
+  std::vector<int> root_permutation = permutation;
+  std::vector<size_t> root_offset = offset;
+
+  // NOTE: A view of a view that has not been copied yet is expressed directly in terms of
+  // the data that the parent view refers to.
+  DataBlockView* parent_view = dynamic_cast< DataBlockView* >( parent.get() );
+  if ( parent_view )
+  {
+    boost::mutex::scoped_lock lock( parent_view->private_->mutex_ );
+    if ( !parent_view->private_->data_block_ )
+    {
+      const std::vector<int>& parent_permutation = parent_view->private_->permutation_;
+      const std::vector<size_t>& parent_offset = parent_view->private_->offset_;
+
+      for ( size_t j = 0; j < 3; j++ )
+      {
+        int axis = std::abs( permutation[ j ] ) - 1;
+        int root_axis = std::abs( parent_permutation[ axis ] ) - 1;
+        int sign = ( permutation[ j ] > 0 ) == ( parent_permutation[ axis ] > 0 ) ? 1 : -1;
+
+        root_permutation[ j ] = sign * ( root_axis + 1 );
+        if ( parent_permutation[ axis ] > 0 )
+        {
+          root_offset[ root_axis ] = parent_offset[ root_axis ] + offset[ axis ];
+        }
+        else
+        {
+          root_offset[ root_axis ] = parent_offset[ root_axis ] + parent_size[ axis ] - 
+            offset[ axis ] - size[ j ];
+        }
+      }
+      root = parent_view->private_->parent_;
+    }
+  }
+
+  DataBlockViewHandle view;
+  try
+  {
+    view = DataBlockViewHandle( new DataBlockView( root, root_permutation, 
+      root_offset, size, ComputeGridTransform( parent_transform, permutation, 
+      offset, size ) ) );
+  }
+  catch ( ... )
+  {
+    return DataBlockViewHandle();
+  }
+
+  // Reordering the data does not change its histogram
+  if ( full_size && parent->get_histogram().is_valid() )
+  {
+    view->set_histogram( parent->get_histogram() );
+  }
+  
+  return view;
+}
+
+DataBlockViewHandle DataBlockView::NewCrop( const DataBlockHandle& parent, 
+  const GridTransform& parent_transform, const std::vector<size_t>& offset, 
+  const std::vector<size_t>& size )
+{
+  std::vector<int> permutation( 3 );
+  permutation[ 0 ] = 1;
+  permutation[ 1 ] = 2;
+  permutation[ 2 ] = 3;
+  return New( parent, parent_transform, permutation, offset, size );
+}
+
+DataBlockViewHandle DataBlockView::NewPermutation( const DataBlockHandle& parent, 
+  const GridTransform& parent_transform, const std::vector<int>& permutation )
+{
+  if ( !parent || permutation.size() != 3 ) return DataBlockViewHandle();
+
+  std::vector<size_t> size( 3, 0 );
+  for ( size_t j = 0; j < 3; j++ )
+  {
+    switch ( std::abs( permutation[ j ] ) )
+    {
+      case 1: size[ j ] = parent->get_nx(); break;
+      case 2: size[ j ] = parent->get_ny(); break;
+      case 3: size[ j ] = parent->get_nz(); break;
+      default: return DataBlockViewHandle();
+    }
+  }
+  return New( parent, parent_transform, permutation, std::vector<size_t>( 3, 0 ), size );
+}
+
+GridTransform DataBlockView::ComputeGridTransform( const GridTransform& parent_transform,
+  const std::vector<int>& permutation, const std::vector<size_t>& offset, 
+  const std::vector<size_t>& size )
+{
+  // Size of the cropped region along the axes of the parent
+  size_t region_size[ 3 ];
+  bool reordered = false;
+  for ( size_t j = 0; j < 3; j++ )
+  {
+    region_size[ std::abs( permutation[ j ] ) - 1 ] = size[ j ];
+    if ( permutation[ j ] != static_cast<int>( j + 1 ) ) reordered = true;
+  }
+
+  // Crop: move the origin to the first voxel of the region
+  Matrix trans = parent_transform.transform().get_matrix();
+  Point origin = parent_transform * Point( static_cast<double>( offset[ 0 ] ), 
+    static_cast<double>( offset[ 1 ] ), static_cast<double>( offset[ 2 ] ) );
+  trans( 0, 3 ) = origin[ 0 ];
+  trans( 1, 3 ) = origin[ 1 ];
+  trans( 2, 3 ) = origin[ 2 ];
+
+  GridTransform grid_transform;
+  grid_transform.load_matrix( trans );
+  grid_transform.set_nx( region_size[ 0 ] );
+  grid_transform.set_ny( region_size[ 1 ] );
+  grid_transform.set_nz( region_size[ 2 ] );
+  grid_transform.set_originally_node_centered( 
+    parent_transform.get_originally_node_centered() );
+  if ( !reordered ) return grid_transform;
+
+  // Reorder: keep the center of the region and swap the spacing along with the axes
+  Point region_max = grid_transform * Point( static_cast<double>( region_size[ 0 ] - 1 ), 
+    static_cast<double>( region_size[ 1 ] - 1 ), static_cast<double>( region_size[ 2 ] - 1 ) );
+  Point center( ( origin + region_max ) * 0.5 );
+  Vector extent = region_max - origin;
+  Vector spacing = grid_transform * Vector( 1, 1, 1 );
+
+  Point dst_origin;
+  Vector dst_spacing;
+  for ( int j = 0; j < 3; j++ )
+  {
+    int axis = std::abs( permutation[ j ] ) - 1;
+    dst_origin[ j ] = center[ j ] - extent[ axis ] * 0.5;
+    dst_spacing[ j ] = spacing[ axis ];
+  }
+
+  GridTransform permuted_transform( size[ 0 ], size[ 1 ], size[ 2 ], dst_origin, 
+    Vector( dst_spacing[ 0 ], 0, 0 ), Vector( 0, dst_spacing[ 1 ], 0 ), 
+    Vector( 0, 0, dst_spacing[ 2 ] ) );
+  permuted_transform.set_originally_node_centered( 
+    parent_transform.get_originally_node_centered() );
+  return permuted_transform;
+}
+
+} // end namespace Core
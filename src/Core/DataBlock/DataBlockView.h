@@ -0,0 +1,126 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_DATABLOCKVIEW_H
+#define CORE_DATABLOCK_DATABLOCKVIEW_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <vector>
+
+// Core includes
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/Geometry/GridTransform.h>
+
+namespace Core
+{
+
+// Forward Declaration
+class DataBlockView;
+typedef boost::shared_ptr< DataBlockView > DataBlockViewHandle;
+
+class DataBlockViewPrivate;
+typedef boost::shared_ptr< DataBlockViewPrivate > DataBlockViewPrivateHandle;
+
+// CLASS DataBlockView:
+/// A data block that describes a permuted and/or cropped region of another data block. The
+/// data is only copied when it is accessed for the first time, or when materialize is called.
+/// A view of a view that has not been materialized refers directly to the original data, so
+/// a chain of crops and permutations is copied only once.
+
+/// NOTE: The parent data block is assumed not to change while the view exists. Data layers
+/// replace their data block when their data changes, which makes this safe for layer data.
+class DataBlockView : public DataBlock
+{
+  // -- Constructor/destructor --
+private:
+  DataBlockView( const DataBlockHandle& parent, const std::vector<int>& permutation,
+    const std::vector<size_t>& offset, const std::vector<size_t>& size,
+    const GridTransform& grid_transform );
+
+public:
+  virtual ~DataBlockView();
+
+  // -- Access to the data --
+public:
+  // IS_MATERIALIZED:
+  /// Whether the data of the view has been copied out of the parent.
+  bool is_materialized() const;
+
+  // MATERIALIZE:
+  /// Copy the data out of the parent. Returns false if the memory could not be allocated.
+  bool materialize();
+
+  // GET_GRID_TRANSFORM:
+  /// The grid transform of the view, derived from the grid transform of its parent.
+  const GridTransform& get_grid_transform() const;
+
+protected:
+  // GET_DEFERRED_DATA:
+  /// Materialize the view on the first access to its data.
+  virtual void* get_deferred_data();
+
+  // -- Internal implementation of this class --
+private:
+  DataBlockViewPrivateHandle private_;
+
+public:
+  // NEW:
+  /// Create a view of the region of the parent starting at offset with the given size. The
+  /// permutation uses the convention of DataBlock::PermuteData, the size is specified along
+  /// the axes of the view. Returns an empty handle if the region is not valid.
+  static DataBlockViewHandle New( const DataBlockHandle& parent, 
+    const GridTransform& parent_transform, const std::vector<int>& permutation, 
+    const std::vector<size_t>& offset, const std::vector<size_t>& size );
+
+  // NEWCROP:
+  /// Create a view of a cropped region of the parent.
+  static DataBlockViewHandle NewCrop( const DataBlockHandle& parent, 
+    const GridTransform& parent_transform, const std::vector<size_t>& offset, 
+    const std::vector<size_t>& size );
+
+  // NEWPERMUTATION:
+  /// Create a view of the parent with its axes reordered.
+  static DataBlockViewHandle NewPermutation( const DataBlockHandle& parent, 
+    const GridTransform& parent_transform, const std::vector<int>& permutation );
+
+  // COMPUTEGRIDTRANSFORM:
+  /// Compute the grid transform of a view of a parent with the given grid transform. A crop
+  /// keeps the voxels in place. Reordered axes are aligned with the coordinate axes and 
+  /// centered on the cropped region, which is how the flip and rotate tools reorient data.
+  static GridTransform ComputeGridTransform( const GridTransform& parent_transform,
+    const std::vector<int>& permutation, const std::vector<size_t>& offset, 
+    const std::vector<size_t>& size );
+};
+
+} // end namespace Core
+
+#endif
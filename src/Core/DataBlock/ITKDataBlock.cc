@@ -101,6 +101,30 @@ DataBlockHandle ITKDataBlock::New( ITKImageDataHandle itk_data )
   }
 }
 
+DataBlockHandle ITKDataBlock::New( ITKImageDataHandle itk_data, DataType data_type )
+{
+  try
+  {
+    ITKDataBlockHandle data_block( new ITKDataBlock( itk_data ) );
+
+    // NOTE: The buffer is still owned by the itk image, which releases it with its original
+    // pixel type. Only types of the same size are allowed, so the size of the data block
+    // matches the size of the buffer that is kept alive.
+    if ( GetSizeDataType( data_type ) != GetSizeDataType( data_block->get_data_type() ) ||
+      !data_block->convert_data_type_in_place( data_type ) )
+    {
+      return DataBlockHandle();
+    }
+    return data_block;
+  }
+  catch ( ... )
+  {
+    // Return an empty handle
+    DataBlockHandle data_block;
+    return data_block;
+  }
+}
+
 DataBlockHandle ITKDataBlock::New( ITKImage2DDataHandle itk_data, SliceType slice )
 {
   try
@@ -72,6 +72,12 @@ public:
   /// Version with 2D data
   static DataBlockHandle New( ITKImage2DDataHandle itk_data, SliceType slice = SliceType::AXIAL_E );
 
+  // NEW:
+  /// Constructor of a new data block using the ITKImageData wrapper class, which reuses the
+  /// buffer of the image for data of a type with the same size as the pixel type. The
+  /// pixels are converted in place, hence the image should not be used afterwards.
+  static DataBlockHandle New( ITKImageDataHandle itk_data, DataType data_type );
+
   // -----------------------------
   // Templated versions that take in itk objects directly and wrap the ITKDataImageT<T>
   // class around it. That class is just a wrapper class exposing a different interface to
@@ -89,6 +95,19 @@ public:
     return New( itk_data );
   }
 
+  // NEW:
+  /// Constructor of a new data block using an itk image pointer, converting the pixels in
+  /// place to a type with the same size as the pixel type.
+  template< class T >
+  static DataBlockHandle New( typename itk::Image<T,3>::Pointer itk_image, DataType data_type )
+  {
+    // Create a wrapper class.
+    typename ITKImageDataT<T>::Handle itk_data = 
+      typename ITKImageDataT<T>::Handle( new ITKImageDataT<T>( itk_image) );
+    // Use the wrapper class to generate the data block.
+    return New( itk_data, data_type );
+  }
+
   // NEW:
   /// Constructor of a new data block using an itk image pointer.
   template< class T >
@@ -279,18 +279,18 @@ bool ITKImageDataT<T>::initialize( DataBlockHandle data_block, Transform transfo
   
   // Step (3) : copy the dimensions of the data block
   typename image_type::RegionType region;
-  region.SetSize( 0, data_block->get_nx() );
-  region.SetSize( 1, data_block->get_ny() );
-  region.SetSize( 2, data_block->get_nz() );
+  region.SetSize( 0, data_block_->get_nx() );
+  region.SetSize( 1, data_block_->get_ny() );
+  region.SetSize( 2, data_block_->get_nz() );
   itk_image_->SetRegions( region );
 
   // Step (4) : Wrap our data into an ITK pixel container
   typename image_type::PixelContainerPointer pixel_container = 
     image_type::PixelContainer::New();
   
-  pixel_container->SetImportPointer( reinterpret_cast<T*>( data_block->get_data() ),
+  pixel_container->SetImportPointer( reinterpret_cast<T*>( data_block_->get_data() ),
     static_cast<typename image_type::PixelContainer::ElementIdentifier >
-    ( data_block->get_size() ), false );
+    ( data_block_->get_size() ), false );
 
   itk_image_->SetPixelContainer( pixel_container );
 
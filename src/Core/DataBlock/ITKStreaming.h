@@ -0,0 +1,215 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_ITKSTREAMING_H
+#define CORE_DATABLOCK_ITKSTREAMING_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <algorithm>
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+// ITK includes
+#include <itkImageRegionConstIterator.h>
+
+// Core includes
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/ITKDataBlock.h>
+#include <Core/DataBlock/ITKImageData.h>
+
+namespace Core
+{
+
+// CLASS ITKStreaming:
+/// Runs itk filters on parts of a volume, so that itk never holds buffers for the full volume.
+class ITKStreaming : public boost::noncopyable
+{
+public:
+  /// Function that is polled to check whether the filter needs to be aborted
+  typedef boost::function< bool () > abort_function_type;
+
+  /// Function that is called with the fraction of the volume that has been processed
+  typedef boost::function< void ( double ) > progress_function_type;
+
+  // STREAMFILTER:
+  /// Run a filter in slabs of slab_size slices along the z axis and copy each slab of its
+  /// output into the destination, which needs to have the size of the output. For each slab
+  /// the filter only requests the region of its input that the slab needs, including the
+  /// halo the filter itself derives, so an input that wraps an existing buffer is read in 
+  /// place. Returns false if the filter failed or was aborted.
+  template< class FILTER >
+  static bool StreamFilter( FILTER* filter, const DataBlockHandle& dst_data_block, 
+    size_t slab_size, const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type() )
+  {
+    typedef typename FILTER::OutputImageType image_type;
+
+    try
+    {
+      typename image_type::Pointer output = filter->GetOutput();
+      output->UpdateOutputInformation();
+
+      typename image_type::RegionType region = output->GetLargestPossibleRegion();
+      size_t nx = region.GetSize( 0 );
+      size_t ny = region.GetSize( 1 );
+      size_t nz = region.GetSize( 2 );
+      size_t z_start = region.GetIndex( 2 );
+      if ( nx != dst_data_block->get_nx() || ny != dst_data_block->get_ny() || 
+        nz != dst_data_block->get_nz() || slab_size == 0 )
+      {
+        return false;
+      }
+
+      for ( size_t z = 0; z < nz; z += slab_size )
+      {
+        if ( abort_function && abort_function() ) return false;
+
+        size_t slab_nz = std::min( slab_size, nz - z );
+        region.SetIndex( 2, z_start + z );
+        region.SetSize( 2, slab_nz );
+
+        // NOTE: This follows the same steps as itk::StreamingImageFilter, but the slab is
+        // written into the data block instead of into a full size itk image.
+        output->SetRequestedRegion( region );
+        output->PropagateRequestedRegion();
+        output->UpdateOutputData();
+
+        if ( abort_function && abort_function() ) return false;
+
+        CopyRegion<image_type>( output, region, dst_data_block, z * nx * ny );
+        if ( progress_function ) progress_function( static_cast<double>( z + slab_nz ) / nz );
+      }
+    }
+    catch ( ... )
+    {
+      return false;
+    }
+
+    return true;
+  }
+
+  // RUNFILTER:
+  /// Run a filter on a data block and convert its output into a new data block of the given
+  /// type. This is used to run itk filters on the bricks of a large volume, the source is 
+  /// converted to the input pixel type of the filter if needed.
+  template< class FILTER >
+  static bool RunFilter( FILTER* filter, const DataBlockHandle& src_data_block, 
+    DataType data_type, DataBlockHandle& dst_data_block )
+  {
+    typedef typename FILTER::InputImageType::PixelType input_type;
+    typedef typename FILTER::OutputImageType::PixelType output_type;
+
+    dst_data_block.reset();
+    try
+    {
+      typename ITKImageDataT<input_type>::Handle input_image( 
+        new ITKImageDataT<input_type>( src_data_block ) );
+      if ( !input_image->get_image() ) return false;
+
+      filter->SetInput( input_image->get_image() );
+      filter->Update();
+
+      DataBlockHandle output_data_block = ITKDataBlock::New<output_type>( 
+        typename itk::Image<output_type,3>::Pointer( filter->GetOutput() ) );
+      if ( !output_data_block ) return false;
+
+      if ( output_data_block->get_data_type() == data_type )
+      {
+        dst_data_block = output_data_block;
+        return true;
+      }
+      return DataBlock::ConvertDataType( output_data_block, dst_data_block, data_type );
+    }
+    catch ( ... )
+    {
+      dst_data_block.reset();
+      return false;
+    }
+  }
+
+private:
+  // COPYREGION:
+  // Copy a region that spans full slices of an itk image into a data block, starting at
+  // the given index of the data block.
+  template< class IMAGE >
+  static void CopyRegion( IMAGE* image, const typename IMAGE::RegionType& region, 
+    const DataBlockHandle& data_block, size_t offset )
+  {
+    switch( data_block->get_data_type() )
+    {
+      case DataType::CHAR_E:
+        CopyRegionIntoArray<IMAGE, signed char>( image, region, data_block, offset );
+        break;
+      case DataType::UCHAR_E:
+        CopyRegionIntoArray<IMAGE, unsigned char>( image, region, data_block, offset );
+        break;
+      case DataType::SHORT_E:
+        CopyRegionIntoArray<IMAGE, short>( image, region, data_block, offset );
+        break;
+      case DataType::USHORT_E:
+        CopyRegionIntoArray<IMAGE, unsigned short>( image, region, data_block, offset );
+        break;
+      case DataType::INT_E:
+        CopyRegionIntoArray<IMAGE, int>( image, region, data_block, offset );
+        break;
+      case DataType::UINT_E:
+        CopyRegionIntoArray<IMAGE, unsigned int>( image, region, data_block, offset );
+        break;
+      case DataType::FLOAT_E:
+        CopyRegionIntoArray<IMAGE, float>( image, region, data_block, offset );
+        break;
+      case DataType::DOUBLE_E:
+        CopyRegionIntoArray<IMAGE, double>( image, region, data_block, offset );
+        break;
+      default:
+        break;
+    }
+  }
+
+  template< class IMAGE, class T >
+  static void CopyRegionIntoArray( IMAGE* image, const typename IMAGE::RegionType& region, 
+    const DataBlockHandle& data_block, size_t offset )
+  {
+    T* data = reinterpret_cast<T*>( data_block->get_data() ) + offset;
+    itk::ImageRegionConstIterator<IMAGE> it( image, region );
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it, ++data )
+    {
+      *data = static_cast<T>( it.Get() );
+    }
+  }
+};
+
+} // end namespace Core
+
+#endif
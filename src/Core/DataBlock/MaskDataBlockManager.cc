@@ -35,6 +35,7 @@
 
 // Boost includes
 #include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
 
 // Core includes
 #include <Core/Utils/Log.h>
@@ -81,8 +82,37 @@ public:
   // List that maintains a list of which bits are used in
   typedef std::vector< MaskDataBlockEntry > mask_list_type;
   mask_list_type mask_list_;
+
+  // Snapshot of the bitplane usage, guarded by its own mutex so readers do not wait for
+  // the manager lock while a mask is being cleared or allocated.
+  boost::mutex usage_mutex_;
+  size_t used_bitplanes_;
+  size_t total_bitplanes_;
+
+  MaskDataBlockManagerInternal() :
+    used_bitplanes_( 0 ),
+    total_bitplanes_( 0 )
+  {
+  }
+
+  // UPDATE_USAGE:
+  // Recompute the usage snapshot. The manager lock needs to be held when calling this.
+  void update_usage();
 };
 
+void MaskDataBlockManagerInternal::update_usage()
+{
+  size_t used_bitplanes = 0;
+  for ( size_t j = 0; j < this->mask_list_.size(); j++ )
+  {
+    used_bitplanes += this->mask_list_[ j ].bits_used_.count();
+  }
+
+  boost::mutex::scoped_lock lock( this->usage_mutex_ );
+  this->used_bitplanes_ = used_bitplanes;
+  this->total_bitplanes_ = 8 * this->mask_list_.size();
+}
+
 
 
 MaskDataBlockManager::MaskDataBlockManager() :
@@ -168,6 +198,7 @@ bool MaskDataBlockManager::create( GridTransform grid_transform, MaskDataBlockHa
   // Mark the bitplane as being used before returning the mask
   mask_list[ mask_entry_index ].bits_used_[ mask_bit ] = 1;
   mask_list[ mask_entry_index ].data_masks_[ mask_bit ] = mask;
+  this->private_->update_usage();
 
   return true;
 }
@@ -190,6 +221,7 @@ bool MaskDataBlockManager::create( DataBlock::generation_type generation, unsign
       mask = MaskDataBlockHandle( new MaskDataBlock( mask_list[ j ].data_block_, bit ) );
       mask_list[ j ].bits_used_[ bit ] = 1;
       mask_list[ j ].data_masks_[ bit ] = mask;
+      this->private_->update_usage();
 
       return true;
     }
@@ -218,6 +250,7 @@ void MaskDataBlockManager::release(DataBlockHandle& datablock, unsigned int mask
         DataBlockManager::Instance()->unregister_datablock( datablock->get_generation() );
         mask_list.erase( mask_list.begin() + j );
       }
+      this->private_->update_usage();
 
       break;
     }
@@ -230,12 +263,22 @@ bool MaskDataBlockManager::compact()
   return false;
 }
 
+void MaskDataBlockManager::get_bitplane_usage( size_t& used_bitplanes, size_t& total_bitplanes )
+{
+  // NOTE: Only the usage snapshot is locked, as the manager lock can be held for a long
+  // time by the threads that create masks.
+  boost::mutex::scoped_lock lock( this->private_->usage_mutex_ );
+  used_bitplanes = this->private_->used_bitplanes_;
+  total_bitplanes = this->private_->total_bitplanes_;
+}
+
 void MaskDataBlockManager::register_data_block( DataBlockHandle data_block, 
                          const GridTransform& grid_transform )
 {
   lock_type lock( get_mutex() );
 
   this->private_->mask_list_.push_back( MaskDataBlockEntry( data_block, grid_transform ) );
+  this->private_->update_usage();
 }
 
 void MaskDataBlockManager::clear()
@@ -248,6 +291,7 @@ void MaskDataBlockManager::clear()
     ++it;
   }
   this->private_->mask_list_.clear();
+  this->private_->update_usage();
 }
 
 bool MaskDataBlockManager::Create( GridTransform grid_transform, MaskDataBlockHandle& mask )
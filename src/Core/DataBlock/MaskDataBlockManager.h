@@ -97,6 +97,12 @@ public:
   /// to compact the space required.
   bool compact();
 
+  // GET_BITPLANE_USAGE:
+  /// Get the number of bitplanes that are in use and the number of bitplanes that
+  /// are available in the data blocks that are allocated for masks. This reads a snapshot
+  /// and does not wait for the manager lock.
+  void get_bitplane_usage( size_t& used_bitplanes, size_t& total_bitplanes );
+
   // -- MaskDataBlock callbacks --
 protected:
   friend class MaskDataBlock;
@@ -33,6 +33,12 @@
 #include <Core/Math/MathFunctions.h>
 #include <Core/Geometry/GridTransform.h>
 #include <Core/DataBlock/NrrdData.h>
+#include <Core/DataBlock/ParallelGzip.h>
+
+// STL includes
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 
 // Boost includes
 #include <boost/filesystem.hpp>
@@ -495,47 +501,189 @@ bool NrrdData::get_originally_node_centered() const
 }
 
 
-bool NrrdData::LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata, std::string& error )
+// Meta data keys that describe the layout of the independently compressed gzip blocks
+static const char* GZIP_BLOCK_SIZE_KEY_C = "seg3d-gzip-block-size";
+static const char* GZIP_BLOCKS_KEY_C = "seg3d-gzip-blocks";
+
+// Width of the hexadecimal entry for each compressed block size in the header
+static const size_t GZIP_BLOCK_ENTRY_WIDTH_C = 8;
+
+// GETNRRDDATASIZE:
+// Number of bytes of the data of a nrrd. This calls into Teem and needs the Teem lock.
+static size_t GetNrrdDataSize( Nrrd* nrrd )
 {
-  // Lock down the Teem library
-  lock_type lock( GetMutex() );
+  return nrrdElementNumber( nrrd ) * nrrdElementSize( nrrd );
+}
 
-  Nrrd* nrrd = nrrdNew();
-    boost::filesystem::path nrrd_path = boost::filesystem::path( filename ).parent_path();
-    std::string filename_only = boost::filesystem::path( filename ).filename().string();
-    
-    boost::system::error_code ec;
-    boost::filesystem::path current_path = boost::filesystem::current_path( ec );
-    if ( ec )
+static bool GetParallelGzipLayout( Nrrd* nrrd, size_t& block_size, 
+  std::vector< size_t >& block_sizes )
+{
+  char* block_size_value = nrrdKeyValueGet( nrrd, GZIP_BLOCK_SIZE_KEY_C );
+  char* blocks_value = nrrdKeyValueGet( nrrd, GZIP_BLOCKS_KEY_C );
+  
+  bool success = false;
+  if ( block_size_value && blocks_value && 
+    ImportFromString( block_size_value, block_size ) && block_size > 0 )
+  {
+    std::istringstream blocks_stream( blocks_value );
+    blocks_stream >> std::hex;
+    block_sizes.clear();
+    size_t compressed_size;
+    while ( blocks_stream >> compressed_size ) block_sizes.push_back( compressed_size );
+    success = blocks_stream.eof() && block_sizes.size() > 0;
+  }
+
+  if ( block_size_value ) free( block_size_value );
+  if ( blocks_value ) free( blocks_value );
+
+  return success;
+}
+
+// LOADPARALLELGZIPDATA:
+// Decompress the data of a nrrd written by the parallel gzip writer into a newly allocated
+// buffer. This does not call into Teem and hence can run without holding the Teem lock.
+static bool LoadParallelGzipData( const std::string& filename, size_t size, 
+  size_t block_size, const std::vector< size_t >& block_sizes, void*& data, std::string& error,
+  boost::function< void ( double ) > progress )
+{
+  data = 0;
+
+  // The compressed stream is located at the end of the file
+  boost::system::error_code ec;
+  size_t file_size = static_cast< size_t >( boost::filesystem::file_size( filename, ec ) );
+  size_t stream_size = ParallelGzip::GetStreamSize( block_sizes );
+  if ( ec || stream_size > file_size )
+  {
+    error = "File is truncated.";
+    return false;
+  }
+
+  data = malloc( size );
+  if ( data == 0 )
+  {
+    error = "Could not allocate enough memory.";
+    return false;
+  }
+
+  if ( !ParallelGzip::Decompress( filename, file_size - stream_size, data, size, 
+    block_size, block_sizes, error, progress ) )
+  {
+    free( data );
+    data = 0;
+    return false;
+  }
+
+  return true;
+}
+
+static bool SaveParallelGzipNrrd( const std::string& filename, Nrrd* nrrd, int level,
+  std::string& error )
+{
+  size_t size = 0;
+  {
+    NrrdData::lock_type lock( NrrdData::GetMutex() );
+    size = GetNrrdDataSize( nrrd );
+  }
+  size_t block_size = ParallelGzip::DEFAULT_BLOCK_SIZE_C;
+  size_t num_blocks = Max( static_cast< size_t >( 1 ), ( size + block_size - 1 ) / block_size );
+
+  // The compressed sizes of the blocks are only known once the data has been written. Hence
+  // a fixed width entry is reserved for each block in the header, which is filled in afterwards.
+  std::string placeholder;
+  for ( size_t j = 0; j < num_blocks; j++ )
+  {
+    if ( j ) placeholder += " ";
+    placeholder += std::string( GZIP_BLOCK_ENTRY_WIDTH_C, '0' );
+  }
+
+  {
+    // Lock down the Teem library while writing the header
+    NrrdData::lock_type lock( NrrdData::GetMutex() );
+
+    // The block layout is added to a shallow copy, so the nrrd of the caller is left untouched.
+    // The copy shares the data of the original nrrd, which is not freed by nrrdNix.
+    Nrrd* header = nrrdNew();
+    int result = nrrdBasicInfoCopy( header, nrrd, NRRD_BASIC_INFO_NONE ) ||
+      nrrdAxisInfoCopy( header, nrrd, 0, NRRD_AXIS_INFO_NONE );
+
+    if ( !result )
     {
-    error = std::string( "Could not open file: " ) + filename + " : Could not get current directory.";
-        return false;
+      nrrdKeyValueAdd( header, GZIP_BLOCK_SIZE_KEY_C, ExportToString( block_size ).c_str() );
+      nrrdKeyValueAdd( header, GZIP_BLOCKS_KEY_C, placeholder.c_str() );
+
+      NrrdIoState* nio = nrrdIoStateNew();
+      nrrdIoStateEncodingSet( nio, nrrdEncodingGzip );
+      nrrdIoStateSet( nio, nrrdIoStateZlibLevel, level );
+      nio->skipData = AIR_TRUE;
+
+      result = nrrdSave( filename.c_str(), header, nio );
+      nrrdIoStateNix( nio );
     }
-    boost::filesystem::current_path( nrrd_path, ec );
-    if ( ec )
+    nrrdNix( header );
+
+    if ( result )
     {
-    error = std::string( "Could not open file: " ) + filename + " : Could not access path.";
-        return false;
+      char *err = biffGet( NRRD );
+      error = std::string( err );
+      free( err );
+      biffDone( NRRD );
+      return false;
     }
+  }
+
+  std::fstream stream( filename.c_str(), std::ios::in | std::ios::out | std::ios::binary );
+  std::string header( ( std::istreambuf_iterator< char >( stream ) ), 
+    std::istreambuf_iterator< char >() );
+  stream.clear();
 
-  if ( nrrdLoad( nrrd, filename_only.c_str(), 0 ) )
+  std::string::size_type placeholder_pos = header.find( std::string( GZIP_BLOCKS_KEY_C ) + ":=" );
+  if ( !stream || placeholder_pos == std::string::npos )
   {
-    char *err = biffGet( NRRD );
-    error = std::string( "Could not open file: " ) + filename + " : " + std::string( err );
-    free( err );
-    biffDone( NRRD );
-    nrrdNuke( nrrd );
-    nrrddata.reset();
-        boost::filesystem::current_path( current_path, ec );
+    error = "Could not write header.";
     return false;
   }
-    boost::filesystem::current_path( current_path, ec );
+  placeholder_pos += std::string( GZIP_BLOCKS_KEY_C ).size() + 2;
+
+  // The data follows the header after an empty line
+  stream.seekp( 0, std::ios::end );
+  if ( header.size() < 2 || header.substr( header.size() - 2 ) != "\n\n" ) stream << "\n";
 
+  std::vector< size_t > block_sizes;
+  if ( !ParallelGzip::Compress( stream, nrrd->data, size, level, block_size, block_sizes, 
+    error ) )
+  {
+    return false;
+  }
+
+  std::ostringstream blocks;
+  blocks << std::hex << std::setfill( '0' );
+  for ( size_t j = 0; j < block_sizes.size(); j++ )
+  {
+    if ( j ) blocks << " ";
+    blocks << std::setw( GZIP_BLOCK_ENTRY_WIDTH_C ) << block_sizes[ j ];
+  }
+
+  stream.seekp( placeholder_pos );
+  stream << blocks.str();
+  stream.flush();
+
+  if ( !stream )
+  {
+    error = "Could not write compressed data.";
+    return false;
+  }
+  
+  return true;
+}
+
+// NORMALIZENRRDAXES:
+// Turn 2D nrrds into 3D nrrds and remove the stub axes that older versions added. This calls 
+// into Teem and needs the Teem lock.
+static bool NormalizeNrrdAxes( Nrrd* nrrd, std::string& error )
+{
   if ( nrrd->dim < 2 )
   {
     error = "Currently only 2D or 3D nrrd files are supported.";
-    nrrdNuke( nrrd );
-    nrrddata.reset();
     return false;
   }
 
@@ -611,27 +759,188 @@ bool NrrdData::LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata,
       }
     }
   }
+
+  return true;
+}
+
+bool NrrdData::LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata, std::string& error,
+  boost::function< void ( double ) > progress )
+{
+  // Lock down the Teem library
+  lock_type lock( GetMutex() );
+
+  Nrrd* nrrd = nrrdNew();
+    boost::filesystem::path nrrd_path = boost::filesystem::path( filename ).parent_path();
+    std::string filename_only = boost::filesystem::path( filename ).filename().string();
+    
+    boost::system::error_code ec;
+    boost::filesystem::path current_path = boost::filesystem::current_path( ec );
+    if ( ec )
+    {
+    error = std::string( "Could not open file: " ) + filename + " : Could not get current directory.";
+        return false;
+    }
+  std::string absolute_filename = boost::filesystem::absolute( filename, current_path ).string();
+
+    boost::filesystem::current_path( nrrd_path, ec );
+    if ( ec )
+    {
+    error = std::string( "Could not open file: " ) + filename + " : Could not access path.";
+        return false;
+    }
+
+  // Read the header first to check whether the data was written in independently compressed
+  // blocks, in which case it can be decompressed in parallel.
+  NrrdIoState* nio = nrrdIoStateNew();
+  nio->skipData = AIR_TRUE;
+  bool parallel_gzip = false;
+  int endian = airEndianUnknown;
+  size_t block_size = 0;
+  std::vector< size_t > block_sizes;
+
+  if ( nrrdLoad( nrrd, filename_only.c_str(), nio ) == 0 )
+  {
+    if ( nio->encoding == nrrdEncodingGzip )
+    {
+      parallel_gzip = GetParallelGzipLayout( nrrd, block_size, block_sizes );
+      endian = nio->endian;
+    }
+  }
+  else
+  {
+    // Any error will be reported by the full load below
+    biffDone( NRRD );
+  }
+  nrrdIoStateNix( nio );
+
+  if ( !parallel_gzip )
+  {
+    nrrdNuke( nrrd );
+    nrrd = nrrdNew();
+  }
+
+  if ( !parallel_gzip && nrrdLoad( nrrd, filename_only.c_str(), 0 ) )
+  {
+    char *err = biffGet( NRRD );
+    error = std::string( "Could not open file: " ) + filename + " : " + std::string( err );
+    free( err );
+    biffDone( NRRD );
+    nrrdNuke( nrrd );
+    nrrddata.reset();
+        boost::filesystem::current_path( current_path, ec );
+    return false;
+  }
+    boost::filesystem::current_path( current_path, ec );
+
+  nrrdKeyValueErase( nrrd, GZIP_BLOCK_SIZE_KEY_C );
+  nrrdKeyValueErase( nrrd, GZIP_BLOCKS_KEY_C );
+
+  if ( parallel_gzip )
+  {
+    // Decompressing does not involve Teem, hence other volumes can be loaded meanwhile. The
+    // Teem calls that follow need the lock again.
+    size_t size = GetNrrdDataSize( nrrd );
+    void* data = 0;
+    lock.unlock();
+    bool decompressed = LoadParallelGzipData( absolute_filename, size, block_size, 
+      block_sizes, data, error, progress );
+    lock.lock();
+
+    if ( !decompressed )
+    {
+      error = std::string( "Could not open file: " ) + filename + " : " + error;
+      nrrdNuke( nrrd );
+      nrrddata.reset();
+      return false;
+    }
+
+    nrrd->data = data;
+    if ( endian != airEndianUnknown && endian != airMyEndian() && nrrdElementSize( nrrd ) > 1 )
+    {
+      nrrdSwapEndian( nrrd );
+    }
+  }
+
+  if ( !NormalizeNrrdAxes( nrrd, error ) )
+  {
+    nrrdNuke( nrrd );
+    nrrddata.reset();
+    return false;
+  }
   
   error = "";
   nrrddata = NrrdDataHandle( new NrrdData( nrrd ) );
   return true;
 }
 
+bool NrrdData::LoadNrrdHeader( const std::string& filename, NrrdDataHandle& nrrddata, 
+  std::string& error )
+{
+  // Lock down the Teem library
+  lock_type lock( GetMutex() );
+
+  // NOTE: Only the header is read, hence the data file of a detached header is not needed and
+  // the current directory does not need to change.
+  Nrrd* nrrd = nrrdNew();
+  NrrdIoState* nio = nrrdIoStateNew();
+  nio->skipData = AIR_TRUE;
+  int result = nrrdLoad( nrrd, filename.c_str(), nio );
+  nrrdIoStateNix( nio );
+
+  if ( result )
+  {
+    char *err = biffGet( NRRD );
+    error = std::string( "Could not open file: " ) + filename + " : " + std::string( err );
+    free( err );
+    biffDone( NRRD );
+    nrrdNuke( nrrd );
+    nrrddata.reset();
+    return false;
+  }
+
+  nrrdKeyValueErase( nrrd, GZIP_BLOCK_SIZE_KEY_C );
+  nrrdKeyValueErase( nrrd, GZIP_BLOCKS_KEY_C );
+
+  if ( !NormalizeNrrdAxes( nrrd, error ) )
+  {
+    nrrdNuke( nrrd );
+    nrrddata.reset();
+    return false;
+  }
+
+  error = "";
+  nrrddata = NrrdDataHandle( new NrrdData( nrrd ) );
+  return true;
+}
+
 bool NrrdData::SaveNrrd( const std::string& filename,
                          NrrdDataHandle nrrddata,
                          std::string& error,
                          bool compress,
                          int level )
 {
-  // Lock down the Teem library
-  lock_type lock( GetMutex() );
-
   if ( ! nrrddata.get() )
   {
     error = "Error writing file: " + filename + " : no data volume available";
     return false;
   }
 
+  // Compressed data that is attached to the header is written with the parallel gzip writer
+  if ( compress && boost::filesystem::path( filename ).extension() == ".nrrd" )
+  {
+    if ( !SaveParallelGzipNrrd( filename, nrrddata->nrrd(), level, error ) )
+    {
+      error = "Error writing file: " + filename + " : " + error;
+      return false;
+    }
+
+    error = "";
+    return true;
+  }
+
+  // Lock down the Teem library
+  lock_type lock( GetMutex() );
+
   NrrdIoState* nio = nrrdIoStateNew();
 
   // Turn on compression if the user wants it.
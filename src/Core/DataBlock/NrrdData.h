@@ -37,6 +37,7 @@
 #include <teem/nrrd.h>
 
 // Boost includes
+#include <boost/function.hpp>
 #include <boost/utility.hpp>
 #include <boost/smart_ptr.hpp>
 #include <boost/thread/mutex.hpp>
@@ -150,8 +151,16 @@ private:
 public:
 
   // LOADNRRD:
-  /// Load a nrrd into the nrrd data structure
+  /// Load a nrrd into the nrrd data structure. The progress function is called while the data
+  /// of files written by the parallel gzip writer is decompressed.
   static bool LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata, 
+    std::string& error, 
+    boost::function< void ( double ) > progress = boost::function< void ( double ) >() );
+
+  // LOADNRRDHEADER:
+  /// Load only the header of a nrrd, which describes the size, type and transform of the data,
+  /// without reading its data.
+  static bool LoadNrrdHeader( const std::string& filename, NrrdDataHandle& nrrddata, 
     std::string& error );
 
   // SAVENRRD:
@@ -0,0 +1,463 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <fstream>
+#include <cstring>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+// Zlib includes
+#include <zlib.h>
+
+// Core includes
+#include <Core/Math/MathFunctions.h>
+#include <Core/Utils/Parallel.h>
+#include <Core/DataBlock/ParallelGzip.h>
+
+namespace Core
+{
+
+const size_t ParallelGzip::DEFAULT_BLOCK_SIZE_C = 4 * 1024 * 1024;
+
+// Minimal gzip header: deflate, no flags, no time stamp, unix
+static const unsigned char GZIP_HEADER_C[ 10 ] = 
+  { 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03 };
+static const size_t GZIP_HEADER_SIZE_C = 10;
+static const size_t GZIP_TRAILER_SIZE_C = 8;
+
+class ParallelGzipPrivate
+{
+public:
+  ParallelGzipPrivate() :
+    src_( 0 ),
+    dst_( 0 ),
+    size_( 0 ),
+    block_size_( ParallelGzip::DEFAULT_BLOCK_SIZE_C ),
+    num_blocks_( 0 ),
+    level_( Z_DEFAULT_COMPRESSION ),
+    block_start_( 0 ),
+    block_end_( 0 ),
+    offset_( 0 ),
+    num_decompressed_blocks_( 0 ),
+    success_( true )
+  {
+  }
+
+  // GET_BLOCK_LENGTH:
+  /// Get the number of uncompressed bytes in a block
+  size_t get_block_length( size_t block ) const;
+
+  // COMPRESS_BLOCK:
+  /// Deflate one block. All blocks but the last one end with a sync flush, so that the raw deflate
+  /// streams of all the blocks can be concatenated.
+  bool compress_block( size_t block, std::vector< unsigned char >& output );
+
+  // DECOMPRESS_BLOCK:
+  /// Inflate one block that was written by compress_block.
+  bool decompress_block( std::ifstream& stream, size_t block, std::vector< unsigned char >& input );
+
+  // PARALLEL_COMPRESS:
+  /// Compress the blocks in the current batch
+  void parallel_compress( int thread, int num_threads, boost::barrier& barrier );
+
+  // PARALLEL_DECOMPRESS:
+  /// Decompress all the blocks of the stream
+  void parallel_decompress( int thread, int num_threads, boost::barrier& barrier );
+
+  // SET_ERROR:
+  /// Record an error from one of the threads
+  void set_error( const std::string& error );
+
+  // Uncompressed data
+  const unsigned char* src_;
+  unsigned char* dst_;
+  size_t size_;
+
+  // Layout of the blocks
+  size_t block_size_;
+  size_t num_blocks_;
+  int level_;
+
+  // Range of blocks that is processed by the current call to Parallel
+  size_t block_start_;
+  size_t block_end_;
+
+  // Compressed output of the blocks in the current batch
+  std::vector< std::vector< unsigned char > > buffers_;
+
+  // Checksum of each block, these are combined into the checksum of the stream
+  std::vector< z_uLong > crcs_;
+
+  // File and offsets of the compressed blocks for decompression
+  std::string filename_;
+  size_t offset_;
+  std::vector< size_t > block_offsets_;
+  std::vector< size_t > block_sizes_;
+
+  // Progress reporting for decompression, protected by the error mutex
+  boost::function< void ( double ) > progress_;
+  size_t num_decompressed_blocks_;
+
+  // Error reporting from the threads
+  boost::mutex error_mutex_;
+  bool success_;
+  std::string error_;
+};
+
+typedef boost::shared_ptr< ParallelGzipPrivate > ParallelGzipPrivateHandle;
+
+size_t ParallelGzipPrivate::get_block_length( size_t block ) const
+{
+  size_t start = block * this->block_size_;
+  if ( start + this->block_size_ > this->size_ ) return this->size_ - start;
+  return this->block_size_;
+}
+
+bool ParallelGzipPrivate::compress_block( size_t block, std::vector< unsigned char >& output )
+{
+  size_t length = this->get_block_length( block );
+  bool last_block = ( block + 1 == this->num_blocks_ );
+
+  z_stream strm;
+  std::memset( &strm, 0, sizeof( z_stream ) );
+
+  // Negative window bits: raw deflate stream, the gzip wrapper is written separately
+  if ( deflateInit2( &strm, this->level_, Z_DEFLATED, -MAX_WBITS, 8, 
+    Z_DEFAULT_STRATEGY ) != Z_OK )
+  {
+    return false;
+  }
+
+  // Leave room for the sync flush marker
+  output.resize( z_deflateBound( &strm, static_cast< z_uLong >( length ) ) + 64 );
+
+  strm.next_in = reinterpret_cast< z_Bytef* >( 
+    const_cast< unsigned char* >( this->src_ + block * this->block_size_ ) );
+  strm.avail_in = static_cast< z_uInt >( length );
+
+  int flush = last_block ? Z_FINISH : Z_SYNC_FLUSH;
+  size_t written = 0;
+  int result = Z_OK;
+  do
+  {
+    if ( written == output.size() ) output.resize( 2 * output.size() );
+    strm.next_out = reinterpret_cast< z_Bytef* >( &output[ written ] );
+    strm.avail_out = static_cast< z_uInt >( output.size() - written );
+    result = z_deflate( &strm, flush );
+    written = output.size() - strm.avail_out;
+  }
+  while ( result == Z_OK && strm.avail_out == 0 );
+  
+  z_deflateEnd( &strm );
+  output.resize( written );
+
+  if ( last_block ) return result == Z_STREAM_END;
+  return result == Z_OK && strm.avail_in == 0;
+}
+
+bool ParallelGzipPrivate::decompress_block( std::ifstream& stream, size_t block, 
+  std::vector< unsigned char >& input )
+{
+  size_t length = this->get_block_length( block );
+  bool last_block = ( block + 1 == this->num_blocks_ );
+
+  input.resize( this->block_sizes_[ block ] );
+  stream.seekg( this->block_offsets_[ block ] );
+  if ( input.size() > 0 )
+  {
+    stream.read( reinterpret_cast< char* >( &input[ 0 ] ), input.size() );
+    if ( !stream ) return false;
+  }
+
+  z_stream strm;
+  std::memset( &strm, 0, sizeof( z_stream ) );
+  if ( inflateInit2( &strm, -MAX_WBITS ) != Z_OK ) return false;
+
+  unsigned char* dst = this->dst_ + block * this->block_size_;
+  strm.next_in = input.size() ? reinterpret_cast< z_Bytef* >( &input[ 0 ] ) : 0;
+  strm.avail_in = static_cast< z_uInt >( input.size() );
+  strm.next_out = reinterpret_cast< z_Bytef* >( dst );
+  strm.avail_out = static_cast< z_uInt >( length );
+
+  int result = z_inflate( &strm, Z_SYNC_FLUSH );
+  size_t total_out = strm.total_out;
+  z_inflateEnd( &strm );
+
+  if ( total_out != length ) return false;
+  if ( last_block && result != Z_STREAM_END ) return false;
+  if ( !last_block && result != Z_OK && result != Z_BUF_ERROR ) return false;
+
+  this->crcs_[ block ] = z_crc32( z_crc32( 0L, Z_NULL, 0 ), reinterpret_cast< z_Bytef* >( dst ), 
+    static_cast< z_uInt >( length ) );
+  return true;
+}
+
+void ParallelGzipPrivate::parallel_compress( int thread, int num_threads, boost::barrier& barrier )
+{
+  for ( size_t block = this->block_start_ + thread; block < this->block_end_; 
+    block += num_threads )
+  {
+    std::vector< unsigned char >& output = this->buffers_[ block - this->block_start_ ];
+    if ( !this->compress_block( block, output ) )
+    {
+      this->set_error( "Could not compress data." );
+      return;
+    }
+
+    this->crcs_[ block ] = z_crc32( z_crc32( 0L, Z_NULL, 0 ), 
+      reinterpret_cast< const z_Bytef* >( this->src_ + block * this->block_size_ ), 
+      static_cast< z_uInt >( this->get_block_length( block ) ) );
+  }
+}
+
+void ParallelGzipPrivate::parallel_decompress( int thread, int num_threads, 
+  boost::barrier& barrier )
+{
+  // Each thread reads its own blocks through its own file handle
+  std::ifstream stream( this->filename_.c_str(), std::ios::in | std::ios::binary );
+  if ( !stream )
+  {
+    this->set_error( "Could not open file '" + this->filename_ + "'." );
+    return;
+  }
+
+  std::vector< unsigned char > input;
+  for ( size_t block = thread; block < this->num_blocks_; block += num_threads )
+  {
+    if ( !this->decompress_block( stream, block, input ) )
+    {
+      this->set_error( "Could not decompress file '" + this->filename_ + "'." );
+      return;
+    }
+
+    if ( this->progress_ )
+    {
+      boost::mutex::scoped_lock lock( this->error_mutex_ );
+      this->num_decompressed_blocks_++;
+      this->progress_( static_cast< double >( this->num_decompressed_blocks_ ) / 
+        static_cast< double >( this->num_blocks_ ) );
+    }
+  }
+}
+
+void ParallelGzipPrivate::set_error( const std::string& error )
+{
+  boost::mutex::scoped_lock lock( this->error_mutex_ );
+  this->success_ = false;
+  this->error_ = error;
+}
+
+static void WriteLittleEndian32( unsigned char* buffer, size_t value )
+{
+  for ( size_t j = 0; j < 4; j++ )
+  {
+    buffer[ j ] = static_cast< unsigned char >( ( value >> ( 8 * j ) ) & 0xff );
+  }
+}
+
+static size_t ReadLittleEndian32( const unsigned char* buffer )
+{
+  size_t value = 0;
+  for ( size_t j = 0; j < 4; j++ )
+  {
+    value |= static_cast< size_t >( buffer[ j ] ) << ( 8 * j );
+  }
+  return value;
+}
+
+static size_t GetNumBlocks( size_t size, size_t block_size )
+{
+  // An empty stream still needs one final deflate block
+  if ( size == 0 ) return 1;
+  return ( size + block_size - 1 ) / block_size;
+}
+
+bool ParallelGzip::Compress( std::ostream& stream, const void* data, size_t size, int level,
+  size_t block_size, std::vector< size_t >& block_sizes, std::string& error )
+{
+  if ( block_size == 0 )
+  {
+    error = "Invalid compression block size.";
+    return false;
+  }
+
+  ParallelGzipPrivateHandle private_( new ParallelGzipPrivate );
+  private_->src_ = reinterpret_cast< const unsigned char* >( data );
+  private_->size_ = size;
+  private_->block_size_ = block_size;
+  private_->num_blocks_ = GetNumBlocks( size, block_size );
+  private_->level_ = level;
+  private_->crcs_.resize( private_->num_blocks_ );
+
+  block_sizes.clear();
+  block_sizes.reserve( private_->num_blocks_ );
+
+  stream.write( reinterpret_cast< const char* >( GZIP_HEADER_C ), GZIP_HEADER_SIZE_C );
+
+  // Compress a few blocks per thread at a time, so that we do not need to keep the compressed
+  // version of the full volume in memory.
+  size_t num_threads = Max( 1u, boost::thread::hardware_concurrency() );
+  size_t batch_size = 4 * num_threads;
+  z_uLong crc = z_crc32( 0L, Z_NULL, 0 );
+
+  for ( size_t batch = 0; batch < private_->num_blocks_; batch += batch_size )
+  {
+    private_->block_start_ = batch;
+    private_->block_end_ = Min( batch + batch_size, private_->num_blocks_ );
+    private_->buffers_.resize( private_->block_end_ - private_->block_start_ );
+
+    Parallel parallel_compress( boost::bind( &ParallelGzipPrivate::parallel_compress, 
+      private_, _1, _2, _3 ), static_cast< int >( num_threads ) );
+    parallel_compress.run();
+
+    if ( !private_->success_ )
+    {
+      error = private_->error_;
+      return false;
+    }
+
+    for ( size_t block = private_->block_start_; block < private_->block_end_; block++ )
+    {
+      std::vector< unsigned char >& output = private_->buffers_[ block - private_->block_start_ ];
+      if ( output.size() )
+      {
+        stream.write( reinterpret_cast< const char* >( &output[ 0 ] ), output.size() );
+      }
+      block_sizes.push_back( output.size() );
+      crc = z_crc32_combine( crc, private_->crcs_[ block ], 
+        static_cast< z_off_t >( private_->get_block_length( block ) ) );
+      std::vector< unsigned char >().swap( output );
+    }
+
+    if ( !stream )
+    {
+      error = "Could not write compressed data.";
+      return false;
+    }
+  }
+
+  unsigned char trailer[ GZIP_TRAILER_SIZE_C ];
+  WriteLittleEndian32( trailer, crc );
+  WriteLittleEndian32( trailer + 4, size & 0xffffffff );
+  stream.write( reinterpret_cast< const char* >( trailer ), GZIP_TRAILER_SIZE_C );
+
+  if ( !stream )
+  {
+    error = "Could not write compressed data.";
+    return false;
+  }
+
+  return true;
+}
+
+bool ParallelGzip::Decompress( const std::string& filename, size_t offset, void* data, 
+  size_t size, size_t block_size, const std::vector< size_t >& block_sizes, std::string& error,
+  boost::function< void ( double ) > progress )
+{
+  if ( block_size == 0 || block_sizes.size() != GetNumBlocks( size, block_size ) )
+  {
+    error = "Compressed block layout of file '" + filename + "' does not match its size.";
+    return false;
+  }
+
+  std::ifstream stream( filename.c_str(), std::ios::in | std::ios::binary );
+  unsigned char header[ GZIP_HEADER_SIZE_C ];
+  stream.seekg( offset );
+  stream.read( reinterpret_cast< char* >( header ), GZIP_HEADER_SIZE_C );
+  if ( !stream || std::memcmp( header, GZIP_HEADER_C, 4 ) != 0 )
+  {
+    error = "File '" + filename + "' does not contain a valid gzip stream.";
+    return false;
+  }
+
+  ParallelGzipPrivateHandle private_( new ParallelGzipPrivate );
+  private_->dst_ = reinterpret_cast< unsigned char* >( data );
+  private_->size_ = size;
+  private_->block_size_ = block_size;
+  private_->num_blocks_ = block_sizes.size();
+  private_->filename_ = filename;
+  private_->block_sizes_ = block_sizes;
+  private_->progress_ = progress;
+  private_->crcs_.resize( private_->num_blocks_ );
+
+  size_t block_offset = offset + GZIP_HEADER_SIZE_C;
+  private_->block_offsets_.resize( private_->num_blocks_ );
+  for ( size_t block = 0; block < private_->num_blocks_; block++ )
+  {
+    private_->block_offsets_[ block ] = block_offset;
+    block_offset += block_sizes[ block ];
+  }
+
+  Parallel parallel_decompress( boost::bind( &ParallelGzipPrivate::parallel_decompress, 
+    private_, _1, _2, _3 ) );
+  parallel_decompress.run();
+
+  if ( !private_->success_ )
+  {
+    error = private_->error_;
+    return false;
+  }
+
+  // Verify the checksum and size stored in the trailer
+  unsigned char trailer[ GZIP_TRAILER_SIZE_C ];
+  stream.seekg( block_offset );
+  stream.read( reinterpret_cast< char* >( trailer ), GZIP_TRAILER_SIZE_C );
+  if ( !stream )
+  {
+    error = "File '" + filename + "' is truncated.";
+    return false;
+  }
+
+  z_uLong crc = z_crc32( 0L, Z_NULL, 0 );
+  for ( size_t block = 0; block < private_->num_blocks_; block++ )
+  {
+    crc = z_crc32_combine( crc, private_->crcs_[ block ], 
+      static_cast< z_off_t >( private_->get_block_length( block ) ) );
+  }
+
+  if ( ReadLittleEndian32( trailer ) != ( crc & 0xffffffff ) ||
+    ReadLittleEndian32( trailer + 4 ) != ( size & 0xffffffff ) )
+  {
+    error = "Checksum error in file '" + filename + "'.";
+    return false;
+  }
+
+  return true;
+}
+
+size_t ParallelGzip::GetStreamSize( const std::vector< size_t >& block_sizes )
+{
+  size_t stream_size = GZIP_HEADER_SIZE_C + GZIP_TRAILER_SIZE_C;
+  for ( size_t j = 0; j < block_sizes.size(); j++ ) stream_size += block_sizes[ j ];
+  return stream_size;
+}
+
+} // end namespace Core
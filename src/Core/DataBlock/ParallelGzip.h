@@ -0,0 +1,82 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_PARALLELGZIP_H
+#define CORE_DATABLOCK_PARALLELGZIP_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+
+namespace Core
+{
+
+// CLASS PARALLELGZIP
+/// This class writes and reads gzip streams using multiple threads. The data is split into blocks
+/// of fixed size that are deflated independently and then concatenated into a single gzip member
+/// (the same approach that pigz uses). The result is a standard gzip stream that can be read by
+/// any gzip reader, including teem. If the compressed sizes of the blocks are known, the stream
+/// can be inflated in parallel as well.
+class ParallelGzip : boost::noncopyable
+{
+  // -- Compression --
+public:
+  // COMPRESS:
+  /// Compress size bytes of data into a gzip stream and write it to the output stream.
+  /// The compressed size of each block is returned in block_sizes.
+  static bool Compress( std::ostream& stream, const void* data, size_t size, int level,
+    size_t block_size, std::vector< size_t >& block_sizes, std::string& error );
+
+  // DECOMPRESS:
+  /// Read a gzip stream that was written by Compress from the file starting at offset and
+  /// inflate it into data, which needs to hold size bytes. If a progress function is given, it
+  /// is called from the decompression threads with the fraction of the data that is done.
+  static bool Decompress( const std::string& filename, size_t offset, void* data, size_t size,
+    size_t block_size, const std::vector< size_t >& block_sizes, std::string& error,
+    boost::function< void ( double ) > progress = boost::function< void ( double ) >() );
+
+  // GETSTREAMSIZE:
+  /// Get the total size of the gzip stream including its header and trailer.
+  static size_t GetStreamSize( const std::vector< size_t >& block_sizes );
+
+  // Default size of the blocks that are compressed independently
+  const static size_t DEFAULT_BLOCK_SIZE_C;
+};
+
+} // end namespace Core
+
+#endif
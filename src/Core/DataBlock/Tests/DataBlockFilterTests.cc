@@ -0,0 +1,673 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <teem/nrrd.h>
+
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/DataBlockFilter.h>
+#include <Core/DataBlock/DataType.h>
+#include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Utils/StringUtil.h>
+#include <Testing/Utils/DataBlockSource.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+// Values in the box around a voxel, repeating the voxels on the boundary
+static std::vector< double > getNeighborhood( DataBlockHandle data_block, int x, int y, int z, 
+  int radius )
+{
+  std::vector< double > values;
+  int n[ 3 ] = { static_cast< int >( data_block->get_nx() ), 
+    static_cast< int >( data_block->get_ny() ), static_cast< int >( data_block->get_nz() ) };
+  for ( int dz = -radius; dz <= radius; dz++ )
+  {
+    for ( int dy = -radius; dy <= radius; dy++ )
+    {
+      for ( int dx = -radius; dx <= radius; dx++ )
+      {
+        int p[ 3 ] = { x + dx, y + dy, z + dz };
+        for ( int j = 0; j < 3; j++ ) p[ j ] = std::max( 0, std::min( n[ j ] - 1, p[ j ] ) );
+        values.push_back( data_block->get_data_at( p[ 0 ], p[ 1 ], p[ 2 ] ) );
+      }
+    }
+  }
+  return values;
+}
+
+static void checkMedianFilter( DataBlockHandle src, int radius )
+{
+  DataBlockHandle dst;
+  ASSERT_TRUE( DataBlockFilter::MedianFilter( src, dst, radius ) );
+  ASSERT_TRUE( dst );
+  ASSERT_EQ( dst->get_data_type(), src->get_data_type() );
+
+  for ( size_t z = 0; z < src->get_nz(); z++ )
+  {
+    for ( size_t y = 0; y < src->get_ny(); y++ )
+    {
+      for ( size_t x = 0; x < src->get_nx(); x++ )
+      {
+        std::vector< double > values = getNeighborhood( src, static_cast< int >( x ), 
+          static_cast< int >( y ), static_cast< int >( z ), radius );
+        std::nth_element( values.begin(), values.begin() + values.size() / 2, values.end() );
+        ASSERT_EQ( dst->get_data_at( x, y, z ), values[ values.size() / 2 ] );
+      }
+    }
+  }
+}
+
+static void checkMeanFilter( DataBlockHandle src, int radius )
+{
+  DataBlockHandle dst;
+  ASSERT_TRUE( DataBlockFilter::MeanFilter( src, dst, radius ) );
+  ASSERT_TRUE( dst );
+  ASSERT_EQ( dst->get_data_type(), DataType::FLOAT_E );
+
+  for ( size_t z = 0; z < src->get_nz(); z++ )
+  {
+    for ( size_t y = 0; y < src->get_ny(); y++ )
+    {
+      for ( size_t x = 0; x < src->get_nx(); x++ )
+      {
+        std::vector< double > values = getNeighborhood( src, static_cast< int >( x ), 
+          static_cast< int >( y ), static_cast< int >( z ), radius );
+        double sum = 0.0;
+        for ( size_t j = 0; j < values.size(); j++ ) sum += values[ j ];
+        ASSERT_NEAR( dst->get_data_at( x, y, z ), sum / values.size(), 1e-3 );
+      }
+    }
+  }
+}
+
+TEST(DataBlockFilterTest, MedianFilter8Bit)
+{
+  checkMedianFilter( generateRandomDataBlock( 13, 11, 9, DataType::UCHAR_E, 0, 255 ), 1 );
+  checkMedianFilter( generateRandomDataBlock( 13, 11, 9, DataType::CHAR_E, -128, 127 ), 2 );
+  // A box that is larger than the volume
+  checkMedianFilter( generateRandomDataBlock( 5, 4, 3, DataType::UCHAR_E, 0, 255 ), 4 );
+}
+
+TEST(DataBlockFilterTest, MedianFilter16Bit)
+{
+  checkMedianFilter( generateRandomDataBlock( 13, 11, 9, DataType::USHORT_E, 0, 65535 ), 1 );
+  checkMedianFilter( generateRandomDataBlock( 13, 11, 9, DataType::SHORT_E, -32768, 32767 ), 2 );
+  checkMedianFilter( generateRandomDataBlock( 5, 4, 3, DataType::SHORT_E, -100, 100 ), 4 );
+}
+
+TEST(DataBlockFilterTest, MedianFilter12Bit)
+{
+  // NOTE: Data that uses a limited range of values is filtered with column histograms
+  checkMedianFilter( generateRandomDataBlock( 13, 11, 9, DataType::USHORT_E, 1000, 5000 ), 2 );
+  checkMedianFilter( generateRandomDataBlock( 13, 11, 9, DataType::SHORT_E, -2000, 2000 ), 1 );
+  checkMedianFilter( generateRandomDataBlock( 13, 11, 9, DataType::SHORT_E, 7, 9 ), 1 );
+}
+
+TEST(DataBlockFilterTest, MedianFilterParallel)
+{
+  // NOTE: Large enough to be split over multiple threads
+  checkMedianFilter( generateRandomDataBlock( 67, 65, 63, DataType::UCHAR_E, 0, 255 ), 1 );
+  checkMedianFilter( generateRandomDataBlock( 67, 65, 63, DataType::USHORT_E, 0, 4000 ), 1 );
+}
+
+TEST(DataBlockFilterTest, NeighborhoodFilterThreads)
+{
+  // NOTE: The number of threads the caller asks for only changes how the volume is split
+  DataBlockHandle src = generateRandomDataBlock( 67, 65, 63, DataType::USHORT_E, 0, 4000 );
+  DataBlockHandle single, multiple;
+  ASSERT_TRUE( DataBlockFilter::MedianFilter( src, single, 1,
+    DataBlockFilter::abort_function_type(), DataBlockFilter::progress_function_type(), 1 ) );
+  ASSERT_TRUE( DataBlockFilter::MedianFilter( src, multiple, 1,
+    DataBlockFilter::abort_function_type(), DataBlockFilter::progress_function_type(), 3 ) );
+  for ( size_t j = 0; j < src->get_size(); j++ )
+  {
+    ASSERT_EQ( single->get_data_at( j ), multiple->get_data_at( j ) );
+  }
+
+  ASSERT_TRUE( DataBlockFilter::MeanFilter( src, single, 2,
+    DataBlockFilter::abort_function_type(), DataBlockFilter::progress_function_type(), 1 ) );
+  ASSERT_TRUE( DataBlockFilter::MeanFilter( src, multiple, 2,
+    DataBlockFilter::abort_function_type(), DataBlockFilter::progress_function_type(), 3 ) );
+  for ( size_t j = 0; j < src->get_size(); j++ )
+  {
+    ASSERT_EQ( single->get_data_at( j ), multiple->get_data_at( j ) );
+  }
+}
+
+TEST(DataBlockFilterTest, MedianFilterUnsupportedType)
+{
+  DataBlockHandle src = generateRandomDataBlock( 4, 4, 4, DataType::FLOAT_E, 0, 10 );
+  DataBlockHandle dst;
+  EXPECT_FALSE( DataBlockFilter::IsMedianFilterSupported( DataType::FLOAT_E ) );
+  EXPECT_FALSE( DataBlockFilter::MedianFilter( src, dst, 1 ) );
+  EXPECT_FALSE( dst );
+}
+
+TEST(DataBlockFilterTest, MeanFilter)
+{
+  checkMeanFilter( generateRandomDataBlock( 13, 11, 9, DataType::UCHAR_E, 0, 255 ), 1 );
+  checkMeanFilter( generateRandomDataBlock( 13, 11, 9, DataType::SHORT_E, -1000, 1000 ), 3 );
+  checkMeanFilter( generateRandomDataBlock( 5, 4, 3, DataType::FLOAT_E, 0, 100 ), 4 );
+  checkMeanFilter( generateRandomDataBlock( 67, 65, 63, DataType::USHORT_E, 0, 4000 ), 2 );
+}
+
+// Separable Gaussian smoothing with a kernel of six sigma, repeating the voxels on the boundary
+static std::vector< double > referenceGaussian( DataBlockHandle data_block, double sigma )
+{
+  int n[ 3 ] = { static_cast< int >( data_block->get_nx() ), 
+    static_cast< int >( data_block->get_ny() ), static_cast< int >( data_block->get_nz() ) };
+  int stride[ 3 ] = { 1, n[ 0 ], n[ 0 ] * n[ 1 ] };
+  std::vector< double > data( data_block->get_size() );
+  for ( size_t j = 0; j < data.size(); j++ ) data[ j ] = data_block->get_data_at( j );
+
+  int radius = static_cast< int >( std::ceil( 6.0 * sigma ) );
+  std::vector< double > kernel( 2 * radius + 1 );
+  double sum = 0.0;
+  for ( int k = -radius; k <= radius; k++ )
+  {
+    kernel[ k + radius ] = std::exp( -0.5 * k * k / ( sigma * sigma ) );
+    sum += kernel[ k + radius ];
+  }
+  for ( size_t k = 0; k < kernel.size(); k++ ) kernel[ k ] /= sum;
+
+  for ( int axis = 0; axis < 3; axis++ )
+  {
+    std::vector< double > result( data.size(), 0.0 );
+    for ( int z = 0; z < n[ 2 ]; z++ )
+    {
+      for ( int y = 0; y < n[ 1 ]; y++ )
+      {
+        for ( int x = 0; x < n[ 0 ]; x++ )
+        {
+          int p[ 3 ] = { x, y, z };
+          int index = x + y * stride[ 1 ] + z * stride[ 2 ];
+          for ( int k = -radius; k <= radius; k++ )
+          {
+            int q = std::max( 0, std::min( n[ axis ] - 1, p[ axis ] + k ) );
+            result[ index ] += kernel[ k + radius ] * 
+              data[ index + ( q - p[ axis ] ) * stride[ axis ] ];
+          }
+        }
+      }
+    }
+    data.swap( result );
+  }
+  return data;
+}
+
+static void checkGaussianFilter( DataBlockHandle src, double sigma, double tolerance,
+  int margin )
+{
+  DataBlockHandle dst;
+  ASSERT_TRUE( DataBlockFilter::GaussianFilter( src, dst, sigma ) );
+  ASSERT_TRUE( dst );
+  ASSERT_EQ( dst->get_data_type(), DataType::FLOAT_E );
+
+  std::vector< double > reference = referenceGaussian( src, sigma );
+  for ( size_t z = margin; z + margin < src->get_nz(); z++ )
+  {
+    for ( size_t y = margin; y + margin < src->get_ny(); y++ )
+    {
+      for ( size_t x = margin; x + margin < src->get_nx(); x++ )
+      {
+        ASSERT_NEAR( dst->get_data_at( x, y, z ), reference[ src->to_index( x, y, z ) ], 
+          tolerance );
+      }
+    }
+  }
+}
+
+TEST(DataBlockFilterTest, GaussianFilterConvolution)
+{
+  DataBlockHandle src = generateRandomDataBlock( 23, 19, 17, DataType::UCHAR_E, 0, 255 );
+  // NOTE: The kernel is truncated at three sigma, which changes the result slightly
+  checkGaussianFilter( src, 0.7, 0.5, 0 );
+  checkGaussianFilter( src, 1.5, 1.0, 0 );
+}
+
+TEST(DataBlockFilterTest, GaussianFilterRecursive)
+{
+  // NOTE: The recursive filter approximates the Gaussian, and approximates the boundary
+  DataBlockHandle src = generateRandomDataBlock( 41, 39, 37, DataType::SHORT_E, -1000, 1000 );
+  checkGaussianFilter( src, 2.5, 10.0, 8 );
+  checkGaussianFilter( src, 6.0, 10.0, 12 );
+}
+
+TEST(DataBlockFilterTest, GaussianFilterConstant)
+{
+  DataBlockHandle src = generateRandomDataBlock( 67, 65, 63, DataType::USHORT_E, 700, 700 );
+  const double sigmas[ 3 ] = { 0.0, 1.0, 4.0 };
+  for ( int j = 0; j < 3; j++ )
+  {
+    DataBlockHandle dst;
+    ASSERT_TRUE( DataBlockFilter::GaussianFilter( src, dst, sigmas[ j ] ) );
+    for ( size_t k = 0; k < dst->get_size(); k++ )
+    {
+      ASSERT_NEAR( dst->get_data_at( k ), 700.0, 0.05 );
+    }
+  }
+}
+
+TEST(DataBlockFilterTest, GaussianKernelFilter)
+{
+  // NOTE: Unlike GaussianFilter, large sigmas use the explicit kernel as well
+  DataBlockHandle src = generateRandomDataBlock( 41, 39, 37, DataType::SHORT_E, -1000, 1000 );
+  DataBlockHandle dst;
+  ASSERT_TRUE( DataBlockFilter::GaussianKernelFilter( src, dst, 2.5 ) );
+  ASSERT_TRUE( dst );
+  ASSERT_EQ( dst->get_data_type(), DataType::FLOAT_E );
+  EXPECT_EQ( 8, DataBlockFilter::GetGaussianKernelRadius( 2.5 ) );
+
+  // The kernel is truncated at three sigma, which changes the result slightly
+  std::vector< double > reference = referenceGaussian( src, 2.5 );
+  for ( size_t j = 0; j < dst->get_size(); j++ )
+  {
+    ASSERT_NEAR( dst->get_data_at( j ), reference[ j ], 10.0 );
+  }
+}
+
+TEST(DataBlockFilterTest, GaussianKernelFilterRegion)
+{
+  // Smoothing a region with a margin of the kernel radius around a part of the volume gives
+  // the same result for that part as smoothing the full volume
+  DataBlockHandle src = generateRandomDataBlock( 45, 40, 35, DataType::UCHAR_E, 0, 255 );
+  const double sigma = 3.0;
+  const int radius = DataBlockFilter::GetGaussianKernelRadius( sigma );
+
+  DataBlockHandle full;
+  ASSERT_TRUE( DataBlockFilter::GaussianKernelFilter( src, full, sigma ) );
+
+  const int start[ 3 ] = { 12, 10, 11 };
+  const int size[ 3 ] = { 8, 9, 7 };
+  DataBlockHandle region = StdDataBlock::New( size[ 0 ] + 2 * radius, 
+    size[ 1 ] + 2 * radius, size[ 2 ] + 2 * radius, DataType::UCHAR_E );
+  for ( size_t z = 0; z < region->get_nz(); z++ )
+  {
+    for ( size_t y = 0; y < region->get_ny(); y++ )
+    {
+      for ( size_t x = 0; x < region->get_nx(); x++ )
+      {
+        region->set_data_at( x, y, z, src->get_data_at( start[ 0 ] - radius + x,
+          start[ 1 ] - radius + y, start[ 2 ] - radius + z ) );
+      }
+    }
+  }
+
+  DataBlockHandle part;
+  ASSERT_TRUE( DataBlockFilter::GaussianKernelFilter( region, part, sigma ) );
+  for ( int z = 0; z < size[ 2 ]; z++ )
+  {
+    for ( int y = 0; y < size[ 1 ]; y++ )
+    {
+      for ( int x = 0; x < size[ 0 ]; x++ )
+      {
+        ASSERT_NEAR( part->get_data_at( x + radius, y + radius, z + radius ), 
+          full->get_data_at( start[ 0 ] + x, start[ 1 ] + y, start[ 2 ] + z ), 1e-3 );
+      }
+    }
+  }
+}
+
+static MaskDataBlockHandle generateRandomMask( size_t nx, size_t ny, size_t nz, int percentage )
+{
+  DataBlockHandle data_block = StdDataBlock::New( nx, ny, nz, DataType::UCHAR_E );
+  std::srand( 7 );
+  for ( size_t j = 0; j < data_block->get_size(); j++ )
+  {
+    data_block->set_data_at( j, ( std::rand() % 100 ) < percentage ? 1.0 : 0.0 );
+  }
+  MaskDataBlockHandle mask;
+  MaskDataBlockManager::Convert( data_block, GridTransform( nx, ny, nz ), mask );
+  return mask;
+}
+
+// Brute force distance from every voxel to the nearest feature voxel
+static void checkDistanceFilter( MaskDataBlockHandle mask, const Vector& spacing, 
+  bool signed_distance, bool inside_positive )
+{
+  DataBlockHandle dst;
+  ASSERT_TRUE( DataBlockFilter::DistanceFilter( mask, dst, spacing, signed_distance, 
+    inside_positive ) );
+  ASSERT_TRUE( dst );
+  ASSERT_EQ( dst->get_data_type(), DataType::FLOAT_E );
+
+  int n[ 3 ] = { static_cast< int >( mask->get_nx() ), static_cast< int >( mask->get_ny() ), 
+    static_cast< int >( mask->get_nz() ) };
+  std::vector< int > features;
+  for ( int z = 0; z < n[ 2 ]; z++ )
+  {
+    for ( int y = 0; y < n[ 1 ]; y++ )
+    {
+      for ( int x = 0; x < n[ 0 ]; x++ )
+      {
+        if ( !mask->get_mask_at( x, y, z ) ) continue;
+        bool feature = !signed_distance;
+        int p[ 3 ] = { x, y, z };
+        for ( int axis = 0; axis < 3 && !feature; axis++ )
+        {
+          for ( int step = -1; step <= 1; step += 2 )
+          {
+            int q[ 3 ] = { x, y, z };
+            q[ axis ] += step;
+            if ( q[ axis ] >= 0 && q[ axis ] < n[ axis ] && 
+              !mask->get_mask_at( q[ 0 ], q[ 1 ], q[ 2 ] ) ) feature = true;
+          }
+        }
+        if ( feature ) features.push_back( p[ 0 ] + n[ 0 ] * ( p[ 1 ] + n[ 1 ] * p[ 2 ] ) );
+      }
+    }
+  }
+  ASSERT_FALSE( features.empty() );
+
+  for ( int z = 0; z < n[ 2 ]; z++ )
+  {
+    for ( int y = 0; y < n[ 1 ]; y++ )
+    {
+      for ( int x = 0; x < n[ 0 ]; x++ )
+      {
+        double best = std::numeric_limits< double >::max();
+        for ( size_t j = 0; j < features.size(); j++ )
+        {
+          double dx = ( x - features[ j ] % n[ 0 ] ) * spacing.x();
+          double dy = ( y - ( features[ j ] / n[ 0 ] ) % n[ 1 ] ) * spacing.y();
+          double dz = ( z - features[ j ] / ( n[ 0 ] * n[ 1 ] ) ) * spacing.z();
+          best = std::min( best, dx * dx + dy * dy + dz * dz );
+        }
+        double expected = std::sqrt( best );
+        bool inside = mask->get_mask_at( x, y, z );
+        if ( signed_distance && inside != inside_positive ) expected = -expected;
+        ASSERT_NEAR( dst->get_data_at( x, y, z ), expected, 1e-3 );
+      }
+    }
+  }
+}
+
+TEST(DataBlockFilterTest, DistanceFilterUnsigned)
+{
+  checkDistanceFilter( generateRandomMask( 17, 15, 13, 1 ), Vector( 1.0, 1.0, 1.0 ), 
+    false, false );
+  checkDistanceFilter( generateRandomMask( 17, 15, 13, 2 ), Vector( 0.5, 1.5, 3.0 ), 
+    false, false );
+}
+
+TEST(DataBlockFilterTest, DistanceFilterSigned)
+{
+  checkDistanceFilter( generateRandomMask( 17, 15, 13, 60 ), Vector( 1.0, 1.0, 1.0 ), 
+    true, false );
+  checkDistanceFilter( generateRandomMask( 17, 15, 13, 90 ), Vector( 2.0, 0.7, 1.3 ), 
+    true, true );
+}
+
+TEST(DataBlockFilterTest, DistanceFilterParallel)
+{
+  // NOTE: Large enough to be split over multiple threads, with a few small objects to keep
+  // the brute force check fast
+  DataBlockHandle data_block = StdDataBlock::New( 67, 65, 63, DataType::UCHAR_E );
+  data_block->clear();
+  data_block->set_data_at( 3, 5, 7, 1.0 );
+  data_block->set_data_at( 60, 30, 40, 1.0 );
+  data_block->set_data_at( 61, 30, 40, 1.0 );
+  data_block->set_data_at( 20, 64, 62, 1.0 );
+  data_block->set_data_at( 33, 33, 10, 1.0 );
+  MaskDataBlockHandle mask;
+  MaskDataBlockManager::Convert( data_block, GridTransform( 67, 65, 63 ), mask );
+
+  checkDistanceFilter( mask, Vector( 1.0, 2.0, 1.0 ), false, false );
+  checkDistanceFilter( mask, Vector( 0.3, 0.3, 1.5 ), true, false );
+}
+
+static void checkThresholdFilter( const DataBlockHandle& data_block, 
+  const std::vector< double >& lower, const std::vector< double >& upper )
+{
+  // NOTE: The masks are created in a row, hence they share bit planes of the same data blocks
+  std::vector< MaskDataBlockHandle > masks( lower.size() );
+  for ( size_t k = 0; k < masks.size(); k++ )
+  {
+    ASSERT_TRUE( MaskDataBlockManager::Create( GridTransform( data_block->get_nx(), 
+      data_block->get_ny(), data_block->get_nz() ), masks[ k ] ) );
+  }
+
+  ASSERT_TRUE( DataBlockFilter::ThresholdFilter( data_block, lower, upper, masks ) );
+
+  for ( size_t k = 0; k < masks.size(); k++ )
+  {
+    size_t errors = 0;
+    for ( size_t j = 0; j < data_block->get_size(); j++ )
+    {
+      double value = data_block->get_data_at( j );
+      bool inside = value >= lower[ k ] && value <= upper[ k ];
+      if ( masks[ k ]->get_mask_at( j ) != inside ) errors++;
+    }
+    EXPECT_EQ( 0u, errors ) << "band " << k;
+  }
+}
+
+TEST(DataBlockFilterTest, ThresholdFilterBands)
+{
+  std::vector< double > lower;
+  std::vector< double > upper;
+  lower.push_back( -1000.0 ); upper.push_back( -0.5 );
+  lower.push_back( -0.5 ); upper.push_back( 20.0 );
+  lower.push_back( 10.25 ); upper.push_back( 99.75 );
+  lower.push_back( 50.0 ); upper.push_back( 1.0e10 );
+  lower.push_back( 30.0 ); upper.push_back( 20.0 );
+
+  checkThresholdFilter( generateRandomDataBlock( 17, 15, 13, DataType::SHORT_E, -100, 100 ),
+    lower, upper );
+  checkThresholdFilter( generateRandomDataBlock( 17, 15, 13, DataType::UCHAR_E, 0, 255 ),
+    lower, upper );
+  checkThresholdFilter( generateRandomDataBlock( 67, 65, 63, DataType::INT_E, -100, 100 ),
+    lower, upper );
+}
+
+TEST(DataBlockFilterTest, ThresholdFilterFloatBounds)
+{
+  DataBlockHandle data_block = StdDataBlock::New( 5, 4, 3, DataType::FLOAT_E );
+  for ( size_t j = 0; j < data_block->get_size(); j++ )
+  {
+    data_block->set_data_at( j, 0.1 * static_cast< double >( j ) );
+  }
+
+  // NOTE: 0.1 and 0.3 cannot be represented exactly as float, the bounds are rounded inward
+  std::vector< double > lower( 1, 0.1 );
+  std::vector< double > upper( 1, 0.3 );
+  checkThresholdFilter( data_block, lower, upper );
+}
+
+TEST(DataBlockFilterTest, OtsuThresholds)
+{
+  // Three clusters of values
+  std::vector< unsigned char > data;
+  std::srand( 42 );
+  for ( int j = 0; j < 3000; j++ )
+  {
+    int center = ( j % 3 ) * 100 + 20;
+    data.push_back( static_cast< unsigned char >( center + std::rand() % 11 - 5 ) );
+  }
+  Histogram histogram( &data[ 0 ], data.size() );
+
+  std::vector< double > thresholds;
+  ASSERT_TRUE( DataBlockFilter::OtsuThresholds( histogram, 2, thresholds ) );
+  ASSERT_EQ( 2u, thresholds.size() );
+  EXPECT_GT( thresholds[ 0 ], 25.0 );
+  EXPECT_LE( thresholds[ 0 ], 115.0 );
+  EXPECT_GT( thresholds[ 1 ], 125.0 );
+  EXPECT_LE( thresholds[ 1 ], 215.0 );
+
+  EXPECT_FALSE( DataBlockFilter::OtsuThresholds( histogram, 0, thresholds ) );
+  EXPECT_FALSE( DataBlockFilter::OtsuThresholds( Histogram(), 1, thresholds ) );
+}
+
+// Resample the data with nrrdResampleExecute, set up as the resample tool does, and check that
+// the resample filter gives the same result with the context that teem leaves behind.
+static void checkResampleFilter( DataBlockHandle src, const NrrdKernel* kernel, 
+  double parm0, double parm1, double parm2, const size_t samples[ 3 ], bool pad,
+  double pad_value, double tolerance )
+{
+  const size_t n[ 3 ] = { src->get_nx(), src->get_ny(), src->get_nz() };
+  double parm[ NRRD_KERNEL_PARMS_NUM ] = { parm0, parm1, parm2 };
+
+  Nrrd* nin = nrrdNew();
+  int nrrd_type = src->get_data_type() == DataType::FLOAT_E ? nrrdTypeFloat : nrrdTypeUChar;
+  ASSERT_EQ( 0, nrrdWrap_va( nin, src->get_data(), nrrd_type, 3, n[ 0 ], n[ 1 ], n[ 2 ] ) );
+  int centers[ 3 ] = { nrrdCenterCell, nrrdCenterCell, nrrdCenterCell };
+  nrrdAxisInfoSet_nva( nin, nrrdAxisInfoCenter, centers );
+
+  NrrdResampleContext* context = nrrdResampleContextNew();
+  context->verbose = 0;
+  int error = nrrdResampleDefaultCenterSet( context, nrrdCenterCell );
+  error |= nrrdResampleNrrdSet( context, nin );
+  for ( unsigned int axis = 0; axis < 3; axis++ )
+  {
+    error |= nrrdResampleKernelSet( context, axis, kernel, parm );
+    error |= nrrdResampleSamplesSet( context, axis, samples[ axis ] );
+    if ( pad )
+    {
+      // Extend the range by a few voxels on each side, so part of the output is padded
+      error |= nrrdResampleRangeSet( context, axis, -2.0, n[ axis ] + 1.0 );
+    }
+    else
+    {
+      error |= nrrdResampleRangeFullSet( context, axis );
+    }
+  }
+  error |= nrrdResampleBoundarySet( context, pad ? nrrdBoundaryPad : nrrdBoundaryBleed );
+  error |= nrrdResamplePadValueSet( context, pad_value );
+
+  Nrrd* nout = nrrdNew();
+  error |= nrrdResampleExecute( context, nout );
+  EXPECT_EQ( 0, error );
+
+  NrrdKernelSpec kernel_spec;
+  kernel_spec.kernel = kernel;
+  for ( int j = 0; j < NRRD_KERNEL_PARMS_NUM; j++ ) kernel_spec.parm[ j ] = parm[ j ];
+
+  DataBlockHandle dst;
+  if ( !error )
+  {
+    EXPECT_TRUE( DataBlockFilter::ResampleFilter( src, dst, context, &kernel_spec, pad, 
+      pad_value ) );
+  }
+
+  if ( dst )
+  {
+    EXPECT_EQ( dst->get_data_type(), src->get_data_type() );
+    EXPECT_EQ( dst->get_nx(), samples[ 0 ] );
+    EXPECT_EQ( dst->get_ny(), samples[ 1 ] );
+    EXPECT_EQ( dst->get_nz(), samples[ 2 ] );
+    EXPECT_EQ( nout->type, nrrd_type );
+
+    size_t mismatches = 0;
+    for ( size_t j = 0; j < dst->get_size(); j++ )
+    {
+      double expected = nrrd_type == nrrdTypeFloat ? 
+        static_cast< float* >( nout->data )[ j ] : 
+        static_cast< unsigned char* >( nout->data )[ j ];
+      if ( std::abs( dst->get_data_at( j ) - expected ) > tolerance ) mismatches++;
+    }
+    EXPECT_EQ( mismatches, 0u );
+  }
+
+  nrrdNuke( nout );
+  nrrdNix( nin );
+  nrrdResampleContextNix( context );
+}
+
+TEST(DataBlockFilterTest, ResampleFilterUpsample)
+{
+  DataBlockHandle src = generateRandomDataBlock( 10, 8, 6, DataType::UCHAR_E, 0, 255 );
+  const size_t samples[ 3 ] = { 17, 13, 9 };
+  // Integer results can round the other way when teem sums in a different order
+  checkResampleFilter( src, nrrdKernelTent, 1.0, 0.0, 0.0, samples, false, 0.0, 1.0 );
+  checkResampleFilter( src, nrrdKernelBCCubic, 1.0, 0.0, 0.5, samples, false, 0.0, 1.0 );
+}
+
+TEST(DataBlockFilterTest, ResampleFilterDownsample)
+{
+  DataBlockHandle src = generateRandomDataBlock( 20, 16, 12, DataType::FLOAT_E, -100, 100 );
+  const size_t samples[ 3 ] = { 9, 7, 5 };
+  checkResampleFilter( src, nrrdKernelBox, 1.0, 0.0, 0.0, samples, false, 0.0, 1e-3 );
+  checkResampleFilter( src, nrrdKernelBCCubic, 1.0, 1.0, 0.0, samples, false, 0.0, 1e-3 );
+  checkResampleFilter( src, nrrdKernelAQuartic, 1.0, 0.0834, 0.0, samples, false, 0.0, 1e-3 );
+  checkResampleFilter( src, nrrdKernelGaussian, 1.0, 3.0, 0.0, samples, false, 0.0, 1e-3 );
+}
+
+TEST(DataBlockFilterTest, ResampleFilterPadding)
+{
+  DataBlockHandle src = generateRandomDataBlock( 12, 10, 8, DataType::FLOAT_E, 0, 100 );
+  const size_t samples[ 3 ] = { 15, 11, 13 };
+  checkResampleFilter( src, nrrdKernelTent, 1.0, 0.0, 0.0, samples, true, 0.0, 1e-3 );
+  checkResampleFilter( src, nrrdKernelBCCubic, 1.0, 0.0, 0.5, samples, true, 100.0, 1e-3 );
+}
+
+TEST(DataBlockFilterTest, ResampleFilterParallel)
+{
+  // Large enough to be split over the threads
+  DataBlockHandle src = generateRandomDataBlock( 64, 64, 48, DataType::UCHAR_E, 0, 255 );
+  const size_t samples[ 3 ] = { 80, 50, 96 };
+  checkResampleFilter( src, nrrdKernelTent, 1.0, 0.0, 0.0, samples, false, 0.0, 1.0 );
+}
+
+// Timing of the median, mean and Gaussian filters over a range of radii. The times are
+// recorded as test properties. Run it with --gtest_also_run_disabled_tests 
+// --gtest_filter=*Benchmark* --gtest_output=xml
+TEST(DataBlockFilterTest, DISABLED_NeighborhoodFilterBenchmark)
+{
+  DataBlockHandle src = generateRandomDataBlock( 256, 256, 256, DataType::USHORT_E, 0, 4095 );
+  const int radii[ 3 ] = { 1, 5, 10 };
+  for ( int j = 0; j < 3; j++ )
+  {
+    DataBlockHandle dst;
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    ASSERT_TRUE( DataBlockFilter::MedianFilter( src, dst, radii[ j ] ) );
+    boost::posix_time::ptime middle = boost::posix_time::microsec_clock::universal_time();
+    ASSERT_TRUE( DataBlockFilter::MeanFilter( src, dst, radii[ j ] ) );
+    boost::posix_time::ptime end = boost::posix_time::microsec_clock::universal_time();
+    ASSERT_TRUE( DataBlockFilter::GaussianFilter( src, dst, radii[ j ] ) );
+    boost::posix_time::ptime gaussian_end = boost::posix_time::microsec_clock::universal_time();
+
+    std::string radius = "radius_" + ExportToString( radii[ j ] );
+    RecordProperty( radius + "_median_ms", static_cast< int >( 
+      ( middle - start ).total_milliseconds() ) );
+    RecordProperty( radius + "_mean_ms", static_cast< int >( 
+      ( end - middle ).total_milliseconds() ) );
+    RecordProperty( radius + "_gaussian_ms", static_cast< int >( 
+      ( gaussian_end - end ).total_milliseconds() ) );
+  }
+}
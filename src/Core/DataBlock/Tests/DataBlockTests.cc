@@ -28,9 +28,16 @@
 
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <Core/DataBlock/DataBlock.h>
 #include <Core/DataBlock/DataType.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Utils/StringUtil.h>
 #include <Testing/Utils/DataBlockSource.h>
 
 using namespace Core;
@@ -50,6 +57,16 @@ public:
     set_ny(ny);
     set_nz(nz);
   }
+
+  void set_data_type(DataType type)
+  {
+    set_type(type);
+  }
+
+  bool convert_in_place(DataType type)
+  {
+    return convert_data_type_in_place(type);
+  }
 };
 
 class DataBlockTest : public ::testing::Test {
@@ -120,3 +137,149 @@ TEST_F(DataBlockTest, SetData)
   EXPECT_EQ(dataBlock_->get_nz(), 3);
 }
 
+// All 48 signed axis permutations that PermuteData accepts
+static std::vector< std::vector< int > > getSignedPermutations()
+{
+  const int orders[ 6 ][ 3 ] = 
+    { { 1, 2, 3 }, { 1, 3, 2 }, { 2, 1, 3 }, { 2, 3, 1 }, { 3, 1, 2 }, { 3, 2, 1 } };
+  std::vector< std::vector< int > > permutations;
+  for ( int order = 0; order < 6; order++ )
+  {
+    for ( int signs = 0; signs < 8; signs++ )
+    {
+      std::vector< int > permutation( 3 );
+      for ( int j = 0; j < 3; j++ )
+      {
+        permutation[ j ] = ( signs & ( 1 << j ) ) ? -orders[ order ][ j ] : orders[ order ][ j ];
+      }
+      permutations.push_back( permutation );
+    }
+  }
+  return permutations;
+}
+
+static void checkPermutation( DataBlockHandle src, const std::vector< int >& permutation )
+{
+  DataBlockHandle dst;
+  ASSERT_TRUE( DataBlock::PermuteData( src, dst, permutation ) );
+  ASSERT_TRUE( dst );
+
+  size_t n[ 3 ] = { src->get_nx(), src->get_ny(), src->get_nz() };
+  size_t dn[ 3 ] = { dst->get_nx(), dst->get_ny(), dst->get_nz() };
+  for ( int j = 0; j < 3; j++ )
+  {
+    ASSERT_EQ( dn[ j ], n[ std::abs( permutation[ j ] ) - 1 ] );
+  }
+
+  size_t d[ 3 ];
+  for ( d[ 2 ] = 0; d[ 2 ] < dn[ 2 ]; d[ 2 ]++ )
+  {
+    for ( d[ 1 ] = 0; d[ 1 ] < dn[ 1 ]; d[ 1 ]++ )
+    {
+      for ( d[ 0 ] = 0; d[ 0 ] < dn[ 0 ]; d[ 0 ]++ )
+      {
+        size_t s[ 3 ];
+        for ( int j = 0; j < 3; j++ )
+        {
+          int axis = std::abs( permutation[ j ] ) - 1;
+          s[ axis ] = permutation[ j ] > 0 ? d[ j ] : n[ axis ] - 1 - d[ j ];
+        }
+        ASSERT_EQ( dst->get_data_at( d[ 0 ], d[ 1 ], d[ 2 ] ), 
+          src->get_data_at( s[ 0 ], s[ 1 ], s[ 2 ] ) );
+      }
+    }
+  }
+}
+
+TEST_F(DataBlockTest, ConvertDataTypeInPlace)
+{
+  // Use a size that spans multiple conversion chunks
+  const size_t nx = 100003;
+  std::vector<float> data(nx);
+  for (size_t j = 0; j < nx; j++)
+  {
+    data[j] = static_cast<float>(j % 60000) - 30000.0f;
+  }
+
+  dataBlock_->set_size(nx, 1, 1);
+  dataBlock_->set_data_type(DataType::FLOAT_E);
+  dataBlock_->set_data(&data[0]);
+
+  // Wider types cannot be stored in the same buffer
+  EXPECT_FALSE(dataBlock_->convert_in_place(DataType::DOUBLE_E));
+  EXPECT_EQ(dataBlock_->get_data_type(), DataType::FLOAT_E);
+
+  ASSERT_TRUE(dataBlock_->convert_in_place(DataType::SHORT_E));
+  EXPECT_EQ(dataBlock_->get_data_type(), DataType::SHORT_E);
+
+  const short* converted = reinterpret_cast<const short*>(dataBlock_->get_data());
+  for (size_t j = 0; j < nx; j++)
+  {
+    ASSERT_EQ(converted[j], static_cast<short>(static_cast<int>(j % 60000) - 30000));
+  }
+
+  dataBlock_->set_data(0);
+}
+
+TEST(DataBlockPermuteTest, AllSignedPermutations)
+{
+  // NOTE: Sizes that are not a multiple of the tile size, to check the edges of the tiles
+  DataBlockHandle src = generateIndexedDataBlock( 37, 70, 45, DataType::SHORT_E, 127 );
+  std::vector< std::vector< int > > permutations = getSignedPermutations();
+  for ( size_t j = 0; j < permutations.size(); j++ )
+  {
+    checkPermutation( src, permutations[ j ] );
+  }
+}
+
+TEST(DataBlockPermuteTest, AllSignedPermutationsParallel)
+{
+  // NOTE: Large enough to be split over multiple threads
+  DataBlockHandle src = generateIndexedDataBlock( 131, 67, 129, DataType::FLOAT_E, 127 );
+  std::vector< std::vector< int > > permutations = getSignedPermutations();
+  for ( size_t j = 0; j < permutations.size(); j++ )
+  {
+    checkPermutation( src, permutations[ j ] );
+  }
+}
+
+TEST(DataBlockPermuteTest, InvalidPermutation)
+{
+  DataBlockHandle src = generateIndexedDataBlock( 4, 5, 6, DataType::UCHAR_E, 127 );
+  DataBlockHandle dst;
+  
+  std::vector< int > permutation( 3 );
+  permutation[ 0 ] = 1;
+  permutation[ 1 ] = 4;
+  permutation[ 2 ] = 3;
+  EXPECT_FALSE( DataBlock::PermuteData( src, dst, permutation ) );
+
+  permutation.resize( 2 );
+  EXPECT_FALSE( DataBlock::PermuteData( src, dst, permutation ) );
+}
+
+// Benchmark of all the signed permutations on a large volume. The throughput is recorded as
+// a test property. Run it with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark* 
+// --gtest_output=xml
+TEST(DataBlockPermuteTest, DISABLED_PermuteDataBenchmark)
+{
+  DataBlockHandle src = StdDataBlock::New( 512, 512, 512, DataType::USHORT_E );
+  ASSERT_TRUE( src );
+  std::fill( reinterpret_cast< unsigned short* >( src->get_data() ),
+    reinterpret_cast< unsigned short* >( src->get_data() ) + src->get_size(), 1 );
+  double megabytes = static_cast< double >( src->get_byte_size() ) / ( 1 << 20 );
+
+  std::vector< std::vector< int > > permutations = getSignedPermutations();
+  for ( size_t j = 0; j < permutations.size(); j++ )
+  {
+    DataBlockHandle dst;
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    ASSERT_TRUE( DataBlock::PermuteData( src, dst, permutations[ j ] ) );
+    double seconds = static_cast< double >( ( boost::posix_time::microsec_clock::universal_time() 
+      - start ).total_microseconds() ) * 1.0e-6;
+
+    RecordProperty( "permutation_" + ExportToString( permutations[ j ][ 0 ] ) + "_" +
+      ExportToString( permutations[ j ][ 1 ] ) + "_" + ExportToString( permutations[ j ][ 2 ] ) +
+      "_mb_per_s", static_cast< int >( seconds > 0.0 ? megabytes / seconds : 0.0 ) );
+  }
+}
@@ -0,0 +1,237 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+ 
+ The MIT License
+ 
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+ 
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/DataBlockView.h>
+#include <Core/DataBlock/DataType.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Geometry/GridTransform.h>
+#include <Testing/Utils/DataBlockSource.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+static GridTransform makeGridTransform( DataBlockHandle data_block )
+{
+  return GridTransform( data_block->get_nx(), data_block->get_ny(), data_block->get_nz(),
+    Point( 1.0, 2.0, 3.0 ), Vector( 0.5, 0.0, 0.0 ), Vector( 0.0, 2.0, 0.0 ), 
+    Vector( 0.0, 0.0, 4.0 ) );
+}
+
+static std::vector< int > makePermutation( int x, int y, int z )
+{
+  std::vector< int > permutation( 3 );
+  permutation[ 0 ] = x;
+  permutation[ 1 ] = y;
+  permutation[ 2 ] = z;
+  return permutation;
+}
+
+static std::vector< size_t > makeVector( size_t x, size_t y, size_t z )
+{
+  std::vector< size_t > vec( 3 );
+  vec[ 0 ] = x;
+  vec[ 1 ] = y;
+  vec[ 2 ] = z;
+  return vec;
+}
+
+// Check the view against the region of the source it should describe
+static void checkView( DataBlockHandle src, DataBlockHandle view, 
+  const std::vector< int >& permutation, const std::vector< size_t >& offset )
+{
+  size_t dn[ 3 ] = { view->get_nx(), view->get_ny(), view->get_nz() };
+  size_t d[ 3 ];
+  for ( d[ 2 ] = 0; d[ 2 ] < dn[ 2 ]; d[ 2 ]++ )
+  {
+    for ( d[ 1 ] = 0; d[ 1 ] < dn[ 1 ]; d[ 1 ]++ )
+    {
+      for ( d[ 0 ] = 0; d[ 0 ] < dn[ 0 ]; d[ 0 ]++ )
+      {
+        size_t s[ 3 ];
+        for ( int j = 0; j < 3; j++ )
+        {
+          int axis = std::abs( permutation[ j ] ) - 1;
+          s[ axis ] = offset[ axis ] + ( permutation[ j ] > 0 ? d[ j ] : dn[ j ] - 1 - d[ j ] );
+        }
+        ASSERT_EQ( view->get_data_at( d[ 0 ], d[ 1 ], d[ 2 ] ), 
+          src->get_data_at( s[ 0 ], s[ 1 ], s[ 2 ] ) );
+      }
+    }
+  }
+}
+
+TEST(DataBlockViewTest, PermutationMatchesPermuteData)
+{
+  DataBlockHandle src = generateIndexedDataBlock( 7, 9, 11 );
+  std::vector< int > permutation = makePermutation( -3, 1, -2 );
+
+  DataBlockViewHandle view = DataBlockView::NewPermutation( src, 
+    makeGridTransform( src ), permutation );
+  ASSERT_TRUE( view );
+  EXPECT_FALSE( view->is_materialized() );
+  EXPECT_EQ( view->get_nx(), 11u );
+  EXPECT_EQ( view->get_ny(), 7u );
+  EXPECT_EQ( view->get_nz(), 9u );
+
+  DataBlockHandle dst;
+  ASSERT_TRUE( DataBlock::PermuteData( src, dst, permutation ) );
+  
+  // Accessing the data copies it out of the source
+  ASSERT_TRUE( view->get_data() != 0 );
+  EXPECT_TRUE( view->is_materialized() );
+  for ( size_t j = 0; j < dst->get_size(); j++ )
+  {
+    ASSERT_EQ( view->get_data_at( j ), dst->get_data_at( j ) );
+  }
+}
+
+TEST(DataBlockViewTest, Crop)
+{
+  DataBlockHandle src = generateIndexedDataBlock( 10, 12, 8 );
+  std::vector< size_t > offset = makeVector( 2, 3, 1 );
+  DataBlockViewHandle view = DataBlockView::NewCrop( src, makeGridTransform( src ), 
+    offset, makeVector( 5, 6, 4 ) );
+  ASSERT_TRUE( view );
+  checkView( src, view, makePermutation( 1, 2, 3 ), offset );
+  
+  // Regions outside the source are rejected
+  EXPECT_FALSE( DataBlockView::NewCrop( src, makeGridTransform( src ), 
+    makeVector( 6, 0, 0 ), makeVector( 5, 1, 1 ) ) );
+}
+
+TEST(DataBlockViewTest, CroppedPermutation)
+{
+  DataBlockHandle src = generateIndexedDataBlock( 10, 12, 8 );
+  std::vector< int > permutation = makePermutation( 2, -3, -1 );
+  std::vector< size_t > offset = makeVector( 1, 2, 3 );
+  DataBlockViewHandle view = DataBlockView::New( src, makeGridTransform( src ), 
+    permutation, offset, makeVector( 9, 4, 6 ) );
+  ASSERT_TRUE( view );
+  checkView( src, view, permutation, offset );
+}
+
+TEST(DataBlockViewTest, ComposedViews)
+{
+  DataBlockHandle src = generateIndexedDataBlock( 10, 12, 8 );
+  std::vector< int > first_permutation = makePermutation( -2, 3, -1 );
+  std::vector< int > second_permutation = makePermutation( -3, -1, 2 );
+  std::vector< size_t > offset = makeVector( 2, 1, 3 );
+  std::vector< size_t > size = makeVector( 5, 7, 4 );
+
+  DataBlockViewHandle first = DataBlockView::NewPermutation( src, makeGridTransform( src ), 
+    first_permutation );
+  ASSERT_TRUE( first );
+  DataBlockViewHandle second = DataBlockView::New( first, first->get_grid_transform(), 
+    second_permutation, offset, size );
+  ASSERT_TRUE( second );
+
+  // The composed view is copied straight from the source
+  ASSERT_TRUE( second->materialize() );
+  EXPECT_FALSE( first->is_materialized() );
+
+  // Compare against the same views taken from a copied intermediate
+  DataBlockHandle intermediate;
+  ASSERT_TRUE( DataBlock::PermuteData( src, intermediate, first_permutation ) );
+  checkView( intermediate, second, second_permutation, offset );
+}
+
+TEST(DataBlockViewTest, GridTransform)
+{
+  DataBlockHandle src = generateIndexedDataBlock( 10, 12, 8 );
+  GridTransform src_transform = makeGridTransform( src );
+  src_transform.set_originally_node_centered( false );
+
+  // A crop keeps the voxels in place
+  DataBlockViewHandle crop = DataBlockView::NewCrop( src, src_transform, 
+    makeVector( 2, 3, 1 ), makeVector( 5, 6, 4 ) );
+  ASSERT_TRUE( crop );
+  GridTransform crop_transform = crop->get_grid_transform();
+  EXPECT_EQ( crop_transform.get_nx(), 5u );
+  EXPECT_EQ( crop_transform.get_ny(), 6u );
+  EXPECT_EQ( crop_transform.get_nz(), 4u );
+  EXPECT_FALSE( crop_transform.get_originally_node_centered() );
+  Point crop_origin = crop_transform * Point( 0.0, 0.0, 0.0 );
+  Point src_voxel = src_transform * Point( 2.0, 3.0, 1.0 );
+  for ( int j = 0; j < 3; j++ ) EXPECT_DOUBLE_EQ( crop_origin[ j ], src_voxel[ j ] );
+
+  // A permutation keeps the center and reorders the spacing
+  DataBlockViewHandle permuted = DataBlockView::NewPermutation( src, src_transform, 
+    makePermutation( -3, 1, 2 ) );
+  ASSERT_TRUE( permuted );
+  GridTransform permuted_transform = permuted->get_grid_transform();
+  EXPECT_EQ( permuted_transform.get_nx(), 8u );
+  EXPECT_EQ( permuted_transform.get_ny(), 10u );
+  EXPECT_EQ( permuted_transform.get_nz(), 12u );
+  Vector spacing = permuted_transform * Vector( 1.0, 1.0, 1.0 );
+  EXPECT_DOUBLE_EQ( spacing[ 0 ], 4.0 );
+  EXPECT_DOUBLE_EQ( spacing[ 1 ], 0.5 );
+  EXPECT_DOUBLE_EQ( spacing[ 2 ], 2.0 );
+  Point src_center = src_transform * Point( 4.5, 5.5, 3.5 );
+  Point permuted_center = permuted_transform * Point( 3.5, 4.5, 5.5 );
+  for ( int j = 0; j < 3; j++ ) EXPECT_DOUBLE_EQ( permuted_center[ j ], src_center[ j ] );
+
+  // The view is still lazy
+  EXPECT_FALSE( crop->is_materialized() );
+  EXPECT_FALSE( permuted->is_materialized() );
+}
+
+static void getViewData( DataBlockViewHandle view, void** data )
+{
+  *data = view->get_data();
+}
+
+TEST(DataBlockViewTest, ConcurrentFirstAccess)
+{
+  DataBlockHandle src = generateIndexedDataBlock( 64, 64, 64 );
+  std::vector< int > permutation = makePermutation( 3, -2, 1 );
+  DataBlockViewHandle view = DataBlockView::NewPermutation( src, makeGridTransform( src ), 
+    permutation );
+  ASSERT_TRUE( view );
+
+  // All threads need to see the same, completely copied data
+  const size_t num_threads = 8;
+  std::vector< void* > data( num_threads, static_cast< void* >( 0 ) );
+  boost::thread_group threads;
+  for ( size_t j = 0; j < num_threads; j++ )
+  {
+    threads.create_thread( boost::bind( &getViewData, view, &data[ j ] ) );
+  }
+  threads.join_all();
+
+  ASSERT_TRUE( data[ 0 ] != 0 );
+  for ( size_t j = 1; j < num_threads; j++ ) EXPECT_EQ( data[ j ], data[ 0 ] );
+  checkView( src, view, permutation, makeVector( 0, 0, 0 ) );
+}
@@ -0,0 +1,127 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <itkGradientMagnitudeImageFilter.h>
+#include <itkMedianImageFilter.h>
+
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/DataType.h>
+#include <Core/DataBlock/ITKImageData.h>
+#include <Core/DataBlock/ITKStreaming.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Testing/Utils/DataBlockSource.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+typedef itk::Image< float, 3 > FloatImage;
+
+// Run a filter on the full volume and in slabs of the given size, both outputs need to match
+template< class FILTER >
+static void compareStreamedFilter( typename FILTER::Pointer filter, 
+  const DataBlockHandle& input, size_t slab_size )
+{
+  ITKFloatImageDataHandle input_image( new ITKFloatImageData( input ) );
+  filter->SetInput( input_image->get_image() );
+  filter->Update();
+  FloatImage::Pointer full_output = filter->GetOutput();
+  full_output->DisconnectPipeline();
+
+  DataBlockHandle streamed = StdDataBlock::New( input->get_nx(), input->get_ny(), 
+    input->get_nz(), DataType::FLOAT_E );
+  filter->Modified();
+  ASSERT_TRUE( ITKStreaming::StreamFilter( filter.GetPointer(), streamed, slab_size ) );
+
+  const float* full_data = full_output->GetBufferPointer();
+  const float* streamed_data = reinterpret_cast< const float* >( streamed->get_data() );
+  for ( size_t j = 0; j < streamed->get_size(); j++ )
+  {
+    ASSERT_FLOAT_EQ( full_data[ j ], streamed_data[ j ] ) << "index " << j;
+  }
+}
+
+TEST( ITKStreamingTests, StreamedGradientMagnitude )
+{
+  typedef itk::GradientMagnitudeImageFilter< FloatImage, FloatImage > filter_type;
+  DataBlockHandle input = generateRandomDataBlock( 13, 11, 17, DataType::FLOAT_E, 0, 999 );
+
+  // Slab sizes that do and do not divide the number of slices
+  compareStreamedFilter< filter_type >( filter_type::New(), input, 1 );
+  compareStreamedFilter< filter_type >( filter_type::New(), input, 3 );
+  compareStreamedFilter< filter_type >( filter_type::New(), input, 17 );
+}
+
+TEST( ITKStreamingTests, StreamedMedian )
+{
+  typedef itk::MedianImageFilter< FloatImage, FloatImage > filter_type;
+  DataBlockHandle input = generateRandomDataBlock( 9, 10, 12, DataType::FLOAT_E, 0, 999 );
+
+  filter_type::Pointer filter = filter_type::New();
+  filter_type::InputSizeType radius;
+  radius.Fill( 2 );
+  filter->SetRadius( radius );
+  compareStreamedFilter< filter_type >( filter, input, 5 );
+}
+
+TEST( ITKStreamingTests, StreamWrongSize )
+{
+  typedef itk::GradientMagnitudeImageFilter< FloatImage, FloatImage > filter_type;
+  DataBlockHandle input = generateRandomDataBlock( 4, 4, 4, DataType::FLOAT_E, 0, 999 );
+  ITKFloatImageDataHandle input_image( new ITKFloatImageData( input ) );
+
+  filter_type::Pointer filter = filter_type::New();
+  filter->SetInput( input_image->get_image() );
+  DataBlockHandle output = StdDataBlock::New( 4, 4, 5, DataType::FLOAT_E );
+  EXPECT_FALSE( ITKStreaming::StreamFilter( filter.GetPointer(), output, 2 ) );
+  EXPECT_FALSE( ITKStreaming::StreamFilter( filter.GetPointer(), input, 0 ) );
+}
+
+TEST( ITKStreamingTests, RunFilterConvertsDataType )
+{
+  typedef itk::Image< double, 3 > DoubleImage;
+  typedef itk::MedianImageFilter< DoubleImage, DoubleImage > filter_type;
+  DataBlockHandle input = generateRandomDataBlock( 6, 5, 4, DataType::INT_E, 0, 999 );
+
+  filter_type::Pointer filter = filter_type::New();
+  filter_type::InputSizeType radius;
+  radius.Fill( 0 );
+  filter->SetRadius( radius );
+
+  // A median of radius zero returns the input
+  DataBlockHandle output;
+  ASSERT_TRUE( ITKStreaming::RunFilter( filter.GetPointer(), input, DataType::INT_E, output ) );
+  ASSERT_TRUE( output );
+  EXPECT_EQ( DataType::INT_E, output->get_data_type() );
+  ASSERT_EQ( input->get_size(), output->get_size() );
+  for ( size_t j = 0; j < input->get_size(); j++ )
+  {
+    EXPECT_EQ( input->get_data_at( j ), output->get_data_at( j ) );
+  }
+}
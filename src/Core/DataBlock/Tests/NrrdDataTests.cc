@@ -28,12 +28,14 @@ DEALINGS IN THE SOFTWARE.
 
 #include <gtest/gtest.h>
 
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <algorithm>
 #include <vector>
 #include <fstream>
 
 #include <Core/DataBlock/NrrdData.h>
+#include <Core/DataBlock/StdDataBlock.h>
 #include <Testing/Utils/DataBlockSource.h>
 #include <Testing/Utils/FilesystemPaths.h>
 
@@ -68,4 +70,85 @@ TEST(NrrdDataTests, DetachedNrrdFromStdDataBlockNodeCentered)
 //  std::ifstream inputfile;
 //  inputfile.exceptions( std::ifstream::failbit | std::ifstream::badbit );
   
-}
\ No newline at end of file
+}
+// Compressed nrrds are written in independently deflated blocks and read back in parallel.
+TEST(NrrdDataTests, CompressedNrrdRoundTrip)
+{
+  Core::GridTransform gridTransform( 64, 64, 600 );
+  Core::DataBlockHandle dataBlock = Core::StdDataBlock::New( gridTransform, Core::DataType::INT_E );
+  ASSERT_FALSE(dataBlock.get() == 0);
+
+  int* data = reinterpret_cast<int*>( dataBlock->get_data() );
+  for (size_t i = 0; i < dataBlock->get_size(); ++i)
+  {
+    data[i] = static_cast<int>( ( i * 7919 ) % 1021 );
+  }
+
+  Core::NrrdDataHandle nrrd =
+    Core::NrrdDataHandle( new Core::NrrdData( dataBlock, gridTransform ) );
+
+  boost::filesystem::path nrrdFile = testOutputDir() / "compressedTest.nrrd";
+
+  std::string error;
+  EXPECT_TRUE(NrrdData::SaveNrrd(nrrdFile.string(), nrrd, error, true, 6));
+  EXPECT_TRUE(error.empty());
+
+  // The block layout is only written to the file and not added to the saved nrrd
+  EXPECT_EQ(nrrdKeyValueSize(nrrd->nrrd()), 0u);
+
+  // The file is a standard gzip compressed nrrd that Teem reads on its own
+  {
+    Nrrd* teemNrrd = nrrdNew();
+    ASSERT_EQ(nrrdLoad(teemNrrd, nrrdFile.string().c_str(), 0), 0);
+    ASSERT_EQ(nrrdElementNumber(teemNrrd), dataBlock->get_size());
+    ASSERT_EQ(teemNrrd->type, nrrdTypeInt);
+    int* teemData = reinterpret_cast<int*>( teemNrrd->data );
+    EXPECT_TRUE(std::equal(data, data + dataBlock->get_size(), teemData));
+    nrrdNuke(teemNrrd);
+  }
+
+  Core::NrrdDataHandle loadedNrrd;
+  ASSERT_TRUE(NrrdData::LoadNrrd(nrrdFile.string(), loadedNrrd, error));
+  ASSERT_FALSE(loadedNrrd.get() == 0);
+  ASSERT_EQ(loadedNrrd->get_size(), dataBlock->get_size());
+  ASSERT_EQ(loadedNrrd->get_data_type(), Core::DataType::INT_E);
+
+  int* loadedData = reinterpret_cast<int*>( loadedNrrd->get_data() );
+  EXPECT_TRUE(std::equal(data, data + dataBlock->get_size(), loadedData));
+}
+
+static void RecordProgress( std::vector<double>* progress, double value )
+{
+  progress->push_back( value );
+}
+
+// The header of a compressed nrrd can be read on its own, and loading its data reports progress.
+TEST(NrrdDataTests, CompressedNrrdHeaderAndProgress)
+{
+  Core::GridTransform gridTransform( 64, 64, 600 );
+  Core::DataBlockHandle dataBlock = Core::StdDataBlock::New( gridTransform, Core::DataType::SHORT_E );
+  ASSERT_FALSE(dataBlock.get() == 0);
+  dataBlock->clear();
+
+  Core::NrrdDataHandle nrrd =
+    Core::NrrdDataHandle( new Core::NrrdData( dataBlock, gridTransform ) );
+
+  boost::filesystem::path nrrdFile = testOutputDir() / "compressedHeaderTest.nrrd";
+
+  std::string error;
+  ASSERT_TRUE(NrrdData::SaveNrrd(nrrdFile.string(), nrrd, error, true, 6));
+
+  Core::NrrdDataHandle header;
+  ASSERT_TRUE(NrrdData::LoadNrrdHeader(nrrdFile.string(), header, error));
+  EXPECT_EQ(header->get_grid_transform().get_nx(), 64u);
+  EXPECT_EQ(header->get_grid_transform().get_ny(), 64u);
+  EXPECT_EQ(header->get_grid_transform().get_nz(), 600u);
+  EXPECT_TRUE(header->get_data() == 0);
+
+  std::vector<double> progress;
+  Core::NrrdDataHandle loadedNrrd;
+  ASSERT_TRUE(NrrdData::LoadNrrd(nrrdFile.string(), loadedNrrd, error, 
+    boost::bind( &RecordProgress, &progress, _1 ) ));
+  ASSERT_FALSE(progress.empty());
+  EXPECT_DOUBLE_EQ(*std::max_element(progress.begin(), progress.end()), 1.0);
+}
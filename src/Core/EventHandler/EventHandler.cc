@@ -29,6 +29,7 @@
 // Boost includes
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
 
 
 #include <Core/Utils/Log.h>
@@ -84,7 +85,9 @@ void EventHandler::install_eventhandler_context( EventHandlerContextHandle& cont
 
 void EventHandler::post_event( boost::function< void() > function )
 {
-  EventHandle event = EventHandle( new EventT< boost::function< void() > > ( function ) );
+  ++this->event_count_;
+  EventHandle event = EventHandle( new EventT< boost::function< void() > > ( 
+    boost::bind( &EventHandler::run_queued_event, this, function ) ) );
   eventhandler_context_->post_event( event );
 }
 
@@ -96,11 +99,27 @@ void EventHandler::post_and_wait_event( boost::function< void() > function )
   }
   else
   {
-    EventHandle event = EventHandle( new EventT< boost::function< void() > > ( function ) );
+    ++this->event_count_;
+    EventHandle event = EventHandle( new EventT< boost::function< void() > > ( 
+      boost::bind( &EventHandler::run_queued_event, this, function ) ) );
     eventhandler_context_->post_and_wait_event( event );
   }
 }
 
+void EventHandler::run_queued_event( boost::function< void() > function )
+{
+  // NOTE: The event leaves the queue the moment it starts, so a long running event
+  // does not count towards the queue depth.
+  --this->event_count_;
+  function();
+}
+
+size_t EventHandler::get_event_queue_size() const
+{
+  long count = this->event_count_;
+  return count > 0 ? static_cast< size_t >( count ) : 0;
+}
+
 bool EventHandler::process_events()
 {
   // use the implementation of the application context
@@ -38,6 +38,9 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
 
+// Core includes
+#include <Core/Utils/AtomicCounter.h>
+
 // For event handling
 #include <Core/EventHandler/EventFWD.h>
 #include <Core/EventHandler/EventHandlerContext.h>
@@ -130,7 +133,20 @@ public:
   /// the application thread.
   void install_eventhandler_context( EventHandlerContextHandle& context );
 
+  // GET_EVENT_QUEUE_SIZE:
+  /// Get the number of events that have been posted, but have not started yet.
+  /// NOTE: This function is thread-safe.
+  size_t get_event_queue_size() const;
+
 private:
+  // RUN_QUEUED_EVENT:
+  // Update the queue size and run the function of an event.
+  void run_queued_event( boost::function< void() > function );
+
+  // EVENT_COUNT:
+  // Number of events that are waiting in the queue.
+  AtomicCounter event_count_;
+
 
   // EVENTHANDLERCONTEXT:
   // This is the internal representation of the handler.
@@ -38,6 +38,7 @@
 #include <Core/Utils/StackVector.h>
 #include <Core/Utils/Parallel.h>
 #include <Core/Utils/Log.h>
+#include <Core/Utils/Tracer.h>
 #include <Core/Graphics/VertexBufferObject.h>
 #include <Core/RenderResources/RenderResources.h>
 
@@ -1664,6 +1665,8 @@ void IsosurfacePrivate::upload_to_vertex_buffer()
     return;
   }
 
+  CORE_TRACE_SCOPE( "isosurface", "upload" );
+
   size_t num_of_parts = this->part_points_.size();
   bool has_values = this->values_.size() == this->points_.size();
 
@@ -1763,6 +1766,7 @@ Isosurface::Isosurface( const MaskVolumeHandle& mask_volume ) :
 void Isosurface::compute( double quality_factor, bool capping_enabled, 
   boost::function< bool () > check_abort )
 {
+  CORE_TRACE_SCOPE( "isosurface", "compute" );
   lock_type lock( this->get_mutex() );
 
   this->private_->points_.clear();
@@ -1783,6 +1787,7 @@ void Isosurface::compute( double quality_factor, bool capping_enabled,
     if( quality_factor != 1.0 )
     {
       assert( quality_factor == 0.5 || quality_factor == 0.25 || quality_factor == 0.125 );
+      CORE_TRACE_SCOPE( "isosurface", "downsample" );
       Parallel parallel_downsample( boost::bind( &IsosurfacePrivate::parallel_downsample_mask, 
         this->private_, _1, _2, _3, quality_factor ) );
       parallel_downsample.run();
@@ -1799,9 +1804,11 @@ void Isosurface::compute( double quality_factor, bool capping_enabled,
     this->private_->compute_setup();
 
     // Compute isosurface without caps
+    Core::TraceScope faces_trace( "isosurface", "compute faces" );
     Parallel parallel_faces( boost::bind( &IsosurfacePrivate::parallel_compute_faces, 
       this->private_, _1, _2, _3 ) );
     parallel_faces.run();
+    faces_trace.end();
 
     if ( check_abort() )
     {
@@ -1813,6 +1820,7 @@ void Isosurface::compute( double quality_factor, bool capping_enabled,
     // Compute isosurface caps
     if( capping_enabled )
     {
+      CORE_TRACE_SCOPE( "isosurface", "compute caps" );
       this->private_->compute_cap_faces();
     }
   }
@@ -1831,9 +1839,11 @@ void Isosurface::compute( double quality_factor, bool capping_enabled,
     this->private_->values_.push_back( val );
   }*/
 
+  Core::TraceScope normals_trace( "isosurface", "compute normals" );
   Parallel parallel_normals( boost::bind( &IsosurfacePrivate::parallel_compute_normals, 
     this->private_, _1, _2, _3 ) );
   parallel_normals.run();
+  normals_trace.end();
 
   if ( check_abort() )
   {
@@ -33,6 +33,7 @@
 
 #include <Core/Application/Application.h>
 #include <Core/Utils/ConnectionHandler.h>
+#include <Core/Utils/Tracer.h>
 #include <Core/DataBlock/DataBlock.h>
 #include <Core/LargeVolume/LargeVolumeCache.h>
 
@@ -48,6 +49,7 @@ class LargeVolumeCachePrivate : ConnectionHandler, Lockable, public EventHandler
   {
     DataBlockHandle data_block_;
     cache_access_list_type::iterator access_record_;
+    size_t generation_;
   };
 
   struct LoadJob
@@ -107,16 +109,20 @@ public:
     this->disconnect_all();
   }
 
-  void add_entry(const std::string& brick_name, DataBlockHandle data_block)
+  void add_entry(const std::string& brick_name, DataBlockHandle data_block, size_t generation )
   {
     lock_type lock( this->get_mutex() );
 
+    // Replace an entry of an older generation of the brick
+    this->remove_entry( brick_name );
+
     this->cache_access_list_.push_front( brick_name );
     this->cache_size_ += data_block->get_byte_size();
 
     CacheEntry entry;
     entry.data_block_ = data_block;
     entry.access_record_ = this->cache_access_list_.begin();
+    entry.generation_ = generation;
     this->cache_map_[ brick_name ] = entry;
 
     this->constraint_cache_size();
@@ -134,7 +140,18 @@ public:
     }
   }
 
-  bool get_entry( const std::string& brick_name, DataBlockHandle& data_block )
+  // NOTE: The cache needs to be locked when calling this function
+  void remove_entry( const std::string& brick_name )
+  {
+    cache_map_type::iterator it = this->cache_map_.find( brick_name );
+    if (it == this->cache_map_.end()) return;
+
+    this->cache_size_ -= it->second.data_block_->get_byte_size();
+    this->cache_access_list_.erase( it->second.access_record_ );
+    this->cache_map_.erase( it );
+  }
+
+  bool get_entry( const std::string& brick_name, size_t generation, DataBlockHandle& data_block )
   {
     lock_type lock( this->get_mutex() );
 
@@ -142,6 +159,13 @@ public:
     if (it == this->cache_map_.end()) 
       return false;
 
+    // The brick was rewritten after it was loaded
+    if ( it->second.generation_ != generation )
+    {
+      this->remove_entry( brick_name );
+      return false;
+    }
+
     this->cache_access_list_.erase( it->second.access_record_ );
     this->cache_access_list_.push_front( brick_name );
     it->second.access_record_ = this->cache_access_list_.begin();
@@ -150,6 +174,12 @@ public:
     return true;
   }
 
+  long long get_cache_size()
+  {
+    lock_type lock( this->get_mutex() );
+    return this->cache_size_;
+  }
+
   void clear_cache()
   {
     lock_type lock( this->get_mutex() );
@@ -175,12 +205,16 @@ public:
 
       std::string brick_name = lj.schema_->get_brick_file_name( lj.bi_ ).string();
       DataBlockHandle data_block;
-      if (! this->get_entry( brick_name, data_block )) 
+      size_t generation = lj.schema_->get_brick_generation( lj.bi_ );
+      if (! this->get_entry( brick_name, generation, data_block )) 
       {
+        CORE_TRACE_SCOPE( "largevolume", "read brick " + brick_name );
         std::string error;
-        lj.schema_->read_brick( data_block, lj.bi_, error );
-        this->add_entry( brick_name, data_block );
-        this->instance_->brick_loaded_signal_();
+        if ( lj.schema_->read_brick( data_block, lj.bi_, error ) )
+        {
+          this->add_entry( brick_name, data_block, generation );
+          this->instance_->brick_loaded_signal_();
+        }
       }
     }
 
@@ -212,7 +246,8 @@ bool LargeVolumeCache::mark_brick( LargeVolumeSchemaHandle schema, const BrickIn
   std::string brick_name = schema->get_brick_file_name( bi ).string();
 
   DataBlockHandle data_block;
-  return this->private_->get_entry( brick_name, data_block );
+  return this->private_->get_entry( brick_name, schema->get_brick_generation( bi ), 
+    data_block );
 }
 
 bool LargeVolumeCache::get_brick( LargeVolumeSchemaHandle schema, const BrickInfo& bi, 
@@ -220,11 +255,13 @@ bool LargeVolumeCache::get_brick( LargeVolumeSchemaHandle schema, const BrickInf
 {
   std::string brick_name = schema->get_brick_file_name( bi ).string();
 
-  if (this->private_->get_entry( brick_name, data_block ))
+  if (this->private_->get_entry( brick_name, schema->get_brick_generation( bi ), data_block ))
   {
+    CORE_TRACE_EVENT( "largevolume", "cache hit " + brick_name );
     return true;
   }
 
+  CORE_TRACE_EVENT( "largevolume", "cache miss " + brick_name );
   this->private_->post_event( boost::bind( &LargeVolumeCachePrivate::load_brick, this->private_, schema, bi, load_key ) );
 
   return false;
@@ -241,4 +278,14 @@ void LargeVolumeCache::clear_load_queue( const std::string& load_key )
   this->private_->post_event( boost::bind( &LargeVolumeCachePrivate::clear_load_queue, this->private_, load_key ) );
 }
 
+long long LargeVolumeCache::get_cache_size()
+{
+  return this->private_->get_cache_size();
+}
+
+long long LargeVolumeCache::get_cache_capacity()
+{
+  return this->private_->cache_capacity_;
+}
+
 } // end namespace
@@ -65,6 +65,12 @@ public:
 
   void clear_load_queue( const std::string& load_key );
 
+  /// Get the number of bytes of the bricks that are currently held in the cache.
+  long long get_cache_size();
+
+  /// Get the maximum number of bytes the cache will hold.
+  long long get_cache_capacity();
+
   boost::signals2::signal<void()> brick_loaded_signal_;
 
 private:
@@ -0,0 +1,684 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <map>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+// Core includes
+#include <Core/Application/Application.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/DataBlock/DataBlockFilter.h>
+#include <Core/Math/MathFunctions.h>
+#include <Core/Utils/Parallel.h>
+#include <Core/LargeVolume/LargeVolumeFilter.h>
+
+namespace Core
+{
+
+/// Fraction of the physical memory used for the regions that are filtered and the bricks
+/// that are cached while filtering
+const static double LARGE_VOLUME_FILTER_MEMORY_FRACTION_C = 0.25;
+
+/// Smallest number of bricks of each input kept in the cache, which covers all the 
+/// neighbors of a brick
+const static size_t LARGE_VOLUME_FILTER_MIN_CACHED_BRICKS_C = 27;
+
+typedef IndexVector::index_type index_type;
+
+//////////////////////////////////////////////////////////////////////////
+// Class LargeVolumeFilterBrickCache
+//////////////////////////////////////////////////////////////////////////
+
+// CLASS LargeVolumeFilterBrickCache:
+/// Least recently used cache of the bricks of the inputs, so the bricks shared by the halos
+/// of neighboring bricks are only read and decompressed once.
+class LargeVolumeFilterBrickCache : public boost::noncopyable
+{
+public:
+  typedef std::pair< size_t, std::pair< index_type, index_type > > key_type;
+  typedef std::list< key_type > lru_list_type;
+  typedef std::map< key_type, std::pair< DataBlockHandle, lru_list_type::iterator > > 
+    cache_type;
+
+  explicit LargeVolumeFilterBrickCache( long long capacity ) :
+    capacity_( capacity ),
+    size_( 0 )
+  {
+  }
+
+  bool read_brick( size_t input, LargeVolumeSchemaHandle schema, DataBlockHandle& brick, 
+    const BrickInfo& bi, std::string& error )
+  {
+    key_type key( input, std::make_pair( bi.level_, bi.index_ ) );
+    {
+      boost::mutex::scoped_lock lock( this->mutex_ );
+      cache_type::iterator it = this->cache_.find( key );
+      if ( it != this->cache_.end() )
+      {
+        this->lru_.splice( this->lru_.end(), this->lru_, it->second.second );
+        brick = it->second.first;
+        return true;
+      }
+    }
+
+    // Read outside of the lock, the other threads can continue meanwhile
+    if ( !schema->read_brick( brick, bi, error ) ) return false;
+
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    if ( this->cache_.find( key ) != this->cache_.end() ) return true;
+
+    this->lru_.push_back( key );
+    this->cache_[ key ] = std::make_pair( brick, --this->lru_.end() );
+    this->size_ += static_cast<long long>( brick->get_byte_size() );
+
+    while ( this->size_ > this->capacity_ && this->lru_.size() > 1 )
+    {
+      cache_type::iterator it = this->cache_.find( this->lru_.front() );
+      this->size_ -= static_cast<long long>( it->second.first->get_byte_size() );
+      this->cache_.erase( it );
+      this->lru_.pop_front();
+    }
+
+    return true;
+  }
+
+private:
+  boost::mutex mutex_;
+  lru_list_type lru_;
+  cache_type cache_;
+  long long capacity_;
+  long long size_;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Class LargeVolumeFilterRun
+//////////////////////////////////////////////////////////////////////////
+
+template< class T >
+static void ExtractBrick( const DataBlockHandle& region, const IndexVector& region_start,
+  DataBlockHandle& brick, const IndexVector& brick_start, const IndexVector& size, 
+  double& min_value, double& max_value )
+{
+  const T* src = reinterpret_cast<const T*>( region->get_data() );
+  T* dst = reinterpret_cast<T*>( brick->get_data() );
+
+  const index_type rnx = static_cast<index_type>( region->get_nx() );
+  const index_type rny = static_cast<index_type>( region->get_ny() );
+  const index_type bnx = static_cast<index_type>( brick->get_nx() );
+  const index_type bny = static_cast<index_type>( brick->get_ny() );
+  const index_type bnz = static_cast<index_type>( brick->get_nz() );
+
+  for ( index_type z = 0; z < bnz; z++ )
+  {
+    const index_type gz = brick_start.z() + z;
+    for ( index_type y = 0; y < bny; y++ )
+    {
+      const index_type gy = brick_start.y() + y;
+      for ( index_type x = 0; x < bnx; x++, dst++ )
+      {
+        const index_type gx = brick_start.x() + x;
+        
+        // Overlap outside of the volume is padded with zeros
+        if ( gx < 0 || gy < 0 || gz < 0 || gx >= size.x() || gy >= size.y() || 
+          gz >= size.z() )
+        {
+          *dst = T( 0 );
+          continue;
+        }
+
+        *dst = src[ ( ( gz - region_start.z() ) * rny + ( gy - region_start.y() ) ) * rnx +
+          ( gx - region_start.x() ) ];
+        min_value = Min( min_value, static_cast<double>( *dst ) );
+        max_value = Max( max_value, static_cast<double>( *dst ) );
+      }
+    }
+  }
+}
+
+// CLASS LargeVolumeFilterRun:
+/// State shared by the threads that filter the bricks.
+class LargeVolumeFilterRun : public boost::noncopyable
+{
+public:
+  std::vector<LargeVolumeSchemaHandle> src_schemas_;
+  LargeVolumeSchemaHandle dst_schema_;
+  size_t halo_;
+  LargeVolumeFilter::region_filter_type filter_;
+  LargeVolumeFilter::abort_function_type abort_function_;
+  LargeVolumeFilter::progress_function_type progress_function_;
+  boost::shared_ptr<LargeVolumeFilterBrickCache> cache_;
+
+  boost::mutex mutex_;
+  index_type level_;
+  size_t next_brick_;
+  size_t bricks_done_;
+  size_t total_bricks_;
+  bool success_;
+  std::string error_;
+  double min_;
+  double max_;
+
+public:
+  bool get_next_brick( BrickInfo& bi )
+  {
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    if ( !this->success_ ) return false;
+    if ( this->next_brick_ >= this->dst_schema_->compute_level_num_bricks( this->level_ ) ) 
+    {
+      return false;
+    }
+    bi = BrickInfo( static_cast<index_type>( this->next_brick_++ ), this->level_ );
+    return true;
+  }
+
+  void finish_brick( int thread )
+  {
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    this->bricks_done_++;
+    if ( thread == 0 && this->progress_function_ )
+    {
+      this->progress_function_( static_cast<double>( this->bricks_done_ ) / 
+        this->total_bricks_ );
+    }
+  }
+
+  void fail( const std::string& error )
+  {
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    if ( this->success_ ) this->error_ = error;
+    this->success_ = false;
+  }
+
+  bool filter_brick( const BrickInfo& bi, double& min_value, double& max_value, 
+    std::string& error )
+  {
+    const IndexVector& size = this->dst_schema_->get_size();
+    const IndexVector& eff_brick_size = this->dst_schema_->get_effective_brick_size();
+    const IndexVector layout = this->dst_schema_->get_level_layout( 0 );
+    const IndexVector brick_size = this->dst_schema_->get_brick_size( bi );
+    const index_type overlap = static_cast<index_type>( this->dst_schema_->get_overlap() );
+    const index_type halo = static_cast<index_type>( this->halo_ );
+
+    const IndexVector index( bi.index_ % layout.x(), ( bi.index_ / layout.x() ) % layout.y(),
+      bi.index_ / ( layout.x() * layout.y() ) );
+
+    // The brick including its overlap, and the region needed to filter it
+    IndexVector brick_start, region_start, region_end;
+    for ( size_t j = 0; j < 3; j++ )
+    {
+      brick_start[ j ] = index[ j ] * eff_brick_size[ j ] - overlap;
+      region_start[ j ] = Max( static_cast<index_type>( 0 ), brick_start[ j ] - halo );
+      region_end[ j ] = Min( size[ j ], brick_start[ j ] + brick_size[ j ] + halo );
+    }
+
+    std::vector<DataBlockHandle> regions( this->src_schemas_.size() );
+    for ( size_t j = 0; j < this->src_schemas_.size(); j++ )
+    {
+      if ( !this->src_schemas_[ j ]->read_region( regions[ j ], 0, region_start, region_end,
+        error, boost::bind( &LargeVolumeFilterBrickCache::read_brick, this->cache_, j, 
+        this->src_schemas_[ j ], _1, _2, _3 ) ) )
+      {
+        return false;
+      }
+    }
+
+    DataBlockHandle result;
+    if ( !this->filter_( regions, result ) || !result )
+    {
+      error = "Could not filter brick.";
+      return false;
+    }
+    regions.clear();
+
+    if ( result->get_data_type() != this->dst_schema_->get_data_type() ||
+      static_cast<index_type>( result->get_nx() ) != region_end.x() - region_start.x() ||
+      static_cast<index_type>( result->get_ny() ) != region_end.y() - region_start.y() ||
+      static_cast<index_type>( result->get_nz() ) != region_end.z() - region_start.z() )
+    {
+      error = "Filter returned a region of the wrong size or data type.";
+      return false;
+    }
+
+    DataBlockHandle brick = StdDataBlock::New( brick_size.x(), brick_size.y(), 
+      brick_size.z(), result->get_data_type() );
+    if ( !brick )
+    {
+      error = "Could not allocate brick.";
+      return false;
+    }
+
+    switch ( result->get_data_type() )
+    {
+    case DataType::UCHAR_E:
+      ExtractBrick<unsigned char>( result, region_start, brick, brick_start, size, 
+        min_value, max_value );
+      break;
+    case DataType::CHAR_E:
+      ExtractBrick<signed char>( result, region_start, brick, brick_start, size, 
+        min_value, max_value );
+      break;
+    case DataType::USHORT_E:
+      ExtractBrick<unsigned short>( result, region_start, brick, brick_start, size, 
+        min_value, max_value );
+      break;
+    case DataType::SHORT_E:
+      ExtractBrick<short>( result, region_start, brick, brick_start, size, 
+        min_value, max_value );
+      break;
+    case DataType::UINT_E:
+      ExtractBrick<unsigned int>( result, region_start, brick, brick_start, size, 
+        min_value, max_value );
+      break;
+    case DataType::INT_E:
+      ExtractBrick<int>( result, region_start, brick, brick_start, size, 
+        min_value, max_value );
+      break;
+    case DataType::FLOAT_E:
+      ExtractBrick<float>( result, region_start, brick, brick_start, size, 
+        min_value, max_value );
+      break;
+    case DataType::DOUBLE_E:
+      ExtractBrick<double>( result, region_start, brick, brick_start, size, 
+        min_value, max_value );
+      break;
+    default:
+      error = "Unknown data type.";
+      return false;
+    }
+
+    return this->dst_schema_->write_brick( brick, bi, error );
+  }
+
+  void run_parallel( int thread, int num_threads, boost::barrier& barrier )
+  {
+    double min_value = std::numeric_limits<double>::max();
+    double max_value = -std::numeric_limits<double>::max();
+
+    BrickInfo bi( 0, 0 );
+    while ( this->get_next_brick( bi ) )
+    {
+      if ( this->abort_function_ && this->abort_function_() )
+      {
+        this->fail( "Filter was aborted." );
+        break;
+      }
+
+      std::string error;
+      bool success = this->level_ == 0 ? 
+        this->filter_brick( bi, min_value, max_value, error ) :
+        this->dst_schema_->build_brick( bi, error );
+      if ( !success )
+      {
+        this->fail( error );
+        break;
+      }
+
+      this->finish_brick( thread );
+    }
+
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    this->min_ = Min( this->min_, min_value );
+    this->max_ = Max( this->max_, max_value );
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Region filters
+//////////////////////////////////////////////////////////////////////////
+
+template< class T >
+static void ThresholdRegion( const DataBlockHandle& src, DataBlockHandle& dst, 
+  double lower, double upper )
+{
+  const T* src_data = reinterpret_cast<const T*>( src->get_data() );
+  unsigned char* dst_data = reinterpret_cast<unsigned char*>( dst->get_data() );
+  size_t size = src->get_size();
+  for ( size_t j = 0; j < size; j++ )
+  {
+    double value = static_cast<double>( src_data[ j ] );
+    dst_data[ j ] = ( value >= lower && value <= upper ) ? 1 : 0;
+  }
+}
+
+template< class T >
+static void MaskRegion( const DataBlockHandle& src, std::vector<unsigned char>& mask )
+{
+  const T* src_data = reinterpret_cast<const T*>( src->get_data() );
+  size_t size = src->get_size();
+  mask.resize( size );
+  for ( size_t j = 0; j < size; j++ )
+  {
+    mask[ j ] = src_data[ j ] != T( 0 ) ? 1 : 0;
+  }
+}
+
+static bool FilterThreshold( const std::vector<DataBlockHandle>& src, DataBlockHandle& dst,
+  double lower, double upper )
+{
+  if ( src.size() != 1 ) return false;
+
+  dst = StdDataBlock::New( src[ 0 ]->get_nx(), src[ 0 ]->get_ny(), src[ 0 ]->get_nz(),
+    DataType::UCHAR_E );
+  if ( !dst ) return false;
+
+  switch ( src[ 0 ]->get_data_type() )
+  {
+  case DataType::UCHAR_E:
+    ThresholdRegion<unsigned char>( src[ 0 ], dst, lower, upper );
+    return true;
+  case DataType::CHAR_E:
+    ThresholdRegion<signed char>( src[ 0 ], dst, lower, upper );
+    return true;
+  case DataType::USHORT_E:
+    ThresholdRegion<unsigned short>( src[ 0 ], dst, lower, upper );
+    return true;
+  case DataType::SHORT_E:
+    ThresholdRegion<short>( src[ 0 ], dst, lower, upper );
+    return true;
+  case DataType::UINT_E:
+    ThresholdRegion<unsigned int>( src[ 0 ], dst, lower, upper );
+    return true;
+  case DataType::INT_E:
+    ThresholdRegion<int>( src[ 0 ], dst, lower, upper );
+    return true;
+  case DataType::FLOAT_E:
+    ThresholdRegion<float>( src[ 0 ], dst, lower, upper );
+    return true;
+  case DataType::DOUBLE_E:
+    ThresholdRegion<double>( src[ 0 ], dst, lower, upper );
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool FilterMask( const DataBlockHandle& src, std::vector<unsigned char>& mask )
+{
+  switch ( src->get_data_type() )
+  {
+  case DataType::UCHAR_E:
+    MaskRegion<unsigned char>( src, mask );
+    return true;
+  case DataType::CHAR_E:
+    MaskRegion<signed char>( src, mask );
+    return true;
+  case DataType::USHORT_E:
+    MaskRegion<unsigned short>( src, mask );
+    return true;
+  case DataType::SHORT_E:
+    MaskRegion<short>( src, mask );
+    return true;
+  case DataType::UINT_E:
+    MaskRegion<unsigned int>( src, mask );
+    return true;
+  case DataType::INT_E:
+    MaskRegion<int>( src, mask );
+    return true;
+  case DataType::FLOAT_E:
+    MaskRegion<float>( src, mask );
+    return true;
+  case DataType::DOUBLE_E:
+    MaskRegion<double>( src, mask );
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool FilterBoolean( const std::vector<DataBlockHandle>& src, DataBlockHandle& dst,
+  LargeVolumeFilter::boolean_type boolean )
+{
+  if ( src.size() != 2 ) return false;
+
+  std::vector<unsigned char> mask1, mask2;
+  if ( !FilterMask( src[ 0 ], mask1 ) || !FilterMask( src[ 1 ], mask2 ) ) return false;
+
+  dst = StdDataBlock::New( src[ 0 ]->get_nx(), src[ 0 ]->get_ny(), src[ 0 ]->get_nz(),
+    DataType::UCHAR_E );
+  if ( !dst ) return false;
+
+  unsigned char* dst_data = reinterpret_cast<unsigned char*>( dst->get_data() );
+  size_t size = dst->get_size();
+  for ( size_t j = 0; j < size; j++ )
+  {
+    switch ( boolean )
+    {
+    case LargeVolumeFilter::AND_E:
+      dst_data[ j ] = mask1[ j ] & mask2[ j ];
+      break;
+    case LargeVolumeFilter::OR_E:
+      dst_data[ j ] = mask1[ j ] | mask2[ j ];
+      break;
+    case LargeVolumeFilter::XOR_E:
+      dst_data[ j ] = mask1[ j ] ^ mask2[ j ];
+      break;
+    case LargeVolumeFilter::REMOVE_E:
+      dst_data[ j ] = mask1[ j ] & ( 1 - mask2[ j ] );
+      break;
+    }
+  }
+
+  return true;
+}
+
+static bool FilterMean( const std::vector<DataBlockHandle>& src, DataBlockHandle& dst,
+  int radius )
+{
+  if ( src.size() != 1 ) return false;
+  return DataBlockFilter::MeanFilter( src[ 0 ], dst, radius, 
+    DataBlockFilter::abort_function_type(), DataBlockFilter::progress_function_type(), 1 );
+}
+
+static bool FilterMedian( const std::vector<DataBlockHandle>& src, DataBlockHandle& dst,
+  int radius )
+{
+  if ( src.size() != 1 ) return false;
+  return DataBlockFilter::MedianFilter( src[ 0 ], dst, radius, 
+    DataBlockFilter::abort_function_type(), DataBlockFilter::progress_function_type(), 1 );
+}
+
+static bool FilterGaussian( const std::vector<DataBlockHandle>& src, DataBlockHandle& dst,
+  double sigma )
+{
+  if ( src.size() != 1 ) return false;
+  // NOTE: The recursive filter of large sigmas responds to every voxel of a line, hence
+  // bricks need the explicit kernel to match smoothing the full volume within their halo
+  return DataBlockFilter::GaussianKernelFilter( src[ 0 ], dst, sigma, 
+    DataBlockFilter::abort_function_type(), DataBlockFilter::progress_function_type(), 1 );
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Class LargeVolumeFilter
+//////////////////////////////////////////////////////////////////////////
+
+LargeVolumeSchemaHandle LargeVolumeFilter::CreateSchema( 
+  const LargeVolumeSchemaHandle& src_schema, const boost::filesystem::path& dir, 
+  DataType data_type )
+{
+  LargeVolumeSchemaHandle schema( new LargeVolumeSchema );
+  schema->set_dir( dir );
+  schema->set_parameters( src_schema->get_size(), src_schema->get_spacing(), 
+    src_schema->get_origin(), src_schema->get_brick_size(), src_schema->get_overlap(), 
+    data_type );
+  schema->set_compression( src_schema->is_compressed() );
+
+  std::vector<IndexVector> levels;
+  for ( size_t j = 0; j < src_schema->get_num_levels(); j++ )
+  {
+    levels.push_back( src_schema->get_level_downsample_ratio( j ) );
+  }
+  schema->set_levels( levels );
+
+  return schema;
+}
+
+bool LargeVolumeFilter::Run( const std::vector<LargeVolumeSchemaHandle>& src_schemas, 
+  const LargeVolumeSchemaHandle& dst_schema, size_t halo, size_t filter_memory, 
+  const region_filter_type& filter, std::string& error, const abort_function_type& abort_function, 
+  const progress_function_type& progress_function )
+{
+  error = "";
+
+  if ( src_schemas.empty() || !dst_schema || !filter )
+  {
+    error = "No volume to filter.";
+    return false;
+  }
+
+  for ( size_t j = 0; j < src_schemas.size(); j++ )
+  {
+    if ( src_schemas[ j ]->get_size() != dst_schema->get_size() ||
+      src_schemas[ j ]->get_brick_size() != dst_schema->get_brick_size() ||
+      src_schemas[ j ]->get_overlap() != dst_schema->get_overlap() )
+    {
+      error = "Volumes need to have the same size and bricks.";
+      return false;
+    }
+  }
+
+  if ( !dst_schema->save( error ) ) return false;
+
+  LargeVolumeFilterRun run;
+  run.src_schemas_ = src_schemas;
+  run.dst_schema_ = dst_schema;
+  run.halo_ = halo;
+  run.filter_ = filter;
+  run.abort_function_ = abort_function;
+  run.progress_function_ = progress_function;
+  run.bricks_done_ = 0;
+  run.total_bricks_ = 0;
+  run.success_ = true;
+  run.min_ = std::numeric_limits<double>::max();
+  run.max_ = -std::numeric_limits<double>::max();
+
+  for ( size_t j = 0; j < dst_schema->get_num_levels(); j++ )
+  {
+    run.total_bricks_ += dst_schema->compute_level_num_bricks( j );
+  }
+
+  // Each thread holds the regions of the inputs, the filtered region, which may be of type
+  // float or double, and the working memory of the filter. The cache gets the rest of the
+  // memory budget. The region filters run on a single thread each, as the bricks are 
+  // already filtered in parallel.
+  const IndexVector& brick_size = dst_schema->get_brick_size();
+  long long region_voxels = 1;
+  for ( size_t j = 0; j < 3; j++ )
+  {
+    region_voxels *= brick_size[ j ] + 2 * static_cast<long long>( halo );
+  }
+  long long region_bytes = region_voxels * ( 2 * sizeof( double ) ) + 
+    static_cast<long long>( filter_memory );
+  long long brick_bytes = static_cast<long long>( brick_size.x() ) * brick_size.y() * 
+    brick_size.z() * GetSizeDataType( dst_schema->get_data_type() );
+  for ( size_t j = 0; j < src_schemas.size(); j++ )
+  {
+    region_bytes += region_voxels * GetSizeDataType( src_schemas[ j ]->get_data_type() );
+  }
+
+  long long memory = static_cast<long long>( LARGE_VOLUME_FILTER_MEMORY_FRACTION_C * 
+    Application::Instance()->get_total_addressable_physical_memory() );
+  long long cache_bytes = LARGE_VOLUME_FILTER_MIN_CACHED_BRICKS_C * src_schemas.size() * 
+    brick_bytes;
+
+  int num_threads = static_cast<int>( boost::thread::hardware_concurrency() );
+  num_threads = Max( 1, Min( num_threads, static_cast<int>( 
+    ( memory - cache_bytes ) / Max( region_bytes, 1LL ) ) ) );
+  cache_bytes = Max( cache_bytes, memory - num_threads * region_bytes );
+  run.cache_.reset( new LargeVolumeFilterBrickCache( cache_bytes ) );
+
+  // Filter the bricks at full resolution, then rebuild the levels one at a time as each 
+  // level depends on the one below it
+  for ( size_t j = 0; j < dst_schema->get_num_levels() && run.success_; j++ )
+  {
+    run.level_ = static_cast<index_type>( j );
+    run.next_brick_ = 0;
+    
+    Parallel parallel( boost::bind( &LargeVolumeFilterRun::run_parallel, &run, _1, _2, _3 ),
+      num_threads );
+    parallel.run();
+    
+    if ( j == 0 ) run.cache_.reset();
+  }
+
+  if ( !run.success_ )
+  {
+    error = run.error_;
+    return false;
+  }
+
+  if ( run.min_ > run.max_ ) run.min_ = run.max_ = 0.0;
+  dst_schema->set_min_max( run.min_, run.max_ );
+
+  return dst_schema->save( error );
+}
+
+LargeVolumeFilter::region_filter_type LargeVolumeFilter::ThresholdFilter( double lower, 
+  double upper )
+{
+  return boost::bind( &FilterThreshold, _1, _2, lower, upper );
+}
+
+LargeVolumeFilter::region_filter_type LargeVolumeFilter::MeanFilter( int radius )
+{
+  return boost::bind( &FilterMean, _1, _2, radius );
+}
+
+LargeVolumeFilter::region_filter_type LargeVolumeFilter::MedianFilter( int radius )
+{
+  return boost::bind( &FilterMedian, _1, _2, radius );
+}
+
+LargeVolumeFilter::region_filter_type LargeVolumeFilter::GaussianFilter( double sigma )
+{
+  return boost::bind( &FilterGaussian, _1, _2, sigma );
+}
+
+size_t LargeVolumeFilter::GetMedianFilterMemory( const IndexVector& brick_size, int radius )
+{
+  return DataBlockFilter::GetMedianFilterMemory( static_cast<size_t>( brick_size.x() ) + 
+    2 * static_cast<size_t>( Max( radius, 0 ) ) );
+}
+
+size_t LargeVolumeFilter::GetGaussianHalo( double sigma )
+{
+  return static_cast<size_t>( DataBlockFilter::GetGaussianKernelRadius( sigma ) );
+}
+
+LargeVolumeFilter::region_filter_type LargeVolumeFilter::BooleanFilter( boolean_type boolean )
+{
+  return boost::bind( &FilterBoolean, _1, _2, boolean );
+}
+
+} // end namespace Core
@@ -0,0 +1,136 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_LARGEVOLUME_LARGEVOLUMEFILTER_H
+#define CORE_LARGEVOLUME_LARGEVOLUMEFILTER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+
+namespace Core
+{
+
+// CLASS LargeVolumeFilter:
+/// Runs filters on large volumes brick by brick, without ever loading the full volume. Each
+/// brick of the highest resolution is filtered together with a halo of voxels around it that
+/// is large enough for the filter to give the same result as on the full volume. The result
+/// is written into a new volume with the same bricks, after which its downsampled levels are
+/// rebuilt from the filtered bricks.
+class LargeVolumeFilter : public boost::noncopyable
+{
+public:
+  /// Function that is polled to check whether the filter needs to be aborted
+  typedef boost::function< bool () > abort_function_type;
+
+  /// Function that is called with the fraction of the volume that has been processed
+  typedef boost::function< void ( double ) > progress_function_type;
+
+  /// Function that filters a region. It gets a region of each of the inputs, which are all of
+  /// the same size, and needs to return a region of that size as well.
+  typedef boost::function< bool ( const std::vector<DataBlockHandle>&, DataBlockHandle& ) > 
+    region_filter_type;
+
+  /// The operations of BooleanFilter
+  enum boolean_type
+  {
+    AND_E,
+    OR_E,
+    XOR_E,
+    REMOVE_E
+  };
+
+  // CREATESCHEMA:
+  /// Create the schema of a volume with the same size, bricks and levels as the source, but
+  /// with a different data type, in the given directory. Nothing is written until the
+  /// schema is passed to Run.
+  static LargeVolumeSchemaHandle CreateSchema( const LargeVolumeSchemaHandle& src_schema,
+    const boost::filesystem::path& dir, DataType data_type );
+
+  // RUN:
+  /// Filter the inputs, which need to have the same size and bricks, into the destination
+  /// schema, which is saved into its directory first. Halo is the number of voxels outside a
+  /// brick the filter needs to compute it.
+  /// Filter_memory is the memory the filter uses for each region in addition to the regions
+  /// of the inputs and the output, which limits the number of bricks filtered at once.
+  static bool Run( const std::vector<LargeVolumeSchemaHandle>& src_schemas, 
+    const LargeVolumeSchemaHandle& dst_schema, size_t halo, size_t filter_memory,
+    const region_filter_type& filter, std::string& error,
+    const abort_function_type& abort_function = abort_function_type(),
+    const progress_function_type& progress_function = progress_function_type() );
+
+  // THRESHOLDFILTER:
+  /// Voxels within [lower, upper] become 1, all others 0. The output is of type unsigned char.
+  static region_filter_type ThresholdFilter( double lower, double upper );
+
+  // MEANFILTER:
+  /// Mean over a box of ( 2 * radius + 1 )^3 voxels, see DataBlockFilter::MeanFilter.
+  static region_filter_type MeanFilter( int radius );
+
+  // MEDIANFILTER:
+  /// Median over a box of ( 2 * radius + 1 )^3 voxels, see DataBlockFilter::MedianFilter.
+  static region_filter_type MedianFilter( int radius );
+
+  // GETMEDIANFILTERMEMORY:
+  /// The memory MedianFilter uses for the histograms of each region of a volume with the 
+  /// given bricks.
+  static size_t GetMedianFilterMemory( const IndexVector& brick_size, int radius );
+
+  // GAUSSIANFILTER:
+  /// Gaussian smoothing with a standard deviation of sigma voxels, see 
+  /// DataBlockFilter::GaussianKernelFilter. Unlike the recursive filter used for large 
+  /// sigmas on data blocks, its explicit kernel gives the same result brick by brick as on
+  /// the full volume.
+  static region_filter_type GaussianFilter( double sigma );
+
+  // GETGAUSSIANHALO:
+  /// The halo GaussianFilter needs to match smoothing the full volume.
+  static size_t GetGaussianHalo( double sigma );
+
+  // BOOLEANFILTER:
+  /// Combine two volumes that are interpreted as masks, where any value other than zero is
+  /// inside the mask. The output is of type unsigned char.
+  static region_filter_type BooleanFilter( boolean_type boolean );
+};
+
+} // end namespace Core
+
+#endif
@@ -30,8 +30,13 @@
 
 #include <limits>
 #include <fstream>
+#include <sstream>
 #include <set>
 #include <queue>
+#include <map>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
 
 // test
 #include <iostream>
@@ -41,6 +46,7 @@
 #include <Core/Utils/StringUtil.h>
 #include <Core/Math/MathFunctions.h>
 #include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Utils/Parallel.h>
 
 #include <Core/LargeVolume/LargeVolumeSchema.h>
 #include <Core/LargeVolume/LargeVolumeCache.h>
@@ -50,6 +56,55 @@ namespace bfs=boost::filesystem;
 namespace Core
 {
 
+// File next to the volume file that records the generation of each rewritten brick
+const static char* const GENERATION_FILE_NAME_C = "generations.txt";
+
+// File next to the volume file that records the bricks whose update has not finished yet
+const static char* const PENDING_FILE_NAME_C = "pending.txt";
+
+// WRITEFILE:
+// Write a file next to the destination and move it over the destination once it has been
+// written completely, so the destination is never left half written.
+static bool WriteFile( const bfs::path& filename, const char* data, size_t size, 
+  std::string& error )
+{
+  bfs::path temp_file = filename.string() + ".tmp";
+
+  bool success = false;
+  try
+  {
+    std::ofstream output( temp_file.string().c_str(), 
+      std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
+    output.write( data, size );
+    output.close();
+    success = !output.fail();
+  }
+  catch ( ... )
+  {
+  }
+
+  if ( success )
+  {
+    try
+    {
+      bfs::rename( temp_file, filename );
+      return true;
+    }
+    catch ( ... )
+    {
+      error = "Could not replace file '" + filename.string() + "'.";
+    }
+  }
+  else
+  {
+    error = "Could not write to file '" + temp_file.string() + "'.";
+  }
+
+  boost::system::error_code ec;
+  bfs::remove( temp_file, ec );
+  return false;
+}
+
 class LargeVolumeSchemaPrivate {
 
 public:
@@ -69,7 +124,8 @@ public:
     downsample_y_( true ),
     downsample_z_( true ),
     min_( 0.0 ),
-    max_( 0.0 )
+    max_( 0.0 ),
+    generation_( 0 )
   {
   }
 
@@ -171,6 +227,38 @@ public:
   void load_and_substitue_missing_bricks( std::vector<BrickInfo>& want_to_render, SliceType slice, 
     double depth, const std::string& load_key, std::vector<BrickInfo>& current_render );
 
+  typedef std::set< std::pair< index_type, index_type > > brick_set_type;
+
+  // COMPUTE_DEPENDENT_BRICKS:
+  // Find the bricks of the next level that depend on the given bricks of a level. This is the
+  // parent of each brick, as well as the neighbors of the parent whose overlap covers part of
+  // the brick.
+  void compute_dependent_bricks( index_type level, const brick_set_type& bricks, 
+    brick_set_type& dependents );
+
+  // ADD_NEIGHBOR_BRICKS:
+  // Add the bricks whose overlap holds a copy of part of the interior of the given bricks.
+  void add_neighbor_bricks( index_type level, brick_set_type& bricks );
+
+  // LOAD_GENERATIONS:
+  // Read the generation of each brick and the pending bricks from the generation and pending
+  // files, if there are any.
+  bool load_generations( std::string& error );
+
+  // SAVE_GENERATIONS:
+  // Write the generation of each brick and the pending bricks to the generation and pending
+  // files.
+  bool save_generations( std::string& error );
+
+  // MARK_BRICKS:
+  // Set the generation of the given bricks and store it with the volume.
+  bool mark_bricks( const brick_set_type& bricks, size_t generation, std::string& error );
+
+  // MARK_PENDING:
+  // Add or remove bricks of the highest resolution from the bricks whose update has not 
+  // finished and store them with the volume.
+  bool mark_pending( const brick_set_type& bricks, bool pending, std::string& error );
+
   // -- contents in the text header --
 public:
   IndexVector size_;
@@ -198,6 +286,16 @@ public:
 
   double min_;
   double max_;
+
+  // -- generation of the bricks --
+public:
+  typedef std::map< std::pair< index_type, index_type >, size_t > brick_generation_map_type;
+  
+  size_t generation_;
+  brick_generation_map_type brick_generation_;
+  // Bricks of the highest resolution that update_levels started on, but did not finish
+  brick_set_type pending_bricks_;
+  boost::mutex generation_mutex_;
   
   bfs::path dir_;
   LargeVolumeSchema* schema_;
@@ -309,6 +407,261 @@ bool LargeVolumeSchemaPrivate::insert_brick_internals( DataBlockHandle volume, D
   return true;
 }
 
+bool LargeVolumeSchemaPrivate::insert_brick( DataBlockHandle volume, DataBlockHandle brick,
+  const IndexVector& offset, const IndexVector& clip_start, const IndexVector& clip_end )
+{
+  switch ( volume->get_data_type() )
+  {
+  case DataType::UCHAR_E:
+    return this->insert_brick_internals<unsigned char>( volume, brick, offset, clip_start, clip_end );
+  case DataType::CHAR_E:
+    return this->insert_brick_internals<signed char>( volume, brick, offset, clip_start, clip_end );
+  case DataType::USHORT_E:
+    return this->insert_brick_internals<unsigned short>( volume, brick, offset, clip_start, clip_end );
+  case DataType::SHORT_E:
+    return this->insert_brick_internals<short>( volume, brick, offset, clip_start, clip_end );
+  case DataType::UINT_E:
+    return this->insert_brick_internals<unsigned int>( volume, brick, offset, clip_start, clip_end );
+  case DataType::INT_E:
+    return this->insert_brick_internals<int>( volume, brick, offset, clip_start, clip_end );
+  case DataType::FLOAT_E:
+    return this->insert_brick_internals<float>( volume, brick, offset, clip_start, clip_end );
+  case DataType::DOUBLE_E:
+    return this->insert_brick_internals<double>( volume, brick, offset, clip_start, clip_end );
+  }
+
+  return false;
+}
+
+void LargeVolumeSchemaPrivate::compute_dependent_bricks( index_type level, 
+  const brick_set_type& bricks, brick_set_type& dependents )
+{
+  dependents.clear();
+
+  const index_type overlap = static_cast<index_type>( this->overlap_ );
+  const IndexVector& eff_brick_size = this->effective_brick_size_;
+  const IndexVector& layout = this->level_layout_[ level ];
+  const IndexVector& next_layout = this->level_layout_[ level + 1 ];
+  const IndexVector& ratio_src = this->levels_[ level ];
+  const IndexVector& ratio_dst = this->levels_[ level + 1 ];
+    
+  brick_set_type::const_iterator it = bricks.begin();
+  for ( ; it != bricks.end(); ++it )
+  {
+    BrickInfo bi( it->second, level );
+    IndexVector index = this->compute_brick_index_vector( layout, bi.index_ );
+    IndexVector interior_size = this->schema_->get_brick_size( bi ) - 
+      IndexVector( 2 * overlap, 2 * overlap, 2 * overlap );
+
+    IndexVector parent_start, parent_end;
+    for ( size_t k = 0; k < 3; k++ )
+    {
+      const index_type ratio = ratio_dst[ k ] / ratio_src[ k ];
+      const index_type start = ( index[ k ] * eff_brick_size[ k ] ) / ratio;
+      const index_type end = ( index[ k ] * eff_brick_size[ k ] + interior_size[ k ] - 1 ) / 
+        ratio + 1;
+      parent_start[ k ] = Max( static_cast<index_type>( 0 ), start - overlap ) / 
+        eff_brick_size[ k ];
+      parent_end[ k ] = Min( next_layout[ k ], ( end + overlap - 1 ) / 
+        eff_brick_size[ k ] + 1 );
+    }
+
+    for ( index_type z = parent_start.z(); z < parent_end.z(); z++ )
+    {
+      for ( index_type y = parent_start.y(); y < parent_end.y(); y++ )
+      {
+        for ( index_type x = parent_start.x(); x < parent_end.x(); x++ )
+        {
+          dependents.insert( std::make_pair( level + 1, 
+            z * next_layout.x() * next_layout.y() + y * next_layout.x() + x ) );
+        }
+      }
+    }
+  }
+}
+
+void LargeVolumeSchemaPrivate::add_neighbor_bricks( index_type level, brick_set_type& bricks )
+{
+  // The overlap is smaller than a brick, hence only the direct neighbors hold copies
+  if ( this->overlap_ == 0 ) return;
+
+  const IndexVector& layout = this->level_layout_[ level ];
+  brick_set_type neighbors;
+
+  brick_set_type::const_iterator it = bricks.begin();
+  for ( ; it != bricks.end(); ++it )
+  {
+    IndexVector index = this->compute_brick_index_vector( layout, it->second );
+    IndexVector start, end;
+    for ( size_t k = 0; k < 3; k++ )
+    {
+      start[ k ] = Max( static_cast<index_type>( 0 ), index[ k ] - 1 );
+      end[ k ] = Min( layout[ k ], index[ k ] + 2 );
+    }
+
+    for ( index_type z = start.z(); z < end.z(); z++ )
+    {
+      for ( index_type y = start.y(); y < end.y(); y++ )
+      {
+        for ( index_type x = start.x(); x < end.x(); x++ )
+        {
+          neighbors.insert( std::make_pair( level, 
+            z * layout.x() * layout.y() + y * layout.x() + x ) );
+        }
+      }
+    }
+  }
+
+  bricks.insert( neighbors.begin(), neighbors.end() );
+}
+
+bool LargeVolumeSchemaPrivate::load_generations( std::string& error )
+{
+  boost::mutex::scoped_lock lock( this->generation_mutex_ );
+  this->brick_generation_.clear();
+  this->pending_bricks_.clear();
+
+  bfs::path pending_filename = this->dir_ / PENDING_FILE_NAME_C;
+  if ( bfs::exists( pending_filename ) )
+  {
+    try
+    {
+      std::ifstream file_text( pending_filename.string().c_str() );
+      std::string line;
+      while ( std::getline( file_text, line ) )
+      {
+        StripSurroundingSpaces( line );
+        if ( line.empty() ) continue;
+
+        std::vector<long long> values;
+        if ( !ImportFromString( line, values ) || values.size() != 2 )
+        {
+          error = "Could not read pending file '" + pending_filename.string() + "'.";
+          return false;
+        }
+
+        this->pending_bricks_.insert( std::make_pair( static_cast<index_type>( values[ 0 ] ), 
+          static_cast<index_type>( values[ 1 ] ) ) );
+      }
+    }
+    catch ( ... )
+    {
+      error = "Could not read pending file '" + pending_filename.string() + "'.";
+      return false;
+    }
+  }
+
+  bfs::path filename = this->dir_ / GENERATION_FILE_NAME_C;
+
+  // Volumes whose bricks were never rewritten do not have a generation file
+  if ( !bfs::exists( filename ) ) return true;
+
+  try
+  {
+    std::ifstream file_text( filename.string().c_str() );
+    std::string line;
+    while ( std::getline( file_text, line ) )
+    {
+      StripSurroundingSpaces( line );
+      if ( line.empty() ) continue;
+
+      std::vector<long long> values;
+      if ( !ImportFromString( line, values ) || values.size() != 3 )
+      {
+        error = "Could not read generation file '" + filename.string() + "'.";
+        return false;
+      }
+
+      const size_t generation = static_cast<size_t>( values[ 2 ] );
+      this->brick_generation_[ std::make_pair( static_cast<index_type>( values[ 0 ] ), 
+        static_cast<index_type>( values[ 1 ] ) ) ] = generation;
+
+      // The volume file is written last, so it may lag behind the bricks
+      this->generation_ = Max( this->generation_, generation );
+    }
+  }
+  catch ( ... )
+  {
+    error = "Could not read generation file '" + filename.string() + "'.";
+    return false;
+  }
+
+  return true;
+}
+
+bool LargeVolumeSchemaPrivate::save_generations( std::string& error )
+{
+  std::ostringstream generations;
+  std::ostringstream pending;
+  {
+    boost::mutex::scoped_lock lock( this->generation_mutex_ );
+    brick_generation_map_type::const_iterator it = this->brick_generation_.begin();
+    for ( ; it != this->brick_generation_.end(); ++it )
+    {
+      generations << it->first.first << " " << it->first.second << " " << it->second << 
+        std::endl;
+    }
+
+    brick_set_type::const_iterator pit = this->pending_bricks_.begin();
+    for ( ; pit != this->pending_bricks_.end(); ++pit )
+    {
+      pending << pit->first << " " << pit->second << std::endl;
+    }
+  }
+
+  // Like the bricks the files are replaced as a whole, so they are never left half written
+  std::string generations_text = generations.str();
+  if ( !WriteFile( this->dir_ / GENERATION_FILE_NAME_C, generations_text.c_str(), 
+    generations_text.size(), error ) ) return false;
+
+  // Volumes without an unfinished update do not have a pending file
+  bfs::path pending_filename = this->dir_ / PENDING_FILE_NAME_C;
+  std::string pending_text = pending.str();
+  if ( pending_text.empty() )
+  {
+    boost::system::error_code ec;
+    bfs::remove( pending_filename, ec );
+    if ( ec )
+    {
+      error = "Could not remove file '" + pending_filename.string() + "'.";
+      return false;
+    }
+    return true;
+  }
+  return WriteFile( pending_filename, pending_text.c_str(), pending_text.size(), error );
+}
+
+bool LargeVolumeSchemaPrivate::mark_bricks( const brick_set_type& bricks, size_t generation, 
+  std::string& error )
+{
+  {
+    boost::mutex::scoped_lock lock( this->generation_mutex_ );
+    brick_set_type::const_iterator it = bricks.begin();
+    for ( ; it != bricks.end(); ++it )
+    {
+      this->brick_generation_[ *it ] = generation;
+    }
+  }
+
+  return this->save_generations( error );
+}
+
+bool LargeVolumeSchemaPrivate::mark_pending( const brick_set_type& bricks, bool pending,
+  std::string& error )
+{
+  {
+    boost::mutex::scoped_lock lock( this->generation_mutex_ );
+    brick_set_type::const_iterator it = bricks.begin();
+    for ( ; it != bricks.end(); ++it )
+    {
+      if ( pending ) this->pending_bricks_.insert( *it );
+      else this->pending_bricks_.erase( *it );
+    }
+  }
+
+  return this->save_generations( error );
+}
+
 LargeVolumeSchema::LargeVolumeSchema() :
   private_(new LargeVolumeSchemaPrivate),
   VOLUME_FILE_NAME_("volume.txt")
@@ -476,6 +829,14 @@ bool LargeVolumeSchema::load( std::string& error)
       return false;
     }
 
+    // Volumes written before bricks could be rebuilt do not have a generation
+    if ( values.find( "generation" ) != values.end() &&
+      !ImportFromString( values[ "generation" ], this->private_->generation_ ) )
+    {
+      error = "Could not read generation field.";
+      return false;
+    }
+
     size_t level = 0;
     
     while ( values.find( "level" + ExportToString(level)) != values.end() )
@@ -502,7 +863,7 @@ bool LargeVolumeSchema::load( std::string& error)
     return false;
   }
 
-  return true;
+  return this->private_->load_generations( error );
 }
 
 
@@ -529,6 +890,7 @@ bool LargeVolumeSchema::save( std::string& error ) const
     text_file << "endian: " << ( this->private_->little_endian_ ? "little" : "big" ) << std::endl;
     text_file << "min: " << ExportToString( this->private_->min_ ) << std::endl;
     text_file << "max: " << ExportToString( this->private_->max_ ) << std::endl;
+    text_file << "generation: " << ExportToString( this->private_->generation_ ) << std::endl;
     
     for (size_t j = 0 ; j < this->private_->levels_.size(); j++ )
     {    
@@ -540,7 +902,7 @@ bool LargeVolumeSchema::save( std::string& error ) const
     return false;
   }
 
-  return true;
+  return this->private_->save_generations( error );
 }
 
 
@@ -604,6 +966,21 @@ double LargeVolumeSchema::get_max() const
   return this->private_->max_;
 }
 
+size_t LargeVolumeSchema::get_generation() const
+{
+  boost::mutex::scoped_lock lock( this->private_->generation_mutex_ );
+  return this->private_->generation_;
+}
+
+size_t LargeVolumeSchema::get_brick_generation( const BrickInfo& bi ) const
+{
+  boost::mutex::scoped_lock lock( this->private_->generation_mutex_ );
+  LargeVolumeSchemaPrivate::brick_generation_map_type::const_iterator it = 
+    this->private_->brick_generation_.find( std::make_pair( bi.level_, bi.index_ ) );
+  if ( it == this->private_->brick_generation_.end() ) return 0;
+  return it->second;
+}
+
 bfs::path LargeVolumeSchema::get_dir() const
 {
   return this->private_->dir_;
@@ -687,6 +1064,12 @@ void LargeVolumeSchema::set_parameters( const IndexVector& size, const Vector& s
   this->private_->effective_brick_size_.z( brick_size.z() - 2 * overlap );
 }
 
+void LargeVolumeSchema::set_levels( const std::vector<IndexVector>& levels )
+{
+  this->private_->levels_ = levels;
+  this->private_->compute_cached_level_info();
+}
+
 void LargeVolumeSchema::set_compression( bool compression )
 {
   this->private_->compression_ = compression;
@@ -751,6 +1134,11 @@ IndexVector LargeVolumeSchema::get_level_layout( index_type level ) const
   return this->private_->level_layout_[ level ];
 }
 
+size_t LargeVolumeSchema::compute_level_num_bricks( index_type level ) const
+{
+  return this->private_->compute_level_num_bricks( level );
+}
+
 IndexVector LargeVolumeSchema::get_brick_size( const BrickInfo& bi ) const
 {
   const IndexVector& effective_brick_size = this->private_->effective_brick_size_;
@@ -845,6 +1233,399 @@ bool LargeVolumeSchema::read_brick( DataBlockHandle& brick, const BrickInfo& bi,
   return true;
 }
 
+bool LargeVolumeSchema::read_region( DataBlockHandle& data_block, index_type level, 
+  const IndexVector& start, const IndexVector& end, std::string& error, 
+  brick_reader_type reader ) const
+{
+  error = "";
+
+  data_block = StdDataBlock::New( end.x() - start.x(), end.y() - start.y(), 
+    end.z() - start.z(), this->get_data_type() );
+  if ( !data_block )
+  {
+    error = "Could not allocate region.";
+    return false;
+  }
+  data_block->clear();
+
+  if ( !reader )
+  {
+    reader = boost::bind( &LargeVolumeSchema::read_brick, this, _1, _2, _3 );
+  }
+
+  const IndexVector& eff_brick_size = this->private_->effective_brick_size_;
+  const IndexVector& layout = this->private_->level_layout_[ level ];
+  const IndexVector& level_size = this->private_->level_size_[ level ];
+
+  // Range of bricks whose interior intersects the part of the region inside the level
+  IndexVector brick_start, brick_end;
+  for ( size_t j = 0; j < 3; j++ )
+  {
+    index_type region_start = Max( start[ j ], static_cast<index_type>( 0 ) );
+    index_type region_end = Min( end[ j ], level_size[ j ] );
+    if ( region_start >= region_end ) return true;
+
+    brick_start[ j ] = region_start / eff_brick_size[ j ];
+    brick_end[ j ] = Min( ( region_end - 1 ) / eff_brick_size[ j ] + 1, layout[ j ] );
+  }
+
+  for ( index_type z = brick_start.z(); z < brick_end.z(); z++ )
+  {
+    for ( index_type y = brick_start.y(); y < brick_end.y(); y++ )
+    {
+      for ( index_type x = brick_start.x(); x < brick_end.x(); x++ )
+      {
+        BrickInfo bi( z * layout.x() * layout.y() + y * layout.x() + x, level );
+
+        DataBlockHandle brick;
+        if ( !reader( brick, bi, error ) ) return false;
+
+        IndexVector origin( x * eff_brick_size.x(), y * eff_brick_size.y(), 
+          z * eff_brick_size.z() );
+        IndexVector interior_size = this->get_brick_size( bi ) - IndexVector( 
+          2 * this->private_->overlap_, 2 * this->private_->overlap_, 
+          2 * this->private_->overlap_ );
+
+        IndexVector clip_start, clip_end, offset;
+        for ( size_t j = 0; j < 3; j++ )
+        {
+          clip_start[ j ] = Max( static_cast<index_type>( 0 ), start[ j ] - origin[ j ] );
+          clip_end[ j ] = Min( interior_size[ j ], end[ j ] - origin[ j ] );
+          offset[ j ] = origin[ j ] + clip_start[ j ] - start[ j ];
+        }
+
+        if ( !this->private_->insert_brick( data_block, brick, offset, clip_start, clip_end ) )
+        {
+          error = "Could not insert brick into region.";
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+template<class T>
+static void BuildBrickInternal( DataBlockHandle region, const IndexVector& region_start,
+  DataBlockHandle brick, const IndexVector& brick_start, const IndexVector& ratio, 
+  const IndexVector& level_size, const IndexVector& source_size )
+{
+  typedef IndexVector::index_type index_type;
+
+  const T* src = reinterpret_cast<const T*>( region->get_data() );
+  T* dst = reinterpret_cast<T*>( brick->get_data() );
+
+  const index_type rnx = static_cast<index_type>( region->get_nx() );
+  const index_type rny = static_cast<index_type>( region->get_ny() );
+  const index_type bnx = static_cast<index_type>( brick->get_nx() );
+  const index_type bny = static_cast<index_type>( brick->get_ny() );
+  const index_type bnz = static_cast<index_type>( brick->get_nz() );
+
+  for ( index_type z = 0; z < bnz; z++ )
+  {
+    const index_type gz = brick_start.z() + z;
+    for ( index_type y = 0; y < bny; y++ )
+    {
+      const index_type gy = brick_start.y() + y;
+      for ( index_type x = 0; x < bnx; x++, dst++ )
+      {
+        const index_type gx = brick_start.x() + x;
+
+        // Overlap outside of the volume is padded with zeros
+        if ( gx < 0 || gy < 0 || gz < 0 || gx >= level_size.x() || gy >= level_size.y() ||
+          gz >= level_size.z() )
+        {
+          *dst = T( 0 );
+          continue;
+        }
+
+        // Average the source voxels that are inside the level below
+        const index_type sx_end = Min( ( gx + 1 ) * ratio.x(), source_size.x() );
+        const index_type sy_end = Min( ( gy + 1 ) * ratio.y(), source_size.y() );
+        const index_type sz_end = Min( ( gz + 1 ) * ratio.z(), source_size.z() );
+
+        double sum = 0.0;
+        index_type count = 0;
+        for ( index_type sz = gz * ratio.z(); sz < sz_end; sz++ )
+        {
+          for ( index_type sy = gy * ratio.y(); sy < sy_end; sy++ )
+          {
+            const T* row = src + ( ( sz - region_start.z() ) * rny + 
+              ( sy - region_start.y() ) ) * rnx - region_start.x();
+            for ( index_type sx = gx * ratio.x(); sx < sx_end; sx++ )
+            {
+              sum += static_cast<double>( row[ sx ] );
+              count++;
+            }
+          }
+        }
+
+        *dst = count ? static_cast<T>( sum / count ) : T( 0 );
+      }
+    }
+  }
+}
+
+bool LargeVolumeSchema::build_brick( const BrickInfo& bi, std::string& error,
+  brick_reader_type reader ) const
+{
+  error = "";
+
+  if ( bi.level_ < 0 || bi.level_ >= static_cast<index_type>( this->get_num_levels() ) )
+  {
+    error = "Brick is not part of the volume.";
+    return false;
+  }
+
+  const IndexVector& layout = this->private_->level_layout_[ bi.level_ ];
+  const IndexVector index = this->private_->compute_brick_index_vector( layout, bi.index_ );
+
+  // Region of the brick including its overlap in the coordinates of its level
+  const index_type overlap = static_cast<index_type>( this->private_->overlap_ );
+  const IndexVector& eff_brick_size = this->private_->effective_brick_size_;
+  const IndexVector brick_size = this->get_brick_size( bi );
+  const IndexVector brick_start( index.x() * eff_brick_size.x() - overlap, 
+    index.y() * eff_brick_size.y() - overlap, index.z() * eff_brick_size.z() - overlap );
+
+  // The highest resolution cannot be recomputed, only its overlap is copied from the interiors
+  // of the neighboring bricks
+  if ( bi.level_ == 0 )
+  {
+    DataBlockHandle brick;
+    if ( !this->read_region( brick, 0, brick_start, brick_start + brick_size, error, reader ) )
+    {
+      return false;
+    }
+    return this->write_brick( brick, bi, error );
+  }
+
+  const IndexVector& ratio_src = this->private_->levels_[ bi.level_ - 1 ];
+  const IndexVector& ratio_dst = this->private_->levels_[ bi.level_ ];
+  const IndexVector ratio( ratio_dst.x() / ratio_src.x(), ratio_dst.y() / ratio_src.y(),
+    ratio_dst.z() / ratio_src.z() );
+  const IndexVector& level_size = this->private_->level_size_[ bi.level_ ];
+  const IndexVector& source_size = this->private_->level_size_[ bi.level_ - 1 ];
+
+  // The part of the level below that is averaged into the brick
+  IndexVector region_start, region_end;
+  for ( size_t j = 0; j < 3; j++ )
+  {
+    region_start[ j ] = Max( static_cast<index_type>( 0 ), brick_start[ j ] * ratio[ j ] );
+    region_end[ j ] = Min( source_size[ j ], ( brick_start[ j ] + brick_size[ j ] ) * ratio[ j ] );
+    if ( region_end[ j ] < region_start[ j ] ) region_end[ j ] = region_start[ j ];
+  }
+
+  DataBlockHandle region;
+  if ( !this->read_region( region, bi.level_ - 1, region_start, region_end, error, reader ) )
+  {
+    return false;
+  }
+
+  DataBlockHandle brick = StdDataBlock::New( brick_size.x(), brick_size.y(), brick_size.z(),
+    this->get_data_type() );
+  if ( !brick )
+  {
+    error = "Could not allocate brick.";
+    return false;
+  }
+
+  switch ( this->get_data_type() )
+  {
+  case DataType::UCHAR_E:
+    BuildBrickInternal<unsigned char>( region, region_start, brick, brick_start, ratio, 
+      level_size, source_size );
+    break;
+  case DataType::CHAR_E:
+    BuildBrickInternal<signed char>( region, region_start, brick, brick_start, ratio, 
+      level_size, source_size );
+    break;
+  case DataType::USHORT_E:
+    BuildBrickInternal<unsigned short>( region, region_start, brick, brick_start, ratio, 
+      level_size, source_size );
+    break;
+  case DataType::SHORT_E:
+    BuildBrickInternal<short>( region, region_start, brick, brick_start, ratio, 
+      level_size, source_size );
+    break;
+  case DataType::UINT_E:
+    BuildBrickInternal<unsigned int>( region, region_start, brick, brick_start, ratio, 
+      level_size, source_size );
+    break;
+  case DataType::INT_E:
+    BuildBrickInternal<int>( region, region_start, brick, brick_start, ratio, 
+      level_size, source_size );
+    break;
+  case DataType::FLOAT_E:
+    BuildBrickInternal<float>( region, region_start, brick, brick_start, ratio, 
+      level_size, source_size );
+    break;
+  case DataType::DOUBLE_E:
+    BuildBrickInternal<double>( region, region_start, brick, brick_start, ratio, 
+      level_size, source_size );
+    break;
+  default:
+    error = "Unknown data type.";
+    return false;
+  }
+
+  return this->write_brick( brick, bi, error );
+}
+
+// CLASS LargeVolumeSchemaRebuild:
+/// Bricks of one level that are rebuilt in parallel by update_levels.
+class LargeVolumeSchemaRebuild : public boost::noncopyable
+{
+public:
+  const LargeVolumeSchema* schema_;
+  std::vector<BrickInfo> bricks_;
+  boost::mutex mutex_;
+  bool success_;
+  std::string error_;
+
+  void run_parallel( int thread, int num_threads, boost::barrier& barrier )
+  {
+    for ( size_t j = thread; j < this->bricks_.size(); j += num_threads )
+    {
+      std::string error;
+      if ( !this->schema_->build_brick( this->bricks_[ j ], error ) )
+      {
+        boost::mutex::scoped_lock lock( this->mutex_ );
+        if ( this->success_ ) this->error_ = error;
+        this->success_ = false;
+      }
+
+      boost::mutex::scoped_lock lock( this->mutex_ );
+      if ( !this->success_ ) break;
+    }
+  }
+};
+
+// REBUILD_BRICKS:
+// Rebuild a set of bricks in parallel.
+static bool RebuildBricks( const LargeVolumeSchema* schema, 
+  const LargeVolumeSchemaPrivate::brick_set_type& bricks, std::string& error )
+{
+  LargeVolumeSchemaRebuild rebuild;
+  rebuild.schema_ = schema;
+  rebuild.success_ = true;
+  LargeVolumeSchemaPrivate::brick_set_type::const_iterator it = bricks.begin();
+  for ( ; it != bricks.end(); ++it )
+  {
+    rebuild.bricks_.push_back( BrickInfo( it->second, it->first ) );
+  }
+
+  Parallel parallel( boost::bind( &LargeVolumeSchemaRebuild::run_parallel, &rebuild, 
+    _1, _2, _3 ) );
+  parallel.run();
+
+  error = rebuild.error_;
+  return rebuild.success_;
+}
+
+bool LargeVolumeSchema::update_levels( const std::vector<BrickInfo>& bricks, 
+  std::string& error )
+{
+  error = "";
+
+  size_t generation;
+  {
+    boost::mutex::scoped_lock lock( this->private_->generation_mutex_ );
+    generation = ++this->private_->generation_;
+  }
+
+  LargeVolumeSchemaPrivate::brick_set_type rewritten;
+  for ( size_t j = 0; j < bricks.size(); j++ )
+  {
+    if ( bricks[ j ].level_ != 0 ) 
+    {
+      error = "Only bricks of the highest resolution can be updated.";
+      return false;
+    }
+    rewritten.insert( std::make_pair( bricks[ j ].level_, bricks[ j ].index_ ) );
+  }
+
+  // The rewritten bricks are recorded before anything is rebuilt, so a volume whose update did
+  // not finish can be found with get_stale_bricks.
+  if ( !this->private_->mark_pending( rewritten, true, error ) ) return false;
+
+  // The overlap of the neighbors still holds the old voxels of the rewritten bricks, these 
+  // bricks change as well.
+  LargeVolumeSchemaPrivate::brick_set_type changed = rewritten;
+  this->private_->add_neighbor_bricks( 0, changed );
+
+  // A brick only gets the new generation once it has been rebuilt, so a cache that loads it
+  // while it is being rebuilt does not keep the old voxels under the new generation.
+  if ( this->private_->overlap_ > 0 && !RebuildBricks( this, changed, error ) ) return false;
+  if ( !this->private_->mark_bricks( changed, generation, error ) ) return false;
+
+  for ( index_type level = 0; level + 1 < static_cast<index_type>( this->get_num_levels() ); 
+    level++ )
+  {
+    LargeVolumeSchemaPrivate::brick_set_type dependents;
+    this->private_->compute_dependent_bricks( level, changed, dependents );
+
+    if ( !RebuildBricks( this, dependents, error ) ) return false;
+    if ( !this->private_->mark_bricks( dependents, generation, error ) ) return false;
+
+    changed.swap( dependents );
+  }
+
+  if ( !this->private_->mark_pending( rewritten, false, error ) ) return false;
+
+  return this->save( error );
+}
+
+std::vector<BrickInfo> LargeVolumeSchema::get_stale_bricks() const
+{
+  LargeVolumeSchemaPrivate::brick_generation_map_type generations;
+  LargeVolumeSchemaPrivate::brick_set_type pending_bricks;
+  {
+    boost::mutex::scoped_lock lock( this->private_->generation_mutex_ );
+    generations = this->private_->brick_generation_;
+    pending_bricks = this->private_->pending_bricks_;
+  }
+
+  std::vector<BrickInfo> stale_bricks;
+  LargeVolumeSchemaPrivate::brick_set_type::const_iterator pit = pending_bricks.begin();
+  for ( ; pit != pending_bricks.end(); ++pit )
+  {
+    stale_bricks.push_back( BrickInfo( pit->second, 0 ) );
+  }
+
+  // A finished update leaves every brick that depends on a rewritten brick at least at the
+  // generation of that brick.
+  LargeVolumeSchemaPrivate::brick_generation_map_type::const_iterator it = generations.begin();
+  for ( ; it != generations.end() && it->first.first == 0; ++it )
+  {
+    if ( pending_bricks.count( it->first ) ) continue;
+
+    LargeVolumeSchemaPrivate::brick_set_type changed;
+    changed.insert( it->first );
+
+    bool stale = false;
+    for ( index_type level = 0; !stale && 
+      level + 1 < static_cast<index_type>( this->get_num_levels() ); level++ )
+    {
+      LargeVolumeSchemaPrivate::brick_set_type dependents;
+      this->private_->compute_dependent_bricks( level, changed, dependents );
+
+      LargeVolumeSchemaPrivate::brick_set_type::const_iterator dit = dependents.begin();
+      for ( ; dit != dependents.end(); ++dit )
+      {
+        LargeVolumeSchemaPrivate::brick_generation_map_type::const_iterator git = 
+          generations.find( *dit );
+        if ( git == generations.end() || git->second < it->second ) stale = true;
+      }
+      changed.swap( dependents );
+    }
+
+    if ( stale ) stale_bricks.push_back( BrickInfo( it->first.second, 0 ) );
+  }
+
+  return stale_bricks;
+}
+
 bool LargeVolumeSchema::append_brick_buffer( DataBlockHandle data_block, size_t z_start, size_t z_end,
     size_t offset, const BrickInfo& bi, std::string& error ) const
 {
@@ -906,6 +1687,8 @@ bool LargeVolumeSchema::write_brick( DataBlockHandle data_block, const BrickInfo
 
   size_t brick_size = size[0] * size[1] * size[2] * GetSizeDataType( this->get_data_type() );
 
+  // The brick is written next to the old one and then moved over it, so a brick that is being
+  // rewritten can still be read while this happens
   if ( this->private_->compression_) 
   {
     std::vector<char> buffer( brick_size + 12 );
@@ -919,50 +1702,15 @@ bool LargeVolumeSchema::write_brick( DataBlockHandle data_block, const BrickInfo
       return false;
     }
   
+    // Compression succeeded
     if ( brick_size_ul < brick_size )
     {
-      // Compression succeeded
-      try
-      {
-        std::ofstream output( brick_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
-        output.write( &buffer[0], brick_size_ul );
-      }
-      catch ( ... )
-      {
-        error = "Could not write to file '" + brick_file.string() + "'.";
-        return false;
-      }
-
+      return WriteFile( brick_file, &buffer[0], brick_size_ul, error );
     } 
-    else 
-    {
-      try
-      {
-        std::ofstream output( brick_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
-        output.write( reinterpret_cast<char *>( data_block->get_data() ) , brick_size );
-      }
-      catch ( ... )
-      {
-        error = "Could not write to file '" + brick_file.string() + "'.";
-        return false;
-      }   
-    }
-  }
-  else
-  {
-    try
-    {
-      std::ofstream output( brick_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
-      output.write( reinterpret_cast<char *>( data_block->get_data() ) , brick_size );
-    }
-    catch ( ... )
-    {
-      error = "Could not write to file '" + brick_file.string() + "'.";
-      return false;
-    }   
   }
 
-  return true;
+  return WriteFile( brick_file, reinterpret_cast<char *>( data_block->get_data() ), 
+    brick_size, error );
 }
 
 
@@ -1564,27 +2312,7 @@ bool LargeVolumeSchema::get_level_start_and_end( const GridTransform& region, in
 
 bool LargeVolumeSchema::insert_brick( DataBlockHandle volume, DataBlockHandle brick, IndexVector offset, IndexVector clip_start, IndexVector clip_end )
 {
-  switch ( volume->get_data_type() )
-  {
-  case DataType::UCHAR_E:
-    return this->private_->insert_brick_internals<unsigned char>( volume, brick, offset, clip_start, clip_end );
-  case DataType::CHAR_E:
-    return this->private_->insert_brick_internals<signed char>( volume, brick, offset, clip_start, clip_end );
-  case DataType::USHORT_E:
-    return this->private_->insert_brick_internals<unsigned short>( volume, brick, offset, clip_start, clip_end );
-  case DataType::SHORT_E:
-    return this->private_->insert_brick_internals<short>( volume, brick, offset, clip_start, clip_end );
-  case DataType::UINT_E:
-    return this->private_->insert_brick_internals<unsigned int>( volume, brick, offset, clip_start, clip_end );
-  case DataType::INT_E:
-    return this->private_->insert_brick_internals<int>( volume, brick, offset, clip_start, clip_end );
-  case DataType::FLOAT_E:
-    return this->private_->insert_brick_internals<float>( volume, brick, offset, clip_start, clip_end );
-  case DataType::DOUBLE_E:
-    return this->private_->insert_brick_internals<double>( volume, brick, offset, clip_start, clip_end );
-  }
-
-  return false;
+  return this->private_->insert_brick( volume, brick, offset, clip_start, clip_end );
 }
 
 bool LargeVolumeSchema::insert_brick( DataBlockHandle volume, DataBlockHandle brick, IndexVector offset )
@@ -40,6 +40,7 @@
 
 // Boost includes
 #include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 #include <boost/filesystem.hpp>
 
 namespace Core
@@ -125,6 +126,11 @@ class LargeVolumeSchema : public boost::enable_shared_from_this<LargeVolumeSchem
 public:
   typedef IndexVector::index_type index_type;
 
+  /// Function used for reading bricks when assembling regions, it has the same signature
+  /// as read_brick so a cache can be placed in front of the bricks on disk.
+  typedef boost::function< bool ( DataBlockHandle&, const BrickInfo&, std::string& ) > 
+    brick_reader_type;
+
   // -- constructor --
 public:
   LargeVolumeSchema();
@@ -209,6 +215,22 @@ public:
   /// Get minimum value of dataset
   double get_max() const;
 
+  /// GET_GENERATION
+  /// Get the generation of the volume, which is increased each time bricks of the volume
+  /// are rebuilt with update_levels
+  size_t get_generation() const;
+
+  /// GET_BRICK_GENERATION
+  /// Get the generation in which a brick was last rewritten by update_levels, bricks that were
+  /// never rewritten are of generation zero. The generations are stored with the volume.
+  size_t get_brick_generation( const BrickInfo& bi ) const;
+
+  /// GET_STALE_BRICKS
+  /// Get the bricks of the highest resolution whose downsampled levels were not completely
+  /// rebuilt, e.g. because the program stopped during update_levels. Passing them to
+  /// update_levels brings the volume up to date again.
+  std::vector<BrickInfo> get_stale_bricks() const;
+
   /// SET_DIR
   /// Set large volume dir
   void set_dir( const boost::filesystem::path& dir );
@@ -225,6 +247,11 @@ public:
   /// Set min and max values for the dataset
   void set_min_max( double min, double max ) const;
 
+  /// SET_LEVELS
+  /// Set the downsample ratios of all the levels directly, e.g. to give a derived volume the
+  /// same pyramid as the volume it was computed from
+  void set_levels( const std::vector<IndexVector>& levels );
+
   /// ENABLE_DOWNSAMPLE
   /// Enable down sample in certain directions only
   void enable_downsample( bool downsample_x, bool downsample_y, bool downsample_z );
@@ -318,6 +345,30 @@ public:
   bool reprocess_brick( const BrickInfo& bi,
     std::string& error ) const;
 
+  /// READ_REGION
+  /// Assemble the region [start, end) of a level from the bricks that intersect it. Parts of
+  /// the region outside of the level are filled with zeros. If no reader is given the bricks
+  /// are read from disk with read_brick.
+  bool read_region( DataBlockHandle& data_block, index_type level, const IndexVector& start,
+    const IndexVector& end, std::string& error, 
+    brick_reader_type reader = brick_reader_type() ) const;
+
+  /// BUILD_BRICK
+  /// Recompute a brick of level 1 or higher by downsampling the level below it and write it
+  /// to disk. This uses the same averaging as the converter. Bricks of the highest resolution
+  /// only get their overlap copied from the interiors of their neighbors.
+  bool build_brick( const BrickInfo& bi, std::string& error,
+    brick_reader_type reader = brick_reader_type() ) const;
+
+  /// UPDATE_LEVELS
+  /// Rebuild the downsampled levels after the given bricks of the highest resolution were
+  /// rewritten. The overlap of these bricks and of their neighbors, which holds copies of the
+  /// rewritten voxels, is refreshed first. Then only the bricks that depend on them are 
+  /// recomputed, level by level and in parallel within a level. The rewritten bricks start a 
+  /// new generation, so caches only drop those bricks. Only the interiors of the given bricks
+  /// need to be up to date.
+  bool update_levels( const std::vector<BrickInfo>& bricks, std::string& error );
+
   /// APPEND_BRICK_BUFFER
   /// Append data to a brick to disk
   bool append_brick_buffer( DataBlockHandle data_block, size_t z_start, size_t z_end, const size_t offset,
@@ -0,0 +1,146 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/LargeVolume/LargeVolumeCache.h>
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+
+using namespace Core;
+
+namespace bfs = boost::filesystem;
+
+// Directory that is removed when the test is done
+class TemporaryDirectory
+{
+public:
+  TemporaryDirectory() :
+    path_( bfs::temp_directory_path() / bfs::unique_path( "largevolume-%%%%-%%%%-%%%%" ) )
+  {
+  }
+
+  ~TemporaryDirectory()
+  {
+    boost::system::error_code ec;
+    bfs::remove_all( this->path_, ec );
+  }
+
+  bfs::path path_;
+};
+
+// Write every brick of the highest resolution with the same value
+static void writeBricks( const LargeVolumeSchemaHandle& schema, double value )
+{
+  std::string error;
+  std::vector< BrickInfo > bricks;
+  for ( size_t j = 0; j < schema->compute_level_num_bricks( 0 ); j++ )
+  {
+    BrickInfo bi( j, 0 );
+    IndexVector size = schema->get_brick_size( bi );
+    DataBlockHandle brick = StdDataBlock::New( size.x(), size.y(), size.z(), 
+      schema->get_data_type() );
+    for ( size_t k = 0; k < brick->get_size(); k++ ) brick->set_data_at( k, value );
+    ASSERT_TRUE( schema->write_brick( brick, bi, error ) ) << error;
+    bricks.push_back( bi );
+  }
+  ASSERT_TRUE( schema->update_levels( bricks, error ) ) << error;
+}
+
+// The cache loads bricks on its own thread, keep asking until the brick is there
+static bool waitForBrick( const LargeVolumeSchemaHandle& schema, const BrickInfo& bi,
+  DataBlockHandle& brick )
+{
+  for ( int j = 0; j < 500; j++ )
+  {
+    if ( LargeVolumeCache::Instance()->get_brick( schema, bi, "test", brick ) ) return true;
+    boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ) );
+  }
+  return false;
+}
+
+TEST( LargeVolumeCacheTests, RewrittenBricksAreReloaded )
+{
+  TemporaryDirectory dir;
+  LargeVolumeSchemaHandle schema( new LargeVolumeSchema );
+  schema->set_dir( dir.path_ );
+  schema->set_parameters( IndexVector( 20, 20, 20 ), Vector( 1.0, 1.0, 1.0 ), 
+    Point( 0.0, 0.0, 0.0 ), IndexVector( 16, 16, 16 ), 2, DataType::UCHAR_E );
+  schema->compute_levels();
+  std::string error;
+  ASSERT_TRUE( schema->save( error ) ) << error;
+  writeBricks( schema, 10.0 );
+
+  BrickInfo bi( 0, 0 );
+  long long empty_size = LargeVolumeCache::Instance()->get_cache_size();
+  EXPECT_FALSE( LargeVolumeCache::Instance()->mark_brick( schema, bi ) );
+
+  DataBlockHandle brick;
+  ASSERT_TRUE( waitForBrick( schema, bi, brick ) );
+  EXPECT_EQ( 10.0, brick->get_data_at( 2, 2, 2 ) );
+  EXPECT_TRUE( LargeVolumeCache::Instance()->mark_brick( schema, bi ) );
+  EXPECT_EQ( empty_size + static_cast< long long >( brick->get_byte_size() ), 
+    LargeVolumeCache::Instance()->get_cache_size() );
+
+  // The rewritten brick is of a new generation, the cached copy is dropped
+  writeBricks( schema, 20.0 );
+  EXPECT_FALSE( LargeVolumeCache::Instance()->mark_brick( schema, bi ) );
+  EXPECT_EQ( empty_size, LargeVolumeCache::Instance()->get_cache_size() );
+
+  ASSERT_TRUE( waitForBrick( schema, bi, brick ) );
+  EXPECT_EQ( 20.0, brick->get_data_at( 2, 2, 2 ) );
+}
+
+TEST( LargeVolumeCacheTests, ReloadedSchemaKeepsGeneration )
+{
+  TemporaryDirectory dir;
+  LargeVolumeSchemaHandle schema( new LargeVolumeSchema );
+  schema->set_dir( dir.path_ );
+  schema->set_parameters( IndexVector( 20, 20, 20 ), Vector( 1.0, 1.0, 1.0 ), 
+    Point( 0.0, 0.0, 0.0 ), IndexVector( 16, 16, 16 ), 2, DataType::UCHAR_E );
+  schema->compute_levels();
+  std::string error;
+  ASSERT_TRUE( schema->save( error ) ) << error;
+  writeBricks( schema, 30.0 );
+
+  BrickInfo bi( 1, 0 );
+  DataBlockHandle brick;
+  ASSERT_TRUE( waitForBrick( schema, bi, brick ) );
+
+  // Bricks cached for the volume before it was reopened are still of the same generation
+  LargeVolumeSchemaHandle reloaded( new LargeVolumeSchema );
+  reloaded->set_dir( dir.path_ );
+  ASSERT_TRUE( reloaded->load( error ) ) << error;
+  EXPECT_TRUE( LargeVolumeCache::Instance()->mark_brick( reloaded, bi ) );
+}
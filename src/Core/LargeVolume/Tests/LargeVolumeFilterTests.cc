@@ -0,0 +1,185 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/DataBlockFilter.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/LargeVolume/LargeVolumeFilter.h>
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+#include <Testing/Utils/DataBlockSource.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+namespace bfs = boost::filesystem;
+
+// Directory that is removed when the test is done
+class TemporaryDirectory
+{
+public:
+  TemporaryDirectory() :
+    path_( bfs::temp_directory_path() / bfs::unique_path( "largevolume-%%%%-%%%%-%%%%" ) )
+  {
+  }
+
+  ~TemporaryDirectory()
+  {
+    boost::system::error_code ec;
+    bfs::remove_all( this->path_, ec );
+  }
+
+  bfs::path path_;
+};
+
+// Write a volume as bricks of the given size, including the downsampled levels
+static LargeVolumeSchemaHandle createLargeVolume( const bfs::path& dir, 
+  const DataBlockHandle& data_block, size_t brick_size, size_t overlap )
+{
+  LargeVolumeSchemaHandle schema( new LargeVolumeSchema );
+  schema->set_dir( dir );
+  IndexVector size( data_block->get_nx(), data_block->get_ny(), data_block->get_nz() );
+  schema->set_parameters( size, Vector( 1.0, 1.0, 1.0 ), Point( 0.0, 0.0, 0.0 ),
+    IndexVector( brick_size, brick_size, brick_size ), overlap, 
+    data_block->get_data_type() );
+  schema->compute_levels();
+
+  std::string error;
+  EXPECT_TRUE( schema->save( error ) ) << error;
+
+  const IndexVector layout = schema->get_level_layout( 0 );
+  const IndexVector& eff_brick_size = schema->get_effective_brick_size();
+  std::vector< BrickInfo > bricks;
+  for ( size_t j = 0; j < schema->compute_level_num_bricks( 0 ); j++ )
+  {
+    BrickInfo bi( j, 0 );
+    IndexVector index( j % layout.x(), ( j / layout.x() ) % layout.y(), 
+      j / ( layout.x() * layout.y() ) );
+    IndexVector brick_dims = schema->get_brick_size( bi );
+    DataBlockHandle brick = StdDataBlock::New( brick_dims.x(), brick_dims.y(), 
+      brick_dims.z(), data_block->get_data_type() );
+
+    // The overlap outside of the volume is padded with zeros
+    for ( size_t z = 0; z < brick->get_nz(); z++ )
+    {
+      for ( size_t y = 0; y < brick->get_ny(); y++ )
+      {
+        for ( size_t x = 0; x < brick->get_nx(); x++ )
+        {
+          IndexVector::index_type p[ 3 ] = { 
+            index.x() * eff_brick_size.x() - overlap + x,
+            index.y() * eff_brick_size.y() - overlap + y,
+            index.z() * eff_brick_size.z() - overlap + z };
+          bool inside = true;
+          for ( int k = 0; k < 3; k++ ) inside = inside && p[ k ] >= 0 && p[ k ] < size[ k ];
+          brick->set_data_at( x, y, z, inside ? 
+            data_block->get_data_at( p[ 0 ], p[ 1 ], p[ 2 ] ) : 0.0 );
+        }
+      }
+    }
+
+    EXPECT_TRUE( schema->write_brick( brick, bi, error ) ) << error;
+    bricks.push_back( bi );
+  }
+
+  EXPECT_TRUE( schema->update_levels( bricks, error ) ) << error;
+  return schema;
+}
+
+// Filter a large volume and compare its highest resolution with filtering the full volume
+static void checkLargeVolumeFilter( const DataBlockHandle& src, const DataBlockHandle& expected,
+  const LargeVolumeFilter::region_filter_type& filter, size_t halo, DataType data_type,
+  size_t filter_memory = 0 )
+{
+  TemporaryDirectory src_dir, dst_dir;
+  LargeVolumeSchemaHandle src_schema = createLargeVolume( src_dir.path_, src, 16, 2 );
+
+  LargeVolumeSchemaHandle dst_schema = LargeVolumeFilter::CreateSchema( src_schema, 
+    dst_dir.path_, data_type );
+  std::string error;
+  ASSERT_TRUE( LargeVolumeFilter::Run( std::vector< LargeVolumeSchemaHandle >( 1, src_schema ),
+    dst_schema, halo, filter_memory, filter, error ) ) << error;
+
+  DataBlockHandle result;
+  ASSERT_TRUE( dst_schema->read_region( result, 0, IndexVector( 0, 0, 0 ), 
+    dst_schema->get_size(), error ) ) << error;
+  ASSERT_EQ( expected->get_size(), result->get_size() );
+  for ( size_t j = 0; j < expected->get_size(); j++ )
+  {
+    ASSERT_NEAR( expected->get_data_at( j ), result->get_data_at( j ), 1e-3 ) << "index " << j;
+  }
+}
+
+TEST( LargeVolumeFilterTests, GaussianMatchesFullVolume )
+{
+  // NOTE: On data blocks a sigma of 3 uses the recursive filter, which responds to every voxel
+  // of a line and hence cannot be computed brick by brick
+  DataBlockHandle src = generateRandomDataBlock( 37, 29, 23, DataType::UCHAR_E, 0, 255 );
+  const double sigmas[ 2 ] = { 1.5, 3.0 };
+  for ( int j = 0; j < 2; j++ )
+  {
+    DataBlockHandle expected;
+    ASSERT_TRUE( DataBlockFilter::GaussianKernelFilter( src, expected, sigmas[ j ] ) );
+    checkLargeVolumeFilter( src, expected, LargeVolumeFilter::GaussianFilter( sigmas[ j ] ), 
+      LargeVolumeFilter::GetGaussianHalo( sigmas[ j ] ), DataType::FLOAT_E );
+  }
+}
+
+TEST( LargeVolumeFilterTests, GaussianHaloCoversKernel )
+{
+  const double sigmas[ 4 ] = { 0.5, 1.9, 2.0, 6.5 };
+  for ( int j = 0; j < 4; j++ )
+  {
+    EXPECT_EQ( static_cast< size_t >( DataBlockFilter::GetGaussianKernelRadius( sigmas[ j ] ) ),
+      LargeVolumeFilter::GetGaussianHalo( sigmas[ j ] ) );
+  }
+}
+
+TEST( LargeVolumeFilterTests, MeanMatchesFullVolume )
+{
+  DataBlockHandle src = generateRandomDataBlock( 33, 21, 40, DataType::USHORT_E, 0, 4000 );
+  DataBlockHandle expected;
+  ASSERT_TRUE( DataBlockFilter::MeanFilter( src, expected, 3 ) );
+  checkLargeVolumeFilter( src, expected, LargeVolumeFilter::MeanFilter( 3 ), 3, 
+    DataType::FLOAT_E );
+}
+
+TEST( LargeVolumeFilterTests, MedianMatchesFullVolume )
+{
+  DataBlockHandle src = generateRandomDataBlock( 30, 35, 19, DataType::UCHAR_E, 0, 255 );
+  DataBlockHandle expected;
+  ASSERT_TRUE( DataBlockFilter::MedianFilter( src, expected, 2 ) );
+  checkLargeVolumeFilter( src, expected, LargeVolumeFilter::MedianFilter( 2 ), 2, 
+    DataType::UCHAR_E, LargeVolumeFilter::GetMedianFilterMemory( IndexVector( 16, 16, 16 ), 
+    2 ) );
+}
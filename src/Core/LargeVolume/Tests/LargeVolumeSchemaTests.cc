@@ -0,0 +1,307 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+#include <Testing/Utils/DataBlockSource.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+namespace bfs = boost::filesystem;
+
+// Directory that is removed when the test is done
+class TemporaryDirectory
+{
+public:
+  TemporaryDirectory() :
+    path_( bfs::temp_directory_path() / bfs::unique_path( "largevolume-%%%%-%%%%-%%%%" ) )
+  {
+  }
+
+  ~TemporaryDirectory()
+  {
+    boost::system::error_code ec;
+    bfs::remove_all( this->path_, ec );
+  }
+
+  bfs::path path_;
+};
+
+static LargeVolumeSchemaHandle createSchema( const bfs::path& dir, 
+  const DataBlockHandle& data_block )
+{
+  LargeVolumeSchemaHandle schema( new LargeVolumeSchema );
+  schema->set_dir( dir );
+  IndexVector size( data_block->get_nx(), data_block->get_ny(), data_block->get_nz() );
+  schema->set_parameters( size, Vector( 1.0, 1.0, 1.0 ), Point( 0.0, 0.0, 0.0 ),
+    IndexVector( 16, 16, 16 ), 2, data_block->get_data_type() );
+  schema->compute_levels();
+
+  std::string error;
+  EXPECT_TRUE( schema->save( error ) ) << error;
+  return schema;
+}
+
+// Write a brick of the highest resolution from a volume. If the overlap is not filled it
+// is left at zero.
+static void writeBrick( const LargeVolumeSchemaHandle& schema, const DataBlockHandle& data_block,
+  const BrickInfo& bi, bool fill_overlap )
+{
+  const IndexVector layout = schema->get_level_layout( 0 );
+  const IndexVector& eff_brick_size = schema->get_effective_brick_size();
+  const IndexVector size = schema->get_size();
+  const IndexVector::index_type overlap = schema->get_overlap();
+  IndexVector index( bi.index_ % layout.x(), ( bi.index_ / layout.x() ) % layout.y(), 
+    bi.index_ / ( layout.x() * layout.y() ) );
+  IndexVector brick_dims = schema->get_brick_size( bi );
+  DataBlockHandle brick = StdDataBlock::New( brick_dims.x(), brick_dims.y(), 
+    brick_dims.z(), data_block->get_data_type() );
+
+  for ( IndexVector::index_type z = 0; z < brick_dims.z(); z++ )
+  {
+    for ( IndexVector::index_type y = 0; y < brick_dims.y(); y++ )
+    {
+      for ( IndexVector::index_type x = 0; x < brick_dims.x(); x++ )
+      {
+        IndexVector::index_type b[ 3 ] = { x, y, z };
+        IndexVector::index_type p[ 3 ] = { 
+          index.x() * eff_brick_size.x() - overlap + x,
+          index.y() * eff_brick_size.y() - overlap + y,
+          index.z() * eff_brick_size.z() - overlap + z };
+        bool use = true;
+        for ( int k = 0; k < 3; k++ ) 
+        {
+          use = use && p[ k ] >= 0 && p[ k ] < size[ k ];
+          if ( !fill_overlap ) use = use && b[ k ] >= overlap && 
+            b[ k ] < brick_dims[ k ] - overlap;
+        }
+        brick->set_data_at( x, y, z, use ? 
+          data_block->get_data_at( p[ 0 ], p[ 1 ], p[ 2 ] ) : 0.0 );
+      }
+    }
+  }
+
+  std::string error;
+  EXPECT_TRUE( schema->write_brick( brick, bi, error ) ) << error;
+}
+
+// Write all bricks of the highest resolution and build the downsampled levels from scratch
+static LargeVolumeSchemaHandle createLargeVolume( const bfs::path& dir, 
+  const DataBlockHandle& data_block )
+{
+  LargeVolumeSchemaHandle schema = createSchema( dir, data_block );
+  std::vector< BrickInfo > bricks;
+  for ( size_t j = 0; j < schema->compute_level_num_bricks( 0 ); j++ )
+  {
+    writeBrick( schema, data_block, BrickInfo( j, 0 ), true );
+    bricks.push_back( BrickInfo( j, 0 ) );
+  }
+
+  std::string error;
+  EXPECT_TRUE( schema->update_levels( bricks, error ) ) << error;
+  return schema;
+}
+
+static void expectSameBricks( const LargeVolumeSchemaHandle& expected, 
+  const LargeVolumeSchemaHandle& result )
+{
+  std::string error;
+  for ( size_t level = 0; level < expected->get_num_levels(); level++ )
+  {
+    for ( size_t j = 0; j < expected->compute_level_num_bricks( level ); j++ )
+    {
+      BrickInfo bi( j, level );
+      DataBlockHandle expected_brick, result_brick;
+      ASSERT_TRUE( expected->read_brick( expected_brick, bi, error ) ) << error;
+      ASSERT_TRUE( result->read_brick( result_brick, bi, error ) ) << error;
+      ASSERT_EQ( expected_brick->get_size(), result_brick->get_size() );
+      for ( size_t k = 0; k < expected_brick->get_size(); k++ )
+      {
+        ASSERT_EQ( expected_brick->get_data_at( k ), result_brick->get_data_at( k ) ) << 
+          "level " << level << " brick " << j << " index " << k;
+      }
+    }
+  }
+}
+
+// Change a block of voxels in the interior of the volume
+static DataBlockHandle changeVolume( const DataBlockHandle& data_block, const IndexVector& start,
+  const IndexVector& end )
+{
+  DataBlockHandle changed = StdDataBlock::New( data_block->get_nx(), data_block->get_ny(),
+    data_block->get_nz(), data_block->get_data_type() );
+  for ( size_t j = 0; j < data_block->get_size(); j++ )
+  {
+    changed->set_data_at( j, data_block->get_data_at( j ) );
+  }
+  for ( IndexVector::index_type z = start.z(); z < end.z(); z++ )
+  {
+    for ( IndexVector::index_type y = start.y(); y < end.y(); y++ )
+    {
+      for ( IndexVector::index_type x = start.x(); x < end.x(); x++ )
+      {
+        changed->set_data_at( x, y, z, 4000.0 - data_block->get_data_at( x, y, z ) );
+      }
+    }
+  }
+  return changed;
+}
+
+TEST( LargeVolumeSchemaTests, UpdateLevelsMatchesRebuild )
+{
+  TemporaryDirectory updated_dir, rebuilt_dir;
+  DataBlockHandle src = generateRandomDataBlock( 70, 61, 53, DataType::USHORT_E, 0, 4000, 42 );
+  LargeVolumeSchemaHandle updated = createLargeVolume( updated_dir.path_, src );
+  ASSERT_GT( updated->get_num_levels(), 2u );
+  EXPECT_EQ( 1u, updated->get_generation() );
+
+  // The change covers parts of two bricks, which are rewritten without their overlap
+  DataBlockHandle changed = changeVolume( src, IndexVector( 8, 14, 15 ), 
+    IndexVector( 15, 20, 23 ) );
+  const IndexVector layout = updated->get_level_layout( 0 );
+  std::vector< BrickInfo > bricks;
+  bricks.push_back( BrickInfo( 1 * layout.x() * layout.y() + 1 * layout.x() + 0, 0 ) );
+  bricks.push_back( BrickInfo( 1 * layout.x() * layout.y() + 1 * layout.x() + 1, 0 ) );
+  for ( size_t j = 0; j < bricks.size(); j++ )
+  {
+    writeBrick( updated, changed, bricks[ j ], false );
+  }
+
+  std::string error;
+  ASSERT_TRUE( updated->update_levels( bricks, error ) ) << error;
+  EXPECT_EQ( 2u, updated->get_generation() );
+
+  LargeVolumeSchemaHandle rebuilt = createLargeVolume( rebuilt_dir.path_, changed );
+  expectSameBricks( rebuilt, updated );
+
+  // Only the changed bricks, the neighbors sharing their voxels and the bricks depending on
+  // them are rewritten
+  EXPECT_EQ( 2u, updated->get_brick_generation( bricks[ 0 ] ) );
+  EXPECT_EQ( 2u, updated->get_brick_generation( BrickInfo( 0, 0 ) ) );
+  EXPECT_EQ( 1u, updated->get_brick_generation( 
+    BrickInfo( updated->compute_level_num_bricks( 0 ) - 1, 0 ) ) );
+  size_t num_rewritten = 0;
+  for ( size_t j = 0; j < updated->compute_level_num_bricks( 1 ); j++ )
+  {
+    if ( updated->get_brick_generation( BrickInfo( j, 1 ) ) == 2 ) num_rewritten++;
+  }
+  EXPECT_GT( num_rewritten, 0u );
+  EXPECT_LT( num_rewritten, updated->compute_level_num_bricks( 1 ) );
+  EXPECT_TRUE( updated->get_stale_bricks().empty() );
+}
+
+TEST( LargeVolumeSchemaTests, GenerationsSurviveReload )
+{
+  TemporaryDirectory dir;
+  DataBlockHandle src = generateRandomDataBlock( 40, 30, 20, DataType::USHORT_E, 0, 4000, 7 );
+  LargeVolumeSchemaHandle schema = createLargeVolume( dir.path_, src );
+
+  std::vector< BrickInfo > bricks( 1, BrickInfo( 0, 0 ) );
+  std::string error;
+  ASSERT_TRUE( schema->update_levels( bricks, error ) ) << error;
+
+  LargeVolumeSchemaHandle reloaded( new LargeVolumeSchema );
+  reloaded->set_dir( dir.path_ );
+  ASSERT_TRUE( reloaded->load( error ) ) << error;
+  EXPECT_EQ( schema->get_generation(), reloaded->get_generation() );
+  for ( size_t level = 0; level < schema->get_num_levels(); level++ )
+  {
+    for ( size_t j = 0; j < schema->compute_level_num_bricks( level ); j++ )
+    {
+      EXPECT_EQ( schema->get_brick_generation( BrickInfo( j, level ) ), 
+        reloaded->get_brick_generation( BrickInfo( j, level ) ) );
+    }
+  }
+  EXPECT_TRUE( reloaded->get_stale_bricks().empty() );
+}
+
+TEST( LargeVolumeSchemaTests, InterruptedUpdateLeavesStaleBricks )
+{
+  TemporaryDirectory dir;
+  DataBlockHandle src = generateRandomDataBlock( 40, 30, 20, DataType::USHORT_E, 0, 4000, 3 );
+  LargeVolumeSchemaHandle schema = createLargeVolume( dir.path_, src );
+  ASSERT_GT( schema->get_num_levels(), 1u );
+
+  // Pretend an update stopped after the generation of a brick was stored
+  {
+    std::ofstream generations( ( dir.path_ / "generations.txt" ).string().c_str(), 
+      std::ios_base::app );
+    generations << "0 3 5" << std::endl;
+  }
+
+  LargeVolumeSchemaHandle reloaded( new LargeVolumeSchema );
+  reloaded->set_dir( dir.path_ );
+  std::string error;
+  ASSERT_TRUE( reloaded->load( error ) ) << error;
+  EXPECT_EQ( 5u, reloaded->get_generation() );
+
+  std::vector< BrickInfo > stale = reloaded->get_stale_bricks();
+  ASSERT_EQ( 1u, stale.size() );
+  EXPECT_EQ( 3, stale[ 0 ].index_ );
+  EXPECT_EQ( 0, stale[ 0 ].level_ );
+
+  ASSERT_TRUE( reloaded->update_levels( stale, error ) ) << error;
+  EXPECT_EQ( 6u, reloaded->get_brick_generation( BrickInfo( 3, 0 ) ) );
+  EXPECT_TRUE( reloaded->get_stale_bricks().empty() );
+}
+
+TEST( LargeVolumeSchemaTests, PendingUpdateLeavesStaleBricks )
+{
+  TemporaryDirectory dir;
+  DataBlockHandle src = generateRandomDataBlock( 40, 30, 20, DataType::USHORT_E, 0, 4000, 5 );
+  LargeVolumeSchemaHandle schema = createLargeVolume( dir.path_, src );
+
+  // Pretend an update stopped before any brick was rebuilt
+  {
+    std::ofstream pending( ( dir.path_ / "pending.txt" ).string().c_str() );
+    pending << "0 2" << std::endl;
+  }
+
+  LargeVolumeSchemaHandle reloaded( new LargeVolumeSchema );
+  reloaded->set_dir( dir.path_ );
+  std::string error;
+  ASSERT_TRUE( reloaded->load( error ) ) << error;
+
+  std::vector< BrickInfo > stale = reloaded->get_stale_bricks();
+  ASSERT_EQ( 1u, stale.size() );
+  EXPECT_EQ( 2, stale[ 0 ].index_ );
+  EXPECT_EQ( 0, stale[ 0 ].level_ );
+
+  ASSERT_TRUE( reloaded->update_levels( stale, error ) ) << error;
+  EXPECT_TRUE( reloaded->get_stale_bricks().empty() );
+  EXPECT_FALSE( boost::filesystem::exists( dir.path_ / "pending.txt" ) );
+}
@@ -0,0 +1,313 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef _MSC_VER
+#pragma warning( disable: 4244 4267 )
+#endif
+
+// STL includes
+#include <cstring>
+
+// Boost includes
+#include <boost/python.hpp>
+
+// Core includes
+#include <Core/Python/DataBlockBuffer.h>
+
+namespace Core
+{
+
+// CLASS DataBlockBufferPrivate:
+/// The state of a python object that exposes a data block.
+class DataBlockBufferPrivate
+{
+public:
+  DataBlockHandle data_block_;
+  bool writable_;
+  bool closed_;
+  bool released_;
+
+  // Number of buffers that are exported, a read-only data block is locked while this is not 
+  // zero
+  int exports_;
+
+  char format_[ 2 ];
+  Py_ssize_t shape_[ 3 ];
+  Py_ssize_t strides_[ 3 ];
+
+  boost::function< void () > release_function_;
+
+  // LOCK, UNLOCK:
+  // Lock a read-only data block for the first exported buffer and unlock it after the last one.
+  // A writable data block is not locked, as nothing else uses it, but its histogram is updated
+  // after the last buffer.
+  void lock();
+  void unlock();
+
+  // RELEASE:
+  // Call the release function once the object is closed and no buffers remain.
+  void release();
+};
+
+void DataBlockBufferPrivate::lock()
+{
+  // NOTE: Python holds on to the lock for as long as any array uses the buffer, hence a unique
+  // lock would stall every reader of the data block, such as the renderer.
+  if ( !this->writable_ )
+  {
+    this->data_block_->get_mutex().lock_shared();
+  }
+}
+
+void DataBlockBufferPrivate::unlock()
+{
+  if ( this->writable_ )
+  {
+    this->data_block_->increase_generation();
+    this->data_block_->update_histogram();
+    this->data_block_->data_changed_signal_();
+  }
+  else
+  {
+    this->data_block_->get_mutex().unlock_shared();
+  }
+}
+
+void DataBlockBufferPrivate::release()
+{
+  if ( this->released_ || this->exports_ > 0 ) return;
+
+  this->released_ = true;
+  this->data_block_.reset();
+  if ( this->release_function_ ) this->release_function_();
+}
+
+// CLASS DataBlockBufferObject:
+/// The python object, which only holds on to the private class.
+typedef struct
+{
+  PyObject_HEAD
+  DataBlockBufferPrivate* private_;
+} DataBlockBufferObject;
+
+static DataBlockBufferPrivate* GetPrivate( PyObject* self )
+{
+  return reinterpret_cast< DataBlockBufferObject* >( self )->private_;
+}
+
+static int DataBlockBufferGetBuffer( PyObject* self, Py_buffer* view, int flags )
+{
+  DataBlockBufferPrivate* priv = GetPrivate( self );
+  if ( priv->closed_ )
+  {
+    PyErr_SetString( PyExc_BufferError, "The data has been closed." );
+    view->obj = 0;
+    return -1;
+  }
+
+  void* data = priv->data_block_->get_data();
+  Py_ssize_t length = static_cast< Py_ssize_t >( priv->data_block_->get_size() *
+    priv->data_block_->get_elem_size() );
+  if ( PyBuffer_FillInfo( view, self, data, length, priv->writable_ ? 0 : 1, flags ) < 0 )
+  {
+    return -1;
+  }
+
+  view->itemsize = static_cast< Py_ssize_t >( priv->data_block_->get_elem_size() );
+  if ( flags & PyBUF_FORMAT ) view->format = priv->format_;
+  if ( ( flags & PyBUF_ND ) == PyBUF_ND )
+  {
+    view->ndim = 3;
+    view->shape = priv->shape_;
+  }
+  if ( ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES )
+  {
+    view->strides = priv->strides_;
+  }
+
+  if ( priv->exports_ == 0 ) priv->lock();
+  priv->exports_++;
+  return 0;
+}
+
+static void DataBlockBufferReleaseBuffer( PyObject* self, Py_buffer* /*view*/ )
+{
+  DataBlockBufferPrivate* priv = GetPrivate( self );
+  priv->exports_--;
+  if ( priv->exports_ == 0 )
+  {
+    priv->unlock();
+    if ( priv->closed_ ) priv->release();
+  }
+}
+
+static void DataBlockBufferDealloc( PyObject* self )
+{
+  DataBlockBufferPrivate* priv = GetPrivate( self );
+  if ( priv )
+  {
+    // NOTE: Every exported buffer holds a reference to the object, hence none remain here.
+    priv->closed_ = true;
+    priv->release();
+    delete priv;
+  }
+  Py_TYPE( self )->tp_free( self );
+}
+
+static PyObject* DataBlockBufferClose( PyObject* self, PyObject* /*args*/ )
+{
+  DataBlockBufferPrivate* priv = GetPrivate( self );
+  priv->closed_ = true;
+  priv->release();
+  Py_RETURN_NONE;
+}
+
+static PyObject* DataBlockBufferEnter( PyObject* self, PyObject* /*args*/ )
+{
+  Py_INCREF( self );
+  return self;
+}
+
+static PyMethodDef DataBlockBufferMethods[] = 
+{
+  { "close", DataBlockBufferClose, METH_NOARGS, 
+    "Release the data once no arrays use it anymore." },
+  { "__enter__", DataBlockBufferEnter, METH_NOARGS, 0 },
+  { "__exit__", DataBlockBufferClose, METH_VARARGS, 0 },
+  { 0, 0, 0, 0 }
+};
+
+static PyBufferProcs DataBlockBufferProcs;
+static PyTypeObject DataBlockBufferType;
+
+// GETDATABLOCKBUFFERTYPE:
+// Set up the type the first time it is used.
+// NOTE: The fields are set one by one, as C++ does not have designated initializers.
+static PyTypeObject* GetDataBlockBufferType()
+{
+  static bool initialized = false;
+  if ( !initialized )
+  {
+    DataBlockBufferProcs.bf_getbuffer = DataBlockBufferGetBuffer;
+    DataBlockBufferProcs.bf_releasebuffer = DataBlockBufferReleaseBuffer;
+
+    PyTypeObject base_type = { PyVarObject_HEAD_INIT( 0, 0 ) };
+    DataBlockBufferType = base_type;
+    DataBlockBufferType.tp_name = "seg3d.DataBlockBuffer";
+    DataBlockBufferType.tp_basicsize = sizeof( DataBlockBufferObject );
+    DataBlockBufferType.tp_dealloc = DataBlockBufferDealloc;
+    DataBlockBufferType.tp_as_buffer = &DataBlockBufferProcs;
+    DataBlockBufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+    DataBlockBufferType.tp_doc = "Data of a layer that can be used through the buffer protocol.";
+    DataBlockBufferType.tp_methods = DataBlockBufferMethods;
+    if ( PyType_Ready( &DataBlockBufferType ) < 0 )
+    {
+      boost::python::throw_error_already_set();
+    }
+    initialized = true;
+  }
+  return &DataBlockBufferType;
+}
+
+boost::python::object NewDataBlockBuffer( DataBlockHandle data_block, bool writable,
+  boost::function< void () > release_function )
+{
+  DataBlockBufferObject* self = PyObject_New( DataBlockBufferObject, 
+    GetDataBlockBufferType() );
+  if ( !self ) boost::python::throw_error_already_set();
+
+  DataBlockBufferPrivate* priv = new DataBlockBufferPrivate;
+  priv->data_block_ = data_block;
+  priv->writable_ = writable;
+  priv->closed_ = false;
+  priv->released_ = false;
+  priv->exports_ = 0;
+  priv->format_[ 0 ] = GetBufferFormat( data_block->get_data_type() );
+  priv->format_[ 1 ] = 0;
+
+  Py_ssize_t elem_size = static_cast< Py_ssize_t >( data_block->get_elem_size() );
+  priv->shape_[ 0 ] = static_cast< Py_ssize_t >( data_block->get_nz() );
+  priv->shape_[ 1 ] = static_cast< Py_ssize_t >( data_block->get_ny() );
+  priv->shape_[ 2 ] = static_cast< Py_ssize_t >( data_block->get_nx() );
+  priv->strides_[ 2 ] = elem_size;
+  priv->strides_[ 1 ] = elem_size * priv->shape_[ 2 ];
+  priv->strides_[ 0 ] = priv->strides_[ 1 ] * priv->shape_[ 1 ];
+  priv->release_function_ = release_function;
+  self->private_ = priv;
+
+  return boost::python::object( boost::python::handle<>( 
+    reinterpret_cast< PyObject* >( self ) ) );
+}
+
+char GetBufferFormat( DataType data_type )
+{
+  switch ( data_type )
+  {
+  case DataType::CHAR_E:      return 'b';
+  case DataType::UCHAR_E:     return 'B';
+  case DataType::SHORT_E:     return 'h';
+  case DataType::USHORT_E:    return 'H';
+  case DataType::INT_E:       return 'i';
+  case DataType::UINT_E:      return 'I';
+  case DataType::LONGLONG_E:  return 'q';
+  case DataType::ULONGLONG_E: return 'Q';
+  case DataType::FLOAT_E:     return 'f';
+  case DataType::DOUBLE_E:    return 'd';
+  default:                    return 0;
+  }
+}
+
+bool GetBufferDataType( const char* format, DataType& data_type )
+{
+  data_type = DataType::UNKNOWN_E;
+  if ( format == 0 ) format = "B";
+
+  // Only native byte order is supported, which is what numpy exports by default
+  if ( format[ 0 ] == '@' || format[ 0 ] == '=' ) format++;
+  if ( std::strlen( format ) != 1 ) return false;
+
+  switch ( format[ 0 ] )
+  {
+  case 'b': data_type = DataType::CHAR_E; break;
+  case 'B': data_type = DataType::UCHAR_E; break;
+  case 'h': data_type = DataType::SHORT_E; break;
+  case 'H': data_type = DataType::USHORT_E; break;
+  case 'i': data_type = DataType::INT_E; break;
+  case 'I': data_type = DataType::UINT_E; break;
+  case 'l': data_type = sizeof( long ) == 8 ? DataType::LONGLONG_E : DataType::INT_E; break;
+  case 'L': data_type = sizeof( long ) == 8 ? DataType::ULONGLONG_E : DataType::UINT_E; break;
+  case 'q': data_type = DataType::LONGLONG_E; break;
+  case 'Q': data_type = DataType::ULONGLONG_E; break;
+  case 'f': data_type = DataType::FLOAT_E; break;
+  case 'd': data_type = DataType::DOUBLE_E; break;
+  default: return false;
+  }
+  return true;
+}
+
+} // end namespace Core
@@ -0,0 +1,73 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_PYTHON_DATABLOCKBUFFER_H
+#define CORE_PYTHON_DATABLOCKBUFFER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+
+// Boost includes
+#include <boost/python.hpp>
+#include <boost/function.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlock.h>
+
+namespace Core
+{
+
+// NEWDATABLOCKBUFFER:
+/// Create a python object that exposes the data of a data block through the buffer protocol,
+/// so that numpy.asarray() or memoryview() can use the data without copying it. The buffer has
+/// the shape ( nz, ny, nx ). While a buffer of a read-only object is exported the data block is
+/// locked shared. A writable object changes the data block without locking it, hence it needs
+/// a data block that nothing else uses. When the last buffer of a writable object is released,
+/// the generation of the data block is increased and its histogram is updated.
+/// The release function is called once when the object is closed and no buffers remain, or when
+/// it is deleted. The object can be used in a with statement to close it at the end.
+/// NOTE: This function must only be called on the Python thread.
+boost::python::object NewDataBlockBuffer( DataBlockHandle data_block, bool writable,
+  boost::function< void () > release_function = boost::function< void () >() );
+
+// GETBUFFERFORMAT:
+/// Get the struct module format character of a data type, or 0 if it has none.
+char GetBufferFormat( DataType data_type );
+
+// GETBUFFERDATATYPE:
+/// Get the data type of a struct module format string. Returns false if the format is not
+/// one of the data types of a data block.
+bool GetBufferDataType( const char* format, DataType& data_type );
+
+} // end namespace Core
+
+#endif
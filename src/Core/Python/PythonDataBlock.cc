@@ -0,0 +1,152 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef _MSC_VER
+#pragma warning( disable: 4244 4267 )
+#endif
+
+// Boost includes
+#include <boost/python.hpp>
+
+// STL includes
+#include <cstring>
+
+// Core includes
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Python/DataBlockBuffer.h>
+#include <Core/Python/PythonDataBlock.h>
+#include <Core/Python/PythonInterpreter.h>
+
+namespace Core
+{
+
+// ISIMMUTABLE:
+// Check whether the memory of an object can never change. A read-only array or memoryview can
+// still be a view of writable memory, hence the objects the memory belongs to are followed 
+// until the owner of the memory is found. Only bytes are known to never change.
+static bool IsImmutable( PyObject* object )
+{
+  Py_INCREF( object );
+  while ( object != Py_None && !PyBytes_Check( object ) )
+  {
+    // Memoryviews refer to their owner as obj, numpy arrays as base
+    const char* owner_name = PyMemoryView_Check( object ) ? "obj" : "base";
+    PyObject* owner = PyObject_HasAttrString( object, owner_name ) ? 
+      PyObject_GetAttrString( object, owner_name ) : 0;
+    Py_DECREF( object );
+    if ( !owner )
+    {
+      PyErr_Clear();
+      return false;
+    }
+    object = owner;
+  }
+
+  bool immutable = object != Py_None;
+  Py_DECREF( object );
+  return immutable;
+}
+
+PythonDataBlock::PythonDataBlock( Py_buffer* buffer, DataType data_type ) :
+  buffer_( buffer )
+{
+  this->set_nx( static_cast< size_t >( buffer->shape[ 2 ] ) );
+  this->set_ny( static_cast< size_t >( buffer->shape[ 1 ] ) );
+  this->set_nz( static_cast< size_t >( buffer->shape[ 0 ] ) );
+  this->set_type( data_type );
+  this->set_data( buffer->buf );
+}
+
+PythonDataBlock::~PythonDataBlock()
+{
+  // NOTE: The buffer can be released right away by a thread that holds the global interpreter 
+  // lock, other threads hand it to the interpreter thread.
+  if ( PyGILState_Check() )
+  {
+    PyBuffer_Release( this->buffer_ );
+    delete this->buffer_;
+    return;
+  }
+  PythonInterpreter::Instance()->release_buffer( this->buffer_ );
+}
+
+bool PythonDataBlock::New( PyObject* object, DataBlockHandle& data_block, std::string& error )
+{
+  data_block.reset();
+
+  Py_buffer* buffer = new Py_buffer;
+  if ( PyObject_GetBuffer( object, buffer, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT ) < 0 )
+  {
+    PyErr_Clear();
+    delete buffer;
+    error = "The data needs to be a C contiguous array.";
+    return false;
+  }
+
+  DataType data_type = DataType::UNKNOWN_E;
+  if ( buffer->ndim != 3 )
+  {
+    error = "The data needs to have three dimensions.";
+  }
+  else if ( !GetBufferDataType( buffer->format, data_type ) ||
+    static_cast< size_t >( buffer->itemsize ) != GetSizeDataType( data_type ) )
+  {
+    error = "The data type of the array is not supported.";
+  }
+  else if ( buffer->shape[ 0 ] == 0 || buffer->shape[ 1 ] == 0 || buffer->shape[ 2 ] == 0 )
+  {
+    error = "The data is empty.";
+  }
+  else if ( buffer->readonly && IsImmutable( object ) )
+  {
+    data_block = DataBlockHandle( new PythonDataBlock( buffer, data_type ) );
+    return true;
+  }
+  else
+  {
+    // NOTE: Python can change writable memory at any time without locking the data block,
+    // hence the data is copied.
+    data_block = StdDataBlock::New( static_cast< size_t >( buffer->shape[ 2 ] ), 
+      static_cast< size_t >( buffer->shape[ 1 ] ), static_cast< size_t >( buffer->shape[ 0 ] ),
+      data_type );
+    if ( data_block )
+    {
+      std::memcpy( data_block->get_data(), buffer->buf, static_cast< size_t >( buffer->len ) );
+    }
+    else
+    {
+      error = "Could not allocate enough memory.";
+    }
+  }
+
+  PyBuffer_Release( buffer );
+  delete buffer;
+  return data_block.get() != 0;
+}
+
+} // end namespace Core
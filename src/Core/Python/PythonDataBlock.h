@@ -0,0 +1,78 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_PYTHON_PYTHONDATABLOCK_H
+#define CORE_PYTHON_PYTHONDATABLOCK_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+
+// Boost includes
+#include <boost/python.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlock.h>
+
+namespace Core
+{
+
+// CLASS PythonDataBlock:
+/// A data block that uses the memory of an immutable python object, such as a bytes object or
+/// a read-only numpy array of one, through the buffer protocol instead of copying it. The data 
+/// block keeps the buffer of the object until it is deleted, the buffer is then released on the
+/// Python thread.
+class PythonDataBlock : public DataBlock
+{
+  // -- Constructor/destructor --
+private:
+  PythonDataBlock( Py_buffer* buffer, DataType data_type );
+
+public: 
+  virtual ~PythonDataBlock();
+
+public:
+  // NEW:
+  /// Create a data block from a python object with a three dimensional C contiguous buffer
+  /// of shape ( nz, ny, nx ). The buffer is used without copying it if its memory belongs to a
+  /// bytes object. Other buffers are copied into a StdDataBlock so later changes from python do
+  /// not reach the data block, as a read-only array can still be a view of a writable one.
+  /// Returns false and sets the error if the buffer is not supported.
+  /// NOTE: This function must only be called on the Python thread.
+  static bool New( PyObject* object, DataBlockHandle& data_block, std::string& error );
+
+private:
+  Py_buffer* buffer_;
+};
+
+} // end namespace Core
+
+#endif
@@ -104,6 +104,8 @@ public:
   std::string prompt1_;
   // Python sys.ps2
   std::string prompt2_;
+  // The session for which a command is being run
+  PythonSessionHandle session_;
 
   // Condition variable to make sure the PythonInterpreter thread has 
   // completed initialization before continuing the main thread.
@@ -171,6 +173,37 @@ std::string PythonInterpreterPrivate::read_from_console( const int bytes /*= -1
   return result;
 }
 
+// CLASS PYTHONSESSIONSCOPE
+// Make a session the current one for the duration of a command.
+
+class PythonSessionScope : public boost::noncopyable
+{
+public:
+  PythonSessionScope( PythonInterpreterPrivateHandle interpreter, PythonSessionHandle session ) :
+    interpreter_( interpreter ),
+    session_( session )
+  {
+    if ( this->session_ )
+    {
+      this->interpreter_->session_ = this->session_;
+      std::swap( this->interpreter_->command_buffer_, this->session_->command_buffer_ );
+    }
+  }
+
+  ~PythonSessionScope()
+  {
+    if ( this->session_ )
+    {
+      std::swap( this->interpreter_->command_buffer_, this->session_->command_buffer_ );
+      this->interpreter_->session_.reset();
+    }
+  }
+
+private:
+  PythonInterpreterPrivateHandle interpreter_;
+  PythonSessionHandle session_;
+};
+
 } // end namespace Core
 
 
@@ -194,7 +227,7 @@ public:
 
   int write( std::string data )
   {
-    Core::PythonInterpreter::Instance()->output_signal_( data );
+    Core::PythonInterpreter::Instance()->write_output( data );
     return static_cast< int >( data.size() );
   }
 };
@@ -204,7 +237,7 @@ class PythonStdErr
 public:
   int write( std::string data )
   {
-    Core::PythonInterpreter::Instance()->error_signal_( data );
+    Core::PythonInterpreter::Instance()->write_error( data );
     return static_cast< int >( data.size() );
   }
 };
@@ -367,7 +400,7 @@ void PythonInterpreter::print_banner()
   this->prompt_signal_( this->private_->prompt1_ );
 }
 
-void PythonInterpreter::run_string( std::string command )
+void PythonInterpreter::run_string( std::string command, PythonSessionHandle session )
 {
   {
     PythonInterpreterPrivate::lock_type lock( this->private_->get_mutex() );
@@ -391,10 +424,13 @@ void PythonInterpreter::run_string( std::string command )
       }
     }
 
-    this->post_event( boost::bind( &PythonInterpreter::run_string, this, command ) );
+    this->post_event( boost::bind( &PythonInterpreter::run_string, this, command, session ) );
     return;
   }
 
+  // Route the output and continuation lines to the session
+  PythonSessionScope session_scope( this->private_, session );
+
   // Clear any previous Python errors.
   PyErr_Clear();
 
@@ -440,7 +476,7 @@ void PythonInterpreter::run_string( std::string command )
     {
       if ( PyErr_ExceptionMatches( PyExc_EOFError ) )
       {
-        this->error_signal_( "\nKeyboardInterrupt\n" );
+        this->write_error( "\nKeyboardInterrupt\n" );
         PyErr_Clear();
       }
       else
@@ -452,15 +488,15 @@ void PythonInterpreter::run_string( std::string command )
   // If the code object is Py_None, prompt for more input
   else
   {
-    this->prompt_signal_( this->private_->prompt2_ );
+    this->write_prompt( this->private_->prompt2_ );
     return;
   }
 
   this->private_->command_buffer_.clear();
-  this->prompt_signal_( this->private_->prompt1_ );
+  this->write_prompt( this->private_->prompt1_ );
 }
 
-void PythonInterpreter::run_script( std::string script )
+void PythonInterpreter::run_script( std::string script, PythonSessionHandle session )
 {
   {
     PythonInterpreterPrivate::lock_type lock( this->private_->get_mutex() );
@@ -472,14 +508,17 @@ void PythonInterpreter::run_script( std::string script )
 
   if ( !this->is_eventhandler_thread() )
   {
-    this->post_event( boost::bind( static_cast< void ( PythonInterpreter::* ) ( std::string ) >( 
-      &PythonInterpreter::run_script ), this, script ) );
+    this->post_event( boost::bind( static_cast< void ( PythonInterpreter::* ) ( std::string,
+      PythonSessionHandle ) >( &PythonInterpreter::run_script ), this, script, session ) );
     return;
   }
 
+  // Route the output to the session
+  PythonSessionScope session_scope( this->private_, session );
+
   // Output the script to the console
   //this->output_signal_( "Running script ...\n" + script + "\n" );
-  this->output_signal_( "Running script ...\n" );
+  if ( !session ) this->output_signal_( "Running script ...\n" );
 
   // Clear any previous Python errors.
   PyErr_Clear();
@@ -511,7 +550,7 @@ void PythonInterpreter::run_script( std::string script )
   }
 
   this->private_->command_buffer_.clear();
-  this->prompt_signal_( this->private_->prompt1_ );
+  this->write_prompt( this->private_->prompt1_ );
 }
 
 void PythonInterpreter::run_script( StringVectorConstHandle script )
@@ -582,6 +621,20 @@ void PythonInterpreter::interrupt()
   }
 }
 
+void PythonInterpreter::release_buffer( Py_buffer* buffer )
+{
+  // NOTE: The interpreter thread holds the global interpreter lock, hence buffers can only be
+  // released on that thread.
+  if ( !this->is_eventhandler_thread() )
+  {
+    this->post_event( boost::bind( &PythonInterpreter::release_buffer, this, buffer ) );
+    return;
+  }
+
+  PyBuffer_Release( buffer );
+  delete buffer;
+}
+
 void PythonInterpreter::start_terminal()
 {
   {
@@ -629,6 +682,24 @@ void PythonInterpreter::start_terminal()
   this->private_->terminal_running_ = false;
 }
 
+void PythonInterpreter::write_prompt( const std::string& prompt )
+{
+  if ( this->private_->session_ ) this->private_->session_->prompt_signal_( prompt );
+  else this->prompt_signal_( prompt );
+}
+
+void PythonInterpreter::write_error( const std::string& error )
+{
+  if ( this->private_->session_ ) this->private_->session_->error_signal_( error );
+  else this->error_signal_( error );
+}
+
+void PythonInterpreter::write_output( const std::string& output )
+{
+  if ( this->private_->session_ ) this->private_->session_->output_signal_( output );
+  else this->output_signal_( output );
+}
+
 PythonActionContextHandle PythonInterpreter::get_action_context()
 {
   return this->private_->action_context_;
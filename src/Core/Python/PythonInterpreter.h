@@ -32,6 +32,7 @@
 // Boost includes
 #include <boost/python.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
 #include <boost/signals2/signal.hpp>
 
 // Core includes
@@ -41,10 +42,36 @@
 #include <Core/Python/PythonActionContext.h>
 
 class PythonStdIO;
+class PythonStdErr;
 
 namespace Core
 {
 
+// CLASS PYTHONSESSION
+/// The state of one client of the python interpreter, such as a socket connection.
+/// Commands that are run for a session keep their own buffer for statements that span
+/// multiple lines, and their output is sent to the signals of the session instead of
+/// the signals of the interpreter.
+
+class PythonSession;
+typedef boost::shared_ptr< PythonSession > PythonSessionHandle;
+
+class PythonSession : public boost::noncopyable
+{
+  // -- signals --
+public:
+  typedef boost::signals2::signal< void ( std::string ) > console_output_signal_type;
+  console_output_signal_type prompt_signal_;
+  console_output_signal_type error_signal_;
+  console_output_signal_type output_signal_;
+
+private:
+  friend class PythonSessionScope;
+
+  // The command buffer of this session
+  std::string command_buffer_;
+};
+
 // CLASS PYTHONINTERPRETER
 /// A wrapper class of the python interpreter.
 /// It calls the python interpreter on a separate thread.
@@ -89,14 +116,16 @@ public:
   void print_banner();
 
   // RUN_STRING:
-  /// Execute a single python command.
+  /// Execute a single python command. If a session is given, the output is sent to
+  /// the signals of that session.
   /// NOTE: The command is run in the main namespace.
-  void run_string( std::string command );
+  void run_string( std::string command, PythonSessionHandle session = PythonSessionHandle() );
 
   // RUN_SCRIPT:
-  /// Execute a python script.
+  /// Execute a python script. If a session is given, the output is sent to the
+  /// signals of that session.
   /// NOTE: The script is run in its own local namespace.
-  void run_script( std::string script );
+  void run_script( std::string script, PythonSessionHandle session = PythonSessionHandle() );
 
   // RUN_SCRIPT:
   /// Execute a python script.
@@ -112,6 +141,11 @@ public:
   /// Interrupt the current execution.
   void interrupt();
 
+  // RELEASE_BUFFER:
+  /// Release a buffer that was obtained from a python object and delete it. This function can
+  /// be called from any thread, the buffer is released on the Python thread.
+  void release_buffer( Py_buffer* buffer );
+
   // START_TERMINAL:
   /// To be implemented.
   void start_terminal();
@@ -125,8 +159,16 @@ public:
 
 private:
   friend class ::PythonStdIO;
+  friend class ::PythonStdErr;
   PythonInterpreterPrivateHandle private_;
 
+  // WRITE_PROMPT, WRITE_ERROR, WRITE_OUTPUT:
+  // Send text to the session that is currently running or to the interpreter signals
+  // if no session is running.
+  void write_prompt( const std::string& prompt );
+  void write_error( const std::string& error );
+  void write_output( const std::string& output );
+
 public:
   // GETACTIONCONTEXT:
   /// Returns the action context for the python interpreter.
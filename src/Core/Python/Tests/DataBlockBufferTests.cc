@@ -0,0 +1,254 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/python.hpp>
+
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/DataBlockManager.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Python/DataBlockBuffer.h>
+#include <Core/Python/PythonDataBlock.h>
+
+using namespace Core;
+
+// The tests run on the main thread, which holds the global interpreter lock
+class DataBlockBufferTest : public ::testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    if ( !Py_IsInitialized() ) Py_Initialize();
+  }
+
+  // Evaluate a python expression
+  boost::python::object eval( const std::string& expression )
+  {
+    boost::python::object globals = boost::python::import( "__main__" ).attr( "__dict__" );
+    return boost::python::eval( expression.c_str(), globals );
+  }
+};
+
+static void CountRelease( int* count )
+{
+  ( *count )++;
+}
+
+static DataBlockHandle generateDataBlock()
+{
+  DataBlockHandle data_block = StdDataBlock::New( 4, 3, 2, DataType::SHORT_E );
+  for ( size_t j = 0; j < data_block->get_size(); j++ )
+  {
+    data_block->set_data_at( j, static_cast< double >( j ) );
+  }
+  return data_block;
+}
+
+static boost::python::object newMemoryView( const boost::python::object& object )
+{
+  return boost::python::object( boost::python::handle<>( 
+    PyMemoryView_FromObject( object.ptr() ) ) );
+}
+
+TEST_F(DataBlockBufferTest, ReadOnlyExport)
+{
+  DataBlockHandle data_block = generateDataBlock();
+  int releases = 0;
+  boost::python::object buffer = NewDataBlockBuffer( data_block, false, 
+    boost::bind( &CountRelease, &releases ) );
+
+  boost::python::object view = newMemoryView( buffer );
+  Py_buffer* info = PyMemoryView_GET_BUFFER( view.ptr() );
+  EXPECT_TRUE( info->readonly );
+  ASSERT_EQ( info->ndim, 3 );
+  EXPECT_EQ( info->shape[ 0 ], 2 );
+  EXPECT_EQ( info->shape[ 1 ], 3 );
+  EXPECT_EQ( info->shape[ 2 ], 4 );
+  EXPECT_EQ( std::string( info->format ), "h" );
+  EXPECT_EQ( info->buf, data_block->get_data() );
+
+  // The data block is locked shared while the buffer is exported
+  EXPECT_FALSE( data_block->get_mutex().try_lock() );
+  ASSERT_TRUE( data_block->get_mutex().try_lock_shared() );
+  data_block->get_mutex().unlock_shared();
+
+  view = boost::python::object();
+  ASSERT_TRUE( data_block->get_mutex().try_lock() );
+  data_block->get_mutex().unlock();
+
+  EXPECT_EQ( releases, 0 );
+  buffer.attr( "close" )();
+  EXPECT_EQ( releases, 1 );
+
+  // A closed object does not export its data anymore
+  EXPECT_TRUE( PyMemoryView_FromObject( buffer.ptr() ) == 0 );
+  EXPECT_TRUE( PyErr_ExceptionMatches( PyExc_BufferError ) );
+  PyErr_Clear();
+  buffer.attr( "close" )();
+  EXPECT_EQ( releases, 1 );
+}
+
+TEST_F(DataBlockBufferTest, WritableExport)
+{
+  // Only registered data blocks get new generations
+  DataBlockHandle data_block = generateDataBlock();
+  DataBlockManager::Instance()->register_datablock( data_block );
+  DataBlock::generation_type generation = data_block->get_generation();
+  boost::python::object buffer = NewDataBlockBuffer( data_block, true );
+
+  boost::python::object view = newMemoryView( buffer );
+  Py_buffer* info = PyMemoryView_GET_BUFFER( view.ptr() );
+  EXPECT_FALSE( info->readonly );
+  static_cast< short* >( info->buf )[ 5 ] = 42;
+
+  // A writable data block is not locked, so readers are not held up while python uses it
+  ASSERT_TRUE( data_block->get_mutex().try_lock_shared() );
+  data_block->get_mutex().unlock_shared();
+  EXPECT_EQ( data_block->get_generation(), generation );
+
+  view = boost::python::object();
+  EXPECT_NE( data_block->get_generation(), generation );
+  EXPECT_EQ( data_block->get_data_at( 5 ), 42.0 );
+  EXPECT_EQ( data_block->get_max(), 42.0 );
+}
+
+TEST_F(DataBlockBufferTest, LockLifetime)
+{
+  DataBlockHandle data_block = generateDataBlock();
+  int releases = 0;
+  boost::python::object buffer = NewDataBlockBuffer( data_block, false, 
+    boost::bind( &CountRelease, &releases ) );
+
+  // The lock is held until the last of several exports is released
+  boost::python::object view1 = newMemoryView( buffer );
+  boost::python::object view2 = newMemoryView( buffer );
+  view1 = boost::python::object();
+  EXPECT_FALSE( data_block->get_mutex().try_lock() );
+
+  // Closing the object waits for the remaining export
+  buffer.attr( "close" )();
+  EXPECT_EQ( releases, 0 );
+  view2 = boost::python::object();
+  EXPECT_EQ( releases, 1 );
+  ASSERT_TRUE( data_block->get_mutex().try_lock() );
+  data_block->get_mutex().unlock();
+
+  // Deleting an object that was not closed releases it as well
+  buffer = NewDataBlockBuffer( data_block, false, boost::bind( &CountRelease, &releases ) );
+  buffer = boost::python::object();
+  EXPECT_EQ( releases, 2 );
+}
+
+TEST_F(DataBlockBufferTest, WithStatement)
+{
+  DataBlockHandle data_block = generateDataBlock();
+  int releases = 0;
+  boost::python::object globals = boost::python::import( "__main__" ).attr( "__dict__" );
+  globals[ "data" ] = NewDataBlockBuffer( data_block, false, 
+    boost::bind( &CountRelease, &releases ) );
+  boost::python::exec( "with data as d:\n  total = sum( memoryview( d ).cast( 'B' ) )\n", 
+    globals );
+  EXPECT_EQ( releases, 1 );
+  ASSERT_TRUE( data_block->get_mutex().try_lock() );
+  data_block->get_mutex().unlock();
+  boost::python::exec( "del data\n", globals );
+}
+
+TEST_F(DataBlockBufferTest, ReadOnlyBufferIsShared)
+{
+  boost::python::object array = this->eval( 
+    "memoryview( bytes( range( 24 ) ) ).cast( 'B', ( 2, 3, 4 ) )" );
+  DataBlockHandle data_block;
+  std::string error;
+  ASSERT_TRUE( PythonDataBlock::New( array.ptr(), data_block, error ) );
+  EXPECT_EQ( data_block->get_nx(), 4u );
+  EXPECT_EQ( data_block->get_ny(), 3u );
+  EXPECT_EQ( data_block->get_nz(), 2u );
+  EXPECT_EQ( data_block->get_data_type(), DataType::UCHAR_E );
+  EXPECT_EQ( data_block->get_data(), PyMemoryView_GET_BUFFER( array.ptr() )->buf );
+  EXPECT_EQ( data_block->get_data_at( 3, 2, 1 ), 23.0 );
+
+  // The data block holds on to the buffer until it is deleted
+  EXPECT_THROW( array.attr( "release" )(), boost::python::error_already_set );
+  PyErr_Clear();
+  data_block.reset();
+  array.attr( "release" )();
+}
+
+TEST_F(DataBlockBufferTest, ReadOnlyViewIsCopied)
+{
+  // A read-only view can still be changed through the writable memory it belongs to
+  boost::python::object bytes = this->eval( "bytearray( range( 24 ) )" );
+  boost::python::object array = newMemoryView( bytes ).attr( "toreadonly" )().attr( "cast" )( 
+    "B", boost::python::make_tuple( 2, 3, 4 ) );
+  ASSERT_TRUE( PyMemoryView_GET_BUFFER( array.ptr() )->readonly );
+  DataBlockHandle data_block;
+  std::string error;
+  ASSERT_TRUE( PythonDataBlock::New( array.ptr(), data_block, error ) );
+  EXPECT_NE( data_block->get_data(), PyMemoryView_GET_BUFFER( array.ptr() )->buf );
+
+  bytes[ 23 ] = 99;
+  EXPECT_EQ( data_block->get_data_at( 3, 2, 1 ), 23.0 );
+  array.attr( "release" )();
+}
+
+TEST_F(DataBlockBufferTest, WritableBufferIsCopied)
+{
+  boost::python::object bytes = this->eval( "bytearray( range( 24 ) )" );
+  boost::python::object array = newMemoryView( bytes ).attr( "cast" )( "B", 
+    boost::python::make_tuple( 2, 3, 4 ) );
+  DataBlockHandle data_block;
+  std::string error;
+  ASSERT_TRUE( PythonDataBlock::New( array.ptr(), data_block, error ) );
+  EXPECT_NE( data_block->get_data(), PyMemoryView_GET_BUFFER( array.ptr() )->buf );
+
+  // Changes from python do not reach the data block, and no buffer is held on to
+  bytes[ 23 ] = 99;
+  EXPECT_EQ( data_block->get_data_at( 3, 2, 1 ), 23.0 );
+  array.attr( "release" )();
+}
+
+TEST_F(DataBlockBufferTest, UnsupportedBuffers)
+{
+  DataBlockHandle data_block;
+  std::string error;
+  boost::python::object flat = this->eval( "bytes( range( 24 ) )" );
+  EXPECT_FALSE( PythonDataBlock::New( flat.ptr(), data_block, error ) );
+  EXPECT_FALSE( data_block );
+  EXPECT_FALSE( error.empty() );
+
+  boost::python::object booleans = this->eval( 
+    "memoryview( bytes( 24 ) ).cast( '?', ( 2, 3, 4 ) )" );
+  error.clear();
+  EXPECT_FALSE( PythonDataBlock::New( booleans.ptr(), data_block, error ) );
+  EXPECT_FALSE( error.empty() );
+  booleans.attr( "release" )();
+}
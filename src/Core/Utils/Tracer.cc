@@ -0,0 +1,297 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <fstream>
+#include <map>
+#include <vector>
+
+// Boost includes
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+// Core includes
+#include <Core/Utils/Tracer.h>
+
+namespace Core
+{
+
+CORE_SINGLETON_IMPLEMENTATION( Tracer );
+
+const size_t Tracer::DEFAULT_CAPACITY_C = 1 << 16;
+const char* Tracer::DEFAULT_FILE_C = "Seg3D_trace.json";
+
+// NOTE: This flag is read without locking, so that checking whether tracing is enabled is cheap.
+static volatile bool TracingEnabled = false;
+
+class TraceEvent
+{
+public:
+  const char* category_;
+  std::string name_;
+  // 'X' for spans and 'i' for instantaneous events
+  char phase_;
+  long long timestamp_;
+  long long duration_;
+  int thread_;
+};
+
+class TracerPrivate
+{
+public:
+  // GET_THREAD_NUMBER:
+  /// Get a small number that identifies the current thread in the trace
+  int get_thread_number();
+
+  // ADD_EVENT:
+  /// Insert an event into the ring buffer
+  void add_event( const TraceEvent& event );
+
+  boost::mutex mutex_;
+
+  // Time from which all time stamps are measured
+  boost::posix_time::ptime start_time_;
+
+  // Ring buffer with the events
+  std::vector< TraceEvent > events_;
+  size_t next_event_;
+  size_t num_events_;
+
+  std::map< boost::thread::id, int > thread_numbers_;
+};
+
+int TracerPrivate::get_thread_number()
+{
+  boost::thread::id id = boost::this_thread::get_id();
+  std::map< boost::thread::id, int >::iterator it = this->thread_numbers_.find( id );
+  if ( it != this->thread_numbers_.end() ) return it->second;
+  
+  int thread_number = static_cast< int >( this->thread_numbers_.size() ) + 1;
+  this->thread_numbers_[ id ] = thread_number;
+  return thread_number;
+}
+
+void TracerPrivate::add_event( const TraceEvent& event )
+{
+  boost::mutex::scoped_lock lock( this->mutex_ );
+  if ( this->events_.empty() ) return;
+
+  TraceEvent& slot = this->events_[ this->next_event_ ];
+  slot = event;
+  slot.thread_ = this->get_thread_number();
+
+  this->next_event_ = ( this->next_event_ + 1 ) % this->events_.size();
+  if ( this->num_events_ < this->events_.size() ) this->num_events_++;
+}
+
+static std::string EscapeJSONString( const std::string& str )
+{
+  std::string result;
+  result.reserve( str.size() );
+  for ( size_t j = 0; j < str.size(); j++ )
+  {
+    char c = str[ j ];
+    if ( c == '"' || c == '\\' ) 
+    {
+      result += '\\';
+      result += c;
+    }
+    else if ( static_cast< unsigned char >( c ) < 0x20 ) 
+    {
+      result += ' ';
+    }
+    else
+    {
+      result += c;
+    }
+  }
+  return result;
+}
+
+Tracer::Tracer() :
+  private_( new TracerPrivate )
+{
+  this->private_->start_time_ = boost::posix_time::microsec_clock::universal_time();
+  this->private_->next_event_ = 0;
+  this->private_->num_events_ = 0;
+}
+
+Tracer::~Tracer()
+{
+}
+
+void Tracer::start( size_t capacity )
+{
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  this->private_->events_.clear();
+  this->private_->events_.resize( capacity );
+  this->private_->next_event_ = 0;
+  this->private_->num_events_ = 0;
+  TracingEnabled = capacity > 0;
+}
+
+void Tracer::stop()
+{
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  TracingEnabled = false;
+}
+
+bool Tracer::is_tracing() const
+{
+  return TracingEnabled;
+}
+
+bool Tracer::has_events() const
+{
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  return this->private_->num_events_ > 0;
+}
+
+long long Tracer::get_timestamp() const
+{
+  return ( boost::posix_time::microsec_clock::universal_time() - 
+    this->private_->start_time_ ).total_microseconds();
+}
+
+void Tracer::add_span( const char* category, const std::string& name, long long start, 
+  long long duration )
+{
+  if ( !TracingEnabled ) return;
+
+  TraceEvent event;
+  event.category_ = category;
+  event.name_ = name;
+  event.phase_ = 'X';
+  event.timestamp_ = start;
+  event.duration_ = duration;
+  this->private_->add_event( event );
+}
+
+void Tracer::add_event( const char* category, const std::string& name )
+{
+  if ( !TracingEnabled ) return;
+
+  TraceEvent event;
+  event.category_ = category;
+  event.name_ = name;
+  event.phase_ = 'i';
+  event.timestamp_ = this->get_timestamp();
+  event.duration_ = 0;
+  this->private_->add_event( event );
+}
+
+bool Tracer::export_to_file( const std::string& filename, std::string& error ) const
+{
+  std::ofstream output( filename.c_str() );
+  if ( !output )
+  {
+    error = "Could not open file '" + filename + "'.";
+    return false;
+  }
+
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  
+  output << "{\"traceEvents\":[\n";
+  size_t capacity = this->private_->events_.size();
+  size_t first_event = capacity ? ( this->private_->next_event_ + capacity - 
+    this->private_->num_events_ ) % capacity : 0;
+  for ( size_t j = 0; j < this->private_->num_events_; j++ )
+  {
+    const TraceEvent& event = this->private_->events_[ ( first_event + j ) % capacity ];
+    if ( j ) output << ",\n";
+    output << "{\"name\":\"" << EscapeJSONString( event.name_ ) << "\",\"cat\":\"" << 
+      event.category_ << "\",\"ph\":\"" << event.phase_ << "\",\"ts\":" << event.timestamp_;
+    if ( event.phase_ == 'X' ) output << ",\"dur\":" << event.duration_;
+    else output << ",\"s\":\"t\"";
+    output << ",\"pid\":1,\"tid\":" << event.thread_ << "}";
+  }
+  output << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  if ( !output )
+  {
+    error = "Could not write to file '" + filename + "'.";
+    return false;
+  }
+
+  return true;
+}
+
+bool Tracer::IsTracing()
+{
+  return TracingEnabled;
+}
+
+bool Tracer::GetTraceFile( int argc, char** argv, std::string& trace_file )
+{
+  const std::string option( "--trace" );
+  for ( int j = 1; j < argc; j++ )
+  {
+    std::string arg( argv[ j ] );
+    if ( arg == option )
+    {
+      trace_file = DEFAULT_FILE_C;
+      return true;
+    }
+    if ( arg.compare( 0, option.size() + 1, option + "=" ) == 0 )
+    {
+      trace_file = arg.substr( option.size() + 1 );
+      if ( trace_file.empty() ) trace_file = DEFAULT_FILE_C;
+      return true;
+    }
+  }
+  return false;
+}
+
+TraceScope::TraceScope( const char* category, const std::string& name ) :
+  category_( category ),
+  start_( 0 ),
+  active_( Tracer::IsTracing() )
+{
+  if ( this->active_ )
+  {
+    this->name_ = name;
+    this->start_ = Tracer::Instance()->get_timestamp();
+  }
+}
+
+TraceScope::~TraceScope()
+{
+  this->end();
+}
+
+void TraceScope::end()
+{
+  if ( !this->active_ ) return;
+  this->active_ = false;
+
+  Tracer* tracer = Tracer::Instance();
+  tracer->add_span( this->category_, this->name_, this->start_, 
+    tracer->get_timestamp() - this->start_ );
+}
+
+} // end namespace Core
@@ -0,0 +1,160 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_UTILS_TRACER_H
+#define CORE_UTILS_TRACER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+
+// Boost includes
+#include <boost/noncopyable.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/preprocessor/cat.hpp>
+
+// Core includes
+#include <Core/Utils/Singleton.h>
+
+namespace Core
+{
+
+// CLASS TRACER:
+/// The tracer records timed spans and events from any thread into a ring buffer of fixed size.
+/// The recorded trace can be exported in the Chrome trace event format, which can be viewed in
+/// chrome://tracing or Perfetto. When tracing is not enabled, recording a span costs only a
+/// check of a flag.
+
+class TracerPrivate;
+typedef boost::shared_ptr< TracerPrivate > TracerPrivateHandle;
+
+class Tracer : public boost::noncopyable
+{
+  CORE_SINGLETON( Tracer );
+
+  // -- Constructor/Destructor --
+private:
+  Tracer();
+  virtual ~Tracer();
+
+  // -- Recording --
+public:
+  // START:
+  /// Start recording. The buffer keeps the last capacity events.
+  void start( size_t capacity = DEFAULT_CAPACITY_C );
+
+  // STOP:
+  /// Stop recording. The events recorded so far are kept until the next call to start.
+  void stop();
+
+  // IS_TRACING:
+  /// Whether events are currently being recorded
+  bool is_tracing() const;
+
+  // HAS_EVENTS:
+  /// Whether there are recorded events that can be exported
+  bool has_events() const;
+
+  // GET_TIMESTAMP:
+  /// Get the current time in microseconds since the tracer was created
+  long long get_timestamp() const;
+
+  // ADD_SPAN:
+  /// Record a span that started at start and lasted duration microseconds
+  void add_span( const char* category, const std::string& name, long long start, 
+    long long duration );
+
+  // ADD_EVENT:
+  /// Record an instantaneous event
+  void add_event( const char* category, const std::string& name );
+
+  // -- Export --
+public:
+  // EXPORT_TO_FILE:
+  /// Write the recorded events to a file in the Chrome trace event format
+  bool export_to_file( const std::string& filename, std::string& error ) const;
+
+  // -- Internals --
+private:
+  TracerPrivateHandle private_;
+
+public:
+  // ISTRACING:
+  /// Whether events are currently being recorded
+  static bool IsTracing();
+
+  // GETTRACEFILE:
+  /// Find --trace or --trace=<file> on the command line. A bare --trace uses DEFAULT_FILE_C.
+  /// NOTE: The raw arguments are used, as the application parameter parser splits values on
+  /// characters such as '-', ':' and '=' that are common in paths.
+  static bool GetTraceFile( int argc, char** argv, std::string& trace_file );
+
+  // Number of events that are kept by default
+  const static size_t DEFAULT_CAPACITY_C;
+
+  // File that a bare --trace writes to
+  const static char* DEFAULT_FILE_C;
+};
+
+// CLASS TRACESCOPE:
+/// Records the time between its construction and destruction, or the call to end, as a span.
+class TraceScope : public boost::noncopyable
+{
+public:
+  TraceScope( const char* category, const std::string& name );
+  ~TraceScope();
+
+  // END:
+  /// End the span before the scope is left
+  void end();
+
+private:
+  const char* category_;
+  std::string name_;
+  long long start_;
+  bool active_;
+};
+
+} // end namespace Core
+
+// CORE_TRACE_SCOPE:
+/// Trace the remainder of the current scope. The name is only evaluated when tracing is enabled.
+#define CORE_TRACE_SCOPE( category, name ) \
+  Core::TraceScope BOOST_PP_CAT( trace_scope_, __LINE__ )( category, \
+    Core::Tracer::IsTracing() ? std::string( name ) : std::string() )
+
+// CORE_TRACE_EVENT:
+/// Record an instantaneous event
+#define CORE_TRACE_EVENT( category, name ) \
+  do { if ( Core::Tracer::IsTracing() ) Core::Tracer::Instance()->add_event( category, name ); } \
+  while ( false )
+
+#endif
@@ -437,12 +437,13 @@ void DataVolume::unregister_data()
 }
 
 bool DataVolume::LoadDataVolume( const boost::filesystem::path& filename, 
-                DataVolumeHandle& volume, std::string& error )
+                DataVolumeHandle& volume, std::string& error, 
+                boost::function< void ( double ) > progress )
 {
   volume.reset();
   
   NrrdDataHandle nrrd;
-  if ( ! ( NrrdData::LoadNrrd( filename.string(), nrrd, error ) ) ) return false;
+  if ( ! ( NrrdData::LoadNrrd( filename.string(), nrrd, error, progress ) ) ) return false;
   
   Core::DataBlockHandle datablock( Core::NrrdDataBlock::New( nrrd ) );
   
@@ -453,6 +454,16 @@ bool DataVolume::LoadDataVolume( const boost::filesystem::path& filename,
   return true;
 }
 
+bool DataVolume::LoadGridTransform( const boost::filesystem::path& filename, 
+  GridTransform& grid_transform, std::string& error )
+{
+  NrrdDataHandle nrrd;
+  if ( !NrrdData::LoadNrrdHeader( filename.string(), nrrd, error ) ) return false;
+
+  grid_transform = nrrd->get_grid_transform();
+  return true;
+}
+
 bool DataVolume::SaveDataVolume( const boost::filesystem::path& filepath, 
                 DataVolumeHandle& volume, std::string& error, 
                 bool compress, int level )
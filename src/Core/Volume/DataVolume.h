@@ -130,9 +130,16 @@ private:
 public:
 
   // LOADDATAVOLUME:
-  /// Load a DataVolume from a nrrd file
+  /// Load a DataVolume from a nrrd file. The progress function reports the fraction of the data
+  /// that has been read, if the file format allows it.
   static bool LoadDataVolume( const boost::filesystem::path& filename, DataVolumeHandle& volume,
-    std::string& error );
+    std::string& error, 
+    boost::function< void ( double ) > progress = boost::function< void ( double ) >() );
+
+  // LOADGRIDTRANSFORM:
+  /// Read the grid transform of the volume in a nrrd file without reading its data
+  static bool LoadGridTransform( const boost::filesystem::path& filename, 
+    GridTransform& grid_transform, std::string& error );
 
   // SAVEDATAVOLUME:
   /// Save a DataVolume to a nrrd file
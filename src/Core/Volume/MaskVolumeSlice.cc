@@ -27,10 +27,12 @@
  */
 
 #include <algorithm>
+#include <list>
 
 #include <boost/lambda/lambda.hpp>
 
 #include <Core/Application/Application.h>
+#include <Core/Utils/Lockable.h>
 #include <Core/Volume/MaskVolumeSlice.h>
 #include <Core/RenderResources/RenderResources.h>
 #include <Core/Graphics/PixelBufferObject.h>
@@ -43,8 +45,168 @@ class MaskVolumeSlicePrivate
 public:
   bool using_cache_;
   std::vector< unsigned char > cache_;
+
+  // Buffer used for uploading the cached slice to the texture
+  std::vector< unsigned char > texture_buffer_;
 };
 
+// CLASS MaskSliceCache:
+// Cache of the bytes of slices of the data blocks that store the bit planes of the masks. The
+// bytes contain all the masks of a data block at once, hence the slice is read out of the 
+// volume once, however many masks share the data block and however many viewers show it.
+
+class MaskSliceCache : public Lockable
+{
+public:
+  MaskSliceCache() :
+    size_( 0 )
+  {
+  }
+
+  typedef boost::shared_ptr< const std::vector< unsigned char > > slice_handle_type;
+
+  // GET_SLICE:
+  // Get the bytes of the data block underlying the slice. The bytes are read from the volume
+  // if no slice with the same generation is in the cache.
+  // NOTE: The caller needs to hold a lock on the slice.
+  slice_handle_type get_slice( const MaskVolumeSlice* slice );
+
+  // INVALIDATE:
+  // Remove all the slices of a data block from the cache.
+  void invalidate( const DataBlock* data_block );
+
+private:
+  class Entry
+  {
+  public:
+    Entry( const DataBlockHandle& data_block, VolumeSliceType slice_type, size_t slice_number,
+      DataBlock::generation_type generation, const slice_handle_type& data ) :
+      data_block_( data_block ), slice_type_( slice_type ), slice_number_( slice_number ),
+      generation_( generation ), data_( data )
+    {
+    }
+
+    DataBlockWeakHandle data_block_;
+    VolumeSliceType slice_type_;
+    size_t slice_number_;
+    DataBlock::generation_type generation_;
+    slice_handle_type data_;
+  };
+
+  // ERASE_ENTRY:
+  // Remove an entry and account for its bytes.
+  std::list< Entry >::iterator erase_entry( std::list< Entry >::iterator it );
+
+  // Most recently used entries are at the front
+  std::list< Entry > entries_;
+
+  // Number of bytes held by the entries
+  size_t size_;
+
+  // Number of bytes of slices that are kept. A single slice of a very large volume can be 
+  // bigger than this, in which case only that slice is kept.
+  const static size_t MAX_BYTES_C = 64 * 1024 * 1024;
+};
+
+static MaskSliceCache MaskSliceCacheInstance;
+
+static void CopyPackedMaskData( const MaskVolumeSlice* slice, unsigned char* buffer )
+{
+  size_t current_index = slice->to_index( 0, 0 );
+
+  // Index strides in X and Y direction. Use int instead of size_t because strides might be negative.
+  const int x_stride = slice->nx() > 1 ? static_cast< int >( slice->to_index( 1, 0 ) - current_index ) : 0;
+  const int y_stride = slice->ny() > 1 ? static_cast< int >( slice->to_index( 0, 1 ) - current_index ) : 0;
+
+  const unsigned char* mask_data = slice->get_mask_data_block()->get_mask_data();
+  const size_t nx = slice->nx();
+  const size_t ny = slice->ny();
+
+  size_t row_start = current_index;
+  for ( size_t j = 0; j < ny; j++ )
+  {
+    current_index = row_start;
+    for ( size_t i = 0; i < nx; i++ )
+    {
+      buffer[ j * nx + i ] = mask_data[ current_index ];
+      current_index += x_stride;
+    }
+    row_start += y_stride;
+  }
+}
+
+MaskSliceCache::slice_handle_type MaskSliceCache::get_slice( const MaskVolumeSlice* slice )
+{
+  MaskDataBlockHandle mask_data_block = slice->get_mask_data_block();
+  DataBlockHandle data_block = mask_data_block->get_data_block();
+  VolumeSliceType slice_type = slice->get_slice_type();
+  size_t slice_number = slice->get_slice_number();
+
+  MaskDataBlock::shared_lock_type volume_lock( mask_data_block->get_mutex() );
+  DataBlock::generation_type generation = data_block->get_generation();
+
+  {
+    lock_type lock( this->get_mutex() );
+    std::list< Entry >::iterator it = this->entries_.begin();
+    for ( ; it != this->entries_.end(); ++it )
+    {
+      if ( it->data_block_.lock() == data_block && it->slice_type_ == slice_type &&
+        it->slice_number_ == slice_number && it->generation_ == generation &&
+        it->data_->size() == slice->nx() * slice->ny() )
+      {
+        this->entries_.splice( this->entries_.begin(), this->entries_, it );
+        return it->data_;
+      }
+    }
+  }
+
+  // NOTE: The slice is read without holding the lock of the cache, so other data blocks can
+  // be served in the meantime.
+  boost::shared_ptr< std::vector< unsigned char > > data( 
+    new std::vector< unsigned char >( slice->nx() * slice->ny() ) );
+  if ( !data->empty() ) CopyPackedMaskData( slice, &( *data )[ 0 ] );
+
+  lock_type lock( this->get_mutex() );
+  this->entries_.push_front( Entry( data_block, slice_type, slice_number, generation, data ) );
+  this->size_ += data->size();
+  while ( this->size_ > MAX_BYTES_C && this->entries_.size() > 1 ) 
+  {
+    this->erase_entry( --this->entries_.end() );
+  }
+
+  return data;
+}
+
+std::list< MaskSliceCache::Entry >::iterator MaskSliceCache::erase_entry( 
+  std::list< Entry >::iterator it )
+{
+  this->size_ -= it->data_->size();
+  return this->entries_.erase( it );
+}
+
+void MaskSliceCache::invalidate( const DataBlock* data_block )
+{
+  lock_type lock( this->get_mutex() );
+  std::list< Entry >::iterator it = this->entries_.begin();
+  while ( it != this->entries_.end() )
+  {
+    DataBlockHandle entry_data_block = it->data_block_.lock();
+    if ( !entry_data_block || entry_data_block.get() == data_block )
+    {
+      it = this->erase_entry( it );
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+static void InvalidateMaskSliceCache( MaskDataBlock* mask_data_block )
+{
+  MaskSliceCacheInstance.invalidate( mask_data_block->get_data_block().get() );
+}
+
 MaskVolumeSlice::MaskVolumeSlice( const MaskVolumeHandle& mask_volume, 
                  VolumeSliceType type, size_t slice_num ) :
   VolumeSlice( mask_volume, type, slice_num ),
@@ -54,6 +216,12 @@ MaskVolumeSlice::MaskVolumeSlice( const MaskVolumeHandle& mask_volume,
   this->private_->using_cache_ = false;
   if ( this->mask_data_block_ )
   {
+    // NOTE: Masks can be written without a new generation number, hence the slices of the
+    // data block are dropped from the cache whenever a mask changes or is attached to a slice.
+    InvalidateMaskSliceCache( this->mask_data_block_ );
+    this->add_connection( this->mask_data_block_->mask_updated_signal_.connect( 
+      boost::bind( &InvalidateMaskSliceCache, this->mask_data_block_ ), 
+      boost::signals2::at_front ) );
     this->add_connection( this->mask_data_block_->mask_updated_signal_.connect( 
       boost::bind( &VolumeSlice::handle_volume_updated, this ), boost::signals2::at_front ) );
     this->add_connection( this->cache_updated_signal_.connect( boost::bind(
@@ -131,43 +299,42 @@ void MaskVolumeSlice::upload_texture()
     this->set_size_changed( false );
   }
   
+  // NOTE: The texture holds all the bit planes of the data block. The shaders pick out the 
+  // bit of this mask, hence the bytes are uploaded without extracting the mask first.
+  const size_t size = nx * ny;
   if ( this->private_->using_cache_ )
   {
+    // The cache holds 0 or 1 for each pixel, which is moved to the bit of this mask
+    const unsigned char mask_value = this->mask_data_block_->get_mask_value();
+    std::vector< unsigned char >& buffer = this->private_->texture_buffer_;
+    buffer.resize( size );
+    for ( size_t j = 0; j < size; j++ )
+    {
+      buffer[ j ] = this->private_->cache_[ j ] ? mask_value : 0;
+    }
+
     glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
     tex->set_sub_image( 0, 0, static_cast<int>( nx ), 
-      static_cast<int>( ny ), &this->private_->cache_[ 0 ], GL_ALPHA, GL_UNSIGNED_BYTE );
+      static_cast<int>( ny ), size > 0 ? &buffer[ 0 ] : 0, GL_ALPHA, GL_UNSIGNED_BYTE );
     tex->unbind();
   }
   else
   {
-    // Step 1. copy the data in the slice to a pixel unpack buffer
-    PixelBufferObjectHandle pixel_buffer( new PixelUnpackBuffer );
-    pixel_buffer->bind();
-    pixel_buffer->set_buffer_data( sizeof(unsigned char) * nx * ny,
-      NULL, GL_STREAM_DRAW );
-    unsigned char* buffer = reinterpret_cast<unsigned char*>(
-      pixel_buffer->map_buffer( GL_WRITE_ONLY ) );
+    // Step 1. get the bytes of the slice, which are shared with the other masks of the data
+    // block.
+    MaskSliceCache::slice_handle_type packed_slice = MaskSliceCacheInstance.get_slice( this );
 
-    {
-      MaskDataBlock::shared_lock_type volume_lock( 
-        this->mask_data_block_->get_mutex() );
-      CopyMaskData( this, buffer );
-    }
-    
-    // Step 2. copy from the pixel buffer to texture
-    pixel_buffer->unmap_buffer();
+    // Step 2. copy the packed bytes to the texture
+    PixelUnpackBuffer::RestoreDefault();
     glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-    tex->set_sub_image( 0, 0, static_cast<int>( nx ), 
-      static_cast<int>( ny ), NULL, GL_ALPHA, GL_UNSIGNED_BYTE );
+    tex->set_sub_image( 0, 0, static_cast<int>( nx ), static_cast<int>( ny ), 
+      size > 0 ? &( *packed_slice )[ 0 ] : 0, GL_ALPHA, GL_UNSIGNED_BYTE );
     tex->unbind();
 
-    // Step 3. release the pixel unpack buffer
-    // NOTE: The texture streaming will still succeed even if the PBO is deleted.
-    pixel_buffer->unbind();
-
-    // Use glFinish here to solve synchronization issue when the slice is used in multiple views
+    // Use glFinish here to solve synchronization issue when the slice is used in multiple views,
+    // which render with their own contexts. A flush does not guarantee that the upload has 
+    // completed before another context samples the texture.
     glFinish();
-
   }
 
   this->set_slice_changed( false );
@@ -195,6 +362,10 @@ void MaskVolumeSlice::set_volume( const VolumeHandle& volume )
   this->mask_data_block_ = mask_volume->get_mask_data_block().get();
   if ( this->mask_data_block_ )
   {
+    InvalidateMaskSliceCache( this->mask_data_block_ );
+    this->add_connection( this->mask_data_block_->mask_updated_signal_.connect( 
+      boost::bind( &InvalidateMaskSliceCache, this->mask_data_block_ ), 
+      boost::signals2::at_front ) );
     this->add_connection( this->mask_data_block_->mask_updated_signal_.connect( 
       boost::bind( &VolumeSlice::handle_volume_updated, this ), boost::signals2::at_front ) );
     this->add_connection( this->cache_updated_signal_.connect( boost::bind(
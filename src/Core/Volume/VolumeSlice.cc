@@ -238,6 +238,7 @@ VolumeSlice::~VolumeSlice()
 
 void VolumeSlice::set_slice_type( VolumeSliceType type )
 {
+  lock_type lock( this->get_mutex() );
   if ( this->private_->slice_type_ != type )
   {
     this->private_->slice_changed_ = true;
@@ -258,6 +259,7 @@ VolumeSliceType VolumeSlice::get_slice_type() const
 
 void VolumeSlice::set_slice_number( size_t slice_num )
 {
+  lock_type lock( this->get_mutex() );
   slice_num = Min( slice_num, this->private_->number_of_slices_ - 1 );
   this->private_->out_of_boundary_ = false;
   if ( this->private_->slice_number_ != slice_num )
@@ -364,6 +366,7 @@ void VolumeSlice::project_onto_slice( const Point& pt, double& i_pos, double& j_
 
 void VolumeSlice::move_slice_to( const Point& pos, bool fail_safe )
 {
+  lock_type lock( this->get_mutex() );
   int slice_num = this->get_closest_slice( pos );
   if ( ( slice_num < 0 || 
     slice_num >= static_cast< int >( this->private_->number_of_slices_ ) ) && 
@@ -381,6 +384,7 @@ void VolumeSlice::move_slice_to( const Point& pos, bool fail_safe )
 
 void VolumeSlice::move_slice_to( double depth, bool fail_safe )
 {
+  lock_type lock( this->get_mutex() );
   Point pos;
   switch ( this->private_->slice_type_ )
   {
@@ -78,6 +78,8 @@ public:
 
   VolumeType volume_type() const;
 
+  /// NOTE: The functions that change the slice lock it, so a renderer can upload and clone
+  /// the slice without holding the state lock.
   void set_slice_type( VolumeSliceType type );
 
   VolumeSliceType get_slice_type() const;
@@ -47,6 +47,7 @@
 #include <Core/Utils/Log.h>
 #include <Core/Utils/LogStreamer.h>
 #include <Core/Utils/LogHistory.h>
+#include <Core/Utils/Tracer.h>
 #include <Core/Application/Application.h>
 #include <Core/Interface/Interface.h>
 #include <Core/Action/ActionHistory.h>
@@ -113,6 +114,13 @@ int main( int argc, char **argv )
   // -- Log application information --
   Core::Application::Instance()->log_start();
 
+  // -- Record a trace of actions, filters and I/O if requested --
+  std::string trace_file;
+  if ( Core::Tracer::GetTraceFile( argc, argv, trace_file ) )
+  {
+    Core::Tracer::Instance()->start();
+  }
+
   // -- Add plugins into the architecture  
   Core::RegisterClasses();
 
@@ -216,6 +224,16 @@ int main( int argc, char **argv )
   // Finish the remainder of the actions that are still on the application thread.
   Core::Application::Instance()->finish();
 
+  // -- Write out the trace that was recorded during this run --
+  if ( !trace_file.empty() )
+  {
+    std::string error;
+    if ( !Core::Tracer::Instance()->export_to_file( trace_file, error ) )
+    {
+      CORE_LOG_ERROR( error );
+    }
+  }
+
   // Indicate a successful finish of the program
   Core::Application::Instance()->log_finish();
 
@@ -26,6 +26,8 @@
  DEALINGS IN THE SOFTWARE.
 */
 
+#include <cstdlib>
+
 #include <Testing/Utils/DataBlockSource.h>
 #include <Core/DataBlock/StdDataBlock.h>
 
@@ -136,4 +138,32 @@ generate3x3x3StdDataBlock(const Core::DataType& type,
   }
 }
 
+Core::DataBlockHandle generateRandomDataBlock(size_t nx, size_t ny, size_t nz,
+                                              const Core::DataType& type,
+                                              int minValue,
+                                              int maxValue,
+                                              unsigned int seed)
+{
+  Core::DataBlockHandle dataBlock = Core::StdDataBlock::New(nx, ny, nz, type);
+  std::srand(seed);
+  for (size_t i = 0; i < dataBlock->get_size(); ++i)
+  {
+    dataBlock->set_data_at(i, static_cast<double>(minValue +
+      std::rand() % (maxValue - minValue + 1)));
+  }
+  return dataBlock;
+}
+
+Core::DataBlockHandle generateIndexedDataBlock(size_t nx, size_t ny, size_t nz,
+                                               const Core::DataType& type,
+                                               size_t period)
+{
+  Core::DataBlockHandle dataBlock = Core::StdDataBlock::New(nx, ny, nz, type);
+  for (size_t i = 0; i < dataBlock->get_size(); ++i)
+  {
+    dataBlock->set_data_at(i, static_cast<double>(period ? i % period : i));
+  }
+  return dataBlock;
+}
+
 }}
@@ -62,6 +62,19 @@ generate3x3x3StdDataBlock(const Core::DataType& type,
                           const Core::Vector& spacing,
                           bool nodeCentered);
 
+// Data block of which every voxel holds a random integer in [minValue, maxValue]. The same
+// seed gives the same data.
+Core::DataBlockHandle generateRandomDataBlock(size_t nx, size_t ny, size_t nz,
+                                              const Core::DataType& type,
+                                              int minValue,
+                                              int maxValue,
+                                              unsigned int seed = 42);
+
+// Data block of which every voxel holds its index, modulo period if period is not zero.
+Core::DataBlockHandle generateIndexedDataBlock(size_t nx, size_t ny, size_t nz,
+                                               const Core::DataType& type = Core::DataType::INT_E,
+                                               size_t period = 0);
+
 }}
 
 #endif